@@ -0,0 +1,297 @@
+// Contains symbols shared by the source files of the headless Client host: its configuration, its in-memory stand-in for the platform
+// layer and the scripted input it feeds the Client with.
+// Can only be included in the main Client Host Translation Unit.
+
+#if (TRANSLATION_UNIT != SYNERGY_CLIENT_HOST_MAIN)
+static_assert(0, "ClientHost.h can only be included inside the SYNERGY_CLIENT_HOST_MAIN translation unit ! Found it with " __BASE_FILE__);
+#endif
+
+#ifndef CLIENT_HOST_INCLUDED
+#define CLIENT_HOST_INCLUDED
+
+#include "SynergyClientAPI.h"
+#include "SynergyJobSystem.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Viewports the Client can allocate at once.
+constexpr size_t CLIENT_HOST_MAX_VIEWPORTS = 8;
+
+// Side of the square tiles the rasterizer splits framebuffers into. Every tile is rasterized whole by a single job.
+constexpr int32_t CLIENT_HOST_RASTER_TILE_SIZE = 64;
+
+// Scratch memory of every rasterizer worker's frame arena, which only holds the batches of its parallel loops.
+constexpr size_t CLIENT_HOST_RASTER_FRAME_ARENA_SIZE = 64 * 1024;
+
+// Every draw call gets a slot this size in the draw call buffer, whatever its type.
+constexpr size_t CLIENT_HOST_DRAW_CALL_SLOT_SIZE = 64;
+
+struct ClientHostConfig
+{
+	// Client library to load. Defaults to the one built alongside the host.
+	const char* LibraryPath = nullptr;
+
+	// Frames to run, 0 for 1000 or the whole capture when replaying one.
+	size_t FrameCount = 0;
+
+	// Time every frame claims to take, whatever it really took. Keeps runs deterministic.
+	float FrameTime = 1.0f / 60.0f;
+
+	size_t PersistentMemorySize = 64ull << 20;
+	size_t FrameMemorySize = 16ull << 20;
+
+	// Draw calls a frame can output before further ones are discarded.
+	size_t MaxDrawCallCount = 1 << 16;
+
+	// Text file of inputs to play, see ClientHostScript_INC.cpp.
+	const char* ScriptPath = nullptr;
+
+	// Input capture to replay instead of a script, see SynergyClientAPI_InputCapture.h.
+	const char* ReplayPath = nullptr;
+
+	// Input capture the Client writes the run's inputs to.
+	const char* CapturePath = nullptr;
+
+	// Moves the cursor across the main viewport every frame when there is no script or replay.
+	bool bCursorSweep = false;
+
+	// Withholds SubmitDrawCommands from the Client, making it output draw calls one by one through NewDrawCall.
+	bool bPerCallDraws = false;
+
+	// Rasterizes the draw calls of every frame into the viewports' framebuffers, see ClientHostRaster_INC.cpp.
+	bool bRaster = false;
+
+	// Workers rasterizing tiles, the thread running frames included. 0 uses one per hardware thread.
+	uint32_t RasterWorkerCount = 0;
+
+	// Rasterizes whole framebuffers every frame, rather than only the tiles the Client's damage rectangles overlap.
+	bool bFullRedraw = false;
+
+	// Image file the main viewport's last frame is written to when rasterizing, as a binary PAM with an alpha channel.
+	const char* RasterImagePath = nullptr;
+
+	// Chrome trace to export the Client's profile to once the run is over.
+	const char* ProfilePath = nullptr;
+};
+
+/*
+	Viewport allocated by the Client. There is no window behind it, only the dimensions the Client asked for.
+*/
+struct ClientHostViewport
+{
+	bool bAllocated = false;
+	char DisplayName[64] = {};
+	Vector2s Dimensions = {};
+};
+
+/*
+	Draw calls output by the current frame, in fixed size slots so any type fits in any slot.
+*/
+struct ClientHostDrawBuffer
+{
+	std::vector<uint8_t> Memory;
+	size_t CallCount = 0;
+
+	// Viewport every call of the buffer targets.
+	std::vector<ViewportID> CallViewports;
+
+	// Draw calls that didn't fit. They were handed the discard slot and are lost.
+	size_t DiscardedCount = 0;
+
+	// Batches the Client submitted its draw calls in, 0 when it output them one by one.
+	size_t BatchCount = 0;
+
+	// Where the frame draws differently from the previous one, as the Client submitted it. Calls output one by one come without damage,
+	// leaving the whole frame damaged.
+	std::vector<DrawDamageRect> DamageRects;
+	bool bFullDamage = true;
+
+	// Given to draw calls once the buffer is full, so the Client always has somewhere to write to.
+	alignas(8) uint8_t DiscardSlot[CLIENT_HOST_DRAW_CALL_SLOT_SIZE];
+};
+
+/*
+	RGBA framebuffer of a viewport, 8 bits per channel in that byte order, rows top to bottom.
+*/
+struct ClientHostFramebuffer
+{
+	Vector2s Dimensions = {};
+	std::vector<uint32_t> Pixels;
+};
+
+/*
+	Draw call brought down to what rasterizing it takes: the pixels it may cover, and how to find which of a row it does cover.
+	Rectangles, lines and bitmaps are convex quads, kept as the four edges their inside is on the positive side of. Ellipses are kept as
+	their center and the coefficients of their equation, relative to the center: A * x^2 + B * x * y + C * y^2 <= 1.
+*/
+struct ClientHostRasterShape
+{
+	// Bounds of the shape within its framebuffer, max excluded.
+	int32_t MinX, MinY, MaxX, MaxY;
+
+	// RGBA color with an opaque alpha channel, and the alpha it gets blended with.
+	uint32_t Color;
+	uint32_t Alpha;
+
+	bool bEllipse;
+	union
+	{
+		// Pixel centers (x, y) inside the quad have EdgeX * x + EdgeY * y + EdgeOffset >= 0 for all four edges.
+		struct
+		{
+			float EdgeX[4];
+			float EdgeY[4];
+			float EdgeOffset[4];
+		} Quad;
+
+		struct
+		{
+			float CenterX, CenterY;
+			float A, B, C;
+		} Ellipse;
+	};
+};
+
+/*
+	Software rasterizer standing in for the platform's renderer. Draw calls are binned into the tiles they overlap, then tiles are
+	rasterized in parallel over a job system, each job owning the pixels of its tiles.
+*/
+struct ClientHostRasterizer
+{
+	SJobSystem Jobs = {};
+	std::vector<uint8_t> JobMemory;
+	bool bStarted = false;
+
+	ClientHostFramebuffer Framebuffers[CLIENT_HOST_MAX_VIEWPORTS];
+
+	// Shapes of the viewport being rasterized, and for every tile the shapes it overlaps, in draw order: those of tile T are
+	// TileShapes[TileShapeOffsets[T]] to TileShapes[TileShapeOffsets[T + 1]] excluded.
+	std::vector<ClientHostRasterShape> Shapes;
+	std::vector<uint32_t> TileShapeOffsets;
+	std::vector<uint32_t> TileShapes;
+
+	// Tiles of the viewport being rasterized that the frame's damage overlaps, flagged then listed. Only those get rasterized.
+	std::vector<uint8_t> TileDamaged;
+	std::vector<uint32_t> DamagedTiles;
+};
+
+enum class ClientHostScriptAction : uint8_t
+{
+	PRESS,
+	RELEASE,
+	CURSOR,
+	CURSOR_LEAVE
+};
+
+// Input played at the start of a given frame.
+struct ClientHostScriptEvent
+{
+	size_t Frame;
+	ClientHostScriptAction Action;
+	ActionKey Key;
+	Vector2s CursorLocation;
+};
+
+/*
+	State of the host, which the platform functions handed to the Client reach through GClientHost as they take no context.
+*/
+struct ClientHostState
+{
+	ClientHostConfig Config;
+
+	void* LibraryHandle = nullptr;
+	SynergyClientAPI API;
+
+	ClientSessionData Session;
+	std::vector<uint8_t> PersistentMemory;
+	std::vector<uint8_t> FrameMemory;
+
+	ClientHostViewport Viewports[CLIENT_HOST_MAX_VIEWPORTS];
+	ClientHostDrawBuffer DrawBuffer;
+	ClientHostRasterizer Raster;
+
+	// Script sorted by frame, and the next event to play.
+	std::vector<ClientHostScriptEvent> Script;
+	size_t NextScriptEvent = 0;
+
+	// Capture being replayed, read whole.
+	std::vector<uint8_t> Replay;
+	InputCaptureReader ReplayReader;
+
+	// Cursor as the platform would report it.
+	Vector2s CursorLocation = {};
+	ViewportID CursorViewport = VIEWPORT_ERROR_ID;
+};
+
+extern ClientHostState* GClientHost;
+
+// MAJOR PROCEDURES
+
+/*
+	Loads the Client library and resolves its entry points. Returns false if the library or one of its essential entry points is missing.
+*/
+bool LoadClientLibrary(ClientHostState& Host);
+
+void UnloadClientLibrary(ClientHostState& Host);
+
+/*
+	Returns the platform functions the Client can call at any time, backed by the host's viewports.
+*/
+PlatformAPI GetClientHostPlatformAPI();
+
+/*
+	Requests a draw call slot from the current frame's draw buffer. Handed to the Client as ClientFrameRequestData::NewDrawCall.
+*/
+DrawCall* ClientHostNewDrawCall(ViewportID TargetViewportID, DrawCallType Type);
+
+/*
+	Receives a frame's draw calls all at once. Handed to the Client as ClientFrameRequestData::SubmitDrawCommands.
+	Calls are stored in the draw buffer like NewDrawCall would have, so the checksum doesn't depend on how the Client output them.
+*/
+void ClientHostSubmitDrawCommands(const DrawCommandList& Commands);
+
+/*
+	Starts the rasterizer's job system. Returns false if it couldn't start.
+*/
+bool StartClientHostRasterizer(ClientHostState& Host);
+
+void StopClientHostRasterizer(ClientHostState& Host);
+
+/*
+	Rasterizes the frame's draw buffer into the framebuffers of the viewports its calls target, in the order calls were output.
+	Framebuffers follow the dimensions of their viewport and keep their pixels across frames, so only tiles overlapping the frame's damage
+	get cleared to opaque black and rasterized again, unless the whole frame is damaged, a framebuffer was resized, or FullRedraw is set.
+	Returns the number of tiles rasterized.
+*/
+size_t RasterizeClientHostFrame(ClientHostState& Host);
+
+/*
+	Writes a framebuffer to an image file, as a binary PAM (RGB_ALPHA tuples). Returns false if the file couldn't be written.
+*/
+bool WriteClientHostFramebufferImage(const ClientHostFramebuffer& Framebuffer, const char* Path);
+
+/*
+	Reads an input script. Returns false and reports the offending line if it doesn't parse.
+*/
+bool LoadClientHostScript(const char* Path, std::vector<ClientHostScriptEvent>& OutScript);
+
+/*
+	Plays the script events of the given frame: fills the frame's action input events and moves the cursor.
+*/
+void PlayClientHostScript(ClientHostState& Host, size_t Frame, std::vector<ActionInputEvent>& OutEvents);
+
+/*
+	Reads a whole input capture to replay. Returns false if it can't be read or isn't a capture.
+*/
+bool LoadClientHostReplay(const char* Path, ClientHostState& Host);
+
+/*
+	Fills the frame's request data with the next captured frame: its number, frame time, cursor and action input events, exactly as
+	captured. Returns false once the capture is over.
+*/
+bool PlayClientHostReplay(ClientHostState& Host, ClientFrameRequestData& OutFrameData, std::vector<ActionInputEvent>& OutEvents);
+
+#endif // CLIENT_HOST_INCLUDED
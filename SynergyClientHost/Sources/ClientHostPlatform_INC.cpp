@@ -0,0 +1,160 @@
+SOURCE_INC_FILE()
+
+// Implementation of the host's stand-in for the platform layer: loading the Client library, and the viewports and draw call buffer the
+// Client outputs to, all kept in memory.
+
+#include "ClientHost.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+static_assert(sizeof(LineDrawCallData) <= CLIENT_HOST_DRAW_CALL_SLOT_SIZE && sizeof(RectangleDrawCallData) <= CLIENT_HOST_DRAW_CALL_SLOT_SIZE
+	&& sizeof(EllipseDrawCallData) <= CLIENT_HOST_DRAW_CALL_SLOT_SIZE && sizeof(BitmapDrawCallData) <= CLIENT_HOST_DRAW_CALL_SLOT_SIZE,
+	"Every draw call type must fit in a draw buffer slot.");
+
+ClientHostState* GClientHost = nullptr;
+
+// CLIENT LIBRARY
+
+static void* FindClientSymbol(void* LibraryHandle, const char* Name)
+{
+#if defined(_WIN32)
+	return (void*)GetProcAddress((HMODULE)LibraryHandle, Name);
+#else
+	return dlsym(LibraryHandle, Name);
+#endif
+}
+
+bool LoadClientLibrary(ClientHostState& Host)
+{
+#if defined(_WIN32)
+	Host.LibraryHandle = (void*)LoadLibraryA(Host.Config.LibraryPath);
+	if (Host.LibraryHandle == nullptr)
+	{
+		fprintf(stderr, "Failed to load the Client library %s (error %lu).\n", Host.Config.LibraryPath, GetLastError());
+		return false;
+	}
+#else
+	Host.LibraryHandle = dlopen(Host.Config.LibraryPath, RTLD_NOW | RTLD_LOCAL);
+	if (Host.LibraryHandle == nullptr)
+	{
+		fprintf(stderr, "Failed to load the Client library: %s\n", dlerror());
+		return false;
+	}
+#endif
+
+	Host.API.Hello = (void (*)())FindClientSymbol(Host.LibraryHandle, "Hello");
+	Host.API.StartClient = (void (*)(ClientSessionData&))FindClientSymbol(Host.LibraryHandle, "StartClient");
+	Host.API.RunClientFrame = (void (*)(ClientSessionData&, ClientFrameRequestData&))FindClientSymbol(Host.LibraryHandle, "RunClientFrame");
+	Host.API.ShutdownClient = (void (*)(ClientSessionData&))FindClientSymbol(Host.LibraryHandle, "ShutdownClient");
+	Host.API.ExportClientFrameProfile = (bool (*)(ClientSessionData&, const char*))FindClientSymbol(Host.LibraryHandle,
+		"ExportClientFrameProfile");
+	Host.API.StartInputCapture = (bool (*)(ClientSessionData&, const char*))FindClientSymbol(Host.LibraryHandle, "StartInputCapture");
+	Host.API.StopInputCapture = (void (*)(ClientSessionData&))FindClientSymbol(Host.LibraryHandle, "StopInputCapture");
+
+	if (!Host.API.APISuccessfullyLoaded())
+	{
+		fprintf(stderr, "The Client library %s lacks essential entry points.\n", Host.Config.LibraryPath);
+		UnloadClientLibrary(Host);
+		return false;
+	}
+	return true;
+}
+
+void UnloadClientLibrary(ClientHostState& Host)
+{
+	if (Host.LibraryHandle != nullptr)
+	{
+#if defined(_WIN32)
+		FreeLibrary((HMODULE)Host.LibraryHandle);
+#else
+		dlclose(Host.LibraryHandle);
+#endif
+	}
+	Host.LibraryHandle = nullptr;
+	Host.API = {};
+}
+
+// PLATFORM API
+
+static ViewportID ClientHostAllocateViewport(const char* DisplayName, Vector2s Dimensions)
+{
+	for (ViewportID viewportID = 0; viewportID < CLIENT_HOST_MAX_VIEWPORTS; viewportID++)
+	{
+		ClientHostViewport& viewport = GClientHost->Viewports[viewportID];
+		if (!viewport.bAllocated)
+		{
+			viewport.bAllocated = true;
+			strncpy(viewport.DisplayName, DisplayName != nullptr ? DisplayName : "", sizeof(viewport.DisplayName) - 1);
+			viewport.Dimensions = Dimensions;
+			return viewportID;
+		}
+	}
+	return VIEWPORT_ERROR_ID;
+}
+
+static void ClientHostDestroyViewport(ViewportID ViewportToDestroy)
+{
+	if (ViewportToDestroy < CLIENT_HOST_MAX_VIEWPORTS)
+	{
+		GClientHost->Viewports[ViewportToDestroy] = {};
+	}
+	if (GClientHost->CursorViewport == ViewportToDestroy)
+	{
+		GClientHost->CursorViewport = VIEWPORT_ERROR_ID;
+	}
+}
+
+PlatformAPI GetClientHostPlatformAPI()
+{
+	PlatformAPI platform;
+	platform.AllocateViewport = ClientHostAllocateViewport;
+	platform.DestroyViewport = ClientHostDestroyViewport;
+	return platform;
+}
+
+DrawCall* ClientHostNewDrawCall(ViewportID TargetViewportID, DrawCallType Type)
+{
+	ClientHostDrawBuffer& drawBuffer = GClientHost->DrawBuffer;
+
+	// Slots are zeroed first so that the bytes a frame outputs only depend on what the Client wrote, padding included.
+	uint8_t* slot = drawBuffer.DiscardSlot;
+	if ((drawBuffer.CallCount + 1) * CLIENT_HOST_DRAW_CALL_SLOT_SIZE <= drawBuffer.Memory.size())
+	{
+		slot = drawBuffer.Memory.data() + drawBuffer.CallCount * CLIENT_HOST_DRAW_CALL_SLOT_SIZE;
+		drawBuffer.CallViewports[drawBuffer.CallCount] = TargetViewportID;
+		drawBuffer.CallCount++;
+	}
+	else
+	{
+		drawBuffer.DiscardedCount++;
+	}
+
+	memset(slot, 0, CLIENT_HOST_DRAW_CALL_SLOT_SIZE);
+	DrawCall* drawCall = (DrawCall*)slot;
+	drawCall->type = Type;
+	return drawCall;
+}
+
+void ClientHostSubmitDrawCommands(const DrawCommandList& Commands)
+{
+	for (size_t batchIndex = 0; batchIndex < Commands.BatchCount; batchIndex++)
+	{
+		const DrawBatch& batch = Commands.Batches[batchIndex];
+		const size_t callSize = GetDrawCallSize(batch.Type);
+		const uint8_t* batchCalls = (const uint8_t*)Commands.Calls[(size_t)batch.Type] + batch.FirstCall * callSize;
+		for (uint32_t callIndex = 0; callIndex < batch.CallCount; callIndex++)
+		{
+			memcpy(ClientHostNewDrawCall(batch.Viewport, batch.Type), batchCalls + callIndex * callSize, callSize);
+		}
+	}
+	GClientHost->DrawBuffer.BatchCount += Commands.BatchCount;
+	GClientHost->DrawBuffer.DamageRects.assign(Commands.DamageRects, Commands.DamageRects + Commands.DamageRectCount);
+	GClientHost->DrawBuffer.bFullDamage = Commands.bFullDamage;
+}
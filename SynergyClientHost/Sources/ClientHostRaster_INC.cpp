@@ -0,0 +1,552 @@
+SOURCE_INC_FILE()
+
+// Implementation of the host's software rasterizer: draw calls of a frame rendered into RGBA framebuffers on the CPU, tiles in parallel.
+
+#include "ClientHost.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLIENT_HOST_RASTER_SSE2 1
+#else
+#define CLIENT_HOST_RASTER_SSE2 0
+#endif
+
+/*
+	HOW IT WORKS
+
+	Every frame, for every viewport:
+	- Setup: draw calls targeting the viewport become shapes, in the order they were output. Rotation by angleDeg is applied there, so
+	  rectangles, lines and bitmaps become possibly rotated quads, and ellipses get their rotated equation.
+	- Damage: framebuffers keep their pixels from the previous frame, so only the tiles the Client's damage rectangles overlap need
+	  rasterizing again. Every tile does when the whole frame is damaged, or the framebuffer was resized.
+	- Binning: every shape is listed in the damaged tiles its bounds overlap, which keeps draw order within every tile.
+	- Rasterizing: damaged tiles are spread over the job system's workers. A tile is cleared, then every shape of its list is drawn row by row:
+	  shapes being convex, the pixels a row covers are a single span, found from the quad's edges or by solving the ellipse's equation
+	  for the row. Spans are blended 4 pixels at a time with SSE2 where available.
+
+	A pixel is covered when its center is inside the shape. There is no anti-aliasing.
+	Blending follows ColorRGBT: alpha is 255 - t, every channel becoming (Source * Alpha + Destination * (255 - Alpha)) / 255, rounded.
+	The alpha channel blends the same way from an opaque source, so framebuffers cleared opaque stay opaque.
+	Bitmap draw calls carry no pixels, only a resolution, so they're drawn as rectangles of their color.
+*/
+
+// Framebuffers are cleared to opaque black.
+static const uint8_t CLIENT_HOST_RASTER_CLEAR_COLOR[4] = { 0, 0, 0, 255 };
+
+// SETUP
+
+static uint32_t PackRasterColor(uint8_t R, uint8_t G, uint8_t B, uint8_t A)
+{
+	const uint8_t bytes[4] = { R, G, B, A };
+	uint32_t color;
+	memcpy(&color, bytes, sizeof(color));
+	return color;
+}
+
+// Rotations by right angles are exact, sparing axis aligned shapes rounding errors on their edges.
+static void GetRasterRotation(uint16_t AngleDeg, float& OutCos, float& OutSin)
+{
+	const uint16_t angle = AngleDeg % 360;
+	switch (angle)
+	{
+	case 0: OutCos = 1.f; OutSin = 0.f; return;
+	case 90: OutCos = 0.f; OutSin = 1.f; return;
+	case 180: OutCos = -1.f; OutSin = 0.f; return;
+	case 270: OutCos = 0.f; OutSin = -1.f; return;
+	default:
+		OutCos = cosf(angle * 3.14159265f / 180.f);
+		OutSin = sinf(angle * 3.14159265f / 180.f);
+		return;
+	}
+}
+
+/*
+	Makes the shape a quad spanning [MinU, MaxU] along the U axis and [MinV, MaxV] along the V axis from the origin, axes being unit length.
+	Bounds are left unclipped.
+*/
+static void SetRasterQuad(ClientHostRasterShape& Shape, float OriginX, float OriginY, float UX, float UY, float VX, float VY,
+	float MinU, float MaxU, float MinV, float MaxV)
+{
+	const float originU = OriginX * UX + OriginY * UY;
+	const float originV = OriginX * VX + OriginY * VY;
+
+	Shape.bEllipse = false;
+	Shape.Quad.EdgeX[0] = UX;  Shape.Quad.EdgeY[0] = UY;  Shape.Quad.EdgeOffset[0] = -originU - MinU;
+	Shape.Quad.EdgeX[1] = -UX; Shape.Quad.EdgeY[1] = -UY; Shape.Quad.EdgeOffset[1] = originU + MaxU;
+	Shape.Quad.EdgeX[2] = VX;  Shape.Quad.EdgeY[2] = VY;  Shape.Quad.EdgeOffset[2] = -originV - MinV;
+	Shape.Quad.EdgeX[3] = -VX; Shape.Quad.EdgeY[3] = -VY; Shape.Quad.EdgeOffset[3] = originV + MaxV;
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	const float cornersU[2] = { MinU, MaxU };
+	const float cornersV[2] = { MinV, MaxV };
+	for (float u : cornersU)
+	{
+		for (float v : cornersV)
+		{
+			const float x = OriginX + u * UX + v * VX;
+			const float y = OriginY + u * UY + v * VY;
+			minX = x < minX ? x : minX;
+			minY = y < minY ? y : minY;
+			maxX = x > maxX ? x : maxX;
+			maxY = y > maxY ? y : maxY;
+		}
+	}
+	Shape.MinX = (int32_t)floorf(minX);
+	Shape.MinY = (int32_t)floorf(minY);
+	Shape.MaxX = (int32_t)ceilf(maxX);
+	Shape.MaxY = (int32_t)ceilf(maxY);
+}
+
+/*
+	Turns a draw call into a shape clipped to the framebuffer. Returns false if it draws nothing: invalid, empty, fully transparent or off screen.
+*/
+static bool MakeRasterShape(const DrawCall& Call, Vector2s FramebufferDimensions, ClientHostRasterShape& OutShape)
+{
+	OutShape.Alpha = 255u - Call.color.t;
+	if (OutShape.Alpha == 0)
+	{
+		return false;
+	}
+	OutShape.Color = PackRasterColor(Call.color.r, Call.color.g, Call.color.b, 255);
+
+	float cosAngle, sinAngle;
+	GetRasterRotation(Call.angleDeg, cosAngle, sinAngle);
+	const float originX = Call.origin.x;
+	const float originY = Call.origin.y;
+
+	switch (Call.type)
+	{
+	case DrawCallType::RECTANGLE:
+	case DrawCallType::BITMAP:
+	{
+		const RectangleDrawCallData& rectangle = (const RectangleDrawCallData&)Call;
+		if (rectangle.dimensions.x <= 0 || rectangle.dimensions.y <= 0)
+		{
+			return false;
+		}
+		SetRasterQuad(OutShape, originX, originY, cosAngle, sinAngle, -sinAngle, cosAngle, 0.f, rectangle.dimensions.x, 0.f, rectangle.dimensions.y);
+		break;
+	}
+	case DrawCallType::LINE:
+	{
+		// The line turns around its origin, its width spreading evenly on both sides. Lines are at least a pixel wide.
+		const LineDrawCallData& line = (const LineDrawCallData&)Call;
+		const float deltaX = (float)line.destination.x - originX;
+		const float deltaY = (float)line.destination.y - originY;
+		const float length = sqrtf(deltaX * deltaX + deltaY * deltaY);
+		if (length <= 0.f)
+		{
+			return false;
+		}
+		const float axisX = (deltaX * cosAngle - deltaY * sinAngle) / length;
+		const float axisY = (deltaX * sinAngle + deltaY * cosAngle) / length;
+		const float halfWidth = (line.width > 1 ? line.width : 1) / 2.f;
+		SetRasterQuad(OutShape, originX, originY, axisX, axisY, -axisY, axisX, 0.f, length, -halfWidth, halfWidth);
+		break;
+	}
+	case DrawCallType::ELLIPSE:
+	{
+		const EllipseDrawCallData& ellipse = (const EllipseDrawCallData&)Call;
+		const float radiusX = ellipse.ellipticRadii.x;
+		const float radiusY = ellipse.ellipticRadii.y == 0 ? radiusX : (float)ellipse.ellipticRadii.y;
+		if (radiusX <= 0.f || radiusY <= 0.f)
+		{
+			return false;
+		}
+
+		const float inverseX2 = 1.f / (radiusX * radiusX);
+		const float inverseY2 = 1.f / (radiusY * radiusY);
+		OutShape.bEllipse = true;
+		OutShape.Ellipse.CenterX = originX;
+		OutShape.Ellipse.CenterY = originY;
+		OutShape.Ellipse.A = cosAngle * cosAngle * inverseX2 + sinAngle * sinAngle * inverseY2;
+		OutShape.Ellipse.B = 2.f * cosAngle * sinAngle * (inverseX2 - inverseY2);
+		OutShape.Ellipse.C = sinAngle * sinAngle * inverseX2 + cosAngle * cosAngle * inverseY2;
+
+		const float extentX = sqrtf(radiusX * radiusX * cosAngle * cosAngle + radiusY * radiusY * sinAngle * sinAngle);
+		const float extentY = sqrtf(radiusX * radiusX * sinAngle * sinAngle + radiusY * radiusY * cosAngle * cosAngle);
+		OutShape.MinX = (int32_t)floorf(originX - extentX);
+		OutShape.MinY = (int32_t)floorf(originY - extentY);
+		OutShape.MaxX = (int32_t)ceilf(originX + extentX);
+		OutShape.MaxY = (int32_t)ceilf(originY + extentY);
+		break;
+	}
+	default:
+		return false;
+	}
+
+	OutShape.MinX = OutShape.MinX > 0 ? OutShape.MinX : 0;
+	OutShape.MinY = OutShape.MinY > 0 ? OutShape.MinY : 0;
+	OutShape.MaxX = OutShape.MaxX < FramebufferDimensions.x ? OutShape.MaxX : FramebufferDimensions.x;
+	OutShape.MaxY = OutShape.MaxY < FramebufferDimensions.y ? OutShape.MaxY : FramebufferDimensions.y;
+	return OutShape.MinX < OutShape.MaxX && OutShape.MinY < OutShape.MaxY;
+}
+
+// SPANS
+
+// Rounded division by 255, exact for every product of two bytes summed with a product of their complements.
+static inline uint32_t DivideBy255(uint32_t Value)
+{
+	Value += 128;
+	return (Value + (Value >> 8)) >> 8;
+}
+
+static void BlendRasterSpan(uint32_t* Pixels, int32_t Count, uint32_t Color, uint32_t Alpha)
+{
+	int32_t pixelIndex = 0;
+	if (Alpha == 255)
+	{
+#if CLIENT_HOST_RASTER_SSE2
+		const __m128i color = _mm_set1_epi32((int)Color);
+		for (; pixelIndex + 4 <= Count; pixelIndex += 4)
+		{
+			_mm_storeu_si128((__m128i*)(Pixels + pixelIndex), color);
+		}
+#endif
+		for (; pixelIndex < Count; pixelIndex++)
+		{
+			Pixels[pixelIndex] = Color;
+		}
+		return;
+	}
+
+#if CLIENT_HOST_RASTER_SSE2
+	// Channels are widened to 16 bits, two pixels per register, where the largest sum (255 * 255 + 128) still fits.
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i sourceTerm = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32((int)Color), zero), _mm_set1_epi16((short)Alpha));
+	const __m128i inverseAlpha = _mm_set1_epi16((short)(255 - Alpha));
+	const __m128i rounding = _mm_set1_epi16(128);
+	for (; pixelIndex + 4 <= Count; pixelIndex += 4)
+	{
+		const __m128i destination = _mm_loadu_si128((const __m128i*)(Pixels + pixelIndex));
+		__m128i low = _mm_unpacklo_epi8(destination, zero);
+		__m128i high = _mm_unpackhi_epi8(destination, zero);
+		low = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(low, inverseAlpha), sourceTerm), rounding);
+		high = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(high, inverseAlpha), sourceTerm), rounding);
+		low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+		high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+		_mm_storeu_si128((__m128i*)(Pixels + pixelIndex), _mm_packus_epi16(low, high));
+	}
+#endif
+
+	uint8_t source[4];
+	memcpy(source, &Color, sizeof(source));
+	for (; pixelIndex < Count; pixelIndex++)
+	{
+		uint8_t destination[4];
+		memcpy(destination, &Pixels[pixelIndex], sizeof(destination));
+		for (size_t channel = 0; channel < 4; channel++)
+		{
+			// The rounding bias is added by DivideBy255.
+			destination[channel] = (uint8_t)DivideBy255(source[channel] * Alpha + destination[channel] * (255 - Alpha));
+		}
+		memcpy(&Pixels[pixelIndex], destination, sizeof(destination));
+	}
+}
+
+/*
+	Finds the pixels of a row the shape covers, within its bounds: [OutStartX, OutEndX[. Returns false if it covers none.
+*/
+static bool GetRasterShapeRowSpan(const ClientHostRasterShape& Shape, int32_t Y, int32_t& OutStartX, int32_t& OutEndX)
+{
+	const float centerY = Y + 0.5f;
+	float minX = (float)Shape.MinX;
+	float maxX = (float)Shape.MaxX;
+
+	if (Shape.bEllipse)
+	{
+		// Solve A * x^2 + (B * y) * x + (C * y^2 - 1) = 0 for the row.
+		const float y = centerY - Shape.Ellipse.CenterY;
+		const float b = Shape.Ellipse.B * y;
+		const float c = Shape.Ellipse.C * y * y - 1.f;
+		const float discriminant = b * b - 4.f * Shape.Ellipse.A * c;
+		if (discriminant < 0.f)
+		{
+			return false;
+		}
+		const float root = sqrtf(discriminant);
+		const float ellipseMinX = Shape.Ellipse.CenterX + (-b - root) / (2.f * Shape.Ellipse.A);
+		const float ellipseMaxX = Shape.Ellipse.CenterX + (-b + root) / (2.f * Shape.Ellipse.A);
+		minX = ellipseMinX > minX ? ellipseMinX : minX;
+		maxX = ellipseMaxX < maxX ? ellipseMaxX : maxX;
+	}
+	else
+	{
+		for (size_t edgeIndex = 0; edgeIndex < 4; edgeIndex++)
+		{
+			const float edgeX = Shape.Quad.EdgeX[edgeIndex];
+			const float rowOffset = Shape.Quad.EdgeY[edgeIndex] * centerY + Shape.Quad.EdgeOffset[edgeIndex];
+			if (edgeX > 0.f)
+			{
+				const float edgeMinX = -rowOffset / edgeX;
+				minX = edgeMinX > minX ? edgeMinX : minX;
+			}
+			else if (edgeX < 0.f)
+			{
+				const float edgeMaxX = -rowOffset / edgeX;
+				maxX = edgeMaxX < maxX ? edgeMaxX : maxX;
+			}
+			else if (rowOffset < 0.f)
+			{
+				return false;
+			}
+		}
+	}
+
+	// Pixels whose center lies in [minX, maxX].
+	if (!(minX <= maxX))
+	{
+		return false;
+	}
+	OutStartX = (int32_t)ceilf(minX - 0.5f);
+	OutEndX = (int32_t)floorf(maxX - 0.5f) + 1;
+	OutStartX = OutStartX > Shape.MinX ? OutStartX : Shape.MinX;
+	OutEndX = OutEndX < Shape.MaxX ? OutEndX : Shape.MaxX;
+	return OutStartX < OutEndX;
+}
+
+// TILES
+
+struct ClientHostRasterJobData
+{
+	const ClientHostRasterizer* Raster;
+	ClientHostFramebuffer* Framebuffer;
+	int32_t TileCountX;
+};
+
+static void RasterizeTiles(const SJobContext&, size_t Begin, size_t End, void* Data)
+{
+	const ClientHostRasterJobData& job = *(const ClientHostRasterJobData*)Data;
+	const ClientHostRasterizer& raster = *job.Raster;
+	ClientHostFramebuffer& framebuffer = *job.Framebuffer;
+	const int32_t width = framebuffer.Dimensions.x;
+	const int32_t height = framebuffer.Dimensions.y;
+
+	uint32_t clearColor;
+	memcpy(&clearColor, CLIENT_HOST_RASTER_CLEAR_COLOR, sizeof(clearColor));
+
+	for (size_t damagedIndex = Begin; damagedIndex < End; damagedIndex++)
+	{
+		const uint32_t tileIndex = raster.DamagedTiles[damagedIndex];
+		const int32_t tileMinX = (int32_t)(tileIndex % job.TileCountX) * CLIENT_HOST_RASTER_TILE_SIZE;
+		const int32_t tileMinY = (int32_t)(tileIndex / job.TileCountX) * CLIENT_HOST_RASTER_TILE_SIZE;
+		const int32_t tileMaxX = tileMinX + CLIENT_HOST_RASTER_TILE_SIZE < width ? tileMinX + CLIENT_HOST_RASTER_TILE_SIZE : width;
+		const int32_t tileMaxY = tileMinY + CLIENT_HOST_RASTER_TILE_SIZE < height ? tileMinY + CLIENT_HOST_RASTER_TILE_SIZE : height;
+
+		for (int32_t y = tileMinY; y < tileMaxY; y++)
+		{
+			BlendRasterSpan(&framebuffer.Pixels[(size_t)y * width + tileMinX], tileMaxX - tileMinX, clearColor, 255);
+		}
+
+		for (uint32_t binIndex = raster.TileShapeOffsets[tileIndex]; binIndex < raster.TileShapeOffsets[tileIndex + 1]; binIndex++)
+		{
+			const ClientHostRasterShape& shape = raster.Shapes[raster.TileShapes[binIndex]];
+			const int32_t minY = shape.MinY > tileMinY ? shape.MinY : tileMinY;
+			const int32_t maxY = shape.MaxY < tileMaxY ? shape.MaxY : tileMaxY;
+			for (int32_t y = minY; y < maxY; y++)
+			{
+				int32_t startX, endX;
+				if (!GetRasterShapeRowSpan(shape, y, startX, endX))
+				{
+					continue;
+				}
+				startX = startX > tileMinX ? startX : tileMinX;
+				endX = endX < tileMaxX ? endX : tileMaxX;
+				if (startX < endX)
+				{
+					BlendRasterSpan(&framebuffer.Pixels[(size_t)y * width + startX], endX - startX, shape.Color, shape.Alpha);
+				}
+			}
+		}
+	}
+}
+
+// Lists every shape in the damaged tiles its bounds overlap, in shape order. Tile lists are laid out back to back, counted first.
+static void BinRasterShapes(ClientHostRasterizer& Raster, int32_t TileCountX, int32_t TileCountY)
+{
+	const size_t tileCount = (size_t)TileCountX * TileCountY;
+	Raster.TileShapeOffsets.assign(tileCount + 1, 0);
+
+	auto forEachShapeTile = [&](const ClientHostRasterShape& Shape, auto&& Function)
+	{
+		for (int32_t tileY = Shape.MinY / CLIENT_HOST_RASTER_TILE_SIZE; tileY <= (Shape.MaxY - 1) / CLIENT_HOST_RASTER_TILE_SIZE; tileY++)
+		{
+			for (int32_t tileX = Shape.MinX / CLIENT_HOST_RASTER_TILE_SIZE; tileX <= (Shape.MaxX - 1) / CLIENT_HOST_RASTER_TILE_SIZE; tileX++)
+			{
+				const size_t tileIndex = (size_t)tileY * TileCountX + tileX;
+				if (Raster.TileDamaged[tileIndex])
+				{
+					Function(tileIndex);
+				}
+			}
+		}
+	};
+
+	for (const ClientHostRasterShape& shape : Raster.Shapes)
+	{
+		forEachShapeTile(shape, [&](size_t TileIndex) { Raster.TileShapeOffsets[TileIndex + 1]++; });
+	}
+	for (size_t tileIndex = 0; tileIndex < tileCount; tileIndex++)
+	{
+		Raster.TileShapeOffsets[tileIndex + 1] += Raster.TileShapeOffsets[tileIndex];
+	}
+
+	// Filling moves every tile's offset to its end, which is the next tile's start: shifting offsets back restores them.
+	Raster.TileShapes.resize(Raster.TileShapeOffsets[tileCount]);
+	for (uint32_t shapeIndex = 0; shapeIndex < Raster.Shapes.size(); shapeIndex++)
+	{
+		forEachShapeTile(Raster.Shapes[shapeIndex], [&](size_t TileIndex) { Raster.TileShapes[Raster.TileShapeOffsets[TileIndex]++] = shapeIndex; });
+	}
+	for (size_t tileIndex = tileCount; tileIndex > 0; tileIndex--)
+	{
+		Raster.TileShapeOffsets[tileIndex] = Raster.TileShapeOffsets[tileIndex - 1];
+	}
+	Raster.TileShapeOffsets[0] = 0;
+}
+
+// RASTERIZER
+
+bool StartClientHostRasterizer(ClientHostState& Host)
+{
+	ClientHostRasterizer& raster = Host.Raster;
+
+	SJobSystemOptions options;
+	options.WorkerCount = Host.Config.RasterWorkerCount != 0 ? Host.Config.RasterWorkerCount : std::thread::hardware_concurrency();
+	options.WorkerCount = options.WorkerCount < 1 ? 1 : (options.WorkerCount > SJOB_MAX_WORKERS ? SJOB_MAX_WORKERS : options.WorkerCount);
+	options.FrameArenaSize = CLIENT_HOST_RASTER_FRAME_ARENA_SIZE;
+
+	// Room for the system's shared state, then every worker's deque, arena and thread, with some slack for their alignment.
+	const size_t workerMemorySize = sizeof(SJobWorker) + SJOB_DEQUE_CAPACITY * sizeof(SJob) + options.FrameArenaSize + sizeof(std::thread) + 256;
+	raster.JobMemory.resize(4096 + options.WorkerCount * workerMemorySize);
+
+	MemoryAllocator jobAllocator = MakeStackAllocator(raster.JobMemory.data(), raster.JobMemory.size());
+	raster.bStarted = InitializeJobSystem(raster.Jobs, jobAllocator, options);
+	if (!raster.bStarted)
+	{
+		fprintf(stderr, "Failed to start the rasterizer's job system.\n");
+	}
+	return raster.bStarted;
+}
+
+void StopClientHostRasterizer(ClientHostState& Host)
+{
+	if (Host.Raster.bStarted)
+	{
+		ShutdownJobSystem(Host.Raster.Jobs);
+		Host.Raster.bStarted = false;
+	}
+}
+
+// Flags the tiles the frame's damage overlaps for the viewport, and lists them. Returns how many there are.
+static size_t FindDamagedRasterTiles(ClientHostRasterizer& Raster, const ClientHostDrawBuffer& DrawBuffer, ViewportID Viewport,
+	Vector2s Dimensions, int32_t TileCountX, int32_t TileCountY, bool bFullDamage)
+{
+	const size_t tileCount = (size_t)TileCountX * TileCountY;
+	Raster.TileDamaged.assign(tileCount, bFullDamage ? 1 : 0);
+	for (size_t rectIndex = 0; rectIndex < DrawBuffer.DamageRects.size() && !bFullDamage; rectIndex++)
+	{
+		const DrawDamageRect& rect = DrawBuffer.DamageRects[rectIndex];
+		const int32_t minX = rect.Min.x > 0 ? rect.Min.x : 0;
+		const int32_t minY = rect.Min.y > 0 ? rect.Min.y : 0;
+		const int32_t maxX = rect.Max.x < Dimensions.x ? rect.Max.x : Dimensions.x;
+		const int32_t maxY = rect.Max.y < Dimensions.y ? rect.Max.y : Dimensions.y;
+		if (rect.Viewport != Viewport || minX >= maxX || minY >= maxY)
+		{
+			continue;
+		}
+		for (int32_t tileY = minY / CLIENT_HOST_RASTER_TILE_SIZE; tileY <= (maxY - 1) / CLIENT_HOST_RASTER_TILE_SIZE; tileY++)
+		{
+			for (int32_t tileX = minX / CLIENT_HOST_RASTER_TILE_SIZE; tileX <= (maxX - 1) / CLIENT_HOST_RASTER_TILE_SIZE; tileX++)
+			{
+				Raster.TileDamaged[(size_t)tileY * TileCountX + tileX] = 1;
+			}
+		}
+	}
+
+	Raster.DamagedTiles.clear();
+	for (uint32_t tileIndex = 0; tileIndex < tileCount; tileIndex++)
+	{
+		if (Raster.TileDamaged[tileIndex])
+		{
+			Raster.DamagedTiles.push_back(tileIndex);
+		}
+	}
+	return Raster.DamagedTiles.size();
+}
+
+size_t RasterizeClientHostFrame(ClientHostState& Host)
+{
+	ClientHostRasterizer& raster = Host.Raster;
+	const ClientHostDrawBuffer& drawBuffer = Host.DrawBuffer;
+	ResetJobSystemFrameArenas(raster.Jobs);
+
+	size_t rasterizedTileCount = 0;
+	for (ViewportID viewportID = 0; viewportID < CLIENT_HOST_MAX_VIEWPORTS; viewportID++)
+	{
+		const ClientHostViewport& viewport = Host.Viewports[viewportID];
+		ClientHostFramebuffer& framebuffer = raster.Framebuffers[viewportID];
+		if (!viewport.bAllocated || viewport.Dimensions.x <= 0 || viewport.Dimensions.y <= 0)
+		{
+			framebuffer = {};
+			continue;
+		}
+		const bool bResized = framebuffer.Dimensions != viewport.Dimensions;
+		if (bResized)
+		{
+			framebuffer.Dimensions = viewport.Dimensions;
+			framebuffer.Pixels.resize((size_t)viewport.Dimensions.x * viewport.Dimensions.y);
+		}
+
+		// DAMAGE
+		const int32_t tileCountX = (framebuffer.Dimensions.x + CLIENT_HOST_RASTER_TILE_SIZE - 1) / CLIENT_HOST_RASTER_TILE_SIZE;
+		const int32_t tileCountY = (framebuffer.Dimensions.y + CLIENT_HOST_RASTER_TILE_SIZE - 1) / CLIENT_HOST_RASTER_TILE_SIZE;
+		const bool bFullDamage = drawBuffer.bFullDamage || bResized || Host.Config.bFullRedraw;
+		const size_t damagedTileCount = FindDamagedRasterTiles(raster, drawBuffer, viewportID, framebuffer.Dimensions, tileCountX, tileCountY,
+			bFullDamage);
+		if (damagedTileCount == 0)
+		{
+			continue;
+		}
+		rasterizedTileCount += damagedTileCount;
+
+		// SETUP
+		raster.Shapes.clear();
+		for (size_t callIndex = 0; callIndex < drawBuffer.CallCount; callIndex++)
+		{
+			ClientHostRasterShape shape;
+			const DrawCall& call = *(const DrawCall*)(drawBuffer.Memory.data() + callIndex * CLIENT_HOST_DRAW_CALL_SLOT_SIZE);
+			if (drawBuffer.CallViewports[callIndex] == viewportID && MakeRasterShape(call, framebuffer.Dimensions, shape))
+			{
+				raster.Shapes.push_back(shape);
+			}
+		}
+
+		// BINNING
+		BinRasterShapes(raster, tileCountX, tileCountY);
+
+		// RASTERIZING
+		ClientHostRasterJobData jobData = { &raster, &framebuffer, tileCountX };
+		RunParallelFor(raster.Jobs, 0, damagedTileCount, 1, RasterizeTiles, &jobData);
+	}
+	return rasterizedTileCount;
+}
+
+bool WriteClientHostFramebufferImage(const ClientHostFramebuffer& Framebuffer, const char* Path)
+{
+	FILE* file = fopen(Path, "wb");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to create the image %s.\n", Path);
+		return false;
+	}
+
+	// Pixels are stored in the byte order of PAM's RGB_ALPHA tuples already.
+	fprintf(file, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", Framebuffer.Dimensions.x, Framebuffer.Dimensions.y);
+	const bool bWritten = fwrite(Framebuffer.Pixels.data(), sizeof(uint32_t), Framebuffer.Pixels.size(), file) == Framebuffer.Pixels.size();
+	return fclose(file) == 0 && bWritten;
+}
@@ -0,0 +1,195 @@
+SOURCE_INC_FILE()
+
+// Implementation of the host's inputs standing in for a user: text scripts of inputs to play at given frames, and replays of input captures
+// the Client wrote.
+
+#include "ClientHost.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+/*
+	HOW IT WORKS
+
+	A script holds one input per line, played at the start of the frame it names. Frames count from 0, lines starting with # are comments:
+
+		# frame  action   argument
+		0        cursor   960 540      Moves the cursor to these coordinates of the main viewport.
+		10       press    F1           Presses a key: A-Z, 0-9, F1-F12, SPACE, LEFT, UP, RIGHT, DOWN, MOUSE_LEFT, MOUSE_RIGHT, MOUSE_MIDDLE.
+		11       release  F1           Releases it.
+		20       leave                 Moves the cursor out of every viewport.
+
+	Lines don't need to come in frame order, inputs of the same frame are played in the order they appear in.
+*/
+
+// Finds the key a script names.
+static ActionKey ParseScriptKey(const char* Name)
+{
+	const size_t length = strlen(Name);
+	if (length == 1 && Name[0] >= 'A' && Name[0] <= 'Z') return (ActionKey)((uint8_t)ActionKey::KEY_A + (Name[0] - 'A'));
+	if (length == 1 && Name[0] >= '0' && Name[0] <= '9') return (ActionKey)((uint8_t)ActionKey::KEY_0 + (Name[0] - '0'));
+	if (Name[0] == 'F' && length >= 2)
+	{
+		char* end = nullptr;
+		const unsigned long functionIndex = strtoul(Name + 1, &end, 10);
+		if (*end == '\0' && functionIndex >= 1 && functionIndex <= 12) return (ActionKey)((uint8_t)ActionKey::KEY_FUNC1 + functionIndex - 1);
+	}
+
+	static const struct { const char* Name; ActionKey Key; } NAMED_KEYS[] =
+	{
+		{ "SPACE", ActionKey::KEY_SPACE }, { "LEFT", ActionKey::ARROW_LEFT }, { "UP", ActionKey::ARROW_UP }, { "RIGHT", ActionKey::ARROW_RIGHT },
+		{ "DOWN", ActionKey::ARROW_DOWN }, { "MOUSE_LEFT", ActionKey::MOUSE_LEFT }, { "MOUSE_RIGHT", ActionKey::MOUSE_RIGHT },
+		{ "MOUSE_MIDDLE", ActionKey::MOUSE_MIDDLE },
+	};
+	for (const auto& namedKey : NAMED_KEYS)
+	{
+		if (strcmp(Name, namedKey.Name) == 0) return namedKey.Key;
+	}
+	return ActionKey::ACTION_KEY_NONE;
+}
+
+bool LoadClientHostScript(const char* Path, std::vector<ClientHostScriptEvent>& OutScript)
+{
+	FILE* file = fopen(Path, "r");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open the script %s.\n", Path);
+		return false;
+	}
+
+	char line[256];
+	size_t lineNumber = 0;
+	bool bParsed = true;
+	while (bParsed && fgets(line, sizeof(line), file) != nullptr)
+	{
+		lineNumber++;
+
+		unsigned long long frame = 0;
+		char action[32] = {};
+		char argument[32] = {};
+		int x = 0;
+		int y = 0;
+		const int fieldCount = sscanf(line, " %llu %31s %31s", &frame, action, argument);
+		if (fieldCount <= 0 || line[strspn(line, " \t")] == '#')
+		{
+			continue;
+		}
+
+		ClientHostScriptEvent event = {};
+		event.Frame = (size_t)frame;
+		if (fieldCount == 3 && (strcmp(action, "press") == 0 || strcmp(action, "release") == 0))
+		{
+			event.Action = action[0] == 'p' ? ClientHostScriptAction::PRESS : ClientHostScriptAction::RELEASE;
+			event.Key = ParseScriptKey(argument);
+			bParsed = event.Key != ActionKey::ACTION_KEY_NONE;
+		}
+		else if (strcmp(action, "cursor") == 0 && sscanf(line, " %*u %*s %d %d", &x, &y) == 2)
+		{
+			event.Action = ClientHostScriptAction::CURSOR;
+			event.CursorLocation = { (int16_t)x, (int16_t)y };
+		}
+		else if (fieldCount == 2 && strcmp(action, "leave") == 0)
+		{
+			event.Action = ClientHostScriptAction::CURSOR_LEAVE;
+		}
+		else
+		{
+			bParsed = false;
+		}
+
+		if (bParsed)
+		{
+			OutScript.push_back(event);
+		}
+		else
+		{
+			fprintf(stderr, "Invalid input on line %zu of the script %s: %s", lineNumber, Path, line);
+		}
+	}
+	fclose(file);
+
+	std::stable_sort(OutScript.begin(), OutScript.end(),
+		[](const ClientHostScriptEvent& Left, const ClientHostScriptEvent& Right) { return Left.Frame < Right.Frame; });
+	return bParsed;
+}
+
+void PlayClientHostScript(ClientHostState& Host, size_t Frame, std::vector<ActionInputEvent>& OutEvents)
+{
+	for (; Host.NextScriptEvent < Host.Script.size() && Host.Script[Host.NextScriptEvent].Frame <= Frame; Host.NextScriptEvent++)
+	{
+		const ClientHostScriptEvent& scriptEvent = Host.Script[Host.NextScriptEvent];
+		switch (scriptEvent.Action)
+		{
+		case ClientHostScriptAction::CURSOR:
+			Host.CursorLocation = scriptEvent.CursorLocation;
+			Host.CursorViewport = 0;
+			break;
+		case ClientHostScriptAction::CURSOR_LEAVE:
+			Host.CursorViewport = VIEWPORT_ERROR_ID;
+			break;
+		default:
+		{
+			// Every input of the frame happened right as it started.
+			ActionInputEvent inputEvent = {};
+			inputEvent.timeNormalized = 1.0f;
+			inputEvent.viewport = Host.CursorViewport;
+			inputEvent.cursorLocation = Host.CursorLocation;
+			inputEvent.key = scriptEvent.Key;
+			inputEvent.bRelease = scriptEvent.Action == ClientHostScriptAction::RELEASE;
+			OutEvents.push_back(inputEvent);
+			break;
+		}
+		}
+	}
+}
+
+// REPLAYS
+
+bool LoadClientHostReplay(const char* Path, ClientHostState& Host)
+{
+	FILE* file = fopen(Path, "rb");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open the capture %s.\n", Path);
+		return false;
+	}
+
+	uint8_t chunk[64 * 1024];
+	size_t readSize = 0;
+	while ((readSize = fread(chunk, 1, sizeof(chunk), file)) > 0)
+	{
+		Host.Replay.insert(Host.Replay.end(), chunk, chunk + readSize);
+	}
+	const bool bReadFailed = ferror(file) != 0;
+	fclose(file);
+
+	if (bReadFailed || !Host.ReplayReader.Open(Host.Replay.data(), Host.Replay.size()))
+	{
+		fprintf(stderr, "%s is not an input capture this host can replay.\n", Path);
+		return false;
+	}
+	return true;
+}
+
+bool PlayClientHostReplay(ClientHostState& Host, ClientFrameRequestData& OutFrameData, std::vector<ActionInputEvent>& OutEvents)
+{
+	CapturedFrameInputs frame;
+	if (!Host.ReplayReader.ReadFrame(frame))
+	{
+		return false;
+	}
+
+	for (size_t eventIndex = 0; eventIndex < frame.EventCount; eventIndex++)
+	{
+		OutEvents.push_back(InputCaptureReader::DecodeEvent(frame, eventIndex));
+	}
+
+	OutFrameData.FrameNumber = frame.FrameNumber;
+	OutFrameData.FrameTime = frame.FrameTime;
+	Host.CursorLocation = frame.CursorLocation;
+	Host.CursorViewport = frame.CursorViewport;
+	return true;
+}
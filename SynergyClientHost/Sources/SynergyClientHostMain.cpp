@@ -0,0 +1,357 @@
+#define TRANSLATION_UNIT SYNERGY_CLIENT_HOST_MAIN
+
+// Headless host for the Synergy Client. Loads the Client library, stands in for the platform layer with in-memory viewports and draw
+// buffers, then runs frames back to back as fast as the Client allows and reports frame times as JSON on standard output.
+//
+// Usage: SynergyClientHost [--library PATH] [--frames N] [--frame-time S] [--script PATH] [--replay PATH] [--capture PATH]
+//                          [--cursor-sweep] [--per-call-draws] [--profile PATH] [--persistent-mb N] [--frame-mb N] [--max-draw-calls N]
+//                          [--raster] [--raster-workers N] [--raster-image PATH] [--full-redraw]
+//
+// Runs are deterministic: frames claim a fixed frame time and inputs only come from the script, so two runs of the same library output
+// the same draw calls, which the reported draw checksum shows. Replaying an input capture instead hands every frame the exact inputs and
+// frame time a Client got when it was captured, turning a real session into a repeatable benchmark.
+//
+// With --raster, every frame's draw calls are also rendered by a software rasterizer, timed apart from the Client's frames, and the last
+// frame's pixels get checksummed. --raster-image writes that frame of the main viewport to an image file, and implies --raster.
+// Only the tiles the Client's damage rectangles overlap are rasterized, unless --full-redraw is given: both give the same pixels.
+
+#include "SynergyCore.h"
+#include "ClientHost.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+// Source includes
+#include "ClientHostPlatform_INC.cpp"
+#include "ClientHostScript_INC.cpp"
+#include "ClientHostRaster_INC.cpp"
+
+// Percentiles reported for frame times, and their names in the report.
+constexpr double CLIENT_HOST_REPORTED_PERCENTILES[] = { 50.0, 90.0, 99.0, 99.9 };
+constexpr const char* CLIENT_HOST_REPORTED_PERCENTILE_NAMES[] = { "p50_ns", "p90_ns", "p99_ns", "p999_ns" };
+
+#if !defined(CLIENT_HOST_DEFAULT_LIBRARY)
+#define CLIENT_HOST_DEFAULT_LIBRARY "libSynergyClientLib.so"
+#endif
+
+static bool ParseArguments(int argc, char** argv, ClientHostConfig& Config)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const char* arg = argv[argIndex];
+		if (strcmp(arg, "--cursor-sweep") == 0)
+		{
+			Config.bCursorSweep = true;
+			continue;
+		}
+		if (strcmp(arg, "--per-call-draws") == 0)
+		{
+			Config.bPerCallDraws = true;
+			continue;
+		}
+		if (strcmp(arg, "--raster") == 0)
+		{
+			Config.bRaster = true;
+			continue;
+		}
+		if (strcmp(arg, "--full-redraw") == 0)
+		{
+			Config.bFullRedraw = true;
+			continue;
+		}
+
+		const char* value = argIndex + 1 < argc ? argv[argIndex + 1] : nullptr;
+		if (value == nullptr)
+		{
+			fprintf(stderr, "Missing value for argument %s\n", arg);
+			return false;
+		}
+
+		if (strcmp(arg, "--library") == 0) Config.LibraryPath = value;
+		else if (strcmp(arg, "--frames") == 0) Config.FrameCount = strtoull(value, nullptr, 0);
+		else if (strcmp(arg, "--frame-time") == 0) Config.FrameTime = strtof(value, nullptr);
+		else if (strcmp(arg, "--script") == 0) Config.ScriptPath = value;
+		else if (strcmp(arg, "--replay") == 0) Config.ReplayPath = value;
+		else if (strcmp(arg, "--capture") == 0) Config.CapturePath = value;
+		else if (strcmp(arg, "--profile") == 0) Config.ProfilePath = value;
+		else if (strcmp(arg, "--persistent-mb") == 0) Config.PersistentMemorySize = strtoull(value, nullptr, 0) << 20;
+		else if (strcmp(arg, "--frame-mb") == 0) Config.FrameMemorySize = strtoull(value, nullptr, 0) << 20;
+		else if (strcmp(arg, "--max-draw-calls") == 0) Config.MaxDrawCallCount = strtoull(value, nullptr, 0);
+		else if (strcmp(arg, "--raster-workers") == 0) Config.RasterWorkerCount = (uint32_t)strtoul(value, nullptr, 0);
+		else if (strcmp(arg, "--raster-image") == 0) Config.RasterImagePath = value;
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", arg);
+			return false;
+		}
+
+		argIndex++;
+	}
+
+	if (Config.FrameTime <= 0.0f || Config.PersistentMemorySize == 0 || Config.FrameMemorySize == 0)
+	{
+		fprintf(stderr, "Frame time and memory sizes must be positive.\n");
+		return false;
+	}
+	if (Config.ScriptPath != nullptr && Config.ReplayPath != nullptr)
+	{
+		fprintf(stderr, "Inputs come either from a script or from a replay.\n");
+		return false;
+	}
+	if (Config.RasterImagePath != nullptr)
+	{
+		Config.bRaster = true;
+	}
+	if (Config.FrameCount == 0)
+	{
+		Config.FrameCount = Config.ReplayPath != nullptr ? SIZE_MAX : 1000;
+	}
+	return true;
+}
+
+// Folds the draw calls of a frame into the run's checksum (FNV-1a).
+static uint64_t HashDrawCalls(uint64_t Hash, const ClientHostDrawBuffer& DrawBuffer)
+{
+	const size_t byteCount = DrawBuffer.CallCount * CLIENT_HOST_DRAW_CALL_SLOT_SIZE;
+	for (size_t byteIndex = 0; byteIndex < byteCount; byteIndex++)
+	{
+		Hash = (Hash ^ DrawBuffer.Memory[byteIndex]) * 1099511628211ull;
+	}
+	return Hash;
+}
+
+// Checksums the pixels of every viewport's framebuffer (FNV-1a).
+static uint64_t HashFramebuffers(const ClientHostRasterizer& Raster)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const ClientHostFramebuffer& framebuffer : Raster.Framebuffers)
+	{
+		const uint8_t* bytes = (const uint8_t*)framebuffer.Pixels.data();
+		for (size_t byteIndex = 0; byteIndex < framebuffer.Pixels.size() * sizeof(uint32_t); byteIndex++)
+		{
+			hash = (hash ^ bytes[byteIndex]) * 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+int main(int argc, char** argv)
+{
+	ClientHostState* host = new ClientHostState();
+	GClientHost = host;
+	host->Config.LibraryPath = CLIENT_HOST_DEFAULT_LIBRARY;
+	if (!ParseArguments(argc, argv, host->Config))
+	{
+		return 1;
+	}
+	const ClientHostConfig& config = host->Config;
+
+	if (config.ScriptPath != nullptr && !LoadClientHostScript(config.ScriptPath, host->Script))
+	{
+		return 1;
+	}
+	if (config.ReplayPath != nullptr && !LoadClientHostReplay(config.ReplayPath, *host))
+	{
+		return 1;
+	}
+	if (!LoadClientLibrary(*host))
+	{
+		return 1;
+	}
+
+	host->PersistentMemory.resize(config.PersistentMemorySize);
+	host->FrameMemory.resize(config.FrameMemorySize);
+	host->DrawBuffer.Memory.resize(config.MaxDrawCallCount * CLIENT_HOST_DRAW_CALL_SLOT_SIZE);
+	host->DrawBuffer.CallViewports.resize(config.MaxDrawCallCount);
+	if (config.bRaster && !StartClientHostRasterizer(*host))
+	{
+		return 1;
+	}
+
+	// What the Client prints goes to standard error, keeping standard output for the report.
+#if !defined(_WIN32)
+	fflush(stdout);
+	const int reportDescriptor = dup(STDOUT_FILENO);
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+#endif
+
+	host->Session.Platform = GetClientHostPlatformAPI();
+	host->Session.PersistentMemoryBuffer.Memory = host->PersistentMemory.data();
+	host->Session.PersistentMemoryBuffer.Size = host->PersistentMemory.size();
+	host->API.StartClient(host->Session);
+
+	bool bCapturing = false;
+	if (config.CapturePath != nullptr)
+	{
+		bCapturing = host->API.StartInputCapture != nullptr && host->API.StartInputCapture(host->Session, config.CapturePath);
+		if (!bCapturing)
+		{
+			fprintf(stderr, "The Client didn't start capturing inputs to %s.\n", config.CapturePath);
+		}
+	}
+
+	std::vector<uint64_t> frameNanoseconds;
+	frameNanoseconds.reserve(config.ReplayPath != nullptr ? 1024 : config.FrameCount);
+	std::vector<ActionInputEvent> inputEvents;
+	uint64_t drawChecksum = 14695981039346656037ull;
+	size_t totalDrawCallCount = 0;
+	size_t maxDrawCallCount = 0;
+	size_t discardedDrawCallCount = 0;
+	size_t totalDrawBatchCount = 0;
+	size_t totalDamageRectCount = 0;
+	size_t fullDamageFrameCount = 0;
+	size_t totalRasterizedTileCount = 0;
+	std::vector<uint64_t> rasterNanoseconds;
+	rasterNanoseconds.reserve(config.bRaster ? frameNanoseconds.capacity() : 0);
+
+	const auto runStart = std::chrono::steady_clock::now();
+	for (size_t frameIndex = 0; frameIndex < config.FrameCount; frameIndex++)
+	{
+		ClientFrameRequestData frameData = {};
+		frameData.FrameNumber = frameIndex;
+		frameData.FrameTime = config.FrameTime;
+
+		inputEvents.clear();
+		if (config.ReplayPath != nullptr)
+		{
+			if (!PlayClientHostReplay(*host, frameData, inputEvents))
+			{
+				break;
+			}
+		}
+		else
+		{
+			PlayClientHostScript(*host, frameIndex, inputEvents);
+		}
+
+		// Without a script or replay, optionally sweep the cursor over the main viewport along its diagonal, a pixel per frame.
+		const ClientHostViewport& mainViewport = host->Viewports[0];
+		if (host->Script.empty() && config.ReplayPath == nullptr && config.bCursorSweep && mainViewport.bAllocated
+			&& mainViewport.Dimensions.x > 0 && mainViewport.Dimensions.y > 0)
+		{
+			host->CursorViewport = 0;
+			host->CursorLocation = { (int16_t)(frameIndex % mainViewport.Dimensions.x), (int16_t)(frameIndex % mainViewport.Dimensions.y) };
+		}
+
+		host->DrawBuffer.CallCount = 0;
+		host->DrawBuffer.DiscardedCount = 0;
+		host->DrawBuffer.BatchCount = 0;
+		host->DrawBuffer.DamageRects.clear();
+		host->DrawBuffer.bFullDamage = true;
+
+		frameData.FrameMemoryBuffer.Memory = host->FrameMemory.data();
+		frameData.FrameMemoryBuffer.Size = host->FrameMemory.size();
+		frameData.ActionInputEvents.Buffer = inputEvents.data();
+		frameData.ActionInputEvents.EventCount = inputEvents.size();
+		frameData.CursorLocation = host->CursorLocation;
+		frameData.CursorViewport = host->CursorViewport;
+		frameData.NewDrawCall = ClientHostNewDrawCall;
+		frameData.SubmitDrawCommands = config.bPerCallDraws ? nullptr : ClientHostSubmitDrawCommands;
+
+		const auto frameStart = std::chrono::steady_clock::now();
+		host->API.RunClientFrame(host->Session, frameData);
+		const auto frameEnd = std::chrono::steady_clock::now();
+		frameNanoseconds.push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(frameEnd - frameStart).count());
+
+		drawChecksum = HashDrawCalls(drawChecksum, host->DrawBuffer);
+		totalDrawCallCount += host->DrawBuffer.CallCount;
+		maxDrawCallCount = std::max(maxDrawCallCount, host->DrawBuffer.CallCount);
+		discardedDrawCallCount += host->DrawBuffer.DiscardedCount;
+		totalDrawBatchCount += host->DrawBuffer.BatchCount;
+		totalDamageRectCount += host->DrawBuffer.DamageRects.size();
+		fullDamageFrameCount += host->DrawBuffer.bFullDamage ? 1 : 0;
+
+		if (config.bRaster)
+		{
+			const auto rasterStart = std::chrono::steady_clock::now();
+			totalRasterizedTileCount += RasterizeClientHostFrame(*host);
+			rasterNanoseconds.push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+				- rasterStart).count());
+		}
+	}
+	const double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+	// Viewports are gone once the Client shut down, framebuffers aren't, but the image is written while the run's state is whole.
+	bool bImageWritten = false;
+	if (config.RasterImagePath != nullptr && !rasterNanoseconds.empty())
+	{
+		bImageWritten = WriteClientHostFramebufferImage(host->Raster.Framebuffers[0], config.RasterImagePath);
+	}
+
+	bool bProfileExported = false;
+	if (config.ProfilePath != nullptr && host->API.ExportClientFrameProfile != nullptr)
+	{
+		bProfileExported = host->API.ExportClientFrameProfile(host->Session, config.ProfilePath);
+	}
+	if (bCapturing && host->API.StopInputCapture != nullptr)
+	{
+		host->API.StopInputCapture(host->Session);
+	}
+	host->API.ShutdownClient(host->Session);
+	UnloadClientLibrary(*host);
+	const uint32_t rasterWorkerCount = config.bRaster ? host->Raster.Jobs.WorkerCount : 0;
+	StopClientHostRasterizer(*host);
+
+#if !defined(_WIN32)
+	fflush(stdout);
+	dup2(reportDescriptor, STDOUT_FILENO);
+	close(reportDescriptor);
+#endif
+
+	const size_t frameCount = frameNanoseconds.size();
+	if (frameCount == 0)
+	{
+		fprintf(stderr, "No frame ran.\n");
+		return 1;
+	}
+
+	uint64_t totalFrameNanoseconds = 0;
+	for (uint64_t nanoseconds : frameNanoseconds) totalFrameNanoseconds += nanoseconds;
+	std::sort(frameNanoseconds.begin(), frameNanoseconds.end());
+
+	printf("{\n");
+	printf("\t\"config\": { \"library\": \"%s\", \"frames\": %zu, \"frameTime_s\": %g, \"script\": \"%s\", \"replay\": \"%s\", "
+		"\"cursorSweep\": %s, \"perCallDraws\": %s },\n",
+		config.LibraryPath, frameCount, config.FrameTime, config.ScriptPath != nullptr ? config.ScriptPath : "",
+		config.ReplayPath != nullptr ? config.ReplayPath : "", config.bCursorSweep ? "true" : "false", config.bPerCallDraws ? "true" : "false");
+	printf("\t\"run\": { \"seconds\": %.6f, \"framesPerSecond\": %.1f },\n", runSeconds, runSeconds > 0.0 ? frameCount / runSeconds : 0.0);
+	printf("\t\"frameTime\": { \"mean_ns\": %llu, \"min_ns\": %llu, \"max_ns\": %llu",
+		(unsigned long long)(totalFrameNanoseconds / frameNanoseconds.size()), (unsigned long long)frameNanoseconds.front(),
+		(unsigned long long)frameNanoseconds.back());
+	for (size_t percentileIndex = 0; percentileIndex < sizeof(CLIENT_HOST_REPORTED_PERCENTILES) / sizeof(double); percentileIndex++)
+	{
+		const size_t rank = (size_t)(CLIENT_HOST_REPORTED_PERCENTILES[percentileIndex] / 100.0 * (frameNanoseconds.size() - 1));
+		printf(", \"%s\": %llu", CLIENT_HOST_REPORTED_PERCENTILE_NAMES[percentileIndex], (unsigned long long)frameNanoseconds[rank]);
+	}
+	printf(" },\n");
+	printf("\t\"drawCalls\": { \"perFrame\": %.1f, \"maxPerFrame\": %zu, \"discarded\": %zu, \"batchesPerFrame\": %.1f, "
+		"\"damageRectsPerFrame\": %.2f, \"fullDamageFrames\": %zu, \"checksum\": \"%016llx\" },\n", (double)totalDrawCallCount / frameCount,
+		maxDrawCallCount, discardedDrawCallCount, (double)totalDrawBatchCount / frameCount, (double)totalDamageRectCount / frameCount,
+		fullDamageFrameCount, (unsigned long long)drawChecksum);
+	uint64_t totalRasterNanoseconds = 0;
+	for (uint64_t nanoseconds : rasterNanoseconds) totalRasterNanoseconds += nanoseconds;
+	std::sort(rasterNanoseconds.begin(), rasterNanoseconds.end());
+	printf("\t\"raster\": { \"enabled\": %s, \"workers\": %u, \"tileSize\": %d, \"tilesPerFrame\": %.1f, \"fullRedraw\": %s, \"mean_ns\": %llu, \"p50_ns\": %llu, \"max_ns\": %llu, "
+		"\"checksum\": \"%016llx\", \"image\": \"%s\", \"imageWritten\": %s },\n", config.bRaster ? "true" : "false",
+		rasterWorkerCount, CLIENT_HOST_RASTER_TILE_SIZE,
+		rasterNanoseconds.empty() ? 0.0 : (double)totalRasterizedTileCount / rasterNanoseconds.size(), config.bFullRedraw ? "true" : "false",
+		(unsigned long long)(rasterNanoseconds.empty() ? 0 : totalRasterNanoseconds / rasterNanoseconds.size()),
+		(unsigned long long)(rasterNanoseconds.empty() ? 0 : rasterNanoseconds[rasterNanoseconds.size() / 2]),
+		(unsigned long long)(rasterNanoseconds.empty() ? 0 : rasterNanoseconds.back()),
+		(unsigned long long)(config.bRaster ? HashFramebuffers(host->Raster) : 0),
+		config.RasterImagePath != nullptr ? config.RasterImagePath : "", bImageWritten ? "true" : "false");
+	printf("\t\"profile\": { \"path\": \"%s\", \"exported\": %s }\n", config.ProfilePath != nullptr ? config.ProfilePath : "",
+		bProfileExported ? "true" : "false");
+	printf("}\n");
+
+	delete host;
+	return 0;
+}
@@ -10,10 +10,68 @@ static_assert(0, "Client.h can only be included inside the SYNERGY_CLIENT_MAIN t
 
 #include "SynergyClientAPI.h"
 #include "SynergyCore.h"
+#include "SynergyJobSystem.h"
 
 #include "ClientDrawing.h"
 #include "ClientUI.h"
 #include "ClientGraph.h"
+#include "ClientProfiler.h"
+
+#include <stdio.h>
+
+// File inputs are captured to when no other is given, relative to the working directory.
+#define CLIENT_INPUT_CAPTURE_DEFAULT_PATH "SynergyClientInput.capture"
+
+// Capacity of the Client Graph's data store, allocated from persistent memory.
+constexpr size_t CLIENT_GRAPH_MAX_NODE_COUNT = 1024;
+constexpr size_t CLIENT_GRAPH_MAX_CONNECTION_COUNT = 8 * CLIENT_GRAPH_MAX_NODE_COUNT;
+
+// Job system workers, the thread running frames included. One per profiler thread so every worker's zones get recorded.
+constexpr uint32_t CLIENT_JOB_MAX_WORKER_COUNT = CLIENT_PROFILER_MAX_THREADS;
+
+// Scratch memory of every job worker, wiped at the start of every frame.
+constexpr size_t CLIENT_JOB_FRAME_ARENA_SIZE = 256 * 1024;
+
+// Working memory of the Main Viewport's retained UI tree, allocated from persistent memory.
+constexpr size_t CLIENT_UI_TREE_MEMORY_SIZE = 16 * 1024;
+
+// Node representations the Client keeps, at most one per graph node shown.
+constexpr size_t CLIENT_NODE_REPRESENTATION_MAX_COUNT = 64;
+
+// Side of a graph node in the graph view, in view space units.
+constexpr int16_t CLIENT_GRAPH_VIEW_NODE_SIZE = 50;
+
+// Side of the view space cells node representations are filed under by the graph view's spatial index, and how many buckets those
+// cells hash into. The bucket count must be a power of two.
+constexpr float CLIENT_GRAPH_VIEW_INDEX_CELL_SIZE = 128.f;
+constexpr size_t CLIENT_GRAPH_VIEW_INDEX_BUCKET_COUNT = 256;
+
+// Fewest children a UI node needs for the positions of its subtrees to be processed in parallel.
+constexpr size_t CLIENT_UI_PARALLEL_MIN_CHILD_COUNT = 256;
+
+/*
+	What of the view space the graph view panel shows: the location at its top left corner, and the pixels a view space unit spans.
+*/
+struct GraphViewCameraData
+{
+	Vector2f Origin;
+	float Zoom;
+};
+
+/*
+	Spatial hash of node representations over view space, letting the graph view only look at those around what it shows.
+	Representations are filed under the cell their location falls in, and cells under one of a fixed number of buckets.
+*/
+struct GraphViewSpatialIndex
+{
+	// First representation of every bucket, and for every representation the next one of its bucket. -1 ends a bucket.
+	int32_t BucketHeads[CLIENT_GRAPH_VIEW_INDEX_BUCKET_COUNT];
+	int32_t NextInBucket[CLIENT_NODE_REPRESENTATION_MAX_COUNT];
+
+	// Version of the node representations the index was built from, valid once built.
+	uint64_t BuiltVersion;
+	bool bBuilt;
+};
 
 /*
 	State of the Client as a whole. Persistent memory pointer provided by the platform is cast to this.
@@ -30,8 +88,40 @@ struct ClientSessionState
 
 	MemoryAllocator PersistentMemoryAllocator;
 
-	// Buffer for displayed node data.
-	GraphNodeRepresentationData NodeRepresentations[64];
+	// Buffer for displayed node data. Used slots are packed at the start.
+	GraphNodeRepresentationData NodeRepresentations[CLIENT_NODE_REPRESENTATION_MAX_COUNT];
+
+	// Position of the node representations in the Client Graph's change stream.
+	SGraphChangeCursor NodeRepresentationsChangeCursor;
+
+	// Bumped whenever representations are added or removed, so that what was built from them knows to rebuild.
+	uint64_t NodeRepresentationsVersion;
+
+	// Spatial index of the node representations, rebuilt by the graph view when their version moves.
+	GraphViewSpatialIndex NodeRepresentationsIndex;
+
+	// Camera of the graph view panel. Graph nodes out of its sight get no UI node, and so no draw call.
+	GraphViewCameraData GraphViewCamera;
+
+	// UI Partition Tree of the Main Viewport, retained across frames. Built on the first frame, then only rebuilt where its inputs changed.
+	UIPartitionTree MainViewportUITree;
+
+	// Inputs the Main Viewport UI tree currently reflects, compared with the Client's every frame to find what needs rebuilding.
+	struct
+	{
+		Vector2s ViewportDimensions;
+		uint64_t NodeRepresentationsVersion;
+		GraphViewCameraData GraphViewCamera;
+		SNodeGUID SelectedNodeID;
+		Vector2s CursorLocation;
+		ViewportID CursorViewport;
+	} MainViewportUIInputs;
+
+	// Node representation shown by every child of the Main Viewport's graph view panel, culling leaving out those out of sight.
+	uint32_t GraphViewNodeRepresentations[CLIENT_NODE_REPRESENTATION_MAX_COUNT];
+
+	// Draw calls of the previous frame, to find where the next one draws differently. See SubmitDrawCommands.
+	ClientDrawDamageTracker DrawDamage;
 
 	// TEST CODE Persistent UI Node Presentation Definitions.
 	// At some point this should become more dynamic.
@@ -50,6 +140,18 @@ struct ClientSessionState
 
 	SNodeGUID SelectedGraphNodeID;
 
+	// Times the stages of every frame. See ClientProfiler.h.
+	ClientProfiler Profiler;
+
+	// Spreads the work of frames over worker threads. Worker 0 is the thread running frames, recording on profiler thread 0.
+	SJobSystem Jobs;
+
+	// File the inputs of every frame are captured to, null while not capturing. See StartInputCapture.
+	FILE* InputCaptureFile;
+
+	// Number of the last frame captured, ~0 before the first.
+	size_t InputCaptureLastFrame;
+
 	// DEBUG DATA
 	bool bDrawUIDebug = false;
 };
@@ -70,18 +172,17 @@ struct ClientFrameState
 	struct
 	{
 		DrawCall* (*NewDrawCall)(ViewportID TargetViewportID, DrawCallType Type);
+		FrameSubmitDrawCommandsFunc* SubmitDrawCommands;
 	} FramePlatformAPI;
 
+	// Draw calls recorded over the frame, submitted to the platform once they're all made. See OutputDrawCalls.
+	ClientDrawCommandBuffer DrawCommands;
+
 	// Location of the cursor when the frame started.
     Vector2s CursorLocation;
 
     // Viewport the cursor was in when the frame started.
     ViewportID CursorViewport;
-
-	// Intermediate data generated and used by the frame, for the frame.
-	
-	// UI Partition Tree for drawing the Main Viewport's UI.
-	UIPartitionTree MainViewportUITree;
 };
 
 // MAJOR PROCEDURES
@@ -92,9 +193,41 @@ struct ClientFrameState
 void ProcessInputs(ClientSessionState& State, ClientFrameState& FrameData);
 
 /*
-	Builds the UI Partition Tree for the Main Viewport, defining every UI element and their logic.
+	Starts capturing the inputs of every frame to the given file, stopping any capture running. Returns false if the file couldn't be created.
+*/
+bool StartInputCapture(ClientSessionState& Client, const char* FilePath);
+
+/*
+	Stops capturing inputs and closes the capture's file, if a capture was running.
+*/
+void StopInputCapture(ClientSessionState& Client);
+
+/*
+	Appends the inputs the platform sent for the frame to the running capture, if any.
+*/
+void CaptureFrameInputs(ClientSessionState& Client, const ClientFrameRequestData& FrameData);
+
+/*
+	Brings node representations up to date with the changes applied to the Client Graph since the last call.
+	Representations are only rebuilt from the whole graph when the change stream calls for a resync.
+*/
+void UpdateNodeRepresentations(ClientSessionState& Client);
+
+/*
+	Partition pass over the Main Viewport's UI tree: builds it on the first frame, then rebuilds the subtrees whose inputs changed.
+*/
+void UpdateUIPartitionTree(ClientSessionState& Client);
+
+/*
+	Interaction pass over the Main Viewport's UI tree: finds the interacted node again if the cursor or positions moved, and runs UI logic.
+*/
+void ProcessUIInteractions(ClientSessionState& Client);
+
+/*
+	Updates the absolute position of the nodes below those marked dirty, spreading subtrees of nodes with many children over the
+	job system's workers. Does nothing when no position is dirty.
 */
-void BuildFrameUIPartitionTree(ClientSessionState& Client, ClientFrameState& Frame, const bool bIsPartitionPass);
+void ProcessUITreeAbsolutePositions(ClientSessionState& Client, UIPartitionTree& Tree);
 
 /*
 	Generates all draw calls to render the end state of a frame. Includes UI and various dynamic elements.
@@ -45,6 +45,107 @@ constexpr ColorRGBT COLOR_Green =		{ 0, 255, 0 };
 constexpr ColorRGBT COLOR_Cyan =		{ 0, 255, 255 };
 constexpr ColorRGBT COLOR_Blue =		{ 0, 0, 255 };
 
+// Draw command buffer
+
+// Draw calls a frame can record. Calls past it are dropped.
+constexpr size_t CLIENT_DRAW_COMMAND_MAX_COUNT = 8192;
+
+// Size of the largest draw call data structure.
+constexpr size_t CLIENT_DRAW_CALL_MAX_SIZE = sizeof(BitmapDrawCallData);
+
+// Layers the Client draws on, in increasing drawing order.
+constexpr uint16_t CLIENT_DRAW_LAYER_UI = 0;
+constexpr uint16_t CLIENT_DRAW_LAYER_DEBUG = 100;
+
+/*
+	Frame-local buffer recording the Client's draw calls, which get sorted into batches and handed to the platform at the end of the frame.
+	All its memory comes from the frame's memory.
+*/
+struct ClientDrawCommandBuffer
+{
+	// Data of the calls recorded, tightly packed in the order they were made.
+	uint8_t* CallData;
+	size_t CallDataSize;
+
+	// Sort key of every call: viewport, layer and type, then the call's index so that sorting keeps the order calls were made in.
+	uint64_t* Keys;
+
+	// Offset of every call's data in CallData.
+	uint32_t* CallOffsets;
+
+	size_t CallCount;
+	size_t CallCapacity;
+
+	// Calls made once the buffer was full. They were handed the discard slot and are lost.
+	size_t DroppedCount;
+
+	alignas(8) uint8_t DiscardSlot[CLIENT_DRAW_CALL_MAX_SIZE];
+};
+
+// Where drawing functions output draw calls: the frame's command buffer, and the viewport and layer they are drawn on.
+struct ClientDrawTarget
+{
+	ClientDrawCommandBuffer* Commands;
+	ViewportID Viewport;
+	uint16_t Layer;
+};
+
+/*
+	Allocates the buffer's memory from the frame's memory, for up to MaxCallCount calls.
+*/
+void InitializeDrawCommandBuffer(ClientDrawCommandBuffer& Buffer, MemoryAllocator& FrameMemory, size_t MaxCallCount);
+
+/*
+	Records a new draw call of the given type and returns its data, zeroed but for its type, for the caller to fill in.
+	Never returns null: calls past the buffer's capacity are written to a discard slot.
+*/
+DrawCall* NewDrawCommand(ClientDrawCommandBuffer& Buffer, ViewportID Viewport, uint16_t Layer, DrawCallType Type);
+
+inline DrawCall* NewDrawCommand(const ClientDrawTarget& Target, DrawCallType Type)
+{
+	return NewDrawCommand(*Target.Commands, Target.Viewport, Target.Layer, Type);
+}
+
+// Most damage rectangles a frame hands to the platform. Past it, new rectangles get merged into existing ones.
+constexpr size_t CLIENT_DRAW_DAMAGE_MAX_RECT_COUNT = 32;
+
+// Draw call of a frame as damage tracking remembers it.
+struct ClientDrawDamageEntry
+{
+	// Hash of the call's data, viewport and layer.
+	uint64_t Hash;
+
+	// Pixels the call may touch.
+	DrawDamageRect Bounds;
+};
+
+/*
+	Remembers the previous frame's draw calls, in batch order, for the next frame to find where it draws differently.
+	Its memory comes from persistent memory.
+*/
+struct ClientDrawDamageTracker
+{
+	ClientDrawDamageEntry* PreviousCalls;
+	size_t PreviousCallCount;
+	size_t Capacity;
+
+	// Whether PreviousCalls holds the previous frame's calls. If not, the next frame is fully damaged.
+	bool bHasPrevious;
+};
+
+/*
+	Allocates the tracker's memory from persistent memory, for frames of up to MaxCallCount calls.
+*/
+void InitializeDrawDamageTracker(ClientDrawDamageTracker& Tracker, MemoryAllocator& PersistentMemory, size_t MaxCallCount);
+
+/*
+	Sorts the recorded calls into batches and hands them to the platform: all at once through SubmitDrawCommands if it has it,
+	one by one through NewDrawCall otherwise. The buffer is left empty.
+	Calls handed all at once come with the damage since the previous frame's, which the tracker then remembers the calls of.
+*/
+void SubmitDrawCommands(ClientDrawCommandBuffer& Buffer, MemoryAllocator& FrameMemory, ClientDrawDamageTracker& Damage,
+	FrameSubmitDrawCommandsFunc* SubmitDrawCommands, FrameNewDrawCallFunc* NewDrawCall);
+
 // Graph drawing
 
 /*
@@ -62,16 +163,15 @@ struct GraphNodeRepresentationData
 
 // UI drawing
 
-// Type definition for a function that is able to output draw calls from a UI Node, a New Draw Call function, and if needed a Presentation Def data structure.
+// Type definition for a function that is able to output draw calls from a UI Node to a Draw Target, and if needed a Presentation Def data structure.
 typedef void (UINodeDrawingFunction)(const struct UIPartitionNode& Node,
-									FrameNewDrawCallFunc& NewDrawCall,
-									ViewportID TargetViewport,
+									const ClientDrawTarget& Target,
 									const struct UINodePresentationDef* PresentationDef);
 
 /*
 	Defines the graphical representation of a node.
-	The simplest definition possible only contains a function pointer able to output draw calls from a UI Node and the
-	necessary frame system call for allocating the calls.
+	The simplest definition possible only contains a function pointer able to output draw calls from a UI Node to the
+	frame's draw commands.
 
 	More complex presentations can be built by extending this data structure with parameters and giving it a drawing function
 	that fetches the definition from the Node and casts it to the appropriate type.
@@ -81,9 +181,9 @@ typedef void (UINodeDrawingFunction)(const struct UIPartitionNode& Node,
 struct UINodePresentationDef
 {
 	// Calls the definition's underlying Drawing Function. If it is not assigned, no draw calls will be emitted for the node.
-	inline void DrawNode(const UIPartitionNode& Node, FrameNewDrawCallFunc& NewDrawCall, ViewportID TargetViewport)
+	inline void DrawNode(const UIPartitionNode& Node, const ClientDrawTarget& Target)
 	{
-		if (DrawingFunctionPtr != nullptr) DrawingFunctionPtr(Node, NewDrawCall, TargetViewport, this);
+		if (DrawingFunctionPtr != nullptr) DrawingFunctionPtr(Node, Target, this);
 		// Assert if the Drawing Function Ptr is not assigned ? Or should invisible nodes just not be assigned a Presentation in the first place ?
 	}
 
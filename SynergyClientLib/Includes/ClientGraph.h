@@ -4,8 +4,16 @@
 #define CLIENT_GRAPH_INCLUDED
 
 #include "Graph/SynergyGraph.h"
+#include "Graph/SynergyGraphStore.h"
+#include "Graph/SynergyGraphBulkLoad.h"
+#include "Graph/SynergyGraphSearch.h"
+#include "Graph/SynergyGraphChangeStream.h"
+#include "Graph/SynergyGraphTransaction.h"
+#include "Net/SynergyProtocol.h"
 #include "SynergyCore.h"
 
+#include <type_traits>
+
 // The Client essentially needs to try and predict where the user will attempt to travel to next on the graph and keep that data quickly
 // accessible, while also providing a potentially very large storage capacity for large graphs, with our without the help of a server.
 
@@ -14,17 +22,15 @@
 // To this end, the client maintains an interface to the rest of the app to server common commands and being able to switch into Edit Mode
 // to conveniently build change operations and form a transaction that can be applied or sent to the server for approval.
 
-// Core Data making up a Node.
-struct NodeCoreData
-{
-	// Display name of the node.
-	NodeName name;
+struct ClientGraph;
 
-	// ID of parent node.
-	SNodeGUID parentNodeID;
-};
+/*
+	Index of a node within its transaction: fetched nodes come first, then created nodes. Transactions only refer to their own nodes
+	through these rather than pointers, so they can be copied around as plain bytes. See ClientGraphEditTransaction::GetNode.
+*/
+typedef uint32_t GraphEditNodeIndex;
 
-struct ClientGraph;
+constexpr GraphEditNodeIndex GRAPH_EDIT_INVALID_NODE = ~0u;
 
 /*
 	"Deployed" version of a node, forming a structured and easy-to-parse graph for edition.
@@ -35,23 +41,29 @@ struct GraphEditNode
 	bool bDeleted = false;
 	bool bFetched = false;
 
-	GraphEditNode* Parent = nullptr;
+	GraphEditNodeIndex Parent = GRAPH_EDIT_INVALID_NODE;
 	SNodeConnectionAccessLevel AccessLevelToParent = SNodeConnectionAccessLevel::NONE;
 	SNodeConnectionAccessLevel AccessLevelFromParent = SNodeConnectionAccessLevel::NONE;
 
-	// Node Def data from latest new or edit operation affecting this node.
+	// Node Def data from latest new or edit operation affecting this node. Its name views the target graph's name pool.
 	SNodeDef NodeDef = {};
+
+	// Handle of the node's name in the target graph's name pool, which the transaction holds a reference on.
+	SNameHandle NameHandle = SNAME_INVALID_HANDLE;
+
+	// Version of a fetched node when it was fetched, which it must still have for the transaction to apply. See SGraphStore::GetNodeVersion.
+	uint64_t Version = 0;
 };
 
 /*
-	"Deployed" wrapper around a connection definition, giving direct pointer access to involved Nodes in the transaction if any.
+	"Deployed" wrapper around a connection definition, giving direct access to involved Nodes in the transaction if any.
 	By the end of the transaction construction Source HAS to be defined, and Destination unless connection was fetched and contains
 	a valid destination ID.
 */
 struct GraphEditConnection
 {
-	GraphEditNode* Src = nullptr;
-	GraphEditNode* Dest = nullptr;
+	GraphEditNodeIndex Src = GRAPH_EDIT_INVALID_NODE;
+	GraphEditNodeIndex Dest = GRAPH_EDIT_INVALID_NODE;
 
 	SNodeConnectionDef Def = {};
 
@@ -60,6 +72,9 @@ struct GraphEditConnection
 
 /*
 	Contains a set of operations to perform and the necessary data to build connections involving nodes created during the transaction.
+	Trivially copyable: it can be copied, queued or journaled as is, as long as its target graph stays alive. It holds a reference on
+	the name of every node it involves, so other transactions and subscription updates applied meanwhile can't free them. Copies share
+	those references: only one of them may be applied or have its names released.
 	TODO The system can be made simpler once a arbitrary memory allocator is implemented.
 */
 struct ClientGraphEditTransaction
@@ -77,8 +92,18 @@ struct ClientGraphEditTransaction
 	GraphEditConnection FetchedConnections[32 * 32];
 	GraphEditConnection CreatedConnections[32 * 32];
 
+	// Returns the node at the passed index, or nullptr for GRAPH_EDIT_INVALID_NODE.
+	GraphEditNode* GetNode(GraphEditNodeIndex NodeIndex);
+	const GraphEditNode* GetNode(GraphEditNodeIndex NodeIndex) const;
+
+	// Returns the index of a node of this transaction, or GRAPH_EDIT_INVALID_NODE for nullptr.
+	GraphEditNodeIndex GetNodeIndex(const GraphEditNode* Node) const;
+
+	// Whether the node at the passed index is one the transaction creates.
+	static bool IsCreatedNode(GraphEditNodeIndex NodeIndex);
+
 	/*
-		Loads an existing node from the parent graph so it may be involved in the transaction.
+		Loads an existing node from the parent graph so it may be involved in the transaction, recording its version.
 		Returns the fetched node within the transaction, usable to create other nodes or edit it conditionally.
 	*/ 
 	GraphEditNode* FetchGraphNode(SNodeGUID NodeID);
@@ -86,12 +111,13 @@ struct ClientGraphEditTransaction
 	/*
 		Creates a new node with the passed definition.
 		Def Parent ID not taken into account. Node ID should be defined if editing an existing node.
+		The name is interned in the target graph right away, so it only needs to stay valid for the duration of the call.
 		Returns the newly created node within the transaction, usable to create further nodes or edit it conditionally.
 	*/
 	GraphEditNode* CreateNode(SNodeDef NewNodeDef, GraphEditNode* Parent);
 
 	/*
-		Edits a node that was fetched or created earlier in the transaction.
+		Edits a node that was fetched or created earlier in the transaction. An empty name keeps the current one.
 		Returns whether the operation was successfully added.
 	*/
 	bool EditNode(GraphEditNode& TargetNode, SNodeDef NewNodeDef, GraphEditNode* NewParent = nullptr,
@@ -124,32 +150,47 @@ struct ClientGraphEditTransaction
 		Returns whether the operation was successfully added.
 	*/
 	bool DeleteConnection(GraphEditConnection& Connection);
-};
-
-/*
-	Statically defined Data Store for a client graph's nodal data.
-*/
-template<size_t MaxNodeCount>
-struct StaticClientGraphDataStore
-{
-	// Core Data datastore for stored nodes. Supports up to a certain amount of nodes at once. Empty slots are marked starting with a 0.
-	// Slot in the store corresponds to the Node's GUID.
-	NodeCoreData _StaticNodeCoreDataStore[MaxNodeCount];
-
-	// Access Level matrix between all stored nodes. To be updated after every edit operation.
-	SNodeConnectionAccessLevel _StaticAccessLevelMatrix[MaxNodeCount * MaxNodeCount];
 
-	constexpr size_t GetMaxNodeCount() const { return MaxNodeCount; }
+	/*
+		Translates the transaction into identifier-based ops (see SynergyGraphTransaction.h), the form it takes to be sent to a server.
+		Fetched nodes become FETCH_NODE preconditions, other ops only carry what differs from the target graph. Op names view its name pool.
+		Writes up to OpBufferSize ops to the buffer. Returns the total number of ops, which may exceed the buffer size.
+	*/
+	size_t ExportOps(SGraphOp* OpBuffer, size_t OpBufferSize) const;
 
-	SNodeGUID FindAvailableID() const;
+	/*
+		Releases the references the transaction holds on the names of its nodes. Applying it does so, call it on a transaction given up
+		without being applied, or that failed to apply, so the names only it kept can be freed.
+	*/
+	void ReleaseNames();
 };
 
+static_assert(std::is_trivially_copyable<ClientGraphEditTransaction>::value, "Transactions must stay copyable as plain bytes.");
+
 /*
 	Contains the entire local state of the graph and provides interface functions to process common commands in the Synergy system for
 	finding nodes, interacting with them, and creating change requests.
 */
 struct ClientGraph
 {
+	/*
+		Allocates the graph's data store, search index and change stream from the passed allocator with the given capacities.
+		Must be called before anything else. Returns whether allocation succeeded.
+	*/
+	bool Initialize(MemoryAllocator& Allocator, size_t MaxNodeCount, size_t MaxConnectionCount,
+					size_t ChangeStreamCapacity = SGRAPH_DEFAULT_CHANGE_STREAM_CAPACITY);
+
+	// Returns how much memory Initialize will request from a Stack Allocator for the given capacities.
+	static size_t GetRequiredMemorySize(size_t MaxNodeCount, size_t MaxConnectionCount,
+					size_t ChangeStreamCapacity = SGRAPH_DEFAULT_CHANGE_STREAM_CAPACITY);
+
+	/*
+		Loads nodes and connections from a bulk file straight into the data store, bypassing transactions.
+		See SynergyGraphBulkLoad.h for the file format. On failure the graph is left unchanged.
+		Loaded nodes aren't described by the change stream, a successful load emits a RESYNC instead.
+	*/
+	bool BulkLoad(const char* FilePath, const SGraphBulkLoadOptions& Options, SGraphBulkLoadResult& OutResult);
+
 	/*
 	Returns a structured representation of a node's core definition data from its ID.
 	StartNodeID, if set, gives the system a hint on where to start the search.
@@ -161,25 +202,67 @@ struct ClientGraph
 		StartNodeID, if set, gives the system a hint on where to start the search.
 		If the graph contains multiple nodes with the same name, the first one found is returned.
 	*/
-	SNodeDef GetNodeDef(NodeName Name, SNodeGUID StartNodeID = SNODE_INVALID_ID);
+	SNodeDef GetNodeDef(std::string_view Name, SNodeGUID StartNodeID = SNODE_INVALID_ID);
+
+	/*
+		Searches nodes by partial name. See SynergyGraphSearch.h for query options.
+		Returns the number of hits written to the buffer.
+	*/
+	size_t SearchNodes(const SGraphSearchQuery& Query, SGraphSearchHit* HitsBuffer, size_t HitsBufferSize, SGraphSearchResultInfo& OutInfo);
 
 	// Returns the connections to AND from the passed Node ID. Returns the total amount of connections.
 	size_t GetNodeConnections_Bidirectional(SNodeGUID NodeID, SNodeConnectionDef* NodeConnectionsBuffer, size_t NodeIDBufferSize);
 
 	/*
-		Attempts to apply the passed transaction.
-		Will mutate the transaction to facilitate its application.
+		Attempts to apply the passed transaction. Fails without changing anything if a fetched node is gone or changed since it was fetched.
+		Will mutate the transaction to facilitate its application. Every change made to the graph is recorded in the change stream.
+		Once applied its names are released, and names nothing references anymore are freed, see SNamePool. A transaction that fails
+		to apply keeps its names until ReleaseNames is called.
 	*/
 	bool ApplyEditTransaction(ClientGraphEditTransaction& TransactionToApply);
 
+	/*
+		Applies a SUBSCRIPTION_UPDATE payload received from the server. Nodes keep their server versions, and are stored under local IDs
+		mapped to their server IDs, so transactions built against the graph can be exported for the server to check.
+		Snapshots replace the whole graph, root included, and emit a RESYNC. Other updates are recorded in the change stream like transactions.
+		Returns false if the payload was malformed or some records didn't fit in the graph, which still gets every record that did.
+	*/
+	bool ApplySubscriptionUpdate(const uint8_t* Payload, size_t PayloadSize);
+
+	// Returns the server ID of a node mirrored from a subscription. Other IDs, created node refs included, are returned as they are.
+	SNodeGUID GetServerNodeID(SNodeGUID NodeID) const;
+
+	// Returns the local ID of the node mirroring the passed server node, or SNODE_INVALID_ID if there is none.
+	SNodeGUID FindLocalNodeID(SNodeGUID ServerNodeID) const;
+
 	// Node ID for Root Node of the Graph, which is the only node that can have no parent.
 	SNodeGUID RootNodeID = 0;
 
+	// Data Store for the Graph. Capacity is set once at initialization.
+	SGraphStore DataStore;
+
+	// Name search index over the Data Store, kept up to date by transactions and bulk loads.
+	SGraphSearchIndex SearchIndex;
+
+	// Changes applied by transactions, for derived structures to follow. See SynergyGraphChangeStream.h.
+	SGraphChangeStream Changes;
+
 	/*
-		Data Store for the Graph.In the spirit of keeping it simple for now, we just use a static data store with a predefined max size.
-		Later this will probably be abstracted away with a type that simply exposes function pointers for access to various elements.
+		Server IDs of the nodes mirrored from a subscription by local ID, SNODE_INVALID_ID for the others.
+		Server IDs spread over the server's whole ID space, much larger than the data store, which is why mirrored nodes get local IDs.
 	*/
-	StaticClientGraphDataStore<16> DataStore;
+	SNodeGUID* ServerNodeIDs = nullptr;
+
+	/*
+		Open addressing hash table of the local IDs of mirrored nodes, keyed by their server ID. Capacity is a power of two at least twice
+		the max node count. Removals shift the entries following them back, so no tombstone is ever left.
+	*/
+	SNodeGUID* LocalNodeIDs = nullptr;
+	size_t LocalNodeIDCapacity = 0;
+
+	// Internal helpers.
+	void MapServerNodeID(SNodeGUID LocalNodeID, SNodeGUID ServerNodeID);
+	void UnmapServerNodeID(SNodeGUID LocalNodeID);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+// Contains symbols for the Client's frame profiler: scoped zones timing the stages of a frame, recorded per thread and exportable as a
+// Chrome trace (chrome://tracing, ui.perfetto.dev).
+
+#ifndef CLIENT_PROFILER_INCLUDED
+#define CLIENT_PROFILER_INCLUDED
+
+#include "SynergyCore.h"
+
+#include <atomic>
+
+// Set by the build (see the SYNERGY_CLIENT_PROFILER CMake option). Without it zones compile to nothing and no memory is reserved.
+#ifndef CLIENT_PROFILER_ENABLED
+#define CLIENT_PROFILER_ENABLED 0
+#endif
+
+// Threads that can record zones, each into its own ring. Thread 0 is the one running frames.
+constexpr uint32_t CLIENT_PROFILER_MAX_THREADS = 8;
+
+// Events each thread's ring holds before overwriting its oldest ones. Must be a power of two.
+constexpr uint64_t CLIENT_PROFILER_RING_EVENT_COUNT = 4096;
+
+// File profiles are exported to when no other is given, relative to the working directory.
+#define CLIENT_PROFILE_DEFAULT_PATH "SynergyClientProfile.json"
+
+// Longest zone name kept, longer ones are truncated.
+constexpr size_t CLIENT_PROFILER_MAX_NAME_LENGTH = 15;
+
+/*
+	Stages of a Client frame, each with a time budget. The time a stage takes over a frame is compared to its budget when the frame ends.
+*/
+enum class ClientFrameStage : uint8_t
+{
+	INPUTS,
+	REPRESENTATIONS,
+	PARTITION_PASS,
+	PARTITION_POSITIONS,
+	INTERACTION_PASS,
+	INTERACTION_POSITIONS,
+	DRAW_CALLS,
+	STAGE_COUNT
+};
+
+struct ClientFrameStageDef
+{
+	const char* Name;
+
+	// Most microseconds the stage should take in a frame, out of the 16.6ms a frame has at 60Hz.
+	uint32_t BudgetMicroseconds;
+};
+
+constexpr ClientFrameStageDef CLIENT_FRAME_STAGE_DEFS[(size_t)ClientFrameStage::STAGE_COUNT] =
+{
+	{ "Inputs", 250 },
+	{ "Representations", 1000 },
+	{ "PartitionPass", 2000 },
+	{ "PartitionPos", 500 },
+	{ "InteractionPass", 2000 },
+	{ "InteractionPos", 500 },
+	{ "DrawCalls", 4000 },
+};
+
+/*
+	A finished zone. Names are copied in rather than pointed to, as a reloaded Client library would leave pointers to its literals dangling.
+*/
+struct ClientProfileEvent
+{
+	uint64_t StartTicks;
+	uint64_t EndTicks;
+	char Name[CLIENT_PROFILER_MAX_NAME_LENGTH + 1];
+};
+
+/*
+	Ring of finished zones of a single thread. Only that thread writes to it, an export reads it from any thread without locking: events are
+	written before the write index moves past them, and events read are discarded when the write index shows they were overwritten meanwhile.
+*/
+struct ClientProfilerThread
+{
+	ClientProfileEvent* Events = nullptr;
+
+	// Events written since the start, the next one goes at WriteIndex % CLIENT_PROFILER_RING_EVENT_COUNT.
+	std::atomic<uint64_t> WriteIndex;
+
+	// Profiler the thread records for, whose recording switch zones check.
+	struct ClientProfiler* Profiler = nullptr;
+};
+
+// Durations of one stage over the frames recorded so far.
+struct ClientFrameStageStats
+{
+	// Ticks the stage took in the current frame, summed over its zones.
+	uint64_t FrameTicks;
+
+	uint64_t LastNanoseconds;
+	uint64_t MaxNanoseconds;
+	uint64_t TotalNanoseconds;
+
+	// Frames in which the stage went over its budget.
+	uint64_t OverrunCount;
+};
+
+/*
+	State of the profiler, part of the Client's persistent state.
+*/
+struct ClientProfiler
+{
+	// Zones only record while this is set. Toggled with F2.
+	bool bRecording;
+
+	ClientProfilerThread Threads[CLIENT_PROFILER_MAX_THREADS];
+
+	// Tick and steady clock readings at the start, against which the tick rate gets calibrated and event times are exported.
+	uint64_t BaseTicks;
+	uint64_t BaseNanoseconds;
+
+	// Latest estimate of the tick rate, refined at the end of every frame.
+	double TicksPerMicrosecond;
+
+	// Frames whose end was recorded.
+	uint64_t FrameCount;
+
+	ClientFrameStageStats Stages[(size_t)ClientFrameStage::STAGE_COUNT];
+};
+
+#if CLIENT_PROFILER_ENABLED
+
+/*
+	Reads the profiler's clock: the CPU's time stamp counter where there is one, the steady clock otherwise.
+*/
+uint64_t ReadProfilerTicks();
+
+/*
+	Writes a finished zone to the thread's ring.
+*/
+void RecordProfileEvent(ClientProfilerThread& Thread, const char* Name, uint64_t StartTicks, uint64_t EndTicks);
+
+/*
+	Records a zone from its construction to the end of its scope, on the given thread.
+*/
+struct ClientProfileZone
+{
+	ClientProfilerThread& Thread;
+	const char* Name;
+	uint64_t StartTicks;
+
+	ClientProfileZone(ClientProfilerThread& InThread, const char* InName)
+		: Thread(InThread), Name(InName), StartTicks(InThread.Profiler->bRecording ? ReadProfilerTicks() : 0) {}
+
+	~ClientProfileZone()
+	{
+		if (StartTicks != 0)
+		{
+			RecordProfileEvent(Thread, Name, StartTicks, ReadProfilerTicks());
+		}
+	}
+};
+
+/*
+	Records a frame stage to the end of its scope on the thread running frames, and counts it in the stage's time for the frame.
+*/
+struct ClientProfileStageZone
+{
+	ClientProfiler& Profiler;
+	ClientFrameStage Stage;
+	uint64_t StartTicks;
+
+	ClientProfileStageZone(ClientProfiler& InProfiler, ClientFrameStage InStage)
+		: Profiler(InProfiler), Stage(InStage), StartTicks(InProfiler.bRecording ? ReadProfilerTicks() : 0) {}
+
+	~ClientProfileStageZone()
+	{
+		if (StartTicks != 0)
+		{
+			const uint64_t endTicks = ReadProfilerTicks();
+			Profiler.Stages[(size_t)Stage].FrameTicks += endTicks - StartTicks;
+			RecordProfileEvent(Profiler.Threads[0], CLIENT_FRAME_STAGE_DEFS[(size_t)Stage].Name, StartTicks, endTicks);
+		}
+	}
+};
+
+#define CLIENT_PROFILE_CONCAT_INNER(A, B) A##B
+#define CLIENT_PROFILE_CONCAT(A, B) CLIENT_PROFILE_CONCAT_INNER(A, B)
+
+// Times the rest of the enclosing scope as a zone of the given name, recorded on the given ClientProfilerThread.
+#define CLIENT_PROFILE_ZONE(Thread, Name) ClientProfileZone CLIENT_PROFILE_CONCAT(profileZone_, __LINE__)(Thread, Name)
+
+// Times the rest of the enclosing scope as the given ClientFrameStage of the current frame.
+#define CLIENT_PROFILE_STAGE(Profiler, Stage) ClientProfileStageZone CLIENT_PROFILE_CONCAT(profileStage_, __LINE__)(Profiler, Stage)
+
+#else
+
+#define CLIENT_PROFILE_ZONE(Thread, Name)
+#define CLIENT_PROFILE_STAGE(Profiler, Stage)
+
+#endif // CLIENT_PROFILER_ENABLED
+
+/*
+	Sets up the profiler, reserving its threads' rings from the given allocator. Recording starts right away.
+*/
+void InitializeClientProfiler(ClientProfiler& Profiler, MemoryAllocator& Allocator);
+
+/*
+	Returns the tick count a frame starts at, to pass to EndClientProfilerFrame.
+*/
+uint64_t BeginClientProfilerFrame(ClientProfiler& Profiler);
+
+/*
+	Records the frame as a zone, then compares the time each stage took over it to its budget.
+*/
+void EndClientProfilerFrame(ClientProfiler& Profiler, uint64_t FrameStartTicks);
+
+/*
+	Writes every event the rings still hold as a Chrome trace, along with the stages' durations and budgets. Returns whether it succeeded.
+*/
+bool ExportClientProfile(ClientProfiler& Profiler, const char* FilePath);
+
+#endif // CLIENT_PROFILER_INCLUDED
@@ -25,9 +25,12 @@ struct UIPartitionNode
 	// Dimensions of UI element rectangle bounds in screen units.
 	Vector2s Dimensions = {};
 
-	// Whether this element is being interacted with. Can only be true during the interaction pass.
+	// Whether this element is being interacted with. Set by the interaction pass' hit test, and kept until the next hit test.
 	bool bIsInteracted = false;
 
+	// Whether the absolute positions of this node's subtree must be recomputed from its own. See MarkUINodePositionsDirty.
+	bool bPositionsDirty = false;
+
 	// Pointer to a Presentation Definition for this node. If assigned will be used to output draw calls
 	// to represent the node's state.
 	UINodePresentationDef* PresentationDef = nullptr;
@@ -41,8 +44,27 @@ struct UIPartitionTree
 
 	// Allocator for the working memory assigned to the UI Tree. Child elements should allocate memory from it instead of the frame memory.
 	MemoryAllocator Memory;
+
+	// Set along with the positions of any node, cleared once positions were processed.
+	bool bPositionsDirty;
+
+	// Whether the interacted node must be found again, as positions moved since the last hit test.
+	bool bHitTestDirty;
+
+	// Node the last hit test found, whose bIsInteracted is set. Null while the cursor is out of the viewport.
+	UIPartitionNode* InteractedNode;
 };
 
+/*
+	Flags the absolute positions of the node's subtree for recomputing, along with the hit test depending on them.
+*/
+inline void MarkUINodePositionsDirty(UIPartitionTree& Tree, UIPartitionNode& Node)
+{
+	Node.bPositionsDirty = true;
+	Tree.bPositionsDirty = true;
+	Tree.bHitTestDirty = true;
+}
+
 /*
 	Goes down the tree and determines which element has been hit at the interaction position.
 */
@@ -12,6 +12,7 @@
 #include "SynergyClientAPI_Viewport.h"
 #include "SynergyClientAPI_Drawing.h"
 #include "SynergyClientAPI_Input.h"
+#include "SynergyClientAPI_InputCapture.h"
 
 #include <stdint.h>
 
@@ -31,6 +32,10 @@ struct ActionInputEventBuffer;
 // Type definition for Frame New Draw Call, requesting the creation of a drawcall in on the platform for the current frame.
 typedef DrawCall* (FrameNewDrawCallFunc)(ViewportID TargetViewportID, DrawCallType Type);
 
+// Type definition for Frame Submit Draw Commands, handing every draw call of the current frame over to the platform at once.
+// The list and the memory it points to are only valid during the call.
+typedef void (FrameSubmitDrawCommandsFunc)(const struct DrawCommandList& Commands);
+
 // Data associated with a request to run a single frame of the Client's execution, during which it should 
 // integrate the passage of time, react to inputs and output draw calls and audio samples.
 struct ClientFrameRequestData
@@ -58,6 +63,10 @@ struct ClientFrameRequestData
 	// If successful returns a pointer to a base DrawCall structure with the correct underlying data type according to the passed type.
 	// If it fails for any reason, returns nullptr.
 	FrameNewDrawCallFunc* NewDrawCall;
+
+	// Optional. Receives every draw call of the frame at once, batched, at the end of the frame. See DrawCommandList.
+	// When set, the Client uses it instead of NewDrawCall.
+	FrameSubmitDrawCommandsFunc* SubmitDrawCommands;
 };
 
 // Collection of platform functions that can be called from Client code.
@@ -107,6 +116,17 @@ struct SynergyClientAPI
 	// Shuts down the client cleanly.
 	void (*ShutdownClient)(ClientSessionData& Context) = nullptr;
 
+	// Optional. Writes the frames the client profiled as a Chrome trace to the given file, or a default one when null.
+	// Returns false if it failed, or the client was built without its profiler.
+	bool (*ExportClientFrameProfile)(ClientSessionData& Context, const char* FilePath) = nullptr;
+
+	// Optional. Starts capturing the inputs of every frame to the given file, or a default one when null, replacing any capture running.
+	// See SynergyClientAPI_InputCapture.h for the format. Returns false if the file couldn't be created.
+	bool (*StartInputCapture)(ClientSessionData& Context, const char* FilePath) = nullptr;
+
+	// Optional. Stops capturing inputs, flushing the capture to its file.
+	void (*StopInputCapture)(ClientSessionData& Context) = nullptr;
+
 	// Checks that all essential functions have been successfully loaded.
 	bool APISuccessfullyLoaded()
 	{
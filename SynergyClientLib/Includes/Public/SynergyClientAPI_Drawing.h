@@ -6,6 +6,7 @@
 #include <iostream>
 
 #include "SynergyCore.h"
+#include "SynergyClientAPI_Viewport.h"
 
 /*
 	Basic "inversed" RGBA color structure used by the Client to understand and express colors. The platform may need to translate it to its own format,
@@ -121,4 +122,68 @@ inline size_t GetDrawCallSize(DrawCallType CallType)
 	}
 }
 
+// DRAW COMMAND LISTS
+
+// Number of draw call types, which per type arrays are indexed with.
+constexpr size_t DRAW_CALL_TYPE_COUNT = (size_t)DrawCallType::INVALID;
+
+/*
+	Run of draw calls of the same type, on the same viewport and layer, which the platform can draw as a single instanced batch.
+*/
+struct DrawBatch
+{
+	ViewportID Viewport;
+	DrawCallType Type;
+
+	// Layers are drawn in increasing order.
+	uint16_t Layer;
+
+	// Calls of the batch, in the command list's array of its type.
+	uint32_t FirstCall;
+	uint32_t CallCount;
+};
+
+/*
+	Region of a viewport whose pixels may differ from the previous frame's, from Min to Max excluded. May extend past the viewport.
+*/
+struct DrawDamageRect
+{
+	ViewportID Viewport;
+	Vector2s Min;
+	Vector2s Max;
+};
+
+/*
+	Every draw call of a frame, handed to the platform at once.
+	Batches are sorted by viewport, then layer, then type, and are meant to be drawn in that order. Within a batch, calls keep the order
+	the Client made them in, so shapes overlapping in a batch draw the same as they would have one by one. Within a layer though, shapes
+	of different types aren't drawn in the order they were made.
+*/
+struct DrawCommandList
+{
+	const DrawBatch* Batches;
+	size_t BatchCount;
+
+	// Calls of every type, tightly packed in batch order. Calls[Type] points to CallCounts[Type] data structures of that type.
+	const void* Calls[DRAW_CALL_TYPE_COUNT];
+	size_t CallCounts[DRAW_CALL_TYPE_COUNT];
+
+	// Returns the calls of the batch, cast to the data structure of its type.
+	template<typename CallDataType>
+	const CallDataType* GetBatchCalls(const DrawBatch& Batch) const
+	{
+		return (const CallDataType*)Calls[(size_t)Batch.Type] + Batch.FirstCall;
+	}
+
+	/*
+		Regions where this frame's calls draw differently from the previous frame's. A platform that kept the previous frame's pixels only
+		needs to redraw those, with every call overlapping them, and present them. Rectangles may overlap.
+		When bFullDamage is set, as on the first frame, everything must be redrawn. A platform that lost or resized its surface must too.
+		Without either, the frame draws exactly as the previous one did.
+	*/
+	const DrawDamageRect* DamageRects;
+	size_t DamageRectCount;
+	bool bFullDamage;
+};
+
 #endif
\ No newline at end of file
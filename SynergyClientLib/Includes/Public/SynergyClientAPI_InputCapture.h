@@ -0,0 +1,218 @@
+// Defines the binary format of input captures: the inputs of every frame a Client ran, written by the Client and replayed by a host.
+
+#ifndef SYNERGY_CLIENT_INPUT_CAPTURE_INCLUDED
+#define SYNERGY_CLIENT_INPUT_CAPTURE_INCLUDED
+
+#include "SynergyClientAPI_Input.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+	A capture starts with a header, then holds one record per frame, all little endian:
+
+		Header   "SYNINPUT" then a u32 version and a u32 left at 0.
+		Frame    varint   Frame number minus the previous frame's plus one, so 0 for consecutive frames.
+		         u32      Frame time, as the bits of the float.
+		         s16 s16  Cursor location.
+		         u8       Cursor viewport.
+		         varint   Event count, then each event:
+		Event    u32      Normalized time, as the bits of the float.
+		         u8       Viewport.
+		         s16 s16  Cursor location.
+		         u8       Modifiers bitmask.
+		         u8       Key, with the release flag in its high bit.
+
+	Floats are kept as their bits so a replay hands the Client the exact values it got. A frame without events takes 11 bytes.
+*/
+
+constexpr char INPUT_CAPTURE_MAGIC[8] = { 'S', 'Y', 'N', 'I', 'N', 'P', 'U', 'T' };
+constexpr uint32_t INPUT_CAPTURE_VERSION = 1;
+constexpr size_t INPUT_CAPTURE_HEADER_SIZE = 16;
+
+// Largest encoded frame record without its events, and largest encoded event.
+constexpr size_t INPUT_CAPTURE_MAX_FRAME_SIZE = 10 + 4 + 4 + 1 + 10;
+constexpr size_t INPUT_CAPTURE_EVENT_SIZE = 11;
+
+static_assert((size_t)ActionKey::ACTION_KEY_COUNT <= 0x80, "Captured keys leave their high bit to the release flag.");
+
+// Inputs of one captured frame. Events point into the capture's memory.
+struct CapturedFrameInputs
+{
+	size_t FrameNumber;
+	float FrameTime;
+	Vector2s CursorLocation;
+	ViewportID CursorViewport;
+
+	const uint8_t* EncodedEvents;
+	size_t EventCount;
+};
+
+inline uint8_t* WriteCaptureVarint(uint8_t* Out, uint64_t Value)
+{
+	while (Value >= 0x80)
+	{
+		*Out++ = (uint8_t)(Value | 0x80);
+		Value >>= 7;
+	}
+	*Out++ = (uint8_t)Value;
+	return Out;
+}
+
+inline uint8_t* WriteCaptureU32(uint8_t* Out, uint32_t Value)
+{
+	for (int byteIndex = 0; byteIndex < 4; byteIndex++) *Out++ = (uint8_t)(Value >> (8 * byteIndex));
+	return Out;
+}
+
+inline uint8_t* WriteCaptureS16(uint8_t* Out, int16_t Value)
+{
+	*Out++ = (uint8_t)((uint16_t)Value);
+	*Out++ = (uint8_t)((uint16_t)Value >> 8);
+	return Out;
+}
+
+inline uint32_t GetCaptureFloatBits(float Value)
+{
+	uint32_t bits;
+	memcpy(&bits, &Value, sizeof(bits));
+	return bits;
+}
+
+inline void WriteInputCaptureHeader(uint8_t* Out)
+{
+	memcpy(Out, INPUT_CAPTURE_MAGIC, sizeof(INPUT_CAPTURE_MAGIC));
+	WriteCaptureU32(WriteCaptureU32(Out + sizeof(INPUT_CAPTURE_MAGIC), INPUT_CAPTURE_VERSION), 0);
+}
+
+/*
+	Encodes the frame record without its events, given the number of the previous frame captured, or ~0 for the first one.
+	Returns the end of what was written, at most INPUT_CAPTURE_MAX_FRAME_SIZE bytes.
+*/
+inline uint8_t* EncodeCapturedFrame(uint8_t* Out, size_t PreviousFrameNumber, size_t FrameNumber, float FrameTime, Vector2s CursorLocation,
+	ViewportID CursorViewport, size_t EventCount)
+{
+	Out = WriteCaptureVarint(Out, (uint64_t)(FrameNumber - (PreviousFrameNumber + 1)));
+	Out = WriteCaptureU32(Out, GetCaptureFloatBits(FrameTime));
+	Out = WriteCaptureS16(Out, CursorLocation.x);
+	Out = WriteCaptureS16(Out, CursorLocation.y);
+	*Out++ = CursorViewport;
+	return WriteCaptureVarint(Out, EventCount);
+}
+
+// Encodes an event in INPUT_CAPTURE_EVENT_SIZE bytes.
+inline uint8_t* EncodeCapturedEvent(uint8_t* Out, const ActionInputEvent& Event)
+{
+	Out = WriteCaptureU32(Out, GetCaptureFloatBits(Event.timeNormalized));
+	*Out++ = Event.viewport;
+	Out = WriteCaptureS16(Out, Event.cursorLocation.x);
+	Out = WriteCaptureS16(Out, Event.cursorLocation.y);
+	*Out++ = Event.modifiers.modifiersBitmask;
+	*Out++ = (uint8_t)Event.key | (Event.bRelease ? 0x80 : 0);
+	return Out;
+}
+
+// Reads captures, frame by frame, out of memory holding the whole file.
+struct InputCaptureReader
+{
+	const uint8_t* Position = nullptr;
+	const uint8_t* End = nullptr;
+	size_t PreviousFrameNumber = ~(size_t)0;
+
+	// Returns false if the memory doesn't start with a capture header this version can read.
+	bool Open(const uint8_t* Data, size_t Size)
+	{
+		if (Size < INPUT_CAPTURE_HEADER_SIZE || memcmp(Data, INPUT_CAPTURE_MAGIC, sizeof(INPUT_CAPTURE_MAGIC)) != 0)
+		{
+			return false;
+		}
+		Position = Data + sizeof(INPUT_CAPTURE_MAGIC);
+		End = Data + Size;
+		PreviousFrameNumber = ~(size_t)0;
+		return ReadU32() == INPUT_CAPTURE_VERSION && ReadU32() == 0;
+	}
+
+	/*
+		Reads the next frame. Returns false at the end of the capture, including when its last frame was cut short, as happens to captures
+		of a Client that didn't shut down.
+	*/
+	bool ReadFrame(CapturedFrameInputs& OutFrame)
+	{
+		uint64_t frameDelta = 0;
+		uint64_t eventCount = 0;
+		if (!ReadVarint(frameDelta) || End - Position < 9)
+		{
+			Position = End;
+			return false;
+		}
+
+		OutFrame.FrameNumber = (size_t)(PreviousFrameNumber + 1 + frameDelta);
+		const uint32_t frameTimeBits = ReadU32();
+		memcpy(&OutFrame.FrameTime, &frameTimeBits, sizeof(float));
+		OutFrame.CursorLocation.x = ReadS16();
+		OutFrame.CursorLocation.y = ReadS16();
+		OutFrame.CursorViewport = *Position++;
+
+		if (!ReadVarint(eventCount) || eventCount > (uint64_t)(End - Position) / INPUT_CAPTURE_EVENT_SIZE)
+		{
+			Position = End;
+			return false;
+		}
+		OutFrame.EncodedEvents = Position;
+		OutFrame.EventCount = (size_t)eventCount;
+		Position += eventCount * INPUT_CAPTURE_EVENT_SIZE;
+		PreviousFrameNumber = OutFrame.FrameNumber;
+		return true;
+	}
+
+	// Decodes the event at the given index of a frame read.
+	static ActionInputEvent DecodeEvent(const CapturedFrameInputs& Frame, size_t EventIndex)
+	{
+		InputCaptureReader eventReader;
+		eventReader.Position = Frame.EncodedEvents + EventIndex * INPUT_CAPTURE_EVENT_SIZE;
+		eventReader.End = eventReader.Position + INPUT_CAPTURE_EVENT_SIZE;
+
+		ActionInputEvent event = {};
+		const uint32_t timeBits = eventReader.ReadU32();
+		memcpy(&event.timeNormalized, &timeBits, sizeof(float));
+		event.viewport = *eventReader.Position++;
+		event.cursorLocation.x = eventReader.ReadS16();
+		event.cursorLocation.y = eventReader.ReadS16();
+		event.modifiers.modifiersBitmask = *eventReader.Position++;
+		const uint8_t keyByte = *eventReader.Position++;
+		event.key = (ActionKey)(keyByte & 0x7F);
+		event.bRelease = (keyByte & 0x80) != 0;
+		return event;
+	}
+
+	uint32_t ReadU32()
+	{
+		uint32_t value = 0;
+		for (int byteIndex = 0; byteIndex < 4; byteIndex++) value |= (uint32_t)*Position++ << (8 * byteIndex);
+		return value;
+	}
+
+	int16_t ReadS16()
+	{
+		const uint16_t value = (uint16_t)(Position[0] | (Position[1] << 8));
+		Position += 2;
+		return (int16_t)value;
+	}
+
+	bool ReadVarint(uint64_t& OutValue)
+	{
+		OutValue = 0;
+		for (int shift = 0; shift < 64 && Position < End; shift += 7)
+		{
+			const uint8_t byte = *Position++;
+			OutValue |= (uint64_t)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+#endif // SYNERGY_CLIENT_INPUT_CAPTURE_INCLUDED
@@ -0,0 +1,404 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Client's draw command buffer: recording draw calls over the frame, then batching them for the platform.
+
+#include "Client.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+/*
+	HOW IT WORKS
+
+	Recording a call appends its data to the buffer, packed without slots, along with a 64 bit sort key:
+
+		bits 56-63   Viewport
+		bits 40-55   Layer
+		bits 32-39   Type
+		bits  0-31   Index of the call
+
+	Sorting the keys puts calls of the same viewport, layer and type next to each other, in the order they were made thanks to the index.
+	Submitting walks the sorted keys once: every change of viewport, layer or type starts a new batch, and calls get copied into the array
+	of their type so that every batch's calls are contiguous, which lets the platform upload and draw them as one instanced batch.
+
+	Damage is found by diffing the frame's calls, in batch order, with the previous frame's, each call being known by a hash of its data,
+	viewport and layer, and by conservative bounds of the pixels it may touch. Every call is matched with the earliest previous call of the
+	same hash left unmatched. A pixel draws the same as in the previous frame when the calls covering it are the same and in the same
+	order, so damage covers:
+	- The bounds of calls without a match, on both sides: those that appeared, disappeared or changed.
+	- The bounds of matched calls, on both sides, whose match comes before that of an earlier call: those drawn in another order.
+	Damage rectangles touching are merged on the way, and past CLIENT_DRAW_DAMAGE_MAX_RECT_COUNT new ones get merged into the rectangle of
+	their viewport they grow the least.
+*/
+
+static_assert(sizeof(LineDrawCallData) <= CLIENT_DRAW_CALL_MAX_SIZE && sizeof(RectangleDrawCallData) <= CLIENT_DRAW_CALL_MAX_SIZE
+	&& sizeof(EllipseDrawCallData) <= CLIENT_DRAW_CALL_MAX_SIZE, "CLIENT_DRAW_CALL_MAX_SIZE must fit every draw call type.");
+static_assert(sizeof(LineDrawCallData) % alignof(DrawCall) == 0 && sizeof(RectangleDrawCallData) % alignof(DrawCall) == 0
+	&& sizeof(EllipseDrawCallData) % alignof(DrawCall) == 0 && sizeof(BitmapDrawCallData) % alignof(DrawCall) == 0,
+	"Packed draw calls rely on every type's size keeping the next one aligned.");
+static_assert(DRAW_CALL_TYPE_COUNT <= 0x100, "Draw call types must fit in 8 bits of a sort key.");
+
+constexpr uint64_t DRAW_KEY_GROUP_SHIFT = 32;
+
+static uint64_t MakeDrawCommandKey(ViewportID Viewport, uint16_t Layer, DrawCallType Type, size_t CallIndex)
+{
+	return ((uint64_t)Viewport << 56) | ((uint64_t)Layer << 40) | ((uint64_t)Type << DRAW_KEY_GROUP_SHIFT) | (uint32_t)CallIndex;
+}
+
+// Draw call structures only hold 16 and 32 bit members, but stack allocations come out with whatever alignment the previous ones left.
+static void* AllocateDrawMemory(MemoryAllocator& Allocator, size_t Size)
+{
+	const uintptr_t address = (uintptr_t)Allocator.Allocate(Size + 7);
+	return (void*)((address + 7) & ~(uintptr_t)7);
+}
+
+void InitializeDrawCommandBuffer(ClientDrawCommandBuffer& Buffer, MemoryAllocator& FrameMemory, size_t MaxCallCount)
+{
+	Buffer.CallData = (uint8_t*)AllocateDrawMemory(FrameMemory, MaxCallCount * CLIENT_DRAW_CALL_MAX_SIZE);
+	Buffer.CallDataSize = 0;
+	Buffer.Keys = (uint64_t*)AllocateDrawMemory(FrameMemory, MaxCallCount * sizeof(uint64_t));
+	Buffer.CallOffsets = (uint32_t*)AllocateDrawMemory(FrameMemory, MaxCallCount * sizeof(uint32_t));
+	Buffer.CallCount = 0;
+	Buffer.CallCapacity = MaxCallCount;
+	Buffer.DroppedCount = 0;
+}
+
+DrawCall* NewDrawCommand(ClientDrawCommandBuffer& Buffer, ViewportID Viewport, uint16_t Layer, DrawCallType Type)
+{
+	const size_t callSize = GetDrawCallSize(Type);
+
+	uint8_t* callData = Buffer.DiscardSlot;
+	if (Buffer.CallCount < Buffer.CallCapacity && callSize > 0)
+	{
+		callData = Buffer.CallData + Buffer.CallDataSize;
+		Buffer.Keys[Buffer.CallCount] = MakeDrawCommandKey(Viewport, Layer, Type, Buffer.CallCount);
+		Buffer.CallOffsets[Buffer.CallCount] = (uint32_t)Buffer.CallDataSize;
+		Buffer.CallDataSize += callSize;
+		Buffer.CallCount++;
+	}
+	else
+	{
+		Buffer.DroppedCount++;
+	}
+
+	memset(callData, 0, callSize > 0 ? callSize : CLIENT_DRAW_CALL_MAX_SIZE);
+	DrawCall* drawCall = (DrawCall*)callData;
+	drawCall->type = Type;
+	return drawCall;
+}
+
+// DAMAGE TRACKING
+
+void InitializeDrawDamageTracker(ClientDrawDamageTracker& Tracker, MemoryAllocator& PersistentMemory, size_t MaxCallCount)
+{
+	Tracker.PreviousCalls = (ClientDrawDamageEntry*)AllocateDrawMemory(PersistentMemory, MaxCallCount * sizeof(ClientDrawDamageEntry));
+	Tracker.PreviousCallCount = 0;
+	Tracker.Capacity = MaxCallCount;
+	Tracker.bHasPrevious = false;
+}
+
+static int16_t ClampDamageCoordinate(int32_t Coordinate)
+{
+	return (int16_t)(Coordinate < INT16_MIN ? INT16_MIN : (Coordinate > INT16_MAX ? INT16_MAX : Coordinate));
+}
+
+/*
+	Bounds of the pixels a call may touch, grown by a pixel on every side for platforms smoothing edges. Rotated shapes are bounded by the
+	circle they turn in, as platforms may not agree on rounding rotations.
+*/
+static DrawDamageRect GetDrawCallDamageBounds(const DrawCall& Call, ViewportID Viewport)
+{
+	const bool bRotated = Call.angleDeg % 360 != 0;
+	const int32_t originX = Call.origin.x;
+	const int32_t originY = Call.origin.y;
+	int32_t minX = originX, minY = originY, maxX = originX, maxY = originY;
+
+	switch (Call.type)
+	{
+	case DrawCallType::RECTANGLE:
+	case DrawCallType::BITMAP:
+	{
+		const RectangleDrawCallData& rectangle = (const RectangleDrawCallData&)Call;
+		if (bRotated)
+		{
+			const int32_t radius = (int32_t)ceilf(sqrtf((float)rectangle.dimensions.x * rectangle.dimensions.x
+				+ (float)rectangle.dimensions.y * rectangle.dimensions.y));
+			minX = originX - radius; minY = originY - radius; maxX = originX + radius; maxY = originY + radius;
+		}
+		else
+		{
+			minX = std::min(originX, originX + rectangle.dimensions.x); maxX = std::max(originX, originX + rectangle.dimensions.x);
+			minY = std::min(originY, originY + rectangle.dimensions.y); maxY = std::max(originY, originY + rectangle.dimensions.y);
+		}
+		break;
+	}
+	case DrawCallType::LINE:
+	{
+		const LineDrawCallData& line = (const LineDrawCallData&)Call;
+		const int32_t halfWidth = line.width / 2 + 1;
+		if (bRotated)
+		{
+			const float deltaX = (float)line.destination.x - originX;
+			const float deltaY = (float)line.destination.y - originY;
+			const int32_t radius = (int32_t)ceilf(sqrtf(deltaX * deltaX + deltaY * deltaY)) + halfWidth;
+			minX = originX - radius; minY = originY - radius; maxX = originX + radius; maxY = originY + radius;
+		}
+		else
+		{
+			minX = std::min<int32_t>(originX, line.destination.x) - halfWidth; maxX = std::max<int32_t>(originX, line.destination.x) + halfWidth;
+			minY = std::min<int32_t>(originY, line.destination.y) - halfWidth; maxY = std::max<int32_t>(originY, line.destination.y) + halfWidth;
+		}
+		break;
+	}
+	case DrawCallType::ELLIPSE:
+	{
+		const EllipseDrawCallData& ellipse = (const EllipseDrawCallData&)Call;
+		int32_t radiusX = std::abs((int32_t)ellipse.ellipticRadii.x);
+		int32_t radiusY = ellipse.ellipticRadii.y == 0 ? radiusX : std::abs((int32_t)ellipse.ellipticRadii.y);
+		if (bRotated)
+		{
+			radiusX = radiusY = std::max(radiusX, radiusY);
+		}
+		minX = originX - radiusX; minY = originY - radiusY; maxX = originX + radiusX; maxY = originY + radiusY;
+		break;
+	}
+	default:
+		break;
+	}
+
+	return { Viewport, Vector2s { ClampDamageCoordinate(minX - 1), ClampDamageCoordinate(minY - 1) },
+		Vector2s { ClampDamageCoordinate(maxX + 1), ClampDamageCoordinate(maxY + 1) } };
+}
+
+static int64_t GetDamageRectArea(const DrawDamageRect& Rect)
+{
+	return (int64_t)(Rect.Max.x - Rect.Min.x) * (Rect.Max.y - Rect.Min.y);
+}
+
+static DrawDamageRect GetDamageRectUnion(const DrawDamageRect& A, const DrawDamageRect& B)
+{
+	return { A.Viewport, Vector2s { std::min(A.Min.x, B.Min.x), std::min(A.Min.y, B.Min.y) },
+		Vector2s { std::max(A.Max.x, B.Max.x), std::max(A.Max.y, B.Max.y) } };
+}
+
+/*
+	Adds the rectangle to the damage, merging it into one of its viewport it touches, or once rectangles run out, the one it grows the least.
+	Returns false if rectangles ran out and none was of its viewport, the damage then being lost.
+*/
+static bool AddDamageRect(DrawDamageRect* Rects, size_t& RectCount, const DrawDamageRect& Rect)
+{
+	if (Rect.Min.x >= Rect.Max.x || Rect.Min.y >= Rect.Max.y)
+	{
+		return true;
+	}
+
+	size_t bestRectIndex = RectCount;
+	int64_t bestGrowth = INT64_MAX;
+	for (size_t rectIndex = 0; rectIndex < RectCount; rectIndex++)
+	{
+		DrawDamageRect& other = Rects[rectIndex];
+		if (other.Viewport != Rect.Viewport)
+		{
+			continue;
+		}
+		if (Rect.Min.x <= other.Max.x && other.Min.x <= Rect.Max.x && Rect.Min.y <= other.Max.y && other.Min.y <= Rect.Max.y)
+		{
+			other = GetDamageRectUnion(other, Rect);
+			return true;
+		}
+
+		const int64_t growth = GetDamageRectArea(GetDamageRectUnion(other, Rect)) - GetDamageRectArea(other);
+		if (growth < bestGrowth)
+		{
+			bestGrowth = growth;
+			bestRectIndex = rectIndex;
+		}
+	}
+
+	if (RectCount < CLIENT_DRAW_DAMAGE_MAX_RECT_COUNT)
+	{
+		Rects[RectCount++] = Rect;
+		return true;
+	}
+	if (bestRectIndex == RectCount)
+	{
+		return false;
+	}
+	Rects[bestRectIndex] = GetDamageRectUnion(Rects[bestRectIndex], Rect);
+	return true;
+}
+
+// Previous call of a given hash, sorted by hash then index to find the earliest previous call of a hash.
+struct DrawDamageMatch
+{
+	uint64_t Hash;
+	uint32_t Index;
+
+	bool operator<(const DrawDamageMatch& Other) const { return Hash != Other.Hash ? Hash < Other.Hash : Index < Other.Index; }
+};
+
+/*
+	Fills the list's damage in by diffing the buffer's sorted calls with the previous frame's, then remembers the buffer's calls.
+*/
+static void TrackDrawDamage(const ClientDrawCommandBuffer& Buffer, MemoryAllocator& FrameMemory, ClientDrawDamageTracker& Tracker,
+	DrawCommandList& OutList)
+{
+	const size_t callCount = Buffer.CallCount;
+	ClientDrawDamageEntry* calls = (ClientDrawDamageEntry*)AllocateDrawMemory(FrameMemory, callCount * sizeof(ClientDrawDamageEntry));
+	for (size_t keyIndex = 0; keyIndex < callCount; keyIndex++)
+	{
+		const uint64_t key = Buffer.Keys[keyIndex];
+		const DrawCall& call = *(const DrawCall*)(Buffer.CallData + Buffer.CallOffsets[(uint32_t)key]);
+		const ViewportID viewport = (ViewportID)(key >> 56);
+
+		// FNV-1a over the call's data, then its viewport and layer.
+		uint64_t hash = 14695981039346656037ull;
+		const uint8_t* callBytes = (const uint8_t*)&call;
+		for (size_t byteIndex = 0; byteIndex < GetDrawCallSize(call.type); byteIndex++)
+		{
+			hash = (hash ^ callBytes[byteIndex]) * 1099511628211ull;
+		}
+		hash = (hash ^ (key >> DRAW_KEY_GROUP_SHIFT)) * 1099511628211ull;
+
+		calls[keyIndex] = { hash, GetDrawCallDamageBounds(call, viewport) };
+	}
+
+	DrawDamageRect* rects = (DrawDamageRect*)AllocateDrawMemory(FrameMemory, CLIENT_DRAW_DAMAGE_MAX_RECT_COUNT * sizeof(DrawDamageRect));
+	size_t rectCount = 0;
+	bool bFullDamage = !Tracker.bHasPrevious;
+	if (!bFullDamage)
+	{
+		const size_t previousCount = Tracker.PreviousCallCount;
+		DrawDamageMatch* matches = (DrawDamageMatch*)AllocateDrawMemory(FrameMemory, previousCount * sizeof(DrawDamageMatch));
+		uint32_t* hashTakenCounts = (uint32_t*)AllocateDrawMemory(FrameMemory, previousCount * sizeof(uint32_t));
+		bool* bPreviousMatched = (bool*)AllocateDrawMemory(FrameMemory, previousCount * sizeof(bool));
+		for (size_t previousIndex = 0; previousIndex < previousCount; previousIndex++)
+		{
+			matches[previousIndex] = { Tracker.PreviousCalls[previousIndex].Hash, (uint32_t)previousIndex };
+			hashTakenCounts[previousIndex] = 0;
+			bPreviousMatched[previousIndex] = false;
+		}
+		std::sort(matches, matches + previousCount);
+
+		// Matched calls keep their damage out only as long as their matches come in increasing order.
+		int64_t lastMatchIndex = -1;
+		for (size_t callIndex = 0; callIndex < callCount && !bFullDamage; callIndex++)
+		{
+			const uint64_t hash = calls[callIndex].Hash;
+			const DrawDamageMatch* hashStart = std::lower_bound(matches, matches + previousCount, DrawDamageMatch { hash, 0 });
+			const size_t hashStartIndex = hashStart - matches;
+			const size_t matchIndex = hashStartIndex + (hashStartIndex < previousCount ? hashTakenCounts[hashStartIndex] : 0);
+			if (matchIndex < previousCount && matches[matchIndex].Hash == hash)
+			{
+				hashTakenCounts[hashStartIndex]++;
+				const uint32_t previousIndex = matches[matchIndex].Index;
+				bPreviousMatched[previousIndex] = true;
+				if ((int64_t)previousIndex > lastMatchIndex)
+				{
+					lastMatchIndex = previousIndex;
+					continue;
+				}
+				bFullDamage |= !AddDamageRect(rects, rectCount, Tracker.PreviousCalls[previousIndex].Bounds);
+			}
+			bFullDamage |= !AddDamageRect(rects, rectCount, calls[callIndex].Bounds);
+		}
+
+		for (size_t previousIndex = 0; previousIndex < previousCount && !bFullDamage; previousIndex++)
+		{
+			if (!bPreviousMatched[previousIndex])
+			{
+				bFullDamage |= !AddDamageRect(rects, rectCount, Tracker.PreviousCalls[previousIndex].Bounds);
+			}
+		}
+	}
+
+	OutList.DamageRects = rects;
+	OutList.DamageRectCount = bFullDamage ? 0 : rectCount;
+	OutList.bFullDamage = bFullDamage;
+
+	Tracker.bHasPrevious = callCount <= Tracker.Capacity;
+	Tracker.PreviousCallCount = Tracker.bHasPrevious ? callCount : 0;
+	memcpy(Tracker.PreviousCalls, calls, Tracker.PreviousCallCount * sizeof(ClientDrawDamageEntry));
+}
+
+// SUBMISSION
+
+void SubmitDrawCommands(ClientDrawCommandBuffer& Buffer, MemoryAllocator& FrameMemory, ClientDrawDamageTracker& Damage,
+	FrameSubmitDrawCommandsFunc* SubmitDrawCommands, FrameNewDrawCallFunc* NewDrawCall)
+{
+	std::sort(Buffer.Keys, Buffer.Keys + Buffer.CallCount);
+
+	// Without the platform taking lists, calls go through one by one in batch order, and there is no damage to tell it about.
+	if (SubmitDrawCommands == nullptr)
+	{
+		Damage.bHasPrevious = false;
+		for (size_t keyIndex = 0; NewDrawCall != nullptr && keyIndex < Buffer.CallCount; keyIndex++)
+		{
+			const uint64_t key = Buffer.Keys[keyIndex];
+			const DrawCallType type = (DrawCallType)((key >> DRAW_KEY_GROUP_SHIFT) & 0xFF);
+			DrawCall* platformCall = NewDrawCall((ViewportID)(key >> 56), type);
+			if (platformCall != nullptr)
+			{
+				memcpy(platformCall, Buffer.CallData + Buffer.CallOffsets[(uint32_t)key], GetDrawCallSize(type));
+			}
+		}
+		Buffer.CallCount = 0;
+		Buffer.CallDataSize = 0;
+		return;
+	}
+
+	// Count batches and the calls of every type, to lay out the list.
+	DrawCommandList list = {};
+	for (size_t keyIndex = 0; keyIndex < Buffer.CallCount; keyIndex++)
+	{
+		const uint64_t key = Buffer.Keys[keyIndex];
+		if (keyIndex == 0 || (key >> DRAW_KEY_GROUP_SHIFT) != (Buffer.Keys[keyIndex - 1] >> DRAW_KEY_GROUP_SHIFT))
+		{
+			list.BatchCount++;
+		}
+		list.CallCounts[(key >> DRAW_KEY_GROUP_SHIFT) & 0xFF]++;
+	}
+
+	DrawBatch* batches = (DrawBatch*)AllocateDrawMemory(FrameMemory, list.BatchCount * sizeof(DrawBatch));
+	uint8_t* typeCalls[DRAW_CALL_TYPE_COUNT] = {};
+	size_t typeCallCounts[DRAW_CALL_TYPE_COUNT] = {};
+	for (size_t typeIndex = 0; typeIndex < DRAW_CALL_TYPE_COUNT; typeIndex++)
+	{
+		if (list.CallCounts[typeIndex] > 0)
+		{
+			typeCalls[typeIndex] = (uint8_t*)AllocateDrawMemory(FrameMemory, list.CallCounts[typeIndex] * GetDrawCallSize((DrawCallType)typeIndex));
+			list.Calls[typeIndex] = typeCalls[typeIndex];
+		}
+	}
+
+	// Fill batches in, copying calls next to the previous ones of their type.
+	size_t batchIndex = 0;
+	for (size_t keyIndex = 0; keyIndex < Buffer.CallCount; keyIndex++)
+	{
+		const uint64_t key = Buffer.Keys[keyIndex];
+		const size_t typeIndex = (key >> DRAW_KEY_GROUP_SHIFT) & 0xFF;
+		const size_t callSize = GetDrawCallSize((DrawCallType)typeIndex);
+
+		if (keyIndex == 0 || (key >> DRAW_KEY_GROUP_SHIFT) != (Buffer.Keys[keyIndex - 1] >> DRAW_KEY_GROUP_SHIFT))
+		{
+			DrawBatch& batch = batches[batchIndex++];
+			batch.Viewport = (ViewportID)(key >> 56);
+			batch.Type = (DrawCallType)typeIndex;
+			batch.Layer = (uint16_t)(key >> 40);
+			batch.FirstCall = (uint32_t)typeCallCounts[typeIndex];
+			batch.CallCount = 0;
+		}
+		batches[batchIndex - 1].CallCount++;
+
+		memcpy(typeCalls[typeIndex] + typeCallCounts[typeIndex] * callSize, Buffer.CallData + Buffer.CallOffsets[(uint32_t)key], callSize);
+		typeCallCounts[typeIndex]++;
+	}
+
+	list.Batches = batches;
+	TrackDrawDamage(Buffer, FrameMemory, Damage, list);
+	SubmitDrawCommands(list);
+
+	Buffer.CallCount = 0;
+	Buffer.CallDataSize = 0;
+}
@@ -19,28 +19,28 @@ int DEBUG_GetUITreeDepth_Recursive(const UIPartitionNode& Node)
 	return 1 + maxChildDepth;
 }
 
-void DEBUG_DrawUINode_Recursive(ViewportID Viewport, ClientFrameState& Frame, const UIPartitionNode& Node, float ColorPerDepth, int DepthLevel)
+void DEBUG_DrawUINode_Recursive(const ClientDrawTarget& Target, const UIPartitionNode& Node, float ColorPerDepth, int DepthLevel)
 {
 	// Output a rectangular draw call with the given color per depth multiplied by depth level, then recursively call on children.
 	
 	uint16_t colorIntensity = (uint8_t)(ColorPerDepth * DepthLevel);
 	
-	RectangleDrawCallData* nodeRect = (RectangleDrawCallData*)Frame.FramePlatformAPI.NewDrawCall(Viewport, DrawCallType::RECTANGLE);
+	RectangleDrawCallData* nodeRect = (RectangleDrawCallData*)NewDrawCommand(Target, DrawCallType::RECTANGLE);
 	nodeRect->dimensions = Node.Dimensions;
 	nodeRect->origin = Node.AbsolutePosition;
 	nodeRect->color = Node.bIsInteracted ? GetColorWithIntensity(COLOR_Green, colorIntensity) : GetColorWithIntensity(COLOR_White, colorIntensity);
 	for (int childIndex = 0; childIndex < Node.ChildCount; childIndex++)
 	{
-		DEBUG_DrawUINode_Recursive(Viewport, Frame, Node.Children[childIndex], ColorPerDepth, DepthLevel + 1);
+		DEBUG_DrawUINode_Recursive(Target, Node.Children[childIndex], ColorPerDepth, DepthLevel + 1);
 	}
 }
 
 /*
 	Draws a debug view of the UI's partition tree along with the "path" to the current pointed element if any. 
 */
-void DEBUG_DrawUIPartitionInteraction(ViewportID Viewport, ClientFrameState& Frame)
+void DEBUG_DrawUIPartitionInteraction(ViewportID Viewport, ClientFrameState& Frame, const UIPartitionTree& Tree)
 {
-	if (Frame.MainViewportUITree.RootNode == nullptr)
+	if (Tree.RootNode == nullptr)
 	{
 		// UI Partition Tree doesn't exist.
 		return;
@@ -49,28 +49,30 @@ void DEBUG_DrawUIPartitionInteraction(ViewportID Viewport, ClientFrameState& Fra
 	// Go down the tree, drawing elements as rectangles getting whiter and whiter with each level.
 	// If the element is interacted with, give it a green hue.
 
-	int treeDepth = DEBUG_GetUITreeDepth_Recursive(*Frame.MainViewportUITree.RootNode);
+	int treeDepth = DEBUG_GetUITreeDepth_Recursive(*Tree.RootNode);
 
 	float colorPerDepthLevel = 255.f / treeDepth;
 
-	DEBUG_DrawUINode_Recursive(Viewport, Frame, *Frame.MainViewportUITree.RootNode, colorPerDepthLevel, 1);
+	// Drawn on its own layer, over the UI.
+	const ClientDrawTarget target = { &Frame.DrawCommands, Viewport, CLIENT_DRAW_LAYER_DEBUG };
+	DEBUG_DrawUINode_Recursive(target, *Tree.RootNode, colorPerDepthLevel, 1);
 }
 
 /*
-	Triggers the Node to call on its assigned Presentation Definition to output drawcalls using the passed NewDrawCall function.
+	Triggers the Node to call on its assigned Presentation Definition to output drawcalls to the passed Draw Target.
 	Called recursively on the node's children, depth-first, meaning intersecting nodes will have visual precedence depending on who is higher
-	in the tree and drawn later.
+	in the tree and drawn later. The whole tree is drawn on the same layer so batching keeps that order.
 */
-void DrawUINode_Recursive(UIPartitionNode& Node, FrameNewDrawCallFunc& NewDrawCall, ViewportID TargetViewport)
+void DrawUINode_Recursive(UIPartitionNode& Node, const ClientDrawTarget& Target)
 {
 	if (Node.PresentationDef != nullptr)
 	{
-		Node.PresentationDef->DrawNode(Node, NewDrawCall, TargetViewport);
+		Node.PresentationDef->DrawNode(Node, Target);
 	}
 
 	for (int childIndex = 0; childIndex < Node.ChildCount; childIndex++)
 	{
-		DrawUINode_Recursive(Node.Children[childIndex], NewDrawCall, TargetViewport);
+		DrawUINode_Recursive(Node.Children[childIndex], Target);
 	}
 }
 
@@ -79,32 +81,38 @@ void DrawUINode_Recursive(UIPartitionNode& Node, FrameNewDrawCallFunc& NewDrawCa
 */
 void DrawUI(ClientFrameState& Frame, UIPartitionTree& Tree, ViewportID TargetViewport)
 {
-	DrawUINode_Recursive(*Tree.RootNode, *Frame.FramePlatformAPI.NewDrawCall, TargetViewport);
+	const ClientDrawTarget target = { &Frame.DrawCommands, TargetViewport, CLIENT_DRAW_LAYER_UI };
+	DrawUINode_Recursive(*Tree.RootNode, target);
 }
 
 void OutputDrawCalls(ClientSessionState& Client, ClientFrameState& Frame)
 {
-	if (Frame.FramePlatformAPI.NewDrawCall == nullptr)
+	if (Frame.FramePlatformAPI.NewDrawCall == nullptr && Frame.FramePlatformAPI.SubmitDrawCommands == nullptr)
 	{
 		// Drawing not supported.
 		return;
 	}
 
-	DrawUI(Frame, Frame.MainViewportUITree, Client.MainViewport.ID);
+	InitializeDrawCommandBuffer(Frame.DrawCommands, Frame.FrameMemoryAllocator, CLIENT_DRAW_COMMAND_MAX_COUNT);
+
+	DrawUI(Frame, Client.MainViewportUITree, Client.MainViewport.ID);
 
 	if (Client.bDrawUIDebug)
 	{
 		// Draw debug UI view.
-		DEBUG_DrawUIPartitionInteraction(Client.MainViewport.ID, Frame);
+		DEBUG_DrawUIPartitionInteraction(Client.MainViewport.ID, Frame, Client.MainViewportUITree);
 	}
+
+	// Hand the whole frame's draw calls over to the platform in one go.
+	SubmitDrawCommands(Frame.DrawCommands, Frame.FrameMemoryAllocator, Client.DrawDamage, Frame.FramePlatformAPI.SubmitDrawCommands,
+		Frame.FramePlatformAPI.NewDrawCall);
 }
 
 // UI NODE DRAWING FUNCTIONS IMPLEMENTATION
 
 // Simple Rectangle.
 void UINodePresentationDrawFunc_Rectangle(	const UIPartitionNode& Node,
-	 										FrameNewDrawCallFunc& NewDrawCall,
-											ViewportID TargetViewport,
+											const ClientDrawTarget& Target,
 											const UINodePresentationDef* PresentationDef)
 {
 	if (PresentationDef == nullptr)
@@ -115,7 +123,7 @@ void UINodePresentationDrawFunc_Rectangle(	const UIPartitionNode& Node,
 
 	const UINodePresentationDef_Rectangle* rectanglePresentationDef = (const UINodePresentationDef_Rectangle*)PresentationDef;
 
-	RectangleDrawCallData* rectDrawCall = (RectangleDrawCallData*)NewDrawCall(TargetViewport, DrawCallType::RECTANGLE);
+	RectangleDrawCallData* rectDrawCall = (RectangleDrawCallData*)NewDrawCommand(Target, DrawCallType::RECTANGLE);
 	rectDrawCall->dimensions = Node.Dimensions;
 	rectDrawCall->origin = Node.AbsolutePosition;
 
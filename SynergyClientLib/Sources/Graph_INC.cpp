@@ -5,6 +5,66 @@ SOURCE_INC_FILE()
 #include "SynergyCore.h"
 #include "ClientGraph.h"
 
+// Number of nodes of each kind a transaction holds. Created nodes are indexed after fetched ones.
+constexpr GraphEditNodeIndex GRAPH_EDIT_MAX_FETCHED_NODES = sizeof(ClientGraphEditTransaction::FetchedNodes) / sizeof(GraphEditNode);
+constexpr GraphEditNodeIndex GRAPH_EDIT_MAX_CREATED_NODES = sizeof(ClientGraphEditTransaction::CreatedNodes) / sizeof(GraphEditNode);
+
+// Every stack allocation is followed by its size.
+constexpr size_t CLIENT_GRAPH_ALLOCATION_OVERHEAD = sizeof(size_t);
+
+static inline size_t GetLocalNodeIDCapacity(size_t MaxNodeCount)
+{
+	size_t capacity = 16;
+	while (capacity < MaxNodeCount * 2)
+	{
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+// Server IDs put the shard in their low bits, spread them before indexing.
+static inline size_t GetLocalNodeIDSlot(SNodeGUID ServerNodeID, size_t Mask)
+{
+	return (size_t)((ServerNodeID * 0x9E3779B97F4A7C15ull) >> 32) & Mask;
+}
+
+GraphEditNode* ClientGraphEditTransaction::GetNode(GraphEditNodeIndex NodeIndex)
+{
+	return const_cast<GraphEditNode*>(static_cast<const ClientGraphEditTransaction*>(this)->GetNode(NodeIndex));
+}
+
+const GraphEditNode* ClientGraphEditTransaction::GetNode(GraphEditNodeIndex NodeIndex) const
+{
+	if (NodeIndex < GRAPH_EDIT_MAX_FETCHED_NODES)
+	{
+		return &FetchedNodes[NodeIndex];
+	}
+	if (NodeIndex - GRAPH_EDIT_MAX_FETCHED_NODES < GRAPH_EDIT_MAX_CREATED_NODES)
+	{
+		return &CreatedNodes[NodeIndex - GRAPH_EDIT_MAX_FETCHED_NODES];
+	}
+	return nullptr;
+}
+
+GraphEditNodeIndex ClientGraphEditTransaction::GetNodeIndex(const GraphEditNode* Node) const
+{
+	if (Node >= FetchedNodes && Node < FetchedNodes + GRAPH_EDIT_MAX_FETCHED_NODES)
+	{
+		return (GraphEditNodeIndex)(Node - FetchedNodes);
+	}
+	if (Node >= CreatedNodes && Node < CreatedNodes + GRAPH_EDIT_MAX_CREATED_NODES)
+	{
+		return GRAPH_EDIT_MAX_FETCHED_NODES + (GraphEditNodeIndex)(Node - CreatedNodes);
+	}
+	// ASSERT Node is null or doesn't belong to the transaction.
+	return GRAPH_EDIT_INVALID_NODE;
+}
+
+bool ClientGraphEditTransaction::IsCreatedNode(GraphEditNodeIndex NodeIndex)
+{
+	return NodeIndex >= GRAPH_EDIT_MAX_FETCHED_NODES && NodeIndex - GRAPH_EDIT_MAX_FETCHED_NODES < GRAPH_EDIT_MAX_CREATED_NODES;
+}
+
 GraphEditNode* ClientGraphEditTransaction::FetchGraphNode(SNodeGUID NodeID)
 {
 	if (TargetGraph == nullptr)
@@ -34,6 +94,7 @@ GraphEditNode* ClientGraphEditTransaction::FetchGraphNode(SNodeGUID NodeID)
 	}
 	
 	GraphEditNode& newFetchedNode = FetchedNodes[fetchedNodeIndex];
+	const GraphEditNodeIndex newFetchedNodeIndex = (GraphEditNodeIndex)fetchedNodeIndex;
 	SNodeDef fetchedDef = TargetGraph->GetNodeDef(NodeID);
 
 	if (fetchedDef.id != NodeID)
@@ -43,8 +104,11 @@ GraphEditNode* ClientGraphEditTransaction::FetchGraphNode(SNodeGUID NodeID)
 	}
 
 	newFetchedNode.ID = NodeID;
-	newFetchedNode.Parent = nullptr; // Fetched nodes are not assigned a parent in the transaction's internal hierarchy until their parent node gets fetched as well.
+	newFetchedNode.Parent = GRAPH_EDIT_INVALID_NODE; // Fetched nodes are not assigned a parent in the transaction's internal hierarchy until their parent node gets fetched as well.
 	newFetchedNode.NodeDef = fetchedDef;
+	newFetchedNode.NameHandle = TargetGraph->DataStore.NameHandles[NodeID];
+	TargetGraph->DataStore.Names.AddRef(newFetchedNode.NameHandle);
+	newFetchedNode.Version = TargetGraph->DataStore.GetNodeVersion(NodeID);
 	newFetchedNode.bDeleted = false;
 
 	// Default values for parent access levels. Useful for root too as it indicates the Fetched node actually exists.
@@ -57,28 +121,28 @@ GraphEditNode* ClientGraphEditTransaction::FetchGraphNode(SNodeGUID NodeID)
 	SNodeConnectionDef connectionsBuffer[32]; // For simplicity we just assume no node has more than a total of 32 outgoing AND incoming connections.
 
 	size_t connectionCount = TargetGraph->GetNodeConnections_Bidirectional(NodeID, connectionsBuffer, sizeof(connectionsBuffer) / sizeof(SNodeConnectionDef));
+	if (connectionCount > sizeof(connectionsBuffer) / sizeof(SNodeConnectionDef))
+	{
+		// ASSERT Node has more connections than we can fetch. Only the first ones get involved in the transaction.
+		connectionCount = sizeof(connectionsBuffer) / sizeof(SNodeConnectionDef);
+	}
 
 	for (size_t connectionIndex = 0; connectionIndex < connectionCount; connectionIndex++)
 	{
 		SNodeConnectionDef& connectionDef = connectionsBuffer[connectionIndex];
+
+		const bool bIncomingConnection = connectionDef.nodeID_Dest == NodeID;
+		const SNodeGUID partnerNodeID = bIncomingConnection ? connectionDef.nodeID_Src : connectionDef.nodeID_Dest;
 		
 		// See if the partner node was fetched beforehand. If it was, the connection should already have been fetched and will be updated in the next step.
 		GraphEditNode* partnerNode = nullptr;
-		bool bIncomingConnection = false;
-		for (GraphEditNode& fetchedNode : FetchedNodes)
+		GraphEditNodeIndex partnerNodeIndex = GRAPH_EDIT_INVALID_NODE;
+		for (GraphEditNodeIndex otherIndex = 0; otherIndex < GRAPH_EDIT_MAX_FETCHED_NODES; otherIndex++)
 		{
-			// OUTGOING connection.
-			if (fetchedNode.ID == connectionDef.nodeID_Dest)
-			{
-				partnerNode = &fetchedNode;
-				break;
-			}
-
-			// INCOMING connection.
-			if (fetchedNode.ID == connectionDef.nodeID_Src)
+			if (otherIndex != newFetchedNodeIndex && FetchedNodes[otherIndex].ID == partnerNodeID)
 			{
-				partnerNode = &fetchedNode;
-				bIncomingConnection = true;
+				partnerNode = &FetchedNodes[otherIndex];
+				partnerNodeIndex = otherIndex;
 				break;
 			}
 		}
@@ -88,13 +152,27 @@ GraphEditNode* ClientGraphEditTransaction::FetchGraphNode(SNodeGUID NodeID)
 		{
 			if (newFetchedNode.NodeDef.parentID == partnerNode->ID)
 			{
-				newFetchedNode.Parent = partnerNode;
-				newFetchedNode.AccessLevelToParent = connectionDef.accessLevel;
+				newFetchedNode.Parent = partnerNodeIndex;
+				if (bIncomingConnection)
+				{
+					newFetchedNode.AccessLevelFromParent = connectionDef.accessLevel;
+				}
+				else
+				{
+					newFetchedNode.AccessLevelToParent = connectionDef.accessLevel;
+				}
 			}
 			else
 			{
-				partnerNode->Parent = &newFetchedNode;
-				partnerNode->AccessLevelFromParent = connectionDef.accessLevel;
+				partnerNode->Parent = newFetchedNodeIndex;
+				if (bIncomingConnection)
+				{
+					partnerNode->AccessLevelToParent = connectionDef.accessLevel;
+				}
+				else
+				{
+					partnerNode->AccessLevelFromParent = connectionDef.accessLevel;
+				}
 			}
 		}
 		
@@ -106,7 +184,7 @@ GraphEditNode* ClientGraphEditTransaction::FetchGraphNode(SNodeGUID NodeID)
 			size_t fetchedConnectionIndex;
 			for (fetchedConnectionIndex = 0; fetchedConnectionIndex < sizeof(FetchedConnections) / sizeof(GraphEditConnection); fetchedConnectionIndex++)
 			{
-				if (FetchedConnections[fetchedConnectionIndex].Src == nullptr)
+				if (FetchedConnections[fetchedConnectionIndex].Def.accessLevel == SNodeConnectionAccessLevel::NONE)
 				{
 					break;
 				}
@@ -119,8 +197,8 @@ GraphEditNode* ClientGraphEditTransaction::FetchGraphNode(SNodeGUID NodeID)
 			}
 			
 			GraphEditConnection& newFetchedConnection = FetchedConnections[fetchedConnectionIndex];
-			newFetchedConnection.Src = bIncomingConnection ? partnerNode : &newFetchedNode;
-			newFetchedConnection.Dest = bIncomingConnection ? &newFetchedNode : partnerNode;
+			newFetchedConnection.Src = bIncomingConnection ? partnerNodeIndex : newFetchedNodeIndex;
+			newFetchedConnection.Dest = bIncomingConnection ? newFetchedNodeIndex : partnerNodeIndex;
 			newFetchedConnection.Def = connectionDef;
 		}
 	}
@@ -128,13 +206,15 @@ GraphEditNode* ClientGraphEditTransaction::FetchGraphNode(SNodeGUID NodeID)
 	// Update fetched connections in case they point to the newly fetched node as destination or source.
 	for(GraphEditConnection& connection : FetchedConnections)
 	{
+		if (connection.Def.accessLevel == SNodeConnectionAccessLevel::NONE) break; // End of array reached.
+
 		if (connection.Def.nodeID_Dest == newFetchedNode.ID)
 		{
-			connection.Dest = &newFetchedNode;
+			connection.Dest = newFetchedNodeIndex;
 		}
 		else if (connection.Def.nodeID_Src == newFetchedNode.ID)
 		{
-			connection.Src = &newFetchedNode;
+			connection.Src = newFetchedNodeIndex;
 		}
 	}
 
@@ -169,12 +249,24 @@ GraphEditNode* ClientGraphEditTransaction::CreateNode(SNodeDef NewNodeDef, Graph
 		return nullptr;
 	}
 
+	// Intern the name now so the transaction doesn't depend on the caller's storage. It keeps it alive until applied, see ReleaseNames.
+	SNamePool& names = TargetGraph->DataStore.Names;
+	SNameHandle nameHandle = names.Intern(NewNodeDef.name);
+	if (nameHandle == SNAME_INVALID_HANDLE)
+	{
+		// ASSERT Name is empty, too long, or the name pool is full.
+		return nullptr;
+	}
+	names.AddRef(nameHandle);
+
 	GraphEditNode& newCreatedNode = CreatedNodes[createdNodeIndex];
 
 	newCreatedNode.ID = SNODE_INVALID_ID; // Created Node don't get an ID, it will get assigned as the transaction is processed.
 	newCreatedNode.bDeleted = false;
-	newCreatedNode.Parent = Parent;
+	newCreatedNode.Parent = GetNodeIndex(Parent);
 	newCreatedNode.NodeDef = NewNodeDef;
+	newCreatedNode.NodeDef.name = names.Get(nameHandle);
+	newCreatedNode.NameHandle = nameHandle;
 
 	// Set minimum access levels to and from parent.
 	newCreatedNode.AccessLevelFromParent = SNodeConnectionAccessLevel::PRIVATE;
@@ -199,6 +291,18 @@ bool ClientGraphEditTransaction::EditNode( GraphEditNode& TargetNode, SNodeDef N
 		Change the target node's data with the passed Def parameter and Parent (if non null).
 	*/
 
+	// Intern the new name first so a failure leaves the node untouched.
+	SNameHandle nameHandle = TargetNode.NameHandle;
+	if (!NewNodeDef.name.empty())
+	{
+		nameHandle = TargetGraph->DataStore.Names.Intern(NewNodeDef.name);
+		if (nameHandle == SNAME_INVALID_HANDLE)
+		{
+			// ASSERT Name is too long or the name pool is full.
+			return false;
+		}
+	}
+
 	// If changing the parent, check that it is a valid operation.
 	if (NewParent != nullptr)
 	{
@@ -208,16 +312,27 @@ bool ClientGraphEditTransaction::EditNode( GraphEditNode& TargetNode, SNodeDef N
 			return false;
 		}
 
-		TargetNode.Parent = NewParent;
+		TargetNode.Parent = GetNodeIndex(NewParent);
 		TargetNode.AccessLevelFromParent = AccessFromParent;
 		TargetNode.AccessLevelToParent = AccessToParent;
 
 		// Updating connections is not necessary as they will be implicitly deleted and created when the operation is processed.
 	}
 
-	// Assign new definition data.
+	// Assign new definition data. Without a new parent the node keeps the one it had, which may not be part of the transaction.
+	SNodeGUID previousParentID = TargetNode.NodeDef.parentID;
 	TargetNode.NodeDef = NewNodeDef;
-	TargetNode.NodeDef.parentID = TargetNode.Parent != nullptr ? TargetNode.Parent->ID : SNODE_INVALID_ID; 
+	const GraphEditNode* parent = GetNode(TargetNode.Parent);
+	TargetNode.NodeDef.parentID = parent != nullptr ? parent->ID : previousParentID;
+	// The transaction holds on to the new name instead of the previous one.
+	SNamePool& names = TargetGraph->DataStore.Names;
+	if (nameHandle != TargetNode.NameHandle)
+	{
+		names.AddRef(nameHandle);
+		names.Release(TargetNode.NameHandle);
+	}
+	TargetNode.NodeDef.name = names.Get(nameHandle);
+	TargetNode.NameHandle = nameHandle;
 
 	return true;
 }
@@ -234,16 +349,17 @@ bool ClientGraphEditTransaction::DeleteNode(GraphEditNode& ToBeDeleted)
 	*/
 
 	ToBeDeleted.bDeleted = true;
+	const GraphEditNodeIndex toBeDeletedIndex = GetNodeIndex(&ToBeDeleted);
 
 	// Perform a recursive delete operation on all child nodes. Fetch them if necessary.
 	{
 		for (GraphEditConnection& connection : FetchedConnections)
 		{
 			if (connection.Def.bIsParentChildConnection
-			&& connection.Src == &ToBeDeleted
+			&& connection.Src == toBeDeletedIndex
 			&& ToBeDeleted.NodeDef.parentID != connection.Def.nodeID_Dest) // To-Child connection check.
 			{
-				GraphEditNode* childNode = connection.Dest;
+				GraphEditNode* childNode = GetNode(connection.Dest);
 				if (childNode == nullptr)
 				{
 					// Fetch child node.
@@ -259,9 +375,9 @@ bool ClientGraphEditTransaction::DeleteNode(GraphEditNode& ToBeDeleted)
 		for (GraphEditConnection& connection : FetchedConnections)
 		{
 			// Incoming connection.
-			if (connection.Dest == &ToBeDeleted)
+			if (connection.Dest == toBeDeletedIndex)
 			{
-				if (connection.Src == nullptr)
+				if (connection.Src == GRAPH_EDIT_INVALID_NODE)
 				{
 					// Fetch the source node of this connection so it can be part of the transaction, as it is about to lose a connection !
 					FetchGraphNode(connection.Def.nodeID_Src);
@@ -269,7 +385,7 @@ bool ClientGraphEditTransaction::DeleteNode(GraphEditNode& ToBeDeleted)
 				DeleteConnection(connection);
 			}
 			// Outgoing connection.
-			else if (connection.Src == &ToBeDeleted)
+			else if (connection.Src == toBeDeletedIndex)
 			{
 				DeleteConnection(connection);
 			}
@@ -294,13 +410,15 @@ bool ClientGraphEditTransaction::AddOrEditConnection(GraphEditNode& SourceNode,
 
 	GraphEditConnection* connectionPtr = nullptr;
 	bool bIsFetchedConnection = false;
+	const GraphEditNodeIndex sourceNodeIndex = GetNodeIndex(&SourceNode);
+	const GraphEditNodeIndex destNodeIndex = GetNodeIndex(&DestNode);
 
 	// Look first among fetched connections as most edit operations will likely target them.
 	size_t fetchedConnectionIndex;
 	for (fetchedConnectionIndex = 0; fetchedConnectionIndex < sizeof(FetchedConnections) / sizeof(GraphEditConnection); fetchedConnectionIndex++)
 	{
-		if (FetchedConnections[fetchedConnectionIndex].Src == &SourceNode
-		&& FetchedConnections[fetchedConnectionIndex].Dest == &DestNode)
+		if (FetchedConnections[fetchedConnectionIndex].Src == sourceNodeIndex
+		&& FetchedConnections[fetchedConnectionIndex].Dest == destNodeIndex)
 		{
 			connectionPtr = &FetchedConnections[fetchedConnectionIndex];
 			bIsFetchedConnection = true;
@@ -315,15 +433,15 @@ bool ClientGraphEditTransaction::AddOrEditConnection(GraphEditNode& SourceNode,
 		size_t availableSpot = ~0;
 		for (createdConnectionIndex = 0; createdConnectionIndex < sizeof(CreatedConnections) / sizeof(GraphEditConnection); createdConnectionIndex++)
 		{
-			if (CreatedConnections[createdConnectionIndex].Src == &SourceNode
-			&& CreatedConnections[createdConnectionIndex].Dest == &DestNode)
+			if (CreatedConnections[createdConnectionIndex].Src == sourceNodeIndex
+			&& CreatedConnections[createdConnectionIndex].Dest == destNodeIndex)
 			{
 				connectionPtr = &CreatedConnections[createdConnectionIndex];
 				break;
 			}
 			else if (availableSpot == ~0
-				&& CreatedConnections[createdConnectionIndex].Src == nullptr
-				&& CreatedConnections[createdConnectionIndex].Dest == nullptr)
+				&& CreatedConnections[createdConnectionIndex].Src == GRAPH_EDIT_INVALID_NODE
+				&& CreatedConnections[createdConnectionIndex].Dest == GRAPH_EDIT_INVALID_NODE)
 			{
 				// Cache the available spot in case the connection needs to be created.
 				availableSpot = createdConnectionIndex;
@@ -341,8 +459,8 @@ bool ClientGraphEditTransaction::AddOrEditConnection(GraphEditNode& SourceNode,
 
 			// Initialize basic connection properties.
 			connectionPtr = &CreatedConnections[availableSpot];
-			connectionPtr->Src = &SourceNode;
-			connectionPtr->Dest = &DestNode;
+			connectionPtr->Src = sourceNodeIndex;
+			connectionPtr->Dest = destNodeIndex;
 		}
 	}
 
@@ -361,8 +479,11 @@ bool ClientGraphEditTransaction::DeleteConnection(GraphEditNode& SourceNode, Gra
 		return false;
 	}
 
-	if (SourceNode.Parent == &DestNode
-	|| DestNode.Parent == &SourceNode)
+	const GraphEditNodeIndex sourceNodeIndex = GetNodeIndex(&SourceNode);
+	const GraphEditNodeIndex destNodeIndex = GetNodeIndex(&DestNode);
+
+	if (SourceNode.Parent == destNodeIndex
+	|| DestNode.Parent == sourceNodeIndex)
 	{
 		// ASSERT Cannot delete parent-child connection. EDIT a node to change a its parent.
 		return false;
@@ -370,8 +491,8 @@ bool ClientGraphEditTransaction::DeleteConnection(GraphEditNode& SourceNode, Gra
 
 	for(GraphEditConnection& connection : FetchedConnections)
 	{
-		if (connection.Src == &SourceNode
-		&& connection.Dest == &DestNode)
+		if (connection.Src == sourceNodeIndex
+		&& connection.Dest == destNodeIndex)
 		{
 			return DeleteConnection(connection);
 		}
@@ -379,8 +500,8 @@ bool ClientGraphEditTransaction::DeleteConnection(GraphEditNode& SourceNode, Gra
 
 	for(GraphEditConnection& connection : CreatedConnections)
 	{
-		if (connection.Src == &SourceNode
-		&& connection.Dest == &DestNode)
+		if (connection.Src == sourceNodeIndex
+		&& connection.Dest == destNodeIndex)
 		{
 			return DeleteConnection(connection);
 		}
@@ -412,82 +533,314 @@ bool ClientGraphEditTransaction::DeleteConnection(GraphEditConnection& Connectio
 	return true;
 }
 
-template<size_t MaxNodeCount>
-SNodeGUID StaticClientGraphDataStore<MaxNodeCount>::FindAvailableID() const
+size_t ClientGraphEditTransaction::ExportOps(SGraphOp* OpBuffer, size_t OpBufferSize) const
 {
-	for(SNodeGUID nodeID = 0; nodeID < MaxNodeCount; nodeID++)
+	if (TargetGraph == nullptr)
 	{
-		if (_StaticNodeCoreDataStore[nodeID].name[0] == '\0')
+		// ASSERT TargetGraph was not assigned.
+		return 0;
+	}
+
+	const SGraphStore& store = TargetGraph->DataStore;
+
+	size_t opCount = 0;
+	auto AddOp = [&](SGraphOpType Type, SNodeGUID NodeRef, SNodeGUID OtherRef, SNodeConnectionAccessLevel AccessLevel,
+		SNodeConnectionAccessLevel AccessLevelFromParent, std::string_view Name)
+	{
+		if (opCount < OpBufferSize)
 		{
-			return nodeID;
+			// Nodes mirrored from a subscription are known to the server under their server IDs.
+			SGraphOp& op = OpBuffer[opCount];
+			op.Type = Type;
+			op.NodeID = TargetGraph->GetServerNodeID(NodeRef);
+			op.OtherID = TargetGraph->GetServerNodeID(OtherRef);
+			op.AccessLevel = AccessLevel;
+			op.AccessLevelFromParent = AccessLevelFromParent;
+			op.Name = Name;
+			op.Version = 0;
 		}
+		opCount++;
+	};
+
+	// Created nodes are referred to by their index among created nodes, as they only get an ID once the ops are applied.
+	SNodeGUID createdNodeRefs[GRAPH_EDIT_MAX_CREATED_NODES];
+	for (SNodeGUID& createdNodeRef : createdNodeRefs)
+	{
+		createdNodeRef = SNODE_INVALID_ID;
 	}
 
-	return SNODE_INVALID_ID;
-}
+	auto NodeRef = [&](GraphEditNodeIndex NodeIndex)
+	{
+		if (IsCreatedNode(NodeIndex))
+		{
+			return createdNodeRefs[NodeIndex - GRAPH_EDIT_MAX_FETCHED_NODES];
+		}
+		const GraphEditNode* node = GetNode(NodeIndex);
+		return node != nullptr ? node->ID : SNODE_INVALID_ID;
+	};
 
-SNodeDef ClientGraph::GetNodeDef(SNodeGUID NodeID, SNodeGUID StartNodeID)
-{
-	// If node of this ID doesn't exist, return "hollow" definition.
-	if (NodeID > DataStore.GetMaxNodeCount() || DataStore._StaticNodeCoreDataStore[NodeID].name[0] == '\0')
+	size_t fetchedNodeCount = 0;
+	while (fetchedNodeCount < GRAPH_EDIT_MAX_FETCHED_NODES && FetchedNodes[fetchedNodeCount].AccessLevelFromParent != SNodeConnectionAccessLevel::NONE)
 	{
-		return {};
+		fetchedNodeCount++;
 	}
-	NodeCoreData& coreData = DataStore._StaticNodeCoreDataStore[NodeID];
 
-	SNodeDef def = {
-		NodeID,
-		coreData.parentNodeID,
+	size_t createdNodeCount = 0;
+	while (createdNodeCount < GRAPH_EDIT_MAX_CREATED_NODES && CreatedNodes[createdNodeCount].AccessLevelFromParent != SNodeConnectionAccessLevel::NONE)
+	{
+		createdNodeCount++;
+	}
+
+	// Everything below was decided against the fetched nodes as they were.
+	for (size_t fetchedIndex = 0; fetchedIndex < fetchedNodeCount; fetchedIndex++)
+	{
+		AddOp(SGraphOpType::FETCH_NODE, FetchedNodes[fetchedIndex].ID, SNODE_INVALID_ID,
+			SNodeConnectionAccessLevel::NONE, SNodeConnectionAccessLevel::NONE, {});
+		if (opCount <= OpBufferSize)
+		{
+			OpBuffer[opCount - 1].Version = FetchedNodes[fetchedIndex].Version;
+		}
+	}
+
+	// Deleted fetched nodes, deepest first: nodes can only be deleted once their children are gone.
+	{
+		size_t deletedIndices[GRAPH_EDIT_MAX_FETCHED_NODES];
+		size_t deletedDepths[GRAPH_EDIT_MAX_FETCHED_NODES];
+		size_t deletedCount = 0;
+
+		for (size_t fetchedIndex = 0; fetchedIndex < fetchedNodeCount; fetchedIndex++)
+		{
+			if (!FetchedNodes[fetchedIndex].bDeleted)
+			{
+				continue;
+			}
+
+			size_t depth = 0;
+			if (store.NodeExists(FetchedNodes[fetchedIndex].ID))
+			{
+				store.ForEachAncestor(FetchedNodes[fetchedIndex].ID, [&depth](SNodeGUID)
+				{
+					depth++;
+					return true;
+				});
+			}
+
+			// Insertion sort, there are few of them.
+			size_t insertIndex = deletedCount++;
+			for (; insertIndex > 0 && deletedDepths[insertIndex - 1] < depth; insertIndex--)
+			{
+				deletedIndices[insertIndex] = deletedIndices[insertIndex - 1];
+				deletedDepths[insertIndex] = deletedDepths[insertIndex - 1];
+			}
+			deletedIndices[insertIndex] = fetchedIndex;
+			deletedDepths[insertIndex] = depth;
+		}
+
+		for (size_t deletedIndex = 0; deletedIndex < deletedCount; deletedIndex++)
+		{
+			AddOp(SGraphOpType::DELETE_NODE, FetchedNodes[deletedIndices[deletedIndex]].ID, SNODE_INVALID_ID,
+				SNodeConnectionAccessLevel::NONE, SNodeConnectionAccessLevel::NONE, {});
+		}
+	}
+
+	// Created nodes, parents first since a parent may have been created after its child was, through an edit.
+	{
+		size_t createdRefCount = 0;
+		bool bProgress = true;
+		while (bProgress)
+		{
+			bProgress = false;
+			for (size_t createdIndex = 0; createdIndex < createdNodeCount; createdIndex++)
+			{
+				const GraphEditNode& createdNode = CreatedNodes[createdIndex];
+				const GraphEditNodeIndex parent = createdNode.Parent;
+				const bool bParentPending = parent != GRAPH_EDIT_INVALID_NODE && NodeRef(parent) == SNODE_INVALID_ID;
+				if (createdNode.bDeleted || createdNodeRefs[createdIndex] != SNODE_INVALID_ID || bParentPending)
+				{
+					continue;
+				}
+
+				AddOp(SGraphOpType::CREATE_NODE, SNODE_INVALID_ID, NodeRef(parent),
+					createdNode.AccessLevelToParent, createdNode.AccessLevelFromParent, createdNode.NodeDef.name);
+				createdNodeRefs[createdIndex] = MakeCreatedNodeRef(createdRefCount++);
+				bProgress = true;
+			}
+		}
+	}
+
+	// Edited fetched nodes.
+	for (size_t fetchedIndex = 0; fetchedIndex < fetchedNodeCount; fetchedIndex++)
+	{
+		const GraphEditNode& fetchedNode = FetchedNodes[fetchedIndex];
+		if (fetchedNode.bDeleted)
+		{
+			continue;
+		}
+
+		const bool bExists = store.NodeExists(fetchedNode.ID);
+		if (!bExists || store.NameHandles[fetchedNode.ID] != fetchedNode.NameHandle)
+		{
+			AddOp(SGraphOpType::RENAME_NODE, fetchedNode.ID, SNODE_INVALID_ID,
+				SNodeConnectionAccessLevel::NONE, SNodeConnectionAccessLevel::NONE, fetchedNode.NodeDef.name);
+		}
+
+		// Nodes whose parent isn't part of the transaction keep it, along with their parent - child connections.
+		if (fetchedNode.Parent != GRAPH_EDIT_INVALID_NODE)
+		{
+			const SNodeGUID parentRef = NodeRef(fetchedNode.Parent);
+			if (!bExists || parentRef != store.ParentIDs[fetchedNode.ID]
+			|| store.GetConnection(fetchedNode.ID, parentRef) != fetchedNode.AccessLevelToParent
+			|| store.GetConnection(parentRef, fetchedNode.ID) != fetchedNode.AccessLevelFromParent)
+			{
+				AddOp(SGraphOpType::SET_PARENT, fetchedNode.ID, parentRef,
+					fetchedNode.AccessLevelToParent, fetchedNode.AccessLevelFromParent, {});
+			}
+		}
+	}
+
+	// Connections of deleted nodes are gone with them.
+	auto IsDeleted = [this](GraphEditNodeIndex NodeIndex)
+	{
+		const GraphEditNode* node = GetNode(NodeIndex);
+		return node != nullptr && node->bDeleted;
 	};
 
-	strcpy_s(def.name, sizeof(def.name), coreData.name);
+	for (const GraphEditConnection& createdConnection : CreatedConnections)
+	{
+		if (createdConnection.Src == GRAPH_EDIT_INVALID_NODE) break; // End of array reached.
+
+		if (createdConnection.bDeleted || IsDeleted(createdConnection.Src) || IsDeleted(createdConnection.Dest))
+		{
+			continue;
+		}
+
+		AddOp(SGraphOpType::SET_CONNECTION, NodeRef(createdConnection.Src), NodeRef(createdConnection.Dest),
+			createdConnection.Def.accessLevel, SNodeConnectionAccessLevel::NONE, {});
+	}
+
+	for (const GraphEditConnection& fetchedConnection : FetchedConnections)
+	{
+		if (fetchedConnection.Def.accessLevel == SNodeConnectionAccessLevel::NONE) break; // End of array reached.
+
+		// Parent - child connections were exported along with node parentage.
+		if (fetchedConnection.Def.bIsParentChildConnection || IsDeleted(fetchedConnection.Src) || IsDeleted(fetchedConnection.Dest))
+		{
+			continue;
+		}
 
-	return def;
+		const SNodeGUID srcID = fetchedConnection.Def.nodeID_Src;
+		const SNodeGUID destID = fetchedConnection.Def.nodeID_Dest;
+		const SNodeConnectionAccessLevel accessLevel = fetchedConnection.bDeleted ? SNodeConnectionAccessLevel::NONE : fetchedConnection.Def.accessLevel;
+		if (!store.NodeExists(srcID) || !store.NodeExists(destID) || store.GetConnection(srcID, destID) != accessLevel)
+		{
+			AddOp(SGraphOpType::SET_CONNECTION, srcID, destID, accessLevel, SNodeConnectionAccessLevel::NONE, {});
+		}
+	}
+
+	return opCount;
 }
 
-SNodeDef ClientGraph::GetNodeDef(NodeName Name, SNodeGUID StartNodeID)
+void ClientGraphEditTransaction::ReleaseNames()
 {
-	// Linear search should data store.
-	// This only works so long as Node GUIDs can be directly translated into Index of datastore element.
-	for (SNodeGUID NodeID = 0; NodeID < DataStore.GetMaxNodeCount(); NodeID++)
+	if (TargetGraph == nullptr)
+	{
+		return;
+	}
+
+	// Unused node slots have no name. Released ones are cleared so releasing twice does nothing.
+	SNamePool& names = TargetGraph->DataStore.Names;
+	for (GraphEditNodeIndex nodeIndex = 0; nodeIndex < GRAPH_EDIT_MAX_FETCHED_NODES + GRAPH_EDIT_MAX_CREATED_NODES; nodeIndex++)
 	{
-		if (strcmp(Name, DataStore._StaticNodeCoreDataStore[NodeID].name) == 0)
+		GraphEditNode& node = *GetNode(nodeIndex);
+		if (node.NameHandle != SNAME_INVALID_HANDLE)
 		{
-			return GetNodeDef(NodeID);
+			names.Release(node.NameHandle);
+			node.NameHandle = SNAME_INVALID_HANDLE;
 		}
 	}
+}
+
+bool ClientGraph::Initialize(MemoryAllocator& Allocator, size_t MaxNodeCount, size_t MaxConnectionCount, size_t ChangeStreamCapacity)
+{
+	RootNodeID = 0;
+	if (!DataStore.Initialize(Allocator, MaxNodeCount, MaxConnectionCount) || !SearchIndex.Initialize(Allocator, DataStore)
+		|| !Changes.Initialize(Allocator, ChangeStreamCapacity))
+	{
+		return false;
+	}
 
-	return {};
+	LocalNodeIDCapacity = GetLocalNodeIDCapacity(MaxNodeCount);
+	ServerNodeIDs = Allocator.Allocate<SNodeGUID>(MaxNodeCount);
+	LocalNodeIDs = Allocator.Allocate<SNodeGUID>(LocalNodeIDCapacity);
+	if (ServerNodeIDs == nullptr || LocalNodeIDs == nullptr)
+	{
+		return false;
+	}
+
+	memset(ServerNodeIDs, 0xFF, sizeof(SNodeGUID) * MaxNodeCount);
+	memset(LocalNodeIDs, 0xFF, sizeof(SNodeGUID) * LocalNodeIDCapacity);
+	return true;
 }
 
-size_t ClientGraph::GetNodeConnections_Bidirectional(SNodeGUID NodeID, SNodeConnectionDef* NodeConnectionsBuffer, size_t NodeConnectionsBufferSize)
+size_t ClientGraph::GetRequiredMemorySize(size_t MaxNodeCount, size_t MaxConnectionCount, size_t ChangeStreamCapacity)
 {
-	// Go through access level matrix, counting connections. If buffer pointer is given, also fill it in with appropriate structured data
-	// until it is full. Keep counting so that the function's user can notice that the given buffer wasn't large enough to hold them all.
+	return SGraphStore::GetRequiredMemorySize(MaxNodeCount, MaxConnectionCount) + SGraphSearchIndex::GetRequiredMemorySize(MaxNodeCount)
+		+ SGraphChangeStream::GetRequiredMemorySize(ChangeStreamCapacity)
+		+ sizeof(SNodeGUID) * MaxNodeCount + CLIENT_GRAPH_ALLOCATION_OVERHEAD
+		+ sizeof(SNodeGUID) * GetLocalNodeIDCapacity(MaxNodeCount) + CLIENT_GRAPH_ALLOCATION_OVERHEAD;
+}
+
+bool ClientGraph::BulkLoad(const char* FilePath, const SGraphBulkLoadOptions& Options, SGraphBulkLoadResult& OutResult)
+{
+	if (!BulkLoadGraph(DataStore, FilePath, Options, OutResult))
+	{
+		return false;
+	}
+
+	// Loaded nodes are indexed in one go, which is cheaper than one at a time.
+	SearchIndex.Rebuild();
 
-	bool bBufferPassed = NodeConnectionsBuffer != nullptr && NodeConnectionsBufferSize > 0;
-	size_t connectionsCount = 0;
+	// Whatever followed the graph has to start over from its new contents.
+	Changes.PushResync();
 
-	// Matrix stores the access level from one node to all others line-wise.
-	// Retrieve all incoming and outgoing connections.
-	for (SNodeGUID OtherNodeID = 0; OtherNodeID < DataStore.GetMaxNodeCount(); OtherNodeID++)
+	if (OutResult.RootNodeID != SNODE_INVALID_ID)
 	{
-		const SNodeConnectionAccessLevel& accessLevel = DataStore._StaticAccessLevelMatrix[NodeID * DataStore.GetMaxNodeCount() + OtherNodeID];
-		if (accessLevel > SNodeConnectionAccessLevel::NONE)
-		{
-			if (bBufferPassed && connectionsCount < NodeConnectionsBufferSize)
-			{
-				NodeConnectionsBuffer[connectionsCount] =
-				{
-					NodeID, OtherNodeID,
-					accessLevel
-				};
-			}
-			connectionsCount += 2;
-		}
+		RootNodeID = OutResult.RootNodeID;
+	}
+	return true;
+}
+
+SNodeDef ClientGraph::GetNodeDef(SNodeGUID NodeID, SNodeGUID)
+{
+	// If node of this ID doesn't exist, return "hollow" definition.
+	if (!DataStore.NodeExists(NodeID))
+	{
+		return {};
 	}
+	// The name is a view of the data store's name pool, nothing gets copied.
+	return {
+		NodeID,
+		DataStore.ParentIDs[NodeID],
+		DataStore.GetNodeName(NodeID),
+	};
+}
+
+SNodeDef ClientGraph::GetNodeDef(std::string_view Name, SNodeGUID)
+{
+	// Hash lookup through the data store's name index.
+	return GetNodeDef(DataStore.FindNodeByName(Name));
+}
 
-	return connectionsCount;
+size_t ClientGraph::SearchNodes(const SGraphSearchQuery& Query, SGraphSearchHit* HitsBuffer, size_t HitsBufferSize, SGraphSearchResultInfo& OutInfo)
+{
+	return SearchIndex.Search(Query, HitsBuffer, HitsBufferSize, OutInfo);
+}
+
+size_t ClientGraph::GetNodeConnections_Bidirectional(SNodeGUID NodeID, SNodeConnectionDef* NodeConnectionsBuffer, size_t NodeConnectionsBufferSize)
+{
+	// The data store keeps per-node lists of outgoing and incoming connections. It fills the buffer if one is given, until it is full,
+	// and keeps counting so that the function's user can notice that the given buffer wasn't large enough to hold them all.
+	return DataStore.GetConnections_Bidirectional(NodeID, NodeConnectionsBuffer, NodeConnectionsBufferSize);
 }
 
 bool ClientGraph::ApplyEditTransaction(ClientGraphEditTransaction& TransactionToApply)
@@ -502,31 +855,65 @@ bool ClientGraph::ApplyEditTransaction(ClientGraphEditTransaction& TransactionTo
 		Go through Fetched nodes and delete those marked for deletion.
 		Create nodes created by the transaction.
 		Resolve new parentage of all involved nodes.
-		Update connection matrix.
+		Update connections.
 	*/
 
-	// TODO Check that all fetched nodes actually exist.
+	// Everything was decided against the fetched nodes as they were, which they must still be.
+	for (const GraphEditNode& fetchedNode : TransactionToApply.FetchedNodes)
+	{
+		if (fetchedNode.AccessLevelFromParent == SNodeConnectionAccessLevel::NONE) break; // End of Fetched Nodes array.
 
-	// Delete fetched nodes marked for deletion.
+		if (!DataStore.NodeExists(fetchedNode.ID) || DataStore.GetNodeVersion(fetchedNode.ID) != fetchedNode.Version)
+		{
+			// ASSERT Transaction conflicts with changes made since it was built.
+			return false;
+		}
+	}
+
+	// Check that the data store is able to store all the newly created nodes.
+	size_t createdNodeCount = 0;
+	for (GraphEditNode& createdNode : TransactionToApply.CreatedNodes)
+	{
+		if (createdNode.AccessLevelFromParent == SNodeConnectionAccessLevel::NONE) break; // End of Created Nodes array.
+		if (!createdNode.bDeleted) createdNodeCount++;
+	}
+
+	if (createdNodeCount > DataStore.MaxNodeCount - DataStore.NodeCount)
+	{
+		// ASSERT Data store is full.
+		return false;
+	}
+
+	Changes.BeginTransaction();
+
+	// Connection updates are only recorded when they actually change something.
+	auto SetConnection = [this](SNodeGUID Src, SNodeGUID Dest, SNodeConnectionAccessLevel AccessLevel)
+	{
+		if (DataStore.GetConnection(Src, Dest) != AccessLevel && DataStore.SetConnection(Src, Dest, AccessLevel))
+		{
+			Changes.Push({ SGraphChangeKind::CONNECTION_CHANGED, AccessLevel, 0, Src, Dest });
+		}
+	};
+
+	// Delete fetched nodes marked for deletion. Their connections go with them.
 	for (GraphEditNode& fetchedNode : TransactionToApply.FetchedNodes)
 	{
 		if (fetchedNode.AccessLevelFromParent == SNodeConnectionAccessLevel::NONE) break; // End of Fetched Nodes array.
 
-		if (fetchedNode.bDeleted)
+		if (fetchedNode.bDeleted && DataStore.NodeExists(fetchedNode.ID))
 		{
-			// Find node in datastore and reset all data.
-			memset(DataStore._StaticNodeCoreDataStore + fetchedNode.ID, 0, sizeof(NodeCoreData));
-
-			for(size_t matrixIndex = 0; matrixIndex < DataStore.GetMaxNodeCount(); matrixIndex++)
+			// Children are left parentless by the deletion.
+			DataStore.ForEachChild(fetchedNode.ID, [&](SNodeGUID ChildID)
 			{
-				DataStore._StaticAccessLevelMatrix[fetchedNode.ID * DataStore.GetMaxNodeCount() + matrixIndex] = SNodeConnectionAccessLevel::NONE;
-				DataStore._StaticAccessLevelMatrix[matrixIndex * DataStore.GetMaxNodeCount() + fetchedNode.ID] = SNodeConnectionAccessLevel::NONE;
-			}
+				Changes.Push({ SGraphChangeKind::PARENT_CHANGED, SNodeConnectionAccessLevel::NONE, 0, ChildID, SNODE_INVALID_ID });
+			});
+
+			const SNodeGUID formerParentID = DataStore.ParentIDs[fetchedNode.ID];
+			DataStore.DeleteNode(fetchedNode.ID);
+			Changes.Push({ SGraphChangeKind::NODE_DELETED, SNodeConnectionAccessLevel::NONE, 0, fetchedNode.ID, formerParentID });
 		}
 	}
 
-	// TODO Check that the datastores are able to store all the newly created nodes.
-
 	// Create created nodes that aren't marked for deletion.
 	for(GraphEditNode& createdNode : TransactionToApply.CreatedNodes)
 	{
@@ -545,8 +932,9 @@ bool ClientGraph::ApplyEditTransaction(ClientGraphEditTransaction& TransactionTo
 		// Assign ID to Graph Edit node so other related nodes and connections know what ID to reference.
 		createdNode.ID = newNodeID;
 
-		// Init properties we have knowledge of already.
-		strcpy_s(DataStore._StaticNodeCoreDataStore[newNodeID].name, sizeof(NodeName), createdNode.NodeDef.name);
+		// Init properties we have knowledge of already. Parent gets resolved once every created node has an ID.
+		DataStore.CreateNode(newNodeID, createdNode.NameHandle, SNODE_INVALID_ID);
+		SearchIndex.OnNodeNamed(newNodeID);
 	}
 
 	// Resolve parentage for new nodes.
@@ -554,15 +942,27 @@ bool ClientGraph::ApplyEditTransaction(ClientGraphEditTransaction& TransactionTo
 	{
 		if (createdNode.AccessLevelFromParent == SNodeConnectionAccessLevel::NONE) break; // End of Created Nodes array.
 
-		if (createdNode.Parent != nullptr)
+		if (createdNode.bDeleted)
+		{
+			continue;
+		}
+
+		const GraphEditNode* parent = TransactionToApply.GetNode(createdNode.Parent);
+		const SNodeGUID parentID = parent != nullptr ? parent->ID : SNODE_INVALID_ID;
+		Changes.Push({ SGraphChangeKind::NODE_CREATED, SNodeConnectionAccessLevel::NONE, createdNode.NameHandle, createdNode.ID, parentID });
+
+		if (parent != nullptr)
 		{
-			DataStore._StaticNodeCoreDataStore[createdNode.ID].parentNodeID = createdNode.Parent->ID;
+			DataStore.SetParent(createdNode.ID, parentID);
+
+			// Implicit parent - child connections.
+			SetConnection(createdNode.ID, parentID, createdNode.AccessLevelToParent);
+			SetConnection(parentID, createdNode.ID, createdNode.AccessLevelFromParent);
 		}
 		else
 		{
 			// New root node.
 			// For now let's not worry about ending up with multiple root nodes. It will be checked for as a post process of the transaction.
-			DataStore._StaticNodeCoreDataStore[createdNode.ID].parentNodeID = SNODE_INVALID_ID;
 			RootNodeID = createdNode.ID;
 		}
 	}
@@ -573,28 +973,53 @@ bool ClientGraph::ApplyEditTransaction(ClientGraphEditTransaction& TransactionTo
 	{
 		if (fetchedNode.AccessLevelFromParent == SNodeConnectionAccessLevel::NONE) break; // End of Created Nodes array.
 
+		if (fetchedNode.bDeleted)
+		{
+			continue;
+		}
+
+		// Apply edited name.
+		if (DataStore.NameHandles[fetchedNode.ID] != fetchedNode.NameHandle)
+		{
+			DataStore.RenameNode(fetchedNode.ID, fetchedNode.NameHandle);
+			SearchIndex.OnNodeNamed(fetchedNode.ID);
+			Changes.Push({ SGraphChangeKind::NODE_RENAMED, SNodeConnectionAccessLevel::NONE, fetchedNode.NameHandle, fetchedNode.ID, SNODE_INVALID_ID });
+		}
+
 		// Delete previous parent relationship.
-		SNodeGUID previousParentID = DataStore._StaticNodeCoreDataStore[fetchedNode.ID].parentNodeID;
-		SNodeGUID newParentID = fetchedNode.Parent != nullptr ? fetchedNode.Parent->ID : SNODE_INVALID_ID;
+		// A fetched node whose parent isn't part of the transaction keeps the parent recorded in its definition.
+		SNodeGUID previousParentID = DataStore.ParentIDs[fetchedNode.ID];
+		const GraphEditNode* parent = TransactionToApply.GetNode(fetchedNode.Parent);
+		SNodeGUID newParentID = parent != nullptr ? parent->ID : fetchedNode.NodeDef.parentID;
 
 		if (newParentID != previousParentID)
 		{
 			if (previousParentID != SNODE_INVALID_ID)
 			{
 				// Remove connection between previous parent and child.
-				DataStore._StaticAccessLevelMatrix[fetchedNode.ID * DataStore.GetMaxNodeCount() + previousParentID] = SNodeConnectionAccessLevel::NONE;
-				DataStore._StaticAccessLevelMatrix[previousParentID * DataStore.GetMaxNodeCount() + fetchedNode.ID] = SNodeConnectionAccessLevel::NONE;
+				SetConnection(fetchedNode.ID, previousParentID, SNodeConnectionAccessLevel::NONE);
+				SetConnection(previousParentID, fetchedNode.ID, SNodeConnectionAccessLevel::NONE);
 			}
 		}
 
 		// Update parent ID in core values.
-		DataStore._StaticNodeCoreDataStore[fetchedNode.ID].parentNodeID = newParentID;	
+		DataStore.SetParent(fetchedNode.ID, newParentID);
+		if (newParentID != previousParentID)
+		{
+			Changes.Push({ SGraphChangeKind::PARENT_CHANGED, SNodeConnectionAccessLevel::NONE, 0, fetchedNode.ID, newParentID });
+		}
 
-		// New parent - Add connection between new parent and child.
+		// New parent - Add connection between new parent and child. Access levels are only known if the parent is part of the transaction
+		// or the node was given a new parent, otherwise the existing connections are left untouched.
 		if (newParentID != SNODE_INVALID_ID)
 		{
-			DataStore._StaticAccessLevelMatrix[fetchedNode.ID * DataStore.GetMaxNodeCount() + newParentID] = fetchedNode.AccessLevelToParent;
-			DataStore._StaticAccessLevelMatrix[newParentID * DataStore.GetMaxNodeCount() + fetchedNode.ID] = fetchedNode.AccessLevelFromParent;
+			if (newParentID == previousParentID && parent == nullptr)
+			{
+				continue;
+			}
+
+			SetConnection(fetchedNode.ID, newParentID, fetchedNode.AccessLevelToParent);
+			SetConnection(newParentID, fetchedNode.ID, fetchedNode.AccessLevelFromParent);
 		}
 		// New root node. Update Graph Root Node ID.
 		// For now let's not worry about ending up with multiple root nodes. It will be checked for as a post process of the transaction.
@@ -607,7 +1032,7 @@ bool ClientGraph::ApplyEditTransaction(ClientGraphEditTransaction& TransactionTo
 	// Resolve created connections.
 	for (GraphEditConnection& createdConnection : TransactionToApply.CreatedConnections)
 	{
-		if (createdConnection.Src == nullptr) break; // End of array reached.
+		if (createdConnection.Src == GRAPH_EDIT_INVALID_NODE) break; // End of array reached.
 
 		if (createdConnection.bDeleted)
 		{
@@ -615,8 +1040,8 @@ bool ClientGraph::ApplyEditTransaction(ClientGraphEditTransaction& TransactionTo
 		}
 
 		// Update access level from source to destination.
-		DataStore._StaticAccessLevelMatrix[createdConnection.Src->ID * DataStore.GetMaxNodeCount() + createdConnection.Dest->ID]
-		 = createdConnection.Def.accessLevel;
+		SetConnection(TransactionToApply.GetNode(createdConnection.Src)->ID, TransactionToApply.GetNode(createdConnection.Dest)->ID,
+			createdConnection.Def.accessLevel);
 	}
 
 	// Resolve fetched connections.
@@ -624,17 +1049,256 @@ bool ClientGraph::ApplyEditTransaction(ClientGraphEditTransaction& TransactionTo
 	{
 		if (fetchedConnection.Def.accessLevel == SNodeConnectionAccessLevel::NONE) break; // End of array reached.
 
-		// If connection was deleted, simply reset access level between the nodes.
-		if (fetchedConnection.bDeleted)
+		// Parent - child connections were resolved along with node parentage.
+		if (fetchedConnection.Def.bIsParentChildConnection)
 		{
-			DataStore._StaticAccessLevelMatrix[fetchedConnection.Src->ID * DataStore.GetMaxNodeCount() + fetchedConnection.Dest->ID]
-			= SNodeConnectionAccessLevel::NONE;
+			continue;
 		}
 
-		// Update access level from source to destination.
-		DataStore._StaticAccessLevelMatrix[fetchedConnection.Src->ID * DataStore.GetMaxNodeCount() + fetchedConnection.Dest->ID]
-		 = fetchedConnection.Def.accessLevel;
+		// Fetched connections always know the IDs of their partners, even when only one of them was fetched.
+		// A deleted connection simply gets its access level reset.
+		SetConnection(fetchedConnection.Def.nodeID_Src, fetchedConnection.Def.nodeID_Dest,
+			fetchedConnection.bDeleted ? SNodeConnectionAccessLevel::NONE : fetchedConnection.Def.accessLevel);
 	}
 
+	Changes.EndTransaction();
+
+	// The nodes hold their own references now, names the transaction was alone to keep are freed along with the ones released.
+	TransactionToApply.ReleaseNames();
+	DataStore.Names.ReclaimUnreferenced();
 	return true;
-}
\ No newline at end of file
+}
+
+bool ClientGraph::ApplySubscriptionUpdate(const uint8_t* Payload, size_t PayloadSize)
+{
+	SProtocolSubscriptionUpdateReader reader;
+	if (!reader.Begin(Payload, PayloadSize))
+	{
+		return false;
+	}
+
+	// A snapshot starts from an empty graph, and is described by a single RESYNC rather than change by change.
+	const bool bSnapshot = (reader.Flags & SPROTOCOL_SUBSCRIPTION_SNAPSHOT) != 0;
+	if (bSnapshot)
+	{
+		DataStore.ForEachNode([this](SNodeGUID NodeID) { DataStore.DeleteNode(NodeID); });
+		memset(ServerNodeIDs, 0xFF, sizeof(SNodeGUID) * DataStore.MaxNodeCount);
+		memset(LocalNodeIDs, 0xFF, sizeof(SNodeGUID) * LocalNodeIDCapacity);
+	}
+	else
+	{
+		Changes.BeginTransaction();
+	}
+
+	// The first node of a snapshot is the root of the subscription's view.
+	bool bRootPending = bSnapshot;
+
+	auto PushChange = [this, bSnapshot](const SGraphChange& Change)
+	{
+		if (!bSnapshot)
+		{
+			Changes.Push(Change);
+		}
+	};
+
+	// Nodes hold the versions the server gave them, which connections changing on their account mustn't alter.
+	auto SetConnectionKeepingVersions = [this](SNodeGUID Src, SNodeGUID Dest, SNodeConnectionAccessLevel AccessLevel)
+	{
+		const uint64_t srcVersion = DataStore.GetNodeVersion(Src);
+		const uint64_t destVersion = DataStore.GetNodeVersion(Dest);
+		const bool bSet = DataStore.SetConnection(Src, Dest, AccessLevel);
+		DataStore.ColdData[Src].ModificationStamp = srcVersion;
+		DataStore.ColdData[Dest].ModificationStamp = destVersion;
+		return bSet;
+	};
+
+	bool bAppliedAll = true;
+	SProtocolSubscriptionRecord record;
+	while (reader.Next(record))
+	{
+		switch (record.Kind)
+		{
+		case SProtocolSubscriptionRecordKind::NODE:
+		{
+			const SNameHandle name = DataStore.Names.Intern(record.Name);
+			const SNodeGUID parentID = FindLocalNodeID(record.OtherID);
+			if (name == SNAME_INVALID_HANDLE)
+			{
+				bAppliedAll = false;
+				break;
+			}
+
+			SNodeGUID nodeID = FindLocalNodeID(record.NodeID);
+			if (nodeID == SNODE_INVALID_ID)
+			{
+				nodeID = DataStore.FindAvailableID();
+				if (nodeID == SNODE_INVALID_ID || !DataStore.CreateNode(nodeID, name, parentID))
+				{
+					bAppliedAll = false;
+					break;
+				}
+				MapServerNodeID(nodeID, record.NodeID);
+				SearchIndex.OnNodeNamed(nodeID);
+				DataStore.ColdData[nodeID].ModificationStamp = record.Version;
+				PushChange({ SGraphChangeKind::NODE_CREATED, SNodeConnectionAccessLevel::NONE, name, nodeID, parentID });
+			}
+			else
+			{
+				if (DataStore.NameHandles[nodeID] != name)
+				{
+					DataStore.RenameNode(nodeID, name);
+					SearchIndex.OnNodeNamed(nodeID);
+					PushChange({ SGraphChangeKind::NODE_RENAMED, SNodeConnectionAccessLevel::NONE, name, nodeID, SNODE_INVALID_ID });
+				}
+				if (DataStore.ParentIDs[nodeID] != parentID)
+				{
+					DataStore.SetParent(nodeID, parentID);
+					PushChange({ SGraphChangeKind::PARENT_CHANGED, SNodeConnectionAccessLevel::NONE, 0, nodeID, parentID });
+				}
+				DataStore.ColdData[nodeID].ModificationStamp = record.Version;
+			}
+
+			if (bRootPending)
+			{
+				RootNodeID = nodeID;
+				bRootPending = false;
+			}
+			break;
+		}
+
+		case SProtocolSubscriptionRecordKind::NODE_REMOVED:
+		{
+			const SNodeGUID nodeID = FindLocalNodeID(record.NodeID);
+			if (nodeID != SNODE_INVALID_ID)
+			{
+				DataStore.ForEachChild(nodeID, [&](SNodeGUID ChildID)
+				{
+					PushChange({ SGraphChangeKind::PARENT_CHANGED, SNodeConnectionAccessLevel::NONE, 0, ChildID, SNODE_INVALID_ID });
+				});
+
+				// Its connections go first, so that its partners keep their versions.
+				while (DataStore.FirstOutEdge[nodeID] != SGRAPH_INVALID_EDGE)
+				{
+					SetConnectionKeepingVersions(nodeID, DataStore.Edges[DataStore.FirstOutEdge[nodeID]].Dest, SNodeConnectionAccessLevel::NONE);
+				}
+				while (DataStore.FirstInEdge[nodeID] != SGRAPH_INVALID_EDGE)
+				{
+					SetConnectionKeepingVersions(DataStore.Edges[DataStore.FirstInEdge[nodeID]].Src, nodeID, SNodeConnectionAccessLevel::NONE);
+				}
+
+				const SNodeGUID formerParentID = DataStore.ParentIDs[nodeID];
+				DataStore.DeleteNode(nodeID);
+				UnmapServerNodeID(nodeID);
+				PushChange({ SGraphChangeKind::NODE_DELETED, SNodeConnectionAccessLevel::NONE, 0, nodeID, formerParentID });
+			}
+			break;
+		}
+
+		case SProtocolSubscriptionRecordKind::CONNECTION:
+		{
+			const SNodeGUID srcID = FindLocalNodeID(record.NodeID);
+			const SNodeGUID destID = FindLocalNodeID(record.OtherID);
+			if (srcID == SNODE_INVALID_ID || destID == SNODE_INVALID_ID)
+			{
+				bAppliedAll = false;
+			}
+			else if (DataStore.GetConnection(srcID, destID) != record.AccessLevel)
+			{
+				if (SetConnectionKeepingVersions(srcID, destID, record.AccessLevel))
+				{
+					PushChange({ SGraphChangeKind::CONNECTION_CHANGED, record.AccessLevel, 0, srcID, destID });
+				}
+				else
+				{
+					bAppliedAll = false;
+				}
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	if (bSnapshot)
+	{
+		SearchIndex.Rebuild();
+		Changes.PushResync();
+	}
+	else
+	{
+		Changes.EndTransaction();
+	}
+
+	// Names of removed and renamed nodes are released, and the change stream doesn't need them to be read.
+	DataStore.Names.ReclaimUnreferenced();
+	return bAppliedAll && !reader.bFailed;
+}
+
+SNodeGUID ClientGraph::GetServerNodeID(SNodeGUID NodeID) const
+{
+	return NodeID < DataStore.MaxNodeCount && ServerNodeIDs[NodeID] != SNODE_INVALID_ID ? ServerNodeIDs[NodeID] : NodeID;
+}
+
+SNodeGUID ClientGraph::FindLocalNodeID(SNodeGUID ServerNodeID) const
+{
+	if (ServerNodeID == SNODE_INVALID_ID)
+	{
+		return SNODE_INVALID_ID;
+	}
+
+	// The table is never more than half full, so an empty slot ends every probing sequence.
+	const size_t mask = LocalNodeIDCapacity - 1;
+	for (size_t slot = GetLocalNodeIDSlot(ServerNodeID, mask); LocalNodeIDs[slot] != SNODE_INVALID_ID; slot = (slot + 1) & mask)
+	{
+		if (ServerNodeIDs[LocalNodeIDs[slot]] == ServerNodeID)
+		{
+			return LocalNodeIDs[slot];
+		}
+	}
+	return SNODE_INVALID_ID;
+}
+
+void ClientGraph::MapServerNodeID(SNodeGUID LocalNodeID, SNodeGUID ServerNodeID)
+{
+	const size_t mask = LocalNodeIDCapacity - 1;
+	size_t slot = GetLocalNodeIDSlot(ServerNodeID, mask);
+	while (LocalNodeIDs[slot] != SNODE_INVALID_ID)
+	{
+		slot = (slot + 1) & mask;
+	}
+
+	LocalNodeIDs[slot] = LocalNodeID;
+	ServerNodeIDs[LocalNodeID] = ServerNodeID;
+}
+
+void ClientGraph::UnmapServerNodeID(SNodeGUID LocalNodeID)
+{
+	const SNodeGUID serverNodeID = ServerNodeIDs[LocalNodeID];
+	if (serverNodeID == SNODE_INVALID_ID)
+	{
+		return;
+	}
+
+	const size_t mask = LocalNodeIDCapacity - 1;
+	size_t hole = GetLocalNodeIDSlot(serverNodeID, mask);
+	while (LocalNodeIDs[hole] != LocalNodeID)
+	{
+		hole = (hole + 1) & mask;
+	}
+
+	// Entries following the hole move back into it, unless that would put them before their home slot.
+	for (size_t slot = (hole + 1) & mask; LocalNodeIDs[slot] != SNODE_INVALID_ID; slot = (slot + 1) & mask)
+	{
+		const size_t home = GetLocalNodeIDSlot(ServerNodeIDs[LocalNodeIDs[slot]], mask);
+		if (((slot - home) & mask) >= ((slot - hole) & mask))
+		{
+			LocalNodeIDs[hole] = LocalNodeIDs[slot];
+			hole = slot;
+		}
+	}
+
+	LocalNodeIDs[hole] = SNODE_INVALID_ID;
+	ServerNodeIDs[LocalNodeID] = SNODE_INVALID_ID;
+}
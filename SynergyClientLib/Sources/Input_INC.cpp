@@ -61,4 +61,64 @@ void ProcessInputs(ClientSessionState& Client, ClientFrameState& Frame)
 
 	Client.Input.CursorLocation = Frame.CursorLocation;
 	Client.Input.CursorViewport = Frame.CursorViewport;
-}
\ No newline at end of file
+}
+// INPUT CAPTURE
+
+bool StartInputCapture(ClientSessionState& Client, const char* FilePath)
+{
+	StopInputCapture(Client);
+
+	FILE* file = fopen(FilePath, "wb");
+	if (file == nullptr)
+	{
+		std::cerr << "Failed to create the input capture " << FilePath << "\n";
+		return false;
+	}
+
+	uint8_t header[INPUT_CAPTURE_HEADER_SIZE];
+	WriteInputCaptureHeader(header);
+	fwrite(header, 1, sizeof(header), file);
+
+	Client.InputCaptureFile = file;
+	Client.InputCaptureLastFrame = ~(size_t)0;
+	std::cout << "Capturing inputs to " << FilePath << ".\n";
+	return true;
+}
+
+void StopInputCapture(ClientSessionState& Client)
+{
+	if (Client.InputCaptureFile != nullptr)
+	{
+		fclose(Client.InputCaptureFile);
+		Client.InputCaptureFile = nullptr;
+		std::cout << "Stopped capturing inputs.\n";
+	}
+}
+
+void CaptureFrameInputs(ClientSessionState& Client, const ClientFrameRequestData& FrameData)
+{
+	if (Client.InputCaptureFile == nullptr)
+	{
+		return;
+	}
+
+	// Small records written through the file's own buffer, a frame without events only costs a copy of a few bytes.
+	uint8_t record[INPUT_CAPTURE_MAX_FRAME_SIZE];
+	const uint8_t* recordEnd = EncodeCapturedFrame(record, Client.InputCaptureLastFrame, FrameData.FrameNumber, FrameData.FrameTime,
+		FrameData.CursorLocation, FrameData.CursorViewport, FrameData.ActionInputEvents.EventCount);
+	fwrite(record, 1, recordEnd - record, Client.InputCaptureFile);
+
+	for (size_t eventIndex = 0; eventIndex < FrameData.ActionInputEvents.EventCount; eventIndex++)
+	{
+		uint8_t event[INPUT_CAPTURE_EVENT_SIZE];
+		EncodeCapturedEvent(event, FrameData.ActionInputEvents.Buffer[eventIndex]);
+		fwrite(event, 1, sizeof(event), Client.InputCaptureFile);
+	}
+
+	Client.InputCaptureLastFrame = FrameData.FrameNumber;
+	if (ferror(Client.InputCaptureFile))
+	{
+		std::cerr << "Failed to write the input capture, stopping it.\n";
+		StopInputCapture(Client);
+	}
+}
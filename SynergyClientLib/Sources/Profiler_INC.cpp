@@ -0,0 +1,199 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Client frame profiler: recording zones into per thread rings, checking frame stages against their budgets and
+// exporting the rings as a Chrome trace.
+
+#include "Client.h"
+
+#include <stdio.h>
+
+#include <chrono>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CLIENT_PROFILER_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CLIENT_PROFILER_HAS_TSC 1
+#else
+#define CLIENT_PROFILER_HAS_TSC 0
+#endif
+
+/*
+	HOW IT WORKS
+
+	Zones read the time stamp counter when they start and end, which takes a few nanoseconds and no system call, then write a single event
+	to their thread's ring. Ticks are only turned into time when the profiler needs it: at the end of every frame the elapsed ticks are
+	compared to the elapsed steady clock (clock_gettime on Linux) since the start, which gives a tick rate more precise with every frame.
+
+	The rings live in persistent memory rather than frame memory, so an export sees the last few hundred frames instead of the current one.
+
+	Exported events are "complete" events, which Chrome nests by time: a frame holds its stages, a stage holds the zones recorded in it.
+	Built without CLIENT_PROFILER_ENABLED, zones are nothing at all and the functions below do nothing.
+*/
+
+#if CLIENT_PROFILER_ENABLED
+
+static uint64_t ReadProfilerNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ReadProfilerTicks()
+{
+#if CLIENT_PROFILER_HAS_TSC
+	return __rdtsc();
+#else
+	return ReadProfilerNanoseconds();
+#endif
+}
+
+void RecordProfileEvent(ClientProfilerThread& Thread, const char* Name, uint64_t StartTicks, uint64_t EndTicks)
+{
+	// Only this thread moves the write index, so it can be read relaxed and published once the event is written.
+	const uint64_t writeIndex = Thread.WriteIndex.load(std::memory_order_relaxed);
+	ClientProfileEvent& event = Thread.Events[writeIndex & (CLIENT_PROFILER_RING_EVENT_COUNT - 1)];
+	event.StartTicks = StartTicks;
+	event.EndTicks = EndTicks;
+	strncpy(event.Name, Name, CLIENT_PROFILER_MAX_NAME_LENGTH);
+	event.Name[CLIENT_PROFILER_MAX_NAME_LENGTH] = '\0';
+	Thread.WriteIndex.store(writeIndex + 1, std::memory_order_release);
+}
+
+void InitializeClientProfiler(ClientProfiler& Profiler, MemoryAllocator& Allocator)
+{
+	Profiler.bRecording = true;
+	for (ClientProfilerThread& thread : Profiler.Threads)
+	{
+		thread.Events = Allocator.Allocate<ClientProfileEvent>(CLIENT_PROFILER_RING_EVENT_COUNT);
+		thread.WriteIndex.store(0, std::memory_order_relaxed);
+		thread.Profiler = &Profiler;
+	}
+
+	Profiler.BaseTicks = ReadProfilerTicks();
+	Profiler.BaseNanoseconds = ReadProfilerNanoseconds();
+	Profiler.TicksPerMicrosecond = CLIENT_PROFILER_HAS_TSC ? 0.0 : 1000.0;
+	Profiler.FrameCount = 0;
+	for (ClientFrameStageStats& stage : Profiler.Stages)
+	{
+		stage = {};
+	}
+}
+
+uint64_t BeginClientProfilerFrame(ClientProfiler& Profiler)
+{
+	return Profiler.bRecording ? ReadProfilerTicks() : 0;
+}
+
+void EndClientProfilerFrame(ClientProfiler& Profiler, uint64_t FrameStartTicks)
+{
+	if (FrameStartTicks == 0)
+	{
+		return;
+	}
+
+	const uint64_t endTicks = ReadProfilerTicks();
+	RecordProfileEvent(Profiler.Threads[0], "Frame", FrameStartTicks, endTicks);
+
+	// Refine the tick rate against the steady clock, the longer the profiler runs the more precise it gets.
+	const uint64_t elapsedNanoseconds = ReadProfilerNanoseconds() - Profiler.BaseNanoseconds;
+	if (elapsedNanoseconds > 0 && CLIENT_PROFILER_HAS_TSC)
+	{
+		Profiler.TicksPerMicrosecond = (double)(endTicks - Profiler.BaseTicks) * 1000.0 / (double)elapsedNanoseconds;
+	}
+	Profiler.FrameCount++;
+
+	for (size_t stageIndex = 0; stageIndex < (size_t)ClientFrameStage::STAGE_COUNT; stageIndex++)
+	{
+		ClientFrameStageStats& stage = Profiler.Stages[stageIndex];
+		const uint64_t nanoseconds = Profiler.TicksPerMicrosecond > 0.0 ? (uint64_t)((double)stage.FrameTicks * 1000.0 / Profiler.TicksPerMicrosecond) : 0;
+		stage.FrameTicks = 0;
+
+		stage.LastNanoseconds = nanoseconds;
+		stage.MaxNanoseconds = nanoseconds > stage.MaxNanoseconds ? nanoseconds : stage.MaxNanoseconds;
+		stage.TotalNanoseconds += nanoseconds;
+		if (nanoseconds > (uint64_t)CLIENT_FRAME_STAGE_DEFS[stageIndex].BudgetMicroseconds * 1000)
+		{
+			stage.OverrunCount++;
+		}
+	}
+}
+
+bool ExportClientProfile(ClientProfiler& Profiler, const char* FilePath)
+{
+	FILE* file = fopen(FilePath, "w");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	const double ticksPerMicrosecond = Profiler.TicksPerMicrosecond > 0.0 ? Profiler.TicksPerMicrosecond : 1.0;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Main\"}}");
+
+	size_t eventCount = 0;
+	for (uint32_t threadIndex = 0; threadIndex < CLIENT_PROFILER_MAX_THREADS; threadIndex++)
+	{
+		ClientProfilerThread& thread = Profiler.Threads[threadIndex];
+		const uint64_t endIndex = thread.WriteIndex.load(std::memory_order_acquire);
+		const uint64_t startIndex = endIndex > CLIENT_PROFILER_RING_EVENT_COUNT ? endIndex - CLIENT_PROFILER_RING_EVENT_COUNT : 0;
+
+		for (uint64_t eventIndex = startIndex; eventIndex < endIndex; eventIndex++)
+		{
+			ClientProfileEvent event = thread.Events[eventIndex & (CLIENT_PROFILER_RING_EVENT_COUNT - 1)];
+
+			// The thread may have lapped the ring while the event was copied, in which case the copy can't be trusted.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (thread.WriteIndex.load(std::memory_order_relaxed) - eventIndex > CLIENT_PROFILER_RING_EVENT_COUNT)
+			{
+				continue;
+			}
+
+			event.Name[CLIENT_PROFILER_MAX_NAME_LENGTH] = '\0';
+			const double start = (double)(event.StartTicks - Profiler.BaseTicks) / ticksPerMicrosecond;
+			const double duration = (double)(event.EndTicks - event.StartTicks) / ticksPerMicrosecond;
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				event.Name, threadIndex, start, duration);
+			eventCount++;
+		}
+	}
+
+	// Stage durations and budgets, shown under the trace's metadata.
+	fprintf(file, "\n],\"otherData\":{\"frames\":\"%llu\"", (unsigned long long)Profiler.FrameCount);
+	for (size_t stageIndex = 0; stageIndex < (size_t)ClientFrameStage::STAGE_COUNT; stageIndex++)
+	{
+		const ClientFrameStageStats& stage = Profiler.Stages[stageIndex];
+		fprintf(file, ",\"%s\":\"last %.1fus, mean %.1fus, max %.1fus, budget %uus, over budget in %llu frames\"",
+			CLIENT_FRAME_STAGE_DEFS[stageIndex].Name, stage.LastNanoseconds / 1000.0,
+			Profiler.FrameCount > 0 ? stage.TotalNanoseconds / 1000.0 / Profiler.FrameCount : 0.0,
+			stage.MaxNanoseconds / 1000.0, CLIENT_FRAME_STAGE_DEFS[stageIndex].BudgetMicroseconds, (unsigned long long)stage.OverrunCount);
+	}
+	fprintf(file, "}}\n");
+
+	const bool bWritten = ferror(file) == 0;
+	fclose(file);
+	std::cout << "Exported " << eventCount << " profile events to " << FilePath << ".\n";
+	return bWritten;
+}
+
+#else
+
+void InitializeClientProfiler(ClientProfiler& Profiler, MemoryAllocator& Allocator)
+{
+}
+
+uint64_t BeginClientProfilerFrame(ClientProfiler& Profiler)
+{
+	return 0;
+}
+
+void EndClientProfilerFrame(ClientProfiler& Profiler, uint64_t FrameStartTicks)
+{
+}
+
+bool ExportClientProfile(ClientProfiler& Profiler, const char* FilePath)
+{
+	return false;
+}
+
+#endif // CLIENT_PROFILER_ENABLED
@@ -11,10 +11,16 @@
 #include "Input_INC.cpp"
 #include "UI_INC.cpp"
 #include "Drawing_INC.cpp"
+#include "DrawCommands_INC.cpp"
+#include "Profiler_INC.cpp"
 
 // EXPORTED SYMBOLS DEFINITION
 
+#if defined(_MSC_VER)
 #define DLL_EXPORT extern "C" __declspec(dllexport)
+#else
+#define DLL_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
 
 #define CastClientState(MemPtr) (*(ClientSessionState*)(MemPtr))
 
@@ -46,16 +52,47 @@ DLL_EXPORT void StartClient(ClientSessionData& Context)
 
 	Client.bDrawUIDebug = false;
 
-	// Allocate Graph from persistent memory.
+	// Allocate Graph and its data store from persistent memory.
 	Client.Graph = Client.PersistentMemoryAllocator.Allocate<ClientGraph>();
+	*Client.Graph = {};
+	if (!Client.Graph->Initialize(Client.PersistentMemoryAllocator, CLIENT_GRAPH_MAX_NODE_COUNT, CLIENT_GRAPH_MAX_CONNECTION_COUNT))
+	{
+		std::cerr << "Failed to allocate Client Graph !\n";
+		return;
+	}
 
 	Client.SelectedGraphNodeID = SNODE_INVALID_ID;
 
-	// Initialize Graph Node Presentation data.
+	InitializeClientProfiler(Client.Profiler, Client.PersistentMemoryAllocator);
+
+	SJobSystemOptions jobOptions;
+	jobOptions.WorkerCount = std::thread::hardware_concurrency();
+	jobOptions.WorkerCount = jobOptions.WorkerCount < CLIENT_JOB_MAX_WORKER_COUNT ? jobOptions.WorkerCount : CLIENT_JOB_MAX_WORKER_COUNT;
+	jobOptions.FrameArenaSize = CLIENT_JOB_FRAME_ARENA_SIZE;
+	if (!InitializeJobSystem(Client.Jobs, Client.PersistentMemoryAllocator, jobOptions))
+	{
+		std::cerr << "Failed to start the job system !\n";
+		return;
+	}
+
+	Client.InputCaptureFile = nullptr;
+
+	// Initialize Graph Node Presentation data. Representations follow the graph from its very first transaction.
 	for (SNodeGUID repIndex = 0; repIndex < sizeof(Client.NodeRepresentations) / sizeof(GraphNodeRepresentationData); repIndex++)
 	{
 		Client.NodeRepresentations[repIndex].nodeID = SNODE_INVALID_ID;
 	}
+	Client.NodeRepresentationsChangeCursor = Client.Graph->Changes.Subscribe();
+	Client.NodeRepresentationsIndex.bBuilt = false;
+	Client.GraphViewCamera = { Vector2f { 0.f, 0.f }, 1.f };
+
+	// The Main Viewport's UI tree gets built on the first frame, then kept.
+	Client.MainViewportUITree = {};
+	Client.MainViewportUITree.Memory = MakeStackAllocator((ByteBuffer)Client.PersistentMemoryAllocator.Allocate(CLIENT_UI_TREE_MEMORY_SIZE),
+		CLIENT_UI_TREE_MEMORY_SIZE);
+	Client.MainViewportUIInputs = {};
+
+	InitializeDrawDamageTracker(Client.DrawDamage, Client.PersistentMemoryAllocator, CLIENT_DRAW_COMMAND_MAX_COUNT);
 
 	// TEST CODE Build Node Presentation Definition structures.
 	Client.UINodePresentations.GenericPanel = UINodePresentationDef_Rectangle { GetColorWithIntensity(COLOR_White, 0.2f), false }; // Grey, non-highlightable.
@@ -82,45 +119,22 @@ DLL_EXPORT void StartClient(ClientSessionData& Context)
 
 	if (!Client.Graph->ApplyEditTransaction(initTransaction))
 	{
+		initTransaction.ReleaseNames();
 		std::cerr << "Error when applying Init Transaction to Client Graph !\n";
 		return;
 	}
 
-	// TEST CODE Initialize node representation data
-
-	// Let's collect the first 64 nodes, if they exist. Later we'll have ways of tracking which nodes actually exist or not.
-	SNodeDef nodeDefsBuffer[64];
-	size_t nodeCount = 0;
-
-	for (SNodeGUID nodeID = 0; nodeID < 32; nodeID++)
-	{
-		SNodeDef def = Client.Graph->GetNodeDef(nodeID);
-
-		if (def.id == SNODE_INVALID_ID)
-		{	
-			continue;
-		}
-
-		nodeDefsBuffer[nodeCount] = def;
-		nodeCount++;
-	}
-
-	for (SNodeGUID nodeID = 0; nodeID < nodeCount; nodeID++)
-	{
-		// Create representation data.
-		// Place the nodes at random over the view space.
-		Client.NodeRepresentations[nodeID] = {
-			nodeID,
-			Vector2f { (float)(rand() % 400), float(rand() % 400) },
-		};
-
-		Client.NodeRepresentations[nodeID].nodeID = nodeID;
-	}
+	// TEST CODE Initialize node representation data from the nodes the init transaction created.
+	UpdateNodeRepresentations(Client);
 }
 
 DLL_EXPORT void RunClientFrame(ClientSessionData& Context, ClientFrameRequestData& FrameData)
 {
 	ClientSessionState& clientState = CastClientState(Context.PersistentMemoryBuffer.Memory);
+	const uint64_t frameStartTicks = BeginClientProfilerFrame(clientState.Profiler);
+
+	// No job outlives the frame that started it, so their scratch memory goes with it.
+	ResetJobSystemFrameArenas(clientState.Jobs);
 
 	// Build Frame State object
 	ClientFrameState frameState = {};
@@ -131,11 +145,21 @@ DLL_EXPORT void RunClientFrame(ClientSessionData& Context, ClientFrameRequestDat
 	frameState.FrameMemoryAllocator = MakeStackAllocator(FrameData.FrameMemoryBuffer.Memory, FrameData.FrameMemoryBuffer.Size);
 
 	frameState.FramePlatformAPI.NewDrawCall = FrameData.NewDrawCall;
+	frameState.FramePlatformAPI.SubmitDrawCommands = FrameData.SubmitDrawCommands;
 
 	frameState.CursorLocation = FrameData.CursorLocation;
 	frameState.CursorViewport = FrameData.CursorViewport;
 
-	ProcessInputs(clientState, frameState);
+	{
+		CLIENT_PROFILE_STAGE(clientState.Profiler, ClientFrameStage::INPUTS);
+		ProcessInputs(clientState, frameState);
+	}
+
+	// Catch up with graph changes applied since the last frame.
+	{
+		CLIENT_PROFILE_STAGE(clientState.Profiler, ClientFrameStage::REPRESENTATIONS);
+		UpdateNodeRepresentations(clientState);
+	}
 	
 	// DEBUG INPUTS
 
@@ -144,45 +168,91 @@ DLL_EXPORT void RunClientFrame(ClientSessionData& Context, ClientFrameRequestDat
 		clientState.bDrawUIDebug = !clientState.bDrawUIDebug;
 	}
 
-	// UI
-	
-	// Construct UI Tree and assign it a memory allocator
+	// Input capture: F4 starts or stops it. Frames are captured once the key is handled, so a replay never sees the key that stopped it.
+	if (clientState.Input.ActionKeyStateIs(ActionKey::KEY_FUNC4, ActionInputState::UP))
 	{
-		UIPartitionTree& tree = frameState.MainViewportUITree;
-		tree = {};
+		if (clientState.InputCaptureFile != nullptr)
+		{
+			StopInputCapture(clientState);
+		}
+		else
+		{
+			StartInputCapture(clientState, CLIENT_INPUT_CAPTURE_DEFAULT_PATH);
+		}
+	}
+	CaptureFrameInputs(clientState, FrameData);
 
-		// Allocate 4kB of memory for the purposes of building the UI tree, from the frame memory.
-		tree.Memory = MakeStackAllocator((ByteBuffer)frameState.FrameMemoryAllocator.Allocate(4096), 4096);
+	// Profiling: F2 pauses or resumes recording, F3 exports what was recorded.
+	if (clientState.Input.ActionKeyStateIs(ActionKey::KEY_FUNC2, ActionInputState::UP))
+	{
+		clientState.Profiler.bRecording = !clientState.Profiler.bRecording;
+	}
+	if (clientState.Input.ActionKeyStateIs(ActionKey::KEY_FUNC3, ActionInputState::UP))
+	{
+		ExportClientProfile(clientState.Profiler, CLIENT_PROFILE_DEFAULT_PATH);
 	}
 
+	// UI
+	// The Main Viewport's UI tree is retained across frames: each pass only redoes the parts whose inputs changed since the last frame.
+
 	// Perform Partition Pass
-	BuildFrameUIPartitionTree(clientState, frameState, true); // -> Main Viewport UI Tree ready for collision checks
+	{
+		CLIENT_PROFILE_STAGE(clientState.Profiler, ClientFrameStage::PARTITION_PASS);
+		UpdateUIPartitionTree(clientState); // -> Main Viewport UI Tree ready for collision checks
+	}
 	
 	// First Absolute Position pass before Interaction pass.
-	ProcessChildNodesAbsolutePosition_Recursive(*frameState.MainViewportUITree.RootNode);
-
-	// Perform interaction collision checks and determine which nodes, if any, are being interacted with and update their flag consequently.
-
-	// #TEST CODE Just use the mouse cursor. A more complex algorithm can come later, taking into account which viewport the cursor is on and
-	// a keyboard-based focus system.
+	{
+		CLIENT_PROFILE_STAGE(clientState.Profiler, ClientFrameStage::PARTITION_POSITIONS);
+		ProcessUITreeAbsolutePositions(clientState, clientState.MainViewportUITree);
+	}
 
-	if (clientState.Input.CursorViewport != VIEWPORT_ERROR_ID)
+	// Perform Interaction Pass, starting with the collision checks determining which node, if any, is being interacted with.
 	{
-		UIPartitionNode* InteractedNode = FindNodeAtPosition(frameState.MainViewportUITree, clientState.Input.CursorLocation);
-		InteractedNode->bIsInteracted = true;
+		CLIENT_PROFILE_STAGE(clientState.Profiler, ClientFrameStage::INTERACTION_PASS);
+		ProcessUIInteractions(clientState); // -> Main Viewport UI Tree ready for drawing. Client state mutated.
 	}
-	
-	// Perform Interaction Pass
-	BuildFrameUIPartitionTree(clientState, frameState, false); // -> Main Viewport UI Tree ready for drawing. Client state mutated.
 
 	// Second Absolute Position pass after Interaction pass and before Drawing.
-	ProcessChildNodesAbsolutePosition_Recursive(*frameState.MainViewportUITree.RootNode);
+	{
+		CLIENT_PROFILE_STAGE(clientState.Profiler, ClientFrameStage::INTERACTION_POSITIONS);
+		ProcessUITreeAbsolutePositions(clientState, clientState.MainViewportUITree);
+	}
 
 	// Output draw calls for this frame.
-	OutputDrawCalls(clientState, frameState);
+	{
+		CLIENT_PROFILE_STAGE(clientState.Profiler, ClientFrameStage::DRAW_CALLS);
+		OutputDrawCalls(clientState, frameState);
+	}
+
+	EndClientProfilerFrame(clientState.Profiler, frameStartTicks);
+}
+
+DLL_EXPORT bool ExportClientFrameProfile(ClientSessionData& Context, const char* FilePath)
+{
+	ClientSessionState& clientState = CastClientState(Context.PersistentMemoryBuffer.Memory);
+	return ExportClientProfile(clientState.Profiler, FilePath != nullptr ? FilePath : CLIENT_PROFILE_DEFAULT_PATH);
+}
+
+DLL_EXPORT bool StartInputCapture(ClientSessionData& Context, const char* FilePath)
+{
+	ClientSessionState& clientState = CastClientState(Context.PersistentMemoryBuffer.Memory);
+	return StartInputCapture(clientState, FilePath != nullptr ? FilePath : CLIENT_INPUT_CAPTURE_DEFAULT_PATH);
+}
+
+DLL_EXPORT void StopInputCapture(ClientSessionData& Context)
+{
+	ClientSessionState& clientState = CastClientState(Context.PersistentMemoryBuffer.Memory);
+	StopInputCapture(clientState);
 }
 
 DLL_EXPORT void ShutdownClient(ClientSessionData& Context)
 {
 	std::cout << "Shutting down client.\n";
+
+	ClientSessionState& clientState = CastClientState(Context.PersistentMemoryBuffer.Memory);
+	StopInputCapture(clientState);
+
+	// Worker threads run code of this library, which the platform may unload once the client is shut down.
+	ShutdownJobSystem(clientState.Jobs);
 }
\ No newline at end of file
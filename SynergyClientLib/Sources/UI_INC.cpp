@@ -5,6 +5,9 @@ SOURCE_INC_FILE()
 
 #include "Client.h"
 
+#include <algorithm>
+#include <math.h>
+
 UIPartitionNode *FindNodeAtPosition(UIPartitionTree Tree, Vector2s ViewportPosition)
 {
 	// Go down the tree level by level, checking the Viewport Position against the bounding rectangle of each element.
@@ -39,125 +42,499 @@ UIPartitionNode *FindNodeAtPosition(UIPartitionTree Tree, Vector2s ViewportPosit
     return hitNode;
 }
 
+// Gives a representation to a node if there is room left, placing it at random over the view space.
+static void AddNodeRepresentation(ClientSessionState& Client, SNodeGUID NodeID)
+{
+	for (GraphNodeRepresentationData& nodePresentation : Client.NodeRepresentations)
+	{
+		if (nodePresentation.nodeID == SNODE_INVALID_ID)
+		{
+			nodePresentation = {
+				NodeID,
+				Vector2f { (float)(rand() % 400), float(rand() % 400) },
+			};
+			Client.NodeRepresentationsVersion++;
+			return;
+		}
+	}
+}
+
+// Removes the representation of a node if it has one, moving the last one in its place to keep the buffer packed.
+static void RemoveNodeRepresentation(ClientSessionState& Client, SNodeGUID NodeID)
+{
+	constexpr size_t maxRepresentationCount = sizeof(Client.NodeRepresentations) / sizeof(GraphNodeRepresentationData);
+
+	size_t count = 0;
+	size_t removedIndex = maxRepresentationCount;
+	for (; count < maxRepresentationCount && Client.NodeRepresentations[count].nodeID != SNODE_INVALID_ID; count++)
+	{
+		if (Client.NodeRepresentations[count].nodeID == NodeID)
+		{
+			removedIndex = count;
+		}
+	}
+
+	if (removedIndex != maxRepresentationCount)
+	{
+		Client.NodeRepresentations[removedIndex] = Client.NodeRepresentations[count - 1];
+		Client.NodeRepresentations[count - 1].nodeID = SNODE_INVALID_ID;
+		Client.NodeRepresentationsVersion++;
+	}
+}
+
+void UpdateNodeRepresentations(ClientSessionState& Client)
+{
+	bool bResync = false;
+
+	// Only creations and deletions matter to representations for now. Past a resync nothing else does, everything gets rebuilt.
+	Client.Graph->Changes.Read(Client.NodeRepresentationsChangeCursor, [&](const SGraphChange& Change)
+	{
+		if (bResync) return;
+
+		switch (Change.Kind)
+		{
+		case SGraphChangeKind::NODE_CREATED:
+			AddNodeRepresentation(Client, Change.NodeID);
+			break;
+		case SGraphChangeKind::NODE_DELETED:
+			RemoveNodeRepresentation(Client, Change.NodeID);
+			if (Client.SelectedGraphNodeID == Change.NodeID)
+			{
+				Client.SelectedGraphNodeID = SNODE_INVALID_ID;
+			}
+			break;
+		case SGraphChangeKind::RESYNC:
+			bResync = true;
+			break;
+		default:
+			break;
+		}
+	});
+
+	if (!bResync)
+	{
+		return;
+	}
+
+	// Collect the first existing nodes, as many as there are representations. Only the store's flags column gets scanned.
+	for (GraphNodeRepresentationData& nodePresentation : Client.NodeRepresentations)
+	{
+		nodePresentation.nodeID = SNODE_INVALID_ID;
+	}
+	Client.NodeRepresentationsVersion++;
+	constexpr size_t maxRepresentationCount = sizeof(Client.NodeRepresentations) / sizeof(GraphNodeRepresentationData);
+	size_t nodeCount = 0;
+	Client.Graph->DataStore.ForEachNode([&](SNodeGUID NodeID)
+	{
+		if (nodeCount < maxRepresentationCount)
+		{
+			AddNodeRepresentation(Client, NodeID);
+			nodeCount++;
+		}
+	});
+
+	if (!Client.Graph->DataStore.NodeExists(Client.SelectedGraphNodeID))
+	{
+		Client.SelectedGraphNodeID = SNODE_INVALID_ID;
+	}
+}
+
+// RETAINED UI TREE
+
 /*
-	Double-use function performing, in this order, the Partition pass followed by the Interaction pass.
-	Partition pass is in charge of initially building the UI tree. By the end of the pass, every UI element must have a position and dimensions
-	assigned relative to the entire viewport.
+	HOW IT WORKS
+
+	Every frame goes through two passes over the Main Viewport's UI tree.
+	Partition pass is in charge of building the UI tree. By the end of the pass, every UI element must have a position and dimensions
+	assigned relative to its parent, absolute positions following right after.
 
 	Interaction pass happens after processing which node is currently being in focus / interaction (usually meaning the mouse cursor is on top of it),
 	giving a chance for the UI to mutate itself and the overall Client state before the frame gets drawn.
 
 	It might have been possible to make it single-pass, but I wasn't satisfied with the idea of using the previous frame's UI collision test results.
 	In a way this is more "immediate" to me than what the traditional single-pass approach to immediate mode UI is.
+
+	The tree is retained across frames though, and remembers the inputs it reflects so that passes only redo what depends on inputs that changed:
+	- Viewport dimensions: the panels' layout, and the graph view panel's children as it clips them.
+	- Node representations, graph view camera: the graph view panel's children.
+	- Selection: the presentation of graph nodes.
+	- Cursor, or positions of any node: the hit test finding the interacted node.
+	Subtrees rebuilt get their positions marked dirty, and only those are recomputed. A frame with nothing new to show only compares inputs.
 */
-void BuildFrameUIPartitionTree(ClientSessionState& Client, ClientFrameState& Frame, const bool bIsPartitionPass)
+
+// Children of the root node, by index.
+constexpr size_t MAIN_VIEWPORT_TOP_PANEL = 0;
+constexpr size_t MAIN_VIEWPORT_LEFT_PANEL = 1;
+constexpr size_t MAIN_VIEWPORT_GRAPH_VIEW_PANEL = 2;
+constexpr size_t MAIN_VIEWPORT_PANEL_COUNT = 3;
+
+// Allocates every node the tree can have at once: the root, its panels, and as many graph view children as there can be representations.
+static void AllocateMainViewportUITree(ClientSessionState& Client)
 {
-	UIPartitionTree& Tree = Frame.MainViewportUITree;
-	
-	// Helper function for allocating new nodes from this tree and automatically setting up the parent - child relationships.
-	auto AllocChildren = [&Tree, bIsPartitionPass](UIPartitionNode& Parent, size_t Count = 1)
+	UIPartitionTree& tree = Client.MainViewportUITree;
+	constexpr size_t maxRepresentationCount = sizeof(Client.NodeRepresentations) / sizeof(GraphNodeRepresentationData);
+
+	tree.RootNode = tree.Memory.Allocate<UIPartitionNode>();
+	*tree.RootNode = {};
+	UIPartitionNode& root = *tree.RootNode;
+
+	root.Children = tree.Memory.Allocate<UIPartitionNode>(MAIN_VIEWPORT_PANEL_COUNT);
+	root.ChildCount = MAIN_VIEWPORT_PANEL_COUNT;
+	for (size_t childIndex = 0; childIndex < MAIN_VIEWPORT_PANEL_COUNT; childIndex++)
 	{
-		if (!bIsPartitionPass) return; // Do nothing if not in partition pass.
+		root.Children[childIndex] = {};
+		root.Children[childIndex].Parent = &root;
+	}
 
-		// ASSERT FATAL IF PARENT ALREADY HAS CHILDREN (Can't grow the children buffer dynamically. If you need a dynamic number of children, determine their count in advance.)
-		Parent.Children = Tree.Memory.Allocate<UIPartitionNode>(Count);
-		Parent.ChildCount = Count;
-		for (size_t childIndex = 0; childIndex < Count; childIndex++)
-		{
-			Parent.Children[childIndex].Parent = &Parent;
-		}
-	};
+	// Graph nodes are rebuilt in place, their count changing with the representations.
+	root.Children[MAIN_VIEWPORT_GRAPH_VIEW_PANEL].Children = tree.Memory.Allocate<UIPartitionNode>(maxRepresentationCount);
+}
 
-	// Separate boolean for readability.
-	// #NOTE: You can also directly use the bIsInteracted member of a node since it can only be true during the interaction pass.
-	const bool bIsInteractionPass = !bIsPartitionPass;
+// Lays out the root and its panels, which only depend on the viewport's dimensions.
+static void LayoutMainViewportPanels(ClientSessionState& Client)
+{
+	UIPartitionTree& tree = Client.MainViewportUITree;
+	UIPartitionNode& root = *tree.RootNode;
+	UIPartitionNode& topPanel = root.Children[MAIN_VIEWPORT_TOP_PANEL];
+	UIPartitionNode& leftPanel = root.Children[MAIN_VIEWPORT_LEFT_PANEL];
+	UIPartitionNode& graphViewPanel = root.Children[MAIN_VIEWPORT_GRAPH_VIEW_PANEL];
 
 	// ROOT NODE
+	// A single viewport-spanning node.
+	root.RelativePosition = {};
+	root.Dimensions = Client.MainViewport.Dimensions;
+
+	// TOP PANEL
+	topPanel.RelativePosition = { }; // Top left corner
+	topPanel.Dimensions = { Client.MainViewport.Dimensions.x, // Entire width
+							(int16_t)(Client.MainViewport.Dimensions.y * 0.2f) // Fifth of height
+	};
+	topPanel.PresentationDef = &Client.UINodePresentations.GenericPanel;
+
+	// LEFT PANEL
+	leftPanel.RelativePosition = { 0, topPanel.Dimensions.y }; // Top left below top panel
+	leftPanel.Dimensions = { (int16_t)(Client.MainViewport.Dimensions.x * 0.2f), // Fifth of width
+							(int16_t)(Client.MainViewport.Dimensions.y - topPanel.Dimensions.y) // Entire height minus top panel.
+	};
+	leftPanel.PresentationDef = &Client.UINodePresentations.GenericPanel;
+
+	// GRAPH VIEW PANEL
+	graphViewPanel.RelativePosition = { leftPanel.Dimensions.x, topPanel.Dimensions.y }; // Top left below top panel to the right of left panel.
+	graphViewPanel.Dimensions = { (int16_t)(Client.MainViewport.Dimensions.x - leftPanel.Dimensions.x), // Entire width minus left panel
+								(int16_t)(Client.MainViewport.Dimensions.y - topPanel.Dimensions.y)
+	}; // Entire height minus top panel
+	graphViewPanel.PresentationDef = &Client.UINodePresentations.GraphViewPanel;
+
+	MarkUINodePositionsDirty(tree, root);
+	Client.MainViewportUIInputs.ViewportDimensions = Client.MainViewport.Dimensions;
+}
+
+// Gives every graph node the presentation matching the current selection.
+static void UpdateGraphNodePresentations(ClientSessionState& Client)
+{
+	UIPartitionNode& graphViewPanel = Client.MainViewportUITree.RootNode->Children[MAIN_VIEWPORT_GRAPH_VIEW_PANEL];
+	for (size_t childIndex = 0; childIndex < graphViewPanel.ChildCount; childIndex++)
 	{
-		if (bIsPartitionPass)
-		{
-			// Create root node as a single viewport-spanning node.
-			Tree.RootNode = Tree.Memory.Allocate<UIPartitionNode>(); 	// Lacking a parent, the helper function can't be used. 
-																			// This probably has some sort of deeper meaning I didn't intend.
-			Tree.RootNode->RelativePosition = {};
-			Tree.RootNode->Dimensions = Client.MainViewport.Dimensions;
-		}
-		UIPartitionNode& root = *Tree.RootNode;
+		graphViewPanel.Children[childIndex].PresentationDef = Client.SelectedGraphNodeID == Client.NodeRepresentations[Client.GraphViewNodeRepresentations[childIndex]].nodeID ?
+			&Client.UINodePresentations.GraphNode_Selected : &Client.UINodePresentations.GraphNode;
+	}
+	Client.MainViewportUIInputs.SelectedNodeID = Client.SelectedGraphNodeID;
+}
 
-		AllocChildren(root, 3);
-		UIPartitionNode& topPanel = root.Children[0];
-		UIPartitionNode& leftPanel = root.Children[1];
-		UIPartitionNode& graphViewPanel = root.Children[2];
+// GRAPH VIEW CULLING
 
-		// TOP PANEL
-		if (bIsPartitionPass)
+/*
+	HOW IT WORKS
+
+	Only graph nodes overlapping the graph view panel get a UI node, so that those out of sight cost neither layout, hit tests nor draw calls.
+	Rather than testing every representation, the panel's rectangle is brought back to view space through the camera, grown by half a
+	graph node on every side, and the spatial index gives the representations located in it. Those still get tested against the panel
+	once placed, the index only narrowing down candidates.
+
+	The index hashes view space cells into buckets, so view space needn't be bounded. When the queried rectangle spans more cells than there
+	are buckets, as when zoomed far out, walking buckets wouldn't save anything and every representation is tested instead.
+*/
+
+static int32_t GetGraphViewIndexCell(float ViewSpaceCoordinate)
+{
+	return (int32_t)floorf(ViewSpaceCoordinate / CLIENT_GRAPH_VIEW_INDEX_CELL_SIZE);
+}
+
+static size_t GetGraphViewIndexBucket(int32_t CellX, int32_t CellY)
+{
+	static_assert((CLIENT_GRAPH_VIEW_INDEX_BUCKET_COUNT & (CLIENT_GRAPH_VIEW_INDEX_BUCKET_COUNT - 1)) == 0,
+		"CLIENT_GRAPH_VIEW_INDEX_BUCKET_COUNT must be a power of two.");
+	return ((uint32_t)CellX * 73856093u ^ (uint32_t)CellY * 19349663u) & (CLIENT_GRAPH_VIEW_INDEX_BUCKET_COUNT - 1);
+}
+
+// Files every node representation under the bucket of its cell.
+static void BuildGraphViewSpatialIndex(ClientSessionState& Client)
+{
+	GraphViewSpatialIndex& index = Client.NodeRepresentationsIndex;
+	for (int32_t& bucketHead : index.BucketHeads)
+	{
+		bucketHead = -1;
+	}
+
+	for (size_t repIndex = 0; repIndex < CLIENT_NODE_REPRESENTATION_MAX_COUNT; repIndex++)
+	{
+		const GraphNodeRepresentationData& nodePresentation = Client.NodeRepresentations[repIndex];
+		if (nodePresentation.nodeID == SNODE_INVALID_ID) break; // End of buffer reached.
+
+		const size_t bucket = GetGraphViewIndexBucket(GetGraphViewIndexCell(nodePresentation.viewSpaceLocation.x),
+			GetGraphViewIndexCell(nodePresentation.viewSpaceLocation.y));
+		index.NextInBucket[repIndex] = index.BucketHeads[bucket];
+		index.BucketHeads[bucket] = (int32_t)repIndex;
+	}
+
+	index.BuiltVersion = Client.NodeRepresentationsVersion;
+	index.bBuilt = true;
+}
+
+/*
+	Writes the indices of the node representations located inside the given view space rectangle, in representation order, and returns
+	how many there are. The output must have room for every representation.
+*/
+static size_t QueryGraphViewSpatialIndex(const ClientSessionState& Client, Vector2f Min, Vector2f Max, uint32_t* OutRepresentations)
+{
+	const GraphViewSpatialIndex& index = Client.NodeRepresentationsIndex;
+	auto isInside = [&](const Vector2f& Location)
+	{
+		return Location.x >= Min.x && Location.x <= Max.x && Location.y >= Min.y && Location.y <= Max.y;
+	};
+
+	// Cell bounds are computed in floating point first, as a far away or zoomed out rectangle can span more cells than an int holds.
+	const float cellSpanX = floorf(Max.x / CLIENT_GRAPH_VIEW_INDEX_CELL_SIZE) - floorf(Min.x / CLIENT_GRAPH_VIEW_INDEX_CELL_SIZE) + 1.f;
+	const float cellSpanY = floorf(Max.y / CLIENT_GRAPH_VIEW_INDEX_CELL_SIZE) - floorf(Min.y / CLIENT_GRAPH_VIEW_INDEX_CELL_SIZE) + 1.f;
+
+	size_t count = 0;
+	if (!(cellSpanX * cellSpanY <= (float)CLIENT_GRAPH_VIEW_INDEX_BUCKET_COUNT))
+	{
+		for (size_t repIndex = 0; repIndex < CLIENT_NODE_REPRESENTATION_MAX_COUNT; repIndex++)
 		{
-			topPanel.RelativePosition = { }; // Top left corner
-			topPanel.Dimensions = { Client.MainViewport.Dimensions.x, // Entire width
-									(int16_t)(Client.MainViewport.Dimensions.y * 0.2f) // Fifth of height
-			};
+			const GraphNodeRepresentationData& nodePresentation = Client.NodeRepresentations[repIndex];
+			if (nodePresentation.nodeID == SNODE_INVALID_ID) break; // End of buffer reached.
+			if (isInside(nodePresentation.viewSpaceLocation))
+			{
+				OutRepresentations[count++] = (uint32_t)repIndex;
+			}
+		}
+		return count;
+	}
 
-			topPanel.PresentationDef = &Client.UINodePresentations.GenericPanel;
+	// Several cells can share a bucket, so representations are only taken from the cell being walked, which also keeps them unique.
+	const int32_t minCellX = GetGraphViewIndexCell(Min.x);
+	const int32_t maxCellX = GetGraphViewIndexCell(Max.x);
+	const int32_t minCellY = GetGraphViewIndexCell(Min.y);
+	const int32_t maxCellY = GetGraphViewIndexCell(Max.y);
+	for (int32_t cellY = minCellY; cellY <= maxCellY; cellY++)
+	{
+		for (int32_t cellX = minCellX; cellX <= maxCellX; cellX++)
+		{
+			for (int32_t repIndex = index.BucketHeads[GetGraphViewIndexBucket(cellX, cellY)]; repIndex >= 0; repIndex = index.NextInBucket[repIndex])
+			{
+				const Vector2f& location = Client.NodeRepresentations[repIndex].viewSpaceLocation;
+				if (GetGraphViewIndexCell(location.x) == cellX && GetGraphViewIndexCell(location.y) == cellY && isInside(location))
+				{
+					OutRepresentations[count++] = (uint32_t)repIndex;
+				}
+			}
 		}
+	}
+
+	// Graph nodes draw in representation order, whatever cells they came from.
+	std::sort(OutRepresentations, OutRepresentations + count);
+	return count;
+}
+
+// Rebuilds the graph view panel's children, one per graph node representation in sight of the camera, in representation order.
+static void BuildGraphViewNodes(ClientSessionState& Client)
+{
+	UIPartitionTree& tree = Client.MainViewportUITree;
+	UIPartitionNode& graphViewPanel = tree.RootNode->Children[MAIN_VIEWPORT_GRAPH_VIEW_PANEL];
+	const GraphViewCameraData& camera = Client.GraphViewCamera;
+
+	if (!Client.NodeRepresentationsIndex.bBuilt || Client.NodeRepresentationsIndex.BuiltVersion != Client.NodeRepresentationsVersion)
+	{
+		BuildGraphViewSpatialIndex(Client);
+	}
+
+	// View space seen by the panel, grown by half a graph node so that nodes partly in sight are found too.
+	const float nodeHalfSize = CLIENT_GRAPH_VIEW_NODE_SIZE / 2.f;
+	const Vector2f viewMin = camera.Origin - Vector2f { nodeHalfSize, nodeHalfSize };
+	const Vector2f viewMax = camera.Origin + Vector2f { graphViewPanel.Dimensions.x / camera.Zoom + nodeHalfSize,
+		graphViewPanel.Dimensions.y / camera.Zoom + nodeHalfSize };
 
-		// LEFT PANEL
-		if (bIsPartitionPass)
+	uint32_t candidates[CLIENT_NODE_REPRESENTATION_MAX_COUNT];
+	const size_t candidateCount = QueryGraphViewSpatialIndex(Client, viewMin, viewMax, candidates);
+
+	size_t childIndex = 0;
+	for (size_t candidateIndex = 0; candidateIndex < candidateCount; candidateIndex++)
+	{
+		const GraphNodeRepresentationData& nodePresentation = Client.NodeRepresentations[candidates[candidateIndex]];
+		UIPartitionNode& graphNodeUINode = graphViewPanel.Children[childIndex];
+
+		graphNodeUINode = {};
+		graphNodeUINode.Parent = &graphViewPanel;
+		graphNodeUINode.Dimensions = { (int16_t)(CLIENT_GRAPH_VIEW_NODE_SIZE * camera.Zoom), (int16_t)(CLIENT_GRAPH_VIEW_NODE_SIZE * camera.Zoom) };
+		graphNodeUINode.RelativePosition = (nodePresentation.viewSpaceLocation - camera.Origin) * camera.Zoom - graphNodeUINode.Dimensions / 2;
+
+		// Clip against the panel once placed, the slot being reused by the next candidate if out of it.
+		const Vector2s rectEnd = graphNodeUINode.RelativePosition + graphNodeUINode.Dimensions;
+		if (rectEnd.x < 0 || rectEnd.y < 0
+			|| graphNodeUINode.RelativePosition.x > graphViewPanel.Dimensions.x || graphNodeUINode.RelativePosition.y > graphViewPanel.Dimensions.y)
 		{
-			leftPanel.RelativePosition = { 0, topPanel.Dimensions.y }; // Top left below top panel
-			leftPanel.Dimensions = { (int16_t)(Client.MainViewport.Dimensions.x * 0.2f), // Fifth of width
-									(int16_t)(Client.MainViewport.Dimensions.y - topPanel.Dimensions.y) // Entire height minus top panel.
-			};
+			continue;
+		}
+
+		Client.GraphViewNodeRepresentations[childIndex++] = candidates[candidateIndex];
+	}
+	graphViewPanel.ChildCount = childIndex;
+
+	UpdateGraphNodePresentations(Client);
+	MarkUINodePositionsDirty(tree, graphViewPanel);
+	Client.MainViewportUIInputs.NodeRepresentationsVersion = Client.NodeRepresentationsVersion;
+	Client.MainViewportUIInputs.GraphViewCamera = camera;
+}
+
+void UpdateUIPartitionTree(ClientSessionState& Client)
+{
+	UIPartitionTree& tree = Client.MainViewportUITree;
+	const auto& inputs = Client.MainViewportUIInputs;
+
+	const bool bFirstBuild = tree.RootNode == nullptr;
+	if (bFirstBuild)
+	{
+		AllocateMainViewportUITree(Client);
+	}
+
+	const bool bLayoutChanged = bFirstBuild || inputs.ViewportDimensions != Client.MainViewport.Dimensions;
+	if (bLayoutChanged)
+	{
+		LayoutMainViewportPanels(Client);
+	}
+
+	if (bLayoutChanged || inputs.NodeRepresentationsVersion != Client.NodeRepresentationsVersion
+		|| inputs.GraphViewCamera.Origin != Client.GraphViewCamera.Origin || inputs.GraphViewCamera.Zoom != Client.GraphViewCamera.Zoom)
+	{
+		BuildGraphViewNodes(Client);
+	}
+	else if (inputs.SelectedNodeID != Client.SelectedGraphNodeID)
+	{
+		// Selection changed outside of the UI, as when the selected node was deleted.
+		UpdateGraphNodePresentations(Client);
+	}
+}
 
-			leftPanel.PresentationDef = &Client.UINodePresentations.GenericPanel;
+void ProcessUIInteractions(ClientSessionState& Client)
+{
+	UIPartitionTree& tree = Client.MainViewportUITree;
+	auto& inputs = Client.MainViewportUIInputs;
+
+	// HIT TEST
+	// #TEST CODE Just use the mouse cursor. A more complex algorithm can come later, taking into account which viewport the cursor is on and
+	// a keyboard-based focus system.
+	if (tree.bHitTestDirty || inputs.CursorLocation != Client.Input.CursorLocation || inputs.CursorViewport != Client.Input.CursorViewport)
+	{
+		if (tree.InteractedNode != nullptr)
+		{
+			tree.InteractedNode->bIsInteracted = false;
+			tree.InteractedNode = nullptr;
 		}
 
-		// GRAPH VIEW PANEL
-		
-		if (bIsPartitionPass)
+		if (Client.Input.CursorViewport != VIEWPORT_ERROR_ID)
 		{
-			graphViewPanel.RelativePosition = { leftPanel.Dimensions.x, topPanel.Dimensions.y }; // Top left below top panel to the right of left panel.
-			graphViewPanel.Dimensions = { (int16_t)(Client.MainViewport.Dimensions.x - leftPanel.Dimensions.x), // Entire width minus left panel
-										(int16_t)(Client.MainViewport.Dimensions.y - topPanel.Dimensions.y) 
-			}; // Entire height minus top panel
+			tree.InteractedNode = FindNodeAtPosition(tree, Client.Input.CursorLocation);
+			tree.InteractedNode->bIsInteracted = true;
+		}
 
-			graphViewPanel.PresentationDef = &Client.UINodePresentations.GraphViewPanel;
+		inputs.CursorLocation = Client.Input.CursorLocation;
+		inputs.CursorViewport = Client.Input.CursorViewport;
+		tree.bHitTestDirty = false;
+	}
 
-			size_t nodeCount = 0;
-			// For each Graph Node Representation available, draw it.
-			for (GraphNodeRepresentationData& nodePresentation : Client.NodeRepresentations)
-			{
-				if (nodePresentation.nodeID == SNODE_INVALID_ID) break; // End of buffer reached.
+	// GRAPH NODES
+	// Clicking a graph node selects it.
+	UIPartitionNode& graphViewPanel = tree.RootNode->Children[MAIN_VIEWPORT_GRAPH_VIEW_PANEL];
+	if (tree.InteractedNode != nullptr && tree.InteractedNode->Parent == &graphViewPanel
+		&& Client.Input.ActionKeyStateIs(ActionKey::MOUSE_LEFT, ActionInputState::UP))
+	{
+		const uint32_t repIndex = Client.GraphViewNodeRepresentations[tree.InteractedNode - graphViewPanel.Children];
+		Client.SelectedGraphNodeID = Client.NodeRepresentations[repIndex].nodeID;
+	}
 
-				nodeCount++;
-			}
+	if (inputs.SelectedNodeID != Client.SelectedGraphNodeID)
+	{
+		UpdateGraphNodePresentations(Client);
+	}
+}
 
-			// Allocate one child node per graph node.
-			AllocChildren(graphViewPanel, nodeCount);
-		}
+// ABSOLUTE POSITIONS
 
-		
-		size_t childIndex = 0;
+struct UIPositionsJobData
+{
+	ClientSessionState* Client;
+	UIPartitionNode* Node;
+};
 
-		// GRAPH NODES
-		for (GraphNodeRepresentationData& nodePresentation : Client.NodeRepresentations)
-		{
-			if (nodePresentation.nodeID == SNODE_INVALID_ID) break; // End of buffer reached.
-			UIPartitionNode& graphNodeUINode = graphViewPanel.Children[childIndex++];
+static void ProcessSubtreeAbsolutePositions(ClientSessionState& Client, UIPartitionNode& Node, uint32_t WorkerIndex);
 
-			if (bIsPartitionPass)
-			{
-				graphNodeUINode.Dimensions = { 50, 50 };
-				graphNodeUINode.RelativePosition = nodePresentation.viewSpaceLocation - graphNodeUINode.Dimensions / 2;
-			}
+static void ProcessChildrenAbsolutePositions(const SJobContext& Context, size_t Begin, size_t End, void* Data)
+{
+	const UIPositionsJobData& jobData = *(const UIPositionsJobData*)Data;
+	CLIENT_PROFILE_ZONE(jobData.Client->Profiler.Threads[Context.WorkerIndex], "UI Positions");
 
-			graphNodeUINode.PresentationDef = Client.SelectedGraphNodeID == nodePresentation.nodeID ?
-													&Client.UINodePresentations.GraphNode_Selected : &Client.UINodePresentations.GraphNode;
+	for (size_t childNodeIndex = Begin; childNodeIndex < End; childNodeIndex++)
+	{
+		UIPartitionNode& child = jobData.Node->Children[childNodeIndex];
+		child.AbsolutePosition = jobData.Node->AbsolutePosition + child.RelativePosition;
+		child.bPositionsDirty = false;
+		ProcessSubtreeAbsolutePositions(*jobData.Client, child, Context.WorkerIndex);
+	}
+}
 
-			if (graphNodeUINode.bIsInteracted && Client.Input.ActionKeyStateIs(ActionKey::MOUSE_LEFT, ActionInputState::UP))
-			{
-				Client.SelectedGraphNodeID = nodePresentation.nodeID;
-			}
+static void ProcessSubtreeAbsolutePositions(ClientSessionState& Client, UIPartitionNode& Node, uint32_t WorkerIndex)
+{
+	if (Node.ChildCount < CLIENT_UI_PARALLEL_MIN_CHILD_COUNT)
+	{
+		for (size_t childNodeIndex = 0; childNodeIndex < Node.ChildCount; childNodeIndex++)
+		{
+			UIPartitionNode& child = Node.Children[childNodeIndex];
+			child.AbsolutePosition = Node.AbsolutePosition + child.RelativePosition;
+			child.bPositionsDirty = false;
+			ProcessSubtreeAbsolutePositions(Client, child, WorkerIndex);
 		}
-		
+		return;
 	}
-}
\ No newline at end of file
+
+	// Children only write their own subtree, so batches of them never touch the same node.
+	UIPositionsJobData jobData = { &Client, &Node };
+	RunParallelFor(Client.Jobs, WorkerIndex, Node.ChildCount, CLIENT_UI_PARALLEL_MIN_CHILD_COUNT / 2, ProcessChildrenAbsolutePositions, &jobData);
+}
+
+// Goes down to the nodes whose positions are dirty and recomputes their subtrees. Nodes above them kept their positions.
+static void ProcessDirtyAbsolutePositions(ClientSessionState& Client, UIPartitionNode& Node)
+{
+	if (Node.bPositionsDirty)
+	{
+		Node.bPositionsDirty = false;
+		ProcessSubtreeAbsolutePositions(Client, Node, 0);
+		return;
+	}
+
+	for (size_t childNodeIndex = 0; childNodeIndex < Node.ChildCount; childNodeIndex++)
+	{
+		ProcessDirtyAbsolutePositions(Client, Node.Children[childNodeIndex]);
+	}
+}
+
+void ProcessUITreeAbsolutePositions(ClientSessionState& Client, UIPartitionTree& Tree)
+{
+	if (!Tree.bPositionsDirty)
+	{
+		return;
+	}
+
+	ProcessDirtyAbsolutePositions(Client, *Tree.RootNode);
+	Tree.bPositionsDirty = false;
+}
@@ -4,14 +4,13 @@
 #define SYNERGY_GRAPH_INCLUDED
 
 #include <stdint.h>
+#include <string_view>
 
 // Unique identifier for a node across its entire Tree.
 typedef uint64_t SNodeGUID;
 // Invalid Node ID used to represent non-existent nodes or invalid operation results.
 constexpr SNodeGUID SNODE_INVALID_ID = ~0;
 
-typedef char NodeName[64];
-
 /*
 	Structured representation of a node.
 	This *represents* a node in a readable, structured format, but it is probably not the format the
@@ -25,8 +24,9 @@ struct SNodeDef
 	// ID of the parent node if any.
 	SNodeGUID parentID = SNODE_INVALID_ID;
 
-	// Name of the node.
-	NodeName name;
+	// Name of the node. When obtained from a graph, views the graph's name pool and stays valid until the node drops the name and the
+	// graph reclaims it, see SNamePool. Transactions keep the names of the nodes they involve.
+	std::string_view name;
 };
 
 // Defines the access level of a node connection.
@@ -0,0 +1,61 @@
+// Streaming bulk loader filling a Graph Store from a line-oriented node / connection file, bypassing edit transactions entirely.
+// Meant for seeding large graphs at deployment time.
+
+#ifndef SYNERGY_GRAPH_BULK_LOAD_INCLUDED
+#define SYNERGY_GRAPH_BULK_LOAD_INCLUDED
+
+#include "SynergyGraphStore.h"
+
+/*
+	BULK FILE FORMAT
+
+	One record per line. Blank lines and lines starting with '#' are ignored. Fields are separated by single spaces.
+
+	N <key> <parent> <accessToParent> <accessFromParent> <name>
+		Declares a node. Keys are local to the file and must cover [0, NodeCount[ exactly once, in any order.
+		The node gets the ID <first reserved ID> + <key>.
+		<parent> is either the key of another node of the file, '@<GUID>' for a node already in the store, or '-' for the root node.
+		Only one root may be declared, and only when loading into an empty store.
+		Access levels are numeric values of SNodeConnectionAccessLevel (1 = PRIVATE ... 4 = OPEN).
+		<name> is the rest of the line.
+
+	E <src> <dest> <accessLevel>
+		Declares a connection from src to dest. Both are keys or '@<GUID>'.
+		Connections may not duplicate each other or implicit parent - child connections.
+*/
+
+struct SGraphBulkLoadOptions
+{
+	// Size of the blocks the file is read in. Lines may not be longer than this.
+	size_t ChunkSize = 8 * 1024 * 1024;
+
+	// Number of threads parsing every chunk. 0 uses one per hardware thread.
+	uint32_t ThreadCount = 0;
+};
+
+struct SGraphBulkLoadResult
+{
+	bool bSuccess = false;
+
+	size_t NodeCount = 0;
+	size_t ConnectionCount = 0;
+
+	// First ID of the range assigned to the loaded nodes. Node with key K gets FirstNodeID + K.
+	SNodeGUID FirstNodeID = SNODE_INVALID_ID;
+
+	// ID of the root node if the file declared one.
+	SNodeGUID RootNodeID = SNODE_INVALID_ID;
+
+	// On failure, line the error was found on (0 if not tied to a line) and description.
+	size_t ErrorLine = 0;
+	char Error[128] = {};
+};
+
+/*
+	Loads the passed file into the store. The file is read in chunks that are parsed in parallel, then the whole content is validated
+	before the store is touched: on failure the store is left unchanged.
+	Returns whether loading succeeded. Details are written to OutResult.
+*/
+bool BulkLoadGraph(SGraphStore& Store, const char* FilePath, const SGraphBulkLoadOptions& Options, SGraphBulkLoadResult& OutResult);
+
+#endif // SYNERGY_GRAPH_BULK_LOAD_INCLUDED
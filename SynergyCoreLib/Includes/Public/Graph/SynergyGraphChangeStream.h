@@ -0,0 +1,143 @@
+// Stream of the changes applied to a graph, letting derived structures follow the graph incrementally instead of rescanning it.
+
+#ifndef SYNERGY_GRAPH_CHANGE_STREAM_INCLUDED
+#define SYNERGY_GRAPH_CHANGE_STREAM_INCLUDED
+
+#include "SynergyGraph.h"
+#include "SynergyNamePool.h"
+#include "SynergyCore.h"
+
+/*
+	HOW IT WORKS
+
+	Every applied transaction writes one delta record into a ring buffer: a TRANSACTION header giving the number of changes that follow,
+	then the changes themselves. There is a single writer, the graph, and any number of subscribers. A subscriber is nothing more than a
+	cursor into the stream, so subscribers consume at their own pace and the writer never waits for any of them.
+
+	A subscriber that falls more than a ring's worth of changes behind can't catch up anymore. It is handed a single RESYNC change instead,
+	meaning it has to rebuild its derived data from the graph itself, and its cursor jumps to the end of the stream.
+*/
+
+// Ring capacity, in changes, picked when a stream is initialized without an explicit one.
+constexpr size_t SGRAPH_DEFAULT_CHANGE_STREAM_CAPACITY = 4096;
+
+enum class SGraphChangeKind : uint8_t
+{
+	TRANSACTION, // Header of a transaction's changes. Value is the number of changes that follow, NodeID the transaction's sequence number.
+	NODE_CREATED, // NodeID was created under OtherID, SNODE_INVALID_ID for a root, and named Value.
+	NODE_DELETED, // NodeID was deleted along with all its connections. OtherID was its parent. Its children get their own PARENT_CHANGED.
+	NODE_RENAMED, // NodeID is now named Value.
+	PARENT_CHANGED, // NodeID now has OtherID for parent, SNODE_INVALID_ID if it has none.
+	CONNECTION_CHANGED, // Connection from NodeID to OtherID now has AccessLevel. NONE means it was deleted.
+	RESYNC, // The graph changed in ways the stream doesn't describe, or the subscriber fell behind. Derived data must be rebuilt.
+};
+
+// A single change, as packed in the stream.
+struct SGraphChange
+{
+	SGraphChangeKind Kind = SGraphChangeKind::RESYNC;
+	SNodeConnectionAccessLevel AccessLevel = SNodeConnectionAccessLevel::NONE;
+
+	// Name handle for NODE_CREATED and NODE_RENAMED, change count for TRANSACTION. See SGraphChangeKind.
+	uint32_t Value = 0;
+
+	SNodeGUID NodeID = SNODE_INVALID_ID;
+	SNodeGUID OtherID = SNODE_INVALID_ID;
+};
+
+// Position of a subscriber in a change stream. Get one from SGraphChangeStream::Subscribe.
+struct SGraphChangeCursor
+{
+	uint64_t Position = 0;
+};
+
+/*
+	Ring buffer of graph changes. All memory is taken from the allocator passed at initialization.
+	Not thread safe: changes must be read on the thread applying transactions, and never while one is being applied.
+*/
+struct SGraphChangeStream
+{
+	SGraphChange* Entries = nullptr;
+	// Power of two.
+	size_t Capacity = 0;
+
+	// Total number of changes ever written, headers included. Positions are taken modulo the capacity to index entries.
+	uint64_t WritePosition = 0;
+	// Position right after the last complete transaction. Readers never go past it.
+	uint64_t CommittedPosition = 0;
+
+	// Position of the header of the transaction being written, if any.
+	uint64_t OpenTransactionPosition = 0;
+	bool bTransactionOpen = false;
+	// Set when the open transaction has more changes than the ring can hold. It gets committed as a RESYNC.
+	bool bTransactionOverflowed = false;
+
+	// Cursors behind this position missed the changes of an overflowed transaction and are treated as overrun.
+	uint64_t DiscardedBefore = 0;
+
+	// Sequence number of the last committed transaction.
+	uint64_t TransactionSequence = 0;
+
+	/*
+		Returns how much memory Initialize will request from a Stack Allocator for the given capacity.
+		Capacity is rounded up to a power of two.
+	*/
+	static size_t GetRequiredMemorySize(size_t InCapacity = SGRAPH_DEFAULT_CHANGE_STREAM_CAPACITY);
+
+	/*
+		Allocates the ring from the passed allocator and resets the stream to an empty state.
+		Returns whether allocation succeeded.
+	*/
+	bool Initialize(MemoryAllocator& Allocator, size_t InCapacity = SGRAPH_DEFAULT_CHANGE_STREAM_CAPACITY);
+
+	// WRITING
+
+	// Opens a transaction. Changes pushed until the matching EndTransaction are only visible to subscribers once it is called.
+	void BeginTransaction();
+
+	// Adds a change to the open transaction.
+	void Push(const SGraphChange& Change);
+
+	// Commits the open transaction. Transactions that didn't push any change leave no trace in the stream.
+	void EndTransaction();
+
+	// Commits a transaction made of a single RESYNC change, for graph changes that bypass transactions such as bulk loads.
+	void PushResync();
+
+	// READING
+
+	// Returns a cursor positioned at the end of the stream, which will only see transactions committed from now on.
+	inline SGraphChangeCursor Subscribe() const { return { CommittedPosition }; }
+
+	// Returns whether the passed cursor has fallen too far behind to read the changes it missed.
+	inline bool IsOverrun(const SGraphChangeCursor& Cursor) const
+	{
+		return WritePosition - Cursor.Position > Capacity || Cursor.Position < DiscardedBefore;
+	}
+
+	/*
+		Calls Visitor(const SGraphChange&) for every change committed since the cursor's position, TRANSACTION headers included,
+		then moves the cursor to the end of the stream. An overrun cursor gets a single RESYNC change instead.
+		The visitor must not apply transactions to the graph. Returns the number of changes visited.
+	*/
+	template<typename VisitorType>
+	size_t Read(SGraphChangeCursor& Cursor, VisitorType&& Visitor) const
+	{
+		if (IsOverrun(Cursor))
+		{
+			Cursor.Position = CommittedPosition;
+			Visitor(SGraphChange {});
+			return 1;
+		}
+
+		const size_t mask = Capacity - 1;
+		size_t count = 0;
+		for (; Cursor.Position < CommittedPosition; Cursor.Position++, count++)
+		{
+			Visitor(Entries[Cursor.Position & mask]);
+		}
+		return count;
+	}
+};
+
+#endif // SYNERGY_GRAPH_CHANGE_STREAM_INCLUDED
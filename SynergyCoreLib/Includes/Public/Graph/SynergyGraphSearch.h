@@ -0,0 +1,152 @@
+// Search index over node names of a Graph Store, answering prefix and substring queries with ranked, paged results.
+
+#ifndef SYNERGY_GRAPH_SEARCH_INCLUDED
+#define SYNERGY_GRAPH_SEARCH_INCLUDED
+
+#include "SynergyGraphStore.h"
+
+/*
+	HOW IT WORKS
+
+	Names are lowercased and broken into grams, each of which heads a posting list of the nodes whose name contains it:
+	- Trigrams of every position, used by queries of 3 characters or more.
+	- Anchored grams: the first 1, 2 and 3 characters of every word, used by short queries and to narrow down prefix queries.
+	  Words are separated by spaces and punctuation.
+	A query only reads the smallest posting list among the grams it must contain, then checks every candidate against the node's current name.
+	That check is what ranks results, and it also makes stale postings harmless. Renamed nodes and deleted nodes only leave dead entries
+	behind that get dropped the next time the index rebuilds itself.
+
+	Posting lists are chains of fixed size blocks from a pool allocated at initialization. When the pool runs out the index rebuilds from
+	the store, and if that doesn't free enough room, searches fall back to scanning the store's name column until the next successful rebuild.
+*/
+
+// Posting entries reserved per node when the index is initialized without an explicit posting capacity.
+constexpr size_t SGRAPH_SEARCH_DEFAULT_POSTINGS_PER_NODE = 24;
+
+// Highest Offset + Count a query may ask for. Deeper pages aren't worth keeping ranking state around for.
+constexpr size_t SGRAPH_SEARCH_MAX_RANKED_RESULTS = 1024;
+
+enum class SGraphSearchMode : uint8_t
+{
+	PREFIX, // The query must appear at the start of a word of the name. Meant for type-ahead.
+	SUBSTRING, // The query may appear anywhere in the name. Queries shorter than 3 characters behave like PREFIX ones.
+};
+
+// How a result matched the query, from best to worst. Results are ranked by this first.
+enum class SGraphSearchMatchKind : uint8_t
+{
+	EXACT, // Whole name matches.
+	NAME_PREFIX, // Name starts with the query.
+	WORD_PREFIX, // A word of the name other than the first starts with the query.
+	SUBSTRING, // Query is found inside a word.
+};
+
+struct SGraphSearchQuery
+{
+	// Case insensitive, only ASCII letters get folded. Leading and trailing separators are ignored.
+	std::string_view Text;
+
+	SGraphSearchMode Mode = SGraphSearchMode::PREFIX;
+
+	// Page of ranked results to return. Offset + Count is clamped to SGRAPH_SEARCH_MAX_RANKED_RESULTS.
+	size_t Offset = 0;
+	size_t Count = 20;
+
+	// Upper bound on the candidates checked by a single query, so very common queries keep a bounded latency.
+	// When reached, results only cover the candidates checked so far and are flagged as truncated.
+	size_t MaxCandidates = 1 << 16;
+};
+
+struct SGraphSearchHit
+{
+	SNodeGUID NodeID = SNODE_INVALID_ID;
+	SGraphSearchMatchKind Kind = SGraphSearchMatchKind::SUBSTRING;
+
+	// Offset of the match in the node's name.
+	uint8_t MatchPosition = 0;
+};
+
+struct SGraphSearchResultInfo
+{
+	// Total number of matches found, across all pages.
+	size_t MatchCount = 0;
+	// Number of hits written to the output buffer.
+	size_t HitCount = 0;
+	// Whether the candidate limit was reached, in which case MatchCount is a lower bound.
+	bool bTruncated = false;
+	// Whether the index was unusable and the store had to be scanned.
+	bool bScanned = false;
+};
+
+/*
+	Search index over the names of a store's nodes. All memory is taken from the allocator passed at initialization.
+	The index isn't notified of store changes by the store itself: whoever changes names must call OnNodeNamed.
+*/
+struct SGraphSearchIndex
+{
+	// Posting list block, sized to a cache line.
+	struct PostingBlock
+	{
+		static constexpr uint32_t ENTRY_COUNT = 15;
+
+		uint32_t NodeIDs[ENTRY_COUNT];
+		uint32_t Next;
+	};
+
+	// Gram table slot. Key 0 marks empty slots, no gram encodes to 0.
+	struct GramSlot
+	{
+		uint32_t Key;
+		uint32_t FirstBlock;
+		uint32_t LastBlock;
+		uint32_t PostingCount;
+	};
+
+	const SGraphStore* Store = nullptr;
+
+	PostingBlock* Blocks = nullptr;
+	uint32_t BlockCapacity = 0;
+	uint32_t BlockCount = 0;
+
+	GramSlot* Grams = nullptr;
+	size_t GramCapacity = 0;
+	size_t GramCount = 0;
+
+	// Per node value of QueryStamp when the node was last checked by a query. Lets queries skip duplicate candidates without clearing anything.
+	uint32_t* SeenStamps = nullptr;
+	uint32_t QueryStamp = 0;
+
+	// Set when the index ran out of room even after rebuilding. Searches scan the store until a rebuild succeeds.
+	bool bDegraded = false;
+
+	/*
+		Returns how much memory Initialize will request from a Stack Allocator for the given capacities.
+		A posting capacity of 0 picks SGRAPH_SEARCH_DEFAULT_POSTINGS_PER_NODE per node.
+	*/
+	static size_t GetRequiredMemorySize(size_t MaxNodeCount, size_t PostingCapacity = 0);
+
+	/*
+		Allocates the index for the passed store, which must be initialized and outlive the index, then indexes the nodes it already holds.
+		Returns whether allocation succeeded.
+	*/
+	bool Initialize(MemoryAllocator& Allocator, const SGraphStore& InStore, size_t PostingCapacity = 0);
+
+	// Drops every posting and indexes all nodes of the store again. Returns false if the index ran out of room.
+	bool Rebuild();
+
+	// Indexes the current name of a node, after it got created or renamed.
+	void OnNodeNamed(SNodeGUID NodeID);
+
+	/*
+		Runs a query, writing its page of ranked hits to the passed buffer, up to its capacity.
+		Returns the number of hits written. Details are written to OutInfo.
+	*/
+	size_t Search(const SGraphSearchQuery& Query, SGraphSearchHit* OutHits, size_t HitCapacity, SGraphSearchResultInfo& OutInfo);
+
+	// Internal helpers.
+	bool AddNodePostings(SNodeGUID NodeID);
+	bool AddPosting(uint32_t GramKey, uint32_t NodeID);
+	const GramSlot* FindGram(uint32_t GramKey) const;
+};
+
+#endif // SYNERGY_GRAPH_SEARCH_INCLUDED
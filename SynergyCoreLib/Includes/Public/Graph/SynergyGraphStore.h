@@ -0,0 +1,289 @@
+// Storage for Synergy Node Graphs. Holds node data and connections in preallocated memory with capacities chosen at initialization,
+// and provides the primitive operations higher level systems (transactions, loaders) are built upon.
+
+#ifndef SYNERGY_GRAPH_STORE_INCLUDED
+#define SYNERGY_GRAPH_STORE_INCLUDED
+
+#include "SynergyGraph.h"
+#include "SynergyNamePool.h"
+#include "SynergyCore.h"
+
+// Name arena bytes reserved per node when a store is initialized without an explicit name arena size.
+constexpr size_t SGRAPH_DEFAULT_NAME_BYTES_PER_NODE = 24;
+
+// Per-node flags.
+typedef uint8_t SGraphNodeFlags;
+// Set for slots holding a node. Free slots have no flags at all.
+constexpr SGraphNodeFlags SGRAPH_NODE_FLAG_EXISTS = 1 << 0;
+
+// Node data that is rarely read, kept out of the way of traversals.
+struct SGraphNodeColdData
+{
+	// Values of the store's modification counter when the node was created, and when it or one of its connections was last changed.
+	uint64_t CreationStamp = 0;
+	uint64_t ModificationStamp = 0;
+};
+
+// Index of a connection record in a graph store.
+typedef uint32_t SGraphEdgeIndex;
+constexpr SGraphEdgeIndex SGRAPH_INVALID_EDGE = ~0u;
+
+/*
+	Stored directed connection between two nodes. Every node heads two intrusive lists of edges: those leaving it and those arriving at it,
+	so connections can be enumerated in O(degree) in both directions.
+*/
+struct SGraphEdge
+{
+	SNodeGUID Src = SNODE_INVALID_ID;
+	SNodeGUID Dest = SNODE_INVALID_ID;
+
+	// Next edge leaving Src. Doubles as the free list link for unused edges.
+	SGraphEdgeIndex NextOut = SGRAPH_INVALID_EDGE;
+	// Next edge arriving at Dest.
+	SGraphEdgeIndex NextIn = SGRAPH_INVALID_EDGE;
+
+	SNodeConnectionAccessLevel AccessLevel = SNodeConnectionAccessLevel::NONE;
+};
+
+/*
+	Read-only view of a store's node columns, for passes that stream over every node slot.
+	Slots at or above SlotCount are always free. Slots below it hold a node only if their flags have SGRAPH_NODE_FLAG_EXISTS.
+*/
+struct SGraphNodeColumns
+{
+	size_t SlotCount = 0;
+
+	const SGraphNodeFlags* Flags = nullptr;
+	const SNodeGUID* ParentIDs = nullptr;
+	const SNameHandle* NameHandles = nullptr;
+	const SNodeGUID* FirstChild = nullptr;
+	const SNodeGUID* NextSibling = nullptr;
+	const uint32_t* OutDegree = nullptr;
+	const uint32_t* InDegree = nullptr;
+	const SGraphNodeColdData* ColdData = nullptr;
+};
+
+/*
+	Data store for a graph's nodal data. Slot in the store corresponds to the Node's GUID.
+	Node data is split into columns indexed by GUID rather than kept as records, so passes only pull the bytes they actually use into cache:
+	hierarchy walks read parents and child / sibling links, filters read flags, and names are only touched when displayed or searched.
+	All memory is taken from the allocator passed at initialization, capacity cannot grow afterwards.
+*/
+struct SGraphStore
+{
+	// HOT COLUMNS
+
+	SGraphNodeFlags* Flags = nullptr;
+	SNodeGUID* ParentIDs = nullptr;
+
+	// Hierarchy links. Children of a node form a doubly linked list headed by FirstChild.
+	SNodeGUID* FirstChild = nullptr;
+	SNodeGUID* NextSibling = nullptr;
+	SNodeGUID* PrevSibling = nullptr;
+
+	// Number of connections leaving and arriving at each node, parent - child ones included.
+	uint32_t* OutDegree = nullptr;
+	uint32_t* InDegree = nullptr;
+
+	// Heads of the outgoing and incoming edge lists of each node.
+	SGraphEdgeIndex* FirstOutEdge = nullptr;
+	SGraphEdgeIndex* FirstInEdge = nullptr;
+
+	// WARM AND COLD COLUMNS
+
+	// Names of nodes, interned in the Names pool.
+	SNameHandle* NameHandles = nullptr;
+
+	SGraphNodeColdData* ColdData = nullptr;
+
+	// Connection records.
+	SGraphEdge* Edges = nullptr;
+
+	// Names of all nodes, holding a reference per node. Room is left for twice as many names as nodes, for names that were
+	// interned or released since their owner last reclaimed them.
+	SNamePool Names;
+
+	/*
+		Open addressing hash table of node IDs keyed by name handle, used for lookups by name.
+		Capacity is a power of two at least twice the max node count, so probing sequences stay short.
+		Removed entries leave tombstones behind, which are cleared by rehashing in place once they fill too much of the table.
+	*/
+	SNodeGUID* NameIndex = nullptr;
+	size_t NameIndexCapacity = 0;
+	size_t NameIndexCount = 0;
+	size_t NameIndexTombstoneCount = 0;
+
+	size_t MaxNodeCount = 0;
+	size_t MaxEdgeCount = 0;
+
+	// Number of live nodes and edges.
+	size_t NodeCount = 0;
+	size_t EdgeCount = 0;
+
+	// Every ID at or above the high water mark is free. Lets bulk operations reserve contiguous ID ranges.
+	SNodeGUID NodeHighWaterMark = 0;
+	// No ID below this one is free. Keeps FindAvailableID amortized constant time when nodes are mostly created.
+	SNodeGUID FreeIDHint = 0;
+
+	// Edges at or above the high water mark have never been used. Edges below it that were freed are chained from FirstFreeEdge.
+	SGraphEdgeIndex EdgeHighWaterMark = 0;
+	SGraphEdgeIndex FirstFreeEdge = SGRAPH_INVALID_EDGE;
+
+	// Incremented by every change to a node or its connections. See SGraphNodeColdData.
+	uint64_t ModificationCounter = 0;
+
+	/*
+		Returns how much memory Initialize will request from a Stack Allocator for the given capacities.
+		A name arena size of 0 picks SGRAPH_DEFAULT_NAME_BYTES_PER_NODE bytes per node.
+	*/
+	static size_t GetRequiredMemorySize(size_t InMaxNodeCount, size_t InMaxEdgeCount, size_t InNameArenaSize = 0);
+
+	/*
+		Allocates all store memory from the passed allocator and resets the store to an empty state.
+		Returns whether allocation succeeded.
+	*/
+	bool Initialize(MemoryAllocator& Allocator, size_t InMaxNodeCount, size_t InMaxEdgeCount, size_t InNameArenaSize = 0);
+
+	inline bool NodeExists(SNodeGUID NodeID) const { return NodeID < MaxNodeCount && (Flags[NodeID] & SGRAPH_NODE_FLAG_EXISTS) != 0; }
+
+	// Returns the name of an existing node, without copying it.
+	inline std::string_view GetNodeName(SNodeGUID NodeID) const { return Names.Get(NameHandles[NodeID]); }
+
+	/*
+		Returns the version of an existing node: its modification stamp, which changes whenever the node or one of its connections does.
+		Transactions built against a node carry its version so they can be refused if it changed in the meantime.
+	*/
+	inline uint64_t GetNodeVersion(SNodeGUID NodeID) const { return ColdData[NodeID].ModificationStamp; }
+
+	// Returns a read-only view of all node columns.
+	SGraphNodeColumns GetNodeColumns() const;
+
+	// COLUMN ITERATION
+	// Each of these only reads the columns it needs to find the next node. Visitors are free to read any column they need themselves.
+
+	// Calls Visitor(NodeID) for every existing node, in ID order. Reads the flags column only.
+	template<typename VisitorType>
+	void ForEachNode(VisitorType&& Visitor) const
+	{
+		for (SNodeGUID nodeID = 0; nodeID < NodeHighWaterMark; nodeID++)
+		{
+			if (Flags[nodeID] & SGRAPH_NODE_FLAG_EXISTS)
+			{
+				Visitor(nodeID);
+			}
+		}
+	}
+
+	// Calls Visitor(ChildID) for every direct child of the passed node.
+	template<typename VisitorType>
+	void ForEachChild(SNodeGUID ParentID, VisitorType&& Visitor) const
+	{
+		if (!NodeExists(ParentID)) return;
+
+		for (SNodeGUID childID = FirstChild[ParentID]; childID != SNODE_INVALID_ID; childID = NextSibling[childID])
+		{
+			Visitor(childID);
+		}
+	}
+
+	// Calls Visitor(AncestorID) for the parent of the passed node, then its parent and so on up to the root.
+	// The walk stops early if the visitor returns false.
+	template<typename VisitorType>
+	void ForEachAncestor(SNodeGUID NodeID, VisitorType&& Visitor) const
+	{
+		if (!NodeExists(NodeID)) return;
+
+		for (SNodeGUID ancestorID = ParentIDs[NodeID]; ancestorID != SNODE_INVALID_ID; ancestorID = ParentIDs[ancestorID])
+		{
+			if (!Visitor(ancestorID)) return;
+		}
+	}
+
+	/*
+		Calls Visitor(NodeID, Depth) for every node of the subtree rooted at the passed node, root included at depth 0, in depth first order.
+		Follows child and sibling links so no stack is needed. Descendants of a node are skipped if the visitor returns false for it.
+	*/
+	template<typename VisitorType>
+	void ForEachInSubtree(SNodeGUID SubtreeRootID, VisitorType&& Visitor) const
+	{
+		if (!NodeExists(SubtreeRootID)) return;
+
+		SNodeGUID nodeID = SubtreeRootID;
+		size_t depth = 0;
+		for (;;)
+		{
+			if (Visitor(nodeID, depth) && FirstChild[nodeID] != SNODE_INVALID_ID)
+			{
+				nodeID = FirstChild[nodeID];
+				depth++;
+				continue;
+			}
+
+			// Climb until a node with a next sibling is found, without leaving the subtree.
+			while (nodeID != SubtreeRootID && NextSibling[nodeID] == SNODE_INVALID_ID)
+			{
+				nodeID = ParentIDs[nodeID];
+				depth--;
+			}
+
+			if (nodeID == SubtreeRootID) return;
+			nodeID = NextSibling[nodeID];
+		}
+	}
+
+	// Returns the lowest free ID, or SNODE_INVALID_ID if the store is full.
+	SNodeGUID FindAvailableID() const;
+
+	/*
+		Reserves a contiguous range of Count free IDs at the top of the store and returns the first one, or SNODE_INVALID_ID if there isn't room.
+		Reserved IDs don't exist until nodes are created in them.
+	*/
+	SNodeGUID ReserveIDRange(size_t Count);
+
+	/*
+		Creates a node in the passed free slot with a name interned in this store's pool. Does not create parent - child connections, see SetConnection.
+		Returns whether the node was created.
+	*/
+	bool CreateNode(SNodeGUID NodeID, SNameHandle Name, SNodeGUID ParentID);
+
+	// Deletes a node along with all its connections, releasing its name.
+	void DeleteNode(SNodeGUID NodeID);
+
+	// Changes a node's name to one interned in this store's pool, keeping the name index up to date. The previous name is released.
+	void RenameNode(SNodeGUID NodeID, SNameHandle NewName);
+
+	/*
+		Moves a node under a new parent, or makes it parentless with SNODE_INVALID_ID, keeping child lists up to date.
+		Does not touch parent - child connections, see SetConnection.
+	*/
+	void SetParent(SNodeGUID NodeID, SNodeGUID NewParentID);
+
+	// Returns the ID of a node with the passed name, or SNODE_INVALID_ID.
+	SNodeGUID FindNodeByName(std::string_view Name) const;
+
+	// Returns the access level of the connection from Src to Dest. NONE if they aren't connected.
+	SNodeConnectionAccessLevel GetConnection(SNodeGUID Src, SNodeGUID Dest) const;
+
+	/*
+		Sets the access level of the connection from Src to Dest, creating it if needed. Setting it to NONE deletes the connection.
+		Returns false if the connection had to be created but the store is out of edges.
+	*/
+	bool SetConnection(SNodeGUID Src, SNodeGUID Dest, SNodeConnectionAccessLevel AccessLevel);
+
+	/*
+		Returns the connections to AND from the passed Node ID, filling in the buffer if one is passed until it is full.
+		Returns the total amount of connections, which may be larger than the buffer.
+	*/
+	size_t GetConnections_Bidirectional(SNodeGUID NodeID, SNodeConnectionDef* ConnectionsBuffer, size_t ConnectionsBufferSize) const;
+
+	// Internal helpers.
+	SGraphEdgeIndex AllocateEdge();
+	void NameIndexInsert(SNodeGUID NodeID);
+	void NameIndexRemove(SNodeGUID NodeID);
+	void NameIndexRehash();
+	void LinkChild(SNodeGUID ParentID, SNodeGUID ChildID);
+	void UnlinkChild(SNodeGUID ChildID);
+	inline void Touch(SNodeGUID NodeID) { ColdData[NodeID].ModificationStamp = ++ModificationCounter; }
+};
+
+#endif // SYNERGY_GRAPH_STORE_INCLUDED
@@ -0,0 +1,203 @@
+// Identifier-based graph transactions, applied atomically to a Graph Store. This is the form transactions take outside of the Client's
+// edit tools: on the wire and on the server.
+
+#ifndef SYNERGY_GRAPH_TRANSACTION_INCLUDED
+#define SYNERGY_GRAPH_TRANSACTION_INCLUDED
+
+#include "SynergyGraphStore.h"
+#include "SynergyGraphChangeStream.h"
+
+#include <vector>
+
+/*
+	HOW IT WORKS
+
+	A transaction is a list of ops applied in order. Ops refer to nodes either by ID, or through a created node reference to a node
+	created by an earlier op of the same transaction, since its ID is only known once the op is applied.
+
+	Each op is validated against the store as left by the ops before it, then applied. Everything applied is recorded in an undo log,
+	broken down into the same primitive changes the change stream describes. When an op fails the log is played backwards to restore the
+	store, so a transaction is either applied entirely or not at all. When all ops succeed the log is published to the change stream as is.
+
+	Concurrency is optimistic: transactions are built without holding anything, and their FETCH_NODE ops carry the version each node had
+	then. If one of them changed since, the transaction fails with CONFLICT instead of silently overwriting what another editor did.
+
+	Ops preserve the shape of the hierarchy: the store holds a single tree, nodes with children can't be deleted and no node can be
+	moved under its own subtree.
+*/
+
+// Highest number of ops in a single transaction.
+constexpr size_t SGRAPH_TRANSACTION_MAX_OPS = 4096;
+
+// Bit marking node references to nodes created earlier in the same transaction. Low bits hold the index of the node among those created.
+constexpr SNodeGUID SGRAPH_CREATED_NODE_REF = 1ull << 62;
+
+inline SNodeGUID MakeCreatedNodeRef(size_t CreatedIndex)
+{
+	return SGRAPH_CREATED_NODE_REF | (SNodeGUID)CreatedIndex;
+}
+
+inline bool IsCreatedNodeRef(SNodeGUID NodeRef)
+{
+	return NodeRef != SNODE_INVALID_ID && (NodeRef & SGRAPH_CREATED_NODE_REF) != 0;
+}
+
+enum class SGraphOpType : uint8_t
+{
+	FETCH_NODE, // Changes nothing, only requires NodeID to exist, with version Version unless it is 0: the transaction was built on what it was.
+	CREATE_NODE, // Creates a node named Name under OtherID. AccessLevel goes to the parent, AccessLevelFromParent comes from it.
+	DELETE_NODE, // Deletes NodeID along with its connections. It must have a parent and no children.
+	RENAME_NODE, // Renames NodeID to Name.
+	SET_PARENT, // Moves NodeID under OtherID, which may be its current parent. Parent - child connections get the op's access levels.
+	SET_CONNECTION, // Sets the connection from NodeID to OtherID to AccessLevel. NONE deletes it, which parent - child connections refuse.
+
+	COUNT
+};
+
+struct SGraphOp
+{
+	SGraphOpType Type = SGraphOpType::COUNT;
+
+	SNodeConnectionAccessLevel AccessLevel = SNodeConnectionAccessLevel::NONE;
+	SNodeConnectionAccessLevel AccessLevelFromParent = SNodeConnectionAccessLevel::NONE;
+
+	// Node IDs or created node references.
+	SNodeGUID NodeID = SNODE_INVALID_ID;
+	SNodeGUID OtherID = SNODE_INVALID_ID;
+
+	// Only needs to stay valid until the transaction is applied.
+	std::string_view Name;
+
+	// FETCH_NODE only. See SGraphStore::GetNodeVersion.
+	uint64_t Version = 0;
+};
+
+enum class SGraphTransactionStatus : uint8_t
+{
+	APPLIED,
+	INVALID_OP, // Unknown op type, bad access level, or transaction too large.
+	MISSING_NODE, // An op refers to a node that doesn't exist, or to a created node reference that isn't created yet.
+	INVALID_NAME, // Empty name or longer than SNODE_NAME_MAX_LENGTH.
+	HIERARCHY_VIOLATION, // The op would break the tree: cycle, second root, deleting a root or a node with children.
+	OUT_OF_CAPACITY, // The store or its name pool is full.
+	CONFLICT, // A fetched node changed since the transaction was built. It may be built again and resubmitted.
+
+	COUNT
+};
+
+// Whether an op may set a connection to the passed access level, given the minimum the connection requires.
+inline bool IsValidGraphAccessLevel(SNodeConnectionAccessLevel AccessLevel, SNodeConnectionAccessLevel Minimum)
+{
+	return AccessLevel >= Minimum && AccessLevel <= SNodeConnectionAccessLevel::OPEN;
+}
+
+inline bool IsValidGraphNodeName(std::string_view Name)
+{
+	return !Name.empty() && Name.size() <= SNODE_NAME_MAX_LENGTH;
+}
+
+// Returns a readable name for the passed status.
+const char* GetGraphTransactionStatusName(SGraphTransactionStatus Status);
+
+struct SGraphTransactionResult
+{
+	SGraphTransactionStatus Status = SGraphTransactionStatus::APPLIED;
+
+	// Index of the op that failed. Meaningless when the transaction was applied.
+	uint32_t FailedOpIndex = 0;
+
+	// Sequence number the change stream gave the transaction, 0 if it made no change or wasn't applied.
+	uint64_t Sequence = 0;
+};
+
+// Entry of a transaction's undo log: a change as applied to the store, and what it replaced.
+struct SGraphTransactionLogEntry
+{
+	SGraphChange Change;
+
+	// PARENT_CHANGED: previous parent.
+	SNodeGUID PreviousOtherID = SNODE_INVALID_ID;
+	// NODE_RENAMED: previous name. NODE_DELETED: name of the deleted node.
+	SNameHandle PreviousValue = SNAME_INVALID_HANDLE;
+	// CONNECTION_CHANGED: previous access level.
+	SNodeConnectionAccessLevel PreviousAccessLevel = SNodeConnectionAccessLevel::NONE;
+
+	// Versions of the change's nodes before it, restored on rollback so transactions that fail don't make others conflict.
+	uint64_t PreviousNodeVersion = 0;
+	uint64_t PreviousOtherVersion = 0;
+};
+
+/*
+	Scratch state for applying transactions. Keep one per thread applying transactions so its buffers are only allocated once.
+	After a successful apply, CreatedIDs holds the IDs of created nodes in creation order.
+*/
+struct SGraphTransactionContext
+{
+	std::vector<SGraphTransactionLogEntry> Log;
+	std::vector<SNodeGUID> CreatedIDs;
+};
+
+/*
+	Validates and applies a transaction to the store, or leaves the store unchanged if any op fails.
+	Changes are published to the passed change stream, if any, once the whole transaction succeeded.
+	Returns whether the transaction was applied. Details are written to OutResult.
+*/
+bool ApplyGraphTransaction(SGraphStore& Store, const SGraphOp* Ops, size_t OpCount, SGraphTransactionContext& Context,
+	SGraphTransactionResult& OutResult, SGraphChangeStream* Changes = nullptr);
+
+// STEPS
+// What ApplyGraphTransaction is made of, for applying ops that don't come from an array.
+
+// Validates and applies a single op, logging its changes to the context.
+SGraphTransactionStatus ApplyGraphOp(SGraphStore& Store, const SGraphOp& Op, SGraphTransactionContext& Context);
+
+// Undoes every change logged to the context, and clears it.
+void RollbackGraphTransaction(SGraphStore& Store, SGraphTransactionContext& Context);
+
+// Publishes the changes logged to the context to the stream, if any, and sets the result's sequence.
+void PublishGraphTransaction(const SGraphTransactionContext& Context, SGraphTransactionResult& OutResult, SGraphChangeStream* Changes);
+
+/*
+	Same as ApplyGraphTransaction, with ops pulled one at a time from a source, such as a decoder reading them straight from a receive buffer.
+	OpSourceType must provide bool Next(SGraphOp&), returning false once it has no more ops, and bool Failed() const, telling whether it
+	stopped because its data was malformed. A failed source fails the transaction with INVALID_OP, at the index of the op it couldn't read.
+*/
+template<typename OpSourceType>
+bool ApplyGraphTransactionFrom(SGraphStore& Store, OpSourceType& Ops, SGraphTransactionContext& Context,
+	SGraphTransactionResult& OutResult, SGraphChangeStream* Changes = nullptr)
+{
+	OutResult = {};
+	Context.Log.clear();
+	Context.CreatedIDs.clear();
+
+	SGraphTransactionStatus status = SGraphTransactionStatus::APPLIED;
+	uint32_t opIndex = 0;
+	SGraphOp op;
+	while (Ops.Next(op))
+	{
+		status = opIndex < SGRAPH_TRANSACTION_MAX_OPS ? ApplyGraphOp(Store, op, Context) : SGraphTransactionStatus::INVALID_OP;
+		if (status != SGraphTransactionStatus::APPLIED)
+		{
+			break;
+		}
+		opIndex++;
+	}
+
+	if (status == SGraphTransactionStatus::APPLIED && Ops.Failed())
+	{
+		status = SGraphTransactionStatus::INVALID_OP;
+	}
+
+	if (status != SGraphTransactionStatus::APPLIED)
+	{
+		RollbackGraphTransaction(Store, Context);
+		OutResult.Status = status;
+		OutResult.FailedOpIndex = opIndex;
+		return false;
+	}
+
+	PublishGraphTransaction(Context, OutResult, Changes);
+	return true;
+}
+
+#endif // SYNERGY_GRAPH_TRANSACTION_INCLUDED
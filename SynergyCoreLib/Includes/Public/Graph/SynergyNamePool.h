@@ -0,0 +1,156 @@
+// String interning pool for node names. Every distinct name is stored once in an arena and referred to by a compact handle.
+
+#ifndef SYNERGY_NAME_POOL_INCLUDED
+#define SYNERGY_NAME_POOL_INCLUDED
+
+#include "SynergyCore.h"
+
+#include <string_view>
+
+// Handle to an interned name. Equal handles from the same pool always mean equal names, and the other way around.
+typedef uint32_t SNameHandle;
+// Handle of the empty name. Never refers to stored data.
+constexpr SNameHandle SNAME_INVALID_HANDLE = 0;
+
+// Longest name that can be interned, in bytes. Lengths are stored on a single byte.
+constexpr size_t SNODE_NAME_MAX_LENGTH = 63;
+
+// Hash function used for names (FNV-1a).
+inline uint64_t HashNodeName(const char* Name, size_t Length)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (size_t charIndex = 0; charIndex < Length; charIndex++)
+	{
+		hash ^= (uint8_t)(Name[charIndex]);
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+inline uint64_t HashNodeName(std::string_view Name)
+{
+	return HashNodeName(Name.data(), Name.size());
+}
+
+// Arena bytes taken by the entry of the longest name, see SNamePool.
+constexpr size_t SNAME_MAX_ENTRY_SIZE = (sizeof(uint32_t) + SNODE_NAME_MAX_LENGTH + 2 + 3) & ~(size_t)3;
+
+// Reference counts of names listed as unreferenced have this bit set, so they only get listed once.
+constexpr uint32_t SNAME_UNREFERENCED_LISTED = 0x80000000u;
+
+/*
+	Arena of interned names. Entries are laid out as [reference count][length byte][characters][null terminator], padded to 4 bytes,
+	and a handle is the offset of an entry's length byte. Views returned by the pool are therefore also valid null terminated C strings.
+	Names are reference counted by what stores their handles, graph stores counting one reference per node carrying a name.
+	Names left without references, be it released or interned but never referenced, are only reclaimed by ReclaimUnreferenced:
+	they leave the lookup table and their entries go to free lists by size, reused by later names of the same size.
+	Their handles must not be used after that, so reclaim where nothing holds on to them, such as once a transaction is published.
+	All memory is taken from the allocator passed at initialization, capacity cannot grow afterwards.
+*/
+struct SNamePool
+{
+	// Slot of the lookup table. The low bits of the name's hash are kept next to the handle so most mismatches are rejected
+	// without touching the arena, and so entries can be moved back towards their home slot when one is removed.
+	struct IndexSlot
+	{
+		SNameHandle Handle;
+		uint32_t Hash;
+	};
+
+	uint8_t* Arena = nullptr;
+	size_t ArenaCapacity = 0;
+	// Bytes of the arena handed out so far, free entries included.
+	size_t ArenaUsed = 0;
+
+	// Open addressing table of handles keyed by name. Capacity is a power of two at least twice the max name count.
+	IndexSlot* Index = nullptr;
+	size_t IndexCapacity = 0;
+
+	size_t MaxNameCount = 0;
+	size_t NameCount = 0;
+
+	// Names that were left without references since the last reclaim. At most one per name, so it holds MaxNameCount handles.
+	SNameHandle* Unreferenced = nullptr;
+	size_t UnreferencedCount = 0;
+
+	// First free entry of every size, in 4 byte units. Free entries are linked through their reference count.
+	SNameHandle FreeLists[SNAME_MAX_ENTRY_SIZE / 4 + 1] = {};
+	// Bytes of the arena held by free entries.
+	size_t FreeByteCount = 0;
+
+	// Interns that failed because the pool was full, failing the edits that needed the names.
+	size_t InternFailureCount = 0;
+
+	/*
+		Returns how much memory Initialize will request from a Stack Allocator for the given capacities, allocation overhead included.
+	*/
+	static size_t GetRequiredMemorySize(size_t InArenaCapacity, size_t InMaxNameCount);
+
+	/*
+		Allocates the arena and lookup table from the passed allocator and resets the pool to an empty state.
+		Returns whether allocation succeeded.
+	*/
+	bool Initialize(MemoryAllocator& Allocator, size_t InArenaCapacity, size_t InMaxNameCount);
+
+	/*
+		Returns the handle of the passed name, storing it if it wasn't already. Doesn't add a reference: a name that nothing references
+		by the next ReclaimUnreferenced is reclaimed. Returns SNAME_INVALID_HANDLE if the name is empty, too long, or the pool is full.
+	*/
+	SNameHandle Intern(std::string_view Name);
+	// Same as above with a precomputed HashNodeName of the name.
+	SNameHandle Intern(std::string_view Name, uint64_t NameHash);
+
+	// Returns the handle of the passed name if it was interned, SNAME_INVALID_HANDLE otherwise. Never stores anything.
+	SNameHandle Find(std::string_view Name) const;
+	SNameHandle Find(std::string_view Name, uint64_t NameHash) const;
+
+	// Adds a reference to an interned name.
+	inline void AddRef(SNameHandle Handle)
+	{
+		GetRefCount(Handle)++;
+	}
+
+	// Removes a reference to an interned name, listing it for the next reclaim when it was the last.
+	void Release(SNameHandle Handle);
+
+	/*
+		Frees every name left without references since the last call, making room for new ones. Returns how many were freed.
+	*/
+	size_t ReclaimUnreferenced();
+
+	// Returns a view of an interned name, valid until it is reclaimed. The invalid handle gives an empty view.
+	inline std::string_view Get(SNameHandle Handle) const
+	{
+		return Handle != SNAME_INVALID_HANDLE ? std::string_view((const char*)Arena + Handle + 1, Arena[Handle]) : std::string_view();
+	}
+
+	// Returns the arena bytes an entry for a name of the passed length takes.
+	static constexpr size_t GetEntrySize(size_t NameLength)
+	{
+		return (sizeof(uint32_t) + NameLength + 2 + 3) & ~(size_t)3;
+	}
+
+	// Returns the arena bytes held by interned names.
+	inline size_t GetUsedBytes() const
+	{
+		return ArenaUsed - FreeByteCount;
+	}
+
+	// Returns whether a name of the passed length could be interned without running out of room.
+	inline bool HasRoomFor(size_t NameLength) const
+	{
+		const size_t entrySize = GetEntrySize(NameLength);
+		return NameCount < MaxNameCount && (FreeLists[entrySize / 4] != SNAME_INVALID_HANDLE || ArenaUsed + entrySize <= ArenaCapacity);
+	}
+
+	// Returns the reference count of an interned name, or the next free entry's handle for a free one.
+	inline uint32_t& GetRefCount(SNameHandle Handle)
+	{
+		return *(uint32_t*)(Arena + Handle - sizeof(uint32_t));
+	}
+
+	// Takes a name out of the lookup table, moving the entries probing past it back so no tombstone is needed.
+	void IndexRemove(SNameHandle Handle);
+};
+
+#endif // SYNERGY_NAME_POOL_INCLUDED
@@ -0,0 +1,245 @@
+// Messages exchanged between Synergy clients and servers over a stream connection, and how they are encoded.
+
+#ifndef SYNERGY_PROTOCOL_INCLUDED
+#define SYNERGY_PROTOCOL_INCLUDED
+
+#include "Graph/SynergyGraphTransaction.h"
+
+#include <vector>
+
+/*
+	FRAMING
+
+	Every message is a frame made of a 5 byte header, [uint32 payload size][uint8 message type], followed by the payload.
+	Fixed size integers are little endian.
+
+	PAYLOAD ENCODING
+
+	Payloads are built from LEB128 varints (7 bits per byte, low bits first, high bit set on every byte but the last), so small values
+	such as counts, indices and IDs of nodes in smaller graphs only take a byte or two. Sizes scale with the number of ops, never with
+	the capacity of the structures they were built from.
+	- Node references: 0 for none, 2 * (ID + 1) for node IDs, 2 * Index + 1 for created node references (see SynergyGraphTransaction.h).
+	- Access levels: one byte, the access level (or access level to parent) in the low 4 bits, access level from parent in the high 4 bits.
+	- Names: each distinct name of a message is stored once in a name table, and ops refer to names by their index in it.
+*/
+
+constexpr uint16_t SPROTOCOL_DEFAULT_PORT = 7777;
+
+constexpr size_t SPROTOCOL_FRAME_HEADER_SIZE = 5;
+
+// Largest payload accepted by either side. Peers sending more get disconnected.
+constexpr uint32_t SPROTOCOL_MAX_PAYLOAD_SIZE = 1 << 20;
+
+enum class SProtocolMessageType : uint8_t
+{
+	/*
+		Client -> Server. Asks for a transaction to be applied to the server's graph.
+		[varint request ID][varint name count][names: varint length, bytes][varint op count][ops]
+		Each op is [uint8 op type] followed by fields depending on its type:
+		- FETCH_NODE: [node][varint version], 0 when the node only has to exist
+		- DELETE_NODE: [node]
+		- CREATE_NODE: [parent][access levels][varint name index]
+		- RENAME_NODE: [node][varint name index]
+		- SET_PARENT: [node][parent][access levels]
+		- SET_CONNECTION: [source][destination][access levels]
+	*/
+	SUBMIT_TRANSACTION,
+
+	/*
+		Server -> Client. Outcome of a submitted transaction.
+		[varint request ID][uint8 status][varint failed op index][varint sequence][varint created count][created IDs]
+		Created IDs are encoded as the zigzag varint difference with the previous one, starting from 0, since they tend to be consecutive.
+	*/
+	TRANSACTION_RESULT,
+
+	// Either way. [uint64 value] that the other side echoes back in a PONG.
+	PING,
+	PONG,
+
+	/*
+		Client -> Server. Replaces the session's subscription, see SProtocolSubscribeRequest. A root of none ends it.
+		[varint request ID][viewer][root][uint8 scope][varint depth][varint bandwidth budget]
+	*/
+	SUBSCRIBE,
+
+	/*
+		Server -> Client. Brings the client's copy of its subscription's view up to date.
+		[varint request ID][varint update sequence][uint8 update flags][records until the end of the payload]
+		Each record is [uint8 record kind] followed by fields depending on its kind:
+		- NODE: [node][parent][varint version][varint name length][name bytes]
+		- NODE_REMOVED: [node]
+		- CONNECTION: [source][destination][uint8 access level]
+	*/
+	SUBSCRIPTION_UPDATE,
+
+	COUNT
+};
+
+// FRAMES
+
+// Appends a frame header to the buffer. The payload must follow, and be exactly PayloadSize bytes long.
+void SProtocolAppendFrameHeader(std::vector<uint8_t>& Buffer, SProtocolMessageType Type, uint32_t PayloadSize);
+
+/*
+	Reads the frame header at the start of the passed data, if all of it is there.
+	Returns false if the header is incomplete, otherwise fills the outputs. The caller must check the payload size.
+*/
+bool SProtocolReadFrameHeader(const uint8_t* Data, size_t Size, SProtocolMessageType& OutType, uint32_t& OutPayloadSize);
+
+// MESSAGES
+// Append functions write a complete frame. Decode functions take a payload, without its frame header, and return whether it was well formed.
+
+void SProtocolAppendSubmitTransaction(std::vector<uint8_t>& Buffer, uint32_t RequestID, const SGraphOp* Ops, size_t OpCount);
+
+/*
+	Decodes a SUBMIT_TRANSACTION payload in place, one op at a time, so ops can go from the receive buffer to the store without
+	being copied anywhere in between. Decoded names view the payload, which must outlive them.
+	Usable as an op source for ApplyGraphTransactionFrom. Keep readers around between payloads so the name table is only allocated once.
+*/
+struct SProtocolTransactionReader
+{
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+	size_t Offset = 0;
+	size_t FirstOpOffset = 0;
+	bool bFailed = false;
+
+	uint32_t RequestID = 0;
+	size_t OpCount = 0;
+	size_t ReadOpCount = 0;
+
+	// Views of the payload's name table.
+	std::vector<std::string_view> Names;
+
+	// Reads the payload's header and name table. Returns false if they are malformed.
+	bool Begin(const uint8_t* Payload, size_t PayloadSize);
+
+	// Goes back to the first op, to read them again. Only valid after a successful Begin.
+	void Rewind()
+	{
+		Offset = FirstOpOffset;
+		ReadOpCount = 0;
+		bFailed = false;
+	}
+
+	// Decodes the next op. Returns false once every op was read, or if the op was malformed in which case Failed() becomes true.
+	bool Next(SGraphOp& OutOp);
+
+	// Whether decoding stopped on malformed data, including trailing bytes after the last op.
+	bool Failed() const { return bFailed || (ReadOpCount == OpCount && Offset != Size); }
+};
+
+void SProtocolAppendTransactionResult(std::vector<uint8_t>& Buffer, uint32_t RequestID, const SGraphTransactionResult& Result,
+	const SNodeGUID* CreatedIDs, size_t CreatedCount);
+
+// Decoded TRANSACTION_RESULT payload.
+struct SProtocolTransactionResult
+{
+	uint32_t RequestID = 0;
+	SGraphTransactionResult Result;
+
+	// Number of nodes the transaction created. Only the first ones that fit were written to the buffer passed to the decoder.
+	size_t CreatedCount = 0;
+};
+
+bool SProtocolDecodeTransactionResult(const uint8_t* Payload, size_t Size, SProtocolTransactionResult& OutResult,
+	SNodeGUID* OutCreatedIDs, size_t CreatedIDCapacity);
+
+// SUBSCRIBE
+
+enum class SProtocolSubscriptionScope : uint8_t
+{
+	SUBTREE, // The root and its descendants, down to Depth levels below it. 0 for no limit.
+	NEIGHBOURHOOD, // Nodes reachable from the root in at most Depth connections. 0 counts as 1.
+
+	COUNT
+};
+
+/*
+	Asks the server to keep the client's copy of part of the graph up to date: an initial snapshot, then only what changes in it.
+	Of the nodes in scope, only those visible to the viewer node are sent, and only connections the viewer may see between them.
+*/
+struct SProtocolSubscribeRequest
+{
+	uint32_t RequestID = 0;
+	SNodeGUID ViewerID = SNODE_INVALID_ID;
+	SNodeGUID RootID = SNODE_INVALID_ID;
+	SProtocolSubscriptionScope Scope = SProtocolSubscriptionScope::SUBTREE;
+	uint32_t Depth = 0;
+
+	// Bytes per second the server may send for the subscription. 0 lets the server pick.
+	uint32_t BandwidthBudget = 0;
+};
+
+void SProtocolAppendSubscribe(std::vector<uint8_t>& Buffer, const SProtocolSubscribeRequest& Request);
+
+bool SProtocolDecodeSubscribe(const uint8_t* Payload, size_t Size, SProtocolSubscribeRequest& OutRequest);
+
+// SUBSCRIPTION_UPDATE
+
+typedef uint8_t SProtocolSubscriptionUpdateFlags;
+// The client must drop its copy of the view before applying the update, which starts a new snapshot.
+constexpr SProtocolSubscriptionUpdateFlags SPROTOCOL_SUBSCRIPTION_SNAPSHOT = 1 << 0;
+// The update was cut short to respect the bandwidth budget, more follows even if the graph doesn't change.
+constexpr SProtocolSubscriptionUpdateFlags SPROTOCOL_SUBSCRIPTION_PARTIAL = 1 << 1;
+// The subscription is over, refused or because its root or viewer went away. No update follows.
+constexpr SProtocolSubscriptionUpdateFlags SPROTOCOL_SUBSCRIPTION_ENDED = 1 << 2;
+
+enum class SProtocolSubscriptionRecordKind : uint8_t
+{
+	NODE, // NodeID is in the view, named Name, under OtherID, at Version. OtherID is none when the parent isn't in the view.
+	NODE_REMOVED, // NodeID left the view. Connections from and to it go with it.
+	CONNECTION, // Connection from NodeID to OtherID now has AccessLevel. NONE means it left the view.
+
+	COUNT
+};
+
+struct SProtocolSubscriptionRecord
+{
+	SProtocolSubscriptionRecordKind Kind = SProtocolSubscriptionRecordKind::NODE;
+	SNodeGUID NodeID = SNODE_INVALID_ID;
+	SNodeGUID OtherID = SNODE_INVALID_ID;
+	SNodeConnectionAccessLevel AccessLevel = SNodeConnectionAccessLevel::NONE;
+
+	// Views the payload when decoded.
+	std::string_view Name;
+
+	// Version of the node on the server, for transactions to be checked against. See SGraphStore::GetNodeVersion.
+	uint64_t Version = 0;
+};
+
+/*
+	Updates are written a record at a time, so the writer may stop whenever it ran out of budget.
+	Begin returns where the frame starts, to be passed to End along with the final flags.
+*/
+size_t SProtocolBeginSubscriptionUpdate(std::vector<uint8_t>& Buffer, uint32_t RequestID, uint64_t Sequence);
+
+void SProtocolAppendSubscriptionRecord(std::vector<uint8_t>& Buffer, const SProtocolSubscriptionRecord& Record);
+
+void SProtocolEndSubscriptionUpdate(std::vector<uint8_t>& Buffer, size_t FrameStart, SProtocolSubscriptionUpdateFlags Flags);
+
+// Decodes a SUBSCRIPTION_UPDATE payload in place, one record at a time.
+struct SProtocolSubscriptionUpdateReader
+{
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+	size_t Offset = 0;
+	bool bFailed = false;
+
+	uint32_t RequestID = 0;
+	uint64_t Sequence = 0;
+	SProtocolSubscriptionUpdateFlags Flags = 0;
+
+	// Reads the update's header. Returns false if it is malformed.
+	bool Begin(const uint8_t* Payload, size_t PayloadSize);
+
+	// Decodes the next record. Returns false once every record was read, or if the record was malformed in which case bFailed is set.
+	bool Next(SProtocolSubscriptionRecord& OutRecord);
+};
+
+// PING and PONG.
+void SProtocolAppendPing(std::vector<uint8_t>& Buffer, SProtocolMessageType Type, uint64_t Value);
+
+bool SProtocolDecodePing(const uint8_t* Payload, size_t Size, uint64_t& OutValue);
+
+#endif // SYNERGY_PROTOCOL_INCLUDED
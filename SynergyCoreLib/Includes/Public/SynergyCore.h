@@ -4,8 +4,30 @@
 #include "SynergyCoreMemory.h"
 #include "SynergyCoreMath.h"
 
+#include <string.h>
+
 // Common defines
 
+// PLATFORM COMPATIBILITY
+
+#if !defined(_MSC_VER)
+// The bounds-checked CRT string functions are MSVC-only. Provide the subset we use so the same sources build with GCC / Clang.
+inline int strcpy_s(char* Dest, size_t DestSize, const char* Src)
+{
+	if (Dest == nullptr || DestSize == 0) return 1;
+
+	size_t srcLength = Src != nullptr ? strlen(Src) : 0;
+	if (srcLength >= DestSize)
+	{
+		Dest[0] = '\0';
+		return 1;
+	}
+
+	memcpy(Dest, Src, srcLength + 1);
+	return 0;
+}
+#endif
+
 // TRANSLATION UNIT & SOURCE INC FILE SYSTEM
 
 #ifndef TRANSLATION_UNIT
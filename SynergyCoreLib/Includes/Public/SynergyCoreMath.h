@@ -64,6 +64,18 @@ constexpr Vector2<ScalarType> operator/(const Vector2<ScalarType>& A, const Scal
 	return { A.x / B, A.y / B };
 }
 
+template<typename ScalarType>
+constexpr bool operator==(const Vector2<ScalarType>& A, const Vector2<ScalarType>& B)
+{
+	return A.x == B.x && A.y == B.y;
+}
+
+template<typename ScalarType>
+constexpr bool operator!=(const Vector2<ScalarType>& A, const Vector2<ScalarType>& B)
+{
+	return !(A == B);
+}
+
 // Utility Functions
 // Note: These are not really written for performance, just convenience. Any heavy operation with many vectors getting manipulated should
 // feature their own performant solution such as using Simd or whatever else is possible in their own context.
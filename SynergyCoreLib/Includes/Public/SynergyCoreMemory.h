@@ -1,6 +1,7 @@
 // Memory management tools usable by projects linked with the Synergy Core lib.
 
 #include <stdint.h>
+#include <stddef.h>
 
 typedef uint8_t* ByteBuffer;
 
@@ -0,0 +1,159 @@
+// Work-stealing job system spreading the work of a frame over worker threads, each with its own job deque and frame arena.
+
+#ifndef SYNERGY_JOB_SYSTEM_INCLUDED
+#define SYNERGY_JOB_SYSTEM_INCLUDED
+
+#include "SynergyCore.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+	Workers are numbered from 0, worker 0 being the thread that initialized the system and runs frames: it has a deque and an arena like
+	the others, and runs jobs while it waits on a counter. Workers 1 and up are threads of the system.
+
+	Jobs are pushed to the deque of the worker submitting them, which pops its own jobs newest first while idle workers steal the oldest
+	ones. There are no fibers: a worker waiting on a counter runs other jobs until the counter reaches zero, so waiting inside a job is fine
+	as long as what it waits on doesn't wait on it.
+
+	Dependencies are expressed with counters: every job of a batch decrements its counter when done, and the batch's continuation, if any,
+	is submitted by whichever worker finished the last job.
+*/
+
+// Most workers a system can have, the thread running frames included.
+constexpr uint32_t SJOB_MAX_WORKERS = 64;
+
+// Jobs a worker's deque holds. Jobs submitted to a full deque run right away on the submitting thread.
+constexpr int64_t SJOB_DEQUE_CAPACITY = 4096;
+
+struct SJobSystem;
+struct SJobCounter;
+
+/*
+	What a job gets to run with: the worker running it, and its frame arena for scratch memory. The arena is wiped whenever the system's
+	owner calls ResetJobSystemFrameArenas, so nothing allocated from it may outlive the frame.
+*/
+struct SJobContext
+{
+	SJobSystem* System;
+	uint32_t WorkerIndex;
+	MemoryAllocator* FrameArena;
+};
+
+typedef void SJobFunction(const SJobContext& Context, void* Data);
+
+struct SJob
+{
+	SJobFunction* Function = nullptr;
+	void* Data = nullptr;
+
+	// Decremented once the job ran. Set by RunJobs, except on continuations where it's up to the submitter.
+	SJobCounter* Counter = nullptr;
+};
+
+/*
+	Counts the jobs of a batch that haven't run yet. Must outlive the jobs counted, which is what waiting on it until it reaches zero ensures.
+*/
+struct SJobCounter
+{
+	std::atomic<uint32_t> Pending { 0 };
+
+	// Submitted once Pending drops to zero. Set by RunJobs.
+	SJob Continuation = {};
+
+	bool IsDone() const { return Pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Fixed capacity work-stealing deque (Chase-Lev). Only its worker pushes and pops, at the bottom. Other workers steal from the top.
+struct SJobDeque
+{
+	alignas(64) std::atomic<int64_t> Top;
+	alignas(64) std::atomic<int64_t> Bottom;
+	SJob* Jobs;
+};
+
+struct SJobWorker
+{
+	SJobDeque Deque;
+	MemoryAllocator FrameArena;
+
+	// Memory the frame arena is rebuilt over on every reset.
+	ByteBuffer FrameArenaMemory;
+	size_t FrameArenaSize;
+
+	// Seeds the choice of workers to steal from.
+	uint32_t StealSeed;
+
+	// Thread of the worker, for workers past 0.
+	std::thread* Thread;
+};
+
+struct SJobSystemOptions
+{
+	// Workers including the thread running frames. 0 uses one per hardware thread. Capped to SJOB_MAX_WORKERS.
+	uint32_t WorkerCount = 0;
+
+	// Scratch memory of every worker's frame arena.
+	size_t FrameArenaSize = 1 << 20;
+};
+
+/*
+	State of a job system. All its memory comes from the allocator it was initialized with.
+*/
+struct SJobSystem
+{
+	uint32_t WorkerCount;
+	SJobWorker* Workers;
+
+	// Idle workers sleep until the generation moves, which it does whenever jobs are pushed.
+	std::atomic<uint64_t> WorkGeneration;
+	std::atomic<uint32_t> SleepingCount;
+	std::mutex* SleepMutex;
+	std::condition_variable* SleepCondition;
+
+	std::atomic<bool> bStopping;
+};
+
+/*
+	Sets up the system and starts its worker threads. Its memory, threads' objects included, comes from the given allocator.
+	Returns false if the options can't be satisfied.
+*/
+bool InitializeJobSystem(SJobSystem& System, MemoryAllocator& Allocator, const SJobSystemOptions& Options);
+
+/*
+	Stops and joins the worker threads. Jobs still queued are dropped, so counters should be waited on first.
+*/
+void ShutdownJobSystem(SJobSystem& System);
+
+/*
+	Submits jobs from the given worker, counting them in the counter. The continuation, if given, is submitted once the counter drops
+	to zero, and counted in its own counter from now on so waiting on that one covers it. Only the batch taking a counter off zero sets
+	its continuation: batches added while it's pending delay that continuation and ignore their own.
+*/
+void RunJobs(SJobSystem& System, uint32_t WorkerIndex, SJob* Jobs, size_t JobCount, SJobCounter& Counter, const SJob* Continuation = nullptr);
+
+/*
+	Runs jobs on the given worker until the counter drops to zero.
+*/
+void WaitForJobCounter(SJobSystem& System, uint32_t WorkerIndex, SJobCounter& Counter);
+
+/*
+	Function run over a range of items by RunParallelFor.
+*/
+typedef void SJobRangeFunction(const SJobContext& Context, size_t Begin, size_t End, void* Data);
+
+/*
+	Runs the function over [0, Count[ in batches of at least MinBatchSize items, spread over the workers, and waits for all of them.
+	Below two batches' worth of items it simply runs on the calling worker. Batches are described in the calling worker's frame arena,
+	and stay there until it is reset: calls that no longer find room for them run on the calling worker as well.
+*/
+void RunParallelFor(SJobSystem& System, uint32_t WorkerIndex, size_t Count, size_t MinBatchSize, SJobRangeFunction* Function, void* Data);
+
+/*
+	Wipes every worker's frame arena. Only call it while no job is running, typically when a frame starts.
+*/
+void ResetJobSystemFrameArenas(SJobSystem& System);
+
+#endif // SYNERGY_JOB_SYSTEM_INCLUDED
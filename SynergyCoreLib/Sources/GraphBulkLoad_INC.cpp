@@ -0,0 +1,628 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Graph Store bulk loader.
+// Loading happens in three phases:
+// - Parsing: the file is streamed in chunks, each chunk split at line boundaries and parsed in parallel into compact records.
+// - Validation: keys, references, hierarchy and capacities are checked without touching the store.
+// - Building: nodes are written in ID order, then connections are counting-sorted by source and linked in a single pass.
+
+#include "SynergyCore.h"
+#include "Graph/SynergyGraphBulkLoad.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Reference to a node from a bulk file, either by file key or by GUID of a node already in the store.
+struct BulkNodeRef
+{
+	enum class Kind : uint8_t { NONE, KEY, GUID };
+
+	uint64_t Value = 0;
+	Kind RefKind = Kind::NONE;
+};
+
+struct BulkNodeRecord
+{
+	uint64_t Key;
+	BulkNodeRef Parent;
+	uint64_t NameHash;
+	size_t Line;
+	uint32_t NameOffset;
+	uint8_t NameLength;
+	SNodeConnectionAccessLevel AccessToParent;
+	SNodeConnectionAccessLevel AccessFromParent;
+};
+
+struct BulkEdgeRecord
+{
+	BulkNodeRef Src;
+	BulkNodeRef Dest;
+	size_t Line;
+	SNodeConnectionAccessLevel AccessLevel;
+};
+
+// Output of parsing one slice of a chunk. Names are stored back to back in their own buffer, without terminators.
+struct BulkParseSlice
+{
+	std::vector<BulkNodeRecord> Nodes;
+	std::vector<BulkEdgeRecord> Edges;
+	std::vector<char> Names;
+
+	// Number of lines in the slice. Line numbers of records are relative to the slice until fixed up after parsing.
+	size_t LineCount = 0;
+
+	size_t ErrorLine = 0;
+	const char* Error = nullptr;
+};
+
+// Connection resolved to store IDs, ready to be sorted and linked.
+struct BulkResolvedEdge
+{
+	SNodeGUID Src;
+	SNodeGUID Dest;
+	size_t Line;
+	SNodeConnectionAccessLevel AccessLevel;
+};
+
+// FIELD PARSING
+
+static bool BulkParseUInt(const char*& Cursor, const char* End, uint64_t& OutValue)
+{
+	const char* start = Cursor;
+	uint64_t value = 0;
+	while (Cursor < End && *Cursor >= '0' && *Cursor <= '9')
+	{
+		value = value * 10 + (uint64_t)(*Cursor - '0');
+		Cursor++;
+	}
+	OutValue = value;
+	return Cursor != start;
+}
+
+static bool BulkParseSeparator(const char*& Cursor, const char* End)
+{
+	if (Cursor < End && *Cursor == ' ')
+	{
+		Cursor++;
+		return true;
+	}
+	return false;
+}
+
+static bool BulkParseNodeRef(const char*& Cursor, const char* End, bool bAllowNone, BulkNodeRef& OutRef)
+{
+	if (Cursor < End && *Cursor == '-')
+	{
+		Cursor++;
+		OutRef = {};
+		return bAllowNone;
+	}
+
+	OutRef.RefKind = BulkNodeRef::Kind::KEY;
+	if (Cursor < End && *Cursor == '@')
+	{
+		Cursor++;
+		OutRef.RefKind = BulkNodeRef::Kind::GUID;
+	}
+	return BulkParseUInt(Cursor, End, OutRef.Value);
+}
+
+static bool BulkParseAccessLevel(const char*& Cursor, const char* End, SNodeConnectionAccessLevel& OutLevel)
+{
+	if (Cursor < End && *Cursor >= '0' + (char)SNodeConnectionAccessLevel::PRIVATE && *Cursor <= '0' + (char)SNodeConnectionAccessLevel::OPEN)
+	{
+		OutLevel = (SNodeConnectionAccessLevel)(*Cursor - '0');
+		Cursor++;
+		return true;
+	}
+	return false;
+}
+
+/*
+	Parses every line of [Begin, End[ into the slice. End must be a line boundary.
+	Stops at the first error.
+*/
+static void BulkParseSlice_Run(const char* Begin, const char* End, BulkParseSlice& Slice)
+{
+	const char* lineStart = Begin;
+	while (lineStart < End)
+	{
+		const char* lineEnd = (const char*)memchr(lineStart, '\n', End - lineStart);
+		const char* nextLine = lineEnd != nullptr ? lineEnd + 1 : End;
+		if (lineEnd == nullptr) lineEnd = End;
+		if (lineEnd > lineStart && lineEnd[-1] == '\r') lineEnd--;
+
+		Slice.LineCount++;
+		const size_t line = Slice.LineCount;
+
+		const char* cursor = lineStart;
+		lineStart = nextLine;
+
+		if (cursor == lineEnd || *cursor == '#')
+		{
+			continue;
+		}
+
+		const char recordType = *cursor++;
+		if (recordType == 'N')
+		{
+			BulkNodeRecord record = {};
+			record.Line = line;
+
+			if (!BulkParseSeparator(cursor, lineEnd) || !BulkParseUInt(cursor, lineEnd, record.Key)
+				|| !BulkParseSeparator(cursor, lineEnd) || !BulkParseNodeRef(cursor, lineEnd, true, record.Parent)
+				|| !BulkParseSeparator(cursor, lineEnd) || !BulkParseAccessLevel(cursor, lineEnd, record.AccessToParent)
+				|| !BulkParseSeparator(cursor, lineEnd) || !BulkParseAccessLevel(cursor, lineEnd, record.AccessFromParent)
+				|| !BulkParseSeparator(cursor, lineEnd))
+			{
+				Slice.ErrorLine = line;
+				Slice.Error = "Malformed node record.";
+				return;
+			}
+
+			// Name is the rest of the line.
+			const size_t nameLength = lineEnd - cursor;
+			if (nameLength == 0 || nameLength > SNODE_NAME_MAX_LENGTH)
+			{
+				Slice.ErrorLine = line;
+				Slice.Error = "Node name is empty or too long.";
+				return;
+			}
+
+			record.NameOffset = (uint32_t)Slice.Names.size();
+			record.NameLength = (uint8_t)nameLength;
+			Slice.Names.insert(Slice.Names.end(), cursor, lineEnd);
+
+			// Hash now, while the name is hot and in parallel, so interning only has to probe.
+			record.NameHash = HashNodeName(cursor, nameLength);
+
+			Slice.Nodes.push_back(record);
+		}
+		else if (recordType == 'E')
+		{
+			BulkEdgeRecord record = {};
+			record.Line = line;
+
+			if (!BulkParseSeparator(cursor, lineEnd) || !BulkParseNodeRef(cursor, lineEnd, false, record.Src)
+				|| !BulkParseSeparator(cursor, lineEnd) || !BulkParseNodeRef(cursor, lineEnd, false, record.Dest)
+				|| !BulkParseSeparator(cursor, lineEnd) || !BulkParseAccessLevel(cursor, lineEnd, record.AccessLevel)
+				|| cursor != lineEnd)
+			{
+				Slice.ErrorLine = line;
+				Slice.Error = "Malformed connection record.";
+				return;
+			}
+
+			Slice.Edges.push_back(record);
+		}
+		else
+		{
+			Slice.ErrorLine = line;
+			Slice.Error = "Unknown record type.";
+			return;
+		}
+	}
+}
+
+static bool BulkLoadFail(SGraphBulkLoadResult& OutResult, size_t Line, const char* Error)
+{
+	OutResult.bSuccess = false;
+	OutResult.ErrorLine = Line;
+	strcpy_s(OutResult.Error, sizeof(OutResult.Error), Error);
+	return false;
+}
+
+bool BulkLoadGraph(SGraphStore& Store, const char* FilePath, const SGraphBulkLoadOptions& Options, SGraphBulkLoadResult& OutResult)
+{
+	OutResult = {};
+
+	uint32_t threadCount = Options.ThreadCount > 0 ? Options.ThreadCount : std::thread::hardware_concurrency();
+	if (threadCount == 0) threadCount = 1;
+
+	if (Options.ChunkSize == 0)
+	{
+		return BulkLoadFail(OutResult, 0, "Invalid chunk size.");
+	}
+
+	FILE* file = fopen(FilePath, "rb");
+	if (file == nullptr)
+	{
+		return BulkLoadFail(OutResult, 0, "Could not open file.");
+	}
+
+	// PARSING
+
+	std::vector<BulkParseSlice> slices;
+	std::vector<char> chunk(Options.ChunkSize);
+	std::vector<std::thread> workers;
+
+	size_t chunkCarry = 0; // Bytes of an incomplete line kept from the previous chunk.
+	size_t lineBase = 0; // Number of lines in previous chunks.
+	for (;;)
+	{
+		if (chunkCarry == chunk.size())
+		{
+			fclose(file);
+			return BulkLoadFail(OutResult, lineBase + 1, "Line longer than chunk size.");
+		}
+
+		const size_t readCount = fread(chunk.data() + chunkCarry, 1, chunk.size() - chunkCarry, file);
+		const size_t filled = chunkCarry + readCount;
+		if (filled == 0)
+		{
+			break;
+		}
+
+		// Parse up to the last complete line, unless the file ended in which case everything left is parsed.
+		const bool bEndOfFile = readCount == 0;
+		size_t parseEnd = filled;
+		if (!bEndOfFile)
+		{
+			while (parseEnd > 0 && chunk[parseEnd - 1] != '\n') parseEnd--;
+			if (parseEnd == 0)
+			{
+				chunkCarry = filled;
+				continue;
+			}
+		}
+
+		// Split at line boundaries into one slice per thread.
+		const size_t firstSlice = slices.size();
+		slices.resize(firstSlice + threadCount);
+
+		const char* chunkStart = chunk.data();
+		const char* sliceStart = chunkStart;
+		for (uint32_t threadIndex = 0; threadIndex < threadCount; threadIndex++)
+		{
+			const char* sliceEnd = chunkStart + parseEnd * (threadIndex + 1) / threadCount;
+			if (sliceEnd < sliceStart) sliceEnd = sliceStart;
+			while (sliceEnd < chunkStart + parseEnd && sliceEnd > sliceStart && sliceEnd[-1] != '\n') sliceEnd++;
+
+			BulkParseSlice& slice = slices[firstSlice + threadIndex];
+			if (threadIndex + 1 < threadCount)
+			{
+				workers.emplace_back(BulkParseSlice_Run, sliceStart, sliceEnd, std::ref(slice));
+			}
+			else
+			{
+				BulkParseSlice_Run(sliceStart, sliceEnd, slice);
+			}
+			sliceStart = sliceEnd;
+		}
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+		workers.clear();
+
+		// Turn slice-relative line numbers into file line numbers and report the first error.
+		for (size_t sliceIndex = firstSlice; sliceIndex < slices.size(); sliceIndex++)
+		{
+			BulkParseSlice& slice = slices[sliceIndex];
+			if (slice.Error != nullptr)
+			{
+				fclose(file);
+				return BulkLoadFail(OutResult, lineBase + slice.ErrorLine, slice.Error);
+			}
+
+			for (BulkNodeRecord& record : slice.Nodes) record.Line += lineBase;
+			for (BulkEdgeRecord& record : slice.Edges) record.Line += lineBase;
+			lineBase += slice.LineCount;
+		}
+
+		chunkCarry = filled - parseEnd;
+		memmove(chunk.data(), chunk.data() + parseEnd, chunkCarry);
+
+		if (bEndOfFile)
+		{
+			break;
+		}
+	}
+
+	fclose(file);
+
+	// VALIDATION
+
+	size_t nodeCount = 0;
+	for (BulkParseSlice& slice : slices) nodeCount += slice.Nodes.size();
+
+	if (nodeCount == 0)
+	{
+		return BulkLoadFail(OutResult, 0, "File declares no nodes.");
+	}
+
+	if (nodeCount > Store.MaxNodeCount - Store.NodeHighWaterMark)
+	{
+		return BulkLoadFail(OutResult, 0, "Not enough room in the store for all nodes.");
+	}
+
+	// IDs are only reserved once everything is validated, but we already know which ones we will get.
+	const SNodeGUID firstNodeID = Store.NodeHighWaterMark;
+
+	// Place every node record at its key. This is the sort that lets nodes be written in ID order.
+	std::vector<const BulkNodeRecord*> nodesByKey(nodeCount, nullptr);
+	std::vector<const char*> namesByKey(nodeCount, nullptr);
+	for (BulkParseSlice& slice : slices)
+	{
+		for (const BulkNodeRecord& record : slice.Nodes)
+		{
+			if (record.Key >= nodeCount)
+			{
+				return BulkLoadFail(OutResult, record.Line, "Node key out of range. Keys must cover [0, NodeCount[.");
+			}
+			if (nodesByKey[record.Key] != nullptr)
+			{
+				return BulkLoadFail(OutResult, record.Line, "Duplicate node key.");
+			}
+			nodesByKey[record.Key] = &record;
+			namesByKey[record.Key] = slice.Names.data() + record.NameOffset;
+		}
+	}
+
+	auto ResolveRef = [&](const BulkNodeRef& Ref) -> SNodeGUID
+	{
+		switch (Ref.RefKind)
+		{
+		case BulkNodeRef::Kind::KEY:
+			return Ref.Value < nodeCount ? firstNodeID + Ref.Value : SNODE_INVALID_ID;
+		case BulkNodeRef::Kind::GUID:
+			return Store.NodeExists(Ref.Value) ? Ref.Value : SNODE_INVALID_ID;
+		default:
+			return SNODE_INVALID_ID;
+		}
+	};
+
+	// Names. Count every one as new, which is pessimistic when names repeat but guarantees interning can't fail later.
+	{
+		size_t nameBytes = 0;
+		for (uint64_t key = 0; key < nodeCount; key++)
+		{
+			nameBytes += SNamePool::GetEntrySize(nodesByKey[key]->NameLength);
+		}
+
+		if (nodeCount > Store.Names.MaxNameCount - Store.Names.NameCount || nameBytes > Store.Names.ArenaCapacity - Store.Names.ArenaUsed)
+		{
+			return BulkLoadFail(OutResult, 0, "Not enough room in the store for all node names.");
+		}
+	}
+
+	// Parents and hierarchy. Walk up from every node until reaching an already validated node, an existing node or the root,
+	// flagging cycles along the way.
+	SNodeGUID rootNodeID = SNODE_INVALID_ID;
+	{
+		enum : uint8_t { UNVISITED, VISITING, VALID };
+		std::vector<uint8_t> state(nodeCount, UNVISITED);
+		std::vector<uint64_t> path;
+
+		for (uint64_t key = 0; key < nodeCount; key++)
+		{
+			const BulkNodeRecord& record = *nodesByKey[key];
+			if (record.Parent.RefKind == BulkNodeRef::Kind::NONE)
+			{
+				if (rootNodeID != SNODE_INVALID_ID || Store.NodeCount > 0)
+				{
+					return BulkLoadFail(OutResult, record.Line, "Only one root node may be declared, and only in an empty store.");
+				}
+				rootNodeID = firstNodeID + key;
+			}
+			else if (ResolveRef(record.Parent) == SNODE_INVALID_ID)
+			{
+				return BulkLoadFail(OutResult, record.Line, "Unknown parent node.");
+			}
+		}
+
+		for (uint64_t key = 0; key < nodeCount; key++)
+		{
+			uint64_t current = key;
+			path.clear();
+			while (state[current] == UNVISITED)
+			{
+				state[current] = VISITING;
+				path.push_back(current);
+
+				const BulkNodeRef& parent = nodesByKey[current]->Parent;
+				if (parent.RefKind != BulkNodeRef::Kind::KEY)
+				{
+					break;
+				}
+				current = parent.Value;
+			}
+
+			if (state[current] == VISITING && nodesByKey[current]->Parent.RefKind == BulkNodeRef::Kind::KEY)
+			{
+				return BulkLoadFail(OutResult, nodesByKey[current]->Line, "Node hierarchy contains a cycle.");
+			}
+
+			for (uint64_t pathKey : path) state[pathKey] = VALID;
+		}
+	}
+
+	// Resolve every connection, implicit parent - child ones included.
+	std::vector<BulkResolvedEdge> edges;
+	{
+		size_t explicitEdgeCount = 0;
+		for (BulkParseSlice& slice : slices) explicitEdgeCount += slice.Edges.size();
+		edges.reserve(explicitEdgeCount + nodeCount * 2);
+
+		for (uint64_t key = 0; key < nodeCount; key++)
+		{
+			const BulkNodeRecord& record = *nodesByKey[key];
+			SNodeGUID parentID = ResolveRef(record.Parent);
+			if (parentID != SNODE_INVALID_ID)
+			{
+				edges.push_back({ firstNodeID + key, parentID, record.Line, record.AccessToParent });
+				edges.push_back({ parentID, firstNodeID + key, record.Line, record.AccessFromParent });
+			}
+		}
+
+		for (BulkParseSlice& slice : slices)
+		{
+			for (const BulkEdgeRecord& record : slice.Edges)
+			{
+				SNodeGUID srcID = ResolveRef(record.Src);
+				SNodeGUID destID = ResolveRef(record.Dest);
+				if (srcID == SNODE_INVALID_ID || destID == SNODE_INVALID_ID || srcID == destID)
+				{
+					return BulkLoadFail(OutResult, record.Line, "Connection references an unknown node or loops on itself.");
+				}
+				edges.push_back({ srcID, destID, record.Line, record.AccessLevel });
+			}
+
+			// Parsed records are no longer needed past this point.
+			std::vector<BulkEdgeRecord>().swap(slice.Edges);
+		}
+	}
+
+	if (edges.size() > Store.MaxEdgeCount - Store.EdgeHighWaterMark)
+	{
+		return BulkLoadFail(OutResult, 0, "Not enough room in the store for all connections.");
+	}
+
+	// Counting sort of connections by source. Connections leaving nodes of the file get grouped per source node in ID order,
+	// connections leaving pre-existing nodes are kept at the end.
+	std::vector<size_t> groupStart(nodeCount + 2, 0);
+	for (const BulkResolvedEdge& edge : edges)
+	{
+		size_t group = edge.Src >= firstNodeID && edge.Src < firstNodeID + nodeCount ? (size_t)(edge.Src - firstNodeID) : nodeCount;
+		groupStart[group + 1]++;
+	}
+	for (size_t group = 0; group <= nodeCount; group++)
+	{
+		groupStart[group + 1] += groupStart[group];
+	}
+
+	std::vector<BulkResolvedEdge> sortedEdges(edges.size());
+	{
+		std::vector<size_t> groupCursor(groupStart.begin(), groupStart.end() - 1);
+		for (const BulkResolvedEdge& edge : edges)
+		{
+			size_t group = edge.Src >= firstNodeID && edge.Src < firstNodeID + nodeCount ? (size_t)(edge.Src - firstNodeID) : nodeCount;
+			sortedEdges[groupCursor[group]++] = edge;
+		}
+		std::vector<BulkResolvedEdge>().swap(edges);
+	}
+
+	// Order each group by destination and reject duplicates.
+	for (size_t group = 0; group <= nodeCount; group++)
+	{
+		auto groupBegin = sortedEdges.begin() + groupStart[group];
+		auto groupEnd = sortedEdges.begin() + groupStart[group + 1];
+		if (groupEnd - groupBegin < 2) continue;
+
+		std::sort(groupBegin, groupEnd, [](const BulkResolvedEdge& A, const BulkResolvedEdge& B)
+		{
+			return A.Src != B.Src ? A.Src < B.Src : A.Dest < B.Dest;
+		});
+
+		for (auto it = groupBegin + 1; it != groupEnd; ++it)
+		{
+			if (it->Src == (it - 1)->Src && it->Dest == (it - 1)->Dest)
+			{
+				return BulkLoadFail(OutResult, it->Line, "Duplicate connection.");
+			}
+		}
+	}
+
+	// BUILDING
+	// Nothing below can fail.
+
+	Store.ReserveIDRange(nodeCount);
+
+	// Every loaded node shares the same creation stamp.
+	const uint64_t loadStamp = ++Store.ModificationCounter;
+
+	// Node columns are written one at a time, each in a single sequential pass over the new range.
+	memset(Store.Flags + firstNodeID, SGRAPH_NODE_FLAG_EXISTS, sizeof(SGraphNodeFlags) * nodeCount);
+	memset(Store.FirstChild + firstNodeID, 0xFF, sizeof(SNodeGUID) * nodeCount);
+	memset(Store.NextSibling + firstNodeID, 0xFF, sizeof(SNodeGUID) * nodeCount);
+	memset(Store.PrevSibling + firstNodeID, 0xFF, sizeof(SNodeGUID) * nodeCount);
+	memset(Store.OutDegree + firstNodeID, 0, sizeof(uint32_t) * nodeCount);
+	memset(Store.InDegree + firstNodeID, 0, sizeof(uint32_t) * nodeCount);
+	memset(Store.FirstOutEdge + firstNodeID, 0xFF, sizeof(SGraphEdgeIndex) * nodeCount);
+	memset(Store.FirstInEdge + firstNodeID, 0xFF, sizeof(SGraphEdgeIndex) * nodeCount);
+
+	for (uint64_t key = 0; key < nodeCount; key++)
+	{
+		const BulkNodeRecord& record = *nodesByKey[key];
+		const SNodeGUID nodeID = firstNodeID + key;
+
+		Store.NameHandles[nodeID] = Store.Names.Intern(std::string_view(namesByKey[key], record.NameLength), record.NameHash);
+		Store.Names.AddRef(Store.NameHandles[nodeID]);
+		Store.ColdData[nodeID] = { loadStamp, loadStamp };
+		Store.NameIndexInsert(nodeID);
+	}
+
+	// Hierarchy. Children get pushed at the front of their parent's list, so going backwards leaves them in key order.
+	for (uint64_t key = nodeCount; key-- > 0;)
+	{
+		const BulkNodeRecord& record = *nodesByKey[key];
+		const SNodeGUID nodeID = firstNodeID + key;
+
+		Store.ParentIDs[nodeID] = SNODE_INVALID_ID;
+		if (record.Parent.RefKind != BulkNodeRef::Kind::NONE)
+		{
+			Store.LinkChild(ResolveRef(record.Parent), nodeID);
+		}
+	}
+
+	Store.NodeCount += nodeCount;
+	if (Store.FreeIDHint >= firstNodeID)
+	{
+		Store.FreeIDHint = firstNodeID + nodeCount;
+	}
+
+	// Connections leaving new nodes are stored contiguously in the order they were sorted in, so outgoing lists are plain runs of edges.
+	const SGraphEdgeIndex firstEdgeIndex = Store.EdgeHighWaterMark;
+	const size_t newNodesEdgeCount = groupStart[nodeCount];
+	for (size_t group = 0; group < nodeCount; group++)
+	{
+		const SNodeGUID srcID = firstNodeID + group;
+		for (size_t sortedIndex = groupStart[group]; sortedIndex < groupStart[group + 1]; sortedIndex++)
+		{
+			const BulkResolvedEdge& resolved = sortedEdges[sortedIndex];
+			SGraphEdge& edge = Store.Edges[firstEdgeIndex + sortedIndex];
+			edge.Src = resolved.Src;
+			edge.Dest = resolved.Dest;
+			edge.AccessLevel = resolved.AccessLevel;
+			edge.NextOut = sortedIndex + 1 < groupStart[group + 1] ? (SGraphEdgeIndex)(firstEdgeIndex + sortedIndex + 1) : SGRAPH_INVALID_EDGE;
+		}
+
+		if (groupStart[group + 1] > groupStart[group])
+		{
+			Store.FirstOutEdge[srcID] = (SGraphEdgeIndex)(firstEdgeIndex + groupStart[group]);
+			Store.OutDegree[srcID] = (uint32_t)(groupStart[group + 1] - groupStart[group]);
+		}
+	}
+
+	// Incoming lists, built backwards so they end up in ascending edge order.
+	for (size_t sortedIndex = newNodesEdgeCount; sortedIndex-- > 0;)
+	{
+		const SGraphEdgeIndex edgeIndex = (SGraphEdgeIndex)(firstEdgeIndex + sortedIndex);
+		SGraphEdge& edge = Store.Edges[edgeIndex];
+		edge.NextIn = Store.FirstInEdge[edge.Dest];
+		Store.FirstInEdge[edge.Dest] = edgeIndex;
+		Store.InDegree[edge.Dest]++;
+	}
+
+	Store.EdgeHighWaterMark += (SGraphEdgeIndex)newNodesEdgeCount;
+	Store.EdgeCount += newNodesEdgeCount;
+
+	// Connections leaving pre-existing nodes go through the regular path.
+	for (size_t sortedIndex = newNodesEdgeCount; sortedIndex < sortedEdges.size(); sortedIndex++)
+	{
+		const BulkResolvedEdge& resolved = sortedEdges[sortedIndex];
+		Store.SetConnection(resolved.Src, resolved.Dest, resolved.AccessLevel);
+	}
+
+	OutResult.bSuccess = true;
+	OutResult.NodeCount = nodeCount;
+	OutResult.ConnectionCount = sortedEdges.size();
+	OutResult.FirstNodeID = firstNodeID;
+	OutResult.RootNodeID = rootNodeID;
+	return true;
+}
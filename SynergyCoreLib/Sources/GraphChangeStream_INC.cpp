@@ -0,0 +1,105 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Graph Change Stream.
+
+#include "SynergyCore.h"
+#include "Graph/SynergyGraphChangeStream.h"
+
+static inline size_t ChangeStreamCapacity(size_t InCapacity)
+{
+	size_t capacity = 16;
+	while (capacity < InCapacity)
+	{
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+size_t SGraphChangeStream::GetRequiredMemorySize(size_t InCapacity)
+{
+	// Every stack allocation is followed by its size.
+	return sizeof(SGraphChange) * ChangeStreamCapacity(InCapacity) + sizeof(size_t);
+}
+
+bool SGraphChangeStream::Initialize(MemoryAllocator& Allocator, size_t InCapacity)
+{
+	*this = {};
+
+	Capacity = ChangeStreamCapacity(InCapacity);
+	Entries = (SGraphChange*)Allocator.Allocate(sizeof(SGraphChange) * Capacity);
+
+	return Entries != nullptr;
+}
+
+void SGraphChangeStream::BeginTransaction()
+{
+	if (bTransactionOpen)
+	{
+		// ASSERT Transactions can't be nested.
+		return;
+	}
+
+	// The header is filled in once the change count is known.
+	bTransactionOpen = true;
+	bTransactionOverflowed = false;
+	OpenTransactionPosition = WritePosition++;
+}
+
+void SGraphChangeStream::Push(const SGraphChange& Change)
+{
+	if (!bTransactionOpen)
+	{
+		// ASSERT Changes must be pushed within a transaction.
+		return;
+	}
+
+	// Past a ring's worth of changes the header would get overwritten. Nobody could read the transaction anyway.
+	if (bTransactionOverflowed || WritePosition - OpenTransactionPosition >= Capacity)
+	{
+		bTransactionOverflowed = true;
+		return;
+	}
+
+	Entries[WritePosition++ & (Capacity - 1)] = Change;
+}
+
+void SGraphChangeStream::EndTransaction()
+{
+	if (!bTransactionOpen)
+	{
+		// ASSERT No transaction to end.
+		return;
+	}
+	bTransactionOpen = false;
+
+	const uint64_t changeCount = WritePosition - OpenTransactionPosition - 1;
+	if (changeCount == 0)
+	{
+		WritePosition = OpenTransactionPosition;
+		return;
+	}
+
+	if (bTransactionOverflowed)
+	{
+		// What was written of the transaction is unusable. Cursors that would read over it have to resync, and so do all others.
+		DiscardedBefore = WritePosition;
+		PushResync();
+		return;
+	}
+
+	TransactionSequence++;
+	SGraphChange& header = Entries[OpenTransactionPosition & (Capacity - 1)];
+	header = {};
+	header.Kind = SGraphChangeKind::TRANSACTION;
+	header.Value = (uint32_t)changeCount;
+	header.NodeID = TransactionSequence;
+
+	CommittedPosition = WritePosition;
+}
+
+void SGraphChangeStream::PushResync()
+{
+	BeginTransaction();
+	Push(SGraphChange {});
+	EndTransaction();
+}
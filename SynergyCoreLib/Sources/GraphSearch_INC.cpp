@@ -0,0 +1,446 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Graph Search Index.
+
+#include "SynergyCore.h"
+#include "Graph/SynergyGraphSearch.h"
+
+#include <algorithm>
+
+constexpr uint32_t SGRAPH_SEARCH_INVALID_BLOCK = ~0u;
+
+// Gram kinds, stored in the top byte of gram keys so that no key is ever 0.
+constexpr uint32_t SGRAPH_SEARCH_GRAM_TRIGRAM = 1;
+constexpr uint32_t SGRAPH_SEARCH_GRAM_ANCHORED = 2;
+
+static inline char SearchFoldChar(char Char)
+{
+	return (Char >= 'A' && Char <= 'Z') ? (char)(Char - 'A' + 'a') : Char;
+}
+
+static inline bool SearchIsSeparator(char Char)
+{
+	return Char == ' ' || Char == '\t' || Char == '_' || Char == '-' || Char == '.' || Char == '/' || Char == ':';
+}
+
+// Lowercases Name into Buffer, which must hold SNODE_NAME_MAX_LENGTH + 1 characters. Returns the folded length.
+static inline size_t SearchFold(std::string_view Name, char* Buffer)
+{
+	const size_t length = Name.size() < SNODE_NAME_MAX_LENGTH ? Name.size() : SNODE_NAME_MAX_LENGTH;
+	for (size_t charIndex = 0; charIndex < length; charIndex++)
+	{
+		Buffer[charIndex] = SearchFoldChar(Name[charIndex]);
+	}
+	return length;
+}
+
+// Packs up to 3 characters and a gram kind into a key. Shorter grams are zero padded, which keeps them distinct from longer ones.
+static inline uint32_t SearchGramKey(uint32_t Kind, const char* Chars, size_t Length)
+{
+	uint32_t key = Kind << 24;
+	for (size_t charIndex = 0; charIndex < Length; charIndex++)
+	{
+		key |= (uint32_t)(uint8_t)Chars[charIndex] << (8 * charIndex);
+	}
+	return key;
+}
+
+static inline size_t SearchGramSlot(uint32_t Key, size_t Mask)
+{
+	return (size_t)((Key * 0x9E3779B1u) >> 7) & Mask;
+}
+
+static inline size_t SearchGramCapacity(size_t PostingCapacity)
+{
+	// Distinct grams are far fewer than postings in practice. Keep the table at most half full.
+	size_t expectedGrams = PostingCapacity / 8 < (1 << 18) ? PostingCapacity / 8 : (1 << 18);
+	size_t capacity = 1024;
+	while (capacity < expectedGrams * 2)
+	{
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+static inline size_t SearchBlockCapacity(size_t PostingCapacity, size_t GramCapacity)
+{
+	// Every gram's last block is partially filled. Leave some slack for that.
+	return PostingCapacity / SGraphSearchIndex::PostingBlock::ENTRY_COUNT + GramCapacity / 4 + 1;
+}
+
+size_t SGraphSearchIndex::GetRequiredMemorySize(size_t MaxNodeCount, size_t PostingCapacity)
+{
+	const size_t allocOverhead = sizeof(size_t);
+
+	if (PostingCapacity == 0)
+	{
+		PostingCapacity = MaxNodeCount * SGRAPH_SEARCH_DEFAULT_POSTINGS_PER_NODE;
+	}
+
+	const size_t gramCapacity = SearchGramCapacity(PostingCapacity);
+	return sizeof(PostingBlock) * SearchBlockCapacity(PostingCapacity, gramCapacity) + allocOverhead
+		+ sizeof(GramSlot) * gramCapacity + allocOverhead
+		+ ((sizeof(uint32_t) * MaxNodeCount + 7) & ~(size_t)7) + allocOverhead;
+}
+
+bool SGraphSearchIndex::Initialize(MemoryAllocator& Allocator, const SGraphStore& InStore, size_t PostingCapacity)
+{
+	if (InStore.MaxNodeCount > (size_t)UINT32_MAX)
+	{
+		// ASSERT Postings store node IDs on 32 bits.
+		return false;
+	}
+
+	*this = {};
+	Store = &InStore;
+
+	if (PostingCapacity == 0)
+	{
+		PostingCapacity = InStore.MaxNodeCount * SGRAPH_SEARCH_DEFAULT_POSTINGS_PER_NODE;
+	}
+
+	GramCapacity = SearchGramCapacity(PostingCapacity);
+	BlockCapacity = (uint32_t)SearchBlockCapacity(PostingCapacity, GramCapacity);
+
+	Blocks = (PostingBlock*)Allocator.Allocate(sizeof(PostingBlock) * BlockCapacity);
+	Grams = (GramSlot*)Allocator.Allocate(sizeof(GramSlot) * GramCapacity);
+	SeenStamps = (uint32_t*)Allocator.Allocate((sizeof(uint32_t) * InStore.MaxNodeCount + 7) & ~(size_t)7);
+
+	if (Blocks == nullptr || Grams == nullptr || SeenStamps == nullptr)
+	{
+		return false;
+	}
+
+	memset(SeenStamps, 0, sizeof(uint32_t) * InStore.MaxNodeCount);
+	Rebuild();
+	return true;
+}
+
+bool SGraphSearchIndex::Rebuild()
+{
+	BlockCount = 0;
+	GramCount = 0;
+	memset(Grams, 0, sizeof(GramSlot) * GramCapacity);
+
+	bool bSuccess = true;
+	Store->ForEachNode([&](SNodeGUID NodeID)
+	{
+		bSuccess = bSuccess && AddNodePostings(NodeID);
+	});
+
+	bDegraded = !bSuccess;
+	return bSuccess;
+}
+
+void SGraphSearchIndex::OnNodeNamed(SNodeGUID NodeID)
+{
+	if (bDegraded || !Store->NodeExists(NodeID))
+	{
+		return;
+	}
+
+	// Out of room. Rebuilding drops the postings of renamed and deleted nodes, which is usually enough.
+	if (!AddNodePostings(NodeID))
+	{
+		Rebuild();
+	}
+}
+
+bool SGraphSearchIndex::AddNodePostings(SNodeGUID NodeID)
+{
+	char name[SNODE_NAME_MAX_LENGTH + 1];
+	const size_t length = SearchFold(Store->GetNodeName(NodeID), name);
+
+	// Collect unique grams first so a node gets a single posting per gram.
+	uint32_t keys[SNODE_NAME_MAX_LENGTH * 4];
+	size_t keyCount = 0;
+
+	for (size_t charIndex = 0; charIndex < length; charIndex++)
+	{
+		if (charIndex + 3 <= length)
+		{
+			keys[keyCount++] = SearchGramKey(SGRAPH_SEARCH_GRAM_TRIGRAM, name + charIndex, 3);
+		}
+
+		const bool bWordStart = !SearchIsSeparator(name[charIndex]) && (charIndex == 0 || SearchIsSeparator(name[charIndex - 1]));
+		if (bWordStart)
+		{
+			for (size_t gramLength = 1; gramLength <= 3 && charIndex + gramLength <= length; gramLength++)
+			{
+				keys[keyCount++] = SearchGramKey(SGRAPH_SEARCH_GRAM_ANCHORED, name + charIndex, gramLength);
+			}
+		}
+	}
+
+	std::sort(keys, keys + keyCount);
+	keyCount = std::unique(keys, keys + keyCount) - keys;
+
+	for (size_t keyIndex = 0; keyIndex < keyCount; keyIndex++)
+	{
+		if (!AddPosting(keys[keyIndex], (uint32_t)NodeID))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SGraphSearchIndex::AddPosting(uint32_t GramKey, uint32_t NodeID)
+{
+	const size_t mask = GramCapacity - 1;
+	size_t slot = SearchGramSlot(GramKey, mask);
+	while (Grams[slot].Key != 0 && Grams[slot].Key != GramKey)
+	{
+		slot = (slot + 1) & mask;
+	}
+
+	GramSlot& gram = Grams[slot];
+	if (gram.Key == 0)
+	{
+		if (GramCount + 1 > GramCapacity / 2)
+		{
+			return false;
+		}
+
+		gram = { GramKey, SGRAPH_SEARCH_INVALID_BLOCK, SGRAPH_SEARCH_INVALID_BLOCK, 0 };
+		GramCount++;
+	}
+
+	// Start a new block when the last one is full.
+	const uint32_t indexInBlock = gram.PostingCount % PostingBlock::ENTRY_COUNT;
+	if (indexInBlock == 0)
+	{
+		if (BlockCount == BlockCapacity)
+		{
+			return false;
+		}
+
+		const uint32_t blockIndex = BlockCount++;
+		Blocks[blockIndex].Next = SGRAPH_SEARCH_INVALID_BLOCK;
+		if (gram.LastBlock != SGRAPH_SEARCH_INVALID_BLOCK)
+		{
+			Blocks[gram.LastBlock].Next = blockIndex;
+		}
+		else
+		{
+			gram.FirstBlock = blockIndex;
+		}
+		gram.LastBlock = blockIndex;
+	}
+
+	Blocks[gram.LastBlock].NodeIDs[indexInBlock] = NodeID;
+	gram.PostingCount++;
+	return true;
+}
+
+const SGraphSearchIndex::GramSlot* SGraphSearchIndex::FindGram(uint32_t GramKey) const
+{
+	const size_t mask = GramCapacity - 1;
+	for (size_t slot = SearchGramSlot(GramKey, mask); Grams[slot].Key != 0; slot = (slot + 1) & mask)
+	{
+		if (Grams[slot].Key == GramKey)
+		{
+			return &Grams[slot];
+		}
+	}
+	return nullptr;
+}
+
+/*
+	Finds the best match of Query in Name, both folded. Prefix matches are only accepted at word starts.
+	Returns whether a match was found.
+*/
+static bool SearchMatchName(const char* Name, size_t NameLength, const char* Query, size_t QueryLength, bool bPrefixOnly,
+	SGraphSearchMatchKind& OutKind, uint8_t& OutPosition)
+{
+	bool bFound = false;
+	for (size_t position = 0; position + QueryLength <= NameLength; position++)
+	{
+		if (memcmp(Name + position, Query, QueryLength) != 0)
+		{
+			continue;
+		}
+
+		SGraphSearchMatchKind kind = SGraphSearchMatchKind::SUBSTRING;
+		if (position == 0)
+		{
+			kind = QueryLength == NameLength ? SGraphSearchMatchKind::EXACT : SGraphSearchMatchKind::NAME_PREFIX;
+		}
+		else if (SearchIsSeparator(Name[position - 1]))
+		{
+			kind = SGraphSearchMatchKind::WORD_PREFIX;
+		}
+
+		if (bPrefixOnly && kind == SGraphSearchMatchKind::SUBSTRING)
+		{
+			continue;
+		}
+
+		if (!bFound || kind < OutKind)
+		{
+			bFound = true;
+			OutKind = kind;
+			OutPosition = (uint8_t)position;
+		}
+
+		// Matches are found left to right, so nothing after a word start can rank better.
+		if (kind != SGraphSearchMatchKind::SUBSTRING)
+		{
+			break;
+		}
+	}
+	return bFound;
+}
+
+size_t SGraphSearchIndex::Search(const SGraphSearchQuery& Query, SGraphSearchHit* OutHits, size_t HitCapacity, SGraphSearchResultInfo& OutInfo)
+{
+	OutInfo = {};
+
+	// Fold and trim the query. Nothing longer than a name can match.
+	std::string_view text = Query.Text;
+	while (!text.empty() && SearchIsSeparator(text.front())) text.remove_prefix(1);
+	while (!text.empty() && SearchIsSeparator(text.back())) text.remove_suffix(1);
+
+	if (text.empty() || text.size() > SNODE_NAME_MAX_LENGTH)
+	{
+		return 0;
+	}
+
+	char query[SNODE_NAME_MAX_LENGTH + 1];
+	const size_t queryLength = SearchFold(text, query);
+	const bool bPrefixOnly = Query.Mode == SGraphSearchMode::PREFIX || queryLength < 3;
+
+	const size_t rankedCapacity = std::min(Query.Offset + Query.Count, SGRAPH_SEARCH_MAX_RANKED_RESULTS);
+	if (rankedCapacity <= Query.Offset)
+	{
+		return 0;
+	}
+
+	// Every match must contain each of these grams, so the smallest of their posting lists holds all candidates.
+	const GramSlot* candidates = nullptr;
+	bool bNoCandidates = false;
+	if (!bDegraded)
+	{
+		auto ConsiderGram = [&](uint32_t GramKey)
+		{
+			const GramSlot* gram = FindGram(GramKey);
+			if (gram == nullptr)
+			{
+				bNoCandidates = true;
+			}
+			else if (candidates == nullptr || gram->PostingCount < candidates->PostingCount)
+			{
+				candidates = gram;
+			}
+		};
+
+		if (bPrefixOnly)
+		{
+			ConsiderGram(SearchGramKey(SGRAPH_SEARCH_GRAM_ANCHORED, query, queryLength < 3 ? queryLength : 3));
+		}
+		for (size_t charIndex = 0; charIndex + 3 <= queryLength; charIndex++)
+		{
+			ConsiderGram(SearchGramKey(SGRAPH_SEARCH_GRAM_TRIGRAM, query + charIndex, 3));
+		}
+
+		if (bNoCandidates)
+		{
+			return 0;
+		}
+	}
+
+	if (++QueryStamp == 0)
+	{
+		memset(SeenStamps, 0, sizeof(uint32_t) * Store->MaxNodeCount);
+		QueryStamp = 1;
+	}
+
+	// Best matches so far, as a max heap of rank keys: match kind, then name length, then node ID.
+	uint64_t ranked[SGRAPH_SEARCH_MAX_RANKED_RESULTS];
+	size_t rankedCount = 0;
+	size_t checkedCount = 0;
+
+	auto CheckCandidate = [&](SNodeGUID NodeID)
+	{
+		if (!Store->NodeExists(NodeID) || SeenStamps[NodeID] == QueryStamp)
+		{
+			return;
+		}
+		SeenStamps[NodeID] = QueryStamp;
+		checkedCount++;
+
+		char name[SNODE_NAME_MAX_LENGTH + 1];
+		const size_t nameLength = SearchFold(Store->GetNodeName(NodeID), name);
+
+		SGraphSearchMatchKind kind;
+		uint8_t position;
+		if (!SearchMatchName(name, nameLength, query, queryLength, bPrefixOnly, kind, position))
+		{
+			return;
+		}
+
+		OutInfo.MatchCount++;
+		const uint64_t rankKey = ((uint64_t)kind << 56) | ((uint64_t)nameLength << 48) | (NodeID & 0xFFFFFFFFFFFFull);
+		if (rankedCount < rankedCapacity)
+		{
+			ranked[rankedCount++] = rankKey;
+			std::push_heap(ranked, ranked + rankedCount);
+		}
+		else if (rankKey < ranked[0])
+		{
+			std::pop_heap(ranked, ranked + rankedCount);
+			ranked[rankedCount - 1] = rankKey;
+			std::push_heap(ranked, ranked + rankedCount);
+		}
+	};
+
+	if (candidates != nullptr)
+	{
+		uint32_t remaining = candidates->PostingCount;
+		for (uint32_t blockIndex = candidates->FirstBlock; blockIndex != SGRAPH_SEARCH_INVALID_BLOCK && remaining > 0; blockIndex = Blocks[blockIndex].Next)
+		{
+			const PostingBlock& block = Blocks[blockIndex];
+			const uint32_t entryCount = remaining < PostingBlock::ENTRY_COUNT ? remaining : PostingBlock::ENTRY_COUNT;
+			for (uint32_t entryIndex = 0; entryIndex < entryCount && checkedCount < Query.MaxCandidates; entryIndex++)
+			{
+				CheckCandidate(block.NodeIDs[entryIndex]);
+			}
+			remaining -= entryCount;
+
+			if (checkedCount >= Query.MaxCandidates)
+			{
+				OutInfo.bTruncated = remaining > 0;
+				break;
+			}
+		}
+	}
+	else
+	{
+		// Degraded index. Scan the store, within the same candidate budget.
+		OutInfo.bScanned = true;
+		for (SNodeGUID nodeID = 0; nodeID < Store->NodeHighWaterMark; nodeID++)
+		{
+			if (checkedCount >= Query.MaxCandidates)
+			{
+				OutInfo.bTruncated = true;
+				break;
+			}
+			CheckCandidate(nodeID);
+		}
+	}
+
+	// Output the requested page, best first.
+	std::sort_heap(ranked, ranked + rankedCount);
+	for (size_t rankIndex = Query.Offset; rankIndex < rankedCount && OutInfo.HitCount < HitCapacity; rankIndex++)
+	{
+		SGraphSearchHit& hit = OutHits[OutInfo.HitCount++];
+		hit.NodeID = ranked[rankIndex] & 0xFFFFFFFFFFFFull;
+
+		// Position isn't part of the rank key, find it again.
+		char name[SNODE_NAME_MAX_LENGTH + 1];
+		const size_t nameLength = SearchFold(Store->GetNodeName(hit.NodeID), name);
+		SearchMatchName(name, nameLength, query, queryLength, bPrefixOnly, hit.Kind, hit.MatchPosition);
+	}
+
+	return OutInfo.HitCount;
+}
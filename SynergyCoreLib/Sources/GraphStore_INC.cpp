@@ -0,0 +1,580 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Graph Store.
+
+#include "SynergyCore.h"
+#include "Graph/SynergyGraphStore.h"
+
+#include <type_traits>
+
+// Name index slot value for removed entries, so probing sequences going through them aren't cut short.
+constexpr SNodeGUID SGRAPH_NAME_INDEX_TOMBSTONE = SNODE_INVALID_ID - 1;
+
+// Marks the entries a name index rehash has yet to move. Node IDs never get anywhere near this bit.
+constexpr SNodeGUID SGRAPH_NAME_INDEX_REHASH_PENDING = (SNodeGUID)1 << 62;
+
+// Share of name index slots, live or tombstones, past which the index is rehashed in place. In quarters.
+constexpr size_t SGRAPH_NAME_INDEX_MAX_LOAD_QUARTERS = 3;
+
+// Rounds allocation sizes up so every array of the store stays 8-byte aligned within the stack allocator.
+static inline size_t GraphStoreAlignedSize(size_t Size)
+{
+	return (Size + 7) & ~(size_t)7;
+}
+
+static inline size_t GraphStoreNameArenaSize(size_t MaxNodeCount, size_t NameArenaSize)
+{
+	return NameArenaSize > 0 ? NameArenaSize : MaxNodeCount * SGRAPH_DEFAULT_NAME_BYTES_PER_NODE;
+}
+
+// Name handles are arena offsets and thus clustered, spread them before indexing.
+static inline size_t GraphStoreNameIndexSlot(SNameHandle Name, size_t Mask)
+{
+	return (size_t)(((uint64_t)Name * 0x9E3779B97F4A7C15ull) >> 32) & Mask;
+}
+
+static inline size_t GraphStoreNameIndexCapacity(size_t MaxNodeCount)
+{
+	size_t capacity = 16;
+	while (capacity < MaxNodeCount * 2)
+	{
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+size_t SGraphStore::GetRequiredMemorySize(size_t InMaxNodeCount, size_t InMaxEdgeCount, size_t InNameArenaSize)
+{
+	// Every stack allocation is followed by its size.
+	const size_t allocOverhead = sizeof(size_t);
+
+	// Node columns, in allocation order.
+	const size_t nodeColumnsSize =
+		GraphStoreAlignedSize(sizeof(SGraphNodeFlags) * InMaxNodeCount) + allocOverhead
+		+ 4 * (GraphStoreAlignedSize(sizeof(SNodeGUID) * InMaxNodeCount) + allocOverhead)
+		+ 2 * (GraphStoreAlignedSize(sizeof(uint32_t) * InMaxNodeCount) + allocOverhead)
+		+ 2 * (GraphStoreAlignedSize(sizeof(SGraphEdgeIndex) * InMaxNodeCount) + allocOverhead)
+		+ GraphStoreAlignedSize(sizeof(SNameHandle) * InMaxNodeCount) + allocOverhead
+		+ GraphStoreAlignedSize(sizeof(SGraphNodeColdData) * InMaxNodeCount) + allocOverhead;
+
+	return sizeof(StackAllocatorData)
+		+ nodeColumnsSize
+		+ GraphStoreAlignedSize(sizeof(SGraphEdge) * InMaxEdgeCount) + allocOverhead
+		+ GraphStoreAlignedSize(sizeof(SNodeGUID) * GraphStoreNameIndexCapacity(InMaxNodeCount)) + allocOverhead
+		+ SNamePool::GetRequiredMemorySize(GraphStoreNameArenaSize(InMaxNodeCount, InNameArenaSize), InMaxNodeCount * 2);
+}
+
+bool SGraphStore::Initialize(MemoryAllocator& Allocator, size_t InMaxNodeCount, size_t InMaxEdgeCount, size_t InNameArenaSize)
+{
+	if (InMaxEdgeCount >= SGRAPH_INVALID_EDGE)
+	{
+		// ASSERT Edge indices are 32 bits.
+		return false;
+	}
+
+	*this = {};
+
+	MaxNodeCount = InMaxNodeCount;
+	MaxEdgeCount = InMaxEdgeCount;
+	NameIndexCapacity = GraphStoreNameIndexCapacity(InMaxNodeCount);
+
+	// Allocates a column of MaxNodeCount elements.
+	auto AllocateColumn = [&](auto*& Column)
+	{
+		Column = (std::remove_reference_t<decltype(*Column)>*)Allocator.Allocate(GraphStoreAlignedSize(sizeof(*Column) * MaxNodeCount));
+		return Column != nullptr;
+	};
+
+	bool bAllocated =
+		AllocateColumn(Flags) && AllocateColumn(ParentIDs)
+		&& AllocateColumn(FirstChild) && AllocateColumn(NextSibling) && AllocateColumn(PrevSibling)
+		&& AllocateColumn(OutDegree) && AllocateColumn(InDegree)
+		&& AllocateColumn(FirstOutEdge) && AllocateColumn(FirstInEdge)
+		&& AllocateColumn(NameHandles) && AllocateColumn(ColdData);
+
+	if (bAllocated)
+	{
+		Edges = (SGraphEdge*)Allocator.Allocate(GraphStoreAlignedSize(sizeof(SGraphEdge) * MaxEdgeCount));
+		NameIndex = (SNodeGUID*)Allocator.Allocate(GraphStoreAlignedSize(sizeof(SNodeGUID) * NameIndexCapacity));
+	}
+
+	if (!bAllocated || Edges == nullptr || NameIndex == nullptr
+		|| !Names.Initialize(Allocator, GraphStoreNameArenaSize(MaxNodeCount, InNameArenaSize), MaxNodeCount * 2))
+	{
+		return false;
+	}
+
+	// Free slots have no flags, and every other column is reset when a node is created in them.
+	memset(Flags, 0, sizeof(SGraphNodeFlags) * MaxNodeCount);
+	memset(NameIndex, 0xFF, sizeof(SNodeGUID) * NameIndexCapacity);
+
+	return true;
+}
+
+SNodeGUID SGraphStore::FindAvailableID() const
+{
+	for (SNodeGUID nodeID = FreeIDHint; nodeID < MaxNodeCount; nodeID++)
+	{
+		if ((Flags[nodeID] & SGRAPH_NODE_FLAG_EXISTS) == 0)
+		{
+			return nodeID;
+		}
+	}
+
+	return SNODE_INVALID_ID;
+}
+
+SNodeGUID SGraphStore::ReserveIDRange(size_t Count)
+{
+	if (Count > MaxNodeCount - NodeHighWaterMark)
+	{
+		return SNODE_INVALID_ID;
+	}
+
+	SNodeGUID firstID = NodeHighWaterMark;
+	NodeHighWaterMark += Count;
+	return firstID;
+}
+
+bool SGraphStore::CreateNode(SNodeGUID NodeID, SNameHandle Name, SNodeGUID ParentID)
+{
+	if (NodeID >= MaxNodeCount || NodeExists(NodeID) || Name == SNAME_INVALID_HANDLE)
+	{
+		return false;
+	}
+
+	Flags[NodeID] = SGRAPH_NODE_FLAG_EXISTS;
+	ParentIDs[NodeID] = SNODE_INVALID_ID;
+	FirstChild[NodeID] = SNODE_INVALID_ID;
+	NextSibling[NodeID] = SNODE_INVALID_ID;
+	PrevSibling[NodeID] = SNODE_INVALID_ID;
+	OutDegree[NodeID] = 0;
+	InDegree[NodeID] = 0;
+	FirstOutEdge[NodeID] = SGRAPH_INVALID_EDGE;
+	FirstInEdge[NodeID] = SGRAPH_INVALID_EDGE;
+	NameHandles[NodeID] = Name;
+	Names.AddRef(Name);
+	ColdData[NodeID].CreationStamp = ColdData[NodeID].ModificationStamp = ++ModificationCounter;
+
+	NameIndexInsert(NodeID);
+
+	if (NodeExists(ParentID))
+	{
+		LinkChild(ParentID, NodeID);
+	}
+
+	NodeCount++;
+	if (NodeID >= NodeHighWaterMark)
+	{
+		NodeHighWaterMark = NodeID + 1;
+	}
+	if (NodeID == FreeIDHint)
+	{
+		FreeIDHint++;
+	}
+
+	return true;
+}
+
+void SGraphStore::DeleteNode(SNodeGUID NodeID)
+{
+	if (!NodeExists(NodeID))
+	{
+		return;
+	}
+
+	// Remove every connection involving the node. SetConnection unlinks the edge from both of its lists.
+	while (FirstOutEdge[NodeID] != SGRAPH_INVALID_EDGE)
+	{
+		SetConnection(NodeID, Edges[FirstOutEdge[NodeID]].Dest, SNodeConnectionAccessLevel::NONE);
+	}
+	while (FirstInEdge[NodeID] != SGRAPH_INVALID_EDGE)
+	{
+		SetConnection(Edges[FirstInEdge[NodeID]].Src, NodeID, SNodeConnectionAccessLevel::NONE);
+	}
+
+	// Leave the hierarchy. Children that are still around become parentless.
+	UnlinkChild(NodeID);
+	while (FirstChild[NodeID] != SNODE_INVALID_ID)
+	{
+		UnlinkChild(FirstChild[NodeID]);
+	}
+
+	NameIndexRemove(NodeID);
+	Names.Release(NameHandles[NodeID]);
+	Flags[NodeID] = 0;
+	NameHandles[NodeID] = SNAME_INVALID_HANDLE;
+	ModificationCounter++;
+
+	NodeCount--;
+	if (NodeID < FreeIDHint)
+	{
+		FreeIDHint = NodeID;
+	}
+}
+
+void SGraphStore::RenameNode(SNodeGUID NodeID, SNameHandle NewName)
+{
+	if (!NodeExists(NodeID) || NewName == SNAME_INVALID_HANDLE || NameHandles[NodeID] == NewName)
+	{
+		return;
+	}
+
+	NameIndexRemove(NodeID);
+	Names.AddRef(NewName);
+	Names.Release(NameHandles[NodeID]);
+	NameHandles[NodeID] = NewName;
+	NameIndexInsert(NodeID);
+	Touch(NodeID);
+}
+
+void SGraphStore::SetParent(SNodeGUID NodeID, SNodeGUID NewParentID)
+{
+	if (!NodeExists(NodeID) || ParentIDs[NodeID] == NewParentID)
+	{
+		return;
+	}
+
+	UnlinkChild(NodeID);
+	if (NodeExists(NewParentID))
+	{
+		LinkChild(NewParentID, NodeID);
+	}
+	Touch(NodeID);
+}
+
+void SGraphStore::LinkChild(SNodeGUID ParentID, SNodeGUID ChildID)
+{
+	ParentIDs[ChildID] = ParentID;
+	PrevSibling[ChildID] = SNODE_INVALID_ID;
+	NextSibling[ChildID] = FirstChild[ParentID];
+	if (FirstChild[ParentID] != SNODE_INVALID_ID)
+	{
+		PrevSibling[FirstChild[ParentID]] = ChildID;
+	}
+	FirstChild[ParentID] = ChildID;
+}
+
+void SGraphStore::UnlinkChild(SNodeGUID ChildID)
+{
+	const SNodeGUID parentID = ParentIDs[ChildID];
+	if (parentID == SNODE_INVALID_ID)
+	{
+		return;
+	}
+
+	if (PrevSibling[ChildID] != SNODE_INVALID_ID)
+	{
+		NextSibling[PrevSibling[ChildID]] = NextSibling[ChildID];
+	}
+	else
+	{
+		FirstChild[parentID] = NextSibling[ChildID];
+	}
+
+	if (NextSibling[ChildID] != SNODE_INVALID_ID)
+	{
+		PrevSibling[NextSibling[ChildID]] = PrevSibling[ChildID];
+	}
+
+	ParentIDs[ChildID] = SNODE_INVALID_ID;
+	NextSibling[ChildID] = SNODE_INVALID_ID;
+	PrevSibling[ChildID] = SNODE_INVALID_ID;
+}
+
+SGraphNodeColumns SGraphStore::GetNodeColumns() const
+{
+	SGraphNodeColumns columns;
+	columns.SlotCount = NodeHighWaterMark;
+	columns.Flags = Flags;
+	columns.ParentIDs = ParentIDs;
+	columns.NameHandles = NameHandles;
+	columns.FirstChild = FirstChild;
+	columns.NextSibling = NextSibling;
+	columns.OutDegree = OutDegree;
+	columns.InDegree = InDegree;
+	columns.ColdData = ColdData;
+	return columns;
+}
+
+SNodeGUID SGraphStore::FindNodeByName(std::string_view Name) const
+{
+	// A name that was never interned can't belong to any node. Otherwise comparing handles is enough.
+	const SNameHandle handle = Names.Find(Name);
+	if (handle == SNAME_INVALID_HANDLE)
+	{
+		return SNODE_INVALID_ID;
+	}
+
+	// Probing is capped at the capacity, so a table without empty slots can't loop forever.
+	const size_t mask = NameIndexCapacity - 1;
+	size_t slot = GraphStoreNameIndexSlot(handle, mask);
+	for (size_t probeCount = 0; probeCount < NameIndexCapacity && NameIndex[slot] != SNODE_INVALID_ID; probeCount++, slot = (slot + 1) & mask)
+	{
+		SNodeGUID nodeID = NameIndex[slot];
+		if (nodeID != SGRAPH_NAME_INDEX_TOMBSTONE && NameHandles[nodeID] == handle)
+		{
+			return nodeID;
+		}
+	}
+
+	return SNODE_INVALID_ID;
+}
+
+void SGraphStore::NameIndexInsert(SNodeGUID NodeID)
+{
+	if ((NameIndexCount + NameIndexTombstoneCount + 1) * 4 > NameIndexCapacity * SGRAPH_NAME_INDEX_MAX_LOAD_QUARTERS)
+	{
+		NameIndexRehash();
+	}
+
+	// There are always fewer live entries than slots, so a free one is found.
+	const size_t mask = NameIndexCapacity - 1;
+	size_t slot = GraphStoreNameIndexSlot(NameHandles[NodeID], mask);
+	while (NameIndex[slot] != SNODE_INVALID_ID && NameIndex[slot] != SGRAPH_NAME_INDEX_TOMBSTONE)
+	{
+		slot = (slot + 1) & mask;
+	}
+
+	if (NameIndex[slot] == SGRAPH_NAME_INDEX_TOMBSTONE)
+	{
+		NameIndexTombstoneCount--;
+	}
+	NameIndex[slot] = NodeID;
+	NameIndexCount++;
+}
+
+void SGraphStore::NameIndexRemove(SNodeGUID NodeID)
+{
+	const size_t mask = NameIndexCapacity - 1;
+	size_t slot = GraphStoreNameIndexSlot(NameHandles[NodeID], mask);
+	for (size_t probeCount = 0; probeCount < NameIndexCapacity && NameIndex[slot] != SNODE_INVALID_ID; probeCount++, slot = (slot + 1) & mask)
+	{
+		if (NameIndex[slot] == NodeID)
+		{
+			// No probing sequence goes through a slot followed by an empty one, so it can be emptied right away.
+			if (NameIndex[(slot + 1) & mask] == SNODE_INVALID_ID)
+			{
+				NameIndex[slot] = SNODE_INVALID_ID;
+			}
+			else
+			{
+				NameIndex[slot] = SGRAPH_NAME_INDEX_TOMBSTONE;
+				NameIndexTombstoneCount++;
+			}
+			NameIndexCount--;
+			return;
+		}
+	}
+}
+
+/*
+	Clears every tombstone of the name index and moves live entries back as close to their home slot as they can get, without extra memory.
+	HOW IT WORKS
+	Live entries are first marked pending and tombstones emptied. Pending entries are then taken out one at a time and put in the first slot
+	from their home that isn't holding a placed entry. If that slot held a pending entry, that one is taken out in turn, until an empty slot
+	is reached. Placed entries are never moved again, so none of them ever has an empty or pending slot between its home and itself.
+*/
+void SGraphStore::NameIndexRehash()
+{
+	for (size_t slot = 0; slot < NameIndexCapacity; slot++)
+	{
+		if (NameIndex[slot] == SGRAPH_NAME_INDEX_TOMBSTONE)
+		{
+			NameIndex[slot] = SNODE_INVALID_ID;
+		}
+		else if (NameIndex[slot] != SNODE_INVALID_ID)
+		{
+			NameIndex[slot] |= SGRAPH_NAME_INDEX_REHASH_PENDING;
+		}
+	}
+
+	const size_t mask = NameIndexCapacity - 1;
+	for (size_t slot = 0; slot < NameIndexCapacity; slot++)
+	{
+		if (NameIndex[slot] == SNODE_INVALID_ID || (NameIndex[slot] & SGRAPH_NAME_INDEX_REHASH_PENDING) == 0)
+		{
+			continue;
+		}
+
+		SNodeGUID nodeID = NameIndex[slot] & ~SGRAPH_NAME_INDEX_REHASH_PENDING;
+		NameIndex[slot] = SNODE_INVALID_ID;
+		while (nodeID != SNODE_INVALID_ID)
+		{
+			size_t targetSlot = GraphStoreNameIndexSlot(NameHandles[nodeID], mask);
+			while (NameIndex[targetSlot] != SNODE_INVALID_ID && (NameIndex[targetSlot] & SGRAPH_NAME_INDEX_REHASH_PENDING) == 0)
+			{
+				targetSlot = (targetSlot + 1) & mask;
+			}
+
+			const SNodeGUID displacedID = NameIndex[targetSlot];
+			NameIndex[targetSlot] = nodeID;
+			nodeID = displacedID == SNODE_INVALID_ID ? SNODE_INVALID_ID : displacedID & ~SGRAPH_NAME_INDEX_REHASH_PENDING;
+		}
+	}
+
+	NameIndexTombstoneCount = 0;
+}
+
+SNodeConnectionAccessLevel SGraphStore::GetConnection(SNodeGUID Src, SNodeGUID Dest) const
+{
+	if (!NodeExists(Src))
+	{
+		return SNodeConnectionAccessLevel::NONE;
+	}
+
+	for (SGraphEdgeIndex edgeIndex = FirstOutEdge[Src]; edgeIndex != SGRAPH_INVALID_EDGE; edgeIndex = Edges[edgeIndex].NextOut)
+	{
+		if (Edges[edgeIndex].Dest == Dest)
+		{
+			return Edges[edgeIndex].AccessLevel;
+		}
+	}
+
+	return SNodeConnectionAccessLevel::NONE;
+}
+
+SGraphEdgeIndex SGraphStore::AllocateEdge()
+{
+	if (FirstFreeEdge != SGRAPH_INVALID_EDGE)
+	{
+		SGraphEdgeIndex edgeIndex = FirstFreeEdge;
+		FirstFreeEdge = Edges[edgeIndex].NextOut;
+		return edgeIndex;
+	}
+
+	if (EdgeHighWaterMark < MaxEdgeCount)
+	{
+		return EdgeHighWaterMark++;
+	}
+
+	return SGRAPH_INVALID_EDGE;
+}
+
+bool SGraphStore::SetConnection(SNodeGUID Src, SNodeGUID Dest, SNodeConnectionAccessLevel AccessLevel)
+{
+	if (!NodeExists(Src) || !NodeExists(Dest))
+	{
+		return false;
+	}
+
+	// Find the edge in the source's outgoing list, remembering the link pointing to it in case it needs to be removed.
+	SGraphEdgeIndex* outLink = &FirstOutEdge[Src];
+	while (*outLink != SGRAPH_INVALID_EDGE && Edges[*outLink].Dest != Dest)
+	{
+		outLink = &Edges[*outLink].NextOut;
+	}
+
+	// Edit or delete existing edge.
+	if (*outLink != SGRAPH_INVALID_EDGE)
+	{
+		SGraphEdgeIndex edgeIndex = *outLink;
+
+		if (AccessLevel != SNodeConnectionAccessLevel::NONE)
+		{
+			if (Edges[edgeIndex].AccessLevel != AccessLevel)
+			{
+				Edges[edgeIndex].AccessLevel = AccessLevel;
+				Touch(Src);
+				Touch(Dest);
+			}
+			return true;
+		}
+
+		// Unlink from both lists then push onto the free list.
+		*outLink = Edges[edgeIndex].NextOut;
+
+		SGraphEdgeIndex* inLink = &FirstInEdge[Dest];
+		while (*inLink != edgeIndex)
+		{
+			inLink = &Edges[*inLink].NextIn;
+		}
+		*inLink = Edges[edgeIndex].NextIn;
+
+		Edges[edgeIndex] = {};
+		Edges[edgeIndex].NextOut = FirstFreeEdge;
+		FirstFreeEdge = edgeIndex;
+		EdgeCount--;
+
+		OutDegree[Src]--;
+		InDegree[Dest]--;
+		Touch(Src);
+		Touch(Dest);
+		return true;
+	}
+
+	if (AccessLevel == SNodeConnectionAccessLevel::NONE)
+	{
+		// Nothing to delete.
+		return true;
+	}
+
+	// Create new edge at the head of both lists.
+	SGraphEdgeIndex edgeIndex = AllocateEdge();
+	if (edgeIndex == SGRAPH_INVALID_EDGE)
+	{
+		// ASSERT Out of edges.
+		return false;
+	}
+
+	SGraphEdge& edge = Edges[edgeIndex];
+	edge.Src = Src;
+	edge.Dest = Dest;
+	edge.AccessLevel = AccessLevel;
+	edge.NextOut = FirstOutEdge[Src];
+	edge.NextIn = FirstInEdge[Dest];
+	FirstOutEdge[Src] = edgeIndex;
+	FirstInEdge[Dest] = edgeIndex;
+
+	EdgeCount++;
+	OutDegree[Src]++;
+	InDegree[Dest]++;
+	Touch(Src);
+	Touch(Dest);
+	return true;
+}
+
+size_t SGraphStore::GetConnections_Bidirectional(SNodeGUID NodeID, SNodeConnectionDef* ConnectionsBuffer, size_t ConnectionsBufferSize) const
+{
+	if (!NodeExists(NodeID))
+	{
+		return 0;
+	}
+
+	const bool bBufferPassed = ConnectionsBuffer != nullptr && ConnectionsBufferSize > 0;
+	const SNodeGUID parentNodeID = ParentIDs[NodeID];
+	size_t connectionsCount = 0;
+
+	// Outgoing connections, then incoming ones.
+	for (SGraphEdgeIndex edgeIndex = FirstOutEdge[NodeID]; edgeIndex != SGRAPH_INVALID_EDGE; edgeIndex = Edges[edgeIndex].NextOut)
+	{
+		const SGraphEdge& edge = Edges[edgeIndex];
+		if (bBufferPassed && connectionsCount < ConnectionsBufferSize)
+		{
+			ConnectionsBuffer[connectionsCount] =
+			{
+				edge.Src, edge.Dest,
+				edge.AccessLevel,
+				edge.Dest == parentNodeID || ParentIDs[edge.Dest] == NodeID
+			};
+		}
+		connectionsCount++;
+	}
+
+	for (SGraphEdgeIndex edgeIndex = FirstInEdge[NodeID]; edgeIndex != SGRAPH_INVALID_EDGE; edgeIndex = Edges[edgeIndex].NextIn)
+	{
+		const SGraphEdge& edge = Edges[edgeIndex];
+		if (bBufferPassed && connectionsCount < ConnectionsBufferSize)
+		{
+			ConnectionsBuffer[connectionsCount] =
+			{
+				edge.Src, edge.Dest,
+				edge.AccessLevel,
+				edge.Src == parentNodeID || ParentIDs[edge.Src] == NodeID
+			};
+		}
+		connectionsCount++;
+	}
+
+	return connectionsCount;
+}
@@ -0,0 +1,370 @@
+SOURCE_INC_FILE()
+
+// Implementation of identifier-based Graph Transactions.
+
+#include "SynergyCore.h"
+#include "Graph/SynergyGraphTransaction.h"
+
+const char* GetGraphTransactionStatusName(SGraphTransactionStatus Status)
+{
+	switch (Status)
+	{
+	case SGraphTransactionStatus::APPLIED: return "APPLIED";
+	case SGraphTransactionStatus::INVALID_OP: return "INVALID_OP";
+	case SGraphTransactionStatus::MISSING_NODE: return "MISSING_NODE";
+	case SGraphTransactionStatus::INVALID_NAME: return "INVALID_NAME";
+	case SGraphTransactionStatus::HIERARCHY_VIOLATION: return "HIERARCHY_VIOLATION";
+	case SGraphTransactionStatus::OUT_OF_CAPACITY: return "OUT_OF_CAPACITY";
+	case SGraphTransactionStatus::CONFLICT: return "CONFLICT";
+	default: return "UNKNOWN";
+	}
+}
+
+// PRIMITIVES
+// Every store change made by a transaction goes through these, so that it lands in the undo log.
+
+// Starts the log entry of a change about to be made, recording the versions its nodes have before it.
+static SGraphTransactionLogEntry MakeLogEntry(const SGraphStore& Store, const SGraphChange& Change)
+{
+	SGraphTransactionLogEntry entry;
+	entry.Change = Change;
+	entry.PreviousNodeVersion = Store.NodeExists(Change.NodeID) ? Store.GetNodeVersion(Change.NodeID) : 0;
+	entry.PreviousOtherVersion = Store.NodeExists(Change.OtherID) ? Store.GetNodeVersion(Change.OtherID) : 0;
+	return entry;
+}
+
+static bool TransactionSetConnection(SGraphStore& Store, SGraphTransactionContext& Context, SNodeGUID Src, SNodeGUID Dest,
+	SNodeConnectionAccessLevel AccessLevel)
+{
+	const SNodeConnectionAccessLevel previousAccessLevel = Store.GetConnection(Src, Dest);
+	if (previousAccessLevel == AccessLevel)
+	{
+		return true;
+	}
+
+	SGraphTransactionLogEntry entry = MakeLogEntry(Store, { SGraphChangeKind::CONNECTION_CHANGED, AccessLevel, 0, Src, Dest });
+	entry.PreviousAccessLevel = previousAccessLevel;
+
+	if (!Store.SetConnection(Src, Dest, AccessLevel))
+	{
+		return false;
+	}
+
+	Context.Log.push_back(entry);
+	return true;
+}
+
+static void TransactionSetParent(SGraphStore& Store, SGraphTransactionContext& Context, SNodeGUID NodeID, SNodeGUID ParentID)
+{
+	SGraphTransactionLogEntry entry = MakeLogEntry(Store, { SGraphChangeKind::PARENT_CHANGED, SNodeConnectionAccessLevel::NONE, 0, NodeID, ParentID });
+	entry.PreviousOtherID = Store.ParentIDs[NodeID];
+
+	Store.SetParent(NodeID, ParentID);
+	Context.Log.push_back(entry);
+}
+
+static void TransactionDeleteNode(SGraphStore& Store, SGraphTransactionContext& Context, SNodeGUID NodeID)
+{
+	// Connections are logged one by one so they can be restored, the store then drops them all along with the node.
+	for (SGraphEdgeIndex edgeIndex = Store.FirstOutEdge[NodeID]; edgeIndex != SGRAPH_INVALID_EDGE; edgeIndex = Store.Edges[edgeIndex].NextOut)
+	{
+		SGraphTransactionLogEntry entry = MakeLogEntry(Store,
+			{ SGraphChangeKind::CONNECTION_CHANGED, SNodeConnectionAccessLevel::NONE, 0, NodeID, Store.Edges[edgeIndex].Dest });
+		entry.PreviousAccessLevel = Store.Edges[edgeIndex].AccessLevel;
+		Context.Log.push_back(entry);
+	}
+	for (SGraphEdgeIndex edgeIndex = Store.FirstInEdge[NodeID]; edgeIndex != SGRAPH_INVALID_EDGE; edgeIndex = Store.Edges[edgeIndex].NextIn)
+	{
+		SGraphTransactionLogEntry entry = MakeLogEntry(Store,
+			{ SGraphChangeKind::CONNECTION_CHANGED, SNodeConnectionAccessLevel::NONE, 0, Store.Edges[edgeIndex].Src, NodeID });
+		entry.PreviousAccessLevel = Store.Edges[edgeIndex].AccessLevel;
+		Context.Log.push_back(entry);
+	}
+
+	SGraphTransactionLogEntry entry = MakeLogEntry(Store,
+		{ SGraphChangeKind::NODE_DELETED, SNodeConnectionAccessLevel::NONE, 0, NodeID, Store.ParentIDs[NodeID] });
+	entry.PreviousValue = Store.NameHandles[NodeID];
+
+	Store.DeleteNode(NodeID);
+	Context.Log.push_back(entry);
+}
+
+// Plays the undo log backwards, restoring the store to its state before the transaction.
+void RollbackGraphTransaction(SGraphStore& Store, SGraphTransactionContext& Context)
+{
+	for (size_t entryIndex = Context.Log.size(); entryIndex-- > 0;)
+	{
+		const SGraphTransactionLogEntry& entry = Context.Log[entryIndex];
+		const SGraphChange& change = entry.Change;
+
+		switch (change.Kind)
+		{
+		case SGraphChangeKind::NODE_CREATED:
+			// Its connections were undone already, they were logged after it.
+			Store.DeleteNode(change.NodeID);
+			break;
+		case SGraphChangeKind::NODE_DELETED:
+			Store.CreateNode(change.NodeID, entry.PreviousValue, change.OtherID);
+			break;
+		case SGraphChangeKind::NODE_RENAMED:
+			Store.RenameNode(change.NodeID, entry.PreviousValue);
+			break;
+		case SGraphChangeKind::PARENT_CHANGED:
+			Store.SetParent(change.NodeID, entry.PreviousOtherID);
+			break;
+		case SGraphChangeKind::CONNECTION_CHANGED:
+			// Restoring a connection can't run out of edges: the transaction freed the one it used.
+			Store.SetConnection(change.NodeID, change.OtherID, entry.PreviousAccessLevel);
+			break;
+		default:
+			break;
+		}
+
+		// Going backwards, the versions left are those from before the transaction.
+		if (Store.NodeExists(change.NodeID))
+		{
+			Store.ColdData[change.NodeID].ModificationStamp = entry.PreviousNodeVersion;
+		}
+		if (Store.NodeExists(change.OtherID))
+		{
+			Store.ColdData[change.OtherID].ModificationStamp = entry.PreviousOtherVersion;
+		}
+	}
+
+	Context.Log.clear();
+	Context.CreatedIDs.clear();
+}
+
+// OPS
+
+SGraphTransactionStatus ApplyGraphOp(SGraphStore& Store, const SGraphOp& Op, SGraphTransactionContext& Context)
+{
+	auto Resolve = [&Context](SNodeGUID NodeRef)
+	{
+		if (IsCreatedNodeRef(NodeRef))
+		{
+			const size_t createdIndex = (size_t)(NodeRef & ~SGRAPH_CREATED_NODE_REF);
+			return createdIndex < Context.CreatedIDs.size() ? Context.CreatedIDs[createdIndex] : SNODE_INVALID_ID;
+		}
+		return NodeRef;
+	};
+
+	const SNodeGUID nodeID = Resolve(Op.NodeID);
+	const SNodeGUID otherID = Resolve(Op.OtherID);
+
+	switch (Op.Type)
+	{
+	case SGraphOpType::FETCH_NODE:
+		if (!Store.NodeExists(nodeID))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+		return Op.Version == 0 || Op.Version == Store.GetNodeVersion(nodeID) ? SGraphTransactionStatus::APPLIED : SGraphTransactionStatus::CONFLICT;
+
+	case SGraphOpType::CREATE_NODE:
+	{
+		if (!IsValidGraphNodeName(Op.Name))
+		{
+			return SGraphTransactionStatus::INVALID_NAME;
+		}
+
+		// Only an empty store may get a root.
+		const bool bRoot = Op.OtherID == SNODE_INVALID_ID;
+		if (bRoot && Store.NodeCount > 0)
+		{
+			return SGraphTransactionStatus::HIERARCHY_VIOLATION;
+		}
+		if (!bRoot && !Store.NodeExists(otherID))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+		if (!bRoot && (!IsValidGraphAccessLevel(Op.AccessLevel, SNodeConnectionAccessLevel::TO_PARENT_MINIMUM)
+			|| !IsValidGraphAccessLevel(Op.AccessLevelFromParent, SNodeConnectionAccessLevel::TO_CHILD_MINIMUM)))
+		{
+			return SGraphTransactionStatus::INVALID_OP;
+		}
+
+		const SNodeGUID newNodeID = Store.FindAvailableID();
+		const SNameHandle name = Store.Names.Intern(Op.Name);
+		if (newNodeID == SNODE_INVALID_ID || name == SNAME_INVALID_HANDLE)
+		{
+			return SGraphTransactionStatus::OUT_OF_CAPACITY;
+		}
+
+		SGraphTransactionLogEntry entry = MakeLogEntry(Store,
+			{ SGraphChangeKind::NODE_CREATED, SNodeConnectionAccessLevel::NONE, name, newNodeID, bRoot ? SNODE_INVALID_ID : otherID });
+
+		Store.CreateNode(newNodeID, name, otherID);
+		Context.Log.push_back(entry);
+		Context.CreatedIDs.push_back(newNodeID);
+
+		if (!bRoot && (!TransactionSetConnection(Store, Context, newNodeID, otherID, Op.AccessLevel)
+			|| !TransactionSetConnection(Store, Context, otherID, newNodeID, Op.AccessLevelFromParent)))
+		{
+			return SGraphTransactionStatus::OUT_OF_CAPACITY;
+		}
+		return SGraphTransactionStatus::APPLIED;
+	}
+
+	case SGraphOpType::DELETE_NODE:
+	{
+		if (!Store.NodeExists(nodeID))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+		if (Store.ParentIDs[nodeID] == SNODE_INVALID_ID || Store.FirstChild[nodeID] != SNODE_INVALID_ID)
+		{
+			return SGraphTransactionStatus::HIERARCHY_VIOLATION;
+		}
+
+		TransactionDeleteNode(Store, Context, nodeID);
+		return SGraphTransactionStatus::APPLIED;
+	}
+
+	case SGraphOpType::RENAME_NODE:
+	{
+		if (!Store.NodeExists(nodeID))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+		if (!IsValidGraphNodeName(Op.Name))
+		{
+			return SGraphTransactionStatus::INVALID_NAME;
+		}
+
+		const SNameHandle name = Store.Names.Intern(Op.Name);
+		if (name == SNAME_INVALID_HANDLE)
+		{
+			return SGraphTransactionStatus::OUT_OF_CAPACITY;
+		}
+
+		if (name != Store.NameHandles[nodeID])
+		{
+			SGraphTransactionLogEntry entry = MakeLogEntry(Store,
+				{ SGraphChangeKind::NODE_RENAMED, SNodeConnectionAccessLevel::NONE, name, nodeID, SNODE_INVALID_ID });
+			entry.PreviousValue = Store.NameHandles[nodeID];
+
+			Store.RenameNode(nodeID, name);
+			Context.Log.push_back(entry);
+		}
+		return SGraphTransactionStatus::APPLIED;
+	}
+
+	case SGraphOpType::SET_PARENT:
+	{
+		if (!Store.NodeExists(nodeID) || !Store.NodeExists(otherID))
+		{
+			return Op.OtherID == SNODE_INVALID_ID ? SGraphTransactionStatus::HIERARCHY_VIOLATION : SGraphTransactionStatus::MISSING_NODE;
+		}
+		if (!IsValidGraphAccessLevel(Op.AccessLevel, SNodeConnectionAccessLevel::TO_PARENT_MINIMUM)
+			|| !IsValidGraphAccessLevel(Op.AccessLevelFromParent, SNodeConnectionAccessLevel::TO_CHILD_MINIMUM))
+		{
+			return SGraphTransactionStatus::INVALID_OP;
+		}
+
+		// The new parent can't be the node itself or one of its descendants.
+		bool bCycle = nodeID == otherID;
+		Store.ForEachAncestor(otherID, [&](SNodeGUID AncestorID)
+		{
+			bCycle |= AncestorID == nodeID;
+			return !bCycle;
+		});
+		if (bCycle)
+		{
+			return SGraphTransactionStatus::HIERARCHY_VIOLATION;
+		}
+
+		const SNodeGUID previousParentID = Store.ParentIDs[nodeID];
+		if (previousParentID != otherID)
+		{
+			if (previousParentID != SNODE_INVALID_ID)
+			{
+				TransactionSetConnection(Store, Context, nodeID, previousParentID, SNodeConnectionAccessLevel::NONE);
+				TransactionSetConnection(Store, Context, previousParentID, nodeID, SNodeConnectionAccessLevel::NONE);
+			}
+			TransactionSetParent(Store, Context, nodeID, otherID);
+		}
+
+		if (!TransactionSetConnection(Store, Context, nodeID, otherID, Op.AccessLevel)
+			|| !TransactionSetConnection(Store, Context, otherID, nodeID, Op.AccessLevelFromParent))
+		{
+			return SGraphTransactionStatus::OUT_OF_CAPACITY;
+		}
+		return SGraphTransactionStatus::APPLIED;
+	}
+
+	case SGraphOpType::SET_CONNECTION:
+	{
+		if (!Store.NodeExists(nodeID) || !Store.NodeExists(otherID))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+
+		// Parent - child connections can be edited but must stay above their minimum.
+		SNodeConnectionAccessLevel minimum = SNodeConnectionAccessLevel::NONE;
+		if (Store.ParentIDs[otherID] == nodeID)
+		{
+			minimum = SNodeConnectionAccessLevel::TO_CHILD_MINIMUM;
+		}
+		else if (Store.ParentIDs[nodeID] == otherID)
+		{
+			minimum = SNodeConnectionAccessLevel::TO_PARENT_MINIMUM;
+		}
+
+		if (nodeID == otherID || !IsValidGraphAccessLevel(Op.AccessLevel, minimum))
+		{
+			return SGraphTransactionStatus::INVALID_OP;
+		}
+
+		return TransactionSetConnection(Store, Context, nodeID, otherID, Op.AccessLevel) ?
+			SGraphTransactionStatus::APPLIED : SGraphTransactionStatus::OUT_OF_CAPACITY;
+	}
+
+	default:
+		return SGraphTransactionStatus::INVALID_OP;
+	}
+}
+
+void PublishGraphTransaction(const SGraphTransactionContext& Context, SGraphTransactionResult& OutResult, SGraphChangeStream* Changes)
+{
+	if (Changes != nullptr && !Context.Log.empty())
+	{
+		Changes->BeginTransaction();
+		for (const SGraphTransactionLogEntry& entry : Context.Log)
+		{
+			Changes->Push(entry.Change);
+		}
+		Changes->EndTransaction();
+		OutResult.Sequence = Changes->TransactionSequence;
+	}
+}
+
+bool ApplyGraphTransaction(SGraphStore& Store, const SGraphOp* Ops, size_t OpCount, SGraphTransactionContext& Context,
+	SGraphTransactionResult& OutResult, SGraphChangeStream* Changes)
+{
+	OutResult = {};
+	Context.Log.clear();
+	Context.CreatedIDs.clear();
+
+	if (OpCount > SGRAPH_TRANSACTION_MAX_OPS)
+	{
+		OutResult.Status = SGraphTransactionStatus::INVALID_OP;
+		OutResult.FailedOpIndex = (uint32_t)SGRAPH_TRANSACTION_MAX_OPS;
+		return false;
+	}
+
+	for (size_t opIndex = 0; opIndex < OpCount; opIndex++)
+	{
+		const SGraphTransactionStatus status = ApplyGraphOp(Store, Ops[opIndex], Context);
+		if (status != SGraphTransactionStatus::APPLIED)
+		{
+			RollbackGraphTransaction(Store, Context);
+			OutResult.Status = status;
+			OutResult.FailedOpIndex = (uint32_t)opIndex;
+			return false;
+		}
+	}
+
+	PublishGraphTransaction(Context, OutResult, Changes);
+	return true;
+}
\ No newline at end of file
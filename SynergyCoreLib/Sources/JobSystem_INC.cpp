@@ -0,0 +1,387 @@
+SOURCE_INC_FILE()
+
+// Implementation of the job system: the workers' deques, their loop, counters and continuations, and the parallel for built on them.
+
+#include "SynergyCore.h"
+#include "SynergyJobSystem.h"
+
+#include <new>
+
+/*
+	HOW IT WORKS
+
+	Every worker owns a Chase-Lev deque: it pushes and pops at the bottom without contention, and thieves take turns at the top with a
+	compare and swap. Submitting jobs pushes them all to the submitting worker's deque, then bumps the work generation and wakes the
+	sleeping workers if there are any.
+
+	A worker looks for jobs in its own deque first, then in the other workers' ones, starting from a different worker every time. Having
+	found nothing for a while, it sleeps until the work generation moves. It reads the generation before looking, and both sides of the
+	sleeping count and generation handshake are sequentially consistent, so either the worker sees jobs that were pushed or the pusher
+	sees the worker is about to sleep and wakes it.
+
+	Running a job decrements its counter once the job returned. The worker bringing a counter to zero submits its continuation, which it
+	read before decrementing since whoever waits on the counter may reuse it as soon as it reaches zero.
+*/
+
+// Rounds of looking for jobs an idle worker does before going to sleep.
+constexpr uint32_t SJOB_IDLE_SPIN_COUNT = 64;
+
+// RunParallelFor splits work in at most this many batches per worker, so stealing stays a small share of the work.
+constexpr size_t SJOB_PARALLEL_FOR_BATCHES_PER_WORKER = 4;
+
+// DEQUES
+
+static bool PushJob(SJobDeque& Deque, const SJob& Job)
+{
+	const int64_t bottom = Deque.Bottom.load(std::memory_order_relaxed);
+	const int64_t top = Deque.Top.load(std::memory_order_acquire);
+	if (bottom - top >= SJOB_DEQUE_CAPACITY)
+	{
+		return false;
+	}
+
+	// Releasing the new bottom publishes the job, and whatever its submitter wrote before, to thieves.
+	Deque.Jobs[bottom % SJOB_DEQUE_CAPACITY] = Job;
+	Deque.Bottom.store(bottom + 1, std::memory_order_release);
+	return true;
+}
+
+static bool PopJob(SJobDeque& Deque, SJob& OutJob)
+{
+	const int64_t bottom = Deque.Bottom.load(std::memory_order_relaxed) - 1;
+	Deque.Bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = Deque.Top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// Empty.
+		Deque.Bottom.store(bottom + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	OutJob = Deque.Jobs[bottom % SJOB_DEQUE_CAPACITY];
+	if (top < bottom)
+	{
+		return true;
+	}
+
+	// Last job left: thieves may be after it too.
+	const bool bWon = Deque.Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	Deque.Bottom.store(bottom + 1, std::memory_order_relaxed);
+	return bWon;
+}
+
+static bool StealJob(SJobDeque& Deque, SJob& OutJob)
+{
+	int64_t top = Deque.Top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t bottom = Deque.Bottom.load(std::memory_order_acquire);
+	if (top >= bottom)
+	{
+		return false;
+	}
+
+	// The copy may be torn if the slot was taken and refilled meanwhile, but then the top moved on and the swap fails, discarding it.
+	OutJob = Deque.Jobs[top % SJOB_DEQUE_CAPACITY];
+	return Deque.Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+// RUNNING JOBS
+
+static bool FindJob(SJobSystem& System, uint32_t WorkerIndex, SJob& OutJob)
+{
+	SJobWorker& worker = System.Workers[WorkerIndex];
+	if (PopJob(worker.Deque, OutJob))
+	{
+		return true;
+	}
+
+	// Xorshift, so that thieves don't all line up behind the same victim.
+	worker.StealSeed ^= worker.StealSeed << 13;
+	worker.StealSeed ^= worker.StealSeed >> 17;
+	worker.StealSeed ^= worker.StealSeed << 5;
+
+	const uint32_t firstVictim = worker.StealSeed % System.WorkerCount;
+	for (uint32_t victimOffset = 0; victimOffset < System.WorkerCount; victimOffset++)
+	{
+		const uint32_t victimIndex = (firstVictim + victimOffset) % System.WorkerCount;
+		if (victimIndex != WorkerIndex && StealJob(System.Workers[victimIndex].Deque, OutJob))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static void WakeJobWorkers(SJobSystem& System, size_t JobCount)
+{
+	System.WorkGeneration.fetch_add(1, std::memory_order_seq_cst);
+	if (System.SleepingCount.load(std::memory_order_seq_cst) > 0)
+	{
+		// Taking the lock makes sure a worker past its generation check is waiting by the time it's notified.
+		{
+			std::lock_guard<std::mutex> lock(*System.SleepMutex);
+		}
+		if (JobCount == 1)
+		{
+			System.SleepCondition->notify_one();
+		}
+		else
+		{
+			System.SleepCondition->notify_all();
+		}
+	}
+}
+
+static void ExecuteJob(SJobSystem& System, uint32_t WorkerIndex, const SJob& Job);
+
+static void SubmitJob(SJobSystem& System, uint32_t WorkerIndex, const SJob& Job)
+{
+	if (!PushJob(System.Workers[WorkerIndex].Deque, Job))
+	{
+		ExecuteJob(System, WorkerIndex, Job);
+	}
+}
+
+static void ExecuteJob(SJobSystem& System, uint32_t WorkerIndex, const SJob& Job)
+{
+	const SJobContext context = { &System, WorkerIndex, &System.Workers[WorkerIndex].FrameArena };
+	Job.Function(context, Job.Data);
+
+	SJobCounter* counter = Job.Counter;
+	if (counter == nullptr)
+	{
+		return;
+	}
+
+	const SJob continuation = counter->Continuation;
+	if (counter->Pending.fetch_sub(1, std::memory_order_acq_rel) == 1 && continuation.Function != nullptr)
+	{
+		SubmitJob(System, WorkerIndex, continuation);
+		WakeJobWorkers(System, 1);
+	}
+}
+
+static void RunJobWorker(SJobSystem* System, uint32_t WorkerIndex)
+{
+	uint32_t idleRounds = 0;
+	while (!System->bStopping.load(std::memory_order_acquire))
+	{
+		const uint64_t generation = System->WorkGeneration.load(std::memory_order_seq_cst);
+
+		SJob job;
+		if (FindJob(*System, WorkerIndex, job))
+		{
+			ExecuteJob(*System, WorkerIndex, job);
+			idleRounds = 0;
+			continue;
+		}
+
+		if (++idleRounds < SJOB_IDLE_SPIN_COUNT)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		System->SleepingCount.fetch_add(1, std::memory_order_seq_cst);
+		{
+			std::unique_lock<std::mutex> lock(*System->SleepMutex);
+			System->SleepCondition->wait(lock, [System, generation]()
+			{
+				return System->bStopping.load(std::memory_order_acquire) || System->WorkGeneration.load(std::memory_order_seq_cst) != generation;
+			});
+		}
+		System->SleepingCount.fetch_sub(1, std::memory_order_seq_cst);
+		idleRounds = 0;
+	}
+}
+
+// SYSTEM
+
+// Stack allocators hand out memory with whatever alignment the previous allocations left.
+static void* AllocateAlignedJobMemory(MemoryAllocator& Allocator, size_t Size, size_t Alignment)
+{
+	const uintptr_t address = (uintptr_t)Allocator.Allocate(Size + Alignment - 1);
+	return (void*)((address + Alignment - 1) & ~(uintptr_t)(Alignment - 1));
+}
+
+bool InitializeJobSystem(SJobSystem& System, MemoryAllocator& Allocator, const SJobSystemOptions& Options)
+{
+	uint32_t workerCount = Options.WorkerCount != 0 ? Options.WorkerCount : std::thread::hardware_concurrency();
+	workerCount = workerCount < 1 ? 1 : (workerCount > SJOB_MAX_WORKERS ? SJOB_MAX_WORKERS : workerCount);
+	if (Options.FrameArenaSize <= sizeof(StackAllocatorData))
+	{
+		return false;
+	}
+
+	System.WorkerCount = workerCount;
+	System.Workers = (SJobWorker*)AllocateAlignedJobMemory(Allocator, workerCount * sizeof(SJobWorker), alignof(SJobWorker));
+	System.WorkGeneration.store(0, std::memory_order_relaxed);
+	System.SleepingCount.store(0, std::memory_order_relaxed);
+	System.SleepMutex = new (AllocateAlignedJobMemory(Allocator, sizeof(std::mutex), alignof(std::mutex))) std::mutex();
+	System.SleepCondition = new (AllocateAlignedJobMemory(Allocator, sizeof(std::condition_variable), alignof(std::condition_variable)))
+		std::condition_variable();
+	System.bStopping.store(false, std::memory_order_relaxed);
+
+	for (uint32_t workerIndex = 0; workerIndex < workerCount; workerIndex++)
+	{
+		SJobWorker& worker = *new (&System.Workers[workerIndex]) SJobWorker();
+		worker.Deque.Top.store(0, std::memory_order_relaxed);
+		worker.Deque.Bottom.store(0, std::memory_order_relaxed);
+		worker.Deque.Jobs = (SJob*)AllocateAlignedJobMemory(Allocator, SJOB_DEQUE_CAPACITY * sizeof(SJob), alignof(SJob));
+		worker.FrameArenaSize = Options.FrameArenaSize;
+		worker.FrameArenaMemory = (ByteBuffer)AllocateAlignedJobMemory(Allocator, Options.FrameArenaSize, alignof(max_align_t));
+		worker.FrameArena = MakeStackAllocator(worker.FrameArenaMemory, worker.FrameArenaSize);
+		worker.StealSeed = 0x9E3779B9u * (workerIndex + 1);
+		worker.Thread = nullptr;
+	}
+
+	// Workers only start once they can all be stolen from.
+	for (uint32_t workerIndex = 1; workerIndex < workerCount; workerIndex++)
+	{
+		void* threadMemory = AllocateAlignedJobMemory(Allocator, sizeof(std::thread), alignof(std::thread));
+		System.Workers[workerIndex].Thread = new (threadMemory) std::thread(RunJobWorker, &System, workerIndex);
+	}
+	return true;
+}
+
+void ShutdownJobSystem(SJobSystem& System)
+{
+	if (System.Workers == nullptr)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(*System.SleepMutex);
+		System.bStopping.store(true, std::memory_order_release);
+	}
+	System.SleepCondition->notify_all();
+
+	for (uint32_t workerIndex = 1; workerIndex < System.WorkerCount; workerIndex++)
+	{
+		std::thread* thread = System.Workers[workerIndex].Thread;
+		thread->join();
+		thread->~thread();
+	}
+	for (uint32_t workerIndex = 0; workerIndex < System.WorkerCount; workerIndex++)
+	{
+		System.Workers[workerIndex].~SJobWorker();
+	}
+	System.SleepCondition->~condition_variable();
+	System.SleepMutex->~mutex();
+
+	System.Workers = nullptr;
+	System.WorkerCount = 0;
+}
+
+void RunJobs(SJobSystem& System, uint32_t WorkerIndex, SJob* Jobs, size_t JobCount, SJobCounter& Counter, const SJob* Continuation)
+{
+	if (JobCount == 0)
+	{
+		return;
+	}
+
+	// A counter's continuation belongs to the batch that took it off zero, later batches only delay it.
+	if (Counter.Pending.load(std::memory_order_acquire) == 0)
+	{
+		Counter.Continuation = Continuation != nullptr ? *Continuation : SJob{};
+		if (Continuation != nullptr && Continuation->Counter != nullptr)
+		{
+			Continuation->Counter->Pending.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	Counter.Pending.fetch_add((uint32_t)JobCount, std::memory_order_relaxed);
+
+	for (size_t jobIndex = 0; jobIndex < JobCount; jobIndex++)
+	{
+		Jobs[jobIndex].Counter = &Counter;
+		SubmitJob(System, WorkerIndex, Jobs[jobIndex]);
+	}
+	WakeJobWorkers(System, JobCount);
+}
+
+void WaitForJobCounter(SJobSystem& System, uint32_t WorkerIndex, SJobCounter& Counter)
+{
+	while (!Counter.IsDone())
+	{
+		SJob job;
+		if (FindJob(System, WorkerIndex, job))
+		{
+			ExecuteJob(System, WorkerIndex, job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void ResetJobSystemFrameArenas(SJobSystem& System)
+{
+	for (uint32_t workerIndex = 0; workerIndex < System.WorkerCount; workerIndex++)
+	{
+		SJobWorker& worker = System.Workers[workerIndex];
+		worker.FrameArena = MakeStackAllocator(worker.FrameArenaMemory, worker.FrameArenaSize);
+	}
+}
+
+// PARALLEL FOR
+
+struct SJobRange
+{
+	SJobRangeFunction* Function;
+	void* Data;
+	size_t Begin;
+	size_t End;
+};
+
+static void RunJobRange(const SJobContext& Context, void* Data)
+{
+	const SJobRange& range = *(const SJobRange*)Data;
+	range.Function(Context, range.Begin, range.End, range.Data);
+}
+
+void RunParallelFor(SJobSystem& System, uint32_t WorkerIndex, size_t Count, size_t MinBatchSize, SJobRangeFunction* Function, void* Data)
+{
+	MemoryAllocator& frameArena = System.Workers[WorkerIndex].FrameArena;
+	const SJobContext context = { &System, WorkerIndex, &frameArena };
+
+	size_t batchSize = MinBatchSize > 0 ? MinBatchSize : 1;
+	size_t batchCount = (Count + batchSize - 1) / batchSize;
+	const size_t maxBatchCount = System.WorkerCount * SJOB_PARALLEL_FOR_BATCHES_PER_WORKER;
+	if (batchCount > maxBatchCount)
+	{
+		batchSize = (Count + maxBatchCount - 1) / maxBatchCount;
+		batchCount = (Count + batchSize - 1) / batchSize;
+	}
+
+	const size_t batchMemorySize = batchCount * (sizeof(SJobRange) + sizeof(SJob)) + alignof(max_align_t);
+	const size_t arenaSpace = frameArena.Memory.BufferSize - frameArena.Memory.AllocatedByteCount;
+	if (batchCount < 2 || System.WorkerCount < 2 || arenaSpace < batchMemorySize + 2 * sizeof(size_t))
+	{
+		if (Count > 0)
+		{
+			Function(context, 0, Count, Data);
+		}
+		return;
+	}
+
+	void* batchMemory = frameArena.Allocate(batchMemorySize);
+	SJobRange* ranges = (SJobRange*)(((uintptr_t)batchMemory + alignof(max_align_t) - 1) & ~(uintptr_t)(alignof(max_align_t) - 1));
+	SJob* jobs = (SJob*)(ranges + batchCount);
+	for (size_t batchIndex = 0; batchIndex < batchCount; batchIndex++)
+	{
+		const size_t begin = batchIndex * batchSize;
+		ranges[batchIndex] = { Function, Data, begin, begin + batchSize < Count ? begin + batchSize : Count };
+		jobs[batchIndex].Function = RunJobRange;
+		jobs[batchIndex].Data = &ranges[batchIndex];
+	}
+
+	SJobCounter counter;
+	RunJobs(System, WorkerIndex, jobs, batchCount, counter);
+	WaitForJobCounter(System, WorkerIndex, counter);
+
+	// The batches aren't freed: jobs run while waiting may have allocated on top of them and still use it. They go when the arena is reset.
+}
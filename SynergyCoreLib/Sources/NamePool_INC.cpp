@@ -0,0 +1,201 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Name Pool.
+
+#include "SynergyCore.h"
+#include "Graph/SynergyNamePool.h"
+
+static inline size_t NamePoolIndexCapacity(size_t MaxNameCount)
+{
+	size_t capacity = 16;
+	while (capacity < MaxNameCount * 2)
+	{
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+size_t SNamePool::GetRequiredMemorySize(size_t InArenaCapacity, size_t InMaxNameCount)
+{
+	// Every stack allocation is followed by its size. The arena is rounded up so the index that follows stays aligned.
+	const size_t allocOverhead = sizeof(size_t);
+
+	return ((InArenaCapacity + 7) & ~(size_t)7) + allocOverhead
+		+ sizeof(IndexSlot) * NamePoolIndexCapacity(InMaxNameCount) + allocOverhead
+		+ ((sizeof(SNameHandle) * InMaxNameCount + 7) & ~(size_t)7) + allocOverhead;
+}
+
+bool SNamePool::Initialize(MemoryAllocator& Allocator, size_t InArenaCapacity, size_t InMaxNameCount)
+{
+	if (InArenaCapacity > (size_t)UINT32_MAX)
+	{
+		// ASSERT Handles are 32 bit offsets into the arena.
+		return false;
+	}
+
+	*this = {};
+
+	ArenaCapacity = InArenaCapacity;
+	MaxNameCount = InMaxNameCount;
+	IndexCapacity = NamePoolIndexCapacity(InMaxNameCount);
+
+	Arena = (uint8_t*)Allocator.Allocate((ArenaCapacity + 7) & ~(size_t)7);
+	Index = (IndexSlot*)Allocator.Allocate(sizeof(IndexSlot) * IndexCapacity);
+	Unreferenced = (SNameHandle*)Allocator.Allocate((sizeof(SNameHandle) * MaxNameCount + 7) & ~(size_t)7);
+
+	if (Arena == nullptr || Index == nullptr || Unreferenced == nullptr)
+	{
+		return false;
+	}
+
+	memset(Index, 0, sizeof(IndexSlot) * IndexCapacity);
+
+	// Handles point past the reference count of their entry, so handle 0 never refers to a name and can mean "no name".
+	ArenaUsed = 0;
+	return true;
+}
+
+SNameHandle SNamePool::Find(std::string_view Name) const
+{
+	return Find(Name, HashNodeName(Name));
+}
+
+SNameHandle SNamePool::Find(std::string_view Name, uint64_t NameHash) const
+{
+	if (Name.empty() || Name.size() > SNODE_NAME_MAX_LENGTH)
+	{
+		return SNAME_INVALID_HANDLE;
+	}
+
+	const size_t mask = IndexCapacity - 1;
+	for (size_t slot = NameHash & mask; Index[slot].Handle != SNAME_INVALID_HANDLE; slot = (slot + 1) & mask)
+	{
+		const IndexSlot& entry = Index[slot];
+		if (entry.Hash == (uint32_t)NameHash && Get(entry.Handle) == Name)
+		{
+			return entry.Handle;
+		}
+	}
+
+	return SNAME_INVALID_HANDLE;
+}
+
+SNameHandle SNamePool::Intern(std::string_view Name)
+{
+	return Intern(Name, HashNodeName(Name));
+}
+
+SNameHandle SNamePool::Intern(std::string_view Name, uint64_t NameHash)
+{
+	if (Name.empty() || Name.size() > SNODE_NAME_MAX_LENGTH)
+	{
+		return SNAME_INVALID_HANDLE;
+	}
+
+	// Probe for the name, stopping at the first empty slot which is where it goes if it isn't there.
+	// Removals move entries back instead of leaving tombstones, so an empty slot always ends the search.
+	const size_t mask = IndexCapacity - 1;
+	size_t slot = NameHash & mask;
+	for (; Index[slot].Handle != SNAME_INVALID_HANDLE; slot = (slot + 1) & mask)
+	{
+		const IndexSlot& entry = Index[slot];
+		if (entry.Hash == (uint32_t)NameHash && Get(entry.Handle) == Name)
+		{
+			return entry.Handle;
+		}
+	}
+
+	if (!HasRoomFor(Name.size()))
+	{
+		// ASSERT Name pool is full.
+		InternFailureCount++;
+		return SNAME_INVALID_HANDLE;
+	}
+
+	// Reuse a free entry of the same size before growing into the arena.
+	const size_t entrySize = GetEntrySize(Name.size());
+	SNameHandle handle = FreeLists[entrySize / 4];
+	if (handle != SNAME_INVALID_HANDLE)
+	{
+		FreeLists[entrySize / 4] = GetRefCount(handle);
+		FreeByteCount -= entrySize;
+	}
+	else
+	{
+		handle = (SNameHandle)(ArenaUsed + sizeof(uint32_t));
+		ArenaUsed += entrySize;
+	}
+
+	Arena[handle] = (uint8_t)Name.size();
+	memcpy(Arena + handle + 1, Name.data(), Name.size());
+	Arena[handle + 1 + Name.size()] = '\0';
+
+	// Nothing references the name yet. It gets reclaimed if that's still the case at the next reclaim.
+	GetRefCount(handle) = SNAME_UNREFERENCED_LISTED;
+	Unreferenced[UnreferencedCount++] = handle;
+
+	Index[slot] = { handle, (uint32_t)NameHash };
+	NameCount++;
+	return handle;
+}
+
+void SNamePool::Release(SNameHandle Handle)
+{
+	// Listed names never drop to zero here, their count keeps the listed bit.
+	uint32_t& refCount = GetRefCount(Handle);
+	if (--refCount == 0)
+	{
+		refCount = SNAME_UNREFERENCED_LISTED;
+		Unreferenced[UnreferencedCount++] = Handle;
+	}
+}
+
+size_t SNamePool::ReclaimUnreferenced()
+{
+	size_t reclaimedCount = 0;
+	for (size_t unreferencedIndex = 0; unreferencedIndex < UnreferencedCount; unreferencedIndex++)
+	{
+		const SNameHandle handle = Unreferenced[unreferencedIndex];
+		uint32_t& refCount = GetRefCount(handle);
+		refCount &= ~SNAME_UNREFERENCED_LISTED;
+		if (refCount != 0)
+		{
+			// Referenced again since it was listed.
+			continue;
+		}
+
+		IndexRemove(handle);
+
+		const size_t entrySize = GetEntrySize(Arena[handle]);
+		refCount = FreeLists[entrySize / 4];
+		FreeLists[entrySize / 4] = handle;
+		FreeByteCount += entrySize;
+		NameCount--;
+		reclaimedCount++;
+	}
+
+	UnreferencedCount = 0;
+	return reclaimedCount;
+}
+
+void SNamePool::IndexRemove(SNameHandle Handle)
+{
+	const size_t mask = IndexCapacity - 1;
+	size_t hole = HashNodeName(Get(Handle)) & mask;
+	while (Index[hole].Handle != Handle)
+	{
+		hole = (hole + 1) & mask;
+	}
+
+	// Every entry after the hole in the same run moves into it, unless that would put it before its home slot.
+	for (size_t slot = (hole + 1) & mask; Index[slot].Handle != SNAME_INVALID_HANDLE; slot = (slot + 1) & mask)
+	{
+		const size_t homeSlot = Index[slot].Hash & mask;
+		if (((slot - homeSlot) & mask) >= ((slot - hole) & mask))
+		{
+			Index[hole] = Index[slot];
+			hole = slot;
+		}
+	}
+	Index[hole] = {};
+}
@@ -0,0 +1,552 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Synergy Protocol encoding.
+
+#include "SynergyCore.h"
+#include "Net/SynergyProtocol.h"
+
+#include <unordered_map>
+
+// Fixed size little endian integers, written byte by byte so the encoding doesn't depend on the host.
+template<typename IntType>
+static inline void ProtocolAppendInt(std::vector<uint8_t>& Buffer, IntType Value)
+{
+	for (size_t byteIndex = 0; byteIndex < sizeof(IntType); byteIndex++)
+	{
+		Buffer.push_back((uint8_t)((uint64_t)Value >> (8 * byteIndex)));
+	}
+}
+
+template<typename IntType>
+static inline IntType ProtocolLoadInt(const uint8_t* Data)
+{
+	uint64_t value = 0;
+	for (size_t byteIndex = 0; byteIndex < sizeof(IntType); byteIndex++)
+	{
+		value |= (uint64_t)Data[byteIndex] << (8 * byteIndex);
+	}
+	return (IntType)value;
+}
+
+// Bounds checked cursor over a payload. Once a read fails every following read fails too, so decoders only check at the end.
+struct ProtocolReader
+{
+	const uint8_t* Data;
+	size_t Size;
+	size_t Offset = 0;
+	bool bFailed = false;
+
+	template<typename IntType>
+	IntType Read()
+	{
+		if (bFailed || Size - Offset < sizeof(IntType))
+		{
+			bFailed = true;
+			return 0;
+		}
+		IntType value = ProtocolLoadInt<IntType>(Data + Offset);
+		Offset += sizeof(IntType);
+		return value;
+	}
+
+	const uint8_t* ReadBytes(size_t Count)
+	{
+		if (bFailed || Size - Offset < Count)
+		{
+			bFailed = true;
+			return nullptr;
+		}
+		const uint8_t* bytes = Data + Offset;
+		Offset += Count;
+		return bytes;
+	}
+
+	// LEB128 varint, refusing encodings longer than 64 bits allow.
+	uint64_t ReadVarint()
+	{
+		uint64_t value = 0;
+		for (uint32_t shift = 0; !bFailed && shift < 64; shift += 7)
+		{
+			if (Offset == Size)
+			{
+				break;
+			}
+			const uint8_t byte = Data[Offset++];
+			value |= (uint64_t)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return value;
+			}
+		}
+		bFailed = true;
+		return 0;
+	}
+
+	// Whether everything read fine and the whole payload was consumed.
+	bool Succeeded() const { return !bFailed && Offset == Size; }
+};
+
+static inline void ProtocolAppendVarint(std::vector<uint8_t>& Buffer, uint64_t Value)
+{
+	while (Value >= 0x80)
+	{
+		Buffer.push_back((uint8_t)(Value | 0x80));
+		Value >>= 7;
+	}
+	Buffer.push_back((uint8_t)Value);
+}
+
+// Maps signed values to unsigned ones so that small magnitudes stay small varints: 0, -1, 1, -2... become 0, 1, 2, 3...
+static inline uint64_t ProtocolZigZag(int64_t Value)
+{
+	return ((uint64_t)Value << 1) ^ (uint64_t)(Value >> 63);
+}
+
+static inline int64_t ProtocolUnZigZag(uint64_t Value)
+{
+	return (int64_t)(Value >> 1) ^ -(int64_t)(Value & 1);
+}
+
+// Node references, see the encoding notes in SynergyProtocol.h. IDs too large to be valid are sent as no node at all.
+static inline uint64_t ProtocolEncodeNodeRef(SNodeGUID NodeRef)
+{
+	if (IsCreatedNodeRef(NodeRef))
+	{
+		return ((NodeRef & ~SGRAPH_CREATED_NODE_REF) << 1) | 1;
+	}
+	return NodeRef < SGRAPH_CREATED_NODE_REF ? (NodeRef + 1) << 1 : 0;
+}
+
+static inline SNodeGUID ProtocolDecodeNodeRef(uint64_t Value)
+{
+	if (Value == 0 || (Value >> 1) >= SGRAPH_CREATED_NODE_REF)
+	{
+		return SNODE_INVALID_ID;
+	}
+	return (Value & 1) != 0 ? MakeCreatedNodeRef((size_t)(Value >> 1)) : (Value >> 1) - 1;
+}
+
+static inline uint8_t ProtocolEncodeAccessLevels(SNodeConnectionAccessLevel AccessLevel, SNodeConnectionAccessLevel AccessLevelFromParent)
+{
+	return (uint8_t)(((uint8_t)AccessLevel & 0x0F) | ((uint8_t)AccessLevelFromParent << 4));
+}
+
+// Which fields follow the type byte of an op.
+static inline bool ProtocolOpHasOther(SGraphOpType Type)
+{
+	return Type == SGraphOpType::CREATE_NODE || Type == SGraphOpType::SET_PARENT || Type == SGraphOpType::SET_CONNECTION;
+}
+
+static inline bool ProtocolOpHasAccessLevels(SGraphOpType Type)
+{
+	return ProtocolOpHasOther(Type);
+}
+
+static inline bool ProtocolOpHasName(SGraphOpType Type)
+{
+	return Type == SGraphOpType::CREATE_NODE || Type == SGraphOpType::RENAME_NODE;
+}
+
+// Starts a frame whose payload size is only known once it is written. ProtocolEndFrame fills it in.
+static inline size_t ProtocolBeginFrame(std::vector<uint8_t>& Buffer, SProtocolMessageType Type)
+{
+	const size_t frameStart = Buffer.size();
+	SProtocolAppendFrameHeader(Buffer, Type, 0);
+	return frameStart;
+}
+
+static inline void ProtocolEndFrame(std::vector<uint8_t>& Buffer, size_t FrameStart)
+{
+	const size_t payloadSize = Buffer.size() - FrameStart - SPROTOCOL_FRAME_HEADER_SIZE;
+	for (size_t byteIndex = 0; byteIndex < sizeof(uint32_t); byteIndex++)
+	{
+		Buffer[FrameStart + byteIndex] = (uint8_t)(payloadSize >> (8 * byteIndex));
+	}
+}
+
+void SProtocolAppendFrameHeader(std::vector<uint8_t>& Buffer, SProtocolMessageType Type, uint32_t PayloadSize)
+{
+	ProtocolAppendInt<uint32_t>(Buffer, PayloadSize);
+	ProtocolAppendInt<uint8_t>(Buffer, (uint8_t)Type);
+}
+
+bool SProtocolReadFrameHeader(const uint8_t* Data, size_t Size, SProtocolMessageType& OutType, uint32_t& OutPayloadSize)
+{
+	if (Size < SPROTOCOL_FRAME_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	OutPayloadSize = ProtocolLoadInt<uint32_t>(Data);
+	OutType = (SProtocolMessageType)Data[4];
+	return true;
+}
+
+// SUBMIT_TRANSACTION
+
+void SProtocolAppendSubmitTransaction(std::vector<uint8_t>& Buffer, uint32_t RequestID, const SGraphOp* Ops, size_t OpCount)
+{
+	// Name table, in order of first use.
+	std::unordered_map<std::string_view, uint32_t> nameIndices;
+	std::vector<std::string_view> names;
+	for (size_t opIndex = 0; opIndex < OpCount; opIndex++)
+	{
+		if (ProtocolOpHasName(Ops[opIndex].Type) && nameIndices.emplace(Ops[opIndex].Name, (uint32_t)names.size()).second)
+		{
+			names.push_back(Ops[opIndex].Name);
+		}
+	}
+
+	const size_t frameStart = ProtocolBeginFrame(Buffer, SProtocolMessageType::SUBMIT_TRANSACTION);
+
+	ProtocolAppendVarint(Buffer, RequestID);
+	ProtocolAppendVarint(Buffer, names.size());
+	for (std::string_view name : names)
+	{
+		ProtocolAppendVarint(Buffer, name.size());
+		Buffer.insert(Buffer.end(), name.begin(), name.end());
+	}
+
+	ProtocolAppendVarint(Buffer, OpCount);
+	for (size_t opIndex = 0; opIndex < OpCount; opIndex++)
+	{
+		const SGraphOp& op = Ops[opIndex];
+		ProtocolAppendInt<uint8_t>(Buffer, (uint8_t)op.Type);
+
+		// CREATE_NODE is the only op whose node goes in OtherID, as the parent.
+		ProtocolAppendVarint(Buffer, ProtocolEncodeNodeRef(op.Type == SGraphOpType::CREATE_NODE ? op.OtherID : op.NodeID));
+		if (ProtocolOpHasOther(op.Type) && op.Type != SGraphOpType::CREATE_NODE)
+		{
+			ProtocolAppendVarint(Buffer, ProtocolEncodeNodeRef(op.OtherID));
+		}
+		if (ProtocolOpHasAccessLevels(op.Type))
+		{
+			ProtocolAppendInt<uint8_t>(Buffer, ProtocolEncodeAccessLevels(op.AccessLevel, op.AccessLevelFromParent));
+		}
+		if (ProtocolOpHasName(op.Type))
+		{
+			ProtocolAppendVarint(Buffer, nameIndices[op.Name]);
+		}
+		if (op.Type == SGraphOpType::FETCH_NODE)
+		{
+			ProtocolAppendVarint(Buffer, op.Version);
+		}
+	}
+
+	ProtocolEndFrame(Buffer, frameStart);
+}
+
+bool SProtocolTransactionReader::Begin(const uint8_t* Payload, size_t PayloadSize)
+{
+	Names.clear();
+	OpCount = 0;
+	ReadOpCount = 0;
+
+	ProtocolReader reader = { Payload, PayloadSize };
+	const uint64_t requestID = reader.ReadVarint();
+	const uint64_t nameCount = reader.ReadVarint();
+	// Every name takes at least a byte, which bounds the table before trusting the count.
+	bool bValid = !reader.bFailed && requestID <= UINT32_MAX && nameCount <= PayloadSize - reader.Offset;
+	for (uint64_t nameIndex = 0; bValid && nameIndex < nameCount; nameIndex++)
+	{
+		const uint64_t nameLength = reader.ReadVarint();
+		const uint8_t* name = reader.ReadBytes(nameLength <= PayloadSize ? (size_t)nameLength : PayloadSize + 1);
+		bValid = name != nullptr;
+		if (bValid)
+		{
+			Names.push_back(std::string_view((const char*)name, (size_t)nameLength));
+		}
+	}
+	const uint64_t opCount = reader.ReadVarint();
+
+	Data = Payload;
+	Size = PayloadSize;
+	Offset = reader.Offset;
+	FirstOpOffset = reader.Offset;
+	RequestID = (uint32_t)requestID;
+	OpCount = (size_t)opCount;
+	// Every op takes at least two bytes.
+	bFailed = !bValid || reader.bFailed || opCount > (PayloadSize - reader.Offset) / 2;
+	return !bFailed;
+}
+
+bool SProtocolTransactionReader::Next(SGraphOp& OutOp)
+{
+	if (bFailed || ReadOpCount == OpCount)
+	{
+		return false;
+	}
+
+	ProtocolReader reader = { Data, Size, Offset };
+
+	OutOp = SGraphOp();
+	OutOp.Type = (SGraphOpType)reader.Read<uint8_t>();
+	if (OutOp.Type >= SGraphOpType::COUNT)
+	{
+		// The layout of unknown ops is unknown too, nothing after them can be read.
+		bFailed = true;
+		return false;
+	}
+
+	const SNodeGUID nodeRef = ProtocolDecodeNodeRef(reader.ReadVarint());
+	if (OutOp.Type == SGraphOpType::CREATE_NODE)
+	{
+		OutOp.OtherID = nodeRef;
+	}
+	else
+	{
+		OutOp.NodeID = nodeRef;
+		if (ProtocolOpHasOther(OutOp.Type))
+		{
+			OutOp.OtherID = ProtocolDecodeNodeRef(reader.ReadVarint());
+		}
+	}
+
+	if (ProtocolOpHasAccessLevels(OutOp.Type))
+	{
+		const uint8_t accessLevels = reader.Read<uint8_t>();
+		OutOp.AccessLevel = (SNodeConnectionAccessLevel)(accessLevels & 0x0F);
+		OutOp.AccessLevelFromParent = (SNodeConnectionAccessLevel)(accessLevels >> 4);
+	}
+
+	if (ProtocolOpHasName(OutOp.Type))
+	{
+		const uint64_t nameIndex = reader.ReadVarint();
+		if (nameIndex >= Names.size())
+		{
+			reader.bFailed = true;
+		}
+		else
+		{
+			OutOp.Name = Names[(size_t)nameIndex];
+		}
+	}
+
+	if (OutOp.Type == SGraphOpType::FETCH_NODE)
+	{
+		OutOp.Version = reader.ReadVarint();
+	}
+
+	Offset = reader.Offset;
+	bFailed = reader.bFailed;
+	ReadOpCount += !bFailed;
+	return !bFailed;
+}
+
+// TRANSACTION_RESULT
+
+void SProtocolAppendTransactionResult(std::vector<uint8_t>& Buffer, uint32_t RequestID, const SGraphTransactionResult& Result,
+	const SNodeGUID* CreatedIDs, size_t CreatedCount)
+{
+	const size_t frameStart = ProtocolBeginFrame(Buffer, SProtocolMessageType::TRANSACTION_RESULT);
+
+	ProtocolAppendVarint(Buffer, RequestID);
+	ProtocolAppendInt<uint8_t>(Buffer, (uint8_t)Result.Status);
+	ProtocolAppendVarint(Buffer, Result.FailedOpIndex);
+	ProtocolAppendVarint(Buffer, Result.Sequence);
+	ProtocolAppendVarint(Buffer, CreatedCount);
+
+	SNodeGUID previousID = 0;
+	for (size_t createdIndex = 0; createdIndex < CreatedCount; createdIndex++)
+	{
+		ProtocolAppendVarint(Buffer, ProtocolZigZag((int64_t)(CreatedIDs[createdIndex] - previousID)));
+		previousID = CreatedIDs[createdIndex];
+	}
+
+	ProtocolEndFrame(Buffer, frameStart);
+}
+
+bool SProtocolDecodeTransactionResult(const uint8_t* Payload, size_t Size, SProtocolTransactionResult& OutResult,
+	SNodeGUID* OutCreatedIDs, size_t CreatedIDCapacity)
+{
+	OutResult = {};
+
+	ProtocolReader reader = { Payload, Size };
+	const uint64_t requestID = reader.ReadVarint();
+	OutResult.Result.Status = (SGraphTransactionStatus)reader.Read<uint8_t>();
+	const uint64_t failedOpIndex = reader.ReadVarint();
+	OutResult.Result.Sequence = reader.ReadVarint();
+	const uint64_t createdCount = reader.ReadVarint();
+	if (reader.bFailed || requestID > UINT32_MAX || failedOpIndex > UINT32_MAX || createdCount > Size - reader.Offset)
+	{
+		return false;
+	}
+
+	OutResult.RequestID = (uint32_t)requestID;
+	OutResult.Result.FailedOpIndex = (uint32_t)failedOpIndex;
+	OutResult.CreatedCount = (size_t)createdCount;
+
+	SNodeGUID createdID = 0;
+	for (size_t createdIndex = 0; createdIndex < OutResult.CreatedCount; createdIndex++)
+	{
+		createdID += (SNodeGUID)ProtocolUnZigZag(reader.ReadVarint());
+		if (createdIndex < CreatedIDCapacity)
+		{
+			OutCreatedIDs[createdIndex] = createdID;
+		}
+	}
+
+	return reader.Succeeded() && OutResult.Result.Status < SGraphTransactionStatus::COUNT;
+}
+
+// SUBSCRIBE
+
+void SProtocolAppendSubscribe(std::vector<uint8_t>& Buffer, const SProtocolSubscribeRequest& Request)
+{
+	const size_t frameStart = ProtocolBeginFrame(Buffer, SProtocolMessageType::SUBSCRIBE);
+
+	ProtocolAppendVarint(Buffer, Request.RequestID);
+	ProtocolAppendVarint(Buffer, ProtocolEncodeNodeRef(Request.ViewerID));
+	ProtocolAppendVarint(Buffer, ProtocolEncodeNodeRef(Request.RootID));
+	ProtocolAppendInt<uint8_t>(Buffer, (uint8_t)Request.Scope);
+	ProtocolAppendVarint(Buffer, Request.Depth);
+	ProtocolAppendVarint(Buffer, Request.BandwidthBudget);
+
+	ProtocolEndFrame(Buffer, frameStart);
+}
+
+bool SProtocolDecodeSubscribe(const uint8_t* Payload, size_t Size, SProtocolSubscribeRequest& OutRequest)
+{
+	OutRequest = {};
+
+	ProtocolReader reader = { Payload, Size };
+	const uint64_t requestID = reader.ReadVarint();
+	OutRequest.ViewerID = ProtocolDecodeNodeRef(reader.ReadVarint());
+	OutRequest.RootID = ProtocolDecodeNodeRef(reader.ReadVarint());
+	OutRequest.Scope = (SProtocolSubscriptionScope)reader.Read<uint8_t>();
+	const uint64_t depth = reader.ReadVarint();
+	const uint64_t bandwidthBudget = reader.ReadVarint();
+
+	OutRequest.RequestID = (uint32_t)requestID;
+	OutRequest.Depth = (uint32_t)depth;
+	OutRequest.BandwidthBudget = (uint32_t)bandwidthBudget;
+
+	// Created node references only make sense within a transaction.
+	return reader.Succeeded() && requestID <= UINT32_MAX && depth <= UINT32_MAX && bandwidthBudget <= UINT32_MAX
+		&& OutRequest.Scope < SProtocolSubscriptionScope::COUNT && !IsCreatedNodeRef(OutRequest.ViewerID) && !IsCreatedNodeRef(OutRequest.RootID);
+}
+
+// SUBSCRIPTION_UPDATE
+
+size_t SProtocolBeginSubscriptionUpdate(std::vector<uint8_t>& Buffer, uint32_t RequestID, uint64_t Sequence)
+{
+	const size_t frameStart = ProtocolBeginFrame(Buffer, SProtocolMessageType::SUBSCRIPTION_UPDATE);
+
+	ProtocolAppendVarint(Buffer, RequestID);
+	ProtocolAppendVarint(Buffer, Sequence);
+	// Flags, filled in once the update is complete.
+	ProtocolAppendInt<uint8_t>(Buffer, 0);
+
+	return frameStart;
+}
+
+void SProtocolAppendSubscriptionRecord(std::vector<uint8_t>& Buffer, const SProtocolSubscriptionRecord& Record)
+{
+	ProtocolAppendInt<uint8_t>(Buffer, (uint8_t)Record.Kind);
+	ProtocolAppendVarint(Buffer, ProtocolEncodeNodeRef(Record.NodeID));
+
+	switch (Record.Kind)
+	{
+	case SProtocolSubscriptionRecordKind::NODE:
+		ProtocolAppendVarint(Buffer, ProtocolEncodeNodeRef(Record.OtherID));
+		ProtocolAppendVarint(Buffer, Record.Version);
+		ProtocolAppendVarint(Buffer, Record.Name.size());
+		Buffer.insert(Buffer.end(), Record.Name.begin(), Record.Name.end());
+		break;
+	case SProtocolSubscriptionRecordKind::CONNECTION:
+		ProtocolAppendVarint(Buffer, ProtocolEncodeNodeRef(Record.OtherID));
+		ProtocolAppendInt<uint8_t>(Buffer, (uint8_t)Record.AccessLevel);
+		break;
+	default:
+		break;
+	}
+}
+
+void SProtocolEndSubscriptionUpdate(std::vector<uint8_t>& Buffer, size_t FrameStart, SProtocolSubscriptionUpdateFlags Flags)
+{
+	// The flags byte is the last of the header, which is only made of varints before it.
+	ProtocolReader reader = { Buffer.data() + FrameStart + SPROTOCOL_FRAME_HEADER_SIZE, Buffer.size() - FrameStart - SPROTOCOL_FRAME_HEADER_SIZE };
+	reader.ReadVarint();
+	reader.ReadVarint();
+	Buffer[FrameStart + SPROTOCOL_FRAME_HEADER_SIZE + reader.Offset] = Flags;
+
+	ProtocolEndFrame(Buffer, FrameStart);
+}
+
+bool SProtocolSubscriptionUpdateReader::Begin(const uint8_t* Payload, size_t PayloadSize)
+{
+	ProtocolReader reader = { Payload, PayloadSize };
+	const uint64_t requestID = reader.ReadVarint();
+	Sequence = reader.ReadVarint();
+	Flags = reader.Read<uint8_t>();
+
+	Data = Payload;
+	Size = PayloadSize;
+	Offset = reader.Offset;
+	RequestID = (uint32_t)requestID;
+	bFailed = reader.bFailed || requestID > UINT32_MAX;
+	return !bFailed;
+}
+
+bool SProtocolSubscriptionUpdateReader::Next(SProtocolSubscriptionRecord& OutRecord)
+{
+	if (bFailed || Offset == Size)
+	{
+		return false;
+	}
+
+	ProtocolReader reader = { Data, Size, Offset };
+
+	OutRecord = SProtocolSubscriptionRecord();
+	OutRecord.Kind = (SProtocolSubscriptionRecordKind)reader.Read<uint8_t>();
+	OutRecord.NodeID = ProtocolDecodeNodeRef(reader.ReadVarint());
+
+	switch (OutRecord.Kind)
+	{
+	case SProtocolSubscriptionRecordKind::NODE:
+	{
+		OutRecord.OtherID = ProtocolDecodeNodeRef(reader.ReadVarint());
+		OutRecord.Version = reader.ReadVarint();
+		const uint64_t nameLength = reader.ReadVarint();
+		const uint8_t* name = reader.ReadBytes(nameLength <= Size ? (size_t)nameLength : Size + 1);
+		if (name != nullptr)
+		{
+			OutRecord.Name = std::string_view((const char*)name, (size_t)nameLength);
+		}
+		break;
+	}
+	case SProtocolSubscriptionRecordKind::NODE_REMOVED:
+		break;
+	case SProtocolSubscriptionRecordKind::CONNECTION:
+		OutRecord.OtherID = ProtocolDecodeNodeRef(reader.ReadVarint());
+		OutRecord.AccessLevel = (SNodeConnectionAccessLevel)reader.Read<uint8_t>();
+		reader.bFailed |= OutRecord.AccessLevel > SNodeConnectionAccessLevel::OPEN;
+		break;
+	default:
+		// Unknown records can't be skipped, their layout is unknown.
+		reader.bFailed = true;
+		break;
+	}
+
+	// Node IDs are never created references here.
+	reader.bFailed |= OutRecord.NodeID == SNODE_INVALID_ID || IsCreatedNodeRef(OutRecord.NodeID) || IsCreatedNodeRef(OutRecord.OtherID);
+
+	Offset = reader.Offset;
+	bFailed = reader.bFailed;
+	return !bFailed;
+}
+
+// PING
+
+void SProtocolAppendPing(std::vector<uint8_t>& Buffer, SProtocolMessageType Type, uint64_t Value)
+{
+	SProtocolAppendFrameHeader(Buffer, Type, 8);
+	ProtocolAppendInt<uint64_t>(Buffer, Value);
+}
+
+bool SProtocolDecodePing(const uint8_t* Payload, size_t Size, uint64_t& OutValue)
+{
+	ProtocolReader reader = { Payload, Size };
+	OutValue = reader.Read<uint64_t>();
+	return reader.Succeeded();
+}
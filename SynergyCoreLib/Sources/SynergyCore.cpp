@@ -2,4 +2,12 @@
 
 #include "SynergyCore.h"
 
-#include "Memory_INC.cpp"
\ No newline at end of file
+#include "Memory_INC.cpp"
+#include "NamePool_INC.cpp"
+#include "GraphStore_INC.cpp"
+#include "GraphBulkLoad_INC.cpp"
+#include "GraphSearch_INC.cpp"
+#include "GraphChangeStream_INC.cpp"
+#include "GraphTransaction_INC.cpp"
+#include "Protocol_INC.cpp"
+#include "JobSystem_INC.cpp"
\ No newline at end of file
@@ -0,0 +1,82 @@
+// Contains symbols for deterministically generating large synthetic graphs to exercise the Client Graph with.
+
+#ifndef GRAPH_GENERATOR_INCLUDED
+#define GRAPH_GENERATOR_INCLUDED
+
+#include "SynergyCore.h"
+#include "ClientGraph.h"
+
+/*
+	Small deterministic pseudo random generator (SplitMix64). The same seed always yields the same sequence on every platform,
+	which is what makes generated graphs reproducible between runs and machines.
+*/
+struct GraphGeneratorRandom
+{
+	uint64_t State = 0;
+
+	uint64_t Next()
+	{
+		uint64_t z = (State += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	// Returns a value in [0, Bound[. Bound must be greater than 0.
+	uint64_t NextBelow(uint64_t Bound) { return Next() % Bound; }
+
+	// Returns a value in [0, 1[.
+	float NextFloat() { return (float)(Next() >> 40) / (float)(1ull << 24); }
+};
+
+// Parameters driving the shape of a generated graph.
+struct GraphGeneratorConfig
+{
+	uint64_t Seed = 0x5EED;
+
+	// Number of children created under every non-leaf node of the hierarchy.
+	uint32_t FanOut = 4;
+
+	// Number of hierarchy levels below the root node.
+	uint32_t Depth = 5;
+
+	// Average number of arbitrary (non parent - child) connections per node.
+	float EdgeDensity = 1.f;
+
+	// Relative weights of PRIVATE, INTERNAL, PUBLIC and OPEN access levels among generated connections.
+	// Parent - child connections are raised to their respective minimum access level.
+	uint32_t AccessLevelMix[4] = { 1, 1, 1, 1 };
+
+	// Hard limit on the number of generated nodes. Generation stops early once it is reached.
+	size_t MaxNodeCount = 0;
+};
+
+// Summary of what actually got generated.
+struct GeneratedGraphInfo
+{
+	size_t NodeCount = 0;
+	size_t HierarchyDepth = 0;
+	size_t CrossConnectionCount = 0;
+	size_t TransactionCount = 0;
+};
+
+/*
+	Picks an access level following the configured mix. Never returns NONE.
+*/
+SNodeConnectionAccessLevel PickAccessLevel(const GraphGeneratorConfig& Config, GraphGeneratorRandom& Random);
+
+/*
+	Fills the passed (empty) graph with a hierarchy and cross connections following the passed config, using regular edit transactions.
+	IDs of generated nodes are written to OutNodeIDs, which must be able to hold Config.MaxNodeCount elements.
+	Returns whether generation succeeded.
+*/
+bool GenerateGraph(ClientGraph& Graph, const GraphGeneratorConfig& Config, SNodeGUID* OutNodeIDs, GeneratedGraphInfo& OutInfo);
+
+/*
+	Writes a graph of exactly Config.MaxNodeCount nodes to a bulk file (see SynergyGraphBulkLoad.h), without going through a graph.
+	The hierarchy is a complete tree of the configured fan-out, Depth is ignored. Cross connections follow the configured density and mix.
+	Returns whether the file could be written.
+*/
+bool WriteGraphBulkFile(const GraphGeneratorConfig& Config, const char* FilePath, GeneratedGraphInfo& OutInfo);
+
+#endif // GRAPH_GENERATOR_INCLUDED
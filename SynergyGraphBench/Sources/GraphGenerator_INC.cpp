@@ -0,0 +1,262 @@
+SOURCE_INC_FILE()
+
+// Implementation of the synthetic graph generator. Graphs are built exclusively through edit transactions so that generating them
+// exercises the same code paths the Client does.
+
+#include "GraphGenerator.h"
+
+#include <stdio.h>
+#include <new>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+SNodeConnectionAccessLevel PickAccessLevel(const GraphGeneratorConfig& Config, GraphGeneratorRandom& Random)
+{
+	uint64_t totalWeight = 0;
+	for (uint32_t weight : Config.AccessLevelMix)
+	{
+		totalWeight += weight;
+	}
+
+	if (totalWeight == 0)
+	{
+		return SNodeConnectionAccessLevel::PUBLIC;
+	}
+
+	uint64_t pick = Random.NextBelow(totalWeight);
+	for (uint8_t levelIndex = 0; levelIndex < 4; levelIndex++)
+	{
+		if (pick < Config.AccessLevelMix[levelIndex])
+		{
+			return (SNodeConnectionAccessLevel)((uint8_t)SNodeConnectionAccessLevel::PRIVATE + levelIndex);
+		}
+		pick -= Config.AccessLevelMix[levelIndex];
+	}
+
+	return SNodeConnectionAccessLevel::OPEN;
+}
+
+// Returns the max of both access levels, used to respect parent - child minimums.
+static SNodeConnectionAccessLevel RaiseAccessLevel(SNodeConnectionAccessLevel Level, SNodeConnectionAccessLevel Minimum)
+{
+	return Level < Minimum ? Minimum : Level;
+}
+
+bool GenerateGraph(ClientGraph& Graph, const GraphGeneratorConfig& Config, SNodeGUID* OutNodeIDs, GeneratedGraphInfo& OutInfo)
+{
+	OutInfo = {};
+
+	if (Config.MaxNodeCount == 0 || OutNodeIDs == nullptr)
+	{
+		return false;
+	}
+
+	GraphGeneratorRandom random = { Config.Seed };
+
+	// Transactions are large, keep a single one around and reset it between uses.
+	ClientGraphEditTransaction* transaction = new ClientGraphEditTransaction();
+	constexpr size_t maxCreatedNodesPerTransaction = sizeof(transaction->CreatedNodes) / sizeof(GraphEditNode) - 1;
+
+	// Names of the previous transaction are released first, unless it was applied already.
+	auto ResetTransaction = [&]()
+	{
+		transaction->ReleaseNames();
+		transaction->~ClientGraphEditTransaction();
+		new (transaction) ClientGraphEditTransaction();
+		transaction->TargetGraph = &Graph;
+	};
+
+	// Names only need to outlive the CreateNode call they are passed to, which interns them.
+	char nameBuffer[SNODE_NAME_MAX_LENGTH + 1];
+	auto MakeNodeDef = [&](size_t NodeIndex)
+	{
+		SNodeDef def = {};
+		def.name = std::string_view(nameBuffer, snprintf(nameBuffer, sizeof(nameBuffer), "Node %zu", NodeIndex));
+		return def;
+	};
+
+	bool bSuccess = true;
+
+	// ROOT
+	{
+		ResetTransaction();
+		GraphEditNode* root = transaction->CreateNode(MakeNodeDef(0), nullptr);
+		if (root == nullptr || !Graph.ApplyEditTransaction(*transaction))
+		{
+			transaction->ReleaseNames();
+			delete transaction;
+			return false;
+		}
+
+		OutNodeIDs[0] = root->ID;
+		OutInfo.NodeCount = 1;
+		OutInfo.TransactionCount++;
+	}
+
+	// HIERARCHY
+	// Built level by level. Every node of the previous level gets fetched once per batch of children created under it.
+	size_t levelStart = 0;
+	size_t levelEnd = 1;
+	for (uint32_t level = 0; level < Config.Depth && bSuccess && OutInfo.NodeCount < Config.MaxNodeCount; level++)
+	{
+		for (size_t parentIndex = levelStart; parentIndex < levelEnd && OutInfo.NodeCount < Config.MaxNodeCount; parentIndex++)
+		{
+			size_t childrenLeft = Config.FanOut;
+			while (childrenLeft > 0 && OutInfo.NodeCount < Config.MaxNodeCount)
+			{
+				ResetTransaction();
+				GraphEditNode* parent = transaction->FetchGraphNode(OutNodeIDs[parentIndex]);
+				if (parent == nullptr)
+				{
+					bSuccess = false;
+					break;
+				}
+
+				size_t batchSize = childrenLeft < maxCreatedNodesPerTransaction ? childrenLeft : maxCreatedNodesPerTransaction;
+				if (batchSize > Config.MaxNodeCount - OutInfo.NodeCount)
+				{
+					batchSize = Config.MaxNodeCount - OutInfo.NodeCount;
+				}
+
+				GraphEditNode* createdNodes[sizeof(transaction->CreatedNodes) / sizeof(GraphEditNode)];
+				for (size_t batchIndex = 0; batchIndex < batchSize; batchIndex++)
+				{
+					GraphEditNode* child = transaction->CreateNode(MakeNodeDef(OutInfo.NodeCount + batchIndex), parent);
+					child->AccessLevelFromParent = RaiseAccessLevel(PickAccessLevel(Config, random), SNodeConnectionAccessLevel::TO_CHILD_MINIMUM);
+					child->AccessLevelToParent = RaiseAccessLevel(PickAccessLevel(Config, random), SNodeConnectionAccessLevel::TO_PARENT_MINIMUM);
+					createdNodes[batchIndex] = child;
+				}
+
+				if (!Graph.ApplyEditTransaction(*transaction))
+				{
+					bSuccess = false;
+					break;
+				}
+				OutInfo.TransactionCount++;
+
+				for (size_t batchIndex = 0; batchIndex < batchSize; batchIndex++)
+				{
+					OutNodeIDs[OutInfo.NodeCount++] = createdNodes[batchIndex]->ID;
+				}
+				childrenLeft -= batchSize;
+			}
+		}
+
+		levelStart = levelEnd;
+		levelEnd = OutInfo.NodeCount;
+		if (levelEnd > levelStart)
+		{
+			OutInfo.HierarchyDepth = level + 1;
+		}
+	}
+
+	// CROSS CONNECTIONS
+	// One connection per transaction between two random nodes that aren't already parent and child.
+	const size_t crossConnectionTarget = (size_t)(OutInfo.NodeCount * Config.EdgeDensity);
+	for (size_t attempt = 0; bSuccess && OutInfo.NodeCount > 1 && attempt < crossConnectionTarget; attempt++)
+	{
+		SNodeGUID srcID = OutNodeIDs[random.NextBelow(OutInfo.NodeCount)];
+		SNodeGUID destID = OutNodeIDs[random.NextBelow(OutInfo.NodeCount)];
+		SNodeConnectionAccessLevel accessLevel = PickAccessLevel(Config, random);
+
+		if (srcID == destID)
+		{
+			continue;
+		}
+
+		SNodeDef srcDef = Graph.GetNodeDef(srcID);
+		SNodeDef destDef = Graph.GetNodeDef(destID);
+		if (srcDef.parentID == destID || destDef.parentID == srcID)
+		{
+			continue;
+		}
+
+		ResetTransaction();
+		GraphEditNode* src = transaction->FetchGraphNode(srcID);
+		GraphEditNode* dest = transaction->FetchGraphNode(destID);
+		if (src == nullptr || dest == nullptr)
+		{
+			bSuccess = false;
+			break;
+		}
+
+		transaction->AddOrEditConnection(*src, *dest, { srcID, destID, accessLevel });
+		if (!Graph.ApplyEditTransaction(*transaction))
+		{
+			bSuccess = false;
+			break;
+		}
+
+		OutInfo.TransactionCount++;
+		OutInfo.CrossConnectionCount++;
+	}
+
+	transaction->ReleaseNames();
+	delete transaction;
+	return bSuccess;
+}
+
+bool WriteGraphBulkFile(const GraphGeneratorConfig& Config, const char* FilePath, GeneratedGraphInfo& OutInfo)
+{
+	OutInfo = {};
+
+	if (Config.MaxNodeCount == 0 || Config.FanOut == 0)
+	{
+		return false;
+	}
+
+	FILE* file = fopen(FilePath, "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	GraphGeneratorRandom random = { Config.Seed };
+
+	// Node with key K has parent (K - 1) / FanOut, which lays the hierarchy out level by level.
+	fprintf(file, "# Synthetic graph. Seed %llu, fan-out %u, %zu nodes.\n", (unsigned long long)Config.Seed, Config.FanOut, Config.MaxNodeCount);
+	fprintf(file, "N 0 - %u %u Node 0\n", (unsigned)SNodeConnectionAccessLevel::TO_PARENT_MINIMUM, (unsigned)SNodeConnectionAccessLevel::TO_CHILD_MINIMUM);
+	size_t levelEnd = 1;
+	for (size_t key = 1; key < Config.MaxNodeCount; key++)
+	{
+		if (key == levelEnd)
+		{
+			OutInfo.HierarchyDepth++;
+			levelEnd = levelEnd * Config.FanOut + 1;
+		}
+
+		SNodeConnectionAccessLevel toParent = RaiseAccessLevel(PickAccessLevel(Config, random), SNodeConnectionAccessLevel::TO_PARENT_MINIMUM);
+		SNodeConnectionAccessLevel fromParent = RaiseAccessLevel(PickAccessLevel(Config, random), SNodeConnectionAccessLevel::TO_CHILD_MINIMUM);
+		fprintf(file, "N %zu %zu %u %u Node %zu\n", key, (key - 1) / Config.FanOut, (unsigned)toParent, (unsigned)fromParent, key);
+	}
+	OutInfo.NodeCount = Config.MaxNodeCount;
+
+	// Cross connections. Pairs are drawn first, then sorted so duplicates can be dropped.
+	const size_t crossConnectionTarget = (size_t)(Config.MaxNodeCount * Config.EdgeDensity);
+	std::vector<std::pair<uint64_t, uint64_t>> pairs;
+	pairs.reserve(crossConnectionTarget);
+	for (size_t attempt = 0; Config.MaxNodeCount > 1 && attempt < crossConnectionTarget; attempt++)
+	{
+		uint64_t src = random.NextBelow(Config.MaxNodeCount);
+		uint64_t dest = random.NextBelow(Config.MaxNodeCount);
+		bool bParentChild = (src > 0 && (src - 1) / Config.FanOut == dest) || (dest > 0 && (dest - 1) / Config.FanOut == src);
+		if (src != dest && !bParentChild)
+		{
+			pairs.push_back({ src, dest });
+		}
+	}
+	std::sort(pairs.begin(), pairs.end());
+	pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+	for (const std::pair<uint64_t, uint64_t>& pair : pairs)
+	{
+		fprintf(file, "E %llu %llu %u\n", (unsigned long long)pair.first, (unsigned long long)pair.second, (unsigned)PickAccessLevel(Config, random));
+	}
+	OutInfo.CrossConnectionCount = pairs.size();
+
+	bool bSuccess = ferror(file) == 0;
+	fclose(file);
+	return bSuccess;
+}
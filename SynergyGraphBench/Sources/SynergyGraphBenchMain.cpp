@@ -0,0 +1,580 @@
+#define TRANSLATION_UNIT SYNERGY_GRAPH_BENCH
+
+// Benchmark suite for the Client Graph. Generates a deterministic synthetic graph and measures the latency of its main operations,
+// reporting results as JSON on standard output.
+//
+// Usage: SynergyGraphBench [--seed N] [--fanout N] [--depth N] [--edge-density F] [--access-mix PRIVATE,INTERNAL,PUBLIC,OPEN]
+//                          [--samples N] [--max-nodes N] [--bulk-nodes N]
+//
+// --bulk-nodes additionally writes a generated graph of N nodes to a temporary bulk file and measures loading it into an empty graph.
+
+#include "SynergyCore.h"
+#include "ClientGraph.h"
+#include "GraphGenerator.h"
+#include "Net/SynergyProtocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// Source includes
+#include "Graph_INC.cpp"
+#include "GraphGenerator_INC.cpp"
+
+// Number of nodes kept free in the graph's store so transactions created during the benchmark always fit.
+constexpr size_t BENCH_RESERVED_NODE_COUNT = 32;
+
+// Transaction sizes the Apply benchmark iterates over.
+constexpr size_t BENCH_TRANSACTION_SIZES[] = { 1, 4, 16, 31 };
+
+struct BenchConfig
+{
+	GraphGeneratorConfig Generator;
+	size_t SampleCount = 256;
+
+	// Limit on the number of nodes generated through transactions.
+	size_t MaxNodeCount = 1 << 16;
+
+	// Size of the bulk loaded graph. 0 skips the bulk load benchmark.
+	size_t BulkNodeCount = 0;
+};
+
+// Outcome of the bulk load benchmark.
+struct BulkBenchResult
+{
+	SGraphBulkLoadResult Load;
+	size_t FileSize = 0;
+	uint64_t ElapsedNs = 0;
+};
+
+// Latency samples of a single benchmarked operation, in nanoseconds.
+struct BenchResult
+{
+	const char* Name = nullptr;
+	size_t TransactionSize = 0;
+	std::vector<uint64_t> Samples;
+};
+
+// Monotonic timestamp in nanoseconds.
+static inline uint64_t BenchNow()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool ParseArguments(int argc, char** argv, BenchConfig& Config)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const char* arg = argv[argIndex];
+		const char* value = argIndex + 1 < argc ? argv[argIndex + 1] : nullptr;
+
+		if (value == nullptr)
+		{
+			fprintf(stderr, "Missing value for argument %s\n", arg);
+			return false;
+		}
+
+		if (strcmp(arg, "--seed") == 0) Config.Generator.Seed = strtoull(value, nullptr, 0);
+		else if (strcmp(arg, "--fanout") == 0) Config.Generator.FanOut = (uint32_t)strtoul(value, nullptr, 0);
+		else if (strcmp(arg, "--depth") == 0) Config.Generator.Depth = (uint32_t)strtoul(value, nullptr, 0);
+		else if (strcmp(arg, "--edge-density") == 0) Config.Generator.EdgeDensity = strtof(value, nullptr);
+		else if (strcmp(arg, "--samples") == 0) Config.SampleCount = strtoull(value, nullptr, 0);
+		else if (strcmp(arg, "--max-nodes") == 0) Config.MaxNodeCount = strtoull(value, nullptr, 0);
+		else if (strcmp(arg, "--bulk-nodes") == 0) Config.BulkNodeCount = strtoull(value, nullptr, 0);
+		else if (strcmp(arg, "--access-mix") == 0)
+		{
+			if (sscanf(value, "%u,%u,%u,%u", &Config.Generator.AccessLevelMix[0], &Config.Generator.AccessLevelMix[1],
+				&Config.Generator.AccessLevelMix[2], &Config.Generator.AccessLevelMix[3]) != 4)
+			{
+				fprintf(stderr, "--access-mix expects 4 comma separated weights.\n");
+				return false;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", arg);
+			return false;
+		}
+
+		argIndex++;
+	}
+
+	return Config.SampleCount > 0 && Config.MaxNodeCount > 0;
+}
+
+// Returns the number of nodes the generator will produce for the passed config, without generating anything.
+static size_t ExpectedGeneratedNodeCount(const BenchConfig& Config)
+{
+	size_t nodeCount = 1;
+	size_t levelSize = 1;
+	for (uint32_t level = 0; level < Config.Generator.Depth && nodeCount < Config.MaxNodeCount; level++)
+	{
+		levelSize *= Config.Generator.FanOut;
+		nodeCount += levelSize;
+	}
+	return nodeCount < Config.MaxNodeCount ? nodeCount : Config.MaxNodeCount;
+}
+
+/*
+	Initializes a graph with room for the passed number of nodes and an edge budget fitting generated graphs.
+	Memory comes from a Stack Allocator over a buffer the caller must free. Returns the buffer, or nullptr on failure.
+*/
+static uint8_t* InitializeBenchGraph(ClientGraph& Graph, const GraphGeneratorConfig& Generator, size_t NodeCount, size_t& OutMemorySize)
+{
+	// Two connections per parent - child link, plus cross connections.
+	const size_t edgeCount = NodeCount * 2 + (size_t)(NodeCount * Generator.EdgeDensity) + 2 * BENCH_RESERVED_NODE_COUNT;
+
+	OutMemorySize = ClientGraph::GetRequiredMemorySize(NodeCount, edgeCount);
+	uint8_t* memory = (uint8_t*)malloc(OutMemorySize);
+	if (memory == nullptr)
+	{
+		return nullptr;
+	}
+
+	MemoryAllocator allocator = MakeStackAllocator(memory, OutMemorySize);
+	if (!Graph.Initialize(allocator, NodeCount, edgeCount))
+	{
+		free(memory);
+		return nullptr;
+	}
+	return memory;
+}
+
+/*
+	Times name searches built from the names of random nodes: prefixes of whole names in PREFIX mode, and 3 to 6 character
+	slices from anywhere in names in SUBSTRING mode.
+*/
+template<typename RandomNodeIDFunc>
+static void BenchSearch(ClientGraph& Graph, RandomNodeIDFunc&& RandomNodeID, GraphGeneratorRandom& Random, size_t SampleCount,
+	const char* PrefixResultName, const char* SubstringResultName, std::vector<BenchResult>& Results)
+{
+	volatile size_t sink = 0;
+	SGraphSearchHit hits[20];
+
+	for (SGraphSearchMode mode : { SGraphSearchMode::PREFIX, SGraphSearchMode::SUBSTRING })
+	{
+		BenchResult result = { mode == SGraphSearchMode::PREFIX ? PrefixResultName : SubstringResultName, 0, {} };
+		for (size_t sample = 0; sample < SampleCount; sample++)
+		{
+			std::string_view name = Graph.GetNodeDef(RandomNodeID()).name;
+
+			SGraphSearchQuery query;
+			query.Mode = mode;
+			if (mode == SGraphSearchMode::PREFIX)
+			{
+				query.Text = name.substr(0, 1 + Random.NextBelow(name.size()));
+			}
+			else
+			{
+				size_t length = name.size() < 3 ? name.size() : 3 + Random.NextBelow(std::min<size_t>(4, name.size() - 2));
+				query.Text = name.substr(Random.NextBelow(name.size() - length + 1), length);
+			}
+
+			SGraphSearchResultInfo info;
+			uint64_t start = BenchNow();
+			sink += Graph.SearchNodes(query, hits, sizeof(hits) / sizeof(SGraphSearchHit), info);
+			result.Samples.push_back(BenchNow() - start);
+		}
+		Results.push_back(std::move(result));
+	}
+}
+
+static bool RunBulkLoadBench(const BenchConfig& Config, BulkBenchResult& OutResult, std::vector<BenchResult>& Results)
+{
+	GraphGeneratorConfig generator = Config.Generator;
+	generator.MaxNodeCount = Config.BulkNodeCount;
+
+	char filePath[256];
+	snprintf(filePath, sizeof(filePath), "SynergyGraphBench_%llu.graph", (unsigned long long)generator.Seed);
+
+	GeneratedGraphInfo fileInfo;
+	if (!WriteGraphBulkFile(generator, filePath, fileInfo))
+	{
+		fprintf(stderr, "Failed to write bulk file %s.\n", filePath);
+		return false;
+	}
+
+	if (FILE* file = fopen(filePath, "rb"))
+	{
+		fseek(file, 0, SEEK_END);
+		OutResult.FileSize = (size_t)ftell(file);
+		fclose(file);
+	}
+
+	ClientGraph* graph = new ClientGraph();
+	size_t memorySize = 0;
+	uint8_t* memory = InitializeBenchGraph(*graph, generator, generator.MaxNodeCount, memorySize);
+	if (memory == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate bulk load graph.\n");
+		delete graph;
+		remove(filePath);
+		return false;
+	}
+
+	uint64_t start = BenchNow();
+	bool bLoaded = graph->BulkLoad(filePath, SGraphBulkLoadOptions(), OutResult.Load);
+	OutResult.ElapsedNs = BenchNow() - start;
+
+	if (!bLoaded)
+	{
+		fprintf(stderr, "Bulk load failed at line %zu: %s\n", OutResult.Load.ErrorLine, OutResult.Load.Error);
+	}
+	else
+	{
+		GraphGeneratorRandom random = { generator.Seed ^ 0x5EA4C4ull };
+		auto RandomNodeID = [&]() { return OutResult.Load.FirstNodeID + random.NextBelow(OutResult.Load.NodeCount); };
+		BenchSearch(*graph, RandomNodeID, random, Config.SampleCount, "SearchNodes_Prefix_BulkGraph", "SearchNodes_Substring_BulkGraph", Results);
+	}
+
+	free(memory);
+	delete graph;
+	remove(filePath);
+	return bLoaded;
+}
+
+static uint64_t Percentile(const std::vector<uint64_t>& SortedSamples, double Fraction)
+{
+	if (SortedSamples.empty()) return 0;
+
+	size_t index = (size_t)(Fraction * (double)SortedSamples.size());
+	return SortedSamples[index < SortedSamples.size() ? index : SortedSamples.size() - 1];
+}
+
+static void PrintResultsJSON(const BenchConfig& Config, const GeneratedGraphInfo& Info, std::vector<BenchResult>& Results, const BulkBenchResult* BulkResult)
+{
+	const GraphGeneratorConfig& gen = Config.Generator;
+
+	printf("{\n");
+	printf("\t\"config\": { \"seed\": %llu, \"fanout\": %u, \"depth\": %u, \"edgeDensity\": %g, \"accessMix\": [%u, %u, %u, %u], \"samples\": %zu },\n",
+		(unsigned long long)gen.Seed, gen.FanOut, gen.Depth, gen.EdgeDensity,
+		gen.AccessLevelMix[0], gen.AccessLevelMix[1], gen.AccessLevelMix[2], gen.AccessLevelMix[3], Config.SampleCount);
+	printf("\t\"graph\": { \"nodes\": %zu, \"depth\": %zu, \"crossConnections\": %zu, \"transactions\": %zu, \"maxNodes\": %zu },\n",
+		Info.NodeCount, Info.HierarchyDepth, Info.CrossConnectionCount, Info.TransactionCount, Config.MaxNodeCount);
+	printf("\t\"results\": [\n");
+
+	for (size_t resultIndex = 0; resultIndex < Results.size(); resultIndex++)
+	{
+		BenchResult& result = Results[resultIndex];
+		std::sort(result.Samples.begin(), result.Samples.end());
+
+		uint64_t total = 0;
+		for (uint64_t sample : result.Samples) total += sample;
+
+		printf("\t\t{ \"name\": \"%s\", ", result.Name);
+		if (result.TransactionSize > 0)
+		{
+			printf("\"transactionSize\": %zu, ", result.TransactionSize);
+		}
+		printf("\"samples\": %zu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"mean_ns\": %llu, \"max_ns\": %llu }%s\n",
+			result.Samples.size(),
+			(unsigned long long)Percentile(result.Samples, 0.50),
+			(unsigned long long)Percentile(result.Samples, 0.99),
+			(unsigned long long)(result.Samples.empty() ? 0 : total / result.Samples.size()),
+			(unsigned long long)(result.Samples.empty() ? 0 : result.Samples.back()),
+			resultIndex + 1 < Results.size() ? "," : "");
+	}
+
+	printf("\t]%s\n", BulkResult != nullptr ? "," : "");
+
+	if (BulkResult != nullptr)
+	{
+		const double seconds = BulkResult->ElapsedNs / 1e9;
+		printf("\t\"bulkLoad\": { \"nodes\": %zu, \"connections\": %zu, \"fileBytes\": %zu, \"elapsed_ms\": %.2f, \"nodesPerSecond\": %.0f, \"megabytesPerSecond\": %.1f }\n",
+			BulkResult->Load.NodeCount, BulkResult->Load.ConnectionCount, BulkResult->FileSize, BulkResult->ElapsedNs / 1e6,
+			seconds > 0 ? BulkResult->Load.NodeCount / seconds : 0.0, seconds > 0 ? BulkResult->FileSize / seconds / (1024.0 * 1024.0) : 0.0);
+	}
+
+	printf("}\n");
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	if (!ParseArguments(argc, argv, config))
+	{
+		return 1;
+	}
+	config.Generator.MaxNodeCount = ExpectedGeneratedNodeCount(config);
+
+	// The store is sized after the generated graph, with some room left so transactions created during the benchmark always fit.
+	ClientGraph* graph = new ClientGraph();
+	size_t graphMemorySize = 0;
+	uint8_t* graphMemory = InitializeBenchGraph(*graph, config.Generator, config.Generator.MaxNodeCount + BENCH_RESERVED_NODE_COUNT, graphMemorySize);
+	if (graphMemory == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate graph.\n");
+		return 1;
+	}
+
+	// Backup of the graph's store memory and bookkeeping, restored after every sample that modifies the graph.
+	uint8_t* graphMemoryBackup = (uint8_t*)malloc(graphMemorySize);
+	ClientGraph* graphBackup = new ClientGraph();
+	ClientGraphEditTransaction* transaction = new ClientGraphEditTransaction();
+	std::vector<SNodeGUID> nodeIDs(config.Generator.MaxNodeCount);
+
+	if (graphMemoryBackup == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate graph backup.\n");
+		return 1;
+	}
+
+	GeneratedGraphInfo info;
+	uint64_t generationStart = BenchNow();
+	if (!GenerateGraph(*graph, config.Generator, nodeIDs.data(), info))
+	{
+		fprintf(stderr, "Graph generation failed.\n");
+		return 1;
+	}
+	fprintf(stderr, "Generated %zu nodes and %zu cross connections in %.2f ms.\n", info.NodeCount, info.CrossConnectionCount,
+		(BenchNow() - generationStart) / 1e6);
+
+	GraphGeneratorRandom random = { config.Generator.Seed ^ 0xBE7C4ull };
+	auto RandomNodeID = [&]() { return nodeIDs[random.NextBelow(info.NodeCount)]; };
+
+	// Names of the previous transaction are released first, unless it was applied already.
+	auto ResetTransaction = [&]()
+	{
+		transaction->ReleaseNames();
+		transaction->~ClientGraphEditTransaction();
+		new (transaction) ClientGraphEditTransaction();
+		transaction->TargetGraph = graph;
+	};
+
+	// Sink for results so the compiler can't discard benchmarked calls.
+	volatile uint64_t sink = 0;
+
+	std::vector<BenchResult> results;
+
+	// GetNodeDef by ID
+	{
+		BenchResult result = { "GetNodeDef_ByID", 0, {} };
+		for (size_t sample = 0; sample < config.SampleCount; sample++)
+		{
+			SNodeGUID nodeID = RandomNodeID();
+			uint64_t start = BenchNow();
+			SNodeDef def = graph->GetNodeDef(nodeID);
+			result.Samples.push_back(BenchNow() - start);
+			sink += def.parentID;
+		}
+		results.push_back(std::move(result));
+	}
+
+	// GetNodeDef by name
+	{
+		BenchResult result = { "GetNodeDef_ByName", 0, {} };
+		for (size_t sample = 0; sample < config.SampleCount; sample++)
+		{
+			SNodeDef target = graph->GetNodeDef(RandomNodeID());
+			uint64_t start = BenchNow();
+			SNodeDef def = graph->GetNodeDef(target.name);
+			result.Samples.push_back(BenchNow() - start);
+			sink += def.id;
+		}
+		results.push_back(std::move(result));
+	}
+
+	// GetNodeConnections_Bidirectional
+	{
+		BenchResult result = { "GetNodeConnections_Bidirectional", 0, {} };
+		SNodeConnectionDef connections[64];
+		for (size_t sample = 0; sample < config.SampleCount; sample++)
+		{
+			SNodeGUID nodeID = RandomNodeID();
+			uint64_t start = BenchNow();
+			size_t count = graph->GetNodeConnections_Bidirectional(nodeID, connections, sizeof(connections) / sizeof(SNodeConnectionDef));
+			result.Samples.push_back(BenchNow() - start);
+			sink += count;
+		}
+		results.push_back(std::move(result));
+	}
+
+	BenchSearch(*graph, RandomNodeID, random, config.SampleCount, "SearchNodes_Prefix", "SearchNodes_Substring", results);
+
+	// Hierarchy walks through the store's columns.
+	{
+		BenchResult result = { "ForEachAncestor", 0, {} };
+		for (size_t sample = 0; sample < config.SampleCount; sample++)
+		{
+			SNodeGUID nodeID = RandomNodeID();
+			size_t depth = 0;
+			uint64_t start = BenchNow();
+			graph->DataStore.ForEachAncestor(nodeID, [&](SNodeGUID) { depth++; return true; });
+			result.Samples.push_back(BenchNow() - start);
+			sink += depth;
+		}
+		results.push_back(std::move(result));
+	}
+
+	{
+		BenchResult result = { "ForEachInSubtree_Root", 0, {} };
+		for (size_t sample = 0; sample < config.SampleCount; sample++)
+		{
+			size_t visited = 0;
+			uint64_t start = BenchNow();
+			graph->DataStore.ForEachInSubtree(graph->RootNodeID, [&](SNodeGUID, size_t) { visited++; return true; });
+			result.Samples.push_back(BenchNow() - start);
+			sink += visited;
+		}
+		results.push_back(std::move(result));
+	}
+
+	// FetchGraphNode into an empty transaction
+	{
+		BenchResult result = { "FetchGraphNode", 0, {} };
+		for (size_t sample = 0; sample < config.SampleCount; sample++)
+		{
+			ResetTransaction();
+			SNodeGUID nodeID = RandomNodeID();
+			uint64_t start = BenchNow();
+			GraphEditNode* node = transaction->FetchGraphNode(nodeID);
+			result.Samples.push_back(BenchNow() - start);
+			sink += node != nullptr;
+		}
+		results.push_back(std::move(result));
+	}
+
+	// ApplyEditTransaction, creating N nodes under a fetched parent. The graph is restored after every sample so each one
+	// starts from the same state.
+	auto RestoreGraph = [&]()
+	{
+		memcpy(graphMemory, graphMemoryBackup, graphMemorySize);
+		*graph = *graphBackup;
+	};
+
+	memcpy(graphMemoryBackup, graphMemory, graphMemorySize);
+	*graphBackup = *graph;
+	for (size_t transactionSize : BENCH_TRANSACTION_SIZES)
+	{
+		BenchResult result = { "ApplyEditTransaction_CreateNodes", transactionSize, {} };
+		for (size_t sample = 0; sample < config.SampleCount; sample++)
+		{
+			ResetTransaction();
+			GraphEditNode* parent = transaction->FetchGraphNode(RandomNodeID());
+			for (size_t nodeIndex = 0; nodeIndex < transactionSize; nodeIndex++)
+			{
+				char name[SNODE_NAME_MAX_LENGTH + 1];
+				SNodeDef def = {};
+				def.name = std::string_view(name, snprintf(name, sizeof(name), "Bench %zu", nodeIndex));
+				transaction->CreateNode(def, parent);
+			}
+
+			uint64_t start = BenchNow();
+			bool bApplied = graph->ApplyEditTransaction(*transaction);
+			result.Samples.push_back(BenchNow() - start);
+			sink += bApplied;
+
+			// Names are released into the graph they were taken from, before it is restored.
+			transaction->ReleaseNames();
+			RestoreGraph();
+		}
+		results.push_back(std::move(result));
+	}
+
+	// Wire encoding of the same transactions: exporting them to ops and encoding a SUBMIT_TRANSACTION frame, then decoding its ops.
+	{
+		std::vector<SGraphOp> ops(SGRAPH_TRANSACTION_MAX_OPS);
+		std::vector<uint8_t> frame;
+		SProtocolTransactionReader reader;
+
+		for (size_t transactionSize : BENCH_TRANSACTION_SIZES)
+		{
+			BenchResult encodeResult = { "EncodeTransaction_CreateNodes", transactionSize, {} };
+			BenchResult decodeResult = { "DecodeTransaction_CreateNodes", transactionSize, {} };
+			for (size_t sample = 0; sample < config.SampleCount; sample++)
+			{
+				ResetTransaction();
+				GraphEditNode* parent = transaction->FetchGraphNode(RandomNodeID());
+				for (size_t nodeIndex = 0; nodeIndex < transactionSize; nodeIndex++)
+				{
+					char name[SNODE_NAME_MAX_LENGTH + 1];
+					SNodeDef def = {};
+					def.name = std::string_view(name, snprintf(name, sizeof(name), "Bench %zu", nodeIndex));
+					transaction->CreateNode(def, parent);
+				}
+
+				frame.clear();
+				uint64_t start = BenchNow();
+				size_t opCount = transaction->ExportOps(ops.data(), ops.size());
+				SProtocolAppendSubmitTransaction(frame, (uint32_t)sample, ops.data(), opCount);
+				encodeResult.Samples.push_back(BenchNow() - start);
+
+				start = BenchNow();
+				SGraphOp op;
+				size_t decodedCount = 0;
+				if (reader.Begin(frame.data() + SPROTOCOL_FRAME_HEADER_SIZE, frame.size() - SPROTOCOL_FRAME_HEADER_SIZE))
+				{
+					while (reader.Next(op))
+					{
+						decodedCount += op.Name.size();
+					}
+				}
+				decodeResult.Samples.push_back(BenchNow() - start);
+				sink += decodedCount + frame.size();
+			}
+			results.push_back(std::move(encodeResult));
+			results.push_back(std::move(decodeResult));
+		}
+	}
+
+	// ApplyEditTransaction, adding N / 2 connections between pairs of fetched nodes (a transaction can only fetch 32 nodes).
+	for (size_t transactionSize : BENCH_TRANSACTION_SIZES)
+	{
+		const size_t connectionCount = transactionSize / 2 > 0 ? transactionSize / 2 : 1;
+
+		// Every pair needs its own two nodes, which small generated graphs don't have for the larger transactions.
+		if (2 * connectionCount >= info.NodeCount)
+		{
+			fprintf(stderr, "Skipping ApplyEditTransaction_AddConnections with %zu connections, the graph only has %zu nodes.\n",
+				connectionCount, info.NodeCount);
+			continue;
+		}
+
+		BenchResult result = { "ApplyEditTransaction_AddConnections", connectionCount, {} };
+		for (size_t sample = 0; sample < config.SampleCount; sample++)
+		{
+			ResetTransaction();
+
+			// Nodes fetched twice in a transaction would alias, so use consecutive generated nodes from a random start.
+			const size_t firstNodeIndex = (size_t)random.NextBelow(info.NodeCount - 2 * connectionCount);
+			for (size_t connectionIndex = 0; connectionIndex < connectionCount; connectionIndex++)
+			{
+				size_t pairStart = firstNodeIndex + 2 * connectionIndex;
+				GraphEditNode* src = transaction->FetchGraphNode(nodeIDs[pairStart]);
+				GraphEditNode* dest = transaction->FetchGraphNode(nodeIDs[pairStart + 1]);
+				if (src == nullptr || dest == nullptr) break;
+
+				transaction->AddOrEditConnection(*src, *dest, { src->ID, dest->ID, PickAccessLevel(config.Generator, random) });
+			}
+
+			uint64_t start = BenchNow();
+			bool bApplied = graph->ApplyEditTransaction(*transaction);
+			result.Samples.push_back(BenchNow() - start);
+			sink += bApplied;
+
+			// Names are released into the graph they were taken from, before it is restored.
+			transaction->ReleaseNames();
+			RestoreGraph();
+		}
+		results.push_back(std::move(result));
+	}
+
+	BulkBenchResult bulkResult;
+	if (config.BulkNodeCount > 0 && !RunBulkLoadBench(config, bulkResult, results))
+	{
+		return 1;
+	}
+
+	PrintResultsJSON(config, info, results, config.BulkNodeCount > 0 ? &bulkResult : nullptr);
+
+	delete transaction;
+	delete graphBackup;
+	delete graph;
+	free(graphMemoryBackup);
+	free(graphMemory);
+	return 0;
+}
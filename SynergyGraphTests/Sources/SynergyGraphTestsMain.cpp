@@ -0,0 +1,167 @@
+#define TRANSLATION_UNIT SYNERGY_GRAPH_TESTS
+
+// Tests of the Client Graph. Every test builds its own small graph, and the program fails if any of them does.
+//
+// Usage: SynergyGraphTests
+
+#include "SynergyCore.h"
+#include "ClientGraph.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Source includes
+#include "Graph_INC.cpp"
+
+// Capacity of the graphs tests run on.
+constexpr size_t TEST_GRAPH_MAX_NODE_COUNT = 64;
+constexpr size_t TEST_GRAPH_MAX_CONNECTION_COUNT = 4 * TEST_GRAPH_MAX_NODE_COUNT;
+
+// Graph a test runs on, along with the memory it was allocated from.
+struct TestGraph
+{
+	ClientGraph Graph;
+	uint8_t* Memory = nullptr;
+
+	// Nodes every test graph starts with: a root and one child of it, where tests can make changes without touching the root.
+	SNodeGUID RootID = SNODE_INVALID_ID;
+	SNodeGUID ScratchID = SNODE_INVALID_ID;
+
+	~TestGraph() { free(Memory); }
+};
+
+static bool GTestFailed = false;
+
+static bool Check(bool bCondition, const char* Test, const char* Description)
+{
+	if (!bCondition)
+	{
+		fprintf(stderr, "%s: %s\n", Test, Description);
+		GTestFailed = true;
+	}
+	return bCondition;
+}
+
+static bool InitializeTestGraph(TestGraph& Test)
+{
+	const size_t memorySize = ClientGraph::GetRequiredMemorySize(TEST_GRAPH_MAX_NODE_COUNT, TEST_GRAPH_MAX_CONNECTION_COUNT);
+	Test.Memory = (uint8_t*)malloc(memorySize);
+	if (Test.Memory == nullptr)
+	{
+		return false;
+	}
+
+	MemoryAllocator allocator = MakeStackAllocator(Test.Memory, memorySize);
+	if (!Test.Graph.Initialize(allocator, TEST_GRAPH_MAX_NODE_COUNT, TEST_GRAPH_MAX_CONNECTION_COUNT))
+	{
+		return false;
+	}
+
+	ClientGraphEditTransaction transaction;
+	transaction.TargetGraph = &Test.Graph;
+	GraphEditNode* root = transaction.CreateNode({ SNODE_INVALID_ID, SNODE_INVALID_ID, "Root" }, nullptr);
+	GraphEditNode* scratch = transaction.CreateNode({ SNODE_INVALID_ID, SNODE_INVALID_ID, "Scratch" }, root);
+	if (root == nullptr || scratch == nullptr || !Test.Graph.ApplyEditTransaction(transaction))
+	{
+		return false;
+	}
+
+	Test.RootID = root->ID;
+	Test.ScratchID = scratch->ID;
+	return true;
+}
+
+// Creates a node under the scratch node in a transaction of its own.
+static bool CreateScratchChild(TestGraph& Test, std::string_view Name)
+{
+	ClientGraphEditTransaction transaction;
+	transaction.TargetGraph = &Test.Graph;
+	GraphEditNode* scratch = transaction.FetchGraphNode(Test.ScratchID);
+	if (scratch == nullptr || transaction.CreateNode({ SNODE_INVALID_ID, SNODE_INVALID_ID, Name }, scratch) == nullptr)
+	{
+		transaction.ReleaseNames();
+		return false;
+	}
+	return Test.Graph.ApplyEditTransaction(transaction);
+}
+
+/*
+	A transaction built, then left queued while others are applied, still applies with the names it was given. Applying the others
+	reclaims the names nothing references, then interns names of the same sizes, which would take over those the queued one interned
+	if it didn't hold on to them.
+*/
+static void TestQueuedTransactionKeepsNames()
+{
+	const char* test = "QueuedTransactionKeepsNames";
+	TestGraph graph;
+	if (!Check(InitializeTestGraph(graph), test, "failed to initialize the graph"))
+	{
+		return;
+	}
+
+	ClientGraphEditTransaction queued;
+	queued.TargetGraph = &graph.Graph;
+	GraphEditNode* root = queued.FetchGraphNode(graph.RootID);
+	GraphEditNode* created = root != nullptr ? queued.CreateNode({ SNODE_INVALID_ID, SNODE_INVALID_ID, "Queued 1" }, root) : nullptr;
+	if (!Check(created != nullptr && queued.EditNode(*root, { SNODE_INVALID_ID, SNODE_INVALID_ID, "Queued root" }), test,
+		"failed to build the queued transaction"))
+	{
+		return;
+	}
+
+	Check(CreateScratchChild(graph, "Other 01"), test, "failed to apply the first other transaction");
+	Check(CreateScratchChild(graph, "Other 02"), test, "failed to apply the second other transaction");
+	Check(CreateScratchChild(graph, "Other root1"), test, "failed to apply the third other transaction");
+
+	// Names taken over leave the pool's lookup table inconsistent, nothing more can be checked then.
+	if (!Check(created->NodeDef.name == "Queued 1" && root->NodeDef.name == "Queued root", test, "the queued transaction's names changed")
+		|| !Check(graph.Graph.ApplyEditTransaction(queued), test, "failed to apply the queued transaction"))
+	{
+		return;
+	}
+
+	Check(graph.Graph.GetNodeDef(created->ID).name == "Queued 1", test, "the created node has the wrong name");
+	Check(graph.Graph.GetNodeDef(graph.RootID).name == "Queued root", test, "the renamed root has the wrong name");
+	Check(graph.Graph.GetNodeDef(std::string_view("Other 02")).id != SNODE_INVALID_ID, test, "a name of another transaction was lost");
+	Check(graph.Graph.DataStore.Names.Find("Root") == SNAME_INVALID_HANDLE, test, "the root's previous name wasn't freed");
+}
+
+/*
+	Names only a transaction given up on held are freed by the next transaction applied.
+*/
+static void TestReleasedTransactionFreesNames()
+{
+	const char* test = "ReleasedTransactionFreesNames";
+	TestGraph graph;
+	if (!Check(InitializeTestGraph(graph), test, "failed to initialize the graph"))
+	{
+		return;
+	}
+
+	ClientGraphEditTransaction dropped;
+	dropped.TargetGraph = &graph.Graph;
+	GraphEditNode* scratch = dropped.FetchGraphNode(graph.ScratchID);
+	if (!Check(scratch != nullptr && dropped.CreateNode({ SNODE_INVALID_ID, SNODE_INVALID_ID, "Dropped" }, scratch) != nullptr, test,
+		"failed to build the dropped transaction"))
+	{
+		return;
+	}
+	dropped.ReleaseNames();
+
+	Check(CreateScratchChild(graph, "Kept"), test, "failed to apply the other transaction");
+	Check(graph.Graph.DataStore.Names.Find("Dropped") == SNAME_INVALID_HANDLE, test, "the dropped transaction's name wasn't freed");
+	Check(graph.Graph.DataStore.Names.Find("Scratch") != SNAME_INVALID_HANDLE, test, "a name still in use was freed");
+}
+
+int main()
+{
+	TestQueuedTransactionKeepsNames();
+	TestReleasedTransactionFreesNames();
+
+	if (GTestFailed)
+	{
+		return 1;
+	}
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,279 @@
+// Contains symbols that are shared and implemented over multiple files in the Load Generator code.
+// Can only be included in the main Load Generator Translation Unit.
+
+#if (TRANSLATION_UNIT != SYNERGY_LOADGEN_MAIN)
+static_assert(0, "LoadGen.h can only be included inside the SYNERGY_LOADGEN_MAIN translation unit ! Found it with " __BASE_FILE__);
+#endif
+
+#ifndef LOADGEN_INCLUDED
+#define LOADGEN_INCLUDED
+
+#include "SynergyCore.h"
+#include "Net/SynergyProtocol.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// The load generator plays thousands of simulated clients against a running server, to find where the server stops keeping up.
+// Sessions are spread over a few worker threads, each running a non-blocking epoll event loop like the server's. Every session runs a
+// closed loop: it picks an operation from the configured mix, waits for its outcome, thinks for a while if asked to, then picks the next.
+
+enum class LoadGenOpType : uint8_t
+{
+	READ, // Submits a transaction only fetching 1 to 4 nodes of the session's view.
+	NAVIGATE, // Subscribes to the subtree of a node of the view, or of the previous root, and waits for the snapshot to complete.
+	SEARCH, // Searches the names of the session's view. The protocol has no search request: clients search what their subscription mirrors.
+	EDIT, // Changes a node of the view, see LoadGenEditType, at the version the session knows of it. CONFLICT when another session got there first.
+
+	COUNT
+};
+
+constexpr size_t LOADGEN_OP_TYPE_COUNT = (size_t)LoadGenOpType::COUNT;
+
+const char* GetLoadGenOpTypeName(LoadGenOpType Type);
+
+// What an EDIT does to the node it picked, its target.
+enum class LoadGenEditType : uint8_t
+{
+	RENAME, // Renames the target.
+	CREATE, // Creates a child under the target.
+	DELETE, // Deletes the target, or the deepest node under it the view knows. Fails when that one has children beyond the view.
+	MOVE, // Moves the target under another node of the view, or under the view's root if that one is below the target.
+	CONNECT, // Sets the connection from the target to another node of the view. Parent - child connections stay OPEN, others may go.
+
+	COUNT
+};
+
+constexpr size_t LOADGEN_EDIT_TYPE_COUNT = (size_t)LoadGenEditType::COUNT;
+
+const char* GetLoadGenEditTypeName(LoadGenEditType Type);
+
+struct LoadGenConfig
+{
+	const char* Address = "127.0.0.1";
+	uint16_t Port = SPROTOCOL_DEFAULT_PORT;
+
+	size_t SessionCount = 1000;
+
+	// Number of worker threads running event loops. 0 picks one per hardware thread.
+	uint32_t ThreadCount = 0;
+
+	// Operations completing during the warmup aren't measured. The run lasts warmup plus duration.
+	double WarmupSeconds = 1.0;
+	double DurationSeconds = 10.0;
+
+	// Relative weights of each operation type, indexed by LoadGenOpType.
+	uint32_t OpMix[LOADGEN_OP_TYPE_COUNT] = { 50, 20, 20, 10 };
+
+	// Relative weights of each edit type, indexed by LoadGenEditType. Deletions are picked as often as creations, though more of them fail,
+	// so the graph slowly grows over a run.
+	uint32_t EditMix[LOADGEN_EDIT_TYPE_COUNT] = { 40, 15, 15, 15, 15 };
+
+	// Pause between an operation's outcome and the next operation of the same session. 0 runs sessions flat out.
+	uint32_t ThinkTimeMs = 0;
+
+	// Depth of the subtrees sessions subscribe to.
+	uint32_t ViewDepth = 1;
+
+	// Node sessions start from, which also is the viewer of every subscription.
+	SNodeGUID RootID = 0;
+
+	// Tree created under the root before the run, so sessions have something to work on. A depth of 0 uses the graph as it is.
+	uint32_t SeedFanOut = 8;
+	uint32_t SeedDepth = 3;
+
+	uint64_t Seed = 0x10AD;
+};
+
+/*
+	Small deterministic pseudo random generator (SplitMix64), one per session.
+*/
+struct LoadGenRandom
+{
+	uint64_t State = 0;
+
+	uint64_t Next()
+	{
+		uint64_t z = (State += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	// Returns a value in [0, Bound[. Bound must be greater than 0.
+	uint64_t NextBelow(uint64_t Bound) { return Next() % Bound; }
+};
+
+// Values are split in buckets of 2^LOADGEN_HISTOGRAM_SUB_BUCKET_BITS linear sub-buckets, values up to 2^LOADGEN_HISTOGRAM_MAX_VALUE_BITS.
+constexpr uint32_t LOADGEN_HISTOGRAM_SUB_BUCKET_BITS = 8;
+constexpr uint32_t LOADGEN_HISTOGRAM_MAX_VALUE_BITS = 40;
+constexpr size_t LOADGEN_HISTOGRAM_HALF_SUB_BUCKET_COUNT = (size_t)1 << (LOADGEN_HISTOGRAM_SUB_BUCKET_BITS - 1);
+constexpr size_t LOADGEN_HISTOGRAM_COUNTS_SIZE =
+	(LOADGEN_HISTOGRAM_MAX_VALUE_BITS - LOADGEN_HISTOGRAM_SUB_BUCKET_BITS + 2) * LOADGEN_HISTOGRAM_HALF_SUB_BUCKET_COUNT;
+
+/*
+	Latency histogram in the manner of HdrHistogram: values are grouped by power of two, and each power of two is split in linear
+	sub-buckets, so any value is kept within 1 / 128 of itself whatever its magnitude, in constant memory and constant recording time.
+	Histograms of different threads merge by adding them up. Values past the largest one are counted as the largest one.
+*/
+struct LoadGenHistogram
+{
+	uint64_t Counts[LOADGEN_HISTOGRAM_COUNTS_SIZE] = {};
+	uint64_t TotalCount = 0;
+	uint64_t MinValue = ~0ull;
+	uint64_t MaxValue = 0;
+	uint64_t ValueSum = 0;
+
+	void Record(uint64_t Value);
+	void Add(const LoadGenHistogram& Other);
+
+	// Value at or below which Percentile % of recorded values are, within the histogram's precision. 0 when empty.
+	uint64_t GetValueAtPercentile(double Percentile) const;
+
+	uint64_t GetMean() const { return TotalCount > 0 ? ValueSum / TotalCount : 0; }
+};
+
+// What a worker's sessions measured. Only operations completing after the warmup are counted.
+struct LoadGenStats
+{
+	// Latency of each operation type, in nanoseconds.
+	LoadGenHistogram Latency[LOADGEN_OP_TYPE_COUNT];
+
+	// Transactions of each operation type that failed, with CONFLICT or with any other status.
+	uint64_t Conflicts[LOADGEN_OP_TYPE_COUNT] = {};
+	uint64_t Failures[LOADGEN_OP_TYPE_COUNT] = {};
+
+	// Edits of each edit type, and how many of them failed, with CONFLICT or with any other status.
+	uint64_t EditCounts[LOADGEN_EDIT_TYPE_COUNT] = {};
+	uint64_t EditConflicts[LOADGEN_EDIT_TYPE_COUNT] = {};
+	uint64_t EditFailures[LOADGEN_EDIT_TYPE_COUNT] = {};
+
+	uint64_t SubscriptionUpdateCount = 0;
+	uint64_t SearchHitCount = 0;
+	uint64_t BytesSent = 0;
+	uint64_t BytesReceived = 0;
+
+	void Add(const LoadGenStats& Other);
+};
+
+// A node of a session's view, as its subscription last described it.
+struct LoadGenViewNode
+{
+	SNodeGUID ParentID = SNODE_INVALID_ID;
+	uint64_t Version = 0;
+	std::string Name;
+
+	// Position in the session's ViewNodeIDs.
+	size_t Slot = 0;
+};
+
+/*
+	A simulated client. Owned by a worker, and only ever touched by its thread.
+*/
+struct LoadGenSession
+{
+	int Socket = -1;
+	bool bConnected = false;
+
+	LoadGenRandom Random;
+
+	// Bytes received and not yet processed, and bytes waiting to be sent. Everything before WriteOffset was sent already.
+	std::vector<uint8_t> ReadBuffer;
+	std::vector<uint8_t> WriteBuffer;
+	size_t WriteOffset = 0;
+
+	// Events the worker's epoll instance currently watches the socket for.
+	uint32_t WatchedEvents = 0;
+
+	uint32_t NextRequestID = 1;
+
+	// Current subscription, and the view it brought: its nodes by ID, and their IDs for random picks.
+	uint32_t SubscriptionRequestID = 0;
+	SNodeGUID ViewRootID = SNODE_INVALID_ID;
+	std::unordered_map<SNodeGUID, LoadGenViewNode> View;
+	std::vector<SNodeGUID> ViewNodeIDs;
+
+	// Roots navigated away from, latest last, so sessions can go back up the hierarchy.
+	std::vector<SNodeGUID> NavigationPath;
+
+	// Operation waiting for its outcome, if any, and when the next one may start otherwise.
+	bool bOpPending = false;
+	LoadGenOpType PendingOp = LoadGenOpType::COUNT;
+	LoadGenEditType PendingEdit = LoadGenEditType::COUNT;
+	uint32_t PendingRequestID = 0;
+	uint64_t OpStartTime = 0;
+	uint64_t NextOpTime = 0;
+};
+
+struct LoadGenWorker
+{
+	uint32_t Index = 0;
+	int EpollDescriptor = -1;
+	std::thread Thread;
+
+	std::vector<std::unique_ptr<LoadGenSession>> Sessions;
+
+	// Sessions done with their last operation, in the order they may start the next one: the think time is the same for all.
+	std::deque<LoadGenSession*> ReadySessions;
+
+	// Scratch for building transactions.
+	std::vector<SGraphOp> Ops;
+
+	// Whether what happens now is measured, updated after every wait.
+	bool bMeasuring = false;
+	LoadGenStats Stats;
+
+	// Sessions that connected, failed to, or got disconnected afterwards.
+	size_t ConnectedCount = 0;
+	size_t ConnectFailureCount = 0;
+	size_t DisconnectCount = 0;
+
+	// Operations completed so far, warmup included, for progress reports from the main thread.
+	std::atomic<uint64_t> CompletedOpCount { 0 };
+};
+
+struct LoadGenState
+{
+	LoadGenConfig Config;
+
+	std::vector<LoadGenWorker> Workers;
+
+	// Cleared to ask workers to stop.
+	std::atomic<bool> bRunning { false };
+
+	// Operations completing before this time, in LoadGenNow() nanoseconds, aren't measured.
+	uint64_t MeasureStartTime = 0;
+};
+
+// Monotonic timestamp in nanoseconds.
+inline uint64_t LoadGenNow()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// MAJOR PROCEDURES
+
+/*
+	Creates the configured tree under the root through a dedicated connection, before sessions start.
+	Returns the number of created nodes, or false if the server refused a transaction or went away.
+*/
+bool SeedServerGraph(const LoadGenConfig& Config, size_t& OutCreatedCount);
+
+// Number of worker threads the configuration asks for.
+uint32_t GetLoadGenWorkerCount(const LoadGenConfig& Config);
+
+/*
+	Spreads sessions over worker threads, which connect them and run them until StopLoadGen. Returns whether workers are running.
+*/
+bool StartLoadGen(LoadGenState& State);
+
+// Asks workers to stop, waits for them, then closes every session.
+void StopLoadGen(LoadGenState& State);
+
+#endif // LOADGEN_INCLUDED
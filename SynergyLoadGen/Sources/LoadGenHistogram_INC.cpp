@@ -0,0 +1,122 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Load Generator's latency histograms and statistics.
+//
+// A value's magnitude is how far it must be shifted right to fit in SUB_BUCKET_BITS bits. Values of magnitude 0 index the counts
+// directly, and each further magnitude adds half a bucket's worth of counts: its values all have their top bit set once shifted,
+// so only the upper half of its sub-buckets can be hit.
+
+#include "LoadGen.h"
+
+static size_t GetHistogramIndex(uint64_t Value)
+{
+	const uint64_t maxValue = (1ull << LOADGEN_HISTOGRAM_MAX_VALUE_BITS) - 1;
+	Value = Value < maxValue ? Value : maxValue;
+
+	uint32_t highestBit = 0;
+	for (uint64_t shifted = Value >> 1; shifted != 0; shifted >>= 1) highestBit++;
+
+	const uint32_t magnitude = highestBit >= LOADGEN_HISTOGRAM_SUB_BUCKET_BITS ? highestBit - (LOADGEN_HISTOGRAM_SUB_BUCKET_BITS - 1) : 0;
+	return (size_t)magnitude * LOADGEN_HISTOGRAM_HALF_SUB_BUCKET_COUNT + (size_t)(Value >> magnitude);
+}
+
+// Highest value counted at the passed index.
+static uint64_t GetHistogramIndexValue(size_t Index)
+{
+	const size_t half = LOADGEN_HISTOGRAM_HALF_SUB_BUCKET_COUNT;
+	const uint32_t magnitude = Index < 2 * half ? 0 : (uint32_t)(Index / half - 1);
+	const uint64_t subBucket = (uint64_t)(Index - magnitude * half);
+	return ((subBucket + 1) << magnitude) - 1;
+}
+
+void LoadGenHistogram::Record(uint64_t Value)
+{
+	Counts[GetHistogramIndex(Value)]++;
+	TotalCount++;
+	ValueSum += Value;
+	MinValue = Value < MinValue ? Value : MinValue;
+	MaxValue = Value > MaxValue ? Value : MaxValue;
+}
+
+void LoadGenHistogram::Add(const LoadGenHistogram& Other)
+{
+	for (size_t index = 0; index < LOADGEN_HISTOGRAM_COUNTS_SIZE; index++)
+	{
+		Counts[index] += Other.Counts[index];
+	}
+	TotalCount += Other.TotalCount;
+	ValueSum += Other.ValueSum;
+	MinValue = Other.MinValue < MinValue ? Other.MinValue : MinValue;
+	MaxValue = Other.MaxValue > MaxValue ? Other.MaxValue : MaxValue;
+}
+
+uint64_t LoadGenHistogram::GetValueAtPercentile(double Percentile) const
+{
+	if (TotalCount == 0)
+	{
+		return 0;
+	}
+
+	// Rank of the value asked for, counting from 1.
+	const double fraction = Percentile < 0.0 ? 0.0 : (Percentile > 100.0 ? 1.0 : Percentile / 100.0);
+	uint64_t rank = (uint64_t)(fraction * (double)TotalCount + 0.5);
+	rank = rank < 1 ? 1 : (rank > TotalCount ? TotalCount : rank);
+
+	uint64_t cumulativeCount = 0;
+	for (size_t index = 0; index < LOADGEN_HISTOGRAM_COUNTS_SIZE; index++)
+	{
+		cumulativeCount += Counts[index];
+		if (cumulativeCount >= rank)
+		{
+			// Bucket bounds may overshoot what was actually recorded.
+			const uint64_t value = GetHistogramIndexValue(index);
+			return value < MaxValue ? (value > MinValue ? value : MinValue) : MaxValue;
+		}
+	}
+	return MaxValue;
+}
+
+void LoadGenStats::Add(const LoadGenStats& Other)
+{
+	for (size_t typeIndex = 0; typeIndex < LOADGEN_OP_TYPE_COUNT; typeIndex++)
+	{
+		Latency[typeIndex].Add(Other.Latency[typeIndex]);
+		Conflicts[typeIndex] += Other.Conflicts[typeIndex];
+		Failures[typeIndex] += Other.Failures[typeIndex];
+	}
+	for (size_t editIndex = 0; editIndex < LOADGEN_EDIT_TYPE_COUNT; editIndex++)
+	{
+		EditCounts[editIndex] += Other.EditCounts[editIndex];
+		EditConflicts[editIndex] += Other.EditConflicts[editIndex];
+		EditFailures[editIndex] += Other.EditFailures[editIndex];
+	}
+	SubscriptionUpdateCount += Other.SubscriptionUpdateCount;
+	SearchHitCount += Other.SearchHitCount;
+	BytesSent += Other.BytesSent;
+	BytesReceived += Other.BytesReceived;
+}
+
+const char* GetLoadGenOpTypeName(LoadGenOpType Type)
+{
+	switch (Type)
+	{
+	case LoadGenOpType::READ: return "READ";
+	case LoadGenOpType::NAVIGATE: return "NAVIGATE";
+	case LoadGenOpType::SEARCH: return "SEARCH";
+	case LoadGenOpType::EDIT: return "EDIT";
+	default: return "UNKNOWN";
+	}
+}
+
+const char* GetLoadGenEditTypeName(LoadGenEditType Type)
+{
+	switch (Type)
+	{
+	case LoadGenEditType::RENAME: return "RENAME";
+	case LoadGenEditType::CREATE: return "CREATE";
+	case LoadGenEditType::DELETE: return "DELETE";
+	case LoadGenEditType::MOVE: return "MOVE";
+	case LoadGenEditType::CONNECT: return "CONNECT";
+	default: return "UNKNOWN";
+	}
+}
@@ -0,0 +1,984 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Load Generator's sessions: connecting them, running their operations from each worker's non-blocking epoll
+// event loop and following what the server answers. Also seeds the graph before the run, over a plain blocking connection.
+
+#include "LoadGen.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__linux__)
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Events handled per epoll_wait call, and how long a wait may last before the worker checks whether it should stop.
+constexpr int LOADGEN_EPOLL_BATCH_SIZE = 256;
+constexpr int LOADGEN_EPOLL_TIMEOUT_MS = 10;
+
+constexpr size_t LOADGEN_READ_CHUNK_SIZE = 16 * 1024;
+
+// Largest number of nodes a READ fetches.
+constexpr uint64_t LOADGEN_MAX_READ_NODES = 4;
+
+// Edits pick among this many names, so the server's name pools don't grow with the length of the run.
+constexpr uint64_t LOADGEN_EDIT_NAME_COUNT = 64;
+
+// One navigation in this many goes back to the previous root rather than down the view.
+constexpr uint64_t LOADGEN_NAVIGATE_BACK_ODDS = 4;
+
+// Transactions the seeding connection sends before reading their results.
+constexpr size_t LOADGEN_SEED_WINDOW = 256;
+
+static bool MakeServerAddress(const LoadGenConfig& Config, sockaddr_in& OutAddress)
+{
+	OutAddress = {};
+	OutAddress.sin_family = AF_INET;
+	OutAddress.sin_port = htons(Config.Port);
+	return inet_pton(AF_INET, Config.Address, &OutAddress.sin_addr) == 1;
+}
+
+// SEEDING
+
+static bool SendAll(int Socket, const std::vector<uint8_t>& Buffer)
+{
+	size_t sentSize = 0;
+	while (sentSize < Buffer.size())
+	{
+		const ssize_t result = send(Socket, Buffer.data() + sentSize, Buffer.size() - sentSize, MSG_NOSIGNAL);
+		if (result < 0 && errno == EINTR) continue;
+		if (result <= 0) return false;
+		sentSize += (size_t)result;
+	}
+	return true;
+}
+
+static bool ReceiveAll(int Socket, uint8_t* Data, size_t Size)
+{
+	size_t receivedSize = 0;
+	while (receivedSize < Size)
+	{
+		const ssize_t result = recv(Socket, Data + receivedSize, Size - receivedSize, 0);
+		if (result < 0 && errno == EINTR) continue;
+		if (result <= 0) return false;
+		receivedSize += (size_t)result;
+	}
+	return true;
+}
+
+// Waits for the next TRANSACTION_RESULT, skipping anything else. Returns false if the connection failed or the result is malformed.
+static bool ReceiveTransactionResult(int Socket, std::vector<uint8_t>& Payload, SProtocolTransactionResult& OutResult,
+	std::vector<SNodeGUID>& OutCreatedIDs)
+{
+	for (;;)
+	{
+		uint8_t header[SPROTOCOL_FRAME_HEADER_SIZE];
+		SProtocolMessageType type;
+		uint32_t payloadSize;
+		if (!ReceiveAll(Socket, header, sizeof(header)) || !SProtocolReadFrameHeader(header, sizeof(header), type, payloadSize)
+			|| payloadSize > SPROTOCOL_MAX_PAYLOAD_SIZE)
+		{
+			return false;
+		}
+
+		Payload.resize(payloadSize);
+		if (!ReceiveAll(Socket, Payload.data(), payloadSize))
+		{
+			return false;
+		}
+
+		if (type == SProtocolMessageType::TRANSACTION_RESULT)
+		{
+			OutCreatedIDs.resize(SGRAPH_TRANSACTION_MAX_OPS);
+			if (!SProtocolDecodeTransactionResult(Payload.data(), payloadSize, OutResult, OutCreatedIDs.data(), OutCreatedIDs.size()))
+			{
+				return false;
+			}
+			OutCreatedIDs.resize(std::min(OutResult.CreatedCount, OutCreatedIDs.size()));
+			return true;
+		}
+	}
+}
+
+bool SeedServerGraph(const LoadGenConfig& Config, size_t& OutCreatedCount)
+{
+	OutCreatedCount = 0;
+
+	sockaddr_in address;
+	if (!MakeServerAddress(Config, address))
+	{
+		std::cerr << "Invalid server address " << Config.Address << ".\n";
+		return false;
+	}
+
+	const int socketDescriptor = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (socketDescriptor < 0 || connect(socketDescriptor, (const sockaddr*)&address, sizeof(address)) != 0)
+	{
+		std::cerr << "Failed to connect to " << Config.Address << ":" << Config.Port << ", error " << errno << ".\n";
+		if (socketDescriptor >= 0) close(socketDescriptor);
+		return false;
+	}
+
+	// Every node of a level gets its children from its own transaction, a window of them sent before reading their results.
+	std::vector<SNodeGUID> level = { Config.RootID };
+	std::vector<SNodeGUID> nextLevel;
+	std::vector<SGraphOp> ops(Config.SeedFanOut);
+	std::vector<std::string> names(Config.SeedFanOut);
+	std::vector<uint8_t> buffer;
+	std::vector<uint8_t> payload;
+	std::vector<SNodeGUID> createdIDs;
+
+	bool bSucceeded = true;
+	for (uint32_t depth = 0; depth < Config.SeedDepth && bSucceeded; depth++)
+	{
+		nextLevel.clear();
+		for (size_t windowStart = 0; windowStart < level.size() && bSucceeded; windowStart += LOADGEN_SEED_WINDOW)
+		{
+			const size_t windowEnd = std::min(windowStart + LOADGEN_SEED_WINDOW, level.size());
+
+			buffer.clear();
+			for (size_t parentIndex = windowStart; parentIndex < windowEnd; parentIndex++)
+			{
+				for (uint32_t childIndex = 0; childIndex < Config.SeedFanOut; childIndex++)
+				{
+					char name[SNODE_NAME_MAX_LENGTH + 1];
+					names[childIndex].assign(name, snprintf(name, sizeof(name), "Seed %u.%zu.%u", depth + 1, parentIndex, childIndex));
+
+					SGraphOp& op = ops[childIndex];
+					op.Type = SGraphOpType::CREATE_NODE;
+					op.OtherID = level[parentIndex];
+					op.AccessLevel = SNodeConnectionAccessLevel::OPEN;
+					op.AccessLevelFromParent = SNodeConnectionAccessLevel::OPEN;
+					op.Name = names[childIndex];
+				}
+				SProtocolAppendSubmitTransaction(buffer, (uint32_t)parentIndex, ops.data(), ops.size());
+			}
+
+			bSucceeded = SendAll(socketDescriptor, buffer);
+			for (size_t parentIndex = windowStart; parentIndex < windowEnd && bSucceeded; parentIndex++)
+			{
+				SProtocolTransactionResult result;
+				bSucceeded = ReceiveTransactionResult(socketDescriptor, payload, result, createdIDs);
+				if (bSucceeded && result.Result.Status != SGraphTransactionStatus::APPLIED)
+				{
+					std::cerr << "Seeding failed with " << GetGraphTransactionStatusName(result.Result.Status) << ".\n";
+					bSucceeded = false;
+				}
+				nextLevel.insert(nextLevel.end(), createdIDs.begin(), createdIDs.end());
+			}
+		}
+
+		OutCreatedCount += nextLevel.size();
+		level.swap(nextLevel);
+	}
+
+	close(socketDescriptor);
+	return bSucceeded;
+}
+
+// VIEWS
+
+static void ClearSessionView(LoadGenSession& Session)
+{
+	Session.View.clear();
+	Session.ViewNodeIDs.clear();
+}
+
+static void SetSessionViewNode(LoadGenSession& Session, const SProtocolSubscriptionRecord& Record)
+{
+	auto inserted = Session.View.try_emplace(Record.NodeID);
+	LoadGenViewNode& node = inserted.first->second;
+	if (inserted.second)
+	{
+		node.Slot = Session.ViewNodeIDs.size();
+		Session.ViewNodeIDs.push_back(Record.NodeID);
+	}
+
+	node.ParentID = Record.OtherID;
+	node.Version = Record.Version;
+	node.Name.assign(Record.Name.data(), Record.Name.size());
+}
+
+static void RemoveSessionViewNode(LoadGenSession& Session, SNodeGUID NodeID)
+{
+	auto found = Session.View.find(NodeID);
+	if (found == Session.View.end())
+	{
+		return;
+	}
+
+	// The last node takes the removed one's slot.
+	const size_t slot = found->second.Slot;
+	const SNodeGUID movedID = Session.ViewNodeIDs.back();
+	Session.ViewNodeIDs[slot] = movedID;
+	Session.View[movedID].Slot = slot;
+	Session.ViewNodeIDs.pop_back();
+	Session.View.erase(found);
+}
+
+// Returns a random node of the view other than its root, or SNODE_INVALID_ID if there is none.
+static SNodeGUID PickSessionViewNode(LoadGenSession& Session)
+{
+	const size_t nodeCount = Session.ViewNodeIDs.size();
+	if (nodeCount == 0)
+	{
+		return SNODE_INVALID_ID;
+	}
+
+	size_t slot = (size_t)Session.Random.NextBelow(nodeCount);
+	if (Session.ViewNodeIDs[slot] == Session.ViewRootID)
+	{
+		if (nodeCount == 1) return SNODE_INVALID_ID;
+		slot = (slot + 1) % nodeCount;
+	}
+	return Session.ViewNodeIDs[slot];
+}
+
+// Parent of a node as the view knows it, or SNODE_INVALID_ID if the view doesn't have the node.
+static SNodeGUID GetSessionViewParent(const LoadGenSession& Session, SNodeGUID NodeID)
+{
+	const auto found = Session.View.find(NodeID);
+	return found != Session.View.end() ? found->second.ParentID : SNODE_INVALID_ID;
+}
+
+// Returns whether the view knows AncestorID to be an ancestor of NodeID. Updates may leave the view inconsistent for a while, so the walk
+// is bounded by the view's size rather than trusting it to end.
+static bool IsSessionViewAncestor(const LoadGenSession& Session, SNodeGUID AncestorID, SNodeGUID NodeID)
+{
+	SNodeGUID parentID = GetSessionViewParent(Session, NodeID);
+	for (size_t depth = 0; depth < Session.ViewNodeIDs.size() && parentID != SNODE_INVALID_ID; depth++)
+	{
+		if (parentID == AncestorID)
+		{
+			return true;
+		}
+		parentID = GetSessionViewParent(Session, parentID);
+	}
+	return false;
+}
+
+// Returns a child of NodeID the view knows of, or SNODE_INVALID_ID if there is none.
+static SNodeGUID FindSessionViewChild(const LoadGenSession& Session, SNodeGUID NodeID)
+{
+	for (const auto& entry : Session.View)
+	{
+		if (entry.second.ParentID == NodeID && entry.first != Session.ViewRootID)
+		{
+			return entry.first;
+		}
+	}
+	return SNODE_INVALID_ID;
+}
+
+// OPERATIONS
+
+// Returns an index in [0, Count[ drawn along Weights, or 0 if they're all 0.
+static size_t PickWeighted(const uint32_t* Weights, size_t Count, LoadGenRandom& Random)
+{
+	uint64_t totalWeight = 0;
+	for (size_t index = 0; index < Count; index++) totalWeight += Weights[index];
+	if (totalWeight == 0)
+	{
+		return 0;
+	}
+
+	uint64_t roll = Random.NextBelow(totalWeight);
+	for (size_t index = 0; index < Count; index++)
+	{
+		if (roll < Weights[index]) return index;
+		roll -= Weights[index];
+	}
+	return 0;
+}
+
+static void BeginSessionOp(LoadGenSession& Session, LoadGenOpType Type, uint32_t RequestID)
+{
+	Session.bOpPending = true;
+	Session.PendingOp = Type;
+	Session.PendingRequestID = RequestID;
+	Session.OpStartTime = LoadGenNow();
+}
+
+/*
+	Records the outcome of the session's pending operation, then queues the session for its next one.
+	Navigations report MISSING_NODE when the subscription ended rather than complete.
+*/
+static void CompleteSessionOp(const LoadGenState& State, LoadGenWorker& Worker, LoadGenSession& Session, SGraphTransactionStatus Status)
+{
+	const uint64_t now = LoadGenNow();
+	const size_t typeIndex = (size_t)Session.PendingOp;
+	const bool bConflicted = Status == SGraphTransactionStatus::CONFLICT;
+	const bool bFailed = Status != SGraphTransactionStatus::APPLIED && !bConflicted;
+
+	if (now >= State.MeasureStartTime)
+	{
+		Worker.Stats.Latency[typeIndex].Record(now - Session.OpStartTime);
+		Worker.Stats.Conflicts[typeIndex] += bConflicted;
+		Worker.Stats.Failures[typeIndex] += bFailed;
+
+		if (Session.PendingOp == LoadGenOpType::EDIT)
+		{
+			const size_t editIndex = (size_t)Session.PendingEdit;
+			Worker.Stats.EditCounts[editIndex]++;
+			Worker.Stats.EditConflicts[editIndex] += bConflicted;
+			Worker.Stats.EditFailures[editIndex] += bFailed;
+		}
+	}
+	Worker.CompletedOpCount.fetch_add(1, std::memory_order_relaxed);
+
+	Session.bOpPending = false;
+	Session.NextOpTime = now + (uint64_t)State.Config.ThinkTimeMs * 1000000;
+	Worker.ReadySessions.push_back(&Session);
+}
+
+static void StartNavigation(const LoadGenConfig& Config, LoadGenSession& Session, SNodeGUID RootID)
+{
+	SProtocolSubscribeRequest request;
+	request.RequestID = Session.NextRequestID++;
+	request.ViewerID = Config.RootID;
+	request.RootID = RootID;
+	request.Scope = SProtocolSubscriptionScope::SUBTREE;
+	request.Depth = Config.ViewDepth;
+	SProtocolAppendSubscribe(Session.WriteBuffer, request);
+
+	Session.SubscriptionRequestID = request.RequestID;
+	Session.ViewRootID = RootID;
+	BeginSessionOp(Session, LoadGenOpType::NAVIGATE, request.RequestID);
+}
+
+static void SubmitSessionTransaction(LoadGenWorker& Worker, LoadGenSession& Session, LoadGenOpType Type)
+{
+	const uint32_t requestID = Session.NextRequestID++;
+	SProtocolAppendSubmitTransaction(Session.WriteBuffer, requestID, Worker.Ops.data(), Worker.Ops.size());
+	BeginSessionOp(Session, Type, requestID);
+}
+
+// Appends an op requiring the node to be at the version the session knows of it, or only to exist if the view doesn't have it.
+static void AppendFetchOp(LoadGenWorker& Worker, const LoadGenSession& Session, SNodeGUID NodeID)
+{
+	const auto found = Session.View.find(NodeID);
+
+	SGraphOp op;
+	op.Type = SGraphOpType::FETCH_NODE;
+	op.NodeID = NodeID;
+	op.Version = found != Session.View.end() ? found->second.Version : 0;
+	Worker.Ops.push_back(op);
+}
+
+/*
+	Submits an edit of the given type on TargetID, a node of the view other than its root. Every node the edit changes or depends on is
+	fetched at the version the session knows of it first. Other nodes the edit involves are picked in the view, and are never the target.
+*/
+static void SubmitSessionEdit(LoadGenWorker& Worker, LoadGenSession& Session, LoadGenEditType Type, SNodeGUID TargetID)
+{
+	LoadGenRandom& random = Session.Random;
+
+	char name[SNODE_NAME_MAX_LENGTH + 1];
+	const int nameLength = snprintf(name, sizeof(name), "LoadGen %u", (uint32_t)random.NextBelow(LOADGEN_EDIT_NAME_COUNT));
+
+	SNodeGUID otherID = Session.ViewNodeIDs[random.NextBelow(Session.ViewNodeIDs.size())];
+	if (otherID == TargetID)
+	{
+		otherID = Session.ViewRootID;
+	}
+
+	Worker.Ops.clear();
+	SGraphOp op;
+	switch (Type)
+	{
+	case LoadGenEditType::RENAME:
+		op.Type = SGraphOpType::RENAME_NODE;
+		op.NodeID = TargetID;
+		op.Name = std::string_view(name, (size_t)nameLength);
+		break;
+	case LoadGenEditType::CREATE:
+		op.Type = SGraphOpType::CREATE_NODE;
+		op.OtherID = TargetID;
+		op.AccessLevel = SNodeConnectionAccessLevel::OPEN;
+		op.AccessLevelFromParent = SNodeConnectionAccessLevel::OPEN;
+		op.Name = std::string_view(name, (size_t)nameLength);
+		break;
+	case LoadGenEditType::DELETE:
+	{
+		// Only leaves may go. The walk is bounded like IsSessionViewAncestor's.
+		SNodeGUID childID = FindSessionViewChild(Session, TargetID);
+		for (size_t depth = 0; depth < Session.ViewNodeIDs.size() && childID != SNODE_INVALID_ID; depth++)
+		{
+			TargetID = childID;
+			childID = FindSessionViewChild(Session, TargetID);
+		}
+		op.Type = SGraphOpType::DELETE_NODE;
+		op.NodeID = TargetID;
+		break;
+	}
+	case LoadGenEditType::MOVE:
+		if (IsSessionViewAncestor(Session, TargetID, otherID))
+		{
+			otherID = Session.ViewRootID;
+		}
+		AppendFetchOp(Worker, Session, otherID);
+		op.Type = SGraphOpType::SET_PARENT;
+		op.NodeID = TargetID;
+		op.OtherID = otherID;
+		op.AccessLevel = SNodeConnectionAccessLevel::OPEN;
+		op.AccessLevelFromParent = SNodeConnectionAccessLevel::OPEN;
+		break;
+	case LoadGenEditType::CONNECT:
+	{
+		// Lowering parent - child connections would hide parts of the graph from every session for the rest of the run.
+		const bool bParentChild = GetSessionViewParent(Session, otherID) == TargetID || GetSessionViewParent(Session, TargetID) == otherID;
+		op.Type = SGraphOpType::SET_CONNECTION;
+		op.NodeID = TargetID;
+		op.OtherID = otherID;
+		op.AccessLevel = bParentChild ? SNodeConnectionAccessLevel::OPEN
+			: (SNodeConnectionAccessLevel)random.NextBelow((uint64_t)SNodeConnectionAccessLevel::OPEN + 1);
+		break;
+	}
+	default:
+		break;
+	}
+
+	AppendFetchOp(Worker, Session, TargetID);
+	Worker.Ops.push_back(op);
+	SubmitSessionTransaction(Worker, Session, LoadGenOpType::EDIT);
+	Session.PendingEdit = Type;
+}
+
+/*
+	Starts the session's next operation, appending its request to the write buffer. Searches complete right away.
+	While the view holds nothing but its root, sessions navigate: back up if they can, or to the same root again.
+*/
+static void StartNextSessionOp(const LoadGenState& State, LoadGenWorker& Worker, LoadGenSession& Session)
+{
+	const LoadGenConfig& config = State.Config;
+	LoadGenRandom& random = Session.Random;
+
+	const SNodeGUID targetID = PickSessionViewNode(Session);
+	const LoadGenOpType type = targetID != SNODE_INVALID_ID ? (LoadGenOpType)PickWeighted(config.OpMix, LOADGEN_OP_TYPE_COUNT, random)
+		: LoadGenOpType::NAVIGATE;
+
+	switch (type)
+	{
+	case LoadGenOpType::READ:
+	{
+		Worker.Ops.clear();
+		const uint64_t nodeCount = 1 + random.NextBelow(LOADGEN_MAX_READ_NODES);
+		for (uint64_t nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++)
+		{
+			SGraphOp op;
+			op.Type = SGraphOpType::FETCH_NODE;
+			op.NodeID = Session.ViewNodeIDs[random.NextBelow(Session.ViewNodeIDs.size())];
+			Worker.Ops.push_back(op);
+		}
+		SubmitSessionTransaction(Worker, Session, type);
+		break;
+	}
+	case LoadGenOpType::NAVIGATE:
+	{
+		SNodeGUID rootID = Session.ViewRootID;
+		if (!Session.NavigationPath.empty() && (targetID == SNODE_INVALID_ID || random.NextBelow(LOADGEN_NAVIGATE_BACK_ODDS) == 0))
+		{
+			rootID = Session.NavigationPath.back();
+			Session.NavigationPath.pop_back();
+		}
+		else if (targetID != SNODE_INVALID_ID)
+		{
+			Session.NavigationPath.push_back(Session.ViewRootID);
+			rootID = targetID;
+		}
+		StartNavigation(config, Session, rootID);
+		break;
+	}
+	case LoadGenOpType::SEARCH:
+	{
+		BeginSessionOp(Session, type, 0);
+
+		// A slice of a random name of the view, looked for in every name of the view.
+		const std::string& name = Session.View[Session.ViewNodeIDs[random.NextBelow(Session.ViewNodeIDs.size())]].Name;
+		const size_t length = std::min<size_t>(3, name.size());
+		const std::string_view text = std::string_view(name).substr(random.NextBelow(name.size() - length + 1), length);
+
+		uint64_t hitCount = 0;
+		for (const auto& entry : Session.View)
+		{
+			hitCount += entry.second.Name.find(text) != std::string::npos;
+		}
+		Worker.Stats.SearchHitCount += Worker.bMeasuring ? hitCount : 0;
+
+		CompleteSessionOp(State, Worker, Session, SGraphTransactionStatus::APPLIED);
+		break;
+	}
+	case LoadGenOpType::EDIT:
+		SubmitSessionEdit(Worker, Session, (LoadGenEditType)PickWeighted(config.EditMix, LOADGEN_EDIT_TYPE_COUNT, random), targetID);
+		break;
+	default:
+		break;
+	}
+}
+
+// FRAMES
+
+static bool ApplySessionSubscriptionUpdate(const LoadGenState& State, LoadGenWorker& Worker, LoadGenSession& Session,
+	const uint8_t* Payload, size_t PayloadSize)
+{
+	SProtocolSubscriptionUpdateReader reader;
+	if (!reader.Begin(Payload, PayloadSize))
+	{
+		return false;
+	}
+	Worker.Stats.SubscriptionUpdateCount += Worker.bMeasuring;
+
+	// Updates of subscriptions replaced since don't matter anymore.
+	if (reader.RequestID != Session.SubscriptionRequestID)
+	{
+		return true;
+	}
+
+	if (reader.Flags & SPROTOCOL_SUBSCRIPTION_SNAPSHOT)
+	{
+		ClearSessionView(Session);
+	}
+
+	SProtocolSubscriptionRecord record;
+	while (reader.Next(record))
+	{
+		if (record.Kind == SProtocolSubscriptionRecordKind::NODE) SetSessionViewNode(Session, record);
+		else if (record.Kind == SProtocolSubscriptionRecordKind::NODE_REMOVED) RemoveSessionViewNode(Session, record.NodeID);
+	}
+	if (reader.bFailed)
+	{
+		return false;
+	}
+
+	const bool bNavigating = Session.bOpPending && Session.PendingOp == LoadGenOpType::NAVIGATE && Session.PendingRequestID == reader.RequestID;
+	if (reader.Flags & SPROTOCOL_SUBSCRIPTION_ENDED)
+	{
+		// The root or the viewer went away: start over from the top.
+		ClearSessionView(Session);
+		Session.NavigationPath.clear();
+		Session.ViewRootID = State.Config.RootID;
+		if (bNavigating)
+		{
+			CompleteSessionOp(State, Worker, Session, SGraphTransactionStatus::MISSING_NODE);
+		}
+	}
+	else if (bNavigating && !(reader.Flags & SPROTOCOL_SUBSCRIPTION_PARTIAL))
+	{
+		CompleteSessionOp(State, Worker, Session, SGraphTransactionStatus::APPLIED);
+	}
+	return true;
+}
+
+static bool HandleSessionFrame(const LoadGenState& State, LoadGenWorker& Worker, LoadGenSession& Session, SProtocolMessageType Type,
+	const uint8_t* Payload, size_t PayloadSize)
+{
+	switch (Type)
+	{
+	case SProtocolMessageType::TRANSACTION_RESULT:
+	{
+		SProtocolTransactionResult result;
+		if (!SProtocolDecodeTransactionResult(Payload, PayloadSize, result, nullptr, 0))
+		{
+			return false;
+		}
+		if (Session.bOpPending && Session.PendingRequestID == result.RequestID)
+		{
+			CompleteSessionOp(State, Worker, Session, result.Result.Status);
+		}
+		return true;
+	}
+	case SProtocolMessageType::SUBSCRIPTION_UPDATE:
+		return ApplySessionSubscriptionUpdate(State, Worker, Session, Payload, PayloadSize);
+	case SProtocolMessageType::PING:
+	{
+		uint64_t value;
+		if (!SProtocolDecodePing(Payload, PayloadSize, value))
+		{
+			return false;
+		}
+		SProtocolAppendPing(Session.WriteBuffer, SProtocolMessageType::PONG, value);
+		return true;
+	}
+	case SProtocolMessageType::PONG:
+		return true;
+	default:
+		// ASSERT Servers may not send this message.
+		return false;
+	}
+}
+
+// Handles every complete frame at the front of the read buffer. Returns false on protocol errors.
+static bool ProcessSessionFrames(const LoadGenState& State, LoadGenWorker& Worker, LoadGenSession& Session)
+{
+	size_t consumedSize = 0;
+	for (;;)
+	{
+		const uint8_t* frame = Session.ReadBuffer.data() + consumedSize;
+		const size_t availableSize = Session.ReadBuffer.size() - consumedSize;
+
+		SProtocolMessageType type;
+		uint32_t payloadSize;
+		if (!SProtocolReadFrameHeader(frame, availableSize, type, payloadSize))
+		{
+			break;
+		}
+		if (payloadSize > SPROTOCOL_MAX_PAYLOAD_SIZE)
+		{
+			return false;
+		}
+		if (availableSize < SPROTOCOL_FRAME_HEADER_SIZE + payloadSize)
+		{
+			break;
+		}
+
+		if (!HandleSessionFrame(State, Worker, Session, type, frame + SPROTOCOL_FRAME_HEADER_SIZE, payloadSize))
+		{
+			return false;
+		}
+		consumedSize += SPROTOCOL_FRAME_HEADER_SIZE + payloadSize;
+	}
+
+	Session.ReadBuffer.erase(Session.ReadBuffer.begin(), Session.ReadBuffer.begin() + consumedSize);
+	return true;
+}
+
+// SOCKETS
+
+static bool SetSessionWatchedEvents(LoadGenWorker& Worker, LoadGenSession& Session, uint32_t Events)
+{
+	if (Session.WatchedEvents == Events)
+	{
+		return true;
+	}
+
+	epoll_event event = {};
+	event.events = Events;
+	event.data.ptr = &Session;
+	if (epoll_ctl(Worker.EpollDescriptor, EPOLL_CTL_MOD, Session.Socket, &event) != 0)
+	{
+		return false;
+	}
+
+	Session.WatchedEvents = Events;
+	return true;
+}
+
+// Writes are only watched while something is waiting to be sent.
+static bool UpdateSessionWatchedEvents(LoadGenWorker& Worker, LoadGenSession& Session)
+{
+	return SetSessionWatchedEvents(Worker, Session, EPOLLIN | (Session.WriteOffset < Session.WriteBuffer.size() ? (uint32_t)EPOLLOUT : 0u));
+}
+
+// Sends as much of the pending bytes as the socket takes. Returns false if the connection failed.
+static bool FlushSession(LoadGenWorker& Worker, LoadGenSession& Session)
+{
+	while (Session.WriteOffset < Session.WriteBuffer.size())
+	{
+		const ssize_t sentSize = send(Session.Socket, Session.WriteBuffer.data() + Session.WriteOffset,
+			Session.WriteBuffer.size() - Session.WriteOffset, MSG_NOSIGNAL);
+		if (sentSize < 0)
+		{
+			if (errno == EINTR) continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		Session.WriteOffset += (size_t)sentSize;
+		Worker.Stats.BytesSent += Worker.bMeasuring ? (uint64_t)sentSize : 0;
+	}
+
+	Session.WriteBuffer.clear();
+	Session.WriteOffset = 0;
+	return true;
+}
+
+// Receives everything the socket has. Returns false if the server left or the connection failed.
+static bool ReadSession(LoadGenWorker& Worker, LoadGenSession& Session)
+{
+	for (;;)
+	{
+		const size_t previousSize = Session.ReadBuffer.size();
+		Session.ReadBuffer.resize(previousSize + LOADGEN_READ_CHUNK_SIZE);
+
+		const ssize_t receivedSize = recv(Session.Socket, Session.ReadBuffer.data() + previousSize, LOADGEN_READ_CHUNK_SIZE, 0);
+		Session.ReadBuffer.resize(previousSize + (receivedSize > 0 ? (size_t)receivedSize : 0));
+
+		if (receivedSize == 0)
+		{
+			return false;
+		}
+		if (receivedSize < 0)
+		{
+			if (errno == EINTR) continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		Worker.Stats.BytesReceived += Worker.bMeasuring ? (uint64_t)receivedSize : 0;
+	}
+}
+
+// Starts connecting the session. Writability then tells the connection completed, one way or the other.
+static bool ConnectSession(LoadGenWorker& Worker, LoadGenSession& Session, const sockaddr_in& Address)
+{
+	Session.Socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (Session.Socket < 0)
+	{
+		return false;
+	}
+
+	// Requests are small and latency is what gets measured.
+	const int noDelay = 1;
+	setsockopt(Session.Socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+	epoll_event event = {};
+	event.events = EPOLLOUT;
+	event.data.ptr = &Session;
+	if ((connect(Session.Socket, (const sockaddr*)&Address, sizeof(Address)) != 0 && errno != EINPROGRESS)
+		|| epoll_ctl(Worker.EpollDescriptor, EPOLL_CTL_ADD, Session.Socket, &event) != 0)
+	{
+		close(Session.Socket);
+		Session.Socket = -1;
+		return false;
+	}
+
+	Session.WatchedEvents = event.events;
+	return true;
+}
+
+// Sessions aren't reconnected: they stay in their worker's list, socketless, until the end of the run.
+static void CloseSession(LoadGenWorker& Worker, LoadGenSession& Session)
+{
+	// Closing the socket removes it from the epoll instance.
+	close(Session.Socket);
+	Session.Socket = -1;
+
+	Worker.ConnectFailureCount += !Session.bConnected;
+	Worker.DisconnectCount += Session.bConnected;
+}
+
+// Handles readiness of a session's socket. Returns false if the session should be closed.
+static bool ServeSession(const LoadGenState& State, LoadGenWorker& Worker, LoadGenSession& Session, uint32_t Events)
+{
+	if (!Session.bConnected)
+	{
+		int error = 0;
+		socklen_t errorSize = sizeof(error);
+		if (getsockopt(Session.Socket, SOL_SOCKET, SO_ERROR, &error, &errorSize) != 0 || error != 0)
+		{
+			return false;
+		}
+
+		// Sessions start at the top of the graph.
+		Session.bConnected = true;
+		Worker.ConnectedCount++;
+		StartNavigation(State.Config, Session, State.Config.RootID);
+	}
+
+	if (Events & EPOLLERR)
+	{
+		return false;
+	}
+
+	if ((Events & (EPOLLIN | EPOLLHUP)) && !ReadSession(Worker, Session))
+	{
+		return false;
+	}
+
+	return ProcessSessionFrames(State, Worker, Session)
+		&& FlushSession(Worker, Session)
+		&& UpdateSessionWatchedEvents(Worker, Session);
+}
+
+// WORKERS
+
+/*
+	Starts the next operation of sessions done thinking, then returns how long the worker may wait for events, in milliseconds.
+	Sessions are due in the order they were queued. Searches queue their session again right away, which then waits for the next pass.
+*/
+static int StartReadySessions(const LoadGenState& State, LoadGenWorker& Worker)
+{
+	const uint64_t now = LoadGenNow();
+
+	for (size_t readyCount = Worker.ReadySessions.size(); readyCount > 0 && Worker.ReadySessions.front()->NextOpTime <= now; readyCount--)
+	{
+		LoadGenSession& session = *Worker.ReadySessions.front();
+		Worker.ReadySessions.pop_front();
+		if (session.Socket < 0)
+		{
+			continue;
+		}
+
+		StartNextSessionOp(State, Worker, session);
+		if (!FlushSession(Worker, session) || !UpdateSessionWatchedEvents(Worker, session))
+		{
+			CloseSession(Worker, session);
+		}
+	}
+
+	if (Worker.ReadySessions.empty())
+	{
+		return LOADGEN_EPOLL_TIMEOUT_MS;
+	}
+
+	const uint64_t nextOpTime = Worker.ReadySessions.front()->NextOpTime;
+	const uint64_t waitMilliseconds = nextOpTime > now ? (nextOpTime - now + 999999) / 1000000 : 0;
+	return (int)std::min<uint64_t>(waitMilliseconds, LOADGEN_EPOLL_TIMEOUT_MS);
+}
+
+static void RunLoadGenWorker(LoadGenState& State, LoadGenWorker& Worker)
+{
+	sockaddr_in address;
+	MakeServerAddress(State.Config, address);
+
+	for (std::unique_ptr<LoadGenSession>& session : Worker.Sessions)
+	{
+		if (!ConnectSession(Worker, *session, address))
+		{
+			Worker.ConnectFailureCount++;
+		}
+	}
+
+	epoll_event events[LOADGEN_EPOLL_BATCH_SIZE];
+	int timeout = LOADGEN_EPOLL_TIMEOUT_MS;
+	while (State.bRunning)
+	{
+		const int eventCount = epoll_wait(Worker.EpollDescriptor, events, LOADGEN_EPOLL_BATCH_SIZE, timeout);
+		if (eventCount < 0)
+		{
+			if (errno == EINTR) continue;
+			std::cerr << "Worker " << Worker.Index << " event loop failed with error " << errno << ".\n";
+			return;
+		}
+
+		Worker.bMeasuring = LoadGenNow() >= State.MeasureStartTime;
+		for (int eventIndex = 0; eventIndex < eventCount; eventIndex++)
+		{
+			LoadGenSession& session = *(LoadGenSession*)events[eventIndex].data.ptr;
+			if (!ServeSession(State, Worker, session, events[eventIndex].events))
+			{
+				CloseSession(Worker, session);
+			}
+		}
+
+		timeout = StartReadySessions(State, Worker);
+	}
+}
+
+uint32_t GetLoadGenWorkerCount(const LoadGenConfig& Config)
+{
+	if (Config.ThreadCount != 0)
+	{
+		return Config.ThreadCount;
+	}
+
+	const uint32_t hardwareThreadCount = std::thread::hardware_concurrency();
+	return hardwareThreadCount == 0 ? 1 : hardwareThreadCount;
+}
+
+bool StartLoadGen(LoadGenState& State)
+{
+	sockaddr_in address;
+	if (!MakeServerAddress(State.Config, address))
+	{
+		std::cerr << "Invalid server address " << State.Config.Address << ".\n";
+		return false;
+	}
+
+	// Every session takes a descriptor, which default limits run out of long before thousands of them.
+	rlimit descriptorLimit;
+	if (getrlimit(RLIMIT_NOFILE, &descriptorLimit) == 0 && descriptorLimit.rlim_cur < descriptorLimit.rlim_max)
+	{
+		descriptorLimit.rlim_cur = descriptorLimit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &descriptorLimit);
+	}
+
+	const uint32_t threadCount = GetLoadGenWorkerCount(State.Config);
+	State.Workers = std::vector<LoadGenWorker>(threadCount);
+	for (uint32_t workerIndex = 0; workerIndex < threadCount; workerIndex++)
+	{
+		LoadGenWorker& worker = State.Workers[workerIndex];
+		worker.Index = workerIndex;
+		worker.EpollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+		if (worker.EpollDescriptor < 0)
+		{
+			std::cerr << "Failed to set up worker " << workerIndex << ", error " << errno << ".\n";
+			StopLoadGen(State);
+			return false;
+		}
+	}
+
+	// Sessions are dealt to workers in turn, each with its own random sequence.
+	for (size_t sessionIndex = 0; sessionIndex < State.Config.SessionCount; sessionIndex++)
+	{
+		std::unique_ptr<LoadGenSession> session(new LoadGenSession());
+		session->Random.State = State.Config.Seed ^ ((uint64_t)sessionIndex << 32);
+		State.Workers[sessionIndex % threadCount].Sessions.push_back(std::move(session));
+	}
+
+	State.MeasureStartTime = LoadGenNow() + (uint64_t)(State.Config.WarmupSeconds * 1e9);
+	State.bRunning = true;
+	for (LoadGenWorker& worker : State.Workers)
+	{
+		worker.Thread = std::thread(RunLoadGenWorker, std::ref(State), std::ref(worker));
+	}
+	return true;
+}
+
+void StopLoadGen(LoadGenState& State)
+{
+	State.bRunning = false;
+
+	for (LoadGenWorker& worker : State.Workers)
+	{
+		if (worker.Thread.joinable())
+		{
+			worker.Thread.join();
+		}
+
+		for (std::unique_ptr<LoadGenSession>& session : worker.Sessions)
+		{
+			if (session->Socket >= 0)
+			{
+				close(session->Socket);
+				session->Socket = -1;
+			}
+		}
+
+		if (worker.EpollDescriptor >= 0)
+		{
+			close(worker.EpollDescriptor);
+			worker.EpollDescriptor = -1;
+		}
+	}
+}
+
+#else
+
+bool SeedServerGraph(const LoadGenConfig& Config, size_t& OutCreatedCount)
+{
+	std::cerr << "The Load Generator's event loop relies on epoll, which is only available on Linux.\n";
+	return false;
+}
+
+uint32_t GetLoadGenWorkerCount(const LoadGenConfig& Config)
+{
+	return 1;
+}
+
+bool StartLoadGen(LoadGenState& State)
+{
+	std::cerr << "The Load Generator's event loop relies on epoll, which is only available on Linux.\n";
+	return false;
+}
+
+void StopLoadGen(LoadGenState& State)
+{
+}
+
+#endif
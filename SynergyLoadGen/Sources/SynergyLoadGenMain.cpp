@@ -0,0 +1,234 @@
+#define TRANSLATION_UNIT SYNERGY_LOADGEN_MAIN
+
+// Load generator for the Synergy Server. Seeds the server's graph, runs simulated client sessions against it for a while, then reports
+// throughput, latency percentiles and conflict rates as JSON on standard output. Progress goes to standard error once a second.
+//
+// Usage: SynergyLoadGen [--address A] [--port N] [--sessions N] [--threads N] [--warmup S] [--duration S]
+//                       [--mix READ,NAVIGATE,SEARCH,EDIT] [--edit-mix RENAME,CREATE,DELETE,MOVE,CONNECT] [--think-ms N]
+//                       [--view-depth N] [--root ID] [--seed-fanout N] [--seed-depth N] [--seed N]
+//
+// Threads default to one per hardware thread. Mixes are relative weights of the operation types, and of the edit types among edits.
+//
+// Sessions only measure how long operations take once sent, so with --think-ms 0 they find the throughput the server saturates at,
+// and with a think time how latency holds up under a given number of users.
+
+#include "LoadGen.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <iostream>
+
+// Source includes
+#include "LoadGenHistogram_INC.cpp"
+#include "LoadGenSessions_INC.cpp"
+
+// Percentiles reported for every operation type, and their names in the report.
+constexpr double LOADGEN_REPORTED_PERCENTILES[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+constexpr const char* LOADGEN_REPORTED_PERCENTILE_NAMES[] = { "p50_ns", "p90_ns", "p99_ns", "p999_ns", "p9999_ns" };
+
+// Set by the signal handler, ends the run early.
+static volatile sig_atomic_t GStopRequested = 0;
+
+static void HandleStopSignal(int)
+{
+	GStopRequested = 1;
+}
+
+static bool ParseArguments(int argc, char** argv, LoadGenConfig& Config)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const char* arg = argv[argIndex];
+		const char* value = argIndex + 1 < argc ? argv[argIndex + 1] : nullptr;
+
+		if (value == nullptr)
+		{
+			fprintf(stderr, "Missing value for argument %s\n", arg);
+			return false;
+		}
+
+		if (strcmp(arg, "--address") == 0) Config.Address = value;
+		else if (strcmp(arg, "--port") == 0) Config.Port = (uint16_t)strtoul(value, nullptr, 0);
+		else if (strcmp(arg, "--sessions") == 0) Config.SessionCount = strtoull(value, nullptr, 0);
+		else if (strcmp(arg, "--threads") == 0) Config.ThreadCount = (uint32_t)strtoul(value, nullptr, 0);
+		else if (strcmp(arg, "--warmup") == 0) Config.WarmupSeconds = strtod(value, nullptr);
+		else if (strcmp(arg, "--duration") == 0) Config.DurationSeconds = strtod(value, nullptr);
+		else if (strcmp(arg, "--think-ms") == 0) Config.ThinkTimeMs = (uint32_t)strtoul(value, nullptr, 0);
+		else if (strcmp(arg, "--view-depth") == 0) Config.ViewDepth = (uint32_t)strtoul(value, nullptr, 0);
+		else if (strcmp(arg, "--root") == 0) Config.RootID = strtoull(value, nullptr, 0);
+		else if (strcmp(arg, "--seed-fanout") == 0) Config.SeedFanOut = (uint32_t)strtoul(value, nullptr, 0);
+		else if (strcmp(arg, "--seed-depth") == 0) Config.SeedDepth = (uint32_t)strtoul(value, nullptr, 0);
+		else if (strcmp(arg, "--seed") == 0) Config.Seed = strtoull(value, nullptr, 0);
+		else if (strcmp(arg, "--mix") == 0)
+		{
+			if (sscanf(value, "%u,%u,%u,%u", &Config.OpMix[0], &Config.OpMix[1], &Config.OpMix[2], &Config.OpMix[3]) != 4)
+			{
+				fprintf(stderr, "--mix expects 4 comma separated weights.\n");
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--edit-mix") == 0)
+		{
+			uint32_t* mix = Config.EditMix;
+			if (sscanf(value, "%u,%u,%u,%u,%u", &mix[0], &mix[1], &mix[2], &mix[3], &mix[4]) != 5)
+			{
+				fprintf(stderr, "--edit-mix expects 5 comma separated weights.\n");
+				return false;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", arg);
+			return false;
+		}
+
+		argIndex++;
+	}
+
+	if (Config.SessionCount == 0 || Config.Port == 0 || Config.DurationSeconds <= 0.0 || Config.WarmupSeconds < 0.0)
+	{
+		fprintf(stderr, "Sessions, port and duration must be positive.\n");
+		return false;
+	}
+	if (Config.SeedDepth > 0 && (Config.SeedFanOut == 0 || Config.SeedFanOut > SGRAPH_TRANSACTION_MAX_OPS))
+	{
+		fprintf(stderr, "--seed-fanout must be between 1 and %zu.\n", SGRAPH_TRANSACTION_MAX_OPS);
+		return false;
+	}
+	return true;
+}
+
+static void PrintResultsJSON(const LoadGenConfig& Config, const LoadGenState& State, const LoadGenStats& Stats, size_t SeededNodeCount,
+	double MeasuredSeconds)
+{
+	size_t connectedCount = 0;
+	size_t connectFailureCount = 0;
+	size_t disconnectCount = 0;
+	for (const LoadGenWorker& worker : State.Workers)
+	{
+		connectedCount += worker.ConnectedCount;
+		connectFailureCount += worker.ConnectFailureCount;
+		disconnectCount += worker.DisconnectCount;
+	}
+
+	uint64_t totalOpCount = 0;
+	for (const LoadGenHistogram& latency : Stats.Latency) totalOpCount += latency.TotalCount;
+
+	const LoadGenHistogram& edits = Stats.Latency[(size_t)LoadGenOpType::EDIT];
+	const uint64_t editConflictCount = Stats.Conflicts[(size_t)LoadGenOpType::EDIT];
+	const double perSecond = MeasuredSeconds > 0.0 ? 1.0 / MeasuredSeconds : 0.0;
+
+	printf("{\n");
+	printf("\t\"config\": { \"address\": \"%s\", \"port\": %u, \"sessions\": %zu, \"threads\": %zu, \"warmup_s\": %g, \"duration_s\": %g, "
+		"\"mix\": [%u, %u, %u, %u], \"editMix\": [%u, %u, %u, %u, %u], \"thinkMs\": %u, \"viewDepth\": %u, \"root\": %llu, \"seedFanout\": %u, \"seedDepth\": %u, \"seed\": %llu },\n",
+		Config.Address, Config.Port, Config.SessionCount, State.Workers.size(), Config.WarmupSeconds, Config.DurationSeconds,
+		Config.OpMix[0], Config.OpMix[1], Config.OpMix[2], Config.OpMix[3], Config.EditMix[0], Config.EditMix[1], Config.EditMix[2],
+		Config.EditMix[3], Config.EditMix[4], Config.ThinkTimeMs, Config.ViewDepth,
+		(unsigned long long)Config.RootID, Config.SeedFanOut, Config.SeedDepth, (unsigned long long)Config.Seed);
+	printf("\t\"sessions\": { \"connected\": %zu, \"connectFailures\": %zu, \"disconnects\": %zu, \"seededNodes\": %zu },\n",
+		connectedCount, connectFailureCount, disconnectCount, SeededNodeCount);
+	printf("\t\"run\": { \"measured_s\": %.3f, \"operations\": %llu, \"operationsPerSecond\": %.0f, \"subscriptionUpdates\": %llu, "
+		"\"searchHits\": %llu, \"bytesSent\": %llu, \"bytesReceived\": %llu },\n",
+		MeasuredSeconds, (unsigned long long)totalOpCount, totalOpCount * perSecond, (unsigned long long)Stats.SubscriptionUpdateCount,
+		(unsigned long long)Stats.SearchHitCount, (unsigned long long)Stats.BytesSent, (unsigned long long)Stats.BytesReceived);
+	printf("\t\"edits\": { \"count\": %llu, \"conflicts\": %llu, \"conflictRate\": %.4f, \"types\": [",
+		(unsigned long long)edits.TotalCount, (unsigned long long)editConflictCount,
+		edits.TotalCount > 0 ? (double)editConflictCount / (double)edits.TotalCount : 0.0);
+	for (size_t editIndex = 0; editIndex < LOADGEN_EDIT_TYPE_COUNT; editIndex++)
+	{
+		printf(" { \"name\": \"%s\", \"count\": %llu, \"conflicts\": %llu, \"failures\": %llu }%s",
+			GetLoadGenEditTypeName((LoadGenEditType)editIndex), (unsigned long long)Stats.EditCounts[editIndex],
+			(unsigned long long)Stats.EditConflicts[editIndex], (unsigned long long)Stats.EditFailures[editIndex],
+			editIndex + 1 < LOADGEN_EDIT_TYPE_COUNT ? "," : "");
+	}
+	printf(" ] },\n");
+	printf("\t\"operations\": [\n");
+
+	for (size_t typeIndex = 0; typeIndex < LOADGEN_OP_TYPE_COUNT; typeIndex++)
+	{
+		const LoadGenHistogram& latency = Stats.Latency[typeIndex];
+
+		printf("\t\t{ \"name\": \"%s\", \"count\": %llu, \"perSecond\": %.0f, \"conflicts\": %llu, \"failures\": %llu, ",
+			GetLoadGenOpTypeName((LoadGenOpType)typeIndex), (unsigned long long)latency.TotalCount, latency.TotalCount * perSecond,
+			(unsigned long long)Stats.Conflicts[typeIndex], (unsigned long long)Stats.Failures[typeIndex]);
+		for (size_t percentileIndex = 0; percentileIndex < sizeof(LOADGEN_REPORTED_PERCENTILES) / sizeof(double); percentileIndex++)
+		{
+			printf("\"%s\": %llu, ", LOADGEN_REPORTED_PERCENTILE_NAMES[percentileIndex],
+				(unsigned long long)latency.GetValueAtPercentile(LOADGEN_REPORTED_PERCENTILES[percentileIndex]));
+		}
+		printf("\"mean_ns\": %llu, \"max_ns\": %llu }%s\n", (unsigned long long)latency.GetMean(), (unsigned long long)latency.MaxValue,
+			typeIndex + 1 < LOADGEN_OP_TYPE_COUNT ? "," : "");
+	}
+
+	printf("\t]\n");
+	printf("}\n");
+}
+
+int main(int argc, char** argv)
+{
+	LoadGenState* state = new LoadGenState();
+	if (!ParseArguments(argc, argv, state->Config))
+	{
+		return 1;
+	}
+	const LoadGenConfig& config = state->Config;
+
+	signal(SIGINT, HandleStopSignal);
+	signal(SIGTERM, HandleStopSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	size_t seededNodeCount = 0;
+	const uint64_t seedStart = LoadGenNow();
+	if (config.SeedDepth > 0 && !SeedServerGraph(config, seededNodeCount))
+	{
+		fprintf(stderr, "Failed to seed the server's graph.\n");
+		return 1;
+	}
+	fprintf(stderr, "Seeded %zu nodes in %.2f ms.\n", seededNodeCount, (LoadGenNow() - seedStart) / 1e6);
+
+	if (!StartLoadGen(*state))
+	{
+		return 1;
+	}
+
+	const uint64_t runStart = LoadGenNow();
+	const uint64_t runEnd = state->MeasureStartTime + (uint64_t)(config.DurationSeconds * 1e9);
+	fprintf(stderr, "Running %zu sessions on %zu threads.\n", config.SessionCount, state->Workers.size());
+
+	// Progress line once a second, until the run is over or a stop signal comes in.
+	uint64_t lastReportTime = runStart;
+	uint64_t lastCompletedCount = 0;
+	while (!GStopRequested && LoadGenNow() < runEnd)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		const uint64_t now = LoadGenNow();
+		if (now - lastReportTime >= 1000000000ull)
+		{
+			uint64_t completedCount = 0;
+			for (const LoadGenWorker& worker : state->Workers) completedCount += worker.CompletedOpCount.load(std::memory_order_relaxed);
+
+			fprintf(stderr, "[%6.1fs] %.0f ops/s%s\n", (now - runStart) / 1e9, (completedCount - lastCompletedCount) * 1e9 / (now - lastReportTime),
+				now < state->MeasureStartTime ? " (warmup)" : "");
+			lastReportTime = now;
+			lastCompletedCount = completedCount;
+		}
+	}
+
+	const uint64_t stopTime = LoadGenNow();
+	StopLoadGen(*state);
+
+	LoadGenStats* stats = new LoadGenStats();
+	for (const LoadGenWorker& worker : state->Workers) stats->Add(worker.Stats);
+
+	const double measuredSeconds = stopTime > state->MeasureStartTime ? (stopTime - state->MeasureStartTime) / 1e9 : 0.0;
+	PrintResultsJSON(config, *state, *stats, seededNodeCount, measuredSeconds);
+
+	delete stats;
+	delete state;
+	return 0;
+}
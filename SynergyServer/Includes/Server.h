@@ -0,0 +1,841 @@
+// Contains symbols that are shared and implemented over multiple files in the Server code.
+// Can only be included in the main Server Translation Unit.
+
+#if (TRANSLATION_UNIT != SYNERGY_SERVER_MAIN)
+static_assert(0, "Server.h can only be included inside the SYNERGY_SERVER_MAIN translation unit ! Found it with " __BASE_FILE__);
+#endif
+
+#ifndef SERVER_INCLUDED
+#define SERVER_INCLUDED
+
+#include "SynergyCore.h"
+#include "Graph/SynergyGraphStore.h"
+#include "Graph/SynergyGraphTransaction.h"
+#include "Graph/SynergyGraphChangeStream.h"
+#include "Net/SynergyProtocol.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// The server is the authority on the graph: clients submit transactions, the server validates and applies them and answers with the
+// outcome. Sessions are spread over a few worker threads, each running its own non-blocking epoll event loop. The graph is split into
+// shards so that transactions touching different parts of it can be applied in parallel.
+
+enum class ServerStorageBackend : uint8_t
+{
+	AUTO, // io_uring when the kernel allows it, the thread pool otherwise.
+	IO_URING,
+	THREAD_POOL,
+};
+
+struct ServerConfig
+{
+	uint16_t Port = SPROTOCOL_DEFAULT_PORT;
+	// Only listen on the loopback interface.
+	bool bLoopbackOnly = true;
+
+	// Number of worker threads running event loops. 0 picks one per hardware thread, up to 4.
+	uint32_t ThreadCount = 0;
+
+	// Sessions accepted past this count are closed right away.
+	size_t MaxSessionCount = 16384;
+
+	// Totals across all shards, which each get an even share.
+	size_t MaxNodeCount = 1 << 20;
+	size_t MaxConnectionCount = 4 << 20;
+
+	// Number of graph shards, up to SERVER_MAX_SHARD_COUNT. 0 uses one per worker thread.
+	uint32_t ShardCount = 1;
+
+	// Optional bulk file seeding the graph. An empty graph only gets a root node otherwise.
+	const char* BulkFilePath = nullptr;
+
+	// Port serving metrics to Prometheus scrapers, on the loopback interface only. 0 doesn't serve them.
+	uint16_t MetricsPort = 0;
+
+	// Directory the graph is persisted to, see ServerPersistence_INC.cpp. Without one the graph only lives in memory.
+	// A directory holding a snapshot restores the graph from it, and the bulk file is ignored.
+	const char* DataDirectory = nullptr;
+
+	// Whether journal writes are flushed to the device before transactions are answered. Without it they only reach the OS.
+	bool bSyncJournal = true;
+
+	// Journal bytes written between two snapshots.
+	size_t SnapshotJournalSize = 256 << 20;
+
+	ServerStorageBackend StorageBackend = ServerStorageBackend::AUTO;
+};
+
+
+constexpr uint32_t SERVER_MAX_SHARD_COUNT = 64;
+
+// Set of shards, one bit per shard index.
+typedef uint64_t ServerShardMask;
+
+// Connection between a node of a shard and a node of another shard. Both shards keep a copy, from their own node's point of view.
+struct ServerRemoteConnection
+{
+	SNodeGUID PartnerID = SNODE_INVALID_ID;
+	SNodeConnectionAccessLevel AccessLevel = SNodeConnectionAccessLevel::NONE;
+	// Whether the connection goes from this shard's node to the partner.
+	bool bOutgoing = false;
+};
+
+// Links of a node with nodes living in other shards, which its shard's store can't hold.
+struct ServerRemoteLinks
+{
+	SNodeGUID ParentID = SNODE_INVALID_ID;
+	uint32_t ChildCount = 0;
+	std::vector<ServerRemoteConnection> Connections;
+};
+
+/*
+	Part of the authoritative graph, owning a subset of its nodes. See ServerShards_INC.cpp for how nodes are placed.
+	Everything in it is only accessed under its lock.
+*/
+struct ServerShard
+{
+	std::mutex Lock;
+	uint32_t Index = 0;
+
+	uint8_t* Memory = nullptr;
+
+	// Stack allocator over Memory, which the store and the journal take everything they need from up front.
+	MemoryAllocator Allocator;
+
+	// Nodes of the shard, under their local IDs.
+	SGraphStore Store;
+
+	// Changes to the shard's nodes, in global IDs. Names in the changes are handles to the shard store's name pool.
+	SGraphChangeStream Journal;
+
+	// Cross-shard links, by local ID. Only nodes having some are present.
+	std::unordered_map<SNodeGUID, ServerRemoteLinks> RemoteLinks;
+};
+
+// Node IDs sharing their high bits are grouped, and each group stores their low SERVER_NODE_BITMAP_LOW_BITS bits.
+constexpr uint32_t SERVER_NODE_BITMAP_LOW_BITS = 16;
+constexpr size_t SERVER_NODE_BITMAP_WORD_COUNT = ((size_t)1 << SERVER_NODE_BITMAP_LOW_BITS) / 64;
+
+// Groups holding more values than this switch from a sorted array to a bitmap, which then takes less room.
+constexpr size_t SERVER_NODE_BITMAP_MAX_ARRAY_SIZE = 4096;
+
+struct ServerNodeBitmapContainer
+{
+	// High bits of the IDs in the group.
+	uint64_t Key = 0;
+	uint32_t Count = 0;
+
+	// Low bits of the IDs, sorted, while there are at most SERVER_NODE_BITMAP_MAX_ARRAY_SIZE of them. A bitmap of all of them afterwards.
+	std::vector<uint16_t> Values;
+	std::vector<uint64_t> Words;
+};
+
+/*
+	Compressed set of node IDs, in the manner of roaring bitmaps. Sparse groups of IDs cost two bytes per ID, dense ones a bit per ID,
+	and membership is a binary search among groups followed by a binary search or a bit test. See ServerVisibility_INC.cpp.
+*/
+struct ServerNodeBitmap
+{
+	// By increasing key.
+	std::vector<ServerNodeBitmapContainer> Containers;
+	size_t Count = 0;
+
+	bool Contains(SNodeGUID NodeID) const;
+
+	// Returns whether the ID wasn't in the set yet.
+	bool Insert(SNodeGUID NodeID);
+
+	size_t GetMemorySize() const;
+};
+
+/*
+	What a viewer node may see of the graph, see ServerSubscriptions_INC.cpp for the rules. Immutable once computed, so subscriptions can
+	keep using the rights they computed their view with while the cache moves on.
+*/
+struct ServerViewerRights
+{
+	SNodeGUID ViewerID = SNODE_INVALID_ID;
+
+	// Nodes the viewer has access to, and nodes it sees, those it has access to included. The latter also are every node the walk
+	// computing them went through.
+	ServerNodeBitmap Accessible;
+	ServerNodeBitmap Visible;
+};
+
+// Most viewers the visibility cache holds rights for. The least recently used ones go first.
+constexpr size_t SERVER_VISIBILITY_CACHE_MAX_VIEWERS = 4096;
+
+struct ServerVisibilityCacheEntry
+{
+	std::shared_ptr<const ServerViewerRights> Rights;
+
+	// Position in each shard's journal the rights are up to date with.
+	std::vector<SGraphChangeCursor> Cursors;
+
+	uint64_t LastUse = 0;
+	size_t MemorySize = 0;
+};
+
+/*
+	Rights of recently seen viewers, so that subscriptions of the same viewer don't walk the graph again for each of them.
+	Entries are checked against the shards' journals when used, and dropped once a change reached the connections their walk went through.
+	Only accessed with every shard held.
+*/
+struct ServerVisibilityCache
+{
+	std::unordered_map<SNodeGUID, ServerVisibilityCacheEntry> Entries;
+	uint64_t UseCount = 0;
+
+	// Read by the status line without holding anything.
+	std::atomic<uint64_t> HitCount { 0 };
+	std::atomic<uint64_t> MissCount { 0 };
+	std::atomic<uint64_t> InvalidationCount { 0 };
+
+	// Bytes taken by the rights of every entry.
+	std::atomic<size_t> MemorySize { 0 };
+};
+
+/*
+	The authoritative graph, split into shards. Node IDs are global: a node's shard is its ID modulo the shard count, and the rest
+	is its ID in the shard's store.
+*/
+struct ServerPersistence;
+
+struct ServerGraph
+{
+	uint32_t ShardCount = 0;
+	std::unique_ptr<ServerShard[]> Shards;
+
+	// Fixed once created, as the root can't be deleted or moved.
+	std::atomic<SNodeGUID> RootID { SNODE_INVALID_ID };
+
+	// Spreads subtrees created under the root over the shards.
+	std::atomic<uint32_t> NextPlacementShard { 0 };
+
+	// Sequence number of the last transaction that changed the graph, whichever shards it touched.
+	std::atomic<uint64_t> TransactionSequence { 0 };
+
+	ServerVisibilityCache VisibilityCache;
+
+	// Where applied transactions are journaled, if the graph is persisted.
+	ServerPersistence* Persistence = nullptr;
+};
+
+/*
+	Scratch state for applying transactions to the sharded graph. Keep one per thread so its buffers are only allocated once.
+*/
+struct ServerShardTransaction
+{
+	// Undo log and created node IDs, in global IDs.
+	SGraphTransactionContext Context;
+
+	// Shard each node created by the transaction goes to, decided before applying it.
+	std::vector<uint32_t> CreatedShards;
+
+	// Shards the transaction holds, and those it found it needs on top of them.
+	ServerShardMask LockedShards = 0;
+	ServerShardMask MissingShards = 0;
+
+	// Journal record of the committed changes, built before taking the journal's lock.
+	std::vector<uint8_t> JournalRecord;
+};
+
+struct ServerSession;
+
+// Highest number of transactions committed as a single batch.
+constexpr size_t SERVER_MAX_BATCH_TRANSACTIONS = 64;
+
+/*
+	Transactions received together, to be committed as a batch. See ServerShards_INC.cpp.
+	Entries past Count are kept around so that readers only allocate their name tables once.
+*/
+struct ServerTransactionBatch
+{
+	size_t Count = 0;
+
+	// Transactions, decoded in place from their sessions' read buffers, and the sessions to answer.
+	std::vector<SProtocolTransactionReader> Readers;
+	std::vector<ServerSession*> Sessions;
+
+	// Shard each node created by a transaction goes to, decided before applying the batch.
+	std::vector<std::vector<uint32_t>> CreatedShards;
+
+	// Outcome of each transaction. Those created by transaction N are CreatedIDs[CreatedOffsets[N]] to CreatedIDs[CreatedOffsets[N + 1]].
+	std::vector<SGraphTransactionResult> Results;
+	std::vector<SNodeGUID> CreatedIDs;
+	std::vector<size_t> CreatedOffsets;
+};
+
+// Connection between two nodes, as a hash map key.
+struct ServerConnectionKey
+{
+	SNodeGUID Src = SNODE_INVALID_ID;
+	SNodeGUID Dest = SNODE_INVALID_ID;
+
+	bool operator==(const ServerConnectionKey& Other) const { return Src == Other.Src && Dest == Other.Dest; }
+};
+
+struct ServerConnectionKeyHash
+{
+	size_t operator()(const ServerConnectionKey& Key) const { return std::hash<SNodeGUID>()(Key.Src * 0x9E3779B97F4A7C15ull ^ Key.Dest); }
+};
+
+// A node as the subscribed client holds it, or as the subscription's view last read it from its shard.
+struct ServerSubscribedNode
+{
+	SNodeGUID ParentID = SNODE_INVALID_ID;
+	uint64_t Version = 0;
+	std::string Name;
+};
+
+struct ServerViewConnection
+{
+	ServerConnectionKey Key;
+	SNodeConnectionAccessLevel AccessLevel = SNodeConnectionAccessLevel::NONE;
+};
+
+/*
+	A session's subscription to part of the graph. See ServerSubscriptions_INC.cpp.
+	The server keeps both the current view and what the client holds of it, and only ever sends the difference. Changes that cancel each
+	other out or that a client fell behind on coalesce on their own, whatever happened between two updates.
+*/
+struct ServerSubscription
+{
+	SProtocolSubscribeRequest Request;
+	uint64_t UpdateSequence = 0;
+
+	// Position in each shard's journal.
+	std::vector<SGraphChangeCursor> Cursors;
+
+	// Nodes in scope, whose changes may alter the view.
+	std::unordered_set<SNodeGUID> Dependencies;
+
+	// Rights of the viewer the view was computed with. Changes that may alter them alter the view too.
+	std::shared_ptr<const ServerViewerRights> Rights;
+
+	// Set when the view must be computed again, and while the client's copy differs from it.
+	bool bStale = true;
+	bool bBehind = true;
+	bool bSnapshotSent = false;
+
+	// Current view: its nodes parents first, each with the parent it has in the view, and the connections between them.
+	// Names and versions are copies, so updates are written without holding any shard.
+	std::vector<SNodeGUID> ViewOrder;
+	std::unordered_map<SNodeGUID, ServerSubscribedNode> ViewNodes;
+	std::vector<ServerViewConnection> ViewConnections;
+
+	// Nodes of the view that changed without altering what is in it, to be read again from their shards only.
+	std::unordered_set<SNodeGUID> DirtyNodes;
+
+	// What the client holds.
+	std::unordered_map<SNodeGUID, ServerSubscribedNode> ClientNodes;
+	std::unordered_map<ServerConnectionKey, SNodeConnectionAccessLevel, ServerConnectionKeyHash> ClientConnections;
+
+	// Token bucket for the bandwidth budget, in bytes. Updates are only sent while it isn't empty.
+	int64_t BudgetBytes = 0;
+	std::chrono::steady_clock::time_point LastRefillTime;
+};
+
+/*
+	State of one client connection. Owned by the worker whose event loop accepted it.
+*/
+struct ServerSession
+{
+	int Socket = -1;
+
+	// Position in its worker's session list.
+	size_t WorkerSlot = 0;
+
+	// Bytes received and not yet processed. Complete frames are consumed from the front.
+	std::vector<uint8_t> ReadBuffer;
+
+	// Bytes waiting to be sent. Everything before WriteOffset was sent already.
+	std::vector<uint8_t> WriteBuffer;
+	size_t WriteOffset = 0;
+
+	// Events the worker's epoll instance currently watches the socket for.
+	uint32_t WatchedEvents = 0;
+
+	// Set while the session waits for its worker's transaction batch to be committed. Its first BatchedSize bytes are the frames of
+	// its transactions in the batch, and nothing after them is processed until they are answered. Nor read, its socket isn't watched
+	// for input meanwhile.
+	bool bAwaitingBatch = false;
+	size_t BatchedSize = 0;
+
+	// TRANSACTION_RESULT frames held until the transactions they answer are durable. The session waits for its batch until then.
+	std::vector<uint8_t> PendingResults;
+
+	// Only set while the client is subscribed.
+	std::unique_ptr<ServerSubscription> Subscription;
+};
+
+// Latency histograms count durations by powers of two microseconds: bucket N those of at most 2^N us, the last one all the others.
+constexpr size_t SERVER_LATENCY_BUCKET_COUNT = 24;
+
+/*
+	Metric written by a single thread and read by any. Writes are a plain load and store rather than a locked read-modify-write, which
+	is enough as no other thread ever writes it, and costs the same as on a plain integer.
+*/
+struct ServerMetric
+{
+	std::atomic<uint64_t> Value { 0 };
+
+	void Add(uint64_t Amount) { Value.store(Value.load(std::memory_order_relaxed) + Amount, std::memory_order_relaxed); }
+	void Set(uint64_t NewValue) { Value.store(NewValue, std::memory_order_relaxed); }
+	uint64_t Get() const { return Value.load(std::memory_order_relaxed); }
+};
+
+// Distribution of durations, written by a single thread.
+struct ServerLatencyHistogram
+{
+	ServerMetric Buckets[SERVER_LATENCY_BUCKET_COUNT];
+	ServerMetric Count;
+	ServerMetric SumNanoseconds;
+
+	void Record(uint64_t Nanoseconds);
+};
+
+/*
+	What a worker measured, only written by its thread. Metrics of all workers are summed when asked for, see ServerMetrics_INC.cpp.
+	Kept on its own cache lines so that readers don't slow down the worker.
+*/
+struct alignas(64) ServerWorkerMetrics
+{
+	ServerMetric AcceptedSessionCount;
+	ServerMetric RefusedSessionCount;
+	ServerMetric ClosedSessionCount;
+
+	ServerMetric ReceivedByteCount;
+	ServerMetric SentByteCount;
+
+	// Committed transactions by outcome, indexed by SGraphTransactionStatus.
+	ServerMetric TransactionCounts[(size_t)SGraphTransactionStatus::COUNT];
+	ServerMetric BatchCount;
+
+	// Time taken to apply each batch, waits on shard locks included.
+	ServerLatencyHistogram BatchApplyLatency;
+
+	// Subscription updates sent and their size, and time taken by syncs that had to look at the graph.
+	ServerMetric SubscriptionUpdateCount;
+	ServerMetric SubscriptionUpdateByteCount;
+	ServerLatencyHistogram SubscriptionSyncLatency;
+
+	// Capacity of the worker's session buffers, refreshed every SERVER_METRICS_GAUGE_INTERVAL_MS.
+	ServerMetric SessionBufferSize;
+};
+
+// How often workers refresh the metrics they have to walk their sessions for.
+constexpr int SERVER_METRICS_GAUGE_INTERVAL_MS = 1000;
+
+// Most requests the storage layer has in flight. Submitting more fails until some complete.
+constexpr uint32_t SERVER_STORAGE_QUEUE_DEPTH = 64;
+
+// Threads running requests when io_uring isn't available.
+constexpr uint32_t SERVER_STORAGE_THREAD_COUNT = 2;
+
+/*
+	Asynchronous write to a file: Size bytes at Offset, then a flush of the file's data to the device if bSync is set.
+	A request without data only flushes.
+*/
+struct ServerStorageRequest
+{
+	int FileDescriptor = -1;
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+	uint64_t Offset = 0;
+
+	// Index of the registered buffer holding Data, -1 if it isn't in one.
+	int32_t BufferIndex = -1;
+
+	bool bSync = false;
+
+	// Handed back with the completion.
+	uint64_t Tag = 0;
+};
+
+struct ServerStorageCompletion
+{
+	uint64_t Tag = 0;
+
+	// 0 once every byte was written and flushed if asked, -errno otherwise.
+	int Result = 0;
+};
+
+// A request in flight, and how far it got. Short writes are carried on until every byte is written.
+struct ServerStorageSlot
+{
+	ServerStorageRequest Request;
+	size_t WrittenSize = 0;
+	bool bSynced = false;
+	int Result = 0;
+
+	// io_uring entries submitted for it and not completed yet.
+	uint32_t PendingEntryCount = 0;
+};
+
+/*
+	Asynchronous storage layer, see ServerStorage_INC.cpp. Requests go to io_uring, or to a small thread pool running blocking calls
+	when io_uring isn't available. Either way submitting never waits on the device, and completions are signaled on an eventfd.
+	Every function may be called from any thread.
+*/
+struct ServerStorage
+{
+	ServerStorageBackend Backend = ServerStorageBackend::AUTO;
+
+	// Readable while completions wait to be reaped.
+	int CompletionEventDescriptor = -1;
+
+	// Guards everything below.
+	std::mutex Lock;
+
+	std::vector<ServerStorageSlot> Slots;
+	std::vector<uint32_t> FreeSlots;
+
+	// io_uring's rings, shared with the kernel. The completion ring may be mapped along with the submission ring.
+	int RingDescriptor = -1;
+	void* SubmissionRing = nullptr;
+	size_t SubmissionRingSize = 0;
+	void* CompletionRing = nullptr;
+	size_t CompletionRingSize = 0;
+	void* SubmissionEntries = nullptr;
+	size_t SubmissionEntriesSize = 0;
+	uint32_t* SubmissionHead = nullptr;
+	uint32_t* SubmissionTail = nullptr;
+	uint32_t* SubmissionArray = nullptr;
+	uint32_t SubmissionMask = 0;
+	uint32_t* CompletionHead = nullptr;
+	uint32_t* CompletionTail = nullptr;
+	void* CompletionEntries = nullptr;
+	uint32_t CompletionMask = 0;
+	bool bBuffersRegistered = false;
+
+	// Entries written to the submission ring and not handed to the kernel yet.
+	uint32_t UnsubmittedEntryCount = 0;
+
+	// Thread pool: slots waiting for a thread, and slots done.
+	std::vector<std::thread> Threads;
+	std::condition_variable QueueSignal;
+	std::deque<uint32_t> QueuedSlots;
+	std::vector<uint32_t> CompletedSlots;
+	bool bStopping = false;
+};
+
+// Journal bytes are gathered in one of two registered buffers while the other one is being written.
+constexpr size_t SERVER_JOURNAL_BUFFER_SIZE = 2 << 20;
+
+// Journal files past this size are closed, and the next flush goes to a new file.
+constexpr uint64_t SERVER_JOURNAL_FILE_SIZE = 64 << 20;
+
+struct ServerJournalBuffer
+{
+	uint8_t* Data = nullptr;
+	size_t Size = 0;
+
+	// Sequence of the last transaction whose record ends in the buffer, 0 if none does.
+	uint64_t LastSequence = 0;
+
+	// Whether a record starting in the buffer goes on in the next one.
+	bool bEndsInRecord = false;
+};
+
+struct ServerJournalFile
+{
+	uint64_t Index = 0;
+	int Descriptor = -1;
+	uint64_t Size = 0;
+
+	// Sequence of the last transaction journaled in the file, 0 if none is.
+	uint64_t LastSequence = 0;
+};
+
+// A worker waiting for transactions to be durable: it is woken through the eventfd once the awaited sequence is.
+struct ServerDurabilityWaiter
+{
+	int EventDescriptor = -1;
+	const std::atomic<uint64_t>* AwaitedSequence = nullptr;
+};
+
+/*
+	Persistence of the graph: a journal of the changes of every committed transaction, and snapshots of the whole graph taken every so
+	often so that the journal can be trimmed. See ServerPersistence_INC.cpp.
+*/
+struct ServerPersistence
+{
+	std::string Directory;
+	bool bSync = true;
+	size_t SnapshotJournalSize = 0;
+
+	ServerGraph* Graph = nullptr;
+	ServerStorage Storage;
+
+	// Taken for a whole append, so that records reach the journal whole and in sequence order.
+	std::mutex AppendLock;
+
+	// Guards the journal's buffers and files.
+	std::mutex Lock;
+	std::condition_variable BufferFlushed;
+
+	ServerJournalBuffer Buffers[2];
+	uint32_t FillingBuffer = 0;
+
+	// Whether a buffer is being written, the other one then fills up. Its records are durable up to FlushSequence once written.
+	bool bFlushInFlight = false;
+	uint64_t FlushSequence = 0;
+	std::chrono::steady_clock::time_point FlushStartTime;
+
+	// File flushes go to, files closed since the last snapshot, and the file opened ahead for when it is full.
+	// Files only change at record boundaries, so that each holds whole records.
+	ServerJournalFile ActiveFile;
+	std::vector<ServerJournalFile> ClosedFiles;
+	ServerJournalFile NextFile;
+	bool bActiveFileEndsInRecord = false;
+	uint64_t BytesSinceSnapshot = 0;
+
+	// Snapshot being written by the persistence thread: its serialized graph, and how far its writes got.
+	std::vector<uint8_t> SnapshotData;
+	int SnapshotDescriptor = -1;
+	uint64_t SnapshotSequence = 0;
+	size_t SnapshotSubmittedSize = 0;
+	uint32_t SnapshotPendingCount = 0;
+	bool bSnapshotSyncing = false;
+	bool bSnapshotFailed = false;
+
+	// Sequence up to which every transaction is durable.
+	std::atomic<uint64_t> DurableSequence { 0 };
+
+	std::mutex WaiterLock;
+	std::vector<ServerDurabilityWaiter> Waiters;
+
+	// Runs completions and snapshots.
+	std::thread Thread;
+	std::atomic<bool> bRunning { false };
+
+	// Written by the persistence thread only, but for BackpressureWaitCount which appenders write under AppendLock.
+	ServerLatencyHistogram JournalFlushLatency;
+	ServerMetric JournalFlushCount;
+	ServerMetric JournalByteCount;
+	ServerMetric BackpressureWaitCount;
+	ServerLatencyHistogram SnapshotPauseLatency;
+	ServerMetric SnapshotCount;
+	ServerMetric SnapshotByteCount;
+};
+
+// Sessions waiting for their transactions, committed up to the sequence, to be durable before being answered.
+struct ServerDurabilityWait
+{
+	uint64_t Sequence = 0;
+	std::vector<ServerSession*> Sessions;
+};
+
+struct ServerWorker
+{
+	uint32_t Index = 0;
+	int EpollDescriptor = -1;
+	std::thread Thread;
+
+	std::vector<ServerSession*> Sessions;
+
+	// Scratch reused by every transaction this worker handles.
+	ServerShardTransaction Transaction;
+
+	// Transactions received since the batch was last committed, and the sessions waiting for it.
+	ServerTransactionBatch Batch;
+	std::vector<ServerSession*> BatchSessions;
+
+	// Number of its sessions having a subscription, and when they were last brought up to date.
+	size_t SubscriptionCount = 0;
+	std::chrono::steady_clock::time_point LastSubscriptionSyncTime;
+
+	ServerWorkerMetrics Metrics;
+	std::chrono::steady_clock::time_point LastMetricsGaugeTime;
+
+	// Committed batches waiting to be durable, oldest first, and the sequence the first one waits for, 0 without any.
+	// The persistence thread signals the eventfd once that sequence is durable.
+	std::deque<ServerDurabilityWait> DurabilityWaits;
+	std::atomic<uint64_t> AwaitedSequence { 0 };
+	int DurabilityEventDescriptor = -1;
+};
+
+struct ServerState
+{
+	ServerConfig Config;
+
+	int ListenSocket = -1;
+	int MetricsListenSocket = -1;
+
+	ServerGraph Graph;
+	std::unique_ptr<ServerPersistence> Persistence;
+
+	std::vector<ServerWorker> Workers;
+
+	// Cleared to ask workers to stop.
+	std::atomic<bool> bRunning { false };
+
+	// Number of live sessions across all workers.
+	std::atomic<size_t> SessionCount { 0 };
+	std::atomic<uint64_t> TotalSessionCount { 0 };
+};
+
+// Latency histogram summed over workers.
+struct ServerLatencySummary
+{
+	uint64_t Buckets[SERVER_LATENCY_BUCKET_COUNT] = {};
+	uint64_t Count = 0;
+	uint64_t SumNanoseconds = 0;
+};
+
+// Metrics of every worker, summed.
+struct ServerMetricsSummary
+{
+	uint64_t AcceptedSessionCount = 0;
+	uint64_t RefusedSessionCount = 0;
+	uint64_t ClosedSessionCount = 0;
+	uint64_t ReceivedByteCount = 0;
+	uint64_t SentByteCount = 0;
+	uint64_t TransactionCounts[(size_t)SGraphTransactionStatus::COUNT] = {};
+	uint64_t BatchCount = 0;
+	ServerLatencySummary BatchApplyLatency;
+	uint64_t SubscriptionUpdateCount = 0;
+	uint64_t SubscriptionUpdateByteCount = 0;
+	ServerLatencySummary SubscriptionSyncLatency;
+	uint64_t SessionBufferSize = 0;
+};
+
+// MAJOR PROCEDURES
+
+/*
+	Allocates the authoritative graph's shards and seeds it, either from the configured bulk file or with a lone root node.
+	Returns whether the graph is ready.
+*/
+bool InitializeServerGraph(ServerGraph& Graph, const ServerConfig& Config);
+
+// Frees the graph's memory.
+void ShutdownServerGraph(ServerGraph& Graph);
+
+/*
+	Validates and applies the batch's transactions to the sharded graph in order, each one entirely or not at all against the graph as
+	left by those before it. Only the shards the transactions touch are locked, so batches on different shards run in parallel.
+	Results and created node IDs are written to the batch.
+*/
+void ApplyShardedTransactionBatch(ServerGraph& Graph, ServerTransactionBatch& Batch, ServerShardTransaction& Transaction);
+
+/*
+	Returns the rights of the viewer, which must exist, from the visibility cache if no change may have altered them since they were
+	computed. Every shard must be held.
+*/
+std::shared_ptr<const ServerViewerRights> GetServerViewerRights(ServerGraph& Graph, SNodeGUID ViewerID);
+
+// Whether the change may alter the passed rights: it touches connections leaving a node their walk went through.
+bool DoesChangeAffectViewerRights(const ServerViewerRights& Rights, const SGraphChange& Change);
+
+/*
+	Copies a graph into the sharded graph, which must be empty, placing each subtree under the root in a shard as a whole.
+	Nodes get new IDs. Returns false if a shard runs out of capacity.
+*/
+bool DistributeGraph(ServerGraph& Graph, const SGraphStore& Source, SNodeGUID SourceRootID);
+
+// Total number of nodes across shards.
+size_t GetServerGraphNodeCount(ServerGraph& Graph);
+
+// Number of worker threads the configuration asks for.
+uint32_t GetServerWorkerCount(const ServerConfig& Config);
+
+/*
+	Adds a submitted transaction payload to the worker's batch. The payload must stay put until the batch is committed.
+	Returns false if the payload's header is malformed, in which case the session should be dropped.
+	Malformed ops are only found while applying, and make the transaction fail with INVALID_OP.
+*/
+bool QueueSubmittedTransaction(ServerWorker& Worker, ServerSession& Session, const uint8_t* Payload, size_t PayloadSize);
+
+/*
+	Applies the worker's batch and appends each transaction's TRANSACTION_RESULT frame to its session's write buffer, then empties the batch.
+	Returns the sequence to wait for before the answers may go out if the graph is persisted, in which case they are held in the
+	sessions' PendingResults instead. Returns 0 when they can go out right away.
+*/
+uint64_t CommitTransactionBatch(ServerState& Server, ServerWorker& Worker);
+
+/*
+	Starts, replaces or ends the session's subscription from a SUBSCRIBE payload, appending the first update to the buffer.
+	Returns false if the payload is malformed.
+*/
+bool HandleSubscribe(ServerState& Server, ServerWorker& Worker, ServerSession& Session, const uint8_t* Payload, size_t PayloadSize);
+
+/*
+	Brings the session's subscription up to date as far as its bandwidth budget allows, appending the update to its write buffer.
+	Returns false once the subscription ended, after appending the last update telling so.
+*/
+bool SyncSubscription(ServerState& Server, ServerWorker& Worker, ServerSession& Session);
+
+/*
+	Opens the listening socket and starts the worker threads. Returns whether the server is up.
+*/
+bool StartServerNetwork(ServerState& Server);
+
+// Asks workers to stop, waits for them, then closes every session and the listening socket.
+void StopServerNetwork(ServerState& Server);
+
+/*
+	Starts the storage layer with the passed backend, registering the buffers for requests to use. Returns false if the backend isn't
+	available. Buffers that can't be registered are only used as plain memory.
+*/
+bool InitializeServerStorage(ServerStorage& Storage, ServerStorageBackend Backend, uint8_t* const* Buffers, const size_t* BufferSizes,
+	uint32_t BufferCount);
+
+// Waits for requests in flight to complete, then stops the storage layer.
+void ShutdownServerStorage(ServerStorage& Storage);
+
+/*
+	Submits the requests together. Returns false if there isn't room for all of them, in which case none was submitted.
+*/
+bool SubmitStorageRequests(ServerStorage& Storage, const ServerStorageRequest* Requests, size_t Count);
+
+// Appends the requests that completed since last called to the vector.
+void ReapStorageCompletions(ServerStorage& Storage, std::vector<ServerStorageCompletion>& OutCompletions);
+
+const char* GetServerStorageBackendName(ServerStorageBackend Backend);
+
+/*
+	Opens the configured data directory: restores the graph from its snapshot and journal, or initializes the graph as without one
+	and snapshots it. Then starts the journal. Returns false if the graph couldn't be restored or the directory can't be written.
+*/
+bool OpenServerPersistence(ServerState& Server);
+
+// Makes everything journaled durable, then stops the persistence thread. Workers must be stopped.
+void CloseServerPersistence(ServerState& Server);
+
+/*
+	Adds the changes of the transactions the shard transaction committed to the journal, giving them their sequence numbers.
+	Must be called holding the shards they touch. Returns the sequence of the last transaction committed before them.
+*/
+uint64_t AppendServerJournal(ServerPersistence& Persistence, ServerGraph& Graph, ServerShardTransaction& Transaction, size_t TransactionCount);
+
+// Workers woken once what they wait for is durable. Set before they start, cleared before their eventfds are closed.
+void SetServerDurabilityWaiters(ServerPersistence& Persistence, std::vector<ServerDurabilityWaiter> Waiters);
+
+// Sums the metrics of the running workers.
+void SummarizeServerMetrics(const ServerState& Server, ServerMetricsSummary& OutSummary);
+
+/*
+	Opens the metrics endpoint's listening socket if the configuration asks for one. Returns false if it couldn't.
+*/
+bool StartServerMetrics(ServerState& Server);
+
+/*
+	Waits up to the passed time for metrics scrapes and answers them, in the Prometheus text format. Only sleeps without an endpoint.
+	Scrapes are served one at a time by the calling thread, away from the workers.
+*/
+void ServeServerMetrics(ServerState& Server, int TimeoutMs);
+
+void StopServerMetrics(ServerState& Server);
+
+#endif // SERVER_INCLUDED
@@ -0,0 +1,187 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Server's authoritative graph: allocation of its shards, seeding, and handling of submitted transactions.
+
+#include "Server.h"
+#include "Graph/SynergyGraphBulkLoad.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+
+// Allocates the graph's shards, empty. Each shard gets its own allocation and an even share of the capacity.
+static bool AllocateServerShards(ServerGraph& Graph, const ServerConfig& Config)
+{
+	Graph.ShardCount = Config.ShardCount;
+	Graph.Shards.reset(new ServerShard[Graph.ShardCount]);
+
+	const size_t shardNodeCount = (Config.MaxNodeCount + Graph.ShardCount - 1) / Graph.ShardCount;
+	const size_t shardConnectionCount = (Config.MaxConnectionCount + Graph.ShardCount - 1) / Graph.ShardCount;
+	const size_t shardMemorySize = SGraphStore::GetRequiredMemorySize(shardNodeCount, shardConnectionCount)
+		+ SGraphChangeStream::GetRequiredMemorySize();
+
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		ServerShard& shard = Graph.Shards[shardIndex];
+		shard.Index = shardIndex;
+		shard.Memory = (uint8_t*)malloc(shardMemorySize);
+		if (shard.Memory == nullptr)
+		{
+			return false;
+		}
+
+		shard.Allocator = MakeStackAllocator(shard.Memory, shardMemorySize);
+		if (!shard.Store.Initialize(shard.Allocator, shardNodeCount, shardConnectionCount) || !shard.Journal.Initialize(shard.Allocator))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool InitializeServerGraph(ServerGraph& Graph, const ServerConfig& Config)
+{
+	if (!AllocateServerShards(Graph, Config))
+	{
+		return false;
+	}
+
+	if (Config.BulkFilePath != nullptr)
+	{
+		// A single shard holds the file's IDs as they are. Otherwise the file is loaded whole first, then spread over the shards.
+		SGraphStore* loadStore = &Graph.Shards[0].Store;
+		uint8_t* loadMemory = nullptr;
+		if (Graph.ShardCount > 1)
+		{
+			const size_t loadMemorySize = SGraphStore::GetRequiredMemorySize(Config.MaxNodeCount, Config.MaxConnectionCount);
+			loadMemory = (uint8_t*)malloc(loadMemorySize);
+			loadStore = new SGraphStore();
+
+			MemoryAllocator allocator = MakeStackAllocator(loadMemory, loadMemorySize);
+			if (loadMemory == nullptr || !loadStore->Initialize(allocator, Config.MaxNodeCount, Config.MaxConnectionCount))
+			{
+				delete loadStore;
+				free(loadMemory);
+				return false;
+			}
+		}
+
+		SGraphBulkLoadResult result;
+		bool bSuccess = BulkLoadGraph(*loadStore, Config.BulkFilePath, SGraphBulkLoadOptions(), result);
+		if (!bSuccess)
+		{
+			std::cerr << "Failed to load " << Config.BulkFilePath << " at line " << result.ErrorLine << ": " << result.Error << "\n";
+		}
+		else if (Graph.ShardCount > 1)
+		{
+			bSuccess = DistributeGraph(Graph, *loadStore, result.RootNodeID);
+			if (!bSuccess)
+			{
+				std::cerr << "Failed to spread " << Config.BulkFilePath << " over " << Graph.ShardCount << " shards, one of them ran out of capacity.\n";
+			}
+		}
+		else
+		{
+			Graph.RootID = result.RootNodeID;
+		}
+
+		if (Graph.ShardCount > 1)
+		{
+			delete loadStore;
+			free(loadMemory);
+		}
+		if (!bSuccess)
+		{
+			return false;
+		}
+
+		std::cout << "Loaded " << result.NodeCount << " nodes and " << result.ConnectionCount << " connections"
+			<< (Graph.ShardCount > 1 ? ", node IDs were reassigned to spread them over shards.\n" : ".\n");
+		return true;
+	}
+
+	// Lone root, in the first shard.
+	ServerShard& rootShard = Graph.Shards[0];
+	const SNameHandle rootName = rootShard.Store.Names.Intern("Root");
+	const SNodeGUID rootID = GlobalNodeID(Graph, 0, rootShard.Store.FindAvailableID());
+	if (rootName == SNAME_INVALID_HANDLE || rootID == SNODE_INVALID_ID)
+	{
+		return false;
+	}
+
+	RawCreateNode(Graph, rootID, rootName, SNODE_INVALID_ID);
+	rootShard.Journal.BeginTransaction();
+	rootShard.Journal.Push({ SGraphChangeKind::NODE_CREATED, SNodeConnectionAccessLevel::NONE, rootName, rootID, SNODE_INVALID_ID });
+	rootShard.Journal.EndTransaction();
+
+	Graph.RootID = rootID;
+	return true;
+}
+
+void ShutdownServerGraph(ServerGraph& Graph)
+{
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		free(Graph.Shards[shardIndex].Memory);
+		Graph.Shards[shardIndex].Memory = nullptr;
+	}
+}
+
+bool QueueSubmittedTransaction(ServerWorker& Worker, ServerSession& Session, const uint8_t* Payload, size_t PayloadSize)
+{
+	ServerTransactionBatch& batch = Worker.Batch;
+	if (batch.Readers.size() <= batch.Count)
+	{
+		batch.Readers.resize(batch.Count + 1);
+	}
+
+	// Ops are decoded as they are applied, straight from the session's read buffer.
+	if (!batch.Readers[batch.Count].Begin(Payload, PayloadSize))
+	{
+		return false;
+	}
+
+	batch.Sessions.resize(batch.Count + 1);
+	batch.Sessions[batch.Count] = &Session;
+	batch.Count++;
+	return true;
+}
+
+uint64_t CommitTransactionBatch(ServerState& Server, ServerWorker& Worker)
+{
+	ServerTransactionBatch& batch = Worker.Batch;
+	if (batch.Count == 0)
+	{
+		return 0;
+	}
+
+	// Shards are locked as needed while applying.
+	const std::chrono::steady_clock::time_point applyStart = std::chrono::steady_clock::now();
+	ApplyShardedTransactionBatch(Server.Graph, batch, Worker.Transaction);
+	Worker.Metrics.BatchApplyLatency.Record(
+		(uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - applyStart).count());
+	Worker.Metrics.BatchCount.Add(1);
+
+	// Answers wait for the last change of the batch to be durable, those of transactions that failed as well: they may have seen it.
+	uint64_t lastSequence = 0;
+	for (size_t transactionIndex = 0; transactionIndex < batch.Count; transactionIndex++)
+	{
+		lastSequence = std::max(lastSequence, batch.Results[transactionIndex].Sequence);
+	}
+	const bool bHoldResults = Server.Persistence != nullptr && lastSequence > Server.Persistence->DurableSequence.load();
+
+	for (size_t transactionIndex = 0; transactionIndex < batch.Count; transactionIndex++)
+	{
+		const SGraphTransactionResult& result = batch.Results[transactionIndex];
+		const size_t createdOffset = batch.CreatedOffsets[transactionIndex];
+		Worker.Metrics.TransactionCounts[(size_t)result.Status].Add(1);
+
+		ServerSession* session = batch.Sessions[transactionIndex];
+		SProtocolAppendTransactionResult(bHoldResults ? session->PendingResults : session->WriteBuffer, batch.Readers[transactionIndex].RequestID,
+			result, batch.CreatedIDs.data() + createdOffset, batch.CreatedOffsets[transactionIndex + 1] - createdOffset);
+	}
+
+	batch.Count = 0;
+	return bHoldResults ? lastSequence : 0;
+}
@@ -0,0 +1,410 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Server's metrics: per worker counters and latency histograms, and the endpoint serving them to Prometheus.
+
+#include "Server.h"
+
+#include <stdio.h>
+
+#include <iostream>
+
+/*
+	HOW IT WORKS
+
+	Workers count what they do in their own ServerWorkerMetrics, which no other thread writes, so counting never takes a lock or a
+	locked instruction and never makes workers fight over a cache line. Whoever wants the totals sums every worker's metrics on the spot:
+	the status line, and the metrics endpoint when scraped. Values read while workers write them may be a few events behind, which is
+	all counters need. Figures that need a walk over a worker's sessions are refreshed by the worker itself once in a while.
+
+	The endpoint answers any HTTP GET of /metrics with the Prometheus text format. It is served by the main thread, which otherwise only
+	prints the status line, so scrapes never delay sessions. Shard figures take each shard's lock in turn, briefly.
+*/
+
+// Most bytes read from a scraper's request, and how long it may take sending it or reading the answer.
+constexpr size_t SERVER_METRICS_MAX_REQUEST_SIZE = 4096;
+constexpr int SERVER_METRICS_SOCKET_TIMEOUT_MS = 1000;
+
+void ServerLatencyHistogram::Record(uint64_t Nanoseconds)
+{
+	// Smallest power of two microseconds at least as long as the duration.
+	const uint64_t microseconds = (Nanoseconds + 999) / 1000;
+	size_t bucketIndex = 0;
+	while (bucketIndex < SERVER_LATENCY_BUCKET_COUNT - 1 && ((uint64_t)1 << bucketIndex) < microseconds)
+	{
+		bucketIndex++;
+	}
+
+	Buckets[bucketIndex].Add(1);
+	Count.Add(1);
+	SumNanoseconds.Add(Nanoseconds);
+}
+
+static void SummarizeLatencyHistogram(const ServerLatencyHistogram& Histogram, ServerLatencySummary& OutSummary)
+{
+	for (size_t bucketIndex = 0; bucketIndex < SERVER_LATENCY_BUCKET_COUNT; bucketIndex++)
+	{
+		OutSummary.Buckets[bucketIndex] += Histogram.Buckets[bucketIndex].Get();
+	}
+	OutSummary.Count += Histogram.Count.Get();
+	OutSummary.SumNanoseconds += Histogram.SumNanoseconds.Get();
+}
+
+void SummarizeServerMetrics(const ServerState& Server, ServerMetricsSummary& OutSummary)
+{
+	OutSummary = ServerMetricsSummary();
+	for (const ServerWorker& worker : Server.Workers)
+	{
+		const ServerWorkerMetrics& metrics = worker.Metrics;
+		OutSummary.AcceptedSessionCount += metrics.AcceptedSessionCount.Get();
+		OutSummary.RefusedSessionCount += metrics.RefusedSessionCount.Get();
+		OutSummary.ClosedSessionCount += metrics.ClosedSessionCount.Get();
+		OutSummary.ReceivedByteCount += metrics.ReceivedByteCount.Get();
+		OutSummary.SentByteCount += metrics.SentByteCount.Get();
+		for (size_t statusIndex = 0; statusIndex < (size_t)SGraphTransactionStatus::COUNT; statusIndex++)
+		{
+			OutSummary.TransactionCounts[statusIndex] += metrics.TransactionCounts[statusIndex].Get();
+		}
+		OutSummary.BatchCount += metrics.BatchCount.Get();
+		SummarizeLatencyHistogram(metrics.BatchApplyLatency, OutSummary.BatchApplyLatency);
+		OutSummary.SubscriptionUpdateCount += metrics.SubscriptionUpdateCount.Get();
+		OutSummary.SubscriptionUpdateByteCount += metrics.SubscriptionUpdateByteCount.Get();
+		SummarizeLatencyHistogram(metrics.SubscriptionSyncLatency, OutSummary.SubscriptionSyncLatency);
+		OutSummary.SessionBufferSize += metrics.SessionBufferSize.Get();
+	}
+}
+
+// EXPOSITION
+
+static void AppendMetricHeader(std::string& Out, const char* Name, const char* Type, const char* Help)
+{
+	Out += "# HELP ";
+	Out += Name;
+	Out += ' ';
+	Out += Help;
+	Out += "\n# TYPE ";
+	Out += Name;
+	Out += ' ';
+	Out += Type;
+	Out += '\n';
+}
+
+// Labels are written as they are, without braces. Empty labels write none.
+static void AppendMetricSample(std::string& Out, const char* Name, const char* Labels, uint64_t Value)
+{
+	char line[256];
+	snprintf(line, sizeof(line), Labels[0] != '\0' ? "%s{%s} %llu\n" : "%s%s %llu\n", Name, Labels, (unsigned long long)Value);
+	Out += line;
+}
+
+static void AppendMetric(std::string& Out, const char* Name, const char* Type, const char* Help, uint64_t Value)
+{
+	AppendMetricHeader(Out, Name, Type, Help);
+	AppendMetricSample(Out, Name, "", Value);
+}
+
+static void AppendLatencyHistogram(std::string& Out, const char* Name, const char* Help, const ServerLatencySummary& Summary)
+{
+	AppendMetricHeader(Out, Name, "histogram", Help);
+
+	char line[256];
+	uint64_t cumulativeCount = 0;
+	for (size_t bucketIndex = 0; bucketIndex < SERVER_LATENCY_BUCKET_COUNT; bucketIndex++)
+	{
+		cumulativeCount += Summary.Buckets[bucketIndex];
+		if (bucketIndex + 1 < SERVER_LATENCY_BUCKET_COUNT)
+		{
+			snprintf(line, sizeof(line), "%s_bucket{le=\"%.9g\"} %llu\n", Name, (double)((uint64_t)1 << bucketIndex) * 1e-6,
+				(unsigned long long)cumulativeCount);
+		}
+		else
+		{
+			snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n", Name, (unsigned long long)cumulativeCount);
+		}
+		Out += line;
+	}
+
+	snprintf(line, sizeof(line), "%s_sum %.9f\n%s_count %llu\n", Name, Summary.SumNanoseconds * 1e-9, Name, (unsigned long long)Summary.Count);
+	Out += line;
+}
+
+// Writes every metric in the Prometheus text format.
+static void WriteServerMetrics(ServerState& Server, std::string& Out)
+{
+	ServerMetricsSummary summary;
+	SummarizeServerMetrics(Server, summary);
+	ServerGraph& graph = Server.Graph;
+	char labels[128];
+
+	AppendMetric(Out, "synergy_sessions", "gauge", "Sessions currently connected.", Server.SessionCount);
+	AppendMetric(Out, "synergy_sessions_accepted_total", "counter", "Sessions accepted.", summary.AcceptedSessionCount);
+	AppendMetric(Out, "synergy_sessions_refused_total", "counter", "Connections closed right away as too many sessions were connected.",
+		summary.RefusedSessionCount);
+	AppendMetric(Out, "synergy_sessions_closed_total", "counter", "Sessions closed, by either side.", summary.ClosedSessionCount);
+	AppendMetric(Out, "synergy_received_bytes_total", "counter", "Bytes received from sessions.", summary.ReceivedByteCount);
+	AppendMetric(Out, "synergy_sent_bytes_total", "counter", "Bytes sent to sessions.", summary.SentByteCount);
+
+	AppendMetricHeader(Out, "synergy_transactions_total", "counter", "Committed transactions, by outcome.");
+	for (size_t statusIndex = 0; statusIndex < (size_t)SGraphTransactionStatus::COUNT; statusIndex++)
+	{
+		snprintf(labels, sizeof(labels), "status=\"%s\"", GetGraphTransactionStatusName((SGraphTransactionStatus)statusIndex));
+		AppendMetricSample(Out, "synergy_transactions_total", labels, summary.TransactionCounts[statusIndex]);
+	}
+	AppendMetric(Out, "synergy_transaction_batches_total", "counter", "Transaction batches committed.", summary.BatchCount);
+	AppendLatencyHistogram(Out, "synergy_transaction_batch_apply_seconds", "Time taken to apply a transaction batch, shard lock waits included.",
+		summary.BatchApplyLatency);
+
+	AppendMetric(Out, "synergy_subscription_updates_total", "counter", "Subscription updates sent.", summary.SubscriptionUpdateCount);
+	AppendMetric(Out, "synergy_subscription_update_bytes_total", "counter", "Bytes of subscription updates sent.",
+		summary.SubscriptionUpdateByteCount);
+	AppendLatencyHistogram(Out, "synergy_subscription_sync_seconds", "Time taken by subscription syncs that had to look at the graph.",
+		summary.SubscriptionSyncLatency);
+
+	AppendMetric(Out, "synergy_visibility_cache_hits_total", "counter", "Viewer rights found in the visibility cache.",
+		graph.VisibilityCache.HitCount);
+	AppendMetric(Out, "synergy_visibility_cache_misses_total", "counter", "Viewer rights computed as the visibility cache didn't hold them.",
+		graph.VisibilityCache.MissCount);
+	AppendMetric(Out, "synergy_visibility_cache_invalidations_total", "counter", "Viewer rights dropped from the visibility cache by changes.",
+		graph.VisibilityCache.InvalidationCount);
+
+	if (const ServerPersistence* persistence = Server.Persistence.get())
+	{
+		ServerLatencySummary flushLatency, pauseLatency;
+		SummarizeLatencyHistogram(persistence->JournalFlushLatency, flushLatency);
+		SummarizeLatencyHistogram(persistence->SnapshotPauseLatency, pauseLatency);
+
+		AppendMetric(Out, "synergy_journal_bytes_total", "counter", "Bytes of records appended to the journal.", persistence->JournalByteCount.Get());
+		AppendMetric(Out, "synergy_journal_flushes_total", "counter", "Journal buffers written and flushed.", persistence->JournalFlushCount.Get());
+		AppendLatencyHistogram(Out, "synergy_journal_flush_seconds", "Time taken to write and flush a journal buffer to the device.", flushLatency);
+		AppendMetric(Out, "synergy_journal_backpressure_waits_total", "counter",
+			"Appends that waited for a journal buffer as both were full or being written.", persistence->BackpressureWaitCount.Get());
+		AppendMetric(Out, "synergy_journal_durable_sequence", "gauge", "Sequence number up to which committed transactions are durable.",
+			persistence->DurableSequence.load(std::memory_order_relaxed));
+		AppendMetric(Out, "synergy_snapshots_total", "counter", "Snapshots of the graph written.", persistence->SnapshotCount.Get());
+		AppendMetric(Out, "synergy_snapshot_bytes_total", "counter", "Bytes of snapshots written.", persistence->SnapshotByteCount.Get());
+		AppendLatencyHistogram(Out, "synergy_snapshot_pause_seconds", "Time a shard was held to serialize its part of a snapshot.", pauseLatency);
+	}
+
+	AppendMetricHeader(Out, "synergy_graph_nodes", "gauge", "Nodes in each graph shard.");
+	std::string connectionSamples, nameCountSamples, internFailureSamples, nameSamples;
+	for (uint32_t shardIndex = 0; shardIndex < graph.ShardCount; shardIndex++)
+	{
+		ServerShard& shard = graph.Shards[shardIndex];
+		size_t nodeCount, connectionCount, nameCount, internFailureCount, nameArenaUsed;
+		{
+			std::lock_guard<std::mutex> lock(shard.Lock);
+			nodeCount = shard.Store.NodeCount;
+			connectionCount = shard.Store.EdgeCount;
+			nameCount = shard.Store.Names.NameCount;
+			internFailureCount = shard.Store.Names.InternFailureCount;
+			nameArenaUsed = shard.Store.Names.GetUsedBytes();
+		}
+
+		snprintf(labels, sizeof(labels), "shard=\"%u\"", shardIndex);
+		AppendMetricSample(Out, "synergy_graph_nodes", labels, nodeCount);
+		AppendMetricSample(connectionSamples, "synergy_graph_connections", labels, connectionCount);
+		AppendMetricSample(nameCountSamples, "synergy_graph_names", labels, nameCount);
+		AppendMetricSample(internFailureSamples, "synergy_name_intern_failures_total", labels, internFailureCount);
+		snprintf(labels, sizeof(labels), "allocator=\"name_pool\",shard=\"%u\"", shardIndex);
+		AppendMetricSample(nameSamples, "synergy_memory_used_bytes", labels, nameArenaUsed);
+	}
+	AppendMetricHeader(Out, "synergy_graph_connections", "gauge", "Connections in each graph shard.");
+	Out += connectionSamples;
+	AppendMetricHeader(Out, "synergy_graph_names", "gauge", "Distinct names interned in each graph shard.");
+	Out += nameCountSamples;
+	AppendMetricHeader(Out, "synergy_name_intern_failures_total", "counter",
+		"Names each graph shard had no room left for, failing the edits that needed them with OUT_OF_CAPACITY.");
+	Out += internFailureSamples;
+
+	AppendMetricHeader(Out, "synergy_graph_node_capacity", "gauge", "Nodes each graph shard can hold.");
+	for (uint32_t shardIndex = 0; shardIndex < graph.ShardCount; shardIndex++)
+	{
+		snprintf(labels, sizeof(labels), "shard=\"%u\"", shardIndex);
+		AppendMetricSample(Out, "synergy_graph_node_capacity", labels, graph.Shards[shardIndex].Store.MaxNodeCount);
+	}
+
+	// Shard arenas and their name pools are allocated whole up front, so they have a reserved size on top of what is used.
+	AppendMetricHeader(Out, "synergy_memory_reserved_bytes", "gauge", "Bytes reserved by each allocator with a fixed size.");
+	for (uint32_t shardIndex = 0; shardIndex < graph.ShardCount; shardIndex++)
+	{
+		const ServerShard& shard = graph.Shards[shardIndex];
+		snprintf(labels, sizeof(labels), "allocator=\"shard_arena\",shard=\"%u\"", shardIndex);
+		AppendMetricSample(Out, "synergy_memory_reserved_bytes", labels, shard.Allocator.Memory.BufferSize);
+		snprintf(labels, sizeof(labels), "allocator=\"name_pool\",shard=\"%u\"", shardIndex);
+		AppendMetricSample(Out, "synergy_memory_reserved_bytes", labels, shard.Store.Names.ArenaCapacity);
+	}
+	if (Server.Persistence != nullptr)
+	{
+		AppendMetricSample(Out, "synergy_memory_reserved_bytes", "allocator=\"journal_buffers\"", 2 * SERVER_JOURNAL_BUFFER_SIZE);
+	}
+
+	AppendMetricHeader(Out, "synergy_memory_used_bytes", "gauge", "Bytes used from each allocator.");
+	for (uint32_t shardIndex = 0; shardIndex < graph.ShardCount; shardIndex++)
+	{
+		snprintf(labels, sizeof(labels), "allocator=\"shard_arena\",shard=\"%u\"", shardIndex);
+		AppendMetricSample(Out, "synergy_memory_used_bytes", labels, graph.Shards[shardIndex].Allocator.Memory.AllocatedByteCount);
+	}
+	Out += nameSamples;
+	AppendMetricSample(Out, "synergy_memory_used_bytes", "allocator=\"visibility_cache\"", graph.VisibilityCache.MemorySize);
+	AppendMetricSample(Out, "synergy_memory_used_bytes", "allocator=\"session_buffers\"", summary.SessionBufferSize);
+	if (Server.Persistence != nullptr)
+	{
+		AppendMetricSample(Out, "synergy_memory_used_bytes", "allocator=\"journal_buffers\"", 2 * SERVER_JOURNAL_BUFFER_SIZE);
+	}
+}
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+bool StartServerMetrics(ServerState& Server)
+{
+	if (Server.Config.MetricsPort == 0)
+	{
+		return true;
+	}
+
+	Server.MetricsListenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (Server.MetricsListenSocket < 0)
+	{
+		return false;
+	}
+
+	const int reuseAddress = 1;
+	setsockopt(Server.MetricsListenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(Server.Config.MetricsPort);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(Server.MetricsListenSocket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(Server.MetricsListenSocket, 16) != 0)
+	{
+		std::cerr << "Failed to serve metrics on port " << Server.Config.MetricsPort << ", error " << errno << ".\n";
+		StopServerMetrics(Server);
+		return false;
+	}
+	return true;
+}
+
+static bool SendAll(int Socket, const char* Data, size_t Size)
+{
+	while (Size > 0)
+	{
+		const ssize_t sentSize = send(Socket, Data, Size, MSG_NOSIGNAL);
+		if (sentSize < 0)
+		{
+			if (errno == EINTR) continue;
+			return false;
+		}
+		Data += sentSize;
+		Size -= (size_t)sentSize;
+	}
+	return true;
+}
+
+// Reads the scraper's request and answers it, on a blocking socket bounded by timeouts.
+static void ServeMetricsScrape(ServerState& Server, int Socket)
+{
+	timeval timeout = {};
+	timeout.tv_sec = SERVER_METRICS_SOCKET_TIMEOUT_MS / 1000;
+	timeout.tv_usec = (SERVER_METRICS_SOCKET_TIMEOUT_MS % 1000) * 1000;
+	setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(Socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	// Only the request line matters, the headers are read so that closing doesn't reset the connection under the scraper.
+	std::string request;
+	char chunk[512];
+	while (request.size() < SERVER_METRICS_MAX_REQUEST_SIZE && request.find("\r\n\r\n") == std::string::npos)
+	{
+		const ssize_t receivedSize = recv(Socket, chunk, sizeof(chunk), 0);
+		if (receivedSize < 0 && errno == EINTR) continue;
+		if (receivedSize <= 0) return;
+		request.append(chunk, (size_t)receivedSize);
+	}
+
+	const bool bMetricsRequest = request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0;
+
+	std::string body;
+	if (bMetricsRequest)
+	{
+		WriteServerMetrics(Server, body);
+	}
+	else
+	{
+		body = "Metrics are served at /metrics.\n";
+	}
+
+	char header[256];
+	const int headerSize = snprintf(header, sizeof(header),
+		"HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+		bMetricsRequest ? "200 OK" : "404 Not Found", body.size());
+	if (SendAll(Socket, header, (size_t)headerSize))
+	{
+		SendAll(Socket, body.data(), body.size());
+	}
+}
+
+void ServeServerMetrics(ServerState& Server, int TimeoutMs)
+{
+	if (Server.MetricsListenSocket < 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(TimeoutMs));
+		return;
+	}
+
+	pollfd listenPoll = { Server.MetricsListenSocket, POLLIN, 0 };
+	if (poll(&listenPoll, 1, TimeoutMs) <= 0)
+	{
+		return;
+	}
+
+	for (;;)
+	{
+		// Accepted sockets don't inherit the listening socket's non-blocking flag.
+		const int socket = accept4(Server.MetricsListenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+		if (socket < 0)
+		{
+			if (errno == EINTR) continue;
+			return;
+		}
+
+		ServeMetricsScrape(Server, socket);
+		close(socket);
+	}
+}
+
+void StopServerMetrics(ServerState& Server)
+{
+	if (Server.MetricsListenSocket >= 0)
+	{
+		close(Server.MetricsListenSocket);
+		Server.MetricsListenSocket = -1;
+	}
+}
+
+#else
+
+bool StartServerMetrics(ServerState& Server)
+{
+	if (Server.Config.MetricsPort != 0)
+	{
+		std::cerr << "The metrics endpoint is only available on Linux.\n";
+	}
+	return Server.Config.MetricsPort == 0;
+}
+
+void ServeServerMetrics(ServerState& Server, int TimeoutMs)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(TimeoutMs));
+}
+
+void StopServerMetrics(ServerState& Server)
+{
+}
+
+#endif
@@ -0,0 +1,669 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Server's networking: a listening socket shared by worker threads, each running a non-blocking epoll event loop
+// over the sessions it accepted. Sessions never move between workers, so a session's state is only ever touched by one thread.
+
+#include "Server.h"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Events handled per epoll_wait call, and how long a wait may last before the worker checks whether it should stop.
+constexpr int SERVER_EPOLL_BATCH_SIZE = 256;
+constexpr int SERVER_EPOLL_TIMEOUT_MS = 100;
+
+// Bytes received from a session in one go. Sessions with more to send get served again on the next wait, so no session starves the others.
+constexpr size_t SERVER_READ_CHUNK_SIZE = 16 * 1024;
+constexpr size_t SERVER_MAX_READ_PER_EVENT = 16 * SERVER_READ_CHUNK_SIZE;
+
+// Sessions with more unsent bytes than this don't get their requests processed until the backlog drains.
+constexpr size_t SERVER_MAX_PENDING_WRITE_SIZE = 4 * 1024 * 1024;
+
+// The listening socket is registered in every worker's epoll instance with a null pointer, telling it apart from sessions.
+static void* const SERVER_LISTEN_EVENT_TAG = nullptr;
+
+// SESSIONS
+
+static bool SetSessionWatchedEvents(ServerWorker& Worker, ServerSession& Session, uint32_t Events)
+{
+	if (Session.WatchedEvents == Events)
+	{
+		return true;
+	}
+
+	epoll_event event = {};
+	event.events = Events;
+	event.data.ptr = &Session;
+	if (epoll_ctl(Worker.EpollDescriptor, EPOLL_CTL_MOD, Session.Socket, &event) != 0)
+	{
+		return false;
+	}
+
+	Session.WatchedEvents = Events;
+	return true;
+}
+
+static size_t GetPendingWriteSize(const ServerSession& Session)
+{
+	return Session.WriteBuffer.size() - Session.WriteOffset;
+}
+
+// Reads are paused while too much is waiting to be sent, or while the session waits for its batch and wouldn't process what it reads.
+// Unread bytes then stay in the socket, and the peer is held back by TCP flow control. Writes are only watched while something is pending.
+static bool UpdateSessionWatchedEvents(ServerWorker& Worker, ServerSession& Session)
+{
+	const size_t pendingWriteSize = GetPendingWriteSize(Session);
+
+	uint32_t events = 0;
+	if (pendingWriteSize < SERVER_MAX_PENDING_WRITE_SIZE && !Session.bAwaitingBatch) events |= EPOLLIN;
+	if (pendingWriteSize > 0) events |= EPOLLOUT;
+
+	return SetSessionWatchedEvents(Worker, Session, events);
+}
+
+// Drops the session's transactions from its worker's batch, or its committed ones from those waiting to be durable.
+// Their payloads live in its read buffer.
+static void RemoveSessionFromBatch(ServerWorker& Worker, ServerSession* Session)
+{
+	for (ServerDurabilityWait& wait : Worker.DurabilityWaits)
+	{
+		wait.Sessions.erase(std::remove(wait.Sessions.begin(), wait.Sessions.end(), Session), wait.Sessions.end());
+	}
+
+	ServerTransactionBatch& batch = Worker.Batch;
+	size_t keptCount = 0;
+	for (size_t transactionIndex = 0; transactionIndex < batch.Count; transactionIndex++)
+	{
+		if (batch.Sessions[transactionIndex] != Session)
+		{
+			// Readers are swapped rather than copied, each keeps its name table's allocation.
+			std::swap(batch.Readers[keptCount], batch.Readers[transactionIndex]);
+			batch.Sessions[keptCount] = batch.Sessions[transactionIndex];
+			keptCount++;
+		}
+	}
+	batch.Count = keptCount;
+
+	Worker.BatchSessions.erase(std::remove(Worker.BatchSessions.begin(), Worker.BatchSessions.end(), Session), Worker.BatchSessions.end());
+}
+
+static void CloseSession(ServerState& Server, ServerWorker& Worker, ServerSession* Session)
+{
+	// Closing the socket removes it from the epoll instance.
+	close(Session->Socket);
+	Worker.SubscriptionCount -= Session->Subscription != nullptr;
+
+	if (Session->bAwaitingBatch)
+	{
+		RemoveSessionFromBatch(Worker, Session);
+	}
+
+	ServerSession* movedSession = Worker.Sessions.back();
+	movedSession->WorkerSlot = Session->WorkerSlot;
+	Worker.Sessions[Session->WorkerSlot] = movedSession;
+	Worker.Sessions.pop_back();
+
+	delete Session;
+	Server.SessionCount--;
+	Worker.Metrics.ClosedSessionCount.Add(1);
+}
+
+// Sends as much of the pending bytes as the socket takes. Returns false if the connection failed.
+static bool FlushSession(ServerWorker& Worker, ServerSession& Session)
+{
+	while (Session.WriteOffset < Session.WriteBuffer.size())
+	{
+		const ssize_t sentSize = send(Session.Socket, Session.WriteBuffer.data() + Session.WriteOffset,
+			Session.WriteBuffer.size() - Session.WriteOffset, MSG_NOSIGNAL);
+		if (sentSize < 0)
+		{
+			if (errno == EINTR) continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		Session.WriteOffset += (size_t)sentSize;
+		Worker.Metrics.SentByteCount.Add((uint64_t)sentSize);
+	}
+
+	Session.WriteBuffer.clear();
+	Session.WriteOffset = 0;
+	return true;
+}
+
+/*
+	Handles every complete frame at the front of the read buffer, appending answers to the write buffer.
+	Submitted transactions go to the worker's batch, and the session waits for it to be committed before handling what follows them.
+	Stops early if the session has too much to send already. Returns false on protocol errors.
+*/
+static bool ProcessSessionFrames(ServerState& Server, ServerWorker& Worker, ServerSession& Session)
+{
+	if (Session.bAwaitingBatch)
+	{
+		return true;
+	}
+
+	size_t consumedSize = 0;
+	while (GetPendingWriteSize(Session) < SERVER_MAX_PENDING_WRITE_SIZE)
+	{
+		const uint8_t* frame = Session.ReadBuffer.data() + consumedSize;
+		const size_t availableSize = Session.ReadBuffer.size() - consumedSize;
+
+		SProtocolMessageType type;
+		uint32_t payloadSize;
+		if (!SProtocolReadFrameHeader(frame, availableSize, type, payloadSize))
+		{
+			break;
+		}
+		if (payloadSize > SPROTOCOL_MAX_PAYLOAD_SIZE)
+		{
+			return false;
+		}
+		if (availableSize < SPROTOCOL_FRAME_HEADER_SIZE + payloadSize)
+		{
+			break;
+		}
+
+		const uint8_t* payload = frame + SPROTOCOL_FRAME_HEADER_SIZE;
+		if (type == SProtocolMessageType::SUBMIT_TRANSACTION)
+		{
+			if (!Session.bAwaitingBatch)
+			{
+				// Frames handled so far go, the batched ones then start the read buffer.
+				Session.ReadBuffer.erase(Session.ReadBuffer.begin(), Session.ReadBuffer.begin() + consumedSize);
+				consumedSize = 0;
+				Session.bAwaitingBatch = true;
+				Worker.BatchSessions.push_back(&Session);
+				continue;
+			}
+			if (Worker.Batch.Count >= SERVER_MAX_BATCH_TRANSACTIONS)
+			{
+				break;
+			}
+			if (!QueueSubmittedTransaction(Worker, Session, payload, payloadSize))
+			{
+				return false;
+			}
+
+			consumedSize += SPROTOCOL_FRAME_HEADER_SIZE + payloadSize;
+			Session.BatchedSize = consumedSize;
+			continue;
+		}
+
+		// Answers go out in the order requests came in.
+		if (Session.bAwaitingBatch)
+		{
+			break;
+		}
+
+		switch (type)
+		{
+		case SProtocolMessageType::SUBSCRIBE:
+			if (!HandleSubscribe(Server, Worker, Session, payload, payloadSize))
+			{
+				return false;
+			}
+			break;
+		case SProtocolMessageType::PING:
+		{
+			uint64_t value;
+			if (!SProtocolDecodePing(payload, payloadSize, value))
+			{
+				return false;
+			}
+			SProtocolAppendPing(Session.WriteBuffer, SProtocolMessageType::PONG, value);
+			break;
+		}
+		case SProtocolMessageType::PONG:
+			break;
+		default:
+			// ASSERT Clients may not send this message.
+			return false;
+		}
+
+		consumedSize += SPROTOCOL_FRAME_HEADER_SIZE + payloadSize;
+	}
+
+	// Batched frames stay until their transactions are answered.
+	if (!Session.bAwaitingBatch)
+	{
+		Session.ReadBuffer.erase(Session.ReadBuffer.begin(), Session.ReadBuffer.begin() + consumedSize);
+	}
+	return true;
+}
+
+// Receives what the socket has for us, up to a limit. Returns false if the peer left or the connection failed.
+static bool ReadSession(ServerWorker& Worker, ServerSession& Session)
+{
+	size_t readSize = 0;
+	while (readSize < SERVER_MAX_READ_PER_EVENT)
+	{
+		const size_t previousSize = Session.ReadBuffer.size();
+		Session.ReadBuffer.resize(previousSize + SERVER_READ_CHUNK_SIZE);
+
+		const ssize_t receivedSize = recv(Session.Socket, Session.ReadBuffer.data() + previousSize, SERVER_READ_CHUNK_SIZE, 0);
+		Session.ReadBuffer.resize(previousSize + (receivedSize > 0 ? (size_t)receivedSize : 0));
+
+		if (receivedSize == 0)
+		{
+			return false;
+		}
+		if (receivedSize < 0)
+		{
+			if (errno == EINTR) continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		readSize += (size_t)receivedSize;
+		Worker.Metrics.ReceivedByteCount.Add((uint64_t)receivedSize);
+	}
+	return true;
+}
+
+// Handles readiness of a session's socket. Returns false if the session should be closed.
+static bool ServeSession(ServerState& Server, ServerWorker& Worker, ServerSession& Session, uint32_t Events)
+{
+	if (Events & EPOLLERR)
+	{
+		return false;
+	}
+
+	// Hang ups are noticed by reads, once whatever the peer sent before leaving has been handled.
+	if ((Events & (EPOLLIN | EPOLLHUP)) && !ReadSession(Worker, Session))
+	{
+		return false;
+	}
+
+	// Frames left over from a paused read get processed once sends caught up.
+	return ProcessSessionFrames(Server, Worker, Session)
+		&& FlushSession(Worker, Session)
+		&& UpdateSessionWatchedEvents(Worker, Session);
+}
+
+static void AcceptSessions(ServerState& Server, ServerWorker& Worker)
+{
+	for (;;)
+	{
+		const int socket = accept4(Server.ListenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (socket < 0)
+		{
+			if (errno == EINTR) continue;
+			// EAGAIN means another worker got the connection, or none was left.
+			return;
+		}
+
+		if (Server.SessionCount >= Server.Config.MaxSessionCount)
+		{
+			close(socket);
+			Worker.Metrics.RefusedSessionCount.Add(1);
+			continue;
+		}
+
+		// Answers are small and latency matters more than packet count.
+		const int noDelay = 1;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+		ServerSession* session = new ServerSession();
+		session->Socket = socket;
+		session->WorkerSlot = Worker.Sessions.size();
+		session->WatchedEvents = EPOLLIN;
+
+		epoll_event event = {};
+		event.events = session->WatchedEvents;
+		event.data.ptr = session;
+		if (epoll_ctl(Worker.EpollDescriptor, EPOLL_CTL_ADD, socket, &event) != 0)
+		{
+			close(socket);
+			delete session;
+			continue;
+		}
+
+		Worker.Sessions.push_back(session);
+		Server.SessionCount++;
+		Server.TotalSessionCount++;
+		Worker.Metrics.AcceptedSessionCount.Add(1);
+	}
+}
+
+/*
+	Commits the worker's transaction batch, then lets the sessions that waited for it handle what followed their transactions.
+	That may fill a new batch, which is committed in turn until no session waits anymore.
+	Sessions whose answers are held until the batch is durable keep waiting, see ReleaseDurableSessions.
+*/
+static void ProcessTransactionBatches(ServerState& Server, ServerWorker& Worker)
+{
+	std::vector<ServerSession*> sessions;
+	while (!Worker.BatchSessions.empty())
+	{
+		const uint64_t awaitedSequence = CommitTransactionBatch(Server, Worker);
+
+		sessions.swap(Worker.BatchSessions);
+		for (ServerSession* session : sessions)
+		{
+			session->ReadBuffer.erase(session->ReadBuffer.begin(), session->ReadBuffer.begin() + session->BatchedSize);
+			session->BatchedSize = 0;
+			session->bAwaitingBatch = awaitedSequence != 0;
+		}
+
+		if (awaitedSequence != 0)
+		{
+			Worker.DurabilityWaits.push_back({ awaitedSequence, std::move(sessions) });
+			sessions.clear();
+			continue;
+		}
+
+		for (ServerSession* session : sessions)
+		{
+			if (!ProcessSessionFrames(Server, Worker, *session) || !FlushSession(Worker, *session)
+				|| !UpdateSessionWatchedEvents(Worker, *session))
+			{
+				CloseSession(Server, Worker, session);
+			}
+		}
+		sessions.clear();
+	}
+}
+
+/*
+	Answers the sessions whose transactions became durable, lets them go on with what followed, and commits the batch that makes.
+	Then tells the persistence thread which sequence the worker waits for next.
+*/
+static void ReleaseDurableSessions(ServerState& Server, ServerWorker& Worker)
+{
+	if (Server.Persistence == nullptr)
+	{
+		return;
+	}
+
+	uint64_t eventCount;
+	while (read(Worker.DurabilityEventDescriptor, &eventCount, sizeof(eventCount)) < 0 && errno == EINTR) {}
+
+	std::vector<ServerSession*> sessions;
+	while (!Worker.DurabilityWaits.empty())
+	{
+		// The persistence thread reads the awaited sequence after making a sequence durable, and workers read the durable sequence
+		// after publishing what they await, so one of them always sees the other.
+		const ServerDurabilityWait* firstWait = &Worker.DurabilityWaits.front();
+		Worker.AwaitedSequence.store(firstWait->Sequence);
+		const uint64_t durableSequence = Server.Persistence->DurableSequence.load();
+		if (firstWait->Sequence > durableSequence)
+		{
+			return;
+		}
+
+		for (; !Worker.DurabilityWaits.empty() && Worker.DurabilityWaits.front().Sequence <= durableSequence; Worker.DurabilityWaits.pop_front())
+		{
+			for (ServerSession* session : Worker.DurabilityWaits.front().Sessions)
+			{
+				session->WriteBuffer.insert(session->WriteBuffer.end(), session->PendingResults.begin(), session->PendingResults.end());
+				session->PendingResults.clear();
+				session->bAwaitingBatch = false;
+				sessions.push_back(session);
+			}
+		}
+
+		for (ServerSession* session : sessions)
+		{
+			if (!ProcessSessionFrames(Server, Worker, *session) || !FlushSession(Worker, *session)
+				|| !UpdateSessionWatchedEvents(Worker, *session))
+			{
+				CloseSession(Server, Worker, session);
+			}
+		}
+		sessions.clear();
+
+		ProcessTransactionBatches(Server, Worker);
+	}
+	Worker.AwaitedSequence.store(0);
+}
+
+// Brings the worker's subscribed sessions up to date, except those still busy sending earlier updates.
+// Sessions waiting for their transactions to be durable are skipped, so that updates never come ahead of their answers.
+static void SyncWorkerSubscriptions(ServerState& Server, ServerWorker& Worker)
+{
+	for (size_t sessionIndex = 0; sessionIndex < Worker.Sessions.size();)
+	{
+		ServerSession* session = Worker.Sessions[sessionIndex];
+		if (session->Subscription == nullptr || session->bAwaitingBatch
+			|| GetPendingWriteSize(*session) > SERVER_SUBSCRIPTION_MAX_PENDING_WRITE_SIZE)
+		{
+			sessionIndex++;
+			continue;
+		}
+
+		if (!SyncSubscription(Server, Worker, *session))
+		{
+			session->Subscription.reset();
+			Worker.SubscriptionCount--;
+		}
+
+		// Closing a session moves the last one into its slot, which then gets its turn.
+		if (!FlushSession(Worker, *session) || !UpdateSessionWatchedEvents(Worker, *session))
+		{
+			CloseSession(Server, Worker, session);
+			continue;
+		}
+		sessionIndex++;
+	}
+}
+
+// Refreshes the worker's metrics that have to walk its sessions.
+static void UpdateWorkerMetricsGauges(ServerWorker& Worker)
+{
+	size_t bufferSize = 0;
+	for (const ServerSession* session : Worker.Sessions)
+	{
+		bufferSize += session->ReadBuffer.capacity() + session->WriteBuffer.capacity();
+	}
+	Worker.Metrics.SessionBufferSize.Set(bufferSize);
+}
+
+// WORKERS
+
+static void RunServerWorker(ServerState& Server, ServerWorker& Worker)
+{
+	epoll_event events[SERVER_EPOLL_BATCH_SIZE];
+
+	while (Server.bRunning)
+	{
+		// Waits are shortened while subscriptions need regular updates.
+		const int timeout = Worker.SubscriptionCount > 0 ? SERVER_SUBSCRIPTION_SYNC_INTERVAL_MS : SERVER_EPOLL_TIMEOUT_MS;
+		const int eventCount = epoll_wait(Worker.EpollDescriptor, events, SERVER_EPOLL_BATCH_SIZE, timeout);
+		if (eventCount < 0)
+		{
+			if (errno == EINTR) continue;
+			std::cerr << "Worker " << Worker.Index << " event loop failed with error " << errno << ".\n";
+			return;
+		}
+
+		// A socket appears at most once per wait, so closing a session can't leave a dangling pointer in the batch.
+		for (int eventIndex = 0; eventIndex < eventCount; eventIndex++)
+		{
+			if (events[eventIndex].data.ptr == SERVER_LISTEN_EVENT_TAG)
+			{
+				AcceptSessions(Server, Worker);
+				continue;
+			}
+			if (events[eventIndex].data.ptr == &Worker.DurabilityWaits)
+			{
+				continue;
+			}
+
+			ServerSession* session = (ServerSession*)events[eventIndex].data.ptr;
+			if (!ServeSession(Server, Worker, *session, events[eventIndex].events))
+			{
+				CloseSession(Server, Worker, session);
+			}
+		}
+
+		// Transactions received during this wait are committed together.
+		ProcessTransactionBatches(Server, Worker);
+		ReleaseDurableSessions(Server, Worker);
+
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (Worker.SubscriptionCount > 0 && now - Worker.LastSubscriptionSyncTime >= std::chrono::milliseconds(SERVER_SUBSCRIPTION_SYNC_INTERVAL_MS))
+		{
+			Worker.LastSubscriptionSyncTime = now;
+			SyncWorkerSubscriptions(Server, Worker);
+		}
+
+		if (now - Worker.LastMetricsGaugeTime >= std::chrono::milliseconds(SERVER_METRICS_GAUGE_INTERVAL_MS))
+		{
+			Worker.LastMetricsGaugeTime = now;
+			UpdateWorkerMetricsGauges(Worker);
+		}
+	}
+}
+
+uint32_t GetServerWorkerCount(const ServerConfig& Config)
+{
+	if (Config.ThreadCount != 0)
+	{
+		return Config.ThreadCount;
+	}
+
+	const uint32_t hardwareThreadCount = std::thread::hardware_concurrency();
+	return hardwareThreadCount == 0 ? 1 : (hardwareThreadCount > 4 ? 4 : hardwareThreadCount);
+}
+
+bool StartServerNetwork(ServerState& Server)
+{
+	Server.ListenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (Server.ListenSocket < 0)
+	{
+		return false;
+	}
+
+	const int reuseAddress = 1;
+	setsockopt(Server.ListenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(Server.Config.Port);
+	address.sin_addr.s_addr = htonl(Server.Config.bLoopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+
+	if (bind(Server.ListenSocket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(Server.ListenSocket, SOMAXCONN) != 0)
+	{
+		std::cerr << "Failed to listen on port " << Server.Config.Port << ", error " << errno << ".\n";
+		close(Server.ListenSocket);
+		Server.ListenSocket = -1;
+		return false;
+	}
+
+	const uint32_t threadCount = GetServerWorkerCount(Server.Config);
+
+	// Every worker watches the listening socket. EPOLLEXCLUSIVE wakes a single one per incoming connection.
+	Server.Workers = std::vector<ServerWorker>(threadCount);
+	for (uint32_t workerIndex = 0; workerIndex < threadCount; workerIndex++)
+	{
+		ServerWorker& worker = Server.Workers[workerIndex];
+		worker.Index = workerIndex;
+		worker.EpollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+
+		epoll_event event = {};
+		event.events = EPOLLIN | EPOLLEXCLUSIVE;
+		event.data.ptr = SERVER_LISTEN_EVENT_TAG;
+		if (worker.EpollDescriptor < 0 || epoll_ctl(worker.EpollDescriptor, EPOLL_CTL_ADD, Server.ListenSocket, &event) != 0)
+		{
+			std::cerr << "Failed to set up worker " << workerIndex << ", error " << errno << ".\n";
+			StopServerNetwork(Server);
+			return false;
+		}
+
+		// The persistence thread wakes the worker through its eventfd once the transactions it holds answers of are durable.
+		if (Server.Persistence != nullptr)
+		{
+			worker.DurabilityEventDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			event.events = EPOLLIN;
+			event.data.ptr = &worker.DurabilityWaits;
+			if (worker.DurabilityEventDescriptor < 0 || epoll_ctl(worker.EpollDescriptor, EPOLL_CTL_ADD, worker.DurabilityEventDescriptor, &event) != 0)
+			{
+				std::cerr << "Failed to set up worker " << workerIndex << ", error " << errno << ".\n";
+				StopServerNetwork(Server);
+				return false;
+			}
+		}
+	}
+
+	if (Server.Persistence != nullptr)
+	{
+		std::vector<ServerDurabilityWaiter> waiters;
+		for (const ServerWorker& worker : Server.Workers)
+		{
+			waiters.push_back({ worker.DurabilityEventDescriptor, &worker.AwaitedSequence });
+		}
+		SetServerDurabilityWaiters(*Server.Persistence, std::move(waiters));
+	}
+
+	Server.bRunning = true;
+	for (ServerWorker& worker : Server.Workers)
+	{
+		worker.Thread = std::thread(RunServerWorker, std::ref(Server), std::ref(worker));
+	}
+
+	return true;
+}
+
+void StopServerNetwork(ServerState& Server)
+{
+	Server.bRunning = false;
+
+	for (ServerWorker& worker : Server.Workers)
+	{
+		if (worker.Thread.joinable())
+		{
+			worker.Thread.join();
+		}
+	}
+	if (Server.Persistence != nullptr)
+	{
+		SetServerDurabilityWaiters(*Server.Persistence, {});
+	}
+
+	for (ServerWorker& worker : Server.Workers)
+	{
+
+		while (!worker.Sessions.empty())
+		{
+			CloseSession(Server, worker, worker.Sessions.back());
+		}
+
+		if (worker.EpollDescriptor >= 0)
+		{
+			close(worker.EpollDescriptor);
+		}
+		if (worker.DurabilityEventDescriptor >= 0)
+		{
+			close(worker.DurabilityEventDescriptor);
+		}
+	}
+	Server.Workers.clear();
+
+	if (Server.ListenSocket >= 0)
+	{
+		close(Server.ListenSocket);
+		Server.ListenSocket = -1;
+	}
+}
+
+#else
+
+bool StartServerNetwork(ServerState& Server)
+{
+	std::cerr << "The Server's event loop relies on epoll, which is only available on Linux.\n";
+	return false;
+}
+
+void StopServerNetwork(ServerState& Server)
+{
+}
+
+#endif
@@ -0,0 +1,1261 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Server's persistence: the journal of committed transactions, snapshots of the graph, and recovery from both.
+
+#include "Server.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+
+/*
+	HOW IT WORKS
+
+	Transactions are journaled as they commit, while their shards are still held, so the journal holds them in the order they were
+	applied in. What a batch commits at once becomes one record: the changes its transactions logged, stamped with their sequence
+	numbers and checksummed. Records are copied into the filling one of two journal buffers, and a write of that buffer followed by a
+	flush of the file is submitted to the storage layer whenever none is in flight. Records arriving while one is in flight gather in
+	the other buffer and go with the next write, so a single flush makes many batches durable. Appenders only ever wait when the
+	filling buffer is full while the other one is still being written.
+
+	Workers hold the answers of committed transactions until the sequence of their batch is durable. They tell the persistence thread
+	which sequence they wait for, and it signals their eventfd once it is, so answers never go out for changes a crash could lose.
+
+	Once enough has been journaled, the persistence thread serializes the graph one shard at a time, holding each only while its own
+	nodes and the connections leaving them are serialized, and records the sequence the shard was at. It then writes the snapshot to a
+	temporary file, flushes it and renames it in place. Older snapshots and the journal files it covers, those up to the lowest of its
+	shard sequences, are then deleted.
+
+	On start, the newest valid snapshot is loaded and the journal records past its lowest shard sequence are replayed, each change only
+	if it is past the sequence of the shard of the node it describes. Shards serialized at different times see each other's nodes at
+	different points: a node can be missing from its shard, deleted before it was serialized or created after, while a node of a shard
+	serialized at another time still links to it. Such links are restored all the same, as cross-shard links outlive the nodes they
+	belong to, and the replayed journal then either removes them or creates the node, leaving the graph as it was at the last record.
+	The first record that is torn or fails its checksum ends the journal: writes complete in order and nothing past it was ever
+	acknowledged, so the journal is cut there. A new journal file is started on every run.
+*/
+
+#if defined(__linux__)
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr uint32_t SERVER_JOURNAL_RECORD_MAGIC = 0x4C4E524A; // "JRNL"
+constexpr uint32_t SERVER_SNAPSHOT_MAGIC = 0x50414E53; // "SNAP"
+constexpr uint32_t SERVER_SNAPSHOT_VERSION = 2;
+// Snapshots serialized with every shard held at once, without sequences of their own for shards.
+constexpr uint32_t SERVER_SNAPSHOT_VERSION_SINGLE_SEQUENCE = 1;
+
+// Snapshots are written in chunks, a few at a time, so they never take every storage slot from the journal.
+constexpr size_t SERVER_SNAPSHOT_CHUNK_SIZE = 1 << 20;
+constexpr uint32_t SERVER_SNAPSHOT_MAX_CHUNKS_IN_FLIGHT = 8;
+
+// How long the persistence thread waits for completions before checking whether it should stop.
+constexpr int SERVER_PERSISTENCE_POLL_TIMEOUT_MS = 100;
+
+// Tags of the persistence's storage requests.
+constexpr uint64_t SERVER_JOURNAL_REQUEST_TAG = 0;
+constexpr uint64_t SERVER_SNAPSHOT_REQUEST_TAG = 1;
+
+// Header of a journal record, followed by its changes: kind, access level, node and other node, then the name of created and renamed nodes.
+struct ServerJournalRecordHeader
+{
+	uint32_t Magic = SERVER_JOURNAL_RECORD_MAGIC;
+	uint32_t PayloadSize = 0;
+	uint64_t FirstSequence = 0;
+	uint32_t TransactionCount = 0;
+	uint32_t ChangeCount = 0;
+	uint64_t PayloadChecksum = 0;
+
+	// Of every field above.
+	uint64_t HeaderChecksum = 0;
+};
+
+// Header of a snapshot, followed by the sequence every shard was serialized at, its nodes shard by shard, then its connections.
+// Sequence is the lowest of the shards'.
+struct ServerSnapshotHeader
+{
+	uint32_t Magic = SERVER_SNAPSHOT_MAGIC;
+	uint32_t Version = SERVER_SNAPSHOT_VERSION;
+	uint32_t ShardCount = 0;
+	uint32_t Reserved = 0;
+	uint64_t Sequence = 0;
+	uint64_t RootID = SNODE_INVALID_ID;
+	uint64_t NodeCount = 0;
+	uint64_t ConnectionCount = 0;
+	uint64_t PayloadSize = 0;
+	uint64_t PayloadChecksum = 0;
+
+	// Of every field above.
+	uint64_t HeaderChecksum = 0;
+};
+
+// FNV-1a over 8 byte words, then over the bytes left.
+static uint64_t ComputePersistenceChecksum(const uint8_t* Data, size_t Size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	size_t offset = 0;
+	for (; offset + sizeof(uint64_t) <= Size; offset += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, Data + offset, sizeof(word));
+		hash = (hash ^ word) * 1099511628211ull;
+	}
+	for (; offset < Size; offset++)
+	{
+		hash = (hash ^ Data[offset]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// Storage failing leaves no way to keep what was acknowledged durable, so the server stops rather than go on without it.
+[[noreturn]] static void FailServerPersistence(const char* What, int Error)
+{
+	std::cerr << "Failed to write the " << What << ", error " << -Error << ". Stopping, as committed transactions can't be made durable.\n";
+	abort();
+}
+
+// ENCODING
+
+template<typename ValueType>
+static inline void AppendPersistedValue(std::vector<uint8_t>& Out, ValueType Value)
+{
+	const size_t offset = Out.size();
+	Out.resize(offset + sizeof(Value));
+	memcpy(Out.data() + offset, &Value, sizeof(Value));
+}
+
+// Names are at most 255 bytes long, see SNamePool.
+static inline void AppendPersistedName(std::vector<uint8_t>& Out, std::string_view Name)
+{
+	AppendPersistedValue<uint8_t>(Out, (uint8_t)Name.size());
+	Out.insert(Out.end(), Name.begin(), Name.end());
+}
+
+struct ServerPersistedReader
+{
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+	size_t Offset = 0;
+	bool bFailed = false;
+
+	template<typename ValueType>
+	ValueType Read()
+	{
+		ValueType value = ValueType();
+		if (bFailed || Size - Offset < sizeof(value))
+		{
+			bFailed = true;
+			return value;
+		}
+		memcpy(&value, Data + Offset, sizeof(value));
+		Offset += sizeof(value);
+		return value;
+	}
+
+	std::string_view ReadName()
+	{
+		const uint8_t length = Read<uint8_t>();
+		if (bFailed || Size - Offset < length)
+		{
+			bFailed = true;
+			return std::string_view();
+		}
+		const std::string_view name((const char*)Data + Offset, length);
+		Offset += length;
+		return name;
+	}
+};
+
+static inline bool IsPersistedAccessLevel(uint8_t AccessLevel)
+{
+	return AccessLevel <= (uint8_t)SNodeConnectionAccessLevel::OPEN;
+}
+
+// Whether the ID is that of a node the graph has room for.
+static bool FitsServerGraph(ServerGraph& Graph, SNodeGUID NodeID)
+{
+	if (NodeID == SNODE_INVALID_ID || IsCreatedNodeRef(NodeID))
+	{
+		return false;
+	}
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+	return node.LocalID < node.Shard->Store.MaxNodeCount;
+}
+
+// Whether a node with the ID fits in the graph and doesn't exist yet.
+static bool CanRestoreNode(ServerGraph& Graph, SNodeGUID NodeID)
+{
+	return FitsServerGraph(Graph, NodeID) && !ServerNodeExists(Graph, NodeID);
+}
+
+// Creates a node without a parent, interning its name in its shard.
+static bool RestoreNode(ServerGraph& Graph, SNodeGUID NodeID, std::string_view Name)
+{
+	if (!CanRestoreNode(Graph, NodeID))
+	{
+		return false;
+	}
+
+	const SNameHandle name = LocateNode(Graph, NodeID).Shard->Store.Names.Intern(Name);
+	if (name == SNAME_INVALID_HANDLE)
+	{
+		return false;
+	}
+	RawCreateNode(Graph, NodeID, name, SNODE_INVALID_ID);
+	return true;
+}
+
+// JOURNAL RECORDS
+
+// Encodes the transaction's logged changes after the record's header. Returns how many there are.
+static uint32_t EncodeJournalChanges(ServerGraph& Graph, const ServerShardTransaction& Transaction, std::vector<uint8_t>& Out)
+{
+	for (const SGraphTransactionLogEntry& entry : Transaction.Context.Log)
+	{
+		const SGraphChange& change = entry.Change;
+		AppendPersistedValue<uint8_t>(Out, (uint8_t)change.Kind);
+		AppendPersistedValue<uint8_t>(Out, (uint8_t)change.AccessLevel);
+		AppendPersistedValue<uint64_t>(Out, change.NodeID);
+		AppendPersistedValue<uint64_t>(Out, change.OtherID);
+
+		// Names are only reclaimed once the batch is journaled, so even a node deleted later in the batch still has its name there.
+		if (change.Kind == SGraphChangeKind::NODE_CREATED || change.Kind == SGraphChangeKind::NODE_RENAMED)
+		{
+			AppendPersistedName(Out, LocateNode(Graph, change.NodeID).Shard->Store.Names.Get(change.Value));
+		}
+	}
+	return (uint32_t)Transaction.Context.Log.size();
+}
+
+// Returns the size of the valid record starting the data, 0 if it is torn or corrupted.
+static size_t ValidateJournalRecord(const uint8_t* Data, size_t Size, ServerJournalRecordHeader& OutHeader)
+{
+	if (Size < sizeof(ServerJournalRecordHeader))
+	{
+		return 0;
+	}
+
+	memcpy(&OutHeader, Data, sizeof(OutHeader));
+	if (OutHeader.Magic != SERVER_JOURNAL_RECORD_MAGIC || OutHeader.TransactionCount == 0
+		|| OutHeader.HeaderChecksum != ComputePersistenceChecksum(Data, offsetof(ServerJournalRecordHeader, HeaderChecksum))
+		|| OutHeader.PayloadSize > Size - sizeof(OutHeader)
+		|| OutHeader.PayloadChecksum != ComputePersistenceChecksum(Data + sizeof(OutHeader), OutHeader.PayloadSize))
+	{
+		return 0;
+	}
+	return sizeof(OutHeader) + OutHeader.PayloadSize;
+}
+
+/*
+	Whether a node of another shard referred to by a change replayed at the sequence may be missing: its shard was serialized past the
+	change, possibly after the node was deleted. See HOW IT WORKS.
+*/
+static bool IsShardSerializedAfter(ServerGraph& Graph, const std::vector<uint64_t>& ShardSequences, SNodeGUID NodeID, uint64_t Sequence)
+{
+	return FitsServerGraph(Graph, NodeID) && ShardSequences[ShardOfNode(Graph, NodeID)] >= Sequence;
+}
+
+/*
+	Applies a record's changes the way their transactions did, skipping those describing nodes of shards the snapshot has past the
+	record's sequence. Returns false if they don't fit the graph.
+*/
+static bool ReplayJournalRecord(ServerGraph& Graph, const uint8_t* Payload, size_t PayloadSize, uint32_t ChangeCount,
+	const std::vector<uint64_t>& ShardSequences, uint64_t Sequence)
+{
+	ServerPersistedReader reader = { Payload, PayloadSize };
+	for (uint32_t changeIndex = 0; changeIndex < ChangeCount; changeIndex++)
+	{
+		const SGraphChangeKind kind = (SGraphChangeKind)reader.Read<uint8_t>();
+		const uint8_t accessLevel = reader.Read<uint8_t>();
+		const SNodeGUID nodeID = reader.Read<uint64_t>();
+		const SNodeGUID otherID = reader.Read<uint64_t>();
+		if (reader.bFailed)
+		{
+			return false;
+		}
+
+		// Changes belong to the shard of the node they describe, which the snapshot may already be past.
+		// Links to the other node are made even if it is gone from a shard serialized after the change, see IsShardSerializedAfter.
+		const bool bApplied = Sequence > ShardSequences[ShardOfNode(Graph, nodeID)];
+		if (bApplied && otherID != SNODE_INVALID_ID && kind != SGraphChangeKind::NODE_DELETED && kind != SGraphChangeKind::NODE_RENAMED
+			&& !ServerNodeExists(Graph, otherID) && !IsShardSerializedAfter(Graph, ShardSequences, otherID, Sequence))
+		{
+			return false;
+		}
+
+		switch (kind)
+		{
+		case SGraphChangeKind::NODE_CREATED:
+		{
+			// Names of skipped changes are read all the same, to get to the next change.
+			const std::string_view name = reader.ReadName();
+			if (reader.bFailed || (bApplied && !RestoreNode(Graph, nodeID, name)))
+			{
+				return false;
+			}
+			if (bApplied)
+			{
+				RawSetParent(Graph, nodeID, otherID);
+				if (otherID == SNODE_INVALID_ID)
+				{
+					Graph.RootID = nodeID;
+				}
+			}
+			break;
+		}
+		case SGraphChangeKind::NODE_DELETED:
+			if (bApplied)
+			{
+				if (!ServerNodeExists(Graph, nodeID))
+				{
+					return false;
+				}
+				RawDeleteNode(Graph, nodeID);
+			}
+			break;
+		case SGraphChangeKind::NODE_RENAMED:
+		{
+			const std::string_view name = reader.ReadName();
+			if (reader.bFailed || (bApplied && !ServerNodeExists(Graph, nodeID)))
+			{
+				return false;
+			}
+			if (!bApplied)
+			{
+				break;
+			}
+			const ServerShardNode node = LocateNode(Graph, nodeID);
+			const SNameHandle handle = node.Shard->Store.Names.Intern(name);
+			if (handle == SNAME_INVALID_HANDLE)
+			{
+				return false;
+			}
+			node.Shard->Store.RenameNode(node.LocalID, handle);
+			break;
+		}
+		case SGraphChangeKind::PARENT_CHANGED:
+			if (bApplied)
+			{
+				if (!ServerNodeExists(Graph, nodeID))
+				{
+					return false;
+				}
+				RawSetParent(Graph, nodeID, otherID);
+			}
+			break;
+		case SGraphChangeKind::CONNECTION_CHANGED:
+			if (!IsPersistedAccessLevel(accessLevel) || otherID == SNODE_INVALID_ID)
+			{
+				return false;
+			}
+			if (bApplied && (!ServerNodeExists(Graph, nodeID) || !RawSetConnection(Graph, nodeID, otherID, (SNodeConnectionAccessLevel)accessLevel)))
+			{
+				return false;
+			}
+			break;
+		default:
+			return false;
+		}
+	}
+	return reader.Offset == PayloadSize;
+}
+
+// SNAPSHOTS
+
+/*
+	Serializes the nodes of a shard and the connections leaving them, adding their counts to the header's. Only the shard must be held.
+	Nodes are listed parents first, and children in the order their parent lists them, so restoring them keeps that order. Children in
+	other shards aren't listed by their parent, so they have no order to keep.
+*/
+static void SerializeServerShard(ServerGraph& Graph, uint32_t ShardIndex, std::vector<uint8_t>& OutNodes, std::vector<uint8_t>& OutConnections,
+	ServerSnapshotHeader& OutHeader)
+{
+	const SGraphStore& store = Graph.Shards[ShardIndex].Store;
+
+	std::vector<SNodeGUID> nodes;
+	store.ForEachNode([&](SNodeGUID LocalID)
+	{
+		if (store.ParentIDs[LocalID] == SNODE_INVALID_ID)
+		{
+			nodes.push_back(LocalID);
+		}
+	});
+	for (size_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++)
+	{
+		store.ForEachChild(nodes[nodeIndex], [&](SNodeGUID ChildLocalID) { nodes.push_back(ChildLocalID); });
+	}
+
+	for (SNodeGUID localID : nodes)
+	{
+		const SNodeGUID nodeID = GlobalNodeID(Graph, ShardIndex, localID);
+		AppendPersistedValue<uint64_t>(OutNodes, nodeID);
+		AppendPersistedValue<uint64_t>(OutNodes, GetServerNodeParentID(Graph, nodeID));
+		AppendPersistedName(OutNodes, store.GetNodeName(localID));
+
+		ForEachServerConnection(Graph, nodeID, [&](SNodeGUID DestID, SNodeConnectionAccessLevel AccessLevel)
+		{
+			AppendPersistedValue<uint64_t>(OutConnections, nodeID);
+			AppendPersistedValue<uint64_t>(OutConnections, DestID);
+			AppendPersistedValue<uint8_t>(OutConnections, (uint8_t)AccessLevel);
+			OutHeader.ConnectionCount++;
+		});
+	}
+	OutHeader.NodeCount += nodes.size();
+}
+
+static void FinishSnapshotHeader(std::vector<uint8_t>& Data, ServerSnapshotHeader& Header)
+{
+	Header.PayloadSize = Data.size() - sizeof(Header);
+	Header.PayloadChecksum = ComputePersistenceChecksum(Data.data() + sizeof(Header), Header.PayloadSize);
+	Header.HeaderChecksum = ComputePersistenceChecksum((const uint8_t*)&Header, offsetof(ServerSnapshotHeader, HeaderChecksum));
+	memcpy(Data.data(), &Header, sizeof(Header));
+}
+
+static bool ValidateSnapshot(const std::vector<uint8_t>& Data, ServerSnapshotHeader& OutHeader)
+{
+	if (Data.size() < sizeof(ServerSnapshotHeader))
+	{
+		return false;
+	}
+
+	memcpy(&OutHeader, Data.data(), sizeof(OutHeader));
+	return OutHeader.Magic == SERVER_SNAPSHOT_MAGIC
+		&& (OutHeader.Version == SERVER_SNAPSHOT_VERSION || OutHeader.Version == SERVER_SNAPSHOT_VERSION_SINGLE_SEQUENCE)
+		&& OutHeader.HeaderChecksum == ComputePersistenceChecksum(Data.data(), offsetof(ServerSnapshotHeader, HeaderChecksum))
+		&& OutHeader.PayloadSize == Data.size() - sizeof(OutHeader)
+		&& OutHeader.PayloadChecksum == ComputePersistenceChecksum(Data.data() + sizeof(OutHeader), OutHeader.PayloadSize);
+}
+
+/*
+	Loads a valid snapshot into the empty graph, along with the sequence every shard was serialized at. Returns false if it doesn't fit
+	the graph. Links to nodes missing from shards serialized at another sequence are restored all the same, see HOW IT WORKS.
+*/
+static bool RestoreServerSnapshot(ServerGraph& Graph, const std::vector<uint8_t>& Data, const ServerSnapshotHeader& Header,
+	std::vector<uint64_t>& OutShardSequences)
+{
+	ServerPersistedReader reader = { Data.data() + sizeof(Header), (size_t)Header.PayloadSize };
+
+	OutShardSequences.assign(Graph.ShardCount, Header.Sequence);
+	if (Header.Version != SERVER_SNAPSHOT_VERSION_SINGLE_SEQUENCE)
+	{
+		for (uint64_t& shardSequence : OutShardSequences)
+		{
+			shardSequence = reader.Read<uint64_t>();
+		}
+	}
+
+	// Whether a node linked to by another may be missing. Only nodes of shards serialized at another sequence than the other's can be.
+	auto MayBeMissing = [&](SNodeGUID NodeID, SNodeGUID ReferrerID)
+	{
+		return FitsServerGraph(Graph, NodeID)
+			&& OutShardSequences[ShardOfNode(Graph, NodeID)] != OutShardSequences[ShardOfNode(Graph, ReferrerID)];
+	};
+
+	std::vector<std::pair<SNodeGUID, SNodeGUID>> parents;
+	for (uint64_t nodeIndex = 0; nodeIndex < Header.NodeCount; nodeIndex++)
+	{
+		const SNodeGUID nodeID = reader.Read<uint64_t>();
+		const SNodeGUID parentID = reader.Read<uint64_t>();
+		const std::string_view name = reader.ReadName();
+		if (reader.bFailed || !RestoreNode(Graph, nodeID, name))
+		{
+			return false;
+		}
+		parents.push_back({ nodeID, parentID });
+	}
+
+	// Children are linked in front of their siblings, so going backwards restores their order.
+	for (size_t nodeIndex = parents.size(); nodeIndex-- > 0;)
+	{
+		const SNodeGUID nodeID = parents[nodeIndex].first;
+		const SNodeGUID parentID = parents[nodeIndex].second;
+		if (parentID == SNODE_INVALID_ID)
+		{
+			continue;
+		}
+		if (!ServerNodeExists(Graph, parentID) && !MayBeMissing(parentID, nodeID))
+		{
+			return false;
+		}
+		RawSetParent(Graph, nodeID, parentID);
+	}
+
+	const size_t connectionsOffset = reader.Offset;
+	const size_t connectionSize = 2 * sizeof(uint64_t) + sizeof(uint8_t);
+	if (Header.ConnectionCount > (reader.Size - connectionsOffset) / connectionSize)
+	{
+		return false;
+	}
+	for (size_t connectionIndex = (size_t)Header.ConnectionCount; connectionIndex-- > 0;)
+	{
+		reader.Offset = connectionsOffset + connectionIndex * connectionSize;
+		const SNodeGUID src = reader.Read<uint64_t>();
+		const SNodeGUID dest = reader.Read<uint64_t>();
+		const uint8_t accessLevel = reader.Read<uint8_t>();
+		if (!ServerNodeExists(Graph, src) || !IsPersistedAccessLevel(accessLevel) || (!ServerNodeExists(Graph, dest) && !MayBeMissing(dest, src))
+			|| !RawSetConnection(Graph, src, dest, (SNodeConnectionAccessLevel)accessLevel))
+		{
+			return false;
+		}
+	}
+
+	Graph.RootID = Header.RootID;
+	return connectionsOffset + Header.ConnectionCount * connectionSize == reader.Size;
+}
+
+// FILES
+
+static std::string GetJournalFilePath(const ServerPersistence& Persistence, uint64_t Index)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "/journal-%016llu.log", (unsigned long long)Index);
+	return Persistence.Directory + name;
+}
+
+static std::string GetSnapshotFilePath(const ServerPersistence& Persistence, uint64_t Sequence, bool bTemporary)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "/snapshot-%020llu.%s", (unsigned long long)Sequence, bTemporary ? "tmp" : "bin");
+	return Persistence.Directory + name;
+}
+
+// Numbers of the directory's files named Prefix<number>Suffix, in increasing order.
+static std::vector<uint64_t> ListPersistenceFiles(const ServerPersistence& Persistence, const char* Prefix, const char* Suffix)
+{
+	std::vector<uint64_t> numbers;
+	DIR* directory = opendir(Persistence.Directory.c_str());
+	if (directory == nullptr)
+	{
+		return numbers;
+	}
+
+	const size_t prefixLength = strlen(Prefix);
+	const size_t suffixLength = strlen(Suffix);
+	while (const dirent* entry = readdir(directory))
+	{
+		const size_t nameLength = strlen(entry->d_name);
+		if (nameLength > prefixLength + suffixLength && strncmp(entry->d_name, Prefix, prefixLength) == 0
+			&& strcmp(entry->d_name + nameLength - suffixLength, Suffix) == 0)
+		{
+			numbers.push_back(strtoull(entry->d_name + prefixLength, nullptr, 10));
+		}
+	}
+	closedir(directory);
+
+	std::sort(numbers.begin(), numbers.end());
+	return numbers;
+}
+
+static bool ReadPersistenceFile(const std::string& Path, std::vector<uint8_t>& OutData)
+{
+	const int descriptor = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (descriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat status;
+	bool bSuccess = fstat(descriptor, &status) == 0;
+	OutData.resize(bSuccess ? (size_t)status.st_size : 0);
+	for (size_t readSize = 0; bSuccess && readSize < OutData.size();)
+	{
+		const ssize_t result = pread(descriptor, OutData.data() + readSize, OutData.size() - readSize, (off_t)readSize);
+		if (result < 0 && errno == EINTR) continue;
+		bSuccess = result > 0;
+		readSize += bSuccess ? (size_t)result : 0;
+	}
+	close(descriptor);
+	return bSuccess;
+}
+
+// Makes files created, renamed or deleted in the directory durable.
+static void SyncPersistenceDirectory(const ServerPersistence& Persistence)
+{
+	const int descriptor = open(Persistence.Directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (descriptor >= 0)
+	{
+		if (Persistence.bSync) fsync(descriptor);
+		close(descriptor);
+	}
+}
+
+static bool OpenJournalFile(const ServerPersistence& Persistence, uint64_t Index, ServerJournalFile& OutFile)
+{
+	OutFile = ServerJournalFile();
+	OutFile.Index = Index;
+	OutFile.Descriptor = open(GetJournalFilePath(Persistence, Index).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (OutFile.Descriptor < 0)
+	{
+		return false;
+	}
+	SyncPersistenceDirectory(Persistence);
+	return true;
+}
+
+// JOURNAL
+
+// Submits the write of the filling buffer, which then stops filling. Must be called holding the lock, with no flush in flight.
+static void StartJournalFlush(ServerPersistence& Persistence)
+{
+	const uint32_t bufferIndex = Persistence.FillingBuffer;
+	ServerJournalBuffer& buffer = Persistence.Buffers[bufferIndex];
+
+	if (Persistence.ActiveFile.Size >= SERVER_JOURNAL_FILE_SIZE && Persistence.NextFile.Descriptor >= 0 && !Persistence.bActiveFileEndsInRecord)
+	{
+		close(Persistence.ActiveFile.Descriptor);
+		Persistence.ActiveFile.Descriptor = -1;
+		Persistence.ClosedFiles.push_back(Persistence.ActiveFile);
+		Persistence.ActiveFile = Persistence.NextFile;
+		Persistence.NextFile = ServerJournalFile();
+	}
+
+	ServerStorageRequest request;
+	request.FileDescriptor = Persistence.ActiveFile.Descriptor;
+	request.Data = buffer.Data;
+	request.Size = buffer.Size;
+	request.Offset = Persistence.ActiveFile.Size;
+	request.BufferIndex = (int32_t)bufferIndex;
+	request.bSync = Persistence.bSync;
+	request.Tag = SERVER_JOURNAL_REQUEST_TAG;
+	if (!SubmitStorageRequests(Persistence.Storage, &request, 1))
+	{
+		FailServerPersistence("journal", -EAGAIN);
+	}
+
+	Persistence.ActiveFile.Size += buffer.Size;
+	if (buffer.LastSequence != 0)
+	{
+		Persistence.ActiveFile.LastSequence = buffer.LastSequence;
+		Persistence.FlushSequence = buffer.LastSequence;
+	}
+	Persistence.bActiveFileEndsInRecord = buffer.bEndsInRecord;
+	Persistence.BytesSinceSnapshot += buffer.Size;
+
+	Persistence.bFlushInFlight = true;
+	Persistence.FlushStartTime = std::chrono::steady_clock::now();
+	Persistence.FillingBuffer = bufferIndex ^ 1;
+}
+
+// Copies a record into the journal's buffers, flushing them as they fill up. Must be called holding the append lock.
+static void WriteJournalRecord(ServerPersistence& Persistence, const uint8_t* Record, size_t RecordSize, uint64_t LastSequence)
+{
+	std::unique_lock<std::mutex> lock(Persistence.Lock);
+
+	size_t writtenSize = 0;
+	while (writtenSize < RecordSize)
+	{
+		ServerJournalBuffer& buffer = Persistence.Buffers[Persistence.FillingBuffer];
+		if (buffer.Size == SERVER_JOURNAL_BUFFER_SIZE)
+		{
+			buffer.bEndsInRecord = true;
+			if (Persistence.bFlushInFlight)
+			{
+				Persistence.BackpressureWaitCount.Add(1);
+				Persistence.BufferFlushed.wait(lock, [&]() { return !Persistence.bFlushInFlight; });
+			}
+			StartJournalFlush(Persistence);
+			continue;
+		}
+
+		const size_t copySize = std::min(RecordSize - writtenSize, SERVER_JOURNAL_BUFFER_SIZE - buffer.Size);
+		memcpy(buffer.Data + buffer.Size, Record + writtenSize, copySize);
+		buffer.Size += copySize;
+		writtenSize += copySize;
+	}
+
+	Persistence.Buffers[Persistence.FillingBuffer].LastSequence = LastSequence;
+	Persistence.JournalByteCount.Add(RecordSize);
+
+	if (!Persistence.bFlushInFlight)
+	{
+		StartJournalFlush(Persistence);
+	}
+}
+
+uint64_t AppendServerJournal(ServerPersistence& Persistence, ServerGraph& Graph, ServerShardTransaction& Transaction, size_t TransactionCount)
+{
+	std::vector<uint8_t>& record = Transaction.JournalRecord;
+	record.assign(sizeof(ServerJournalRecordHeader), 0);
+
+	ServerJournalRecordHeader header;
+	header.ChangeCount = EncodeJournalChanges(Graph, Transaction, record);
+	header.TransactionCount = (uint32_t)TransactionCount;
+	header.PayloadSize = (uint32_t)(record.size() - sizeof(header));
+	header.PayloadChecksum = ComputePersistenceChecksum(record.data() + sizeof(header), header.PayloadSize);
+
+	// Sequence numbers are taken in journal order.
+	std::lock_guard<std::mutex> appendLock(Persistence.AppendLock);
+	const uint64_t sequence = Graph.TransactionSequence.fetch_add(TransactionCount, std::memory_order_relaxed);
+	header.FirstSequence = sequence + 1;
+	header.HeaderChecksum = ComputePersistenceChecksum((const uint8_t*)&header, offsetof(ServerJournalRecordHeader, HeaderChecksum));
+	memcpy(record.data(), &header, sizeof(header));
+
+	WriteJournalRecord(Persistence, record.data(), record.size(), sequence + TransactionCount);
+	return sequence;
+}
+
+static void NotifyDurabilityWaiters(ServerPersistence& Persistence, uint64_t DurableSequence)
+{
+	std::lock_guard<std::mutex> lock(Persistence.WaiterLock);
+	for (const ServerDurabilityWaiter& waiter : Persistence.Waiters)
+	{
+		const uint64_t awaitedSequence = waiter.AwaitedSequence->load();
+		if (awaitedSequence != 0 && awaitedSequence <= DurableSequence)
+		{
+			const uint64_t one = 1;
+			while (write(waiter.EventDescriptor, &one, sizeof(one)) < 0 && errno == EINTR) {}
+		}
+	}
+}
+
+void SetServerDurabilityWaiters(ServerPersistence& Persistence, std::vector<ServerDurabilityWaiter> Waiters)
+{
+	std::lock_guard<std::mutex> lock(Persistence.WaiterLock);
+	Persistence.Waiters = std::move(Waiters);
+}
+
+static void CompleteJournalFlush(ServerPersistence& Persistence)
+{
+	uint64_t durableSequence;
+	{
+		std::lock_guard<std::mutex> lock(Persistence.Lock);
+		ServerJournalBuffer& flushedBuffer = Persistence.Buffers[Persistence.FillingBuffer ^ 1];
+		flushedBuffer.Size = 0;
+		flushedBuffer.LastSequence = 0;
+		flushedBuffer.bEndsInRecord = false;
+		Persistence.bFlushInFlight = false;
+		durableSequence = Persistence.FlushSequence;
+
+		Persistence.JournalFlushLatency.Record(
+			(uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Persistence.FlushStartTime).count());
+		Persistence.JournalFlushCount.Add(1);
+
+		// Records gathered meanwhile go right away.
+		if (Persistence.Buffers[Persistence.FillingBuffer].Size > 0)
+		{
+			StartJournalFlush(Persistence);
+		}
+	}
+	Persistence.BufferFlushed.notify_all();
+
+	if (durableSequence > Persistence.DurableSequence.load())
+	{
+		Persistence.DurableSequence.store(durableSequence);
+		NotifyDurabilityWaiters(Persistence, durableSequence);
+	}
+}
+
+// Opens the next journal file ahead of time once the active one is half full, so that flushes never wait on it.
+static void PrepareNextJournalFile(ServerPersistence& Persistence)
+{
+	uint64_t nextIndex;
+	{
+		std::lock_guard<std::mutex> lock(Persistence.Lock);
+		if (Persistence.NextFile.Descriptor >= 0 || Persistence.ActiveFile.Size < SERVER_JOURNAL_FILE_SIZE / 2)
+		{
+			return;
+		}
+		nextIndex = Persistence.ActiveFile.Index + 1;
+	}
+
+	ServerJournalFile file;
+	if (!OpenJournalFile(Persistence, nextIndex, file))
+	{
+		FailServerPersistence("journal", -errno);
+	}
+
+	std::lock_guard<std::mutex> lock(Persistence.Lock);
+	Persistence.NextFile = file;
+}
+
+// SNAPSHOT WRITES
+
+// Serializes the graph one shard at a time, holding each only for its own part, then starts writing it to a temporary file.
+static void BeginServerSnapshot(ServerPersistence& Persistence)
+{
+	ServerGraph& graph = *Persistence.Graph;
+	ServerSnapshotHeader header;
+	header.ShardCount = graph.ShardCount;
+	header.Sequence = UINT64_MAX;
+
+	std::vector<uint8_t>& data = Persistence.SnapshotData;
+	data.assign(sizeof(ServerSnapshotHeader) + sizeof(uint64_t) * graph.ShardCount, 0);
+	std::vector<uint8_t> connections;
+	for (uint32_t shardIndex = 0; shardIndex < graph.ShardCount; shardIndex++)
+	{
+		// Batches touching the shard take their sequences while holding it, so it has every one up to the counter's and none past it.
+		const std::chrono::steady_clock::time_point pauseStart = std::chrono::steady_clock::now();
+		const ServerShardMask shard = (ServerShardMask)1 << shardIndex;
+		LockShards(graph, shard);
+		const uint64_t shardSequence = graph.TransactionSequence.load(std::memory_order_relaxed);
+		SerializeServerShard(graph, shardIndex, data, connections, header);
+		UnlockShards(graph, shard);
+		Persistence.SnapshotPauseLatency.Record(
+			(uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - pauseStart).count());
+
+		memcpy(data.data() + sizeof(ServerSnapshotHeader) + sizeof(uint64_t) * shardIndex, &shardSequence, sizeof(shardSequence));
+		header.Sequence = std::min(header.Sequence, shardSequence);
+	}
+	data.insert(data.end(), connections.begin(), connections.end());
+	header.RootID = graph.RootID.load(std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(Persistence.Lock);
+		Persistence.BytesSinceSnapshot = 0;
+	}
+
+	FinishSnapshotHeader(Persistence.SnapshotData, header);
+	Persistence.SnapshotSequence = header.Sequence;
+	Persistence.SnapshotSubmittedSize = 0;
+	Persistence.SnapshotPendingCount = 0;
+	Persistence.bSnapshotSyncing = false;
+	Persistence.bSnapshotFailed = false;
+
+	const std::string path = GetSnapshotFilePath(Persistence, header.Sequence, true);
+	Persistence.SnapshotDescriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (Persistence.SnapshotDescriptor < 0)
+	{
+		std::cerr << "Failed to create " << path << ", error " << errno << ". The journal keeps growing until a snapshot succeeds.\n";
+		std::vector<uint8_t>().swap(Persistence.SnapshotData);
+	}
+}
+
+// Renames the written snapshot in place, then deletes what it makes useless.
+static void FinishServerSnapshot(ServerPersistence& Persistence)
+{
+	close(Persistence.SnapshotDescriptor);
+	Persistence.SnapshotDescriptor = -1;
+
+	const uint64_t sequence = Persistence.SnapshotSequence;
+	const std::string temporaryPath = GetSnapshotFilePath(Persistence, sequence, true);
+	if (Persistence.bSnapshotFailed || rename(temporaryPath.c_str(), GetSnapshotFilePath(Persistence, sequence, false).c_str()) != 0)
+	{
+		std::cerr << "Failed to write the snapshot at sequence " << sequence << ". The journal keeps growing until a snapshot succeeds.\n";
+		unlink(temporaryPath.c_str());
+		std::vector<uint8_t>().swap(Persistence.SnapshotData);
+		return;
+	}
+	SyncPersistenceDirectory(Persistence);
+
+	Persistence.SnapshotCount.Add(1);
+	Persistence.SnapshotByteCount.Add(Persistence.SnapshotData.size());
+	std::vector<uint8_t>().swap(Persistence.SnapshotData);
+
+	for (uint64_t snapshotSequence : ListPersistenceFiles(Persistence, "snapshot-", ".bin"))
+	{
+		if (snapshotSequence < sequence)
+		{
+			unlink(GetSnapshotFilePath(Persistence, snapshotSequence, false).c_str());
+		}
+	}
+
+	std::vector<uint64_t> coveredFiles;
+	{
+		std::lock_guard<std::mutex> lock(Persistence.Lock);
+		auto kept = std::remove_if(Persistence.ClosedFiles.begin(), Persistence.ClosedFiles.end(), [&](const ServerJournalFile& File)
+		{
+			if (File.LastSequence <= sequence)
+			{
+				coveredFiles.push_back(File.Index);
+				return true;
+			}
+			return false;
+		});
+		Persistence.ClosedFiles.erase(kept, Persistence.ClosedFiles.end());
+	}
+	for (uint64_t fileIndex : coveredFiles)
+	{
+		unlink(GetJournalFilePath(Persistence, fileIndex).c_str());
+	}
+}
+
+// Submits the snapshot's next chunks together, then its flush once every chunk is written.
+static void AdvanceServerSnapshot(ServerPersistence& Persistence)
+{
+	const std::vector<uint8_t>& data = Persistence.SnapshotData;
+
+	ServerStorageRequest requests[SERVER_SNAPSHOT_MAX_CHUNKS_IN_FLIGHT];
+	uint32_t requestCount = 0;
+	size_t submittedSize = Persistence.SnapshotSubmittedSize;
+	while (!Persistence.bSnapshotFailed && Persistence.SnapshotPendingCount + requestCount < SERVER_SNAPSHOT_MAX_CHUNKS_IN_FLIGHT
+		&& submittedSize < data.size())
+	{
+		ServerStorageRequest& request = requests[requestCount++];
+		request.FileDescriptor = Persistence.SnapshotDescriptor;
+		request.Data = data.data() + submittedSize;
+		request.Size = std::min(SERVER_SNAPSHOT_CHUNK_SIZE, data.size() - submittedSize);
+		request.Offset = submittedSize;
+		request.Tag = SERVER_SNAPSHOT_REQUEST_TAG;
+		submittedSize += request.Size;
+	}
+
+	if (requestCount > 0)
+	{
+		if (!SubmitStorageRequests(Persistence.Storage, requests, requestCount))
+		{
+			return;
+		}
+		Persistence.SnapshotSubmittedSize = submittedSize;
+		Persistence.SnapshotPendingCount += requestCount;
+	}
+
+	if (Persistence.SnapshotPendingCount > 0 || (!Persistence.bSnapshotFailed && Persistence.SnapshotSubmittedSize < data.size()))
+	{
+		return;
+	}
+
+	// Chunks were written in any order, the flush covers them all.
+	if (!Persistence.bSnapshotFailed && !Persistence.bSnapshotSyncing && Persistence.bSync)
+	{
+		ServerStorageRequest request;
+		request.FileDescriptor = Persistence.SnapshotDescriptor;
+		request.bSync = true;
+		request.Tag = SERVER_SNAPSHOT_REQUEST_TAG;
+		if (SubmitStorageRequests(Persistence.Storage, &request, 1))
+		{
+			Persistence.bSnapshotSyncing = true;
+			Persistence.SnapshotPendingCount++;
+		}
+		return;
+	}
+
+	FinishServerSnapshot(Persistence);
+}
+
+// PERSISTENCE THREAD
+
+// Waits up to the passed time for storage completions and handles them, then moves snapshots and journal files along.
+static void RunPersistenceStep(ServerPersistence& Persistence, int TimeoutMs)
+{
+	pollfd pollDescriptor = { Persistence.Storage.CompletionEventDescriptor, POLLIN, 0 };
+	poll(&pollDescriptor, 1, TimeoutMs);
+
+	std::vector<ServerStorageCompletion> completions;
+	ReapStorageCompletions(Persistence.Storage, completions);
+	for (const ServerStorageCompletion& completion : completions)
+	{
+		if (completion.Tag == SERVER_JOURNAL_REQUEST_TAG)
+		{
+			if (completion.Result != 0)
+			{
+				FailServerPersistence("journal", completion.Result);
+			}
+			CompleteJournalFlush(Persistence);
+		}
+		else
+		{
+			Persistence.bSnapshotFailed |= completion.Result != 0;
+			Persistence.SnapshotPendingCount--;
+		}
+	}
+
+	if (Persistence.SnapshotDescriptor >= 0)
+	{
+		AdvanceServerSnapshot(Persistence);
+	}
+	else if (Persistence.bRunning)
+	{
+		bool bSnapshotDue;
+		{
+			std::lock_guard<std::mutex> lock(Persistence.Lock);
+			bSnapshotDue = Persistence.BytesSinceSnapshot >= Persistence.SnapshotJournalSize;
+		}
+		if (bSnapshotDue)
+		{
+			BeginServerSnapshot(Persistence);
+		}
+	}
+
+	PrepareNextJournalFile(Persistence);
+}
+
+static void RunPersistenceThread(ServerPersistence* Persistence)
+{
+	for (;;)
+	{
+		RunPersistenceStep(*Persistence, SERVER_PERSISTENCE_POLL_TIMEOUT_MS);
+
+		// Once stopped, runs until every journaled record is durable and the snapshot in progress is done.
+		if (!Persistence->bRunning && Persistence->SnapshotDescriptor < 0)
+		{
+			std::lock_guard<std::mutex> lock(Persistence->Lock);
+			if (!Persistence->bFlushInFlight && Persistence->Buffers[Persistence->FillingBuffer].Size == 0)
+			{
+				return;
+			}
+		}
+	}
+}
+
+// RECOVERY
+
+// Loads the newest valid snapshot, then replays the journal past it. Sets OutSequence to the last transaction restored.
+static bool RecoverServerGraph(ServerPersistence& Persistence, const ServerConfig& Config, ServerGraph& Graph, uint64_t& OutSequence,
+	uint64_t& OutNextFileIndex)
+{
+	for (uint64_t sequence : ListPersistenceFiles(Persistence, "snapshot-", ".tmp"))
+	{
+		unlink(GetSnapshotFilePath(Persistence, sequence, true).c_str());
+	}
+
+	const std::vector<uint64_t> snapshots = ListPersistenceFiles(Persistence, "snapshot-", ".bin");
+	const std::vector<uint64_t> journalFiles = ListPersistenceFiles(Persistence, "journal-", ".log");
+	OutSequence = 0;
+	OutNextFileIndex = journalFiles.empty() ? 1 : journalFiles.back() + 1;
+
+	if (snapshots.empty())
+	{
+		if (!journalFiles.empty())
+		{
+			std::cerr << Persistence.Directory << " holds a journal without any snapshot to replay it on.\n";
+			return false;
+		}
+		return InitializeServerGraph(Graph, Config);
+	}
+
+	if (!AllocateServerShards(Graph, Config))
+	{
+		return false;
+	}
+
+	// Falls back on older snapshots if the newest is damaged, the journal still holds what came after them until they are deleted.
+	std::vector<uint8_t> data;
+	ServerSnapshotHeader header;
+	std::vector<uint64_t> shardSequences;
+	bool bRestored = false;
+	for (size_t snapshotIndex = snapshots.size(); snapshotIndex-- > 0 && !bRestored;)
+	{
+		const std::string path = GetSnapshotFilePath(Persistence, snapshots[snapshotIndex], false);
+		if (!ReadPersistenceFile(path, data) || !ValidateSnapshot(data, header))
+		{
+			std::cerr << "Ignoring damaged snapshot " << path << ".\n";
+			continue;
+		}
+		if (header.ShardCount != Graph.ShardCount)
+		{
+			std::cerr << path << " was written with " << header.ShardCount << " shards, start the server with --shards " << header.ShardCount << ".\n";
+			return false;
+		}
+		if (!RestoreServerSnapshot(Graph, data, header, shardSequences))
+		{
+			std::cerr << "Failed to restore " << path << ", the graph's capacity may be too small for it.\n";
+			return false;
+		}
+		OutSequence = header.Sequence;
+		bRestored = true;
+	}
+	if (!bRestored)
+	{
+		std::cerr << "No valid snapshot in " << Persistence.Directory << ".\n";
+		return false;
+	}
+	std::vector<uint8_t>().swap(data);
+
+	bool bJournalEnded = false;
+	for (uint64_t fileIndex : journalFiles)
+	{
+		const std::string path = GetJournalFilePath(Persistence, fileIndex);
+		if (bJournalEnded || !ReadPersistenceFile(path, data))
+		{
+			unlink(path.c_str());
+			continue;
+		}
+
+		ServerJournalFile file;
+		file.Index = fileIndex;
+		ServerJournalRecordHeader recordHeader;
+		while (size_t recordSize = ValidateJournalRecord(data.data() + file.Size, data.size() - file.Size, recordHeader))
+		{
+			const uint64_t lastSequence = recordHeader.FirstSequence + recordHeader.TransactionCount - 1;
+			if (lastSequence > OutSequence)
+			{
+				// Records older than the snapshot are skipped, then they must follow each other.
+				if (recordHeader.FirstSequence != OutSequence + 1)
+				{
+					break;
+				}
+				if (!ReplayJournalRecord(Graph, data.data() + file.Size + sizeof(recordHeader), recordHeader.PayloadSize, recordHeader.ChangeCount,
+					shardSequences, recordHeader.FirstSequence))
+				{
+					std::cerr << "Failed to replay the journal record of sequence " << recordHeader.FirstSequence << " in " << path
+						<< ", the graph's capacity may be too small for it.\n";
+					return false;
+				}
+				ReclaimShardNames(Graph, GetAllShardsMask(Graph));
+				OutSequence = lastSequence;
+			}
+			file.LastSequence = lastSequence;
+			file.Size += recordSize;
+		}
+
+		if (file.Size < data.size())
+		{
+			std::cerr << "Cutting " << data.size() - file.Size << " bytes of unfinished or damaged records at the end of " << path << ".\n";
+			if (truncate(path.c_str(), (off_t)file.Size) != 0)
+			{
+				std::cerr << "Failed to cut " << path << ", error " << errno << ".\n";
+				return false;
+			}
+			bJournalEnded = true;
+		}
+		if (file.Size == 0)
+		{
+			unlink(path.c_str());
+			continue;
+		}
+		Persistence.ClosedFiles.push_back(file);
+	}
+	return true;
+}
+
+static void ReleaseServerPersistence(ServerPersistence& Persistence)
+{
+	ShutdownServerStorage(Persistence.Storage);
+	for (ServerJournalFile* file : { &Persistence.ActiveFile, &Persistence.NextFile })
+	{
+		if (file->Descriptor >= 0)
+		{
+			close(file->Descriptor);
+			file->Descriptor = -1;
+		}
+	}
+	if (Persistence.SnapshotDescriptor >= 0)
+	{
+		close(Persistence.SnapshotDescriptor);
+		Persistence.SnapshotDescriptor = -1;
+	}
+	for (ServerJournalBuffer& buffer : Persistence.Buffers)
+	{
+		free(buffer.Data);
+		buffer.Data = nullptr;
+	}
+}
+
+bool OpenServerPersistence(ServerState& Server)
+{
+	const ServerConfig& config = Server.Config;
+	Server.Persistence.reset(new ServerPersistence());
+	ServerPersistence& persistence = *Server.Persistence;
+	persistence.Directory = config.DataDirectory;
+	persistence.bSync = config.bSyncJournal;
+	persistence.SnapshotJournalSize = config.SnapshotJournalSize;
+	persistence.Graph = &Server.Graph;
+
+	if (mkdir(config.DataDirectory, 0755) != 0 && errno != EEXIST)
+	{
+		std::cerr << "Failed to create " << config.DataDirectory << ", error " << errno << ".\n";
+		Server.Persistence.reset();
+		return false;
+	}
+
+	uint8_t* buffers[2];
+	size_t bufferSizes[2];
+	for (uint32_t bufferIndex = 0; bufferIndex < 2; bufferIndex++)
+	{
+		persistence.Buffers[bufferIndex].Data = (uint8_t*)aligned_alloc(4096, SERVER_JOURNAL_BUFFER_SIZE);
+		buffers[bufferIndex] = persistence.Buffers[bufferIndex].Data;
+		bufferSizes[bufferIndex] = SERVER_JOURNAL_BUFFER_SIZE;
+	}
+	if (buffers[0] == nullptr || buffers[1] == nullptr || !InitializeServerStorage(persistence.Storage, config.StorageBackend, buffers, bufferSizes, 2))
+	{
+		std::cerr << "Failed to start the " << GetServerStorageBackendName(config.StorageBackend) << " storage backend.\n";
+		ReleaseServerPersistence(persistence);
+		Server.Persistence.reset();
+		return false;
+	}
+
+	uint64_t sequence = 0;
+	uint64_t nextFileIndex = 1;
+	const bool bHadSnapshot = !ListPersistenceFiles(persistence, "snapshot-", ".bin").empty();
+	if (!RecoverServerGraph(persistence, config, Server.Graph, sequence, nextFileIndex)
+		|| !OpenJournalFile(persistence, nextFileIndex, persistence.ActiveFile))
+	{
+		ReleaseServerPersistence(persistence);
+		Server.Persistence.reset();
+		return false;
+	}
+
+	Server.Graph.TransactionSequence = sequence;
+	persistence.DurableSequence = sequence;
+	Server.Graph.Persistence = &persistence;
+
+	// A graph seeded from scratch is snapshot before anything else, so it is never seeded again.
+	if (!bHadSnapshot)
+	{
+		BeginServerSnapshot(persistence);
+		while (persistence.SnapshotDescriptor >= 0)
+		{
+			RunPersistenceStep(persistence, SERVER_PERSISTENCE_POLL_TIMEOUT_MS);
+		}
+		if (persistence.SnapshotCount.Get() == 0)
+		{
+			Server.Graph.Persistence = nullptr;
+			ReleaseServerPersistence(persistence);
+			Server.Persistence.reset();
+			return false;
+		}
+	}
+	else
+	{
+		std::cout << "Restored " << GetServerGraphNodeCount(Server.Graph) << " nodes from " << config.DataDirectory << " up to transaction "
+			<< sequence << ".\n";
+	}
+
+	std::cout << "Journaling to " << config.DataDirectory << " with the " << GetServerStorageBackendName(persistence.Storage.Backend)
+		<< " storage backend" << (persistence.bSync ? ".\n" : ", without flushing to the device.\n");
+
+	persistence.bRunning = true;
+	persistence.Thread = std::thread(RunPersistenceThread, &persistence);
+	return true;
+}
+
+void CloseServerPersistence(ServerState& Server)
+{
+	if (Server.Persistence == nullptr)
+	{
+		return;
+	}
+
+	ServerPersistence& persistence = *Server.Persistence;
+	persistence.bRunning = false;
+	if (persistence.Thread.joinable())
+	{
+		persistence.Thread.join();
+	}
+
+	Server.Graph.Persistence = nullptr;
+	ReleaseServerPersistence(persistence);
+	Server.Persistence.reset();
+}
+
+#else
+
+bool OpenServerPersistence(ServerState& Server)
+{
+	std::cerr << "Persistence is only available on Linux.\n";
+	return false;
+}
+
+void CloseServerPersistence(ServerState& Server)
+{
+}
+
+uint64_t AppendServerJournal(ServerPersistence& Persistence, ServerGraph& Graph, ServerShardTransaction& Transaction, size_t TransactionCount)
+{
+	return Graph.TransactionSequence.fetch_add(TransactionCount, std::memory_order_relaxed);
+}
+
+void SetServerDurabilityWaiters(ServerPersistence& Persistence, std::vector<ServerDurabilityWaiter> Waiters)
+{
+}
+
+#endif
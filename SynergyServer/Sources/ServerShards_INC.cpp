@@ -0,0 +1,1063 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Server's sharded graph: node placement, cross-shard links, and transactions spanning several shards.
+
+#include "Server.h"
+
+#include <algorithm>
+
+/*
+	HOW IT WORKS
+
+	Nodes live in the shard of their parent, so a subtree stays within a single shard and edits to it only involve that shard.
+	The exception is the root's children: they are spread over shards, each taking its subtree along.
+	Links a shard's store can't hold, parents and connections between nodes of different shards, are kept on both sides in the
+	shards' remote links.
+
+	Transactions are applied in two phases.
+	- Prepare: the ops are read once to find which shards they touch and where created nodes go. Those shards are locked, always in
+	  index order so transactions can't deadlock each other, then the ops are applied with an undo log as with a single store.
+	  Ops may find they need more shards than expected, when a node has links with other shards or to walk its ancestors. The transaction
+	  is then rolled back, its locks released, and it starts over with the missing shards locked as well.
+	- Commit: once every op succeeded, each shard's share of the changes is published to its journal, then the shards are unlocked.
+	  On failure the undo log is played backwards instead.
+
+	Transactions a worker receives together are applied as a batch: the shards of all of them are locked once, each transaction is applied
+	or rolled back on its own in turn, and the changes of those that succeeded are published together. A transaction needing shards the
+	batch doesn't hold commits what came before it, then the batch goes on with them locked as well.
+
+	Concurrency control is optimistic. Clients build transactions from their copy of the graph, and FETCH_NODE ops carry the version each
+	node had then. Versions are the shard stores' modification stamps, which remote links touch as well, and rollbacks restore. A node that
+	changed since makes the transaction fail with CONFLICT, including when the change came from an earlier transaction of the same batch.
+*/
+
+// NODE LOCATION
+
+static inline uint32_t ShardOfNode(const ServerGraph& Graph, SNodeGUID NodeID)
+{
+	return (uint32_t)(NodeID % Graph.ShardCount);
+}
+
+static inline SNodeGUID LocalNodeID(const ServerGraph& Graph, SNodeGUID NodeID)
+{
+	return NodeID / Graph.ShardCount;
+}
+
+static inline SNodeGUID GlobalNodeID(const ServerGraph& Graph, uint32_t ShardIndex, SNodeGUID LocalID)
+{
+	return LocalID == SNODE_INVALID_ID ? SNODE_INVALID_ID : LocalID * Graph.ShardCount + ShardIndex;
+}
+
+// A node as found in its shard.
+struct ServerShardNode
+{
+	ServerShard* Shard = nullptr;
+	SNodeGUID LocalID = SNODE_INVALID_ID;
+};
+
+static inline ServerShardNode LocateNode(ServerGraph& Graph, SNodeGUID NodeID)
+{
+	return { &Graph.Shards[ShardOfNode(Graph, NodeID)], LocalNodeID(Graph, NodeID) };
+}
+
+// Whether the transaction holds the shard. Shards it doesn't hold are recorded as missing.
+static inline bool AccessShard(ServerShardTransaction& Transaction, uint32_t ShardIndex)
+{
+	const ServerShardMask shardBit = (ServerShardMask)1 << ShardIndex;
+	if ((Transaction.LockedShards & shardBit) == 0)
+	{
+		Transaction.MissingShards |= shardBit;
+		return false;
+	}
+	return true;
+}
+
+/*
+	Finds an existing node in the shards held by the transaction.
+	Returns false if it doesn't exist, or if its shard isn't held which gets it recorded as missing.
+*/
+static bool FindNode(ServerGraph& Graph, ServerShardTransaction& Transaction, SNodeGUID NodeID, ServerShardNode& OutNode)
+{
+	if (NodeID == SNODE_INVALID_ID || IsCreatedNodeRef(NodeID) || !AccessShard(Transaction, ShardOfNode(Graph, NodeID)))
+	{
+		return false;
+	}
+
+	OutNode = LocateNode(Graph, NodeID);
+	return OutNode.Shard->Store.NodeExists(OutNode.LocalID);
+}
+
+// REMOTE LINKS
+
+static inline ServerRemoteLinks* FindRemoteLinks(const ServerShardNode& Node)
+{
+	auto found = Node.Shard->RemoteLinks.find(Node.LocalID);
+	return found != Node.Shard->RemoteLinks.end() ? &found->second : nullptr;
+}
+
+// Drops the node's remote links entry once it holds nothing.
+static inline void TrimRemoteLinks(const ServerShardNode& Node)
+{
+	auto found = Node.Shard->RemoteLinks.find(Node.LocalID);
+	if (found != Node.Shard->RemoteLinks.end() && found->second.ParentID == SNODE_INVALID_ID && found->second.ChildCount == 0
+		&& found->second.Connections.empty())
+	{
+		Node.Shard->RemoteLinks.erase(found);
+	}
+}
+
+static SNodeGUID GetParentID(ServerGraph& Graph, const ServerShardNode& Node)
+{
+	const SNodeGUID localParentID = Node.Shard->Store.ParentIDs[Node.LocalID];
+	if (localParentID != SNODE_INVALID_ID)
+	{
+		return GlobalNodeID(Graph, Node.Shard->Index, localParentID);
+	}
+
+	const ServerRemoteLinks* links = FindRemoteLinks(Node);
+	return links != nullptr ? links->ParentID : SNODE_INVALID_ID;
+}
+
+static bool HasChildren(const ServerShardNode& Node)
+{
+	if (Node.Shard->Store.FirstChild[Node.LocalID] != SNODE_INVALID_ID)
+	{
+		return true;
+	}
+
+	const ServerRemoteLinks* links = FindRemoteLinks(Node);
+	return links != nullptr && links->ChildCount > 0;
+}
+
+static SNodeConnectionAccessLevel GetConnection(ServerGraph& Graph, SNodeGUID Src, SNodeGUID Dest)
+{
+	const ServerShardNode srcNode = LocateNode(Graph, Src);
+	if (ShardOfNode(Graph, Src) == ShardOfNode(Graph, Dest))
+	{
+		return srcNode.Shard->Store.GetConnection(srcNode.LocalID, LocalNodeID(Graph, Dest));
+	}
+
+	if (const ServerRemoteLinks* links = FindRemoteLinks(srcNode))
+	{
+		for (const ServerRemoteConnection& connection : links->Connections)
+		{
+			if (connection.bOutgoing && connection.PartnerID == Dest)
+			{
+				return connection.AccessLevel;
+			}
+		}
+	}
+	return SNodeConnectionAccessLevel::NONE;
+}
+
+// Sets one side of a cross-shard connection.
+static void SetRemoteConnection(const ServerShardNode& Node, SNodeGUID PartnerID, bool bOutgoing, SNodeConnectionAccessLevel AccessLevel)
+{
+	ServerRemoteLinks& links = Node.Shard->RemoteLinks[Node.LocalID];
+	for (size_t connectionIndex = 0; connectionIndex < links.Connections.size(); connectionIndex++)
+	{
+		ServerRemoteConnection& connection = links.Connections[connectionIndex];
+		if (connection.PartnerID == PartnerID && connection.bOutgoing == bOutgoing)
+		{
+			if (AccessLevel == SNodeConnectionAccessLevel::NONE)
+			{
+				connection = links.Connections.back();
+				links.Connections.pop_back();
+				TrimRemoteLinks(Node);
+			}
+			else
+			{
+				connection.AccessLevel = AccessLevel;
+			}
+			return;
+		}
+	}
+
+	if (AccessLevel != SNodeConnectionAccessLevel::NONE)
+	{
+		links.Connections.push_back({ PartnerID, AccessLevel, bOutgoing });
+	}
+	else
+	{
+		TrimRemoteLinks(Node);
+	}
+}
+
+// PRIMITIVES
+// Raw changes to the sharded graph, in global IDs. The shards of every node involved must be held.
+
+static bool RawSetConnection(ServerGraph& Graph, SNodeGUID Src, SNodeGUID Dest, SNodeConnectionAccessLevel AccessLevel)
+{
+	const ServerShardNode srcNode = LocateNode(Graph, Src);
+	const ServerShardNode destNode = LocateNode(Graph, Dest);
+	if (srcNode.Shard == destNode.Shard)
+	{
+		return srcNode.Shard->Store.SetConnection(srcNode.LocalID, destNode.LocalID, AccessLevel);
+	}
+
+	SetRemoteConnection(srcNode, Dest, true, AccessLevel);
+	SetRemoteConnection(destNode, Src, false, AccessLevel);
+
+	// Their stores can't see the connection, but it changes both nodes all the same.
+	srcNode.Shard->Store.Touch(srcNode.LocalID);
+	destNode.Shard->Store.Touch(destNode.LocalID);
+	return true;
+}
+
+// Moves the node under another parent, in its shard or in another one. An invalid parent leaves the node parentless.
+static void RawSetParent(ServerGraph& Graph, SNodeGUID NodeID, SNodeGUID ParentID)
+{
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+
+	if (ServerRemoteLinks* links = FindRemoteLinks(node))
+	{
+		if (links->ParentID != SNODE_INVALID_ID)
+		{
+			const ServerShardNode previousParent = LocateNode(Graph, links->ParentID);
+			links->ParentID = SNODE_INVALID_ID;
+			TrimRemoteLinks(node);
+
+			previousParent.Shard->RemoteLinks[previousParent.LocalID].ChildCount--;
+			TrimRemoteLinks(previousParent);
+		}
+	}
+
+	if (ParentID == SNODE_INVALID_ID || ShardOfNode(Graph, ParentID) != node.Shard->Index)
+	{
+		node.Shard->Store.SetParent(node.LocalID, SNODE_INVALID_ID);
+	}
+	else
+	{
+		node.Shard->Store.SetParent(node.LocalID, LocalNodeID(Graph, ParentID));
+	}
+
+	if (ParentID != SNODE_INVALID_ID && ShardOfNode(Graph, ParentID) != node.Shard->Index)
+	{
+		const ServerShardNode parent = LocateNode(Graph, ParentID);
+		node.Shard->RemoteLinks[node.LocalID].ParentID = ParentID;
+		parent.Shard->RemoteLinks[parent.LocalID].ChildCount++;
+	}
+}
+
+// Creates a node with a given ID. Only its connections are left to set.
+static void RawCreateNode(ServerGraph& Graph, SNodeGUID NodeID, SNameHandle Name, SNodeGUID ParentID)
+{
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+	node.Shard->Store.CreateNode(node.LocalID, Name, SNODE_INVALID_ID);
+	RawSetParent(Graph, NodeID, ParentID);
+}
+
+// Deletes a node whose connections were removed already.
+static void RawDeleteNode(ServerGraph& Graph, SNodeGUID NodeID)
+{
+	RawSetParent(Graph, NodeID, SNODE_INVALID_ID);
+
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+	node.Shard->Store.DeleteNode(node.LocalID);
+}
+
+// LOGGED CHANGES
+// Same as the primitives, recording what they change in the transaction's undo log.
+
+// Version of a node, 0 if it doesn't exist. Its shard must be held.
+static uint64_t GetShardNodeVersion(ServerGraph& Graph, SNodeGUID NodeID)
+{
+	if (NodeID == SNODE_INVALID_ID)
+	{
+		return 0;
+	}
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+	return node.Shard->Store.NodeExists(node.LocalID) ? node.Shard->Store.GetNodeVersion(node.LocalID) : 0;
+}
+
+// Starts the log entry of a change about to be made, recording the versions its nodes have before it.
+static SGraphTransactionLogEntry MakeShardLogEntry(ServerGraph& Graph, const SGraphChange& Change)
+{
+	SGraphTransactionLogEntry entry;
+	entry.Change = Change;
+	entry.PreviousNodeVersion = GetShardNodeVersion(Graph, Change.NodeID);
+	entry.PreviousOtherVersion = GetShardNodeVersion(Graph, Change.OtherID);
+	return entry;
+}
+
+static void RestoreShardNodeVersion(ServerGraph& Graph, SNodeGUID NodeID, uint64_t Version)
+{
+	if (NodeID != SNODE_INVALID_ID)
+	{
+		const ServerShardNode node = LocateNode(Graph, NodeID);
+		if (node.Shard->Store.NodeExists(node.LocalID))
+		{
+			node.Shard->Store.ColdData[node.LocalID].ModificationStamp = Version;
+		}
+	}
+}
+
+static bool ShardSetConnection(ServerGraph& Graph, ServerShardTransaction& Transaction, SNodeGUID Src, SNodeGUID Dest,
+	SNodeConnectionAccessLevel AccessLevel)
+{
+	const SNodeConnectionAccessLevel previousAccessLevel = GetConnection(Graph, Src, Dest);
+	if (previousAccessLevel == AccessLevel)
+	{
+		return true;
+	}
+
+	SGraphTransactionLogEntry entry = MakeShardLogEntry(Graph, { SGraphChangeKind::CONNECTION_CHANGED, AccessLevel, 0, Src, Dest });
+	entry.PreviousAccessLevel = previousAccessLevel;
+
+	if (!RawSetConnection(Graph, Src, Dest, AccessLevel))
+	{
+		return false;
+	}
+
+	Transaction.Context.Log.push_back(entry);
+	return true;
+}
+
+static void ShardSetParent(ServerGraph& Graph, ServerShardTransaction& Transaction, SNodeGUID NodeID, SNodeGUID PreviousParentID,
+	SNodeGUID ParentID)
+{
+	SGraphTransactionLogEntry entry = MakeShardLogEntry(Graph,
+		{ SGraphChangeKind::PARENT_CHANGED, SNodeConnectionAccessLevel::NONE, 0, NodeID, ParentID });
+	entry.PreviousOtherID = PreviousParentID;
+
+	RawSetParent(Graph, NodeID, ParentID);
+	Transaction.Context.Log.push_back(entry);
+}
+
+// Returns false without changing anything if the node has links with shards the transaction doesn't hold.
+static bool ShardDeleteNode(ServerGraph& Graph, ServerShardTransaction& Transaction, const ServerShardNode& Node, SNodeGUID NodeID,
+	SNodeGUID ParentID)
+{
+	std::vector<ServerRemoteConnection> remoteConnections;
+	if (const ServerRemoteLinks* links = FindRemoteLinks(Node))
+	{
+		remoteConnections = links->Connections;
+	}
+
+	bool bReachable = ParentID == SNODE_INVALID_ID || AccessShard(Transaction, ShardOfNode(Graph, ParentID));
+	for (const ServerRemoteConnection& connection : remoteConnections)
+	{
+		bReachable &= AccessShard(Transaction, ShardOfNode(Graph, connection.PartnerID));
+	}
+	if (!bReachable)
+	{
+		return false;
+	}
+
+	// Connections are logged one by one so they can be restored.
+	for (const ServerRemoteConnection& connection : remoteConnections)
+	{
+		const SNodeGUID src = connection.bOutgoing ? NodeID : connection.PartnerID;
+		const SNodeGUID dest = connection.bOutgoing ? connection.PartnerID : NodeID;
+
+		SGraphTransactionLogEntry entry = MakeShardLogEntry(Graph,
+			{ SGraphChangeKind::CONNECTION_CHANGED, SNodeConnectionAccessLevel::NONE, 0, src, dest });
+		entry.PreviousAccessLevel = connection.AccessLevel;
+		Transaction.Context.Log.push_back(entry);
+
+		RawSetConnection(Graph, src, dest, SNodeConnectionAccessLevel::NONE);
+	}
+
+	// Local ones go along with the node.
+	const SGraphStore& store = Node.Shard->Store;
+	for (SGraphEdgeIndex edgeIndex = store.FirstOutEdge[Node.LocalID]; edgeIndex != SGRAPH_INVALID_EDGE; edgeIndex = store.Edges[edgeIndex].NextOut)
+	{
+		SGraphTransactionLogEntry entry = MakeShardLogEntry(Graph, { SGraphChangeKind::CONNECTION_CHANGED, SNodeConnectionAccessLevel::NONE, 0,
+			NodeID, GlobalNodeID(Graph, Node.Shard->Index, store.Edges[edgeIndex].Dest) });
+		entry.PreviousAccessLevel = store.Edges[edgeIndex].AccessLevel;
+		Transaction.Context.Log.push_back(entry);
+	}
+	for (SGraphEdgeIndex edgeIndex = store.FirstInEdge[Node.LocalID]; edgeIndex != SGRAPH_INVALID_EDGE; edgeIndex = store.Edges[edgeIndex].NextIn)
+	{
+		SGraphTransactionLogEntry entry = MakeShardLogEntry(Graph, { SGraphChangeKind::CONNECTION_CHANGED, SNodeConnectionAccessLevel::NONE, 0,
+			GlobalNodeID(Graph, Node.Shard->Index, store.Edges[edgeIndex].Src), NodeID });
+		entry.PreviousAccessLevel = store.Edges[edgeIndex].AccessLevel;
+		Transaction.Context.Log.push_back(entry);
+	}
+
+	SGraphTransactionLogEntry entry = MakeShardLogEntry(Graph,
+		{ SGraphChangeKind::NODE_DELETED, SNodeConnectionAccessLevel::NONE, 0, NodeID, ParentID });
+	entry.PreviousValue = store.NameHandles[Node.LocalID];
+	Transaction.Context.Log.push_back(entry);
+
+	RawDeleteNode(Graph, NodeID);
+	return true;
+}
+
+// Undoes the changes logged past the passed mark, those of the transaction being applied.
+static void ShardRollback(ServerGraph& Graph, ServerShardTransaction& Transaction, size_t LogMark)
+{
+	std::vector<SGraphTransactionLogEntry>& log = Transaction.Context.Log;
+	for (size_t entryIndex = log.size(); entryIndex-- > LogMark;)
+	{
+		const SGraphTransactionLogEntry& entry = log[entryIndex];
+		const SGraphChange& change = entry.Change;
+
+		switch (change.Kind)
+		{
+		case SGraphChangeKind::NODE_CREATED:
+			RawDeleteNode(Graph, change.NodeID);
+			break;
+		case SGraphChangeKind::NODE_DELETED:
+			RawCreateNode(Graph, change.NodeID, entry.PreviousValue, change.OtherID);
+			break;
+		case SGraphChangeKind::NODE_RENAMED:
+		{
+			const ServerShardNode node = LocateNode(Graph, change.NodeID);
+			node.Shard->Store.RenameNode(node.LocalID, entry.PreviousValue);
+			break;
+		}
+		case SGraphChangeKind::PARENT_CHANGED:
+			RawSetParent(Graph, change.NodeID, entry.PreviousOtherID);
+			break;
+		case SGraphChangeKind::CONNECTION_CHANGED:
+			RawSetConnection(Graph, change.NodeID, change.OtherID, entry.PreviousAccessLevel);
+			break;
+		default:
+			break;
+		}
+
+		// Going backwards, the versions left are those from before the transaction.
+		RestoreShardNodeVersion(Graph, change.NodeID, entry.PreviousNodeVersion);
+		RestoreShardNodeVersion(Graph, change.OtherID, entry.PreviousOtherVersion);
+	}
+
+	log.resize(LogMark);
+	Transaction.Context.CreatedIDs.clear();
+}
+
+// OPS
+// Same rules as ApplyGraphOp, see SynergyGraphTransaction.h. Reaching a shard the transaction doesn't hold fails the op.
+
+static SGraphTransactionStatus ApplyShardedOp(ServerGraph& Graph, ServerShardTransaction& Transaction, const SGraphOp& Op)
+{
+	SGraphTransactionContext& context = Transaction.Context;
+	auto Resolve = [&context](SNodeGUID NodeRef)
+	{
+		if (IsCreatedNodeRef(NodeRef))
+		{
+			const size_t createdIndex = (size_t)(NodeRef & ~SGRAPH_CREATED_NODE_REF);
+			return createdIndex < context.CreatedIDs.size() ? context.CreatedIDs[createdIndex] : SNODE_INVALID_ID;
+		}
+		return NodeRef;
+	};
+
+	const SNodeGUID nodeID = Resolve(Op.NodeID);
+	const SNodeGUID otherID = Resolve(Op.OtherID);
+	ServerShardNode node;
+	ServerShardNode other;
+
+	switch (Op.Type)
+	{
+	case SGraphOpType::FETCH_NODE:
+		if (!FindNode(Graph, Transaction, nodeID, node))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+		return Op.Version == 0 || Op.Version == node.Shard->Store.GetNodeVersion(node.LocalID) ?
+			SGraphTransactionStatus::APPLIED : SGraphTransactionStatus::CONFLICT;
+
+	case SGraphOpType::CREATE_NODE:
+	{
+		if (!IsValidGraphNodeName(Op.Name))
+		{
+			return SGraphTransactionStatus::INVALID_NAME;
+		}
+
+		// Only an empty graph may get a root. Roots are only created with every shard held.
+		const bool bRoot = Op.OtherID == SNODE_INVALID_ID;
+		if (bRoot)
+		{
+			for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+			{
+				if (!AccessShard(Transaction, shardIndex) || Graph.Shards[shardIndex].Store.NodeCount > 0)
+				{
+					return SGraphTransactionStatus::HIERARCHY_VIOLATION;
+				}
+			}
+		}
+		else if (!FindNode(Graph, Transaction, otherID, other))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+		if (!bRoot && (!IsValidGraphAccessLevel(Op.AccessLevel, SNodeConnectionAccessLevel::TO_PARENT_MINIMUM)
+			|| !IsValidGraphAccessLevel(Op.AccessLevelFromParent, SNodeConnectionAccessLevel::TO_CHILD_MINIMUM)))
+		{
+			return SGraphTransactionStatus::INVALID_OP;
+		}
+
+		const size_t createdIndex = context.CreatedIDs.size();
+		if (createdIndex >= Transaction.CreatedShards.size() || !AccessShard(Transaction, Transaction.CreatedShards[createdIndex]))
+		{
+			return SGraphTransactionStatus::INVALID_OP;
+		}
+
+		ServerShard& shard = Graph.Shards[Transaction.CreatedShards[createdIndex]];
+		const SNodeGUID localID = shard.Store.FindAvailableID();
+		const SNameHandle name = shard.Store.Names.Intern(Op.Name);
+		if (localID == SNODE_INVALID_ID || name == SNAME_INVALID_HANDLE)
+		{
+			return SGraphTransactionStatus::OUT_OF_CAPACITY;
+		}
+
+		const SNodeGUID newNodeID = GlobalNodeID(Graph, shard.Index, localID);
+		const SGraphTransactionLogEntry entry = MakeShardLogEntry(Graph,
+			{ SGraphChangeKind::NODE_CREATED, SNodeConnectionAccessLevel::NONE, name, newNodeID, bRoot ? SNODE_INVALID_ID : otherID });
+
+		RawCreateNode(Graph, newNodeID, name, bRoot ? SNODE_INVALID_ID : otherID);
+		context.Log.push_back(entry);
+		context.CreatedIDs.push_back(newNodeID);
+
+		if (!bRoot && (!ShardSetConnection(Graph, Transaction, newNodeID, otherID, Op.AccessLevel)
+			|| !ShardSetConnection(Graph, Transaction, otherID, newNodeID, Op.AccessLevelFromParent)))
+		{
+			return SGraphTransactionStatus::OUT_OF_CAPACITY;
+		}
+		return SGraphTransactionStatus::APPLIED;
+	}
+
+	case SGraphOpType::DELETE_NODE:
+	{
+		if (!FindNode(Graph, Transaction, nodeID, node))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+
+		const SNodeGUID parentID = GetParentID(Graph, node);
+		if (parentID == SNODE_INVALID_ID || HasChildren(node))
+		{
+			return SGraphTransactionStatus::HIERARCHY_VIOLATION;
+		}
+
+		return ShardDeleteNode(Graph, Transaction, node, nodeID, parentID) ? SGraphTransactionStatus::APPLIED : SGraphTransactionStatus::MISSING_NODE;
+	}
+
+	case SGraphOpType::RENAME_NODE:
+	{
+		if (!FindNode(Graph, Transaction, nodeID, node))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+		if (!IsValidGraphNodeName(Op.Name))
+		{
+			return SGraphTransactionStatus::INVALID_NAME;
+		}
+
+		SGraphStore& store = node.Shard->Store;
+		const SNameHandle name = store.Names.Intern(Op.Name);
+		if (name == SNAME_INVALID_HANDLE)
+		{
+			return SGraphTransactionStatus::OUT_OF_CAPACITY;
+		}
+
+		if (name != store.NameHandles[node.LocalID])
+		{
+			SGraphTransactionLogEntry entry = MakeShardLogEntry(Graph,
+				{ SGraphChangeKind::NODE_RENAMED, SNodeConnectionAccessLevel::NONE, name, nodeID, SNODE_INVALID_ID });
+			entry.PreviousValue = store.NameHandles[node.LocalID];
+
+			store.RenameNode(node.LocalID, name);
+			context.Log.push_back(entry);
+		}
+		return SGraphTransactionStatus::APPLIED;
+	}
+
+	case SGraphOpType::SET_PARENT:
+	{
+		if (!FindNode(Graph, Transaction, nodeID, node) || !FindNode(Graph, Transaction, otherID, other))
+		{
+			return Op.OtherID == SNODE_INVALID_ID ? SGraphTransactionStatus::HIERARCHY_VIOLATION : SGraphTransactionStatus::MISSING_NODE;
+		}
+		if (!IsValidGraphAccessLevel(Op.AccessLevel, SNodeConnectionAccessLevel::TO_PARENT_MINIMUM)
+			|| !IsValidGraphAccessLevel(Op.AccessLevelFromParent, SNodeConnectionAccessLevel::TO_CHILD_MINIMUM))
+		{
+			return SGraphTransactionStatus::INVALID_OP;
+		}
+
+		// The new parent can't be the node itself or one of its descendants. Ancestors may live in any shard.
+		bool bCycle = nodeID == otherID;
+		for (SNodeGUID ancestorID = otherID; !bCycle;)
+		{
+			ServerShardNode ancestor;
+			if (!FindNode(Graph, Transaction, ancestorID, ancestor))
+			{
+				return SGraphTransactionStatus::MISSING_NODE;
+			}
+			ancestorID = GetParentID(Graph, ancestor);
+			if (ancestorID == SNODE_INVALID_ID)
+			{
+				break;
+			}
+			bCycle = ancestorID == nodeID;
+		}
+		if (bCycle)
+		{
+			return SGraphTransactionStatus::HIERARCHY_VIOLATION;
+		}
+
+		const SNodeGUID previousParentID = GetParentID(Graph, node);
+		if (previousParentID != otherID)
+		{
+			ServerShardNode previousParent;
+			if (previousParentID != SNODE_INVALID_ID)
+			{
+				if (!FindNode(Graph, Transaction, previousParentID, previousParent))
+				{
+					return SGraphTransactionStatus::MISSING_NODE;
+				}
+				ShardSetConnection(Graph, Transaction, nodeID, previousParentID, SNodeConnectionAccessLevel::NONE);
+				ShardSetConnection(Graph, Transaction, previousParentID, nodeID, SNodeConnectionAccessLevel::NONE);
+			}
+			ShardSetParent(Graph, Transaction, nodeID, previousParentID, otherID);
+		}
+
+		if (!ShardSetConnection(Graph, Transaction, nodeID, otherID, Op.AccessLevel)
+			|| !ShardSetConnection(Graph, Transaction, otherID, nodeID, Op.AccessLevelFromParent))
+		{
+			return SGraphTransactionStatus::OUT_OF_CAPACITY;
+		}
+		return SGraphTransactionStatus::APPLIED;
+	}
+
+	case SGraphOpType::SET_CONNECTION:
+	{
+		if (!FindNode(Graph, Transaction, nodeID, node) || !FindNode(Graph, Transaction, otherID, other))
+		{
+			return SGraphTransactionStatus::MISSING_NODE;
+		}
+
+		// Parent - child connections can be edited but must stay above their minimum.
+		SNodeConnectionAccessLevel minimum = SNodeConnectionAccessLevel::NONE;
+		if (GetParentID(Graph, other) == nodeID)
+		{
+			minimum = SNodeConnectionAccessLevel::TO_CHILD_MINIMUM;
+		}
+		else if (GetParentID(Graph, node) == otherID)
+		{
+			minimum = SNodeConnectionAccessLevel::TO_PARENT_MINIMUM;
+		}
+
+		if (nodeID == otherID || !IsValidGraphAccessLevel(Op.AccessLevel, minimum))
+		{
+			return SGraphTransactionStatus::INVALID_OP;
+		}
+
+		return ShardSetConnection(Graph, Transaction, nodeID, otherID, Op.AccessLevel) ?
+			SGraphTransactionStatus::APPLIED : SGraphTransactionStatus::OUT_OF_CAPACITY;
+	}
+
+	default:
+		return SGraphTransactionStatus::INVALID_OP;
+	}
+}
+
+// TRAVERSAL
+// Reads of the sharded graph in global IDs, for passes holding every shard.
+
+static inline ServerShardMask GetAllShardsMask(const ServerGraph& Graph)
+{
+	return Graph.ShardCount == 64 ? ~(ServerShardMask)0 : ((ServerShardMask)1 << Graph.ShardCount) - 1;
+}
+
+static bool ServerNodeExists(ServerGraph& Graph, SNodeGUID NodeID)
+{
+	if (NodeID == SNODE_INVALID_ID || IsCreatedNodeRef(NodeID))
+	{
+		return false;
+	}
+
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+	return node.Shard->Store.NodeExists(node.LocalID);
+}
+
+static inline SNodeGUID GetServerNodeParentID(ServerGraph& Graph, SNodeGUID NodeID)
+{
+	return GetParentID(Graph, LocateNode(Graph, NodeID));
+}
+
+static inline uint64_t GetServerNodeVersion(ServerGraph& Graph, SNodeGUID NodeID)
+{
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+	return node.Shard->Store.GetNodeVersion(node.LocalID);
+}
+
+static inline std::string_view GetServerNodeName(ServerGraph& Graph, SNodeGUID NodeID)
+{
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+	return node.Shard->Store.GetNodeName(node.LocalID);
+}
+
+// Calls Visitor(DestID, AccessLevel) for every connection leaving an existing node, parent - child ones included.
+template<typename VisitorType>
+static void ForEachServerConnection(ServerGraph& Graph, SNodeGUID NodeID, VisitorType&& Visitor)
+{
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+	const SGraphStore& store = node.Shard->Store;
+	for (SGraphEdgeIndex edgeIndex = store.FirstOutEdge[node.LocalID]; edgeIndex != SGRAPH_INVALID_EDGE; edgeIndex = store.Edges[edgeIndex].NextOut)
+	{
+		Visitor(GlobalNodeID(Graph, node.Shard->Index, store.Edges[edgeIndex].Dest), store.Edges[edgeIndex].AccessLevel);
+	}
+
+	if (const ServerRemoteLinks* links = FindRemoteLinks(node))
+	{
+		for (const ServerRemoteConnection& connection : links->Connections)
+		{
+			if (connection.bOutgoing)
+			{
+				Visitor(connection.PartnerID, connection.AccessLevel);
+			}
+		}
+	}
+}
+
+// Calls Visitor(ChildID) for every child of an existing node. Children in other shards are found through their parent - child connection.
+template<typename VisitorType>
+static void ForEachServerChild(ServerGraph& Graph, SNodeGUID NodeID, VisitorType&& Visitor)
+{
+	const ServerShardNode node = LocateNode(Graph, NodeID);
+	node.Shard->Store.ForEachChild(node.LocalID, [&](SNodeGUID ChildLocalID)
+	{
+		Visitor(GlobalNodeID(Graph, node.Shard->Index, ChildLocalID));
+	});
+
+	const ServerRemoteLinks* links = FindRemoteLinks(node);
+	if (links == nullptr || links->ChildCount == 0)
+	{
+		return;
+	}
+
+	for (const ServerRemoteConnection& connection : links->Connections)
+	{
+		const ServerShardNode partner = LocateNode(Graph, connection.PartnerID);
+		const ServerRemoteLinks* partnerLinks = connection.bOutgoing ? FindRemoteLinks(partner) : nullptr;
+		if (partnerLinks != nullptr && partnerLinks->ParentID == NodeID)
+		{
+			Visitor(connection.PartnerID);
+		}
+	}
+}
+
+// TRANSACTIONS
+
+/*
+	Reads the ops once to decide where created nodes go, and returns the shards their nodes are known to live in.
+	Shards only found out about while applying are added later.
+*/
+static ServerShardMask PrepareShardedTransaction(ServerGraph& Graph, SProtocolTransactionReader& Ops, ServerShardTransaction& Transaction)
+{
+	const ServerShardMask allShards = GetAllShardsMask(Graph);
+	const SNodeGUID rootID = Graph.RootID.load(std::memory_order_relaxed);
+
+	Transaction.CreatedShards.clear();
+	ServerShardMask shards = 0;
+
+	// Shard a node reference points to, if it can be told already.
+	auto ShardBit = [&](SNodeGUID NodeRef) -> ServerShardMask
+	{
+		if (IsCreatedNodeRef(NodeRef))
+		{
+			const size_t createdIndex = (size_t)(NodeRef & ~SGRAPH_CREATED_NODE_REF);
+			return createdIndex < Transaction.CreatedShards.size() ? (ServerShardMask)1 << Transaction.CreatedShards[createdIndex] : 0;
+		}
+		return NodeRef != SNODE_INVALID_ID ? (ServerShardMask)1 << ShardOfNode(Graph, NodeRef) : 0;
+	};
+
+	SGraphOp op;
+	for (size_t opIndex = 0; opIndex < SGRAPH_TRANSACTION_MAX_OPS && Ops.Next(op); opIndex++)
+	{
+		shards |= ShardBit(op.NodeID) | ShardBit(op.OtherID);
+		if (op.Type != SGraphOpType::CREATE_NODE)
+		{
+			continue;
+		}
+
+		// Nodes go with their parent, except for the root's children which are spread over the shards.
+		uint32_t placementShard = 0;
+		if (op.OtherID == SNODE_INVALID_ID)
+		{
+			shards = allShards;
+		}
+		else if (op.OtherID == rootID)
+		{
+			placementShard = Graph.NextPlacementShard.fetch_add(1, std::memory_order_relaxed) % Graph.ShardCount;
+		}
+		else
+		{
+			const ServerShardMask parentBit = ShardBit(op.OtherID);
+			while (parentBit > ((ServerShardMask)1 << placementShard))
+			{
+				placementShard++;
+			}
+		}
+
+		Transaction.CreatedShards.push_back(placementShard);
+		shards |= (ServerShardMask)1 << placementShard;
+	}
+
+	Ops.Rewind();
+	return shards;
+}
+
+static void LockShards(ServerGraph& Graph, ServerShardMask Shards)
+{
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		if ((Shards >> shardIndex) & 1)
+		{
+			Graph.Shards[shardIndex].Lock.lock();
+		}
+	}
+}
+
+static void UnlockShards(ServerGraph& Graph, ServerShardMask Shards)
+{
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		if ((Shards >> shardIndex) & 1)
+		{
+			Graph.Shards[shardIndex].Lock.unlock();
+		}
+	}
+}
+
+// Frees the names nothing references anymore in the held shards. Logs and journals name changes by handle, so only once they're done.
+static void ReclaimShardNames(ServerGraph& Graph, ServerShardMask Shards)
+{
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		if ((Shards >> shardIndex) & 1)
+		{
+			Graph.Shards[shardIndex].Store.Names.ReclaimUnreferenced();
+		}
+	}
+}
+
+// Publishes each shard's share of the logged changes to its journal in one go. Changes belong to the shard of the node they describe.
+// Shards locked but left unchanged get nothing, not even an empty transaction waking their cursors.
+static void PublishShardedChanges(ServerGraph& Graph, ServerShardTransaction& Transaction)
+{
+	const std::vector<SGraphTransactionLogEntry>& log = Transaction.Context.Log;
+	if (log.empty())
+	{
+		return;
+	}
+
+	ServerShardMask changedShards = 0;
+	for (const SGraphTransactionLogEntry& entry : log)
+	{
+		changedShards |= (ServerShardMask)1 << ShardOfNode(Graph, entry.Change.NodeID);
+		if (entry.Change.Kind == SGraphChangeKind::NODE_CREATED && entry.Change.OtherID == SNODE_INVALID_ID)
+		{
+			Graph.RootID.store(entry.Change.NodeID, std::memory_order_relaxed);
+		}
+	}
+
+	changedShards &= Transaction.LockedShards;
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		if (((changedShards >> shardIndex) & 1) == 0)
+		{
+			continue;
+		}
+
+		SGraphChangeStream& journal = Graph.Shards[shardIndex].Journal;
+		journal.BeginTransaction();
+		for (const SGraphTransactionLogEntry& entry : log)
+		{
+			if (ShardOfNode(Graph, entry.Change.NodeID) == shardIndex)
+			{
+				journal.Push(entry.Change);
+			}
+		}
+		journal.EndTransaction();
+	}
+}
+
+// Applies every op of a transaction, stopping at the first that fails. Returns the status and the index of the op it stopped at.
+static SGraphTransactionStatus ApplyShardedOps(ServerGraph& Graph, SProtocolTransactionReader& Ops, ServerShardTransaction& Transaction,
+	uint32_t& OutOpIndex)
+{
+	SGraphTransactionStatus status = SGraphTransactionStatus::APPLIED;
+	OutOpIndex = 0;
+	SGraphOp op;
+	while (Ops.Next(op))
+	{
+		status = OutOpIndex < SGRAPH_TRANSACTION_MAX_OPS ? ApplyShardedOp(Graph, Transaction, op) : SGraphTransactionStatus::INVALID_OP;
+		if (status != SGraphTransactionStatus::APPLIED)
+		{
+			return status;
+		}
+		OutOpIndex++;
+	}
+	return Ops.Failed() ? SGraphTransactionStatus::INVALID_OP : SGraphTransactionStatus::APPLIED;
+}
+
+void ApplyShardedTransactionBatch(ServerGraph& Graph, ServerTransactionBatch& Batch, ServerShardTransaction& Transaction)
+{
+	const size_t count = Batch.Count;
+	Batch.Results.assign(count, SGraphTransactionResult());
+	Batch.CreatedIDs.clear();
+	Batch.CreatedOffsets.assign(count + 1, 0);
+	if (Batch.CreatedShards.size() < count)
+	{
+		Batch.CreatedShards.resize(count);
+	}
+
+	// Every transaction's placement is decided up front, so the shards of the whole batch can be locked at once.
+	ServerShardMask shards = 0;
+	for (size_t transactionIndex = 0; transactionIndex < count; transactionIndex++)
+	{
+		shards |= PrepareShardedTransaction(Graph, Batch.Readers[transactionIndex], Transaction);
+		Batch.CreatedShards[transactionIndex].swap(Transaction.CreatedShards);
+	}
+
+	// Changed transactions since the last commit, which get their sequence numbers when it is published.
+	std::vector<size_t> changedTransactions;
+
+	size_t transactionIndex = 0;
+	while (transactionIndex < count)
+	{
+		Transaction.Context.Log.clear();
+		Transaction.LockedShards = shards;
+		LockShards(Graph, shards);
+
+		for (; transactionIndex < count; transactionIndex++)
+		{
+			SProtocolTransactionReader& ops = Batch.Readers[transactionIndex];
+			const size_t logMark = Transaction.Context.Log.size();
+			Transaction.Context.CreatedIDs.clear();
+			Transaction.CreatedShards.swap(Batch.CreatedShards[transactionIndex]);
+			Transaction.MissingShards = 0;
+
+			uint32_t opIndex = 0;
+			const SGraphTransactionStatus status = ApplyShardedOps(Graph, ops, Transaction, opIndex);
+			Transaction.CreatedShards.swap(Batch.CreatedShards[transactionIndex]);
+
+			if (status == SGraphTransactionStatus::APPLIED)
+			{
+				const std::vector<SNodeGUID>& createdIDs = Transaction.Context.CreatedIDs;
+				Batch.CreatedIDs.insert(Batch.CreatedIDs.end(), createdIDs.begin(), createdIDs.end());
+				if (Transaction.Context.Log.size() != logMark)
+				{
+					changedTransactions.push_back(transactionIndex);
+				}
+			}
+			else
+			{
+				ShardRollback(Graph, Transaction, logMark);
+
+				// Start over from this transaction holding the shards it was missing, its outcome may differ with them.
+				if (Transaction.MissingShards != 0)
+				{
+					shards |= Transaction.MissingShards;
+					ops.Rewind();
+					break;
+				}
+
+				Batch.Results[transactionIndex].Status = status;
+				Batch.Results[transactionIndex].FailedOpIndex = opIndex;
+			}
+			Batch.CreatedOffsets[transactionIndex + 1] = Batch.CreatedIDs.size();
+		}
+
+		// What was applied so far is committed before letting go of the shards, locks can only be taken in order.
+		// The journal gets it in the same order, see ServerPersistence_INC.cpp.
+		PublishShardedChanges(Graph, Transaction);
+		uint64_t sequence = Graph.Persistence != nullptr && !changedTransactions.empty() ?
+			AppendServerJournal(*Graph.Persistence, Graph, Transaction, changedTransactions.size()) :
+			Graph.TransactionSequence.fetch_add(changedTransactions.size(), std::memory_order_relaxed);
+		ReclaimShardNames(Graph, Transaction.LockedShards);
+		UnlockShards(Graph, Transaction.LockedShards);
+
+		for (size_t changedIndex : changedTransactions)
+		{
+			Batch.Results[changedIndex].Sequence = ++sequence;
+		}
+		changedTransactions.clear();
+	}
+}
+
+// SEEDING
+
+bool DistributeGraph(ServerGraph& Graph, const SGraphStore& Source, SNodeGUID SourceRootID)
+{
+	// Units placed as a whole: subtrees under the root, and parentless subtrees.
+	struct PlacementUnit
+	{
+		SNodeGUID SourceID = SNODE_INVALID_ID;
+		size_t NodeCount = 0;
+	};
+	std::vector<PlacementUnit> units;
+
+	Source.ForEachNode([&](SNodeGUID NodeID)
+	{
+		const SNodeGUID parentID = Source.ParentIDs[NodeID];
+		if ((parentID == SNODE_INVALID_ID && NodeID != SourceRootID) || (parentID != SNODE_INVALID_ID && parentID == SourceRootID))
+		{
+			PlacementUnit unit = { NodeID };
+			Source.ForEachInSubtree(NodeID, [&unit](SNodeGUID, size_t) { unit.NodeCount++; return true; });
+			units.push_back(unit);
+		}
+	});
+
+	// Largest first, each to the least loaded shard.
+	std::sort(units.begin(), units.end(), [](const PlacementUnit& A, const PlacementUnit& B) { return A.NodeCount > B.NodeCount; });
+
+	std::vector<size_t> shardLoads(Graph.ShardCount, 0);
+	std::vector<SNodeGUID> newIDs(Source.MaxNodeCount, SNODE_INVALID_ID);
+
+	auto CopyNode = [&](SNodeGUID SourceID, uint32_t ShardIndex)
+	{
+		SGraphStore& store = Graph.Shards[ShardIndex].Store;
+		const SNodeGUID localID = store.FindAvailableID();
+		const SNameHandle name = store.Names.Intern(Source.GetNodeName(SourceID));
+		if (localID == SNODE_INVALID_ID || name == SNAME_INVALID_HANDLE)
+		{
+			return false;
+		}
+
+		const SNodeGUID sourceParentID = Source.ParentIDs[SourceID];
+		newIDs[SourceID] = GlobalNodeID(Graph, ShardIndex, localID);
+		RawCreateNode(Graph, newIDs[SourceID], name, sourceParentID != SNODE_INVALID_ID ? newIDs[sourceParentID] : SNODE_INVALID_ID);
+		shardLoads[ShardIndex]++;
+		return true;
+	};
+
+	bool bSuccess = SourceRootID == SNODE_INVALID_ID || CopyNode(SourceRootID, 0);
+	for (const PlacementUnit& unit : units)
+	{
+		const uint32_t shardIndex = (uint32_t)(std::min_element(shardLoads.begin(), shardLoads.end()) - shardLoads.begin());
+		Source.ForEachInSubtree(unit.SourceID, [&](SNodeGUID NodeID, size_t)
+		{
+			bSuccess = bSuccess && CopyNode(NodeID, shardIndex);
+			return bSuccess;
+		});
+	}
+
+	// Connections once every node has its new ID, parent - child ones included.
+	Source.ForEachNode([&](SNodeGUID NodeID)
+	{
+		for (SGraphEdgeIndex edgeIndex = Source.FirstOutEdge[NodeID]; bSuccess && edgeIndex != SGRAPH_INVALID_EDGE; edgeIndex = Source.Edges[edgeIndex].NextOut)
+		{
+			const SGraphEdge& edge = Source.Edges[edgeIndex];
+			bSuccess = RawSetConnection(Graph, newIDs[NodeID], newIDs[edge.Dest], edge.AccessLevel);
+		}
+	});
+
+	if (bSuccess && SourceRootID != SNODE_INVALID_ID)
+	{
+		Graph.RootID = newIDs[SourceRootID];
+	}
+	return bSuccess;
+}
+
+size_t GetServerGraphNodeCount(ServerGraph& Graph)
+{
+	size_t nodeCount = 0;
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		std::lock_guard<std::mutex> lock(Graph.Shards[shardIndex].Lock);
+		nodeCount += Graph.Shards[shardIndex].Store.NodeCount;
+	}
+	return nodeCount;
+}
@@ -0,0 +1,585 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Server's asynchronous storage layer: writes and flushes to files, submitted without waiting on the device.
+
+#include "Server.h"
+
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+/*
+	HOW IT WORKS
+
+	Every request takes a slot, and gives it back once complete. With io_uring a request becomes a write, linked to a flush of the file's
+	data when it asks for one, so that the flush only starts once the write is done. Writes may be short: the flush then fails as
+	canceled, and once both entries completed the rest of the write is submitted again with a new flush.
+
+	io_uring is driven through its system calls directly. The rings are mapped once, and the kernel signals the completion eventfd
+	whenever it posts a completion, so whoever reaps only has to poll it. Buffers are registered so that writes from them skip the
+	per-request page pinning; if registering them fails, for instance as they exceed the locked memory limit, plain writes are used.
+
+	Without io_uring, a few threads take slots from a queue and run blocking writes and flushes, then signal the same eventfd.
+*/
+
+#if defined(__linux__)
+
+// Tags of io_uring entries: the slot, and whether the entry is the flush following its write.
+static inline uint64_t MakeStorageEntryTag(uint32_t SlotIndex, bool bSyncEntry)
+{
+	return ((uint64_t)SlotIndex << 1) | (bSyncEntry ? 1 : 0);
+}
+
+// Clears the eventfd's counter, so that it only gets readable again on the next completion.
+static void DrainStorageEvent(ServerStorage& Storage)
+{
+	uint64_t count = 0;
+	while (read(Storage.CompletionEventDescriptor, &count, sizeof(count)) < 0 && errno == EINTR) {}
+}
+
+static void SignalStorageEvent(ServerStorage& Storage)
+{
+	const uint64_t one = 1;
+	while (write(Storage.CompletionEventDescriptor, &one, sizeof(one)) < 0 && errno == EINTR) {}
+}
+
+static uint32_t AllocateStorageSlot(ServerStorage& Storage, const ServerStorageRequest& Request)
+{
+	const uint32_t slotIndex = Storage.FreeSlots.back();
+	Storage.FreeSlots.pop_back();
+
+	ServerStorageSlot& slot = Storage.Slots[slotIndex];
+	slot.Request = Request;
+	slot.WrittenSize = 0;
+	slot.bSynced = !Request.bSync;
+	slot.Result = 0;
+	slot.PendingEntryCount = 0;
+	return slotIndex;
+}
+
+static void ReleaseStorageSlot(ServerStorage& Storage, uint32_t SlotIndex, std::vector<ServerStorageCompletion>& OutCompletions)
+{
+	const ServerStorageSlot& slot = Storage.Slots[SlotIndex];
+	OutCompletions.push_back({ slot.Request.Tag, slot.Result });
+	Storage.FreeSlots.push_back(SlotIndex);
+}
+
+// IO_URING
+
+static int SetupRing(uint32_t EntryCount, io_uring_params* Params)
+{
+	return (int)syscall(__NR_io_uring_setup, EntryCount, Params);
+}
+
+static int EnterRing(int RingDescriptor, uint32_t SubmitCount, uint32_t MinCompleteCount, uint32_t Flags)
+{
+	return (int)syscall(__NR_io_uring_enter, RingDescriptor, SubmitCount, MinCompleteCount, Flags, nullptr, 0);
+}
+
+static int RegisterRing(int RingDescriptor, uint32_t Opcode, const void* Arguments, uint32_t ArgumentCount)
+{
+	return (int)syscall(__NR_io_uring_register, RingDescriptor, Opcode, Arguments, ArgumentCount);
+}
+
+static void ReleaseRing(ServerStorage& Storage)
+{
+	if (Storage.SubmissionEntries != nullptr) munmap(Storage.SubmissionEntries, Storage.SubmissionEntriesSize);
+	if (Storage.CompletionRing != nullptr && Storage.CompletionRing != Storage.SubmissionRing) munmap(Storage.CompletionRing, Storage.CompletionRingSize);
+	if (Storage.SubmissionRing != nullptr) munmap(Storage.SubmissionRing, Storage.SubmissionRingSize);
+	if (Storage.RingDescriptor >= 0) close(Storage.RingDescriptor);
+
+	Storage.SubmissionEntries = nullptr;
+	Storage.CompletionRing = nullptr;
+	Storage.SubmissionRing = nullptr;
+	Storage.RingDescriptor = -1;
+	Storage.bBuffersRegistered = false;
+}
+
+static bool InitializeRing(ServerStorage& Storage, uint8_t* const* Buffers, const size_t* BufferSizes, uint32_t BufferCount)
+{
+	// Every slot may have a write and a flush in the ring at once.
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	Storage.RingDescriptor = SetupRing(SERVER_STORAGE_QUEUE_DEPTH * 2, &params);
+	if (Storage.RingDescriptor < 0)
+	{
+		return false;
+	}
+
+	Storage.SubmissionRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	Storage.CompletionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	const bool bSingleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (bSingleMap)
+	{
+		Storage.SubmissionRingSize = std::max(Storage.SubmissionRingSize, Storage.CompletionRingSize);
+		Storage.CompletionRingSize = Storage.SubmissionRingSize;
+	}
+
+	void* submissionRing = mmap(nullptr, Storage.SubmissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		Storage.RingDescriptor, IORING_OFF_SQ_RING);
+	if (submissionRing == MAP_FAILED)
+	{
+		ReleaseRing(Storage);
+		return false;
+	}
+	Storage.SubmissionRing = submissionRing;
+
+	void* completionRing = submissionRing;
+	if (!bSingleMap)
+	{
+		completionRing = mmap(nullptr, Storage.CompletionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			Storage.RingDescriptor, IORING_OFF_CQ_RING);
+		if (completionRing == MAP_FAILED)
+		{
+			ReleaseRing(Storage);
+			return false;
+		}
+	}
+	Storage.CompletionRing = completionRing;
+
+	Storage.SubmissionEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+	void* submissionEntries = mmap(nullptr, Storage.SubmissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		Storage.RingDescriptor, IORING_OFF_SQES);
+	if (submissionEntries == MAP_FAILED)
+	{
+		ReleaseRing(Storage);
+		return false;
+	}
+	Storage.SubmissionEntries = submissionEntries;
+
+	uint8_t* submissionBase = (uint8_t*)submissionRing;
+	Storage.SubmissionHead = (uint32_t*)(submissionBase + params.sq_off.head);
+	Storage.SubmissionTail = (uint32_t*)(submissionBase + params.sq_off.tail);
+	Storage.SubmissionArray = (uint32_t*)(submissionBase + params.sq_off.array);
+	Storage.SubmissionMask = *(uint32_t*)(submissionBase + params.sq_off.ring_mask);
+
+	uint8_t* completionBase = (uint8_t*)completionRing;
+	Storage.CompletionHead = (uint32_t*)(completionBase + params.cq_off.head);
+	Storage.CompletionTail = (uint32_t*)(completionBase + params.cq_off.tail);
+	Storage.CompletionEntries = completionBase + params.cq_off.cqes;
+	Storage.CompletionMask = *(uint32_t*)(completionBase + params.cq_off.ring_mask);
+
+	if (RegisterRing(Storage.RingDescriptor, IORING_REGISTER_EVENTFD, &Storage.CompletionEventDescriptor, 1) < 0)
+	{
+		ReleaseRing(Storage);
+		return false;
+	}
+
+	std::vector<iovec> buffers(BufferCount);
+	for (uint32_t bufferIndex = 0; bufferIndex < BufferCount; bufferIndex++)
+	{
+		buffers[bufferIndex].iov_base = Buffers[bufferIndex];
+		buffers[bufferIndex].iov_len = BufferSizes[bufferIndex];
+	}
+	Storage.bBuffersRegistered = BufferCount > 0 && RegisterRing(Storage.RingDescriptor, IORING_REGISTER_BUFFERS, buffers.data(), BufferCount) == 0;
+	return true;
+}
+
+static io_uring_sqe* GetNextRingEntry(ServerStorage& Storage)
+{
+	const uint32_t tail = *Storage.SubmissionTail + Storage.UnsubmittedEntryCount;
+	const uint32_t entryIndex = tail & Storage.SubmissionMask;
+	Storage.SubmissionArray[entryIndex] = entryIndex;
+	Storage.UnsubmittedEntryCount++;
+
+	io_uring_sqe* entry = (io_uring_sqe*)Storage.SubmissionEntries + entryIndex;
+	memset(entry, 0, sizeof(*entry));
+	return entry;
+}
+
+// Writes the entries for what is left of the slot's request in the submission ring.
+static void QueueRingEntries(ServerStorage& Storage, uint32_t SlotIndex)
+{
+	ServerStorageSlot& slot = Storage.Slots[SlotIndex];
+	const ServerStorageRequest& request = slot.Request;
+
+	const size_t remainingSize = request.Size - slot.WrittenSize;
+	if (remainingSize > 0)
+	{
+		const bool bFixed = request.BufferIndex >= 0 && Storage.bBuffersRegistered;
+
+		io_uring_sqe* entry = GetNextRingEntry(Storage);
+		entry->opcode = bFixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+		entry->fd = request.FileDescriptor;
+		entry->addr = (uint64_t)(uintptr_t)(request.Data + slot.WrittenSize);
+		entry->len = (uint32_t)std::min<size_t>(remainingSize, 1u << 30);
+		entry->off = request.Offset + slot.WrittenSize;
+		entry->buf_index = bFixed ? (uint16_t)request.BufferIndex : 0;
+		entry->flags = slot.bSynced ? 0 : IOSQE_IO_LINK;
+		entry->user_data = MakeStorageEntryTag(SlotIndex, false);
+		slot.PendingEntryCount++;
+	}
+
+	if (!slot.bSynced)
+	{
+		io_uring_sqe* entry = GetNextRingEntry(Storage);
+		entry->opcode = IORING_OP_FSYNC;
+		entry->fd = request.FileDescriptor;
+		entry->fsync_flags = IORING_FSYNC_DATASYNC;
+		entry->user_data = MakeStorageEntryTag(SlotIndex, true);
+		slot.PendingEntryCount++;
+	}
+}
+
+// Hands the queued entries to the kernel. Returns -errno if it refused them.
+static int SubmitRingEntries(ServerStorage& Storage)
+{
+	// Entries must be visible to the kernel before the tail moving past them is.
+	__atomic_store_n(Storage.SubmissionTail, *Storage.SubmissionTail + Storage.UnsubmittedEntryCount, __ATOMIC_RELEASE);
+
+	uint32_t remainingCount = Storage.UnsubmittedEntryCount;
+	Storage.UnsubmittedEntryCount = 0;
+	while (remainingCount > 0)
+	{
+		const int submittedCount = EnterRing(Storage.RingDescriptor, remainingCount, 0, 0);
+		if (submittedCount < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+			{
+				continue;
+			}
+			return -errno;
+		}
+		remainingCount -= (uint32_t)submittedCount;
+	}
+	return 0;
+}
+
+static void ReapRingCompletions(ServerStorage& Storage, std::vector<ServerStorageCompletion>& OutCompletions)
+{
+	std::vector<uint32_t> touchedSlots;
+
+	uint32_t head = *Storage.CompletionHead;
+	const uint32_t tail = __atomic_load_n(Storage.CompletionTail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++)
+	{
+		const io_uring_cqe& completion = ((const io_uring_cqe*)Storage.CompletionEntries)[head & Storage.CompletionMask];
+		const uint32_t slotIndex = (uint32_t)(completion.user_data >> 1);
+		const bool bSyncEntry = (completion.user_data & 1) != 0;
+		ServerStorageSlot& slot = Storage.Slots[slotIndex];
+
+		if (bSyncEntry)
+		{
+			// A flush is canceled when the write before it came up short, and is submitted again with the rest of the write.
+			if (completion.res == 0)
+			{
+				slot.bSynced = true;
+			}
+			else if (completion.res != -ECANCELED && slot.Result == 0)
+			{
+				slot.Result = completion.res;
+			}
+		}
+		else if (completion.res < 0)
+		{
+			slot.Result = slot.Result == 0 ? completion.res : slot.Result;
+		}
+		else if (completion.res == 0)
+		{
+			// Nothing written at all would only loop.
+			slot.Result = slot.Result == 0 ? -EIO : slot.Result;
+		}
+		else
+		{
+			slot.WrittenSize += (size_t)completion.res;
+		}
+
+		if (--slot.PendingEntryCount == 0)
+		{
+			touchedSlots.push_back(slotIndex);
+		}
+	}
+	__atomic_store_n(Storage.CompletionHead, head, __ATOMIC_RELEASE);
+
+	for (uint32_t slotIndex : touchedSlots)
+	{
+		ServerStorageSlot& slot = Storage.Slots[slotIndex];
+		if (slot.Result == 0 && (slot.WrittenSize < slot.Request.Size || !slot.bSynced))
+		{
+			QueueRingEntries(Storage, slotIndex);
+		}
+		else
+		{
+			ReleaseStorageSlot(Storage, slotIndex, OutCompletions);
+		}
+	}
+
+	if (Storage.UnsubmittedEntryCount > 0)
+	{
+		const int result = SubmitRingEntries(Storage);
+		if (result < 0)
+		{
+			// Entries the kernel refused never complete, so their slots are failed right away.
+			for (uint32_t slotIndex : touchedSlots)
+			{
+				ServerStorageSlot& slot = Storage.Slots[slotIndex];
+				if (slot.PendingEntryCount > 0)
+				{
+					slot.Result = result;
+					slot.PendingEntryCount = 0;
+					ReleaseStorageSlot(Storage, slotIndex, OutCompletions);
+				}
+			}
+		}
+	}
+}
+
+// THREAD POOL
+
+// Runs the request with blocking calls. Returns 0 or -errno.
+static int RunStorageRequest(const ServerStorageRequest& Request)
+{
+	size_t writtenSize = 0;
+	while (writtenSize < Request.Size)
+	{
+		const ssize_t result = pwrite(Request.FileDescriptor, Request.Data + writtenSize, Request.Size - writtenSize,
+			(off_t)(Request.Offset + writtenSize));
+		if (result < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -errno;
+		}
+		if (result == 0)
+		{
+			return -EIO;
+		}
+		writtenSize += (size_t)result;
+	}
+
+	if (Request.bSync && fdatasync(Request.FileDescriptor) != 0)
+	{
+		return -errno;
+	}
+	return 0;
+}
+
+static void RunStorageThread(ServerStorage* Storage)
+{
+	std::unique_lock<std::mutex> lock(Storage->Lock);
+	for (;;)
+	{
+		Storage->QueueSignal.wait(lock, [&]() { return Storage->bStopping || !Storage->QueuedSlots.empty(); });
+		if (Storage->QueuedSlots.empty())
+		{
+			return;
+		}
+
+		const uint32_t slotIndex = Storage->QueuedSlots.front();
+		Storage->QueuedSlots.pop_front();
+		const ServerStorageRequest request = Storage->Slots[slotIndex].Request;
+
+		lock.unlock();
+		const int result = RunStorageRequest(request);
+		lock.lock();
+
+		Storage->Slots[slotIndex].Result = result;
+		Storage->CompletedSlots.push_back(slotIndex);
+		SignalStorageEvent(*Storage);
+	}
+}
+
+// STORAGE
+
+bool InitializeServerStorage(ServerStorage& Storage, ServerStorageBackend Backend, uint8_t* const* Buffers, const size_t* BufferSizes,
+	uint32_t BufferCount)
+{
+	Storage.Slots.assign(SERVER_STORAGE_QUEUE_DEPTH, ServerStorageSlot());
+	Storage.FreeSlots.clear();
+	for (uint32_t slotIndex = SERVER_STORAGE_QUEUE_DEPTH; slotIndex > 0; slotIndex--)
+	{
+		Storage.FreeSlots.push_back(slotIndex - 1);
+	}
+
+	Storage.CompletionEventDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (Storage.CompletionEventDescriptor < 0)
+	{
+		return false;
+	}
+
+	if (Backend != ServerStorageBackend::THREAD_POOL)
+	{
+		if (InitializeRing(Storage, Buffers, BufferSizes, BufferCount))
+		{
+			Storage.Backend = ServerStorageBackend::IO_URING;
+			return true;
+		}
+		if (Backend == ServerStorageBackend::IO_URING)
+		{
+			close(Storage.CompletionEventDescriptor);
+			Storage.CompletionEventDescriptor = -1;
+			return false;
+		}
+	}
+
+	Storage.Backend = ServerStorageBackend::THREAD_POOL;
+	Storage.bStopping = false;
+	for (uint32_t threadIndex = 0; threadIndex < SERVER_STORAGE_THREAD_COUNT; threadIndex++)
+	{
+		Storage.Threads.emplace_back(RunStorageThread, &Storage);
+	}
+	return true;
+}
+
+void ShutdownServerStorage(ServerStorage& Storage)
+{
+	if (Storage.CompletionEventDescriptor < 0)
+	{
+		return;
+	}
+
+	// Requests in flight still point at their buffers.
+	std::vector<ServerStorageCompletion> completions;
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(Storage.Lock);
+			if (Storage.FreeSlots.size() == Storage.Slots.size())
+			{
+				break;
+			}
+		}
+		pollfd pollDescriptor = { Storage.CompletionEventDescriptor, POLLIN, 0 };
+		poll(&pollDescriptor, 1, 100);
+		ReapStorageCompletions(Storage, completions);
+	}
+
+	if (Storage.Backend == ServerStorageBackend::IO_URING)
+	{
+		ReleaseRing(Storage);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(Storage.Lock);
+			Storage.bStopping = true;
+		}
+		Storage.QueueSignal.notify_all();
+		for (std::thread& thread : Storage.Threads)
+		{
+			thread.join();
+		}
+		Storage.Threads.clear();
+	}
+
+	close(Storage.CompletionEventDescriptor);
+	Storage.CompletionEventDescriptor = -1;
+}
+
+bool SubmitStorageRequests(ServerStorage& Storage, const ServerStorageRequest* Requests, size_t Count)
+{
+	std::vector<ServerStorageCompletion> immediateCompletions;
+	{
+		std::lock_guard<std::mutex> lock(Storage.Lock);
+		if (Storage.FreeSlots.size() < Count)
+		{
+			return false;
+		}
+
+		if (Storage.Backend == ServerStorageBackend::THREAD_POOL)
+		{
+			for (size_t requestIndex = 0; requestIndex < Count; requestIndex++)
+			{
+				Storage.QueuedSlots.push_back(AllocateStorageSlot(Storage, Requests[requestIndex]));
+			}
+			if (Count == 1) Storage.QueueSignal.notify_one();
+			else Storage.QueueSignal.notify_all();
+			return true;
+		}
+
+		std::vector<uint32_t> slots;
+		for (size_t requestIndex = 0; requestIndex < Count; requestIndex++)
+		{
+			const uint32_t slotIndex = AllocateStorageSlot(Storage, Requests[requestIndex]);
+			QueueRingEntries(Storage, slotIndex);
+
+			// Nothing to write nor flush: done already.
+			if (Storage.Slots[slotIndex].PendingEntryCount == 0)
+			{
+				Storage.CompletedSlots.push_back(slotIndex);
+			}
+			slots.push_back(slotIndex);
+		}
+
+		const int result = SubmitRingEntries(Storage);
+		if (result < 0)
+		{
+			for (uint32_t slotIndex : slots)
+			{
+				ServerStorageSlot& slot = Storage.Slots[slotIndex];
+				if (slot.PendingEntryCount > 0)
+				{
+					slot.Result = result;
+					slot.PendingEntryCount = 0;
+					Storage.CompletedSlots.push_back(slotIndex);
+				}
+			}
+		}
+		if (!Storage.CompletedSlots.empty())
+		{
+			SignalStorageEvent(Storage);
+		}
+	}
+	return true;
+}
+
+void ReapStorageCompletions(ServerStorage& Storage, std::vector<ServerStorageCompletion>& OutCompletions)
+{
+	DrainStorageEvent(Storage);
+
+	std::lock_guard<std::mutex> lock(Storage.Lock);
+	if (Storage.Backend == ServerStorageBackend::IO_URING)
+	{
+		ReapRingCompletions(Storage, OutCompletions);
+	}
+	for (uint32_t slotIndex : Storage.CompletedSlots)
+	{
+		ReleaseStorageSlot(Storage, slotIndex, OutCompletions);
+	}
+	Storage.CompletedSlots.clear();
+}
+
+#else
+
+bool InitializeServerStorage(ServerStorage& Storage, ServerStorageBackend Backend, uint8_t* const* Buffers, const size_t* BufferSizes,
+	uint32_t BufferCount)
+{
+	return false;
+}
+
+void ShutdownServerStorage(ServerStorage& Storage)
+{
+}
+
+bool SubmitStorageRequests(ServerStorage& Storage, const ServerStorageRequest* Requests, size_t Count)
+{
+	return false;
+}
+
+void ReapStorageCompletions(ServerStorage& Storage, std::vector<ServerStorageCompletion>& OutCompletions)
+{
+}
+
+#endif
+
+const char* GetServerStorageBackendName(ServerStorageBackend Backend)
+{
+	switch (Backend)
+	{
+	case ServerStorageBackend::AUTO: return "auto";
+	case ServerStorageBackend::IO_URING: return "io_uring";
+	case ServerStorageBackend::THREAD_POOL: return "threads";
+	default: return "unknown";
+	}
+}
@@ -0,0 +1,560 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Server's subscriptions: keeping a client's copy of part of the graph up to date, filtered by what it may see.
+
+#include "Server.h"
+
+#include <algorithm>
+
+/*
+	HOW IT WORKS
+
+	A subscription's view is made of the nodes in its scope (a subtree or a neighbourhood) that its viewer may see, and of the connections
+	between them the viewer may see. Rights follow connections, starting from the viewer node:
+	- The viewer has access to itself, and to whatever OPEN connections lead to from nodes it has access to.
+	- It sees nodes it has access to, destinations of INTERNAL or higher connections from them, and destinations of PUBLIC or higher
+	  connections from any node it sees. Since child to parent connections are at least PUBLIC, ancestors of seen nodes are seen too.
+	- It sees PRIVATE connections between nodes it has access to both of, INTERNAL ones from nodes it has access to, and PUBLIC or higher
+	  ones from nodes it sees.
+
+	The view is computed with every shard held, as the walks finding rights and scope may go anywhere in the graph. Afterwards, the shards'
+	journals are read each under its own shard's lock, and only changes involving a node in scope or that may alter the viewer's rights are
+	kept: the graph can't change what the viewer sees, or what is in scope, anywhere else. Of those:
+	- Changes that may alter rights or scope, such as connections set from seen nodes or nodes moved, compute the view again from scratch.
+	- The others, renames or connections from nodes the viewer doesn't see, can't change which nodes and connections are in the view. The
+	  view nodes they name are only read again, holding just the shards they live in.
+	Rights come from the visibility cache (see ServerVisibility_INC.cpp), so subscriptions of the same viewer share a single walk of the graph.
+	Updates are the difference between the view and what the client holds, cut short once they spend the subscription's budget. The view
+	keeps copies of node names and versions, so they are written without holding any shard.
+*/
+
+// How often subscriptions are brought up to date.
+constexpr int SERVER_SUBSCRIPTION_SYNC_INTERVAL_MS = 50;
+
+// Most nodes in a view, and most nodes the scope walk goes through to compute it.
+constexpr size_t SERVER_SUBSCRIPTION_MAX_VIEW_NODES = 64 * 1024;
+constexpr size_t SERVER_SUBSCRIPTION_MAX_WALKED_NODES = 256 * 1024;
+
+// Bandwidth budgets, in bytes per second, and the most a single update may carry.
+constexpr uint32_t SERVER_SUBSCRIPTION_DEFAULT_BUDGET = 1024 * 1024;
+constexpr uint32_t SERVER_SUBSCRIPTION_MIN_BUDGET = 16 * 1024;
+constexpr size_t SERVER_SUBSCRIPTION_MAX_UPDATE_SIZE = 256 * 1024;
+
+// Sessions with more unsent bytes than this don't get updates until the backlog drains. Their changes coalesce in the meantime.
+constexpr size_t SERVER_SUBSCRIPTION_MAX_PENDING_WRITE_SIZE = 256 * 1024;
+
+// Rights of the viewer over a node.
+enum class ServerNodeRights : uint8_t
+{
+	NONE,
+	VISIBLE,
+	ACCESS,
+};
+
+// VIEW
+
+static ServerNodeRights GetNodeRights(const ServerViewerRights& Rights, SNodeGUID NodeID)
+{
+	if (Rights.Accessible.Contains(NodeID)) return ServerNodeRights::ACCESS;
+	return Rights.Visible.Contains(NodeID) ? ServerNodeRights::VISIBLE : ServerNodeRights::NONE;
+}
+
+// Lists the nodes in scope, parents before their children for subtrees, recording them as dependencies.
+static void ComputeScope(ServerGraph& Graph, ServerSubscription& Subscription, std::vector<SNodeGUID>& OutScope)
+{
+	const SProtocolSubscribeRequest& request = Subscription.Request;
+	OutScope.push_back(request.RootID);
+	Subscription.Dependencies.insert(request.RootID);
+
+	if (request.Scope == SProtocolSubscriptionScope::SUBTREE)
+	{
+		// Depth first, keeping each node's depth alongside it.
+		std::vector<std::pair<SNodeGUID, uint32_t>> stack = { { request.RootID, 0 } };
+		while (!stack.empty())
+		{
+			const std::pair<SNodeGUID, uint32_t> entry = stack.back();
+			stack.pop_back();
+			if (request.Depth != 0 && entry.second >= request.Depth)
+			{
+				continue;
+			}
+
+			ForEachServerChild(Graph, entry.first, [&](SNodeGUID ChildID)
+			{
+				if (OutScope.size() < SERVER_SUBSCRIPTION_MAX_WALKED_NODES)
+				{
+					OutScope.push_back(ChildID);
+					Subscription.Dependencies.insert(ChildID);
+					stack.push_back({ ChildID, entry.second + 1 });
+				}
+			});
+		}
+		return;
+	}
+
+	// Breadth first, one hop at a time.
+	std::unordered_set<SNodeGUID> reached = { request.RootID };
+	const uint32_t hopCount = std::max<uint32_t>(request.Depth, 1);
+	size_t hopStart = 0;
+	for (uint32_t hop = 0; hop < hopCount && hopStart < OutScope.size(); hop++)
+	{
+		const size_t hopEnd = OutScope.size();
+		for (size_t scopeIndex = hopStart; scopeIndex < hopEnd; scopeIndex++)
+		{
+			ForEachServerConnection(Graph, OutScope[scopeIndex], [&](SNodeGUID DestID, SNodeConnectionAccessLevel)
+			{
+				if (OutScope.size() < SERVER_SUBSCRIPTION_MAX_WALKED_NODES && reached.insert(DestID).second)
+				{
+					OutScope.push_back(DestID);
+					Subscription.Dependencies.insert(DestID);
+				}
+			});
+		}
+		hopStart = hopEnd;
+	}
+}
+
+static bool IsConnectionVisible(ServerNodeRights SrcRights, ServerNodeRights DestRights, SNodeConnectionAccessLevel AccessLevel)
+{
+	switch (AccessLevel)
+	{
+	case SNodeConnectionAccessLevel::PRIVATE:
+		return SrcRights == ServerNodeRights::ACCESS && DestRights == ServerNodeRights::ACCESS;
+	case SNodeConnectionAccessLevel::INTERNAL:
+		return SrcRights == ServerNodeRights::ACCESS;
+	case SNodeConnectionAccessLevel::PUBLIC:
+	case SNodeConnectionAccessLevel::OPEN:
+		return SrcRights != ServerNodeRights::NONE;
+	default:
+		return false;
+	}
+}
+
+// Computes the subscription's view from scratch. Every shard must be held. Returns false if its root or viewer doesn't exist anymore.
+static bool ComputeSubscriptionView(ServerGraph& Graph, ServerSubscription& Subscription)
+{
+	Subscription.Dependencies.clear();
+	Subscription.ViewOrder.clear();
+	Subscription.ViewNodes.clear();
+	Subscription.ViewConnections.clear();
+	Subscription.DirtyNodes.clear();
+	Subscription.Rights.reset();
+	Subscription.bStale = false;
+	Subscription.bBehind = true;
+
+	if (!ServerNodeExists(Graph, Subscription.Request.RootID) || !ServerNodeExists(Graph, Subscription.Request.ViewerID))
+	{
+		return false;
+	}
+
+	Subscription.Rights = GetServerViewerRights(Graph, Subscription.Request.ViewerID);
+	const ServerViewerRights& rights = *Subscription.Rights;
+
+	std::vector<SNodeGUID> scope;
+	ComputeScope(Graph, Subscription, scope);
+
+	for (SNodeGUID nodeID : scope)
+	{
+		if (Subscription.ViewOrder.size() < SERVER_SUBSCRIPTION_MAX_VIEW_NODES && rights.Visible.Contains(nodeID))
+		{
+			Subscription.ViewOrder.push_back(nodeID);
+			Subscription.ViewNodes.emplace(nodeID, ServerSubscribedNode());
+		}
+	}
+
+	for (SNodeGUID nodeID : Subscription.ViewOrder)
+	{
+		ServerSubscribedNode& viewNode = Subscription.ViewNodes[nodeID];
+		const SNodeGUID parentID = GetServerNodeParentID(Graph, nodeID);
+		if (Subscription.ViewNodes.count(parentID) != 0)
+		{
+			viewNode.ParentID = parentID;
+		}
+		viewNode.Version = GetServerNodeVersion(Graph, nodeID);
+		const std::string_view name = GetServerNodeName(Graph, nodeID);
+		viewNode.Name.assign(name.data(), name.size());
+
+		const ServerNodeRights srcRights = GetNodeRights(rights, nodeID);
+		ForEachServerConnection(Graph, nodeID, [&](SNodeGUID DestID, SNodeConnectionAccessLevel AccessLevel)
+		{
+			// Nodes of the view are all visible.
+			if (Subscription.ViewNodes.count(DestID) != 0 && IsConnectionVisible(srcRights, GetNodeRights(rights, DestID), AccessLevel))
+			{
+				Subscription.ViewConnections.push_back({ { nodeID, DestID }, AccessLevel });
+			}
+		});
+	}
+	return true;
+}
+
+// Applies a change read from a shard's journal to the subscription, see HOW IT WORKS.
+static void ApplySubscriptionChange(ServerSubscription& Subscription, const SGraphChange& Change)
+{
+	if (Change.Kind == SGraphChangeKind::TRANSACTION || Subscription.bStale)
+	{
+		return;
+	}
+
+	if (Change.Kind == SGraphChangeKind::RESYNC || Subscription.Rights == nullptr || DoesChangeAffectViewerRights(*Subscription.Rights, Change))
+	{
+		Subscription.bStale = true;
+		return;
+	}
+
+	if (Subscription.Dependencies.count(Change.NodeID) == 0 && Subscription.Dependencies.count(Change.OtherID) == 0)
+	{
+		return;
+	}
+
+	switch (Change.Kind)
+	{
+	case SGraphChangeKind::NODE_CREATED:
+		// Its parent isn't seen, so neither is the node, but it may be in scope. Scope being too large only costs extra reads.
+		Subscription.Dependencies.insert(Change.NodeID);
+		break;
+	case SGraphChangeKind::PARENT_CHANGED:
+		// Takes a whole subtree in or out of scope, seen nodes of it included.
+		Subscription.bStale = true;
+		return;
+	case SGraphChangeKind::CONNECTION_CHANGED:
+		// Neighbourhoods follow connections whatever the viewer sees of them.
+		if (Subscription.Request.Scope != SProtocolSubscriptionScope::SUBTREE)
+		{
+			Subscription.bStale = true;
+			return;
+		}
+		break;
+	default:
+		break;
+	}
+
+	// Versions of both ends of a connection move with it.
+	for (SNodeGUID nodeID : { Change.NodeID, Change.OtherID })
+	{
+		if (Subscription.ViewNodes.count(nodeID) != 0)
+		{
+			Subscription.DirtyNodes.insert(nodeID);
+		}
+	}
+}
+
+// Reads what the shards' journals hold for the subscription, applying what concerns it.
+static void ReadSubscriptionJournals(ServerGraph& Graph, ServerSubscription& Subscription, bool bLockShards)
+{
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		ServerShard& shard = Graph.Shards[shardIndex];
+		if (bLockShards)
+		{
+			shard.Lock.lock();
+		}
+
+		shard.Journal.Read(Subscription.Cursors[shardIndex], [&Subscription](const SGraphChange& Change)
+		{
+			ApplySubscriptionChange(Subscription, Change);
+		});
+
+		if (bLockShards)
+		{
+			shard.Lock.unlock();
+		}
+	}
+}
+
+/*
+	Reads the names and versions of the view's dirty nodes again, holding only the shards they live in, locked in index order.
+	Nodes deleted in the meantime are left as they were: their deletion is in the journals, and computes the view again once read.
+*/
+static void RefreshDirtyViewNodes(ServerGraph& Graph, ServerSubscription& Subscription)
+{
+	ServerShardMask shards = 0;
+	for (SNodeGUID nodeID : Subscription.DirtyNodes)
+	{
+		shards |= (ServerShardMask)1 << ShardOfNode(Graph, nodeID);
+	}
+
+	LockShards(Graph, shards);
+	for (SNodeGUID nodeID : Subscription.DirtyNodes)
+	{
+		auto viewNode = Subscription.ViewNodes.find(nodeID);
+		if (viewNode != Subscription.ViewNodes.end() && ServerNodeExists(Graph, nodeID))
+		{
+			viewNode->second.Version = GetServerNodeVersion(Graph, nodeID);
+			const std::string_view name = GetServerNodeName(Graph, nodeID);
+			viewNode->second.Name.assign(name.data(), name.size());
+		}
+	}
+	UnlockShards(Graph, shards);
+
+	Subscription.DirtyNodes.clear();
+}
+
+// UPDATES
+
+/*
+	Appends the records bringing the client's copy closer to the view, until the update reaches its size budget.
+	Only reads the view, no shard needs to be held. Returns whether the client caught up with the view.
+*/
+static bool WriteSubscriptionRecords(ServerSubscription& Subscription, std::vector<uint8_t>& Buffer, size_t BudgetEnd)
+{
+	auto Emit = [&Buffer](const SProtocolSubscriptionRecord& Record)
+	{
+		SProtocolAppendSubscriptionRecord(Buffer, Record);
+	};
+
+	auto EmitConnection = [&](const ServerConnectionKey& Key, SNodeConnectionAccessLevel AccessLevel)
+	{
+		SProtocolSubscriptionRecord record;
+		record.Kind = SProtocolSubscriptionRecordKind::CONNECTION;
+		record.NodeID = Key.Src;
+		record.OtherID = Key.Dest;
+		record.AccessLevel = AccessLevel;
+		Emit(record);
+	};
+
+	// Nodes, with their view parents before them so clients can always link them.
+	auto EmitNode = [&](SNodeGUID NodeID)
+	{
+		const ServerSubscribedNode& viewNode = Subscription.ViewNodes[NodeID];
+		auto found = Subscription.ClientNodes.find(NodeID);
+		if (found != Subscription.ClientNodes.end() && found->second.ParentID == viewNode.ParentID && found->second.Version == viewNode.Version
+			&& found->second.Name == viewNode.Name)
+		{
+			return;
+		}
+
+		SProtocolSubscriptionRecord record;
+		record.NodeID = NodeID;
+		record.OtherID = viewNode.ParentID;
+		record.Name = viewNode.Name;
+		record.Version = viewNode.Version;
+		Emit(record);
+		Subscription.ClientNodes[NodeID] = viewNode;
+	};
+
+	std::vector<SNodeGUID> missingAncestors;
+	for (SNodeGUID nodeID : Subscription.ViewOrder)
+	{
+		missingAncestors.clear();
+		for (SNodeGUID ancestorID = Subscription.ViewNodes[nodeID].ParentID;
+			ancestorID != SNODE_INVALID_ID && Subscription.ClientNodes.count(ancestorID) == 0;
+			ancestorID = Subscription.ViewNodes[ancestorID].ParentID)
+		{
+			missingAncestors.push_back(ancestorID);
+		}
+		for (size_t ancestorIndex = missingAncestors.size(); ancestorIndex-- > 0;)
+		{
+			EmitNode(missingAncestors[ancestorIndex]);
+		}
+
+		EmitNode(nodeID);
+		if (Buffer.size() >= BudgetEnd)
+		{
+			return false;
+		}
+	}
+
+	// Connections between nodes the client holds, then those that left the view between nodes staying in it.
+	std::unordered_set<ServerConnectionKey, ServerConnectionKeyHash> viewConnectionKeys;
+	for (const ServerViewConnection& connection : Subscription.ViewConnections)
+	{
+		viewConnectionKeys.insert(connection.Key);
+
+		SNodeConnectionAccessLevel& clientAccessLevel = Subscription.ClientConnections[connection.Key];
+		if (clientAccessLevel != connection.AccessLevel)
+		{
+			EmitConnection(connection.Key, connection.AccessLevel);
+			clientAccessLevel = connection.AccessLevel;
+			if (Buffer.size() >= BudgetEnd)
+			{
+				return false;
+			}
+		}
+	}
+
+	for (auto connection = Subscription.ClientConnections.begin(); connection != Subscription.ClientConnections.end();)
+	{
+		if (viewConnectionKeys.count(connection->first) != 0 || Subscription.ViewNodes.count(connection->first.Src) == 0
+			|| Subscription.ViewNodes.count(connection->first.Dest) == 0)
+		{
+			++connection;
+			continue;
+		}
+
+		EmitConnection(connection->first, SNodeConnectionAccessLevel::NONE);
+		connection = Subscription.ClientConnections.erase(connection);
+		if (Buffer.size() >= BudgetEnd)
+		{
+			return false;
+		}
+	}
+
+	// Nodes that left the view. Clients drop their connections along with them.
+	std::unordered_set<SNodeGUID> removedNodes;
+	bool bCaughtUp = true;
+	for (auto node = Subscription.ClientNodes.begin(); node != Subscription.ClientNodes.end();)
+	{
+		if (Subscription.ViewNodes.count(node->first) != 0)
+		{
+			++node;
+			continue;
+		}
+		if (Buffer.size() >= BudgetEnd)
+		{
+			bCaughtUp = false;
+			break;
+		}
+
+		SProtocolSubscriptionRecord record;
+		record.Kind = SProtocolSubscriptionRecordKind::NODE_REMOVED;
+		record.NodeID = node->first;
+		Emit(record);
+		removedNodes.insert(node->first);
+		node = Subscription.ClientNodes.erase(node);
+	}
+
+	if (!removedNodes.empty())
+	{
+		for (auto connection = Subscription.ClientConnections.begin(); connection != Subscription.ClientConnections.end();)
+		{
+			const bool bRemoved = removedNodes.count(connection->first.Src) != 0 || removedNodes.count(connection->first.Dest) != 0;
+			connection = bRemoved ? Subscription.ClientConnections.erase(connection) : std::next(connection);
+		}
+	}
+	return bCaughtUp;
+}
+
+static void AppendSubscriptionEnded(std::vector<uint8_t>& Buffer, ServerSubscription& Subscription)
+{
+	const size_t frameStart = SProtocolBeginSubscriptionUpdate(Buffer, Subscription.Request.RequestID, ++Subscription.UpdateSequence);
+	SProtocolEndSubscriptionUpdate(Buffer, frameStart, SPROTOCOL_SUBSCRIPTION_ENDED);
+}
+
+bool HandleSubscribe(ServerState& Server, ServerWorker& Worker, ServerSession& Session, const uint8_t* Payload, size_t PayloadSize)
+{
+	SProtocolSubscribeRequest request;
+	if (!SProtocolDecodeSubscribe(Payload, PayloadSize, request))
+	{
+		return false;
+	}
+
+	Worker.SubscriptionCount -= Session.Subscription != nullptr;
+	Session.Subscription.reset(new ServerSubscription());
+
+	ServerSubscription& subscription = *Session.Subscription;
+	subscription.Request = request;
+	subscription.Cursors.resize(Server.Graph.ShardCount);
+
+	const uint32_t budget = request.BandwidthBudget != 0 ? request.BandwidthBudget : SERVER_SUBSCRIPTION_DEFAULT_BUDGET;
+	subscription.Request.BandwidthBudget = std::max(budget, SERVER_SUBSCRIPTION_MIN_BUDGET);
+	subscription.BudgetBytes = subscription.Request.BandwidthBudget;
+	subscription.LastRefillTime = std::chrono::steady_clock::now();
+
+	// Without a root, the request only ends the previous subscription.
+	if (request.RootID == SNODE_INVALID_ID)
+	{
+		AppendSubscriptionEnded(Session.WriteBuffer, subscription);
+		Session.Subscription.reset();
+		return true;
+	}
+
+	Worker.SubscriptionCount++;
+	if (!SyncSubscription(Server, Worker, Session))
+	{
+		Worker.SubscriptionCount--;
+		Session.Subscription.reset();
+	}
+	return true;
+}
+
+bool SyncSubscription(ServerState& Server, ServerWorker& Worker, ServerSession& Session)
+{
+	ServerSubscription& subscription = *Session.Subscription;
+	ServerGraph& graph = Server.Graph;
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const int64_t elapsedMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(now - subscription.LastRefillTime).count();
+	const int64_t refill = elapsedMicroseconds * subscription.Request.BandwidthBudget / 1000000;
+	if (refill > 0)
+	{
+		// At most a second's worth of budget is kept around.
+		subscription.BudgetBytes = std::min<int64_t>(subscription.BudgetBytes + refill, subscription.Request.BandwidthBudget);
+		subscription.LastRefillTime = now;
+	}
+
+	// Most of the time nothing relevant happened, which only takes each shard's lock in turn to find out.
+	if (subscription.bSnapshotSent)
+	{
+		ReadSubscriptionJournals(graph, subscription, true);
+	}
+	if (!subscription.bStale && !subscription.bBehind && subscription.DirtyNodes.empty())
+	{
+		return true;
+	}
+	if (subscription.BudgetBytes <= 0)
+	{
+		return true;
+	}
+
+	if (subscription.bStale)
+	{
+		const ServerShardMask allShards = GetAllShardsMask(graph);
+		LockShards(graph, allShards);
+
+		// Changes that happened since the first read still count.
+		if (subscription.bSnapshotSent)
+		{
+			ReadSubscriptionJournals(graph, subscription, false);
+		}
+		else
+		{
+			for (uint32_t shardIndex = 0; shardIndex < graph.ShardCount; shardIndex++)
+			{
+				subscription.Cursors[shardIndex] = graph.Shards[shardIndex].Journal.Subscribe();
+			}
+		}
+
+		const bool bViewComputed = ComputeSubscriptionView(graph, subscription);
+		UnlockShards(graph, allShards);
+
+		if (!bViewComputed)
+		{
+			AppendSubscriptionEnded(Session.WriteBuffer, subscription);
+			return false;
+		}
+	}
+	else if (!subscription.DirtyNodes.empty())
+	{
+		RefreshDirtyViewNodes(graph, subscription);
+	}
+
+	std::vector<uint8_t>& buffer = Session.WriteBuffer;
+	const size_t frameStart = SProtocolBeginSubscriptionUpdate(buffer, subscription.Request.RequestID, subscription.UpdateSequence + 1);
+	const size_t budgetEnd = frameStart + std::min<size_t>((size_t)subscription.BudgetBytes, SERVER_SUBSCRIPTION_MAX_UPDATE_SIZE);
+	const size_t headerEnd = buffer.size();
+
+	subscription.bBehind = !WriteSubscriptionRecords(subscription, buffer, budgetEnd);
+
+	SProtocolSubscriptionUpdateFlags flags = 0;
+	flags |= subscription.bSnapshotSent ? 0 : SPROTOCOL_SUBSCRIPTION_SNAPSHOT;
+	flags |= subscription.bBehind ? SPROTOCOL_SUBSCRIPTION_PARTIAL : 0;
+
+	Worker.Metrics.SubscriptionSyncLatency.Record(
+		(uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - now).count());
+
+	// Empty updates aren't worth sending, unless they tell the client its view is empty.
+	if (buffer.size() == headerEnd && subscription.bSnapshotSent)
+	{
+		buffer.resize(frameStart);
+		return true;
+	}
+
+	SProtocolEndSubscriptionUpdate(buffer, frameStart, flags);
+	subscription.UpdateSequence++;
+	subscription.bSnapshotSent = true;
+	subscription.BudgetBytes -= (int64_t)(buffer.size() - frameStart);
+
+	Worker.Metrics.SubscriptionUpdateCount.Add(1);
+	Worker.Metrics.SubscriptionUpdateByteCount.Add(buffer.size() - frameStart);
+	return true;
+}
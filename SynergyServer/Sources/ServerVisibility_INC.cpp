@@ -0,0 +1,224 @@
+SOURCE_INC_FILE()
+
+// Implementation of the Server's visibility cache: the rights viewers have over the graph, kept as compressed node sets and reused by
+// every subscription of the same viewer until a change may have altered them.
+
+#include "Server.h"
+
+#include <algorithm>
+
+/*
+	HOW IT WORKS
+
+	Rights follow connections from the viewer (see ServerSubscriptions_INC.cpp), so they can only change when a connection leaving a node
+	their walk went through changes: a connection set or removed from it, a node created under it or moved from or to it, or it being
+	deleted. Renames never change them, neither do changes to nodes the walk never reached.
+
+	Entries hold a cursor in each shard's journal and only read what the journals hold for them when they are used again, so entries of
+	viewers nobody subscribes with cost nothing. A journal overrunning an entry's cursor drops it, as anything may have changed.
+*/
+
+// Most nodes the rights walk goes through. Viewers reaching more only get rights over the first ones it found.
+constexpr size_t SERVER_VISIBILITY_MAX_WALKED_NODES = 256 * 1024;
+
+// NODE BITMAPS
+
+static inline uint64_t GetBitmapKey(SNodeGUID NodeID)
+{
+	return NodeID >> SERVER_NODE_BITMAP_LOW_BITS;
+}
+
+static inline uint16_t GetBitmapLowBits(SNodeGUID NodeID)
+{
+	return (uint16_t)(NodeID & (((SNodeGUID)1 << SERVER_NODE_BITMAP_LOW_BITS) - 1));
+}
+
+bool ServerNodeBitmap::Contains(SNodeGUID NodeID) const
+{
+	const uint64_t key = GetBitmapKey(NodeID);
+	auto container = std::lower_bound(Containers.begin(), Containers.end(), key,
+		[](const ServerNodeBitmapContainer& Container, uint64_t Key) { return Container.Key < Key; });
+	if (container == Containers.end() || container->Key != key)
+	{
+		return false;
+	}
+
+	const uint16_t lowBits = GetBitmapLowBits(NodeID);
+	if (!container->Words.empty())
+	{
+		return (container->Words[lowBits / 64] >> (lowBits % 64)) & 1;
+	}
+	return std::binary_search(container->Values.begin(), container->Values.end(), lowBits);
+}
+
+bool ServerNodeBitmap::Insert(SNodeGUID NodeID)
+{
+	const uint64_t key = GetBitmapKey(NodeID);
+	auto container = std::lower_bound(Containers.begin(), Containers.end(), key,
+		[](const ServerNodeBitmapContainer& Container, uint64_t Key) { return Container.Key < Key; });
+	if (container == Containers.end() || container->Key != key)
+	{
+		container = Containers.insert(container, ServerNodeBitmapContainer());
+		container->Key = key;
+	}
+
+	const uint16_t lowBits = GetBitmapLowBits(NodeID);
+	if (!container->Words.empty())
+	{
+		uint64_t& word = container->Words[lowBits / 64];
+		const uint64_t bit = 1ull << (lowBits % 64);
+		if (word & bit)
+		{
+			return false;
+		}
+		word |= bit;
+	}
+	else
+	{
+		auto value = std::lower_bound(container->Values.begin(), container->Values.end(), lowBits);
+		if (value != container->Values.end() && *value == lowBits)
+		{
+			return false;
+		}
+		container->Values.insert(value, lowBits);
+
+		// Past this size the array takes more room than a bitmap of the whole group.
+		if (container->Values.size() > SERVER_NODE_BITMAP_MAX_ARRAY_SIZE)
+		{
+			container->Words.assign(SERVER_NODE_BITMAP_WORD_COUNT, 0);
+			for (uint16_t arrayValue : container->Values)
+			{
+				container->Words[arrayValue / 64] |= 1ull << (arrayValue % 64);
+			}
+			std::vector<uint16_t>().swap(container->Values);
+		}
+	}
+
+	container->Count++;
+	Count++;
+	return true;
+}
+
+size_t ServerNodeBitmap::GetMemorySize() const
+{
+	size_t memorySize = Containers.capacity() * sizeof(ServerNodeBitmapContainer);
+	for (const ServerNodeBitmapContainer& container : Containers)
+	{
+		memorySize += container.Values.capacity() * sizeof(uint16_t) + container.Words.capacity() * sizeof(uint64_t);
+	}
+	return memorySize;
+}
+
+// RIGHTS
+
+// Walks the rights of the viewer over the graph: access first, then visibility from every node reached, accessed ones included.
+static void ComputeViewerRights(ServerGraph& Graph, SNodeGUID ViewerID, ServerViewerRights& OutRights)
+{
+	OutRights.ViewerID = ViewerID;
+	OutRights.Accessible.Insert(ViewerID);
+	OutRights.Visible.Insert(ViewerID);
+
+	std::vector<SNodeGUID> walk = { ViewerID };
+	for (size_t walkIndex = 0; walkIndex < walk.size(); walkIndex++)
+	{
+		ForEachServerConnection(Graph, walk[walkIndex], [&](SNodeGUID DestID, SNodeConnectionAccessLevel AccessLevel)
+		{
+			if (AccessLevel == SNodeConnectionAccessLevel::OPEN && walk.size() < SERVER_VISIBILITY_MAX_WALKED_NODES
+				&& OutRights.Accessible.Insert(DestID))
+			{
+				OutRights.Visible.Insert(DestID);
+				walk.push_back(DestID);
+			}
+		});
+	}
+
+	const size_t accessCount = walk.size();
+	for (size_t walkIndex = 0; walkIndex < walk.size(); walkIndex++)
+	{
+		const SNodeConnectionAccessLevel minimum = walkIndex < accessCount ? SNodeConnectionAccessLevel::INTERNAL : SNodeConnectionAccessLevel::PUBLIC;
+		ForEachServerConnection(Graph, walk[walkIndex], [&](SNodeGUID DestID, SNodeConnectionAccessLevel AccessLevel)
+		{
+			if (AccessLevel >= minimum && walk.size() < SERVER_VISIBILITY_MAX_WALKED_NODES && OutRights.Visible.Insert(DestID))
+			{
+				walk.push_back(DestID);
+			}
+		});
+	}
+}
+
+bool DoesChangeAffectViewerRights(const ServerViewerRights& Rights, const SGraphChange& Change)
+{
+	switch (Change.Kind)
+	{
+	case SGraphChangeKind::CONNECTION_CHANGED:
+		return Rights.Visible.Contains(Change.NodeID);
+	case SGraphChangeKind::NODE_CREATED:
+	case SGraphChangeKind::NODE_DELETED:
+	case SGraphChangeKind::PARENT_CHANGED:
+		return Rights.Visible.Contains(Change.NodeID) || (Change.OtherID != SNODE_INVALID_ID && Rights.Visible.Contains(Change.OtherID));
+	case SGraphChangeKind::RESYNC:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Reads what the shards' journals hold for the entry. Returns whether its rights still hold.
+static bool RefreshVisibilityCacheEntry(ServerGraph& Graph, ServerVisibilityCacheEntry& Entry)
+{
+	bool bValid = true;
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		Graph.Shards[shardIndex].Journal.Read(Entry.Cursors[shardIndex], [&](const SGraphChange& Change)
+		{
+			bValid = bValid && !DoesChangeAffectViewerRights(*Entry.Rights, Change);
+		});
+	}
+	return bValid;
+}
+
+std::shared_ptr<const ServerViewerRights> GetServerViewerRights(ServerGraph& Graph, SNodeGUID ViewerID)
+{
+	ServerVisibilityCache& cache = Graph.VisibilityCache;
+	cache.UseCount++;
+
+	auto found = cache.Entries.find(ViewerID);
+	if (found != cache.Entries.end())
+	{
+		if (RefreshVisibilityCacheEntry(Graph, found->second))
+		{
+			found->second.LastUse = cache.UseCount;
+			cache.HitCount.fetch_add(1, std::memory_order_relaxed);
+			return found->second.Rights;
+		}
+
+		cache.InvalidationCount.fetch_add(1, std::memory_order_relaxed);
+		cache.MemorySize.fetch_sub(found->second.MemorySize, std::memory_order_relaxed);
+		cache.Entries.erase(found);
+	}
+	cache.MissCount.fetch_add(1, std::memory_order_relaxed);
+
+	// A full cache makes room by dropping the least recently used viewer.
+	if (cache.Entries.size() >= SERVER_VISIBILITY_CACHE_MAX_VIEWERS)
+	{
+		auto leastRecentlyUsed = std::min_element(cache.Entries.begin(), cache.Entries.end(),
+			[](const auto& Left, const auto& Right) { return Left.second.LastUse < Right.second.LastUse; });
+		cache.MemorySize.fetch_sub(leastRecentlyUsed->second.MemorySize, std::memory_order_relaxed);
+		cache.Entries.erase(leastRecentlyUsed);
+	}
+
+	std::shared_ptr<ServerViewerRights> rights = std::make_shared<ServerViewerRights>();
+	ComputeViewerRights(Graph, ViewerID, *rights);
+
+	ServerVisibilityCacheEntry& entry = cache.Entries[ViewerID];
+	entry.Rights = rights;
+	entry.LastUse = cache.UseCount;
+	entry.MemorySize = sizeof(ServerViewerRights) + rights->Accessible.GetMemorySize() + rights->Visible.GetMemorySize();
+	cache.MemorySize.fetch_add(entry.MemorySize, std::memory_order_relaxed);
+	entry.Cursors.resize(Graph.ShardCount);
+	for (uint32_t shardIndex = 0; shardIndex < Graph.ShardCount; shardIndex++)
+	{
+		entry.Cursors[shardIndex] = Graph.Shards[shardIndex].Journal.Subscribe();
+	}
+	return rights;
+}
@@ -1,9 +1,188 @@
-#include "SynergyCore.h"
+#define TRANSLATION_UNIT SYNERGY_SERVER_MAIN
 
+// Entry point of the Synergy Server: parses the command line, sets up the authoritative graph, then runs the network until asked to stop.
+
+#include "Server.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
 #include <iostream>
 
+// Source includes
+#include "ServerShards_INC.cpp"
+#include "ServerGraph_INC.cpp"
+#include "ServerVisibility_INC.cpp"
+#include "ServerSubscriptions_INC.cpp"
+#include "ServerStorage_INC.cpp"
+#include "ServerPersistence_INC.cpp"
+#include "ServerNetwork_INC.cpp"
+#include "ServerMetrics_INC.cpp"
+
+// Set by the signal handler.
+static volatile sig_atomic_t GStopRequested = 0;
+
+static void HandleStopSignal(int)
+{
+	GStopRequested = 1;
+}
+
+static void PrintUsage()
+{
+	std::cout <<
+		"Usage: SynergyServer [options]\n"
+		"  --port N             TCP port to listen on (default " << SPROTOCOL_DEFAULT_PORT << ")\n"
+		"  --any-address        Listen on every interface instead of loopback only\n"
+		"  --threads N          Event loop threads, 0 for automatic (default 0)\n"
+		"  --max-sessions N     Concurrent sessions accepted (default 16384)\n"
+		"  --max-nodes N        Graph node capacity (default 1048576)\n"
+		"  --max-connections N  Graph connection capacity (default 4194304)\n"
+		"  --shards N           Graph shards, 0 for one per worker thread (default 1, max " << SERVER_MAX_SHARD_COUNT << ")\n"
+		"  --bulk-file PATH     Seed the graph from a bulk file\n"
+		"  --metrics-port N     Serve Prometheus metrics over HTTP on this loopback port (default off)\n"
+		"  --data-dir PATH      Persist the graph in this directory, restoring it from there on start (default off)\n"
+		"  --storage-backend B  Persistence writes through auto, io_uring or threads (default auto)\n"
+		"  --no-fsync           Don't flush persisted writes to the device, a machine crash may then lose acknowledged transactions\n"
+		"  --snapshot-mb N      Journal megabytes between snapshots of the graph (default 256)\n";
+}
+
+static bool ParseStorageBackend(const char* Value, ServerStorageBackend& OutBackend)
+{
+	for (ServerStorageBackend backend : { ServerStorageBackend::AUTO, ServerStorageBackend::IO_URING, ServerStorageBackend::THREAD_POOL })
+	{
+		if (Value != nullptr && strcmp(Value, GetServerStorageBackendName(backend)) == 0)
+		{
+			OutBackend = backend;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool ParseServerArguments(int argc, char** argv, ServerConfig& OutConfig)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const char* arg = argv[argIndex];
+		const char* value = argIndex + 1 < argc ? argv[argIndex + 1] : nullptr;
+
+		auto ConsumeValue = [&](unsigned long long& OutValue)
+		{
+			if (value == nullptr) return false;
+			char* end = nullptr;
+			OutValue = strtoull(value, &end, 10);
+			argIndex++;
+			return end != value && *end == '\0';
+		};
+
+		unsigned long long number = 0;
+		if (strcmp(arg, "--port") == 0 && ConsumeValue(number) && number > 0 && number <= 65535) OutConfig.Port = (uint16_t)number;
+		else if (strcmp(arg, "--any-address") == 0) OutConfig.bLoopbackOnly = false;
+		else if (strcmp(arg, "--threads") == 0 && ConsumeValue(number)) OutConfig.ThreadCount = (uint32_t)number;
+		else if (strcmp(arg, "--max-sessions") == 0 && ConsumeValue(number)) OutConfig.MaxSessionCount = (size_t)number;
+		else if (strcmp(arg, "--max-nodes") == 0 && ConsumeValue(number) && number > 0) OutConfig.MaxNodeCount = (size_t)number;
+		else if (strcmp(arg, "--max-connections") == 0 && ConsumeValue(number)) OutConfig.MaxConnectionCount = (size_t)number;
+		else if (strcmp(arg, "--shards") == 0 && ConsumeValue(number) && number <= SERVER_MAX_SHARD_COUNT) OutConfig.ShardCount = (uint32_t)number;
+		else if (strcmp(arg, "--bulk-file") == 0 && value != nullptr) { OutConfig.BulkFilePath = value; argIndex++; }
+		else if (strcmp(arg, "--metrics-port") == 0 && ConsumeValue(number) && number <= 65535) OutConfig.MetricsPort = (uint16_t)number;
+		else if (strcmp(arg, "--data-dir") == 0 && value != nullptr) { OutConfig.DataDirectory = value; argIndex++; }
+		else if (strcmp(arg, "--storage-backend") == 0 && ParseStorageBackend(value, OutConfig.StorageBackend)) argIndex++;
+		else if (strcmp(arg, "--no-fsync") == 0) OutConfig.bSyncJournal = false;
+		else if (strcmp(arg, "--snapshot-mb") == 0 && ConsumeValue(number) && number > 0) OutConfig.SnapshotJournalSize = (size_t)number << 20;
+		else
+		{
+			std::cerr << "Invalid argument: " << arg << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
 int main(int argc, char** argv)
 {
-	std::cout << "Hello World ! This is the Server.\n";
+	std::cout << "Starting server.\n";
+
+	ServerState* server = new ServerState();
+	if (!ParseServerArguments(argc, argv, server->Config))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (server->Config.ShardCount == 0)
+	{
+		server->Config.ShardCount = GetServerWorkerCount(server->Config);
+		server->Config.ShardCount = server->Config.ShardCount > SERVER_MAX_SHARD_COUNT ? SERVER_MAX_SHARD_COUNT : server->Config.ShardCount;
+	}
+
+	// With a data directory, the graph comes from there unless it holds nothing yet.
+	const bool bGraphReady = server->Config.DataDirectory != nullptr ? OpenServerPersistence(*server)
+		: InitializeServerGraph(server->Graph, server->Config);
+	if (!bGraphReady)
+	{
+		std::cerr << "Failed to initialize the Server Graph !\n";
+		return 1;
+	}
+
+	signal(SIGINT, HandleStopSignal);
+	signal(SIGTERM, HandleStopSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	if (!StartServerNetwork(*server))
+	{
+		CloseServerPersistence(*server);
+		ShutdownServerGraph(server->Graph);
+		return 1;
+	}
+
+	if (!StartServerMetrics(*server))
+	{
+		StopServerNetwork(*server);
+		CloseServerPersistence(*server);
+		ShutdownServerGraph(server->Graph);
+		return 1;
+	}
+
+	std::cout << "Listening on port " << server->Config.Port << " with " << server->Workers.size() << " worker threads and "
+		<< server->Graph.ShardCount << " graph shards.\n";
+	if (server->Config.MetricsPort != 0)
+	{
+		std::cout << "Serving metrics on port " << server->Config.MetricsPort << ".\n";
+	}
+
+	// Periodic status line and metrics scrapes, until a stop signal comes in.
+	auto lastReport = std::chrono::steady_clock::now();
+	while (!GStopRequested)
+	{
+		ServeServerMetrics(*server, 100);
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - lastReport >= std::chrono::seconds(10))
+		{
+			lastReport = now;
+
+			ServerMetricsSummary summary;
+			SummarizeServerMetrics(*server, summary);
+
+			const uint64_t appliedCount = summary.TransactionCounts[(size_t)SGraphTransactionStatus::APPLIED];
+			uint64_t rejectedCount = 0;
+			for (uint64_t count : summary.TransactionCounts) rejectedCount += count;
+			rejectedCount -= appliedCount;
+
+			std::cout << "Sessions: " << server->SessionCount << " | Nodes: " << GetServerGraphNodeCount(server->Graph)
+				<< " | Transactions applied: " << appliedCount << ", rejected: " << rejectedCount
+				<< " | Visibility cache hits: " << server->Graph.VisibilityCache.HitCount
+				<< ", misses: " << server->Graph.VisibilityCache.MissCount << "\n";
+		}
+	}
+
+	std::cout << "Shutting down server.\n";
+	StopServerMetrics(*server);
+	StopServerNetwork(*server);
+	CloseServerPersistence(*server);
+	ShutdownServerGraph(server->Graph);
+	delete server;
 	return 0;
-}
\ No newline at end of file
+}